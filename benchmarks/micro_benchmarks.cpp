@@ -0,0 +1,172 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "evaluation.h"
+#include "movegen.h"
+#include "movelist.h"
+#include "nnue/evaluator.h"
+#include "notation.h"
+#include "tt.h"
+
+namespace chiron {
+
+namespace {
+
+// Opening, tactical middlegame and pawn endgame: movegen cost varies a lot between them.
+const std::array<const char*, 3> kPositions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+
+Board position(const benchmark::State& state) {
+    Board board;
+    board.set_from_fen(kPositions[static_cast<std::size_t>(state.range(0))]);
+    return board;
+}
+
+void BM_GenerateLegalMoves(benchmark::State& state) {
+    Board board = position(state);
+    MoveList moves;
+    for (auto _ : state) {
+        moves.clear();
+        MoveGenerator::generate_legal_moves(board, moves);
+        benchmark::DoNotOptimize(moves.size());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GenerateLegalMoves)->DenseRange(0, 2);
+
+void BM_MakeUndoMove(benchmark::State& state) {
+    Board board = position(state);
+    std::vector<Move> moves = MoveGenerator::generate_legal_moves(board);
+    for (auto _ : state) {
+        for (const Move& move : moves) {
+            Board::State undo;
+            board.make_move(move, undo);
+            board.undo_move(move, undo);
+        }
+        benchmark::DoNotOptimize(board.zobrist_key());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(moves.size()));
+}
+BENCHMARK(BM_MakeUndoMove)->DenseRange(0, 2);
+
+void BM_IsSquareAttacked(benchmark::State& state) {
+    Board board = position(state);
+    for (auto _ : state) {
+        int attacked = 0;
+        for (int square = 0; square < kBoardSize; ++square) {
+            attacked += board.is_square_attacked(static_cast<Square>(square), Color::White);
+            attacked += board.is_square_attacked(static_cast<Square>(square), Color::Black);
+        }
+        benchmark::DoNotOptimize(attacked);
+    }
+    state.SetItemsProcessed(state.iterations() * 2 * kBoardSize);
+}
+BENCHMARK(BM_IsSquareAttacked)->DenseRange(0, 2);
+
+void BM_BuildAccumulator(benchmark::State& state) {
+    Board board = position(state);
+    std::shared_ptr<nnue::Evaluator> evaluator = global_evaluator();
+    evaluator->ensure_network_loaded();
+    auto accumulator = std::make_unique<nnue::Accumulator>();
+    for (auto _ : state) {
+        evaluator->build_accumulator(board, *accumulator);
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_BuildAccumulator)->DenseRange(0, 2);
+
+void BM_UpdateAccumulator(benchmark::State& state) {
+    Board board = position(state);
+    std::shared_ptr<nnue::Evaluator> evaluator = global_evaluator();
+    evaluator->ensure_network_loaded();
+    auto base = std::make_unique<nnue::Accumulator>();
+    auto child = std::make_unique<nnue::Accumulator>();
+    evaluator->build_accumulator(board, *base);
+    std::vector<Move> moves = MoveGenerator::generate_legal_moves(board);
+    for (auto _ : state) {
+        for (const Move& move : moves) {
+            evaluator->update_accumulator(board, move, *base, *child);
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(moves.size()));
+}
+BENCHMARK(BM_UpdateAccumulator)->DenseRange(0, 2);
+
+void BM_Evaluate(benchmark::State& state) {
+    Board board = position(state);
+    std::shared_ptr<nnue::Evaluator> evaluator = global_evaluator();
+    evaluator->ensure_network_loaded();
+    auto accumulator = std::make_unique<nnue::Accumulator>();
+    evaluator->build_accumulator(board, *accumulator);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(evaluator->evaluate(board, *accumulator));
+    }
+}
+BENCHMARK(BM_Evaluate)->DenseRange(0, 2);
+
+/**
+ * Every thread probes and stores random keys in one shared 16 MB table, so the multi-threaded
+ * runs measure the lock-free buckets under contention.
+ */
+void BM_TranspositionTableProbeStore(benchmark::State& state) {
+    static TranspositionTable table(1);
+    if (state.thread_index() == 0) {
+        table.resize_mb(16);
+        table.new_search();
+    }
+    std::mt19937_64 rng(static_cast<std::uint64_t>(state.thread_index()) + 1);
+    std::vector<std::uint64_t> keys(4096);
+    for (std::uint64_t& key : keys) {
+        key = rng();
+    }
+    std::size_t next = 0;
+    TTEntry entry;
+    for (auto _ : state) {
+        std::uint64_t key = keys[next++ & (keys.size() - 1)];
+        if (!table.probe(key, entry)) {
+            table.store(key, 8, 25, PackedMove{}, 0, 10);
+        }
+        benchmark::DoNotOptimize(entry);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TranspositionTableProbeStore)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_ParseFen(benchmark::State& state) {
+    std::string fen = kPositions[static_cast<std::size_t>(state.range(0))];
+    Board board;
+    for (auto _ : state) {
+        board.set_from_fen(fen);
+        benchmark::DoNotOptimize(board.zobrist_key());
+    }
+}
+BENCHMARK(BM_ParseFen)->DenseRange(0, 2);
+
+void BM_MoveToSan(benchmark::State& state) {
+    Board board = position(state);
+    std::vector<Move> moves = MoveGenerator::generate_legal_moves(board);
+    for (auto _ : state) {
+        for (const Move& move : moves) {
+            benchmark::DoNotOptimize(move_to_san(board, move));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(moves.size()));
+}
+BENCHMARK(BM_MoveToSan)->DenseRange(0, 2);
+
+}  // namespace
+
+}  // namespace chiron
+
+BENCHMARK_MAIN();
@@ -0,0 +1,94 @@
+#include "pawn_structure.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace chiron {
+
+namespace {
+
+// Passed pawn bonus by rank counted from the pawn's own side.
+constexpr int kPassedBonus[8] = {0, 5, 10, 20, 35, 60, 100, 0};
+constexpr int kIsolatedPenalty = 12;
+constexpr int kDoubledPenalty = 10;
+
+Bitboard fill_north(Bitboard b) {
+    b |= b << 8;
+    b |= b << 16;
+    b |= b << 32;
+    return b;
+}
+
+Bitboard fill_south(Bitboard b) {
+    b |= b >> 8;
+    b |= b >> 16;
+    b |= b >> 32;
+    return b;
+}
+
+Bitboard file_fill(Bitboard b) { return fill_north(b) | fill_south(b); }
+
+int side_score(Bitboard passed, Bitboard isolated, Bitboard doubled, Color color) {
+    int score = -kIsolatedPenalty * popcount(isolated) - kDoubledPenalty * popcount(doubled);
+    while (passed) {
+        int rank = rank_of(static_cast<Square>(pop_lsb(passed)));
+        score += kPassedBonus[color == Color::White ? rank : 7 - rank];
+    }
+    return score;
+}
+
+}  // namespace
+
+PawnEntry analyze_pawns(const Board& board) {
+    PawnEntry entry;
+    entry.key = board.pawn_key();
+    const Bitboard white = board.pieces(Color::White, PieceType::Pawn);
+    const Bitboard black = board.pieces(Color::Black, PieceType::Pawn);
+
+    // Squares ahead of each side's pawns on their own and the adjacent files.
+    Bitboard white_front = fill_north(north(white));
+    Bitboard black_front = fill_south(south(black));
+    Bitboard white_span = white_front | east(white_front) | west(white_front);
+    Bitboard black_span = black_front | east(black_front) | west(black_front);
+
+    entry.passed[0] = white & ~black_span & ~fill_south(south(white));
+    entry.passed[1] = black & ~white_span & ~fill_north(north(black));
+
+    Bitboard white_files = file_fill(white);
+    Bitboard black_files = file_fill(black);
+    entry.isolated[0] = white & ~(east(white_files) | west(white_files));
+    entry.isolated[1] = black & ~(east(black_files) | west(black_files));
+
+    // Every pawn with a friendly pawn in front of it on the same file.
+    entry.doubled[0] = white & fill_south(south(white));
+    entry.doubled[1] = black & fill_north(north(black));
+
+    entry.score = side_score(entry.passed[0], entry.isolated[0], entry.doubled[0], Color::White) -
+                  side_score(entry.passed[1], entry.isolated[1], entry.doubled[1], Color::Black);
+    return entry;
+}
+
+PawnHashTable::PawnHashTable(std::size_t entries) {
+    std::size_t size = std::bit_floor(std::max<std::size_t>(entries, 1));
+    entries_.assign(size, PawnEntry{});
+    mask_ = size - 1;
+}
+
+const PawnEntry& PawnHashTable::probe(const Board& board) {
+    std::uint64_t key = board.pawn_key();
+    PawnEntry& entry = entries_[key & mask_];
+    // Empty slots hold key 0 with an all-zero analysis, which is exactly the pawnless entry.
+    if (entry.key != key) {
+        entry = analyze_pawns(board);
+    }
+    return entry;
+}
+
+void PawnHashTable::clear() { std::fill(entries_.begin(), entries_.end(), PawnEntry{}); }
+
+int pawn_structure_score(const Board& board, PawnHashTable& table) {
+    int score = table.probe(board).score;
+    return board.side_to_move() == Color::White ? score : -score;
+}
+
+}  // namespace chiron
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+#include "board.h"
+
+namespace chiron {
+
+/**
+ * @brief Classical pawn-structure analysis of one pawn configuration.
+ *
+ * Masks are indexed by color. The score is in centipawns from White's point of view and
+ * depends only on the pawns, so it can be cached under Board::pawn_key().
+ */
+struct PawnEntry {
+    std::uint64_t key = 0ULL;
+    std::array<Bitboard, kNumColors> passed{};
+    std::array<Bitboard, kNumColors> isolated{};
+    std::array<Bitboard, kNumColors> doubled{};
+    int score = 0;
+};
+
+/**
+ * @brief Computes the pawn-structure entry for @p board without consulting any cache.
+ */
+[[nodiscard]] PawnEntry analyze_pawns(const Board& board);
+
+/**
+ * @brief Direct-mapped cache of PawnEntry records keyed by the pawn-only Zobrist key.
+ *
+ * Pawn structure changes on few moves, so almost every probe hits and the hybrid term costs
+ * one cache line per node. Each search thread owns its own table.
+ */
+class PawnHashTable {
+   public:
+    static constexpr std::size_t kDefaultEntries = 1ULL << 13;
+
+    /** @brief Allocates @p entries slots rounded down to a power of two. */
+    explicit PawnHashTable(std::size_t entries = kDefaultEntries);
+
+    /**
+     * @brief Returns the entry for the pawns of @p board, analysing and storing it on a miss.
+     */
+    const PawnEntry& probe(const Board& board);
+
+    void clear();
+
+   private:
+    std::vector<PawnEntry> entries_;
+    std::size_t mask_ = 0;
+};
+
+/**
+ * @brief Pawn-structure score from the side to move's point of view, through @p table.
+ */
+[[nodiscard]] int pawn_structure_score(const Board& board, PawnHashTable& table);
+
+}  // namespace chiron
@@ -6,19 +6,30 @@
 #include <iostream>
 
 #include "bitboard.h"
+#include "nnue/feature_set.h"
+#include "nnue/network_cache.h"
+#include "nnue/simd.h"
 
 namespace chiron::nnue {
 
 Evaluator::Evaluator() = default;
 
 void Evaluator::set_network_path(std::string path) {
-
     std::scoped_lock guard(load_mutex_);
-
     network_path_ = std::move(path);
     network_loaded_.store(false, std::memory_order_relaxed);
 }
 
+void Evaluator::set_network(std::shared_ptr<const Network> network) {
+    std::scoped_lock guard(load_mutex_);
+    network_path_.clear();
+    use_quantized_ = false;
+    quantized_.reset();
+    network_ = network ? std::move(network) : default_network();
+    network_generation_.fetch_add(1, std::memory_order_relaxed);
+    network_loaded_.store(true, std::memory_order_release);
+}
+
 void Evaluator::ensure_network_loaded() const {
     if (network_loaded_.load(std::memory_order_acquire)) {
         return;
@@ -26,75 +37,113 @@ void Evaluator::ensure_network_loaded() const {
 
     std::scoped_lock guard(load_mutex_);
     if (network_loaded_.load(std::memory_order_acquire)) {
-
         return;
     }
+    use_quantized_ = false;
+    quantized_.reset();
+    network_ = default_network();
     try {
-        if (!network_path_.empty()) {
-            network_.load_from_file(network_path_);
+        if (network_path_.empty()) {
+            // The shared default is already in place.
+        } else if (QuantizedNetwork::is_quantized_file(network_path_)) {
+            quantized_ = acquire_quantized_network(network_path_);
+            use_quantized_ = true;
         } else {
-            network_.load_default();
+            network_ = acquire_network(network_path_);
         }
     } catch (const std::exception& ex) {
         std::cerr << "info string NNUE fallback: " << ex.what() << std::endl;
-        network_.load_default();
+        network_ = default_network();
     }
+    network_generation_.fetch_add(1, std::memory_order_relaxed);
     network_loaded_.store(true, std::memory_order_release);
 }
 
-void Evaluator::apply_feature(Accumulator& accum, Color color, PieceType piece, int square, int sign) const {
-    if (piece == PieceType::None || square < 0 || square >= kBoardSize) {
+void Evaluator::add_feature_row(int32_t* lane, std::size_t feature, int sign) const {
+    std::size_t hidden = hidden_size();
+    if (use_quantized_) {
+        const int16_t* row = quantized_->feature_weights(feature);
+        if (sign > 0) {
+            simd::add_row(lane, row, hidden);
+        } else {
+            simd::sub_row(lane, row, hidden);
+        }
         return;
     }
-    const Network& net = network();
-    std::size_t hidden = net.hidden_size();
-    if (accum.white.size() != hidden || accum.black.size() != hidden) {
-        accum.reset(hidden);
+    const int32_t* row = network_->feature_weights(feature);
+    if (sign > 0) {
+        simd::add_row(lane, row, hidden);
+    } else {
+        simd::sub_row(lane, row, hidden);
     }
-    std::size_t feature = feature_index(color, piece, square);
-    for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
-        int32_t weight = net.input_weight(feature, neuron);
-        if (color == Color::White) {
-            accum.white[neuron] += sign * weight;
-        } else {
-            accum.black[neuron] += sign * weight;
-        }
+}
+
+void Evaluator::build_lane(const Board& board, Color lane, Accumulator& accum) const {
+    int32_t* target = lane == Color::White ? accum.white.data() : accum.black.data();
+    std::fill_n(target, hidden_size(), 0);
+    std::array<std::size_t, kMaxActiveFeatures> features{};
+    std::size_t count = append_active_features(board, feature_set(), lane, features.data());
+    for (std::size_t i = 0; i < count; ++i) {
+        add_feature_row(target, features[i], +1);
     }
 }
 
 void Evaluator::build_accumulator(const Board& board, Accumulator& accum) const {
     ensure_network_loaded();
-    const Network& net = network();
-    accum.reset(net.hidden_size());
+    accum.reset(hidden_size());
+    build_lane(board, Color::White, accum);
+    build_lane(board, Color::Black, accum);
+}
+
+void Evaluator::refresh_lane(const Board& board, Color lane, Accumulator& accum, RefreshTable& table) const {
+    int king = board.king_square(lane);
+    if (king < 0) {
+        build_lane(board, lane, accum);
+        return;
+    }
+    table.sync(network_generation_.load(std::memory_order_relaxed));
+    RefreshTable::Entry& cached = table.entry(lane, king);
+    std::size_t hidden = hidden_size();
+    if (!cached.valid) {
+        std::fill_n(cached.lane.begin(), hidden, 0);
+        cached.pieces.fill(0);
+        cached.valid = true;
+    }
+
+    // Bring the cached lane up to date with the pieces that differ, then hand out a copy.
     for (int color = 0; color < kNumColors; ++color) {
-        for (int piece = 0; piece < kNumPieceTypes; ++piece) {
-            Bitboard bb = board.pieces(static_cast<Color>(color), static_cast<PieceType>(piece));
-            while (bb) {
-                int square = pop_lsb(bb);
-                apply_feature(accum, static_cast<Color>(color), static_cast<PieceType>(piece), square, +1);
+        for (int piece = 0; piece < kNumPieceTypes - 1; ++piece) {
+            Color piece_color = static_cast<Color>(color);
+            PieceType type = static_cast<PieceType>(piece);
+            Bitboard& snapshot = cached.pieces[static_cast<std::size_t>(color * kNumPieceTypes + piece)];
+            Bitboard current = board.pieces(piece_color, type);
+            Bitboard added = current & ~snapshot;
+            Bitboard removed = snapshot & ~current;
+            while (added) {
+                add_feature_row(cached.lane.data(), halfkp_index(lane, king, piece_color, type, pop_lsb(added)), +1);
+            }
+            while (removed) {
+                add_feature_row(cached.lane.data(), halfkp_index(lane, king, piece_color, type, pop_lsb(removed)),
+                                -1);
             }
+            snapshot = current;
         }
     }
+    int32_t* target = lane == Color::White ? accum.white.data() : accum.black.data();
+    std::copy_n(cached.lane.begin(), hidden, target);
 }
 
-void Evaluator::update_accumulator(const Board& board, const Move& move, const Accumulator& base,
-                                   Accumulator& dest) const {
-    ensure_network_loaded();
-    dest = base;
-
+void Evaluator::record_delta(const Board& board, const Move& move, FeatureDelta& delta) const {
+    delta = FeatureDelta{};
     Color us = board.side_to_move();
     PieceType moving_piece = board.piece_type_at(move.from);
     if (moving_piece == PieceType::None) {
         return;
     }
 
-    apply_feature(dest, us, moving_piece, move.from, -1);
-
-    PieceType placed_piece = moving_piece;
-    if (move.is_promotion()) {
-        placed_piece = move.promotion;
-    }
-    apply_feature(dest, us, placed_piece, move.to, +1);
+    delta.remove(feature_index(us, moving_piece, move.from));
+    PieceType placed_piece = move.is_promotion() ? move.promotion : moving_piece;
+    delta.add(feature_index(us, placed_piece, move.to));
 
     if (move.is_capture()) {
         Color them = opposite_color(us);
@@ -103,7 +152,7 @@ void Evaluator::update_accumulator(const Board& board, const Move& move, const A
         if (move.is_en_passant()) {
             capture_square += (us == Color::White ? -8 : 8);
         }
-        apply_feature(dest, them, captured_piece, capture_square, -1);
+        delta.remove(feature_index(them, captured_piece, capture_square));
     }
 
     if (move.is_castle()) {
@@ -116,30 +165,207 @@ void Evaluator::update_accumulator(const Board& board, const Move& move, const A
             rook_from = (us == Color::White) ? static_cast<int>(Square::A1) : static_cast<int>(Square::A8);
             rook_to = (us == Color::White) ? static_cast<int>(Square::D1) : static_cast<int>(Square::D8);
         }
-        apply_feature(dest, us, PieceType::Rook, rook_from, -1);
-        apply_feature(dest, us, PieceType::Rook, rook_to, +1);
+        delta.remove(feature_index(us, PieceType::Rook, rook_from));
+        delta.add(feature_index(us, PieceType::Rook, rook_to));
     }
 }
 
-int Evaluator::evaluate(const Board& board, const Accumulator& accum) const {
+namespace {
+
+struct PieceKey {
+    Color color;
+    PieceType piece;
+    int square;
+};
+
+// Each deferred delta adds and removes at most two features per lane.
+constexpr std::size_t kMaxLaneRows = kMaxPendingDeltas * 2;
+using LaneFeatures = std::array<std::size_t, kMaxLaneRows>;
+
+template <typename Row, typename RowOf>
+void sweep_lane(int32_t* dst, const int32_t* src, const LaneFeatures* features, const std::size_t* counts,
+                std::size_t hidden, RowOf row_of) {
+    std::array<const Row*, kMaxLaneRows> added;
+    std::array<const Row*, kMaxLaneRows> removed;
+    for (std::size_t j = 0; j < counts[0]; ++j) {
+        added[j] = row_of(features[0][j]);
+    }
+    for (std::size_t j = 0; j < counts[1]; ++j) {
+        removed[j] = row_of(features[1][j]);
+    }
+    simd::apply_rows(dst, src, added.data(), counts[0], removed.data(), counts[1], hidden);
+}
+
+PieceKey decode_key(std::size_t key) {
+    std::size_t per_color = static_cast<std::size_t>(kNumPieceTypes) * kBoardSize;
+    return PieceKey{static_cast<Color>(key / per_color), static_cast<PieceType>((key % per_color) / kBoardSize),
+                    static_cast<int>(key % kBoardSize)};
+}
+
+}  // namespace
+
+void Evaluator::update_accumulator(const Board& board, const Move& move, const Accumulator& base,
+                                   Accumulator& dest) const {
     ensure_network_loaded();
-    const Network& net = network();
-    std::size_t hidden = net.hidden_size();
-    double raw = static_cast<double>(net.bias());
-    for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
-        int32_t pre = 0;
-        if (neuron < accum.white.size()) {
-            pre += accum.white[neuron];
+    record_delta(board, move, dest.delta);
+    if (feature_set() == FeatureSet::HalfKP && board.piece_type_at(move.from) == PieceType::King) {
+        // The mover's lane is keyed by its king square, so it has to be rebuilt after the move.
+        Board child = board;
+        Board::State state;
+        child.make_move(move, state);
+        build_accumulator(child, dest);
+        return;
+    }
+    const FeatureDelta* deltas[] = {&dest.delta};
+    apply_deltas(board, base, deltas, 1, 0U, nullptr, dest);
+}
+
+void Evaluator::record_move(const Board& board, const Move& move, Accumulator& dest) const {
+    record_delta(board, move, dest.delta);
+    dest.computed = false;
+}
+
+void Evaluator::record_null_move(Accumulator& dest) const {
+    dest.delta = FeatureDelta{};
+    dest.computed = false;
+}
+
+void Evaluator::materialize(const Board& board, Accumulator* stack, std::size_t ply, RefreshTable* table) const {
+    Accumulator& target = stack[ply];
+    if (target.computed) {
+        return;
+    }
+    ensure_network_loaded();
+
+    bool king_relative = feature_set() == FeatureSet::HalfKP;
+    std::size_t base = ply;
+    std::size_t pending = 0;
+    unsigned refresh_lanes = 0U;
+    while (base > 0 && !stack[base].computed) {
+        const FeatureDelta& delta = stack[base].delta;
+        pending += delta.added_count + delta.removed_count;
+        for (std::size_t j = 0; king_relative && j < delta.removed_count; ++j) {
+            PieceKey key = decode_key(delta.removed[j]);
+            if (key.piece == PieceType::King) {
+                refresh_lanes |= 1U << static_cast<unsigned>(key.color);
+            }
+        }
+        --base;
+    }
+
+    // Past this many changed features a refresh from the board touches fewer rows.
+    std::size_t pieces = static_cast<std::size_t>(popcount(board.occupancy_all()));
+    std::size_t depth = ply - base;
+    if (!stack[base].computed || stack[base].size() != hidden_size() || depth > kMaxPendingDeltas ||
+        pending > pieces || refresh_lanes == 3U) {
+        if (table != nullptr && king_relative) {
+            target.hidden = hidden_size();
+            refresh_lane(board, Color::White, target, *table);
+            refresh_lane(board, Color::Black, target, *table);
+            target.computed = true;
+        } else {
+            build_accumulator(board, target);
+        }
+        return;
+    }
+
+    std::array<const FeatureDelta*, kMaxPendingDeltas> deltas;
+    for (std::size_t i = 0; i < depth; ++i) {
+        deltas[i] = &stack[base + 1 + i].delta;
+    }
+    apply_deltas(board, stack[base], deltas.data(), depth, refresh_lanes, table, target);
+}
+
+void Evaluator::apply_deltas(const Board& board, const Accumulator& source, const FeatureDelta* const* deltas,
+                             std::size_t delta_count, unsigned refresh_lanes, RefreshTable* table,
+                             Accumulator& target) const {
+    // Split the changes per lane so each lane is swept exactly once. A king-relative network
+    // sees every non-king piece from both kings, so each change lands in both lanes.
+    bool king_relative = feature_set() == FeatureSet::HalfKP;
+    LaneFeatures features[kNumColors][2];
+    std::size_t counts[kNumColors][2] = {};
+    int kings[kNumColors] = {};
+    if (king_relative) {
+        kings[0] = board.king_square(Color::White);
+        kings[1] = board.king_square(Color::Black);
+    }
+    auto route = [&](std::size_t key, std::size_t kind) {
+        if (!king_relative) {
+            std::size_t lane = key / (static_cast<std::size_t>(kNumPieceTypes) * kBoardSize);
+            features[lane][kind][counts[lane][kind]++] = key;
+            return;
+        }
+        PieceKey decoded = decode_key(key);
+        if (decoded.piece == PieceType::King) {
+            return;
+        }
+        for (std::size_t lane = 0; lane < kNumColors; ++lane) {
+            if ((refresh_lanes >> lane) & 1U) {
+                continue;
+            }
+            features[lane][kind][counts[lane][kind]++] =
+                halfkp_index(static_cast<Color>(lane), kings[lane], decoded.color, decoded.piece, decoded.square);
         }
-        if (neuron < accum.black.size()) {
-            pre -= accum.black[neuron];
+    };
+    for (std::size_t i = 0; i < delta_count; ++i) {
+        const FeatureDelta& delta = *deltas[i];
+        for (std::size_t j = 0; j < delta.added_count; ++j) {
+            route(delta.added[j], 0);
         }
-        pre += net.hidden_bias(neuron);
-        double normalized = static_cast<double>(pre) / kActivationScale;
-        double activation = std::tanh(normalized) * kActivationScale;
-        raw += activation * static_cast<double>(net.output_weight(neuron));
+        for (std::size_t j = 0; j < delta.removed_count; ++j) {
+            route(delta.removed[j], 1);
+        }
+    }
+
+    std::size_t hidden = source.size();
+    target.hidden = hidden;
+    for (std::size_t lane = 0; lane < kNumColors; ++lane) {
+        if ((refresh_lanes >> lane) & 1U) {
+            if (table != nullptr) {
+                refresh_lane(board, static_cast<Color>(lane), target, *table);
+            } else {
+                build_lane(board, static_cast<Color>(lane), target);
+            }
+            continue;
+        }
+        const int32_t* src = lane == 0 ? source.white.data() : source.black.data();
+        int32_t* dst = lane == 0 ? target.white.data() : target.black.data();
+        if (use_quantized_) {
+            sweep_lane<int16_t>(dst, src, features[lane], counts[lane], hidden,
+                                [this](std::size_t feature) { return quantized_->feature_weights(feature); });
+        } else {
+            sweep_lane<int32_t>(dst, src, features[lane], counts[lane], hidden,
+                                [this](std::size_t feature) { return network_->feature_weights(feature); });
+        }
+    }
+    target.computed = true;
+}
+
+int Evaluator::evaluate(const Board& board, const Accumulator& accum) const {
+    ensure_network_loaded();
+    std::size_t hidden = hidden_size();
+    if (accum.size() != hidden) {
+        Accumulator rebuilt;
+        build_accumulator(board, rebuilt);
+        return evaluate(board, rebuilt);
+    }
+    double scaled = 0.0;
+    if (use_quantized_) {
+        // Shifted activations carry +clip per neuron; remove it once via the weight sum.
+        int32_t dot = simd::crelu_dot(accum.white.data(), accum.black.data(), quantized_->hidden_biases().data(),
+                                      quantized_->output_weights().data(), hidden, quantized_->clip());
+        dot -= quantized_->clip() * quantized_->output_weight_sum();
+        double raw = static_cast<double>(quantized_->bias()) +
+                     static_cast<double>(dot) * static_cast<double>(quantized_->output_dequant());
+        scaled = raw * static_cast<double>(quantized_->scale());
+    } else {
+        double raw = static_cast<double>(network_->bias());
+        raw += static_cast<double>(simd::activate_and_dot(accum.white.data(), accum.black.data(),
+                                                          network_->hidden_biases_data().data(),
+                                                          network_->output_weights_data().data(), hidden,
+                                                          static_cast<float>(kActivationScale)));
+        scaled = raw * static_cast<double>(network_->scale());
     }
-    double scaled = raw * static_cast<double>(net.scale());
     int score = static_cast<int>(std::llround(scaled));
     score = std::clamp(score, -kMaxEvaluationMagnitude, kMaxEvaluationMagnitude);
     return board.side_to_move() == Color::White ? score : -score;
@@ -147,7 +373,22 @@ int Evaluator::evaluate(const Board& board, const Accumulator& accum) const {
 
 const Network& Evaluator::network() const {
     ensure_network_loaded();
-    return network_;
+    return *network_;
+}
+
+bool Evaluator::is_quantized() const {
+    ensure_network_loaded();
+    return use_quantized_;
+}
+
+std::size_t Evaluator::hidden_size() const {
+    ensure_network_loaded();
+    return use_quantized_ ? quantized_->hidden_size() : network_->hidden_size();
+}
+
+FeatureSet Evaluator::feature_set() const {
+    ensure_network_loaded();
+    return use_quantized_ ? quantized_->feature_set() : network_->feature_set();
 }
 
 }  // namespace chiron::nnue
@@ -1,56 +1,193 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include "bitboard.h"
 #include "board.h"
 #include "move.h"
 #include "nnue/network.h"
+#include "nnue/quantized.h"
 
 namespace chiron::nnue {
 
 // Clamp evaluations so runaway training updates cannot be mistaken for mate scores.
 constexpr int kMaxEvaluationMagnitude = 30000;
 
+// Deepest chain of deferred updates folded into one pass before falling back to a refresh.
+constexpr std::size_t kMaxPendingDeltas = 16;
+
+/**
+ * @brief Piece changes made by one move ("dirty pieces"); castling is the widest case.
+ *
+ * Entries are piece-square keys as produced by feature_index(), which the evaluator maps to
+ * the inputs of whichever FeatureSet the loaded network uses.
+ */
+struct FeatureDelta {
+    std::array<std::uint16_t, 2> added{};
+    std::array<std::uint16_t, 2> removed{};
+    std::uint8_t added_count = 0;
+    std::uint8_t removed_count = 0;
+
+    void add(std::size_t feature) { added[added_count++] = static_cast<std::uint16_t>(feature); }
+    void remove(std::size_t feature) { removed[removed_count++] = static_cast<std::uint16_t>(feature); }
+};
+
 /**
  * @brief Accumulator storing the summed NNUE feature contributions for both colors.
+ *
+ * Storage is inline and cache-line aligned with a compile-time capacity, so search stacks of
+ * accumulators are allocated once and walking the tree never touches the heap. Only the
+ * first size() lanes are meaningful; copy_from() moves just those.
+ *
+ * In a search stack an entry may be left un-computed, holding only the FeatureDelta from
+ * its parent; Evaluator::materialize() resolves it when an evaluation is actually needed.
  */
-struct Accumulator {
-    std::vector<int32_t> white;
-    std::vector<int32_t> black;
+template <std::size_t Capacity>
+struct BasicAccumulator {
+    static constexpr std::size_t kCapacity = Capacity;
+
+    alignas(64) std::array<int32_t, Capacity> white;
+    alignas(64) std::array<int32_t, Capacity> black;
+    std::size_t hidden = 0;
+    bool computed = false;
+    FeatureDelta delta{};
+
+    [[nodiscard]] std::size_t size() const { return hidden; }
 
     void reset(std::size_t hidden_size) {
-        white.assign(hidden_size, 0);
-        black.assign(hidden_size, 0);
+        hidden = hidden_size;
+        computed = true;
+        std::fill_n(white.begin(), hidden, 0);
+        std::fill_n(black.begin(), hidden, 0);
+    }
+
+    void copy_from(const BasicAccumulator& other) {
+        hidden = other.hidden;
+        computed = other.computed;
+        std::copy_n(other.white.begin(), hidden, white.begin());
+        std::copy_n(other.black.begin(), hidden, black.begin());
     }
 };
 
+using Accumulator = BasicAccumulator<kMaxHiddenSize>;
+
+/**
+ * @brief Per-thread "Finny table" for king-relative (HalfKP) networks.
+ *
+ * Holds, for each perspective and king square, the lane last built there together with the
+ * piece placement it reflects. When a king move invalidates a lane, the refresh starts from
+ * the cached lane and only applies the pieces that differ, which is usually a handful of
+ * rows instead of one per piece.
+ */
+class RefreshTable {
+   public:
+    struct Entry {
+        alignas(64) std::array<int32_t, kMaxHiddenSize> lane{};
+        std::array<Bitboard, kNumColors * kNumPieceTypes> pieces{};
+        bool valid = false;
+    };
+
+    RefreshTable() : entries_(static_cast<std::size_t>(kNumColors) * kBoardSize) {}
+
+    [[nodiscard]] Entry& entry(Color perspective, int king_square) {
+        return entries_[static_cast<std::size_t>(perspective) * kBoardSize + static_cast<std::size_t>(king_square)];
+    }
+
+    /** @brief Drops every entry unless they were built for network load @p generation. */
+    void sync(std::uint64_t generation) {
+        if (generation == generation_) {
+            return;
+        }
+        for (Entry& cached : entries_) {
+            cached.valid = false;
+        }
+        generation_ = generation;
+    }
+
+   private:
+    std::vector<Entry> entries_;
+    std::uint64_t generation_ = 0;
+};
+
 /**
  * @brief High-level evaluator that wraps a lightweight NNUE network.
+ *
+ * A network path pointing at a quantized (NNQ1) file selects the integer inference path;
+ * any other file is loaded as a float network. Networks come from the process-wide cache
+ * (see acquire_network()), so evaluators of concurrent games share one copy.
  */
 class Evaluator {
    public:
     Evaluator();
 
     void set_network_path(std::string path);
+
+    /**
+     * @brief Binds an in-memory float network (e.g. freshly trained weights) instead of a file.
+     */
+    void set_network(std::shared_ptr<const Network> network);
     void ensure_network_loaded() const;
 
     void build_accumulator(const Board& board, Accumulator& accum) const;
     void update_accumulator(const Board& board, const Move& move, const Accumulator& base, Accumulator& dest) const;
 
+    /**
+     * @brief Records the feature changes of @p move (played from @p board) in @p dest without
+     *        touching its lanes; the update is deferred until materialize().
+     */
+    void record_move(const Board& board, const Move& move, Accumulator& dest) const;
+
+    /**
+     * @brief Marks @p dest as an unchanged copy of its parent (null move), also deferred.
+     */
+    void record_null_move(Accumulator& dest) const;
+
+    /**
+     * @brief Makes stack[ply] computed for @p board.
+     *
+     * Walks back to the nearest computed ancestor and folds every pending delta into a single
+     * pass. When the pending changes outnumber the pieces on the board (or span more than
+     * kMaxPendingDeltas plies) a full rebuild is cheaper and is used instead. With a HalfKP
+     * network, lanes whose king moved are refreshed through @p table when one is given.
+     */
+    void materialize(const Board& board, Accumulator* stack, std::size_t ply, RefreshTable* table = nullptr) const;
+
     int evaluate(const Board& board, const Accumulator& accum) const;
 
     [[nodiscard]] const Network& network() const;
+    [[nodiscard]] bool is_quantized() const;
+    [[nodiscard]] std::size_t hidden_size() const;
+    [[nodiscard]] FeatureSet feature_set() const;
+
+    /** @brief Incremented on every network load; caches of evaluations key their validity on it. */
+    [[nodiscard]] std::uint64_t network_generation() const {
+        return network_generation_.load(std::memory_order_relaxed);
+    }
 
    private:
-    void apply_feature(Accumulator& accum, Color color, PieceType piece, int square, int sign) const;
+    void add_feature_row(int32_t* lane, std::size_t feature, int sign) const;
+    void build_lane(const Board& board, Color lane, Accumulator& accum) const;
+    void refresh_lane(const Board& board, Color lane, Accumulator& accum, RefreshTable& table) const;
+    void record_delta(const Board& board, const Move& move, FeatureDelta& delta) const;
+    void apply_deltas(const Board& board, const Accumulator& source, const FeatureDelta* const* deltas,
+                      std::size_t delta_count, unsigned refresh_lanes, RefreshTable* table,
+                      Accumulator& target) const;
 
     std::string network_path_;
-    mutable Network network_{};
+    // Immutable and shared with every other evaluator that loaded the same file.
+    mutable std::shared_ptr<const Network> network_;
+    mutable std::shared_ptr<const QuantizedNetwork> quantized_;
+    mutable bool use_quantized_ = false;
     mutable std::atomic<bool> network_loaded_{false};
+    mutable std::atomic<std::uint64_t> network_generation_{0};
     mutable std::mutex load_mutex_;
 };
 
@@ -0,0 +1,35 @@
+#include "nnue/feature_set.h"
+
+#include "bitboard.h"
+
+namespace chiron::nnue {
+
+std::size_t append_active_features(const Board& board, FeatureSet set, Color lane, std::size_t* out) {
+    std::size_t count = 0;
+    if (set == FeatureSet::PieceSquare) {
+        for (int piece = 0; piece < kNumPieceTypes; ++piece) {
+            Bitboard bb = board.pieces(lane, static_cast<PieceType>(piece));
+            while (bb && count < kMaxActiveFeatures) {
+                out[count++] = feature_index(lane, static_cast<PieceType>(piece), pop_lsb(bb));
+            }
+        }
+        return count;
+    }
+
+    int king = board.king_square(lane);
+    if (king < 0) {
+        return 0;
+    }
+    for (int color = 0; color < kNumColors; ++color) {
+        for (int piece = 0; piece < kNumPieceTypes - 1; ++piece) {
+            Bitboard bb = board.pieces(static_cast<Color>(color), static_cast<PieceType>(piece));
+            while (bb && count < kMaxActiveFeatures) {
+                out[count++] =
+                    halfkp_index(lane, king, static_cast<Color>(color), static_cast<PieceType>(piece), pop_lsb(bb));
+            }
+        }
+    }
+    return count;
+}
+
+}  // namespace chiron::nnue
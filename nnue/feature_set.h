@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+#include "board.h"
+#include "nnue/network.h"
+
+namespace chiron::nnue {
+
+/** Upper bound on the inputs active in one lane (every piece on the board). */
+constexpr std::size_t kMaxActiveFeatures = 32;
+
+/**
+ * @brief Writes the input features active in @p lane for @p board and returns their count.
+ *
+ * For FeatureSet::PieceSquare the lane holds that color's pieces; for FeatureSet::HalfKP it
+ * holds every non-king piece relative to that color's king. @p out must have room for
+ * kMaxActiveFeatures entries.
+ */
+std::size_t append_active_features(const Board& board, FeatureSet set, Color lane, std::size_t* out);
+
+}  // namespace chiron::nnue
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace chiron::nnue {
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * Pages are shared with the OS page cache, so every mapping of the same file in every
+ * process costs physical memory only once. The mapping lives as long as the last
+ * shared_ptr returned by open().
+ */
+class MappedFile {
+   public:
+    /**
+     * @brief Maps @p path read-only; throws std::runtime_error if it cannot be opened or is empty.
+     */
+    static std::shared_ptr<const MappedFile> open(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    [[nodiscard]] const std::byte* data() const { return data_; }
+    [[nodiscard]] std::size_t size() const { return size_; }
+    [[nodiscard]] const std::string& path() const { return path_; }
+
+   private:
+    MappedFile() = default;
+
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::string path_;
+#ifdef _WIN32
+    void* mapping_handle_ = nullptr;
+#endif
+};
+
+}  // namespace chiron::nnue
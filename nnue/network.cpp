@@ -14,16 +14,96 @@ namespace {
 constexpr char kMagic[4] = {'N', 'N', 'U', 'E'};
 constexpr std::uint32_t kVersionV1 = 1U;
 constexpr std::uint32_t kVersionV2 = 2U;
+constexpr std::uint32_t kVersionV3 = 3U;
+
+// Version 3 stores every section 64-byte aligned and in its in-memory form (int32 biases,
+// float outputs, int32 feature-major weights) so a mapping can be used without conversion.
+constexpr std::size_t kSectionAlignment = 64;
+
+struct AlignedHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t feature_count;
+    std::uint32_t hidden_size;
+    std::int32_t bias;
+    float scale;
+    std::uint64_t biases_offset;
+    std::uint64_t outputs_offset;
+    std::uint64_t weights_offset;
+    std::uint64_t file_size;
+    std::uint8_t reserved[8];
+};
+static_assert(sizeof(AlignedHeader) == kSectionAlignment, "aligned NNUE header must fill one section");
+
+std::uint64_t align_up(std::uint64_t value) {
+    return (value + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+AlignedHeader make_aligned_header(std::size_t feature_count, std::size_t hidden_size, std::int32_t bias,
+                                  float scale) {
+    AlignedHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersionV3;
+    header.feature_count = static_cast<std::uint32_t>(feature_count);
+    header.hidden_size = static_cast<std::uint32_t>(hidden_size);
+    header.bias = bias;
+    header.scale = scale;
+    header.biases_offset = sizeof(AlignedHeader);
+    header.outputs_offset = align_up(header.biases_offset + hidden_size * sizeof(int32_t));
+    header.weights_offset = align_up(header.outputs_offset + hidden_size * sizeof(float));
+    header.file_size = header.weights_offset + feature_count * hidden_size * sizeof(int32_t);
+    return header;
+}
+
+// Checks an aligned header against the layout this build would write for the same shape.
+FeatureSet validate_aligned_header(const AlignedHeader& header, std::uint64_t available) {
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersionV3) {
+        throw std::runtime_error("Invalid aligned NNUE network: header mismatch");
+    }
+    FeatureSet features = FeatureSet::PieceSquare;
+    if (header.feature_count == kHalfKpFeatureCount) {
+        features = FeatureSet::HalfKP;
+    } else if (header.feature_count != kFeatureCount) {
+        throw std::runtime_error("Unexpected feature count in NNUE network file");
+    }
+    if (header.hidden_size == 0 || header.hidden_size > kMaxHiddenSize) {
+        throw std::runtime_error("Unsupported hidden size in NNUE network file: " +
+                                 std::to_string(header.hidden_size));
+    }
+    AlignedHeader expected = make_aligned_header(header.feature_count, header.hidden_size, 0, 0.0F);
+    if (header.biases_offset != expected.biases_offset || header.outputs_offset != expected.outputs_offset ||
+        header.weights_offset != expected.weights_offset || header.file_size != expected.file_size ||
+        available < header.file_size) {
+        throw std::runtime_error("Corrupt aligned NNUE network: section table does not match its size");
+    }
+    return features;
+}
 
 constexpr int kDefaultPieceValues[static_cast<int>(PieceType::King) + 1] = {
     100, 320, 330, 500, 900, 20000};
 
-std::size_t weight_offset(std::size_t feature, std::size_t neuron) {
-    return neuron * kFeatureCount + feature;
+// Feature-major layout: the weights of one feature are contiguous so an accumulator update
+// streams a single row. Files keep the historical neuron-major order and are transposed on I/O.
+std::size_t weight_offset(std::size_t feature, std::size_t neuron, std::size_t hidden_size) {
+    return feature * hidden_size + neuron;
 }
 
 }  // namespace
 
+const char* feature_set_name(FeatureSet set) {
+    return set == FeatureSet::HalfKP ? "halfkp" : "piece-square";
+}
+
+FeatureSet parse_feature_set(const std::string& name) {
+    if (name == "halfkp") {
+        return FeatureSet::HalfKP;
+    }
+    if (name == "piece-square") {
+        return FeatureSet::PieceSquare;
+    }
+    throw std::invalid_argument("Unknown NNUE feature set: " + name);
+}
+
 std::size_t feature_index(Color color, PieceType piece, int square) {
     if (piece == PieceType::None) {
         throw std::invalid_argument("feature_index called with PieceType::None");
@@ -36,17 +116,149 @@ std::size_t feature_index(Color color, PieceType piece, int square) {
     return color_offset + piece_offset + static_cast<std::size_t>(square);
 }
 
-Network::Network() = default;
+Network::Network() { bind_owned(); }
+
+Network::Network(const Network& other)
+    : loaded_(other.loaded_),
+      feature_set_(other.feature_set_),
+      hidden_size_(other.hidden_size_),
+      input_weights_(other.input_weights_),
+      hidden_biases_(other.hidden_biases_),
+      output_weights_(other.output_weights_),
+      mapping_(other.mapping_),
+      input_view_(other.input_view_),
+      bias_view_(other.bias_view_),
+      output_view_(other.output_view_),
+      bias_(other.bias_),
+      scale_(other.scale_) {
+    if (!mapping_) {
+        bind_owned();
+    }
+}
+
+Network::Network(Network&& other) noexcept
+    : loaded_(other.loaded_),
+      feature_set_(other.feature_set_),
+      hidden_size_(other.hidden_size_),
+      input_weights_(std::move(other.input_weights_)),
+      hidden_biases_(std::move(other.hidden_biases_)),
+      output_weights_(std::move(other.output_weights_)),
+      mapping_(std::move(other.mapping_)),
+      input_view_(other.input_view_),
+      bias_view_(other.bias_view_),
+      output_view_(other.output_view_),
+      bias_(other.bias_),
+      scale_(other.scale_) {
+    if (!mapping_) {
+        bind_owned();
+    }
+    other.bind_owned();
+}
+
+Network& Network::operator=(const Network& other) {
+    if (this != &other) {
+        Network copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+Network& Network::operator=(Network&& other) noexcept {
+    if (this != &other) {
+        loaded_ = other.loaded_;
+        feature_set_ = other.feature_set_;
+        hidden_size_ = other.hidden_size_;
+        input_weights_ = std::move(other.input_weights_);
+        hidden_biases_ = std::move(other.hidden_biases_);
+        output_weights_ = std::move(other.output_weights_);
+        mapping_ = std::move(other.mapping_);
+        input_view_ = other.input_view_;
+        bias_view_ = other.bias_view_;
+        output_view_ = other.output_view_;
+        bias_ = other.bias_;
+        scale_ = other.scale_;
+        if (!mapping_) {
+            bind_owned();
+        }
+        other.bind_owned();
+    }
+    return *this;
+}
+
+void Network::bind_owned() {
+    input_view_ = input_weights_.data();
+    bias_view_ = hidden_biases_.data();
+    output_view_ = output_weights_.data();
+}
+
+void Network::detach() {
+    input_weights_.assign(input_view_, input_view_ + hidden_size_ * feature_count());
+    hidden_biases_.assign(bias_view_, bias_view_ + hidden_size_);
+    output_weights_.assign(output_view_, output_view_ + hidden_size_);
+    mapping_.reset();
+    bind_owned();
+}
+
+bool Network::is_mappable(const MappedFile& file) {
+    if (file.size() < sizeof(AlignedHeader)) {
+        return false;
+    }
+    AlignedHeader header{};
+    std::memcpy(&header, file.data(), sizeof(header));
+    return std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 && header.version == kVersionV3;
+}
+
+void Network::map_from(std::shared_ptr<const MappedFile> file) {
+    if (!file || file->size() < sizeof(AlignedHeader)) {
+        throw std::runtime_error("Invalid aligned NNUE network: file too small");
+    }
+    AlignedHeader header{};
+    std::memcpy(&header, file->data(), sizeof(header));
+    FeatureSet features = validate_aligned_header(header, file->size());
+    if (reinterpret_cast<std::uintptr_t>(file->data()) % kSectionAlignment != 0) {
+        throw std::runtime_error("Aligned NNUE network mapping is not section aligned");
+    }
+
+    input_weights_.clear();
+    hidden_biases_.clear();
+    output_weights_.clear();
+    feature_set_ = features;
+    hidden_size_ = header.hidden_size;
+    bias_ = header.bias;
+    scale_ = header.scale;
+    const std::byte* base = file->data();
+    bias_view_ = reinterpret_cast<const int32_t*>(base + header.biases_offset);
+    output_view_ = reinterpret_cast<const float*>(base + header.outputs_offset);
+    input_view_ = reinterpret_cast<const int32_t*>(base + header.weights_offset);
+    mapping_ = std::move(file);
+    loaded_ = true;
+}
 
-void Network::ensure_storage(std::size_t hidden_size) {
+void Network::map_from_file(const std::string& path) {
+    auto file = MappedFile::open(path);
+    if (is_mappable(*file)) {
+        map_from(std::move(file));
+        return;
+    }
+    load_from_file(path);
+}
+
+void Network::ensure_storage(std::size_t hidden_size, FeatureSet features) {
+    if (hidden_size > kMaxHiddenSize) {
+        throw std::invalid_argument("NNUE hidden size " + std::to_string(hidden_size) + " exceeds the supported maximum of " +
+                                    std::to_string(kMaxHiddenSize));
+    }
+    feature_set_ = features;
     hidden_size_ = std::max<std::size_t>(1, hidden_size);
-    input_weights_.assign(hidden_size_ * kFeatureCount, 0);
+    mapping_.reset();
+    input_weights_.assign(hidden_size_ * feature_count(), 0);
     hidden_biases_.assign(hidden_size_, 0);
     output_weights_.assign(hidden_size_, 0.0F);
+    bind_owned();
 }
 
 void Network::set_hidden_size(std::size_t hidden_size) {
-    ensure_storage(hidden_size);
+    ensure_storage(hidden_size, feature_set_);
     loaded_ = true;
 }
 
@@ -73,7 +285,37 @@ void Network::load_from_file(const std::string& path) {
     if (!stream) {
         throw std::runtime_error("Failed to read NNUE feature count");
     }
-    if (feature_count != kFeatureCount) {
+    if (version == kVersionV3) {
+        AlignedHeader header{};
+        stream.seekg(0);
+        stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+        stream.seekg(0, std::ios::end);
+        std::uint64_t available = static_cast<std::uint64_t>(stream.tellg());
+        if (!stream) {
+            throw std::runtime_error("Failed to read aligned NNUE header");
+        }
+        FeatureSet aligned_features = validate_aligned_header(header, available);
+        ensure_storage(header.hidden_size, aligned_features);
+        auto read_section = [&](std::uint64_t offset, void* data, std::size_t bytes) {
+            stream.seekg(static_cast<std::streamoff>(offset));
+            stream.read(static_cast<char*>(data), static_cast<std::streamsize>(bytes));
+            if (!stream) {
+                throw std::runtime_error("Failed to read NNUE network sections from file: " + path);
+            }
+        };
+        read_section(header.biases_offset, hidden_biases_.data(), hidden_biases_.size() * sizeof(int32_t));
+        read_section(header.outputs_offset, output_weights_.data(), output_weights_.size() * sizeof(float));
+        read_section(header.weights_offset, input_weights_.data(), input_weights_.size() * sizeof(int32_t));
+        bias_ = header.bias;
+        scale_ = header.scale;
+        loaded_ = true;
+        return;
+    }
+
+    FeatureSet features = FeatureSet::PieceSquare;
+    if (feature_count == kHalfKpFeatureCount && version != kVersionV1) {
+        features = FeatureSet::HalfKP;
+    } else if (feature_count != kFeatureCount) {
         throw std::runtime_error("Unexpected feature count in NNUE network file");
     }
 
@@ -93,12 +335,13 @@ void Network::load_from_file(const std::string& path) {
             throw std::runtime_error("Failed to read NNUE weights from file: " + path);
         }
 
-        ensure_storage(1);
+        ensure_storage(1, FeatureSet::PieceSquare);
         for (std::size_t i = 0; i < buffer.size(); ++i) {
             input_weights_[i] = static_cast<int32_t>(buffer[i]);
         }
         hidden_biases_.assign(hidden_size_, 0);
         output_weights_.assign(hidden_size_, 1.0F);
+        bind_owned();
         bias_ = bias;
         scale_ = scale;
         loaded_ = true;
@@ -123,7 +366,7 @@ void Network::load_from_file(const std::string& path) {
         throw std::runtime_error("Failed to read NNUE network parameters");
     }
 
-    ensure_storage(hidden_size);
+    ensure_storage(hidden_size, features);
 
     std::vector<int16_t> bias_buffer(hidden_size_);
     stream.read(reinterpret_cast<char*>(bias_buffer.data()),
@@ -139,7 +382,7 @@ void Network::load_from_file(const std::string& path) {
         throw std::runtime_error("Failed to read NNUE output weights");
     }
 
-    std::vector<int16_t> weights_buffer(hidden_size_ * kFeatureCount);
+    std::vector<int16_t> weights_buffer(hidden_size_ * feature_count);
     stream.read(reinterpret_cast<char*>(weights_buffer.data()),
                 static_cast<std::streamsize>(weights_buffer.size() * sizeof(int16_t)));
     if (!stream) {
@@ -150,8 +393,11 @@ void Network::load_from_file(const std::string& path) {
         hidden_biases_[i] = static_cast<int32_t>(bias_buffer[i]);
         output_weights_[i] = output_buffer[i];
     }
-    for (std::size_t i = 0; i < weights_buffer.size(); ++i) {
-        input_weights_[i] = static_cast<int32_t>(weights_buffer[i]);
+    for (std::size_t neuron = 0; neuron < hidden_size_; ++neuron) {
+        for (std::size_t feature = 0; feature < feature_count; ++feature) {
+            input_weights_[weight_offset(feature, neuron, hidden_size_)] =
+                static_cast<int32_t>(weights_buffer[neuron * feature_count + feature]);
+        }
     }
 
     bias_ = bias;
@@ -159,12 +405,36 @@ void Network::load_from_file(const std::string& path) {
     loaded_ = true;
 }
 
-void Network::load_default(std::size_t hidden_size) {
-    ensure_storage(hidden_size);
+void Network::load_default(std::size_t hidden_size, FeatureSet features) {
+    ensure_storage(hidden_size, features);
     std::fill(hidden_biases_.begin(), hidden_biases_.end(), 0);
     float output = hidden_size_ > 0 ? 1.0F / static_cast<float>(hidden_size_) : 1.0F;
     std::fill(output_weights_.begin(), output_weights_.end(), output);
 
+    if (feature_set_ == FeatureSet::HalfKP) {
+        // Own pieces count +v/2 and enemy pieces -v/2 in each lane, so white - black is the
+        // material balance, exactly as in the piece-square default. Kings are not inputs.
+        for (int king = 0; king < kBoardSize; ++king) {
+            for (int color = 0; color < kNumColors; ++color) {
+                for (int piece = 0; piece < kNumPieceTypes - 1; ++piece) {
+                    int value = kDefaultPieceValues[piece] / 2;
+                    int sign = color == static_cast<int>(Color::White) ? 1 : -1;
+                    for (int square = 0; square < kBoardSize; ++square) {
+                        std::size_t feature = halfkp_index(Color::White, king, static_cast<Color>(color),
+                                                           static_cast<PieceType>(piece), square);
+                        for (std::size_t neuron = 0; neuron < hidden_size_; ++neuron) {
+                            input_weights_[weight_offset(feature, neuron, hidden_size_)] = sign * value;
+                        }
+                    }
+                }
+            }
+        }
+        bias_ = 0;
+        scale_ = 1.0F;
+        loaded_ = true;
+        return;
+    }
+
     for (std::size_t neuron = 0; neuron < hidden_size_; ++neuron) {
         for (int color = 0; color < kNumColors; ++color) {
             for (int piece = 0; piece < kNumPieceTypes; ++piece) {
@@ -172,7 +442,7 @@ void Network::load_default(std::size_t hidden_size) {
                 int value = kDefaultPieceValues[piece];
                 for (int square = 0; square < kBoardSize; ++square) {
                     std::size_t feature = feature_index(static_cast<Color>(color), type, square);
-                    input_weights_[weight_offset(feature, neuron)] = value;
+                    input_weights_[weight_offset(feature, neuron, hidden_size_)] = value;
                 }
             }
         }
@@ -189,36 +459,18 @@ void Network::save_to_file(const std::string& path) const {
         throw std::runtime_error("Failed to open NNUE network for writing: " + path);
     }
 
-    stream.write(kMagic, sizeof(kMagic));
-    std::uint32_t version = kVersionV2;
-    stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
-    std::uint32_t feature_count = static_cast<std::uint32_t>(kFeatureCount);
-    stream.write(reinterpret_cast<const char*>(&feature_count), sizeof(feature_count));
-    std::uint32_t hidden = static_cast<std::uint32_t>(hidden_size_);
-    stream.write(reinterpret_cast<const char*>(&hidden), sizeof(hidden));
-    stream.write(reinterpret_cast<const char*>(&bias_), sizeof(bias_));
-    stream.write(reinterpret_cast<const char*>(&scale_), sizeof(scale_));
-
-    std::vector<int16_t> bias_buffer(hidden_size_);
-    for (std::size_t i = 0; i < hidden_size_; ++i) {
-        int32_t value = hidden_biases_[i];
-        value = std::clamp(value, static_cast<int32_t>(-32768), static_cast<int32_t>(32767));
-        bias_buffer[i] = static_cast<int16_t>(value);
-    }
-    stream.write(reinterpret_cast<const char*>(bias_buffer.data()),
-                 static_cast<std::streamsize>(bias_buffer.size() * sizeof(int16_t)));
-
-    stream.write(reinterpret_cast<const char*>(output_weights_.data()),
-                 static_cast<std::streamsize>(output_weights_.size() * sizeof(float)));
-
-    std::vector<int16_t> weights_buffer(hidden_size_ * kFeatureCount);
-    for (std::size_t i = 0; i < weights_buffer.size(); ++i) {
-        int32_t value = input_weights_[i];
-        value = std::clamp(value, static_cast<int32_t>(-32768), static_cast<int32_t>(32767));
-        weights_buffer[i] = static_cast<int16_t>(value);
-    }
-    stream.write(reinterpret_cast<const char*>(weights_buffer.data()),
-                 static_cast<std::streamsize>(weights_buffer.size() * sizeof(int16_t)));
+    AlignedHeader header = make_aligned_header(feature_count(), hidden_size_, bias_, scale_);
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::uint64_t written = sizeof(header);
+    auto write_section = [&](std::uint64_t offset, const void* data, std::size_t bytes) {
+        static constexpr char kPadding[kSectionAlignment] = {};
+        stream.write(kPadding, static_cast<std::streamsize>(offset - written));
+        stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+        written = offset + bytes;
+    };
+    write_section(header.biases_offset, bias_view_, hidden_size_ * sizeof(int32_t));
+    write_section(header.outputs_offset, output_view_, hidden_size_ * sizeof(float));
+    write_section(header.weights_offset, input_view_, hidden_size_ * feature_count() * sizeof(int32_t));
 
     if (!stream) {
         throw std::runtime_error("Failed to write NNUE network file: " + path);
@@ -230,14 +482,18 @@ int32_t Network::input_weight(Color color, PieceType piece, int square, std::siz
         return 0;
     }
     std::size_t feature = feature_index(color, piece, square);
-    return input_weights_[weight_offset(feature, neuron)];
+    return input_view_[weight_offset(feature, neuron, hidden_size_)];
+}
+
+const int32_t* Network::feature_weights(std::size_t feature) const {
+    return input_view_ + weight_offset(feature, 0, hidden_size_);
 }
 
 int32_t Network::input_weight(std::size_t feature, std::size_t neuron) const {
-    if (neuron >= hidden_size_ || feature >= kFeatureCount) {
+    if (neuron >= hidden_size_ || feature >= feature_count()) {
         return 0;
     }
-    return input_weights_[weight_offset(feature, neuron)];
+    return input_view_[weight_offset(feature, neuron, hidden_size_)];
 }
 
 void Network::set_input_weight(Color color, PieceType piece, int square, int32_t value, std::size_t neuron) {
@@ -245,15 +501,17 @@ void Network::set_input_weight(Color color, PieceType piece, int square, int32_t
         return;
     }
     std::size_t feature = feature_index(color, piece, square);
-    input_weights_[weight_offset(feature, neuron)] = value;
+    make_writable();
+    input_weights_[weight_offset(feature, neuron, hidden_size_)] = value;
     loaded_ = true;
 }
 
 void Network::set_input_weight(std::size_t feature, std::size_t neuron, int32_t value) {
-    if (feature >= kFeatureCount || neuron >= hidden_size_) {
+    if (feature >= feature_count() || neuron >= hidden_size_) {
         return;
     }
-    input_weights_[weight_offset(feature, neuron)] = value;
+    make_writable();
+    input_weights_[weight_offset(feature, neuron, hidden_size_)] = value;
     loaded_ = true;
 }
 
@@ -262,15 +520,17 @@ void Network::add_input_weight(Color color, PieceType piece, int square, int32_t
         return;
     }
     std::size_t feature = feature_index(color, piece, square);
-    input_weights_[weight_offset(feature, neuron)] += delta;
+    make_writable();
+    input_weights_[weight_offset(feature, neuron, hidden_size_)] += delta;
     loaded_ = true;
 }
 
 void Network::add_input_weight(std::size_t feature, std::size_t neuron, int32_t delta) {
-    if (feature >= kFeatureCount || neuron >= hidden_size_) {
+    if (feature >= feature_count() || neuron >= hidden_size_) {
         return;
     }
-    input_weights_[weight_offset(feature, neuron)] += delta;
+    make_writable();
+    input_weights_[weight_offset(feature, neuron, hidden_size_)] += delta;
     loaded_ = true;
 }
 
@@ -278,13 +538,14 @@ int32_t Network::hidden_bias(std::size_t neuron) const {
     if (neuron >= hidden_size_) {
         return 0;
     }
-    return hidden_biases_[neuron];
+    return bias_view_[neuron];
 }
 
 void Network::set_hidden_bias(std::size_t neuron, int32_t value) {
     if (neuron >= hidden_size_) {
         return;
     }
+    make_writable();
     hidden_biases_[neuron] = value;
     loaded_ = true;
 }
@@ -293,13 +554,14 @@ float Network::output_weight(std::size_t neuron) const {
     if (neuron >= hidden_size_) {
         return 0.0F;
     }
-    return output_weights_[neuron];
+    return output_view_[neuron];
 }
 
 void Network::set_output_weight(std::size_t neuron, float value) {
     if (neuron >= hidden_size_) {
         return;
     }
+    make_writable();
     output_weights_[neuron] = value;
     loaded_ = true;
 }
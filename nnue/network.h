@@ -3,43 +3,119 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "nnue/mapped_file.h"
 #include "types.h"
 
 namespace chiron::nnue {
 
 constexpr std::size_t kFeatureCount = static_cast<std::size_t>(kNumColors) * static_cast<std::size_t>(kNumPieceTypes) *
                                        static_cast<std::size_t>(kBoardSize);
+/** King-relative inputs per perspective: king square x (own/their x non-king piece) x square. */
+constexpr std::size_t kHalfKpFeatureCount = static_cast<std::size_t>(kBoardSize) * 2 *
+                                            static_cast<std::size_t>(kNumPieceTypes - 1) *
+                                            static_cast<std::size_t>(kBoardSize);
 constexpr std::size_t kDefaultHiddenSize = 32;
+/** Largest hidden layer supported by the inline accumulator storage in the evaluator. */
+constexpr std::size_t kMaxHiddenSize = 512;
 constexpr double kActivationScale = 512.0;
 
+/**
+ * @brief Input encoding of a network.
+ *
+ * PieceSquare sums white pieces into the white lane and black pieces into the black lane.
+ * HalfKP gives each lane the point of view of that color's king: every non-king piece is
+ * keyed by the perspective's king square, with squares mirrored for black, so one set of
+ * weights serves both lanes.
+ */
+enum class FeatureSet : std::uint32_t {
+    PieceSquare = 0,
+    HalfKP = 1,
+};
+
+[[nodiscard]] constexpr std::size_t feature_count(FeatureSet set) {
+    return set == FeatureSet::HalfKP ? kHalfKpFeatureCount : kFeatureCount;
+}
+
+[[nodiscard]] const char* feature_set_name(FeatureSet set);
+
+/** @brief Parses "piece-square" or "halfkp"; throws std::invalid_argument otherwise. */
+[[nodiscard]] FeatureSet parse_feature_set(const std::string& name);
+
 /**
  * @brief Returns the index into the flattened feature array for a piece on a square.
  */
 std::size_t feature_index(Color color, PieceType piece, int square);
 
+/**
+ * @brief HalfKP index of a non-king piece seen from @p perspective with its king on @p king_square.
+ */
+[[nodiscard]] inline std::size_t halfkp_index(Color perspective, int king_square, Color color, PieceType piece,
+                                              int square) {
+    int flip = perspective == Color::White ? 0 : 56;
+    std::size_t relation = color == perspective ? 0 : 1;
+    std::size_t kind = relation * (kNumPieceTypes - 1) + static_cast<std::size_t>(piece);
+    return (static_cast<std::size_t>(king_square ^ flip) * 2 * (kNumPieceTypes - 1) + kind) * kBoardSize +
+           static_cast<std::size_t>(square ^ flip);
+}
+
 /**
  * @brief Represents a compact NNUE-style network with a single accumulator layer.
  *
- * The network stores weights for each (color, piece type, square) feature and a bias/scale
- * used to convert accumulated sums into centipawn evaluations.
+ * The network stores weights for each input feature (see FeatureSet) and a bias/scale
+ * used to convert accumulated sums into centipawn evaluations. Input weights are held
+ * feature-major (all hidden neurons of one feature are adjacent) for vectorized updates.
+ * Files record the feature count, which identifies the feature set on load.
+ *
+ * save_to_file() writes the aligned (version 3) layout, whose sections are stored exactly
+ * as they are used in memory. Such a file can be attached with map_from_file() without
+ * copying: the parameters then live in a read-only shared mapping, and the first mutation
+ * transparently copies them into owned storage.
  */
 class Network {
    public:
     Network();
+    Network(const Network& other);
+    Network(Network&& other) noexcept;
+    Network& operator=(const Network& other);
+    Network& operator=(Network&& other) noexcept;
 
     void load_from_file(const std::string& path);
-    void load_default(std::size_t hidden_size = kDefaultHiddenSize);
+
+    /**
+     * @brief Returns true if @p file holds the aligned layout that map_from() can attach.
+     */
+    static bool is_mappable(const MappedFile& file);
+
+    /**
+     * @brief Uses the parameters inside an aligned-layout mapping in place; throws
+     *        std::runtime_error if the file is not a valid aligned network.
+     */
+    void map_from(std::shared_ptr<const MappedFile> file);
+
+    /**
+     * @brief Maps @p path when it uses the aligned layout, otherwise falls back to load_from_file().
+     */
+    void map_from_file(const std::string& path);
+    [[nodiscard]] bool is_mapped() const { return mapping_ != nullptr; }
+
+    void load_default(std::size_t hidden_size = kDefaultHiddenSize, FeatureSet features = FeatureSet::PieceSquare);
     void save_to_file(const std::string& path) const;
 
     void set_hidden_size(std::size_t hidden_size);
     [[nodiscard]] std::size_t hidden_size() const { return hidden_size_; }
     [[nodiscard]] bool is_loaded() const { return loaded_; }
+    [[nodiscard]] FeatureSet feature_set() const { return feature_set_; }
+    [[nodiscard]] std::size_t feature_count() const { return nnue::feature_count(feature_set_); }
 
     [[nodiscard]] int32_t input_weight(Color color, PieceType piece, int square, std::size_t neuron = 0) const;
     [[nodiscard]] int32_t input_weight(std::size_t feature_index, std::size_t neuron) const;
+    /** @brief Contiguous row of hidden_size() weights for a feature; @p feature_index must be valid. */
+    [[nodiscard]] const int32_t* feature_weights(std::size_t feature_index) const;
     void set_input_weight(Color color, PieceType piece, int square, int32_t value, std::size_t neuron = 0);
     void set_input_weight(std::size_t feature_index, std::size_t neuron, int32_t value);
     void add_input_weight(Color color, PieceType piece, int square, int32_t delta, std::size_t neuron = 0);
@@ -56,21 +132,46 @@ class Network {
     [[nodiscard]] int32_t bias() const { return bias_; }
     [[nodiscard]] float scale() const { return scale_; }
 
-    std::vector<int32_t>& input_weights_data() { return input_weights_; }
-    const std::vector<int32_t>& input_weights_data() const { return input_weights_; }
-    std::vector<int32_t>& hidden_biases_data() { return hidden_biases_; }
-    const std::vector<int32_t>& hidden_biases_data() const { return hidden_biases_; }
-    std::vector<float>& output_weights_data() { return output_weights_; }
-    const std::vector<float>& output_weights_data() const { return output_weights_; }
+    /** @brief Mutable parameter storage; detaches a mapped network into owned memory first. */
+    std::vector<int32_t>& input_weights_data() {
+        make_writable();
+        return input_weights_;
+    }
+    std::vector<int32_t>& hidden_biases_data() {
+        make_writable();
+        return hidden_biases_;
+    }
+    std::vector<float>& output_weights_data() {
+        make_writable();
+        return output_weights_;
+    }
+    [[nodiscard]] std::span<const int32_t> input_weights_data() const {
+        return {input_view_, hidden_size_ * feature_count()};
+    }
+    [[nodiscard]] std::span<const int32_t> hidden_biases_data() const { return {bias_view_, hidden_size_}; }
+    [[nodiscard]] std::span<const float> output_weights_data() const { return {output_view_, hidden_size_}; }
 
    private:
-    void ensure_storage(std::size_t hidden_size);
+    void ensure_storage(std::size_t hidden_size, FeatureSet features);
+    void make_writable() {
+        if (mapping_) {
+            detach();
+        }
+    }
+    void detach();
+    void bind_owned();
 
     bool loaded_ = false;
+    FeatureSet feature_set_ = FeatureSet::PieceSquare;
     std::size_t hidden_size_ = kDefaultHiddenSize;
     std::vector<int32_t> input_weights_;
     std::vector<int32_t> hidden_biases_;
     std::vector<float> output_weights_;
+    // Views used by every read; they point either at the vectors above or into mapping_.
+    std::shared_ptr<const MappedFile> mapping_;
+    const int32_t* input_view_ = nullptr;
+    const int32_t* bias_view_ = nullptr;
+    const float* output_view_ = nullptr;
     int32_t bias_ = 0;
     float scale_ = 1.0f;
 };
@@ -0,0 +1,99 @@
+#include "nnue/network_cache.h"
+
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "nnue/mapped_file.h"
+
+namespace chiron::nnue {
+
+namespace {
+
+template <typename T>
+class SharedCache {
+   public:
+    template <typename Factory>
+    std::shared_ptr<const T> get_or_create(std::uint64_t key, Factory&& create) {
+        std::scoped_lock guard(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            if (auto existing = it->second.lock()) {
+                return existing;
+            }
+        }
+        std::shared_ptr<const T> created = create();
+        entries_[key] = created;
+        return created;
+    }
+
+   private:
+    std::mutex mutex_;
+    std::unordered_map<std::uint64_t, std::weak_ptr<const T>> entries_;
+};
+
+SharedCache<Network>& network_cache() {
+    static SharedCache<Network> cache;
+    return cache;
+}
+
+SharedCache<QuantizedNetwork>& quantized_cache() {
+    static SharedCache<QuantizedNetwork> cache;
+    return cache;
+}
+
+}  // namespace
+
+std::uint64_t content_hash(const std::byte* data, std::size_t size) {
+    // FNV-1a over 8-byte words with a final avalanche; fast enough to hash a network per load.
+    constexpr std::uint64_t kPrime = 0x100000001b3ULL;
+    std::uint64_t hash = 0xcbf29ce484222325ULL ^ size;
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * kPrime;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ static_cast<std::uint64_t>(data[i])) * kPrime;
+    }
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+std::shared_ptr<const Network> acquire_network(const std::string& path) {
+    auto file = MappedFile::open(path);
+    std::uint64_t key = content_hash(file->data(), file->size());
+    return network_cache().get_or_create(key, [&]() {
+        auto network = std::make_shared<Network>();
+        if (Network::is_mappable(*file)) {
+            network->map_from(file);
+        } else {
+            network->load_from_file(path);
+        }
+        return std::shared_ptr<const Network>(std::move(network));
+    });
+}
+
+std::shared_ptr<const QuantizedNetwork> acquire_quantized_network(const std::string& path) {
+    auto file = MappedFile::open(path);
+    std::uint64_t key = content_hash(file->data(), file->size());
+    return quantized_cache().get_or_create(key, [&]() {
+        auto network = std::make_shared<QuantizedNetwork>();
+        network->load_from_file(path);
+        return std::shared_ptr<const QuantizedNetwork>(std::move(network));
+    });
+}
+
+std::shared_ptr<const Network> default_network() {
+    static const std::shared_ptr<const Network> instance = [] {
+        auto network = std::make_shared<Network>();
+        network->load_default();
+        return std::shared_ptr<const Network>(std::move(network));
+    }();
+    return instance;
+}
+
+}  // namespace chiron::nnue
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "nnue/network.h"
+#include "nnue/quantized.h"
+
+namespace chiron::nnue {
+
+/**
+ * @brief 64-bit content hash used to recognise identical network files.
+ */
+[[nodiscard]] std::uint64_t content_hash(const std::byte* data, std::size_t size);
+
+/**
+ * @brief Returns the process-wide shared network for the file at @p path.
+ *
+ * The file is mapped read-only and identified by its content hash, so every evaluator that
+ * asks for the same bytes (through any path) receives the same immutable instance for as
+ * long as one of them holds it. Aligned (version 3) files are used in place from the
+ * mapping; older layouts are decoded once. A file rewritten on disk hashes differently and
+ * is loaded afresh. Throws std::runtime_error on unreadable or malformed files.
+ */
+[[nodiscard]] std::shared_ptr<const Network> acquire_network(const std::string& path);
+
+/**
+ * @brief Quantized (NNQ1) counterpart of acquire_network(); decoded once per distinct file.
+ */
+[[nodiscard]] std::shared_ptr<const QuantizedNetwork> acquire_quantized_network(const std::string& path);
+
+/**
+ * @brief Shared instance of the built-in default network.
+ */
+[[nodiscard]] std::shared_ptr<const Network> default_network();
+
+}  // namespace chiron::nnue
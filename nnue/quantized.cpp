@@ -0,0 +1,164 @@
+#include "nnue/quantized.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace chiron::nnue {
+
+namespace {
+
+constexpr char kQuantizedMagic[4] = {'N', 'N', 'Q', '1'};
+constexpr std::uint32_t kQuantizedVersion = 1U;
+
+// The tanh knee maps to at most 127 so activations fit the int8/uint8 range used by the
+// output layer; weights must additionally stay inside int16 after scaling.
+constexpr double kMaxClip = 127.0;
+constexpr double kMaxInputWeight = 32000.0;
+constexpr double kMaxOutputWeight = 127.0;
+
+template <typename T>
+void read_exact(std::ifstream& stream, T* data, std::size_t count, const char* what) {
+    stream.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+    if (!stream) {
+        throw std::runtime_error(std::string("Failed to read quantized NNUE ") + what);
+    }
+}
+
+template <typename T>
+void write_exact(std::ofstream& stream, const T* data, std::size_t count) {
+    stream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+}  // namespace
+
+QuantizedNetwork QuantizedNetwork::from_network(const Network& network) {
+    QuantizedNetwork quantized;
+    std::size_t hidden = network.hidden_size();
+    quantized.hidden_size_ = hidden;
+    quantized.feature_set_ = network.feature_set();
+    std::size_t features = network.feature_count();
+
+    int32_t max_weight = 0;
+    for (int32_t weight : network.input_weights_data()) {
+        max_weight = std::max(max_weight, std::abs(weight));
+    }
+    double input_scale = kMaxClip / kActivationScale;
+    if (max_weight > 0) {
+        input_scale = std::min(input_scale, kMaxInputWeight / static_cast<double>(max_weight));
+    }
+    quantized.clip_ = std::max<int32_t>(1, static_cast<int32_t>(std::lround(kActivationScale * input_scale)));
+
+    float max_output = 0.0F;
+    for (float weight : network.output_weights_data()) {
+        max_output = std::max(max_output, std::fabs(weight));
+    }
+    double output_scale = max_output > 0.0F ? kMaxOutputWeight / static_cast<double>(max_output) : 1.0;
+
+    quantized.input_weights_.resize(hidden * features);
+    for (std::size_t feature = 0; feature < features; ++feature) {
+        const int32_t* row = network.feature_weights(feature);
+        for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+            quantized.input_weights_[feature * hidden + neuron] =
+                static_cast<int16_t>(std::lround(static_cast<double>(row[neuron]) * input_scale));
+        }
+    }
+    quantized.hidden_biases_.resize(hidden);
+    quantized.output_weights_.resize(hidden);
+    for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+        quantized.hidden_biases_[neuron] =
+            static_cast<int32_t>(std::lround(static_cast<double>(network.hidden_bias(neuron)) * input_scale));
+        long rounded = std::lround(static_cast<double>(network.output_weight(neuron)) * output_scale);
+        quantized.output_weights_[neuron] = static_cast<int8_t>(std::clamp<long>(rounded, -127, 127));
+    }
+
+    quantized.bias_ = network.bias();
+    quantized.scale_ = network.scale();
+    quantized.output_dequant_ = static_cast<float>(1.0 / (input_scale * output_scale));
+    quantized.finalize();
+    return quantized;
+}
+
+bool QuantizedNetwork::is_quantized_file(const std::string& path) {
+    std::ifstream stream(path, std::ios::binary);
+    char magic[4] = {};
+    stream.read(magic, sizeof(magic));
+    return stream && std::memcmp(magic, kQuantizedMagic, sizeof(kQuantizedMagic)) == 0;
+}
+
+void QuantizedNetwork::load_from_file(const std::string& path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("Failed to open quantized NNUE file: " + path);
+    }
+
+    char magic[4];
+    read_exact(stream, magic, sizeof(magic), "magic");
+    if (std::memcmp(magic, kQuantizedMagic, sizeof(kQuantizedMagic)) != 0) {
+        throw std::runtime_error("Invalid quantized NNUE file: magic mismatch");
+    }
+
+    std::uint32_t header[3] = {};
+    read_exact(stream, header, 3, "header");
+    if (header[0] != kQuantizedVersion) {
+        throw std::runtime_error("Unsupported quantized NNUE version: " + std::to_string(header[0]));
+    }
+    if (header[1] == kHalfKpFeatureCount) {
+        feature_set_ = FeatureSet::HalfKP;
+    } else if (header[1] == kFeatureCount) {
+        feature_set_ = FeatureSet::PieceSquare;
+    } else {
+        throw std::runtime_error("Unexpected feature count in quantized NNUE file");
+    }
+    if (header[2] == 0 || header[2] > kMaxHiddenSize) {
+        throw std::runtime_error("Unsupported hidden size in quantized NNUE file: " + std::to_string(header[2]));
+    }
+    hidden_size_ = header[2];
+
+    read_exact(stream, &bias_, 1, "bias");
+    read_exact(stream, &scale_, 1, "scale");
+    read_exact(stream, &output_dequant_, 1, "output scale");
+    read_exact(stream, &clip_, 1, "clip");
+
+    hidden_biases_.resize(hidden_size_);
+    output_weights_.resize(hidden_size_);
+    input_weights_.resize(hidden_size_ * feature_count(feature_set_));
+    read_exact(stream, hidden_biases_.data(), hidden_biases_.size(), "hidden biases");
+    read_exact(stream, output_weights_.data(), output_weights_.size(), "output weights");
+    read_exact(stream, input_weights_.data(), input_weights_.size(), "input weights");
+    finalize();
+}
+
+void QuantizedNetwork::save_to_file(const std::string& path) const {
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        throw std::runtime_error("Failed to open quantized NNUE file for writing: " + path);
+    }
+    write_exact(stream, kQuantizedMagic, sizeof(kQuantizedMagic));
+    std::uint32_t header[3] = {kQuantizedVersion, static_cast<std::uint32_t>(feature_count(feature_set_)),
+                               static_cast<std::uint32_t>(hidden_size_)};
+    write_exact(stream, header, 3);
+    write_exact(stream, &bias_, 1);
+    write_exact(stream, &scale_, 1);
+    write_exact(stream, &output_dequant_, 1);
+    write_exact(stream, &clip_, 1);
+    write_exact(stream, hidden_biases_.data(), hidden_biases_.size());
+    write_exact(stream, output_weights_.data(), output_weights_.size());
+    write_exact(stream, input_weights_.data(), input_weights_.size());
+    if (!stream) {
+        throw std::runtime_error("Failed to write quantized NNUE file: " + path);
+    }
+}
+
+void QuantizedNetwork::finalize() {
+    output_weight_sum_ = 0;
+    for (int8_t weight : output_weights_) {
+        output_weight_sum_ += weight;
+    }
+    loaded_ = true;
+}
+
+}  // namespace chiron::nnue
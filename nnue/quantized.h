@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nnue/network.h"
+
+namespace chiron::nnue {
+
+/**
+ * @brief Integer inference form of a Network: int16 input weights and an int8 output layer.
+ *
+ * The tanh hidden activation of the float network is replaced by its clipped-linear
+ * counterpart, evaluated as a shifted clipped ReLU: with the input scale s chosen so that
+ * the tanh knee (kActivationScale) maps to clip(), each neuron contributes
+ * clamp(pre + clip, 0, 2 * clip) - clip. Accumulators stay int32 so that no realistic piece
+ * configuration can overflow, while weight rows are half the width of the float network.
+ */
+class QuantizedNetwork {
+   public:
+    /**
+     * @brief Quantizes a float network.
+     */
+    static QuantizedNetwork from_network(const Network& network);
+
+    /**
+     * @brief Returns true when @p path starts with the quantized file magic.
+     */
+    static bool is_quantized_file(const std::string& path);
+
+    void load_from_file(const std::string& path);
+    void save_to_file(const std::string& path) const;
+
+    [[nodiscard]] bool is_loaded() const { return loaded_; }
+    [[nodiscard]] std::size_t hidden_size() const { return hidden_size_; }
+    [[nodiscard]] FeatureSet feature_set() const { return feature_set_; }
+    [[nodiscard]] int32_t clip() const { return clip_; }
+    [[nodiscard]] int32_t bias() const { return bias_; }
+    [[nodiscard]] float scale() const { return scale_; }
+    [[nodiscard]] float output_dequant() const { return output_dequant_; }
+    [[nodiscard]] int32_t output_weight_sum() const { return output_weight_sum_; }
+
+    /** @brief Contiguous row of hidden_size() weights for a feature. */
+    [[nodiscard]] const int16_t* feature_weights(std::size_t feature_index) const {
+        return input_weights_.data() + feature_index * hidden_size_;
+    }
+    [[nodiscard]] const std::vector<int32_t>& hidden_biases() const { return hidden_biases_; }
+    [[nodiscard]] const std::vector<int8_t>& output_weights() const { return output_weights_; }
+
+   private:
+    void finalize();
+
+    bool loaded_ = false;
+    std::size_t hidden_size_ = 0;
+    FeatureSet feature_set_ = FeatureSet::PieceSquare;
+    std::vector<int16_t> input_weights_;
+    std::vector<int32_t> hidden_biases_;
+    std::vector<int8_t> output_weights_;
+    int32_t clip_ = 127;
+    int32_t bias_ = 0;
+    float scale_ = 1.0F;
+    float output_dequant_ = 1.0F;
+    int32_t output_weight_sum_ = 0;
+};
+
+}  // namespace chiron::nnue
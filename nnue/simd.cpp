@@ -0,0 +1,365 @@
+#include "nnue/simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if !defined(CHIRON_DISABLE_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define CHIRON_SIMD_AVX2 1
+#elif !defined(CHIRON_DISABLE_SIMD) && defined(__SSE4_1__)
+#include <smmintrin.h>
+#define CHIRON_SIMD_SSE41 1
+#elif !defined(CHIRON_DISABLE_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define CHIRON_SIMD_NEON 1
+#endif
+
+namespace chiron::nnue::simd {
+
+namespace {
+
+// tanh saturates to 1 within float precision well before this point, and the rational
+// approximation below is monotonic on [-kTanhClamp, kTanhClamp].
+constexpr float kTanhClamp = 4.97F;
+
+constexpr float kP0 = 135135.0F;
+constexpr float kP1 = 17325.0F;
+constexpr float kP2 = 378.0F;
+constexpr float kQ1 = 62370.0F;
+constexpr float kQ2 = 3150.0F;
+constexpr float kQ3 = 28.0F;
+
+#if defined(CHIRON_SIMD_AVX2)
+__m256 tanh_vec(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-kTanhClamp)), _mm256_set1_ps(kTanhClamp));
+    __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 num = _mm256_add_ps(_mm256_set1_ps(kP2), x2);
+    num = _mm256_add_ps(_mm256_set1_ps(kP1), _mm256_mul_ps(x2, num));
+    num = _mm256_add_ps(_mm256_set1_ps(kP0), _mm256_mul_ps(x2, num));
+    num = _mm256_mul_ps(x, num);
+    __m256 den = _mm256_add_ps(_mm256_set1_ps(kQ2), _mm256_mul_ps(x2, _mm256_set1_ps(kQ3)));
+    den = _mm256_add_ps(_mm256_set1_ps(kQ1), _mm256_mul_ps(x2, den));
+    den = _mm256_add_ps(_mm256_set1_ps(kP0), _mm256_mul_ps(x2, den));
+    return _mm256_div_ps(num, den);
+}
+#elif defined(CHIRON_SIMD_SSE41)
+__m128 tanh_vec(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-kTanhClamp)), _mm_set1_ps(kTanhClamp));
+    __m128 x2 = _mm_mul_ps(x, x);
+    __m128 num = _mm_add_ps(_mm_set1_ps(kP2), x2);
+    num = _mm_add_ps(_mm_set1_ps(kP1), _mm_mul_ps(x2, num));
+    num = _mm_add_ps(_mm_set1_ps(kP0), _mm_mul_ps(x2, num));
+    num = _mm_mul_ps(x, num);
+    __m128 den = _mm_add_ps(_mm_set1_ps(kQ2), _mm_mul_ps(x2, _mm_set1_ps(kQ3)));
+    den = _mm_add_ps(_mm_set1_ps(kQ1), _mm_mul_ps(x2, den));
+    den = _mm_add_ps(_mm_set1_ps(kP0), _mm_mul_ps(x2, den));
+    return _mm_div_ps(num, den);
+}
+#elif defined(CHIRON_SIMD_NEON)
+float32x4_t tanh_vec(float32x4_t x) {
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-kTanhClamp)), vdupq_n_f32(kTanhClamp));
+    float32x4_t x2 = vmulq_f32(x, x);
+    float32x4_t num = vaddq_f32(vdupq_n_f32(kP2), x2);
+    num = vmlaq_f32(vdupq_n_f32(kP1), x2, num);
+    num = vmlaq_f32(vdupq_n_f32(kP0), x2, num);
+    num = vmulq_f32(x, num);
+    float32x4_t den = vmlaq_f32(vdupq_n_f32(kQ2), x2, vdupq_n_f32(kQ3));
+    den = vmlaq_f32(vdupq_n_f32(kQ1), x2, den);
+    den = vmlaq_f32(vdupq_n_f32(kP0), x2, den);
+    return vdivq_f32(num, den);
+}
+#endif
+
+#if defined(CHIRON_SIMD_AVX2)
+constexpr std::size_t kLanes = 8;
+using Lane = __m256i;
+inline Lane load_lane(const std::int32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline Lane load_lane(const std::int16_t* p) {
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+}
+inline void store_lane(std::int32_t* p, Lane v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+inline Lane add_lane(Lane a, Lane b) { return _mm256_add_epi32(a, b); }
+inline Lane sub_lane(Lane a, Lane b) { return _mm256_sub_epi32(a, b); }
+#elif defined(CHIRON_SIMD_SSE41)
+constexpr std::size_t kLanes = 4;
+using Lane = __m128i;
+inline Lane load_lane(const std::int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline Lane load_lane(const std::int16_t* p) {
+    return _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+}
+inline void store_lane(std::int32_t* p, Lane v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+inline Lane add_lane(Lane a, Lane b) { return _mm_add_epi32(a, b); }
+inline Lane sub_lane(Lane a, Lane b) { return _mm_sub_epi32(a, b); }
+#elif defined(CHIRON_SIMD_NEON)
+constexpr std::size_t kLanes = 4;
+using Lane = int32x4_t;
+inline Lane load_lane(const std::int32_t* p) { return vld1q_s32(p); }
+inline Lane load_lane(const std::int16_t* p) { return vmovl_s16(vld1_s16(p)); }
+inline void store_lane(std::int32_t* p, Lane v) { vst1q_s32(p, v); }
+inline Lane add_lane(Lane a, Lane b) { return vaddq_s32(a, b); }
+inline Lane sub_lane(Lane a, Lane b) { return vsubq_s32(a, b); }
+#endif
+
+template <typename Row>
+void apply_rows_impl(std::int32_t* dst, const std::int32_t* src, const Row* const* added, std::size_t added_count,
+                     const Row* const* removed, std::size_t removed_count, std::size_t count) {
+    std::size_t i = 0;
+#if defined(CHIRON_SIMD_AVX2) || defined(CHIRON_SIMD_SSE41) || defined(CHIRON_SIMD_NEON)
+    for (; i + kLanes <= count; i += kLanes) {
+        Lane value = load_lane(src + i);
+        for (std::size_t r = 0; r < added_count; ++r) {
+            value = add_lane(value, load_lane(added[r] + i));
+        }
+        for (std::size_t r = 0; r < removed_count; ++r) {
+            value = sub_lane(value, load_lane(removed[r] + i));
+        }
+        store_lane(dst + i, value);
+    }
+#endif
+    for (; i < count; ++i) {
+        std::int32_t value = src[i];
+        for (std::size_t r = 0; r < added_count; ++r) {
+            value += added[r][i];
+        }
+        for (std::size_t r = 0; r < removed_count; ++r) {
+            value -= removed[r][i];
+        }
+        dst[i] = value;
+    }
+}
+
+}  // namespace
+
+const char* kernel_name() {
+#if defined(CHIRON_SIMD_AVX2)
+    return "avx2";
+#elif defined(CHIRON_SIMD_SSE41)
+    return "sse4.1";
+#elif defined(CHIRON_SIMD_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+float fast_tanh(float x) {
+    x = std::clamp(x, -kTanhClamp, kTanhClamp);
+    float x2 = x * x;
+    float num = x * (kP0 + x2 * (kP1 + x2 * (kP2 + x2)));
+    float den = kP0 + x2 * (kQ1 + x2 * (kQ2 + x2 * kQ3));
+    return num / den;
+}
+
+void add_row(std::int32_t* acc, const std::int32_t* row, std::size_t count) {
+    std::size_t i = 0;
+#if defined(CHIRON_SIMD_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi32(a, w));
+    }
+#elif defined(CHIRON_SIMD_SSE41)
+    for (; i + 4 <= count; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_add_epi32(a, w));
+    }
+#elif defined(CHIRON_SIMD_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_s32(acc + i, vaddq_s32(vld1q_s32(acc + i), vld1q_s32(row + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        acc[i] += row[i];
+    }
+}
+
+void sub_row(std::int32_t* acc, const std::int32_t* row, std::size_t count) {
+    std::size_t i = 0;
+#if defined(CHIRON_SIMD_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_sub_epi32(a, w));
+    }
+#elif defined(CHIRON_SIMD_SSE41)
+    for (; i + 4 <= count; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_sub_epi32(a, w));
+    }
+#elif defined(CHIRON_SIMD_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_s32(acc + i, vsubq_s32(vld1q_s32(acc + i), vld1q_s32(row + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        acc[i] -= row[i];
+    }
+}
+
+void add_row(std::int32_t* acc, const std::int16_t* row, std::size_t count) {
+    std::size_t i = 0;
+#if defined(CHIRON_SIMD_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i w = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_add_epi32(a, w));
+    }
+#elif defined(CHIRON_SIMD_SSE41)
+    for (; i + 4 <= count; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i w = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_add_epi32(a, w));
+    }
+#elif defined(CHIRON_SIMD_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_s32(acc + i, vaddw_s16(vld1q_s32(acc + i), vld1_s16(row + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        acc[i] += row[i];
+    }
+}
+
+void sub_row(std::int32_t* acc, const std::int16_t* row, std::size_t count) {
+    std::size_t i = 0;
+#if defined(CHIRON_SIMD_AVX2)
+    for (; i + 8 <= count; i += 8) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+        __m256i w = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), _mm256_sub_epi32(a, w));
+    }
+#elif defined(CHIRON_SIMD_SSE41)
+    for (; i + 4 <= count; i += 4) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i));
+        __m128i w = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i), _mm_sub_epi32(a, w));
+    }
+#elif defined(CHIRON_SIMD_NEON)
+    for (; i + 4 <= count; i += 4) {
+        vst1q_s32(acc + i, vsubw_s16(vld1q_s32(acc + i), vld1_s16(row + i)));
+    }
+#endif
+    for (; i < count; ++i) {
+        acc[i] -= row[i];
+    }
+}
+
+void apply_rows(std::int32_t* dst, const std::int32_t* src, const std::int32_t* const* added, std::size_t added_count,
+                const std::int32_t* const* removed, std::size_t removed_count, std::size_t count) {
+    apply_rows_impl(dst, src, added, added_count, removed, removed_count, count);
+}
+
+void apply_rows(std::int32_t* dst, const std::int32_t* src, const std::int16_t* const* added, std::size_t added_count,
+                const std::int16_t* const* removed, std::size_t removed_count, std::size_t count) {
+    apply_rows_impl(dst, src, added, added_count, removed, removed_count, count);
+}
+
+float activate_and_dot(const std::int32_t* white, const std::int32_t* black, const std::int32_t* biases,
+                       const float* output_weights, std::size_t count, float scale) {
+    const float inv_scale = 1.0F / scale;
+    float sum = 0.0F;
+    std::size_t i = 0;
+#if defined(CHIRON_SIMD_AVX2)
+    __m256 total = _mm256_setzero_ps();
+    for (; i + 8 <= count; i += 8) {
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(white + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(black + i));
+        __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(biases + i));
+        __m256i pre = _mm256_add_epi32(_mm256_sub_epi32(w, b), h);
+        __m256 x = _mm256_mul_ps(_mm256_cvtepi32_ps(pre), _mm256_set1_ps(inv_scale));
+        total = _mm256_add_ps(total, _mm256_mul_ps(tanh_vec(x), _mm256_loadu_ps(output_weights + i)));
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(total), _mm256_extractf128_ps(total, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 0x1));
+    sum = _mm_cvtss_f32(half);
+#elif defined(CHIRON_SIMD_SSE41)
+    __m128 total = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(white + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(black + i));
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(biases + i));
+        __m128i pre = _mm_add_epi32(_mm_sub_epi32(w, b), h);
+        __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(pre), _mm_set1_ps(inv_scale));
+        total = _mm_add_ps(total, _mm_mul_ps(tanh_vec(x), _mm_loadu_ps(output_weights + i)));
+    }
+    total = _mm_add_ps(total, _mm_movehl_ps(total, total));
+    total = _mm_add_ss(total, _mm_shuffle_ps(total, total, 0x1));
+    sum = _mm_cvtss_f32(total);
+#elif defined(CHIRON_SIMD_NEON)
+    float32x4_t total = vdupq_n_f32(0.0F);
+    for (; i + 4 <= count; i += 4) {
+        int32x4_t pre = vaddq_s32(vsubq_s32(vld1q_s32(white + i), vld1q_s32(black + i)), vld1q_s32(biases + i));
+        float32x4_t x = vmulq_n_f32(vcvtq_f32_s32(pre), inv_scale);
+        total = vmlaq_f32(total, tanh_vec(x), vld1q_f32(output_weights + i));
+    }
+    sum = vaddvq_f32(total);
+#endif
+    for (; i < count; ++i) {
+        float x = static_cast<float>(white[i] - black[i] + biases[i]) * inv_scale;
+        sum += fast_tanh(x) * output_weights[i];
+    }
+    return sum * scale;
+}
+
+std::int32_t crelu_dot(const std::int32_t* white, const std::int32_t* black, const std::int32_t* biases,
+                       const std::int8_t* output_weights, std::size_t count, std::int32_t clip) {
+    std::int32_t sum = 0;
+    std::size_t i = 0;
+#if defined(CHIRON_SIMD_AVX2)
+    const __m256i shift = _mm256_set1_epi32(clip);
+    const __m256i ceiling = _mm256_set1_epi32(2 * clip);
+    __m256i total = _mm256_setzero_si256();
+    for (; i + 8 <= count; i += 8) {
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(white + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(black + i));
+        __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(biases + i));
+        __m256i pre = _mm256_add_epi32(_mm256_add_epi32(_mm256_sub_epi32(w, b), h), shift);
+        __m256i act = _mm256_min_epi32(_mm256_max_epi32(pre, _mm256_setzero_si256()), ceiling);
+        __m256i out = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(output_weights + i)));
+        total = _mm256_add_epi32(total, _mm256_mullo_epi32(act, out));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    sum = _mm_cvtsi128_si32(half);
+#elif defined(CHIRON_SIMD_SSE41)
+    const __m128i shift = _mm_set1_epi32(clip);
+    const __m128i ceiling = _mm_set1_epi32(2 * clip);
+    __m128i total = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(white + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(black + i));
+        __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(biases + i));
+        __m128i pre = _mm_add_epi32(_mm_add_epi32(_mm_sub_epi32(w, b), h), shift);
+        __m128i act = _mm_min_epi32(_mm_max_epi32(pre, _mm_setzero_si128()), ceiling);
+        std::int32_t packed = 0;
+        std::memcpy(&packed, output_weights + i, sizeof(packed));
+        __m128i out = _mm_cvtepi8_epi32(_mm_cvtsi32_si128(packed));
+        total = _mm_add_epi32(total, _mm_mullo_epi32(act, out));
+    }
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4E));
+    total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xB1));
+    sum = _mm_cvtsi128_si32(total);
+#elif defined(CHIRON_SIMD_NEON)
+    const int32x4_t shift = vdupq_n_s32(clip);
+    const int32x4_t ceiling = vdupq_n_s32(2 * clip);
+    int32x4_t total = vdupq_n_s32(0);
+    for (; i + 4 <= count; i += 4) {
+        int32x4_t pre = vaddq_s32(vsubq_s32(vld1q_s32(white + i), vld1q_s32(black + i)), vld1q_s32(biases + i));
+        int32x4_t act = vminq_s32(vmaxq_s32(vaddq_s32(pre, shift), vdupq_n_s32(0)), ceiling);
+        int32x4_t out = {output_weights[i], output_weights[i + 1], output_weights[i + 2], output_weights[i + 3]};
+        total = vmlaq_s32(total, act, out);
+    }
+    sum = vaddvq_s32(total);
+#endif
+    for (; i < count; ++i) {
+        std::int32_t act = std::clamp(white[i] - black[i] + biases[i] + clip, 0, 2 * clip);
+        sum += act * output_weights[i];
+    }
+    return sum;
+}
+
+}  // namespace chiron::nnue::simd
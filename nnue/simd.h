@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace chiron::nnue::simd {
+
+/**
+ * @brief Name of the kernel set selected at build time ("avx2", "sse4.1", "neon" or "scalar").
+ */
+[[nodiscard]] const char* kernel_name();
+
+/**
+ * @brief Adds a feature-major weight row to an accumulator: acc[i] += row[i].
+ */
+void add_row(std::int32_t* acc, const std::int32_t* row, std::size_t count);
+
+/**
+ * @brief Subtracts a feature-major weight row from an accumulator: acc[i] -= row[i].
+ */
+void sub_row(std::int32_t* acc, const std::int32_t* row, std::size_t count);
+
+/**
+ * @brief int16 row overloads used by the quantized network; the accumulator stays int32.
+ */
+void add_row(std::int32_t* acc, const std::int16_t* row, std::size_t count);
+void sub_row(std::int32_t* acc, const std::int16_t* row, std::size_t count);
+
+/**
+ * @brief Single-pass multi-row update: dst = src + sum(added rows) - sum(removed rows).
+ *
+ * Lets the evaluator fold the pending feature changes of several plies into one sweep over
+ * the accumulator lanes. @p dst may alias @p src.
+ */
+void apply_rows(std::int32_t* dst, const std::int32_t* src, const std::int32_t* const* added, std::size_t added_count,
+                const std::int32_t* const* removed, std::size_t removed_count, std::size_t count);
+void apply_rows(std::int32_t* dst, const std::int32_t* src, const std::int16_t* const* added, std::size_t added_count,
+                const std::int16_t* const* removed, std::size_t removed_count, std::size_t count);
+
+/**
+ * @brief Rational (Padé 7/6) approximation of tanh, accurate to about 1e-4 on the whole line.
+ */
+[[nodiscard]] float fast_tanh(float x);
+
+/**
+ * @brief Hidden layer activation fused with the output dot product.
+ *
+ * Returns sum_i tanh((white[i] - black[i] + biases[i]) / scale) * scale * output_weights[i]
+ * using fast_tanh, which is the whole network body after the accumulator.
+ */
+[[nodiscard]] float activate_and_dot(const std::int32_t* white, const std::int32_t* black, const std::int32_t* biases,
+                                     const float* output_weights, std::size_t count, float scale);
+
+/**
+ * @brief Shifted clipped ReLU fused with the int8 output layer.
+ *
+ * Returns sum_i clamp(white[i] - black[i] + biases[i] + clip, 0, 2 * clip) * output_weights[i].
+ */
+[[nodiscard]] std::int32_t crelu_dot(const std::int32_t* white, const std::int32_t* black, const std::int32_t* biases,
+                                     const std::int8_t* output_weights, std::size_t count, std::int32_t clip);
+
+}  // namespace chiron::nnue::simd
@@ -0,0 +1,297 @@
+#include "allocation.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#include <filesystem>
+#include <fstream>
+#endif
+
+namespace chiron {
+
+namespace {
+
+constexpr std::size_t kHugePageSize = 2ULL * 1024ULL * 1024ULL;
+
+std::size_t round_up(std::size_t value, std::size_t multiple) { return (value + multiple - 1) / multiple * multiple; }
+
+#ifdef __linux__
+
+struct NumaNode {
+    int id = 0;
+    std::vector<int> cpus;
+};
+
+/** @brief Parses a sysfs CPU list such as "0-15,32-47". */
+std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        std::size_t end = text.find(',', pos);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        std::string range = text.substr(pos, end - pos);
+        std::size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            // Blank lines and malformed ranges contribute nothing.
+        }
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+/** @brief The NUMA nodes that have CPUs, read once from sysfs. */
+const std::vector<NumaNode>& numa_nodes() {
+    static const std::vector<NumaNode> nodes = [] {
+        std::vector<NumaNode> result;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+            std::string name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+                name.find_first_not_of("0123456789", 4) != std::string::npos) {
+                continue;
+            }
+            std::ifstream list(entry.path() / "cpulist");
+            std::string text;
+            std::getline(list, text);
+            NumaNode node{std::stoi(name.substr(4)), parse_cpu_list(text)};
+            if (!node.cpus.empty()) {
+                result.push_back(std::move(node));
+            }
+        }
+        return result;
+    }();
+    return nodes;
+}
+
+/** @brief Asks the kernel to place the pages of a fresh mapping round-robin across the nodes. */
+void interleave_pages(void* data, std::size_t bytes) {
+#ifdef SYS_mbind
+    const std::vector<NumaNode>& nodes = numa_nodes();
+    if (nodes.size() < 2) {
+        return;
+    }
+    constexpr int kInterleavePolicy = 3;  // MPOL_INTERLEAVE, without needing libnuma's headers.
+    constexpr std::size_t kBitsPerWord = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask;
+    for (const NumaNode& node : nodes) {
+        std::size_t word = static_cast<std::size_t>(node.id) / kBitsPerWord;
+        if (mask.size() <= word) {
+            mask.resize(word + 1, 0UL);
+        }
+        mask[word] |= 1UL << (static_cast<std::size_t>(node.id) % kBitsPerWord);
+    }
+    // Best effort: without the policy the pages simply follow first touch.
+    (void)syscall(SYS_mbind, data, bytes, kInterleavePolicy, mask.data(), mask.size() * kBitsPerWord + 1, 0U);
+#else
+    (void)data;
+    (void)bytes;
+#endif
+}
+
+#endif  // __linux__
+
+#ifdef _WIN32
+
+bool enable_lock_memory_privilege() {
+    HANDLE token = nullptr;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+        return false;
+    }
+    TOKEN_PRIVILEGES privileges{};
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+    bool enabled = LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+                   AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr) &&
+                   GetLastError() == ERROR_SUCCESS;
+    CloseHandle(token);
+    return enabled;
+}
+
+/** @brief The NUMA nodes that have processors, with their processor masks. */
+const std::vector<GROUP_AFFINITY>& numa_affinities() {
+    static const std::vector<GROUP_AFFINITY> affinities = [] {
+        std::vector<GROUP_AFFINITY> result;
+        ULONG highest = 0;
+        if (!GetNumaHighestNodeNumber(&highest)) {
+            return result;
+        }
+        for (ULONG node = 0; node <= highest; ++node) {
+            GROUP_AFFINITY affinity{};
+            if (GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity) && affinity.Mask != 0) {
+                result.push_back(affinity);
+            }
+        }
+        return result;
+    }();
+    return affinities;
+}
+
+#endif  // _WIN32
+
+}  // namespace
+
+LargePageBuffer::LargePageBuffer(std::size_t bytes) : size_(bytes) {
+    if (bytes == 0) {
+        return;
+    }
+#ifdef _WIN32
+    SIZE_T large_page = GetLargePageMinimum();
+    if (large_page != 0 && bytes >= large_page && enable_lock_memory_privilege()) {
+        std::size_t rounded = round_up(bytes, large_page);
+        data_ = VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        if (data_ != nullptr) {
+            mapped_ = rounded;
+            large_pages_ = true;
+        }
+    }
+    if (data_ == nullptr) {
+        data_ = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (data_ == nullptr) {
+            throw std::bad_alloc();
+        }
+        mapped_ = bytes;
+    }
+#else
+#ifdef MAP_HUGETLB
+    if (bytes >= kHugePageSize) {
+        std::size_t rounded = round_up(bytes, kHugePageSize);
+        void* pages = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (pages != MAP_FAILED) {
+            data_ = pages;
+            mapped_ = rounded;
+            large_pages_ = true;
+        }
+    }
+#endif
+    if (data_ == nullptr) {
+        // Over-map and trim so transparent huge pages can back the whole table.
+        std::size_t alignment =
+            bytes >= kHugePageSize ? kHugePageSize : static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        std::size_t rounded = round_up(bytes, alignment);
+        std::size_t span = alignment == kHugePageSize ? rounded + alignment : rounded;
+        void* pages = mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pages == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        auto start = reinterpret_cast<std::uintptr_t>(pages);
+        std::uintptr_t aligned = round_up(start, alignment);
+        std::size_t head = aligned - start;
+        std::size_t tail = span - head - rounded;
+        if (head > 0) {
+            munmap(pages, head);
+        }
+        if (tail > 0) {
+            munmap(reinterpret_cast<void*>(aligned + rounded), tail);
+        }
+        data_ = reinterpret_cast<void*>(aligned);
+        mapped_ = rounded;
+#ifdef MADV_HUGEPAGE
+        if (alignment == kHugePageSize) {
+            madvise(data_, mapped_, MADV_HUGEPAGE);
+        }
+#endif
+    }
+#ifdef __linux__
+    interleave_pages(data_, mapped_);
+#endif
+#endif
+}
+
+LargePageBuffer::~LargePageBuffer() { release(); }
+
+LargePageBuffer::LargePageBuffer(LargePageBuffer&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      mapped_(std::exchange(other.mapped_, 0)),
+      large_pages_(std::exchange(other.large_pages_, false)) {}
+
+LargePageBuffer& LargePageBuffer::operator=(LargePageBuffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        mapped_ = std::exchange(other.mapped_, 0);
+        large_pages_ = std::exchange(other.large_pages_, false);
+    }
+    return *this;
+}
+
+void LargePageBuffer::release() {
+    if (data_ == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree(data_, 0, MEM_RELEASE);
+#else
+    munmap(data_, mapped_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = 0;
+    large_pages_ = false;
+}
+
+int numa_node_count() {
+#if defined(__linux__)
+    return std::max<int>(1, static_cast<int>(numa_nodes().size()));
+#elif defined(_WIN32)
+    return std::max<int>(1, static_cast<int>(numa_affinities().size()));
+#else
+    return 1;
+#endif
+}
+
+void bind_thread_to_numa_node(int index) {
+    if (numa_node_count() < 2) {
+        return;
+    }
+    auto node = static_cast<std::size_t>(index % numa_node_count());
+#if defined(__linux__)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu : numa_nodes()[node].cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpus);
+        }
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#elif defined(_WIN32)
+    GROUP_AFFINITY affinity = numa_affinities()[node];
+    SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+#else
+    (void)node;
+#endif
+}
+
+}  // namespace chiron
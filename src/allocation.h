@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+namespace chiron {
+
+/**
+ * @brief Zero-filled, page-aligned memory for large tables, backed by huge pages when the OS
+ *        grants them.
+ *
+ * Linux first asks for explicit huge pages (MAP_HUGETLB) and otherwise maps ordinary pages
+ * advised for transparent huge pages; Windows tries MEM_LARGE_PAGES, which needs the "Lock
+ * pages in memory" privilege. Either way a failed request falls back to regular pages, so
+ * construction only throws (std::bad_alloc) when no memory is available at all. On machines
+ * with several NUMA nodes the pages are interleaved across the nodes.
+ */
+class LargePageBuffer {
+   public:
+    LargePageBuffer() = default;
+    explicit LargePageBuffer(std::size_t bytes);
+    ~LargePageBuffer();
+
+    LargePageBuffer(LargePageBuffer&& other) noexcept;
+    LargePageBuffer& operator=(LargePageBuffer&& other) noexcept;
+    LargePageBuffer(const LargePageBuffer&) = delete;
+    LargePageBuffer& operator=(const LargePageBuffer&) = delete;
+
+    [[nodiscard]] void* data() const { return data_; }
+    [[nodiscard]] std::size_t size() const { return size_; }
+    /** @brief True when the OS handed out explicit large pages rather than regular ones. */
+    [[nodiscard]] bool large_pages() const { return large_pages_; }
+
+   private:
+    void release();
+
+    void* data_ = nullptr;
+    std::size_t size_ = 0;     // Requested size.
+    std::size_t mapped_ = 0;   // Size actually mapped, a multiple of the page size.
+    bool large_pages_ = false;
+};
+
+/** @brief Number of NUMA nodes with CPUs; 1 where the platform does not report any. */
+[[nodiscard]] int numa_node_count();
+
+/**
+ * @brief Restricts the calling thread to the CPUs of NUMA node @p index modulo
+ *        numa_node_count(). Does nothing on single-node machines.
+ */
+void bind_thread_to_numa_node(int index);
+
+}  // namespace chiron
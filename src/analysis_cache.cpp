@@ -0,0 +1,123 @@
+#include "analysis_cache.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace chiron {
+
+namespace {
+
+constexpr std::array<char, 8> kFileMagic = {'C', 'H', 'I', 'R', 'O', 'N', 'A', 'C'};
+constexpr std::uint32_t kFileVersion = 1;
+constexpr std::uint32_t kByteOrderMark = 0x01020304U;
+
+struct FileHeader {
+    std::array<char, 8> magic = kFileMagic;
+    std::uint32_t version = kFileVersion;
+    std::uint32_t byte_order = kByteOrderMark;
+    std::uint64_t record_count = 0;
+    std::uint64_t reserved = 0;
+};
+
+struct FileRecord {
+    std::uint64_t key = 0;
+    std::uint16_t move = 0;
+    std::int16_t depth = 0;
+    std::int16_t score = 0;
+    std::uint16_t reserved = 0;
+};
+
+static_assert(sizeof(FileHeader) == 32 && sizeof(FileRecord) == 16, "Analysis cache files use fixed-size records");
+
+}  // namespace
+
+std::optional<AnalysisRecord> AnalysisCache::probe(std::uint64_t key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = records_.find(key);
+    if (found == records_.end()) {
+        return std::nullopt;
+    }
+    return found->second;
+}
+
+void AnalysisCache::record(std::uint64_t key, const AnalysisRecord& record) {
+    if (record.move.is_null() || record.depth <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [entry, inserted] = records_.try_emplace(key, record);
+    if (!inserted && entry->second.depth <= record.depth) {
+        entry->second = record;
+    }
+}
+
+void AnalysisCache::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Unable to open analysis cache: " + path);
+    }
+    FileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != kFileMagic) {
+        throw std::runtime_error("Not an analysis cache file: " + path);
+    }
+    if (header.version != kFileVersion || header.byte_order != kByteOrderMark) {
+        throw std::runtime_error("Incompatible analysis cache file: " + path);
+    }
+    std::error_code error;
+    std::uintmax_t bytes = std::filesystem::file_size(path, error);
+    if (error || (bytes - sizeof(FileHeader)) / sizeof(FileRecord) < header.record_count) {
+        throw std::runtime_error("Truncated analysis cache file: " + path);
+    }
+    std::vector<FileRecord> records(static_cast<std::size_t>(header.record_count));
+    in.read(reinterpret_cast<char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(FileRecord)));
+    if (!in) {
+        throw std::runtime_error("Truncated analysis cache file: " + path);
+    }
+    for (const FileRecord& saved : records) {
+        record(saved.key, {PackedMove{saved.move}, saved.depth, saved.score});
+    }
+}
+
+void AnalysisCache::save(const std::string& path) const {
+    std::vector<FileRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        records.reserve(records_.size());
+        for (const auto& [key, entry] : records_) {
+            records.push_back({key, entry.move.value, static_cast<std::int16_t>(entry.depth),
+                               static_cast<std::int16_t>(entry.score), 0});
+        }
+    }
+    std::sort(records.begin(), records.end(),
+              [](const FileRecord& lhs, const FileRecord& rhs) { return lhs.key < rhs.key; });
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Unable to write analysis cache: " + path);
+    }
+    FileHeader header;
+    header.record_count = records.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(records.data()),
+              static_cast<std::streamsize>(records.size() * sizeof(FileRecord)));
+    if (!out) {
+        throw std::runtime_error("Failed while writing analysis cache: " + path);
+    }
+}
+
+std::size_t AnalysisCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_.size();
+}
+
+void AnalysisCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_.clear();
+}
+
+}  // namespace chiron
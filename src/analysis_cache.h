@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "move.h"
+
+namespace chiron {
+
+/** @brief Outcome of a finished root search kept by AnalysisCache. */
+struct AnalysisRecord {
+    PackedMove move{};  /**< Best move the search returned. */
+    int depth = 0;      /**< Last completed iteration. */
+    int score = 0;      /**< Score of that iteration from the side to move's point of view. */
+};
+
+/**
+ * @brief Persistent map from a root position's Zobrist key to the deepest result searched there.
+ *
+ * Search records every finished search and probes the cache before iterating, so positions that
+ * come up again, possibly in another process after load(), search the stored move first with
+ * an aspiration window around the stored score. Unlike the transposition table nothing is ever
+ * replaced by a shallower result. All members may be called from any thread.
+ */
+class AnalysisCache {
+   public:
+    AnalysisCache() = default;
+    AnalysisCache(const AnalysisCache&) = delete;
+    AnalysisCache& operator=(const AnalysisCache&) = delete;
+
+    [[nodiscard]] std::optional<AnalysisRecord> probe(std::uint64_t key) const;
+
+    /** @brief Keeps @p record for @p key unless a deeper one is already stored. */
+    void record(std::uint64_t key, const AnalysisRecord& record);
+
+    /**
+     * @brief Merges the records saved in @p path, keeping the deeper one where both have a key.
+     *        Throws std::runtime_error for unreadable or malformed files.
+     */
+    void load(const std::string& path);
+
+    /**
+     * @brief Writes every record to @p path: a 32-byte header followed by fixed-size 16-byte
+     *        records sorted by key in native byte order, so a mapped file can be binary searched.
+     */
+    void save(const std::string& path) const;
+
+    [[nodiscard]] std::size_t size() const;
+    void clear();
+
+   private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::uint64_t, AnalysisRecord> records_;
+};
+
+}  // namespace chiron
@@ -1,14 +1,76 @@
 #include "attacks.h"
 
 #include <array>
+#include <mutex>
+
+#if defined(__BMI2__) && !defined(CHIRON_DISABLE_PEXT)
+#include <immintrin.h>
+#define CHIRON_USE_PEXT 1
+#else
+#define CHIRON_USE_PEXT 0
+#endif
 
 namespace chiron {
 
 namespace {
-std::array<std::array<Bitboard, kBoardSize>, kNumColors> pawn_attacks_{};
-std::array<Bitboard, kBoardSize> knight_attacks_{};
-std::array<Bitboard, kBoardSize> king_attacks_{};
-bool initialized = false;
+
+/**
+ * @brief Per-square slider lookup parameters (fancy magic bitboards or BMI2 PEXT).
+ */
+struct Magic {
+    Bitboard mask = kEmpty;             /**< Relevant occupancy squares (board edges stripped). */
+    Bitboard magic = kEmpty;            /**< Multiplier mapping masked occupancies to indices. */
+    const Bitboard* attacks = nullptr;  /**< Start of this square's slice in the shared table. */
+    unsigned shift = 0;                 /**< 64 minus the number of relevant occupancy bits. */
+
+    [[nodiscard]] unsigned index(Bitboard occupied) const {
+#if CHIRON_USE_PEXT
+        return static_cast<unsigned>(_pext_u64(occupied, mask));
+#else
+        return static_cast<unsigned>(((occupied & mask) * magic) >> shift);
+#endif
+    }
+};
+
+std::array<std::array<Bitboard, kBoardSize>, kNumColors> pawn_attack_table{};
+std::array<Bitboard, kBoardSize> knight_attack_table{};
+std::array<Bitboard, kBoardSize> king_attack_table{};
+std::array<Magic, kBoardSize> bishop_magics{};
+std::array<Magic, kBoardSize> rook_magics{};
+std::array<std::array<Bitboard, kBoardSize>, kBoardSize> between_table{};
+std::array<std::array<Bitboard, kBoardSize>, kBoardSize> line_table{};
+
+constexpr std::size_t kBishopTableSize = 0x1480;
+constexpr std::size_t kRookTableSize = 0x19000;
+
+std::array<Bitboard, kBishopTableSize> bishop_table{};
+std::array<Bitboard, kRookTableSize> rook_table{};
+std::once_flag init_flag;
+
+constexpr Bitboard kRank1 = 0x00000000000000FFULL;
+constexpr Bitboard kRank8 = 0xFF00000000000000ULL;
+constexpr Bitboard kFileA = 0x0101010101010101ULL;
+constexpr Bitboard kFileH = 0x8080808080808080ULL;
+
+/**
+ * @brief xorshift64* generator; with the per-rank seeds below every magic is found quickly.
+ */
+class MagicRng {
+   public:
+    explicit MagicRng(std::uint64_t seed) : state_(seed) {}
+
+    std::uint64_t next() {
+        state_ ^= state_ >> 12;
+        state_ ^= state_ << 25;
+        state_ ^= state_ >> 27;
+        return state_ * 2685821657736338717ULL;
+    }
+
+    std::uint64_t sparse() { return next() & next() & next(); }
+
+   private:
+    std::uint64_t state_;
+};
 
 Bitboard mask_knight(int square) {
     Bitboard attacks = kEmpty;
@@ -52,108 +114,148 @@ Bitboard mask_pawn(Color color, int square) {
     return south_east(b) | south_west(b);
 }
 
-}  // namespace
-
-void init_attack_tables() {
-    if (initialized) {
-        return;
-    }
-
-    for (int sq = 0; sq < kBoardSize; ++sq) {
-        knight_attacks_[sq] = mask_knight(sq);
-        king_attacks_[sq] = mask_king(sq);
-        pawn_attacks_[static_cast<int>(Color::White)][sq] = mask_pawn(Color::White, sq);
-        pawn_attacks_[static_cast<int>(Color::Black)][sq] = mask_pawn(Color::Black, sq);
+Bitboard ray_attacks(int square, Bitboard blockers, const int (&directions)[4][2]) {
+    Bitboard attacks = kEmpty;
+    int rank = square / 8;
+    int file = square % 8;
+    for (const auto& direction : directions) {
+        for (int r = rank + direction[0], f = file + direction[1]; r >= 0 && r <= 7 && f >= 0 && f <= 7;
+             r += direction[0], f += direction[1]) {
+            Bitboard bb = square_bb(static_cast<Square>(r * 8 + f));
+            attacks |= bb;
+            if (blockers & bb) {
+                break;
+            }
+        }
     }
-    initialized = true;
+    return attacks;
 }
 
-Bitboard pawn_attacks(Color color, int square) {
-    init_attack_tables();
-    return pawn_attacks_[static_cast<int>(color)][square];
-}
+/**
+ * @brief Fills one slider's magic entries and attack slices.
+ *
+ * Every subset of the relevant mask is enumerated with the Carry-Rippler trick. With PEXT
+ * the subsets index the slice directly; otherwise sparse random multipliers are tried until
+ * one maps all subsets without a destructive collision.
+ */
+void init_sliders(PieceType piece, Bitboard* table, std::array<Magic, kBoardSize>& magics) {
+    std::array<Bitboard, 4096> occupancy{};
+    std::array<Bitboard, 4096> reference{};
+#if !CHIRON_USE_PEXT
+    static constexpr std::uint64_t kSeeds[8] = {728, 10316, 55013, 32803, 12281, 15100, 16645, 255};
+    std::array<int, 4096> epoch{};
+    int attempt = 0;
+#endif
+    Bitboard* next_slice = table;
 
-Bitboard knight_attacks(int square) {
-    init_attack_tables();
-    return knight_attacks_[square];
-}
+    for (int sq = 0; sq < kBoardSize; ++sq) {
+        Bitboard rank_bb = kRank1 << (8 * (sq >> 3));
+        Bitboard file_bb = kFileA << (sq & 7);
+        Bitboard edges = ((kRank1 | kRank8) & ~rank_bb) | ((kFileA | kFileH) & ~file_bb);
 
-Bitboard king_attacks(int square) {
-    init_attack_tables();
-    return king_attacks_[square];
-}
+        Magic& entry = magics[sq];
+        entry.mask = sliding_attacks_slow(piece, sq, kEmpty) & ~edges;
+        entry.shift = static_cast<unsigned>(64 - popcount(entry.mask));
+        entry.attacks = next_slice;
+        Bitboard* slice = next_slice;
 
-Bitboard bishop_attacks(int square, Bitboard blockers) {
-    Bitboard attacks = kEmpty;
-    int rank = square / 8;
-    int file = square % 8;
+        int size = 0;
+        Bitboard subset = kEmpty;
+        do {
+            occupancy[size] = subset;
+            reference[size] = sliding_attacks_slow(piece, sq, subset);
+            ++size;
+            subset = (subset - entry.mask) & entry.mask;
+        } while (subset);
+        next_slice += size;
 
-    for (int r = rank + 1, f = file + 1; r <= 7 && f <= 7; ++r, ++f) {
-        int sq = r * 8 + f;
-        attacks |= square_bb(static_cast<Square>(sq));
-        if (blockers & square_bb(static_cast<Square>(sq))) {
-            break;
+#if CHIRON_USE_PEXT
+        for (int i = 0; i < size; ++i) {
+            slice[entry.index(occupancy[i])] = reference[i];
         }
-    }
-    for (int r = rank + 1, f = file - 1; r <= 7 && f >= 0; ++r, --f) {
-        int sq = r * 8 + f;
-        attacks |= square_bb(static_cast<Square>(sq));
-        if (blockers & square_bb(static_cast<Square>(sq))) {
-            break;
+#else
+        MagicRng rng(kSeeds[sq >> 3]);
+        for (bool found = false; !found;) {
+            do {
+                entry.magic = rng.sparse();
+            } while (popcount((entry.magic * entry.mask) >> 56) < 6);
+
+            ++attempt;
+            found = true;
+            for (int i = 0; i < size; ++i) {
+                unsigned idx = entry.index(occupancy[i]);
+                if (epoch[idx] < attempt) {
+                    epoch[idx] = attempt;
+                    slice[idx] = reference[i];
+                } else if (slice[idx] != reference[i]) {
+                    found = false;
+                    break;
+                }
+            }
         }
+#endif
     }
-    for (int r = rank - 1, f = file + 1; r >= 0 && f <= 7; --r, ++f) {
-        int sq = r * 8 + f;
-        attacks |= square_bb(static_cast<Square>(sq));
-        if (blockers & square_bb(static_cast<Square>(sq))) {
-            break;
-        }
+}
+
+void build_tables() {
+    for (int sq = 0; sq < kBoardSize; ++sq) {
+        knight_attack_table[sq] = mask_knight(sq);
+        king_attack_table[sq] = mask_king(sq);
+        pawn_attack_table[static_cast<int>(Color::White)][sq] = mask_pawn(Color::White, sq);
+        pawn_attack_table[static_cast<int>(Color::Black)][sq] = mask_pawn(Color::Black, sq);
     }
-    for (int r = rank - 1, f = file - 1; r >= 0 && f >= 0; --r, --f) {
-        int sq = r * 8 + f;
-        attacks |= square_bb(static_cast<Square>(sq));
-        if (blockers & square_bb(static_cast<Square>(sq))) {
-            break;
+    init_sliders(PieceType::Bishop, bishop_table.data(), bishop_magics);
+    init_sliders(PieceType::Rook, rook_table.data(), rook_magics);
+
+    for (int a = 0; a < kBoardSize; ++a) {
+        for (PieceType piece : {PieceType::Bishop, PieceType::Rook}) {
+            Bitboard rays = sliding_attacks_slow(piece, a, kEmpty);
+            Bitboard targets = rays;
+            while (targets) {
+                int b = pop_lsb(targets);
+                Bitboard a_bb = square_bb(static_cast<Square>(a));
+                Bitboard b_bb = square_bb(static_cast<Square>(b));
+                line_table[a][b] = (rays & sliding_attacks_slow(piece, b, kEmpty)) | a_bb | b_bb;
+                between_table[a][b] = sliding_attacks_slow(piece, a, b_bb) & sliding_attacks_slow(piece, b, a_bb);
+            }
         }
     }
-    return attacks;
+}
+
+struct StaticTableInitializer {
+    StaticTableInitializer() { init_attack_tables(); }
+};
+
+const StaticTableInitializer static_table_initializer;
+
+}  // namespace
+
+void init_attack_tables() { std::call_once(init_flag, build_tables); }
+
+Bitboard pawn_attacks(Color color, int square) { return pawn_attack_table[static_cast<int>(color)][square]; }
+
+Bitboard knight_attacks(int square) { return knight_attack_table[square]; }
+
+Bitboard king_attacks(int square) { return king_attack_table[square]; }
+
+Bitboard bishop_attacks(int square, Bitboard blockers) {
+    const Magic& entry = bishop_magics[square];
+    return entry.attacks[entry.index(blockers)];
 }
 
 Bitboard rook_attacks(int square, Bitboard blockers) {
-    Bitboard attacks = kEmpty;
-    int rank = square / 8;
-    int file = square % 8;
+    const Magic& entry = rook_magics[square];
+    return entry.attacks[entry.index(blockers)];
+}
 
-    for (int r = rank + 1; r <= 7; ++r) {
-        int sq = r * 8 + file;
-        attacks |= square_bb(static_cast<Square>(sq));
-        if (blockers & square_bb(static_cast<Square>(sq))) {
-            break;
-        }
-    }
-    for (int r = rank - 1; r >= 0; --r) {
-        int sq = r * 8 + file;
-        attacks |= square_bb(static_cast<Square>(sq));
-        if (blockers & square_bb(static_cast<Square>(sq))) {
-            break;
-        }
-    }
-    for (int f = file + 1; f <= 7; ++f) {
-        int sq = rank * 8 + f;
-        attacks |= square_bb(static_cast<Square>(sq));
-        if (blockers & square_bb(static_cast<Square>(sq))) {
-            break;
-        }
-    }
-    for (int f = file - 1; f >= 0; --f) {
-        int sq = rank * 8 + f;
-        attacks |= square_bb(static_cast<Square>(sq));
-        if (blockers & square_bb(static_cast<Square>(sq))) {
-            break;
-        }
-    }
-    return attacks;
+Bitboard between_bb(int from, int to) { return between_table[from][to]; }
+
+Bitboard line_bb(int from, int to) { return line_table[from][to]; }
+
+Bitboard sliding_attacks_slow(PieceType piece, int square, Bitboard blockers) {
+    static constexpr int kBishopDirections[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+    static constexpr int kRookDirections[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    return ray_attacks(square, blockers, piece == PieceType::Bishop ? kBishopDirections : kRookDirections);
 }
 
 }  // namespace chiron
-
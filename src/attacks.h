@@ -5,6 +5,12 @@
 
 namespace chiron {
 
+/**
+ * @brief Builds the leaper tables and the magic (or BMI2 PEXT) slider tables.
+ *
+ * Safe to call repeatedly; the tables are also built during static initialisation so the
+ * lookups below never pay an initialisation check.
+ */
 void init_attack_tables();
 
 [[nodiscard]] Bitboard pawn_attacks(Color color, int square);
@@ -16,5 +22,19 @@ void init_attack_tables();
     return bishop_attacks(square, blockers) | rook_attacks(square, blockers);
 }
 
-}  // namespace chiron
+/**
+ * @brief Squares strictly between two aligned squares, or an empty board when not aligned.
+ */
+[[nodiscard]] Bitboard between_bb(int from, int to);
+
+/**
+ * @brief Full rank, file or diagonal through two aligned squares, or an empty board.
+ */
+[[nodiscard]] Bitboard line_bb(int from, int to);
 
+/**
+ * @brief Reference ray-walking slider attacks used to build and verify the magic tables.
+ */
+[[nodiscard]] Bitboard sliding_attacks_slow(PieceType piece, int square, Bitboard blockers);
+
+}  // namespace chiron
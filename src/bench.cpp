@@ -0,0 +1,59 @@
+#include "bench.h"
+
+#include <algorithm>
+
+#include "board.h"
+
+namespace chiron {
+
+const std::vector<std::string>& bench_positions() {
+    static const std::vector<std::string> positions = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r3k2r/2pb1ppp/2pp1q2/p7/1nP1B3/1P2P3/P2N1PPP/R2QK2R w KQkq a6 0 14",
+        "4rrk1/2p1b1p1/p1p3q1/4p3/2P2n1p/1P1NR2P/PB3PP1/3R1QK1 b - - 2 24",
+        "r3qbrk/6p1/2b2pPp/p3pP1Q/PpPpP2P/3P1B2/2PB3K/R5R1 w - - 16 42",
+        "6k1/1R3p2/6p1/2Bp3p/3P2q1/P7/1P2rQ1K/5R2 b - - 4 44",
+        "7r/2p3k1/1p1p1qp1/1P1Bp3/p1P2r1P/P7/4R3/Q4RK1 w - - 0 36",
+        "8/8/1p2k1p1/3p3p/1p1P1P1P/1P2PK2/8/8 w - - 3 54",
+    };
+    return positions;
+}
+
+std::uint64_t BenchResult::nodes_per_second() const {
+    auto ms = static_cast<std::uint64_t>(std::max<std::chrono::milliseconds::rep>(elapsed.count(), 1));
+    return nodes * 1000 / ms;
+}
+
+BenchResult run_bench(const BenchConfig& config,
+                      const std::function<void(std::size_t, const SearchResult&)>& on_position) {
+    Search search;
+    search.set_table_size_mb(config.hash_mb);
+    search.set_threads(config.threads);
+
+    SearchLimits limits;
+    limits.max_depth = config.depth;
+
+    BenchResult bench;
+    const std::vector<std::string>& positions = bench_positions();
+    for (std::size_t index = 0; index < positions.size(); ++index) {
+        Board board;
+        board.set_from_fen(positions[index]);
+        search.new_game();
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result = search.search(board, limits);
+        bench.elapsed += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        bench.nodes += result.nodes;
+        bench.stats += result.stats;
+        if (on_position) {
+            on_position(index, result);
+        }
+    }
+    return bench;
+}
+
+}  // namespace chiron
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "search.h"
+
+namespace chiron {
+
+struct BenchConfig {
+    int depth = 10;
+    int threads = 1;
+    std::size_t hash_mb = 16;
+};
+
+struct BenchResult {
+    std::uint64_t nodes = 0; /**< Summed over the suite; with one thread it doubles as a signature. */
+    std::chrono::milliseconds elapsed{0};
+    SearchStats stats{};
+
+    [[nodiscard]] std::uint64_t nodes_per_second() const;
+};
+
+/** @brief The fixed positions bench searches: openings, middlegames and endgames. */
+const std::vector<std::string>& bench_positions();
+
+/**
+ * @brief Searches every bench position to a fixed depth on one engine, starting a new game
+ *        before each, and reports @p on_position after each search.
+ *
+ * A repeatable speed test: single-threaded the node count depends only on the search and
+ * evaluation code, so a changed signature flags a functional change and a changed NPS at the
+ * same signature a speed change.
+ */
+BenchResult run_bench(const BenchConfig& config,
+                      const std::function<void(std::size_t, const SearchResult&)>& on_position = {});
+
+}  // namespace chiron
@@ -1,9 +1,11 @@
 #include "board.h"
 
+#include <array>
 #include <bit>
-#include <cctype>
-#include <sstream>
+#include <charconv>
 #include <stdexcept>
+#include <string>
+#include <system_error>
 
 #include "attacks.h"
 #include "zobrist.h"
@@ -20,6 +22,76 @@ int square_from_file_rank(char file, char rank) {
     return r * 8 + f;
 }
 
+/** @brief Removes and returns the next space-separated field of @p text; empty once none is left. */
+std::string_view next_fen_field(std::string_view& text) {
+    std::size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string_view::npos) {
+        text = {};
+        return {};
+    }
+    std::size_t end = text.find_first_of(" \t\r\n", begin);
+    std::string_view field = text.substr(begin, end - begin);
+    text = end == std::string_view::npos ? std::string_view{} : text.substr(end);
+    return field;
+}
+
+/** @brief Parses @p field as a non-negative move counter into @p value; false, leaving it, otherwise. */
+bool parse_fen_counter(std::string_view field, int& value) {
+    int parsed = 0;
+    auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), parsed);
+    if (field.empty() || error != std::errc{} || end != field.data() + field.size() || parsed < 0) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// Exchange values; the king's only has to exceed any material it could win back.
+constexpr int kSeeValues[kNumPieceTypes + 1] = {100, 320, 330, 500, 900, 20000, 0};
+
+int see_value(PieceType type) { return kSeeValues[static_cast<int>(type)]; }
+
+/** @brief Castling rights that survive a move from or to each square. */
+constexpr std::array<std::uint8_t, kBoardSize> kCastlingRightsKept = [] {
+    constexpr std::uint8_t kAll = kWhiteKingCastle | kWhiteQueenCastle | kBlackKingCastle | kBlackQueenCastle;
+    std::array<std::uint8_t, kBoardSize> kept{};
+    kept.fill(kAll);
+    kept[static_cast<int>(Square::A1)] = static_cast<std::uint8_t>(kAll & ~kWhiteQueenCastle);
+    kept[static_cast<int>(Square::H1)] = static_cast<std::uint8_t>(kAll & ~kWhiteKingCastle);
+    kept[static_cast<int>(Square::A8)] = static_cast<std::uint8_t>(kAll & ~kBlackQueenCastle);
+    kept[static_cast<int>(Square::H8)] = static_cast<std::uint8_t>(kAll & ~kBlackKingCastle);
+    return kept;
+}();
+
+/** @brief Rook squares and rights of castling for the side @p Us. */
+template <Color Us>
+struct CastlingSquares {
+    static constexpr bool kWhite = Us == Color::White;
+    static constexpr int kKingRookFrom = static_cast<int>(kWhite ? Square::H1 : Square::H8);
+    static constexpr int kKingRookTo = static_cast<int>(kWhite ? Square::F1 : Square::F8);
+    static constexpr int kQueenRookFrom = static_cast<int>(kWhite ? Square::A1 : Square::A8);
+    static constexpr int kQueenRookTo = static_cast<int>(kWhite ? Square::D1 : Square::D8);
+    static constexpr std::uint8_t kRights =
+        kWhite ? kWhiteKingCastle | kWhiteQueenCastle : kBlackKingCastle | kBlackQueenCastle;
+};
+
+Bitboard piece_attacks(PieceType type, int square, Bitboard occupied) {
+    switch (type) {
+        case PieceType::Knight:
+            return knight_attacks(square);
+        case PieceType::Bishop:
+            return bishop_attacks(square, occupied);
+        case PieceType::Rook:
+            return rook_attacks(square, occupied);
+        case PieceType::Queen:
+            return queen_attacks(square, occupied);
+        case PieceType::King:
+            return king_attacks(square);
+        default:
+            return kEmpty;
+    }
+}
+
 }  // namespace
 
 Board::Board() {
@@ -40,6 +112,10 @@ void Board::clear() {
     halfmove_clock_ = 0;
     fullmove_number_ = 1;
     zobrist_key_ = 0ULL;
+    pawn_key_ = 0ULL;
+    king_squares_.fill(-1);
+    checkers_ = kEmpty;
+    pinned_ = kEmpty;
 }
 
 void Board::place_piece(Color color, PieceType type, int square) {
@@ -49,6 +125,11 @@ void Board::place_piece(Color color, PieceType type, int square) {
     occupancy_all_ |= bb;
     mailbox_[square] = encode_piece(color, type);
     zobrist_key_ ^= Zobrist::piece_key(color, type, square);
+    if (type == PieceType::Pawn) {
+        pawn_key_ ^= Zobrist::piece_key(color, type, square);
+    } else if (type == PieceType::King) {
+        king_squares_[static_cast<int>(color)] = square;
+    }
 }
 
 void Board::remove_piece(Color color, PieceType type, int square) {
@@ -58,6 +139,34 @@ void Board::remove_piece(Color color, PieceType type, int square) {
     occupancy_all_ &= ~bb;
     mailbox_[square] = kEmptySquare;
     zobrist_key_ ^= Zobrist::piece_key(color, type, square);
+    if (type == PieceType::Pawn) {
+        pawn_key_ ^= Zobrist::piece_key(color, type, square);
+    } else if (type == PieceType::King) {
+        king_squares_[static_cast<int>(color)] = -1;
+    }
+}
+
+void Board::update_check_info() {
+    checkers_ = kEmpty;
+    pinned_ = kEmpty;
+    const Color us = side_to_move_;
+    const Color them = opposite_color(us);
+    const int king = king_squares_[static_cast<int>(us)];
+    if (king < 0) {
+        return;
+    }
+    checkers_ = attackers_to(king, occupancy_all_) & occupancy(them);
+
+    // Enemy sliders that would hit the king on an empty board pin a lone friendly blocker.
+    Bitboard diagonal = pieces(them, PieceType::Bishop) | pieces(them, PieceType::Queen);
+    Bitboard orthogonal = pieces(them, PieceType::Rook) | pieces(them, PieceType::Queen);
+    Bitboard snipers = (bishop_attacks(king, kEmpty) & diagonal) | (rook_attacks(king, kEmpty) & orthogonal);
+    while (snipers) {
+        Bitboard blockers = between_bb(king, pop_lsb(snipers)) & occupancy_all_;
+        if (blockers && (blockers & (blockers - 1)) == 0 && (blockers & occupancy(us))) {
+            pinned_ |= blockers;
+        }
+    }
 }
 
 PieceType Board::piece_from_char(char c) const {
@@ -105,59 +214,81 @@ void Board::set_start_position() {
     set_from_fen(kStartFEN);
 }
 
-void Board::set_from_fen(const std::string& fen) {
+void Board::set_from_fen(std::string_view fen) {
     clear();
     Zobrist::init();
 
-    std::istringstream iss(fen);
-    std::string placement, active, castling, en_passant;
-    int halfmove = 0;
-    int fullmove = 1;
-
-    if (!(iss >> placement >> active >> castling >> en_passant)) {
+    std::string_view placement = next_fen_field(fen);
+    std::string_view active = next_fen_field(fen);
+    std::string_view castling = next_fen_field(fen);
+    std::string_view en_passant = next_fen_field(fen);
+    if (en_passant.empty()) {
         throw std::runtime_error("Invalid FEN string: missing fields");
     }
-    if (!(iss >> halfmove)) {
-        halfmove = 0;
-    }
-    if (!(iss >> fullmove)) {
-        fullmove = 1;
-    }
 
-    int square = 56;  // start from rank 8, file A
+    int rank = 7;
+    int file = 0;
     for (char c : placement) {
         if (c == '/') {
-            square -= 16;  // move down one rank
+            if (file != 8 || rank == 0) {
+                throw std::runtime_error("Invalid FEN placement: expected eight ranks of eight squares");
+            }
+            --rank;
+            file = 0;
             continue;
         }
-        if (std::isdigit(static_cast<unsigned char>(c))) {
-            square += c - '0';
-            continue;
+        int squares = c >= '1' && c <= '8' ? c - '0' : 1;
+        if (file + squares > 8) {
+            throw std::runtime_error("Invalid FEN placement: expected eight ranks of eight squares");
         }
-        PieceType type = piece_from_char(c);
-        if (type == PieceType::None) {
-            throw std::runtime_error("Invalid piece character in FEN");
+        if (squares == 1 && c != '1') {
+            PieceType type = piece_from_char(c);
+            if (type == PieceType::None) {
+                throw std::runtime_error("Invalid piece character in FEN");
+            }
+            place_piece(c < 'a' ? Color::White : Color::Black, type, rank * 8 + file);
         }
-        Color color = std::isupper(static_cast<unsigned char>(c)) ? Color::White : Color::Black;
-        place_piece(color, type, square);
-        ++square;
+        file += squares;
+    }
+    if (rank != 0 || file != 8) {
+        throw std::runtime_error("Invalid FEN placement: expected eight ranks of eight squares");
     }
 
-    side_to_move_ = (active == "b") ? Color::Black : Color::White;
+    if (active != "w" && active != "b") {
+        throw std::runtime_error("Invalid side to move in FEN");
+    }
+    side_to_move_ = active == "b" ? Color::Black : Color::White;
     if (side_to_move_ == Color::Black) {
         zobrist_key_ ^= Zobrist::side_key();
     }
 
     std::uint8_t rights = 0;
-    if (castling.find('K') != std::string::npos) rights |= kWhiteKingCastle;
-    if (castling.find('Q') != std::string::npos) rights |= kWhiteQueenCastle;
-    if (castling.find('k') != std::string::npos) rights |= kBlackKingCastle;
-    if (castling.find('q') != std::string::npos) rights |= kBlackQueenCastle;
+    if (castling != "-") {
+        for (char c : castling) {
+            switch (c) {
+                case 'K':
+                    rights |= kWhiteKingCastle;
+                    break;
+                case 'Q':
+                    rights |= kWhiteQueenCastle;
+                    break;
+                case 'k':
+                    rights |= kBlackKingCastle;
+                    break;
+                case 'q':
+                    rights |= kBlackQueenCastle;
+                    break;
+                default:
+                    throw std::runtime_error("Invalid castling rights in FEN");
+            }
+        }
+    }
     castling_rights_ = rights;
     zobrist_key_ ^= Zobrist::castling_key(castling_rights_);
 
     if (en_passant != "-") {
-        if (en_passant.size() != 2) {
+        if (en_passant.size() != 2 || en_passant[0] < 'a' || en_passant[0] > 'h' ||
+            (en_passant[1] != '3' && en_passant[1] != '6')) {
             throw std::runtime_error("Invalid en passant square in FEN");
         }
         int ep_square = square_from_file_rank(en_passant[0], en_passant[1]);
@@ -165,8 +296,44 @@ void Board::set_from_fen(const std::string& fen) {
         zobrist_key_ ^= Zobrist::en_passant_key(file_of(static_cast<Square>(ep_square)));
     }
 
-    halfmove_clock_ = halfmove;
-    fullmove_number_ = fullmove;
+    // The counters are optional; EPD lines carry operations in their place, which are ignored.
+    halfmove_clock_ = 0;
+    fullmove_number_ = 1;
+    if (parse_fen_counter(next_fen_field(fen), halfmove_clock_)) {
+        parse_fen_counter(next_fen_field(fen), fullmove_number_);
+    }
+    update_check_info();
+}
+
+void Board::set_from_placement(const std::array<std::uint8_t, kBoardSize>& squares, Color side_to_move,
+                               std::uint8_t castling_rights, int en_passant_square, int halfmove_clock,
+                               int fullmove_number) {
+    clear();
+    Zobrist::init();
+    for (int square = 0; square < kBoardSize; ++square) {
+        std::uint8_t code = squares[square];
+        if (code == kEmptySquare) {
+            continue;
+        }
+        if (code > kEmptySquare) {
+            throw std::runtime_error("Invalid piece code in board placement");
+        }
+        place_piece(decode_piece_color(code), decode_piece_type(code), square);
+    }
+
+    side_to_move_ = side_to_move;
+    if (side_to_move_ == Color::Black) {
+        zobrist_key_ ^= Zobrist::side_key();
+    }
+    castling_rights_ = castling_rights & (kWhiteKingCastle | kWhiteQueenCastle | kBlackKingCastle | kBlackQueenCastle);
+    zobrist_key_ ^= Zobrist::castling_key(castling_rights_);
+    if (en_passant_square >= 0 && en_passant_square < kBoardSize) {
+        en_passant_square_ = en_passant_square;
+        zobrist_key_ ^= Zobrist::en_passant_key(file_of(static_cast<Square>(en_passant_square)));
+    }
+    halfmove_clock_ = halfmove_clock;
+    fullmove_number_ = fullmove_number;
+    update_check_info();
 }
 
 bool Board::is_square_attacked(Square sq, Color by) const {
@@ -194,25 +361,220 @@ bool Board::is_square_attacked(Square sq, Color by) const {
     return false;
 }
 
-bool Board::in_check(Color color) const {
-    Bitboard king_bb = pieces(color, PieceType::King);
-    if (king_bb == 0ULL) {
+Bitboard Board::attackers_to(int square, Bitboard occupied) const {
+    Bitboard bishops = pieces_[0][static_cast<int>(PieceType::Bishop)] | pieces_[1][static_cast<int>(PieceType::Bishop)];
+    Bitboard rooks = pieces_[0][static_cast<int>(PieceType::Rook)] | pieces_[1][static_cast<int>(PieceType::Rook)];
+    Bitboard queens = pieces_[0][static_cast<int>(PieceType::Queen)] | pieces_[1][static_cast<int>(PieceType::Queen)];
+    Bitboard knights = pieces_[0][static_cast<int>(PieceType::Knight)] | pieces_[1][static_cast<int>(PieceType::Knight)];
+    Bitboard kings = pieces_[0][static_cast<int>(PieceType::King)] | pieces_[1][static_cast<int>(PieceType::King)];
+    return (pawn_attacks(Color::Black, square) & pieces(Color::White, PieceType::Pawn)) |
+           (pawn_attacks(Color::White, square) & pieces(Color::Black, PieceType::Pawn)) |
+           (knight_attacks(square) & knights) | (king_attacks(square) & kings) |
+           (bishop_attacks(square, occupied) & (bishops | queens)) | (rook_attacks(square, occupied) & (rooks | queens));
+}
+
+bool Board::is_pseudo_legal(const Move& move) const {
+    if (move.from < 0 || move.from >= kBoardSize || move.to < 0 || move.to >= kBoardSize || move.from == move.to) {
+        return false;
+    }
+    const Color us = side_to_move_;
+    const Bitboard from_bb = square_bb(static_cast<Square>(move.from));
+    const Bitboard to_bb = square_bb(static_cast<Square>(move.to));
+    if ((occupancy(us) & from_bb) == 0ULL || (occupancy(us) & to_bb) != 0ULL) {
+        return false;
+    }
+    const PieceType piece = piece_type_at(move.from);
+    const bool enemy_on_target = (occupancy(opposite_color(us)) & to_bb) != 0ULL;
+
+    if (move.is_castle()) {
+        const bool king_side = (move.flags & MoveFlag::KingCastle) != 0;
+        const int home = static_cast<int>(us == Color::White ? Square::E1 : Square::E8);
+        std::uint8_t right = us == Color::White ? (king_side ? kWhiteKingCastle : kWhiteQueenCastle)
+                                                : (king_side ? kBlackKingCastle : kBlackQueenCastle);
+        // Squares between king and rook: f,g on the king side and b,c,d on the queen side.
+        Bitboard path = king_side ? (from_bb << 1 | from_bb << 2) : (from_bb >> 1 | from_bb >> 2 | from_bb >> 3);
+        return piece == PieceType::King && move.from == home && move.to == (king_side ? home + 2 : home - 2) &&
+               (castling_rights_ & right) != 0 && (occupancy_all_ & path) == 0ULL;
+    }
+
+    if (piece != PieceType::Pawn) {
+        if ((move.flags & (MoveFlag::DoublePush | MoveFlag::EnPassant | MoveFlag::Promotion)) != 0) {
+            return false;
+        }
+        return move.is_capture() == enemy_on_target &&
+               (piece_attacks(piece, move.from, occupancy_all_) & to_bb) != 0ULL;
+    }
+
+    const int forward = us == Color::White ? 8 : -8;
+    const int last_rank = us == Color::White ? 7 : 0;
+    if (move.is_promotion() != (move.to / 8 == last_rank)) {
+        return false;
+    }
+    if (move.is_en_passant()) {
+        Bitboard victim = square_bb(static_cast<Square>(move.to - forward));
+        return move.to == en_passant_square_ && (pawn_attacks(us, move.from) & to_bb) != 0ULL &&
+               (pieces(opposite_color(us), PieceType::Pawn) & victim) != 0ULL;
+    }
+    if (move.is_capture()) {
+        return enemy_on_target && (pawn_attacks(us, move.from) & to_bb) != 0ULL;
+    }
+    if (enemy_on_target || move.to - move.from != (move.is_double_pawn_push() ? 2 * forward : forward)) {
+        return false;
+    }
+    if (move.is_double_pawn_push()) {
+        const int start_rank = us == Color::White ? 1 : 6;
+        Bitboard path = to_bb | square_bb(static_cast<Square>(move.from + forward));
+        return move.from / 8 == start_rank && (occupancy_all_ & path) == 0ULL;
+    }
+    return (occupancy_all_ & to_bb) == 0ULL;
+}
+
+bool Board::is_legal(const Move& move) const {
+    const Color us = side_to_move_;
+    const Color them = opposite_color(us);
+    const int king = king_square(us);
+    if (king < 0) {
+        return true;
+    }
+
+    if (move.is_castle()) {
+        const int step = move.to > move.from ? 1 : -1;
+        return !is_square_attacked(static_cast<Square>(king), them) &&
+               !is_square_attacked(static_cast<Square>(move.from + step), them) &&
+               !is_square_attacked(static_cast<Square>(move.to), them);
+    }
+
+    // Out of check, a piece that is not pinned can go anywhere; only king moves and en passant
+    // need their destination tested.
+    if (checkers_ == kEmpty && move.from != king && !move.is_en_passant()) {
+        Bitboard from_bb = square_bb(static_cast<Square>(move.from));
+        Bitboard to_bb = square_bb(static_cast<Square>(move.to));
+        return (pinned_ & from_bb) == 0ULL || (line_bb(king, move.from) & to_bb) != 0ULL;
+    }
+
+    Bitboard captured = square_bb(static_cast<Square>(move.to));
+    Bitboard occupied = (occupancy_all_ ^ square_bb(static_cast<Square>(move.from))) | captured;
+    if (move.is_en_passant()) {
+        captured = square_bb(static_cast<Square>(us == Color::White ? move.to - 8 : move.to + 8));
+        occupied ^= captured;
+    }
+    const int target = move.from == king ? move.to : king;
+    return (attackers_to(target, occupied) & occupancy(them) & ~captured) == 0ULL;
+}
+
+bool Board::see_ge(const Move& move, int threshold) const {
+    if (move.is_castle()) {
+        return threshold <= 0;
+    }
+
+    const int from = move.from;
+    const int to = move.to;
+    PieceType victim = move.is_en_passant() ? PieceType::Pawn : piece_type_at(to);
+    PieceType mover = move.is_promotion() ? move.promotion : piece_type_at(from);
+
+    // swap is the balance the side to move must still beat; it flips sign every capture.
+    int swap = see_value(victim) - threshold;
+    if (move.is_promotion()) {
+        swap += see_value(move.promotion) - see_value(PieceType::Pawn);
+    }
+    if (swap < 0) {
         return false;
     }
-    int king_square = std::countr_zero(king_bb);
-    return is_square_attacked(static_cast<Square>(king_square), opposite_color(color));
+    swap = see_value(mover) - swap;
+    if (swap <= 0) {
+        return true;
+    }
+
+    Bitboard occupied = occupancy_all_ ^ square_bb(static_cast<Square>(from)) ^ square_bb(static_cast<Square>(to));
+    if (move.is_en_passant()) {
+        int captured_square = side_to_move_ == Color::White ? to - 8 : to + 8;
+        occupied ^= square_bb(static_cast<Square>(captured_square));
+    }
+
+    Bitboard diagonal = pieces(Color::White, PieceType::Bishop) | pieces(Color::Black, PieceType::Bishop) |
+                        pieces(Color::White, PieceType::Queen) | pieces(Color::Black, PieceType::Queen);
+    Bitboard straight = pieces(Color::White, PieceType::Rook) | pieces(Color::Black, PieceType::Rook) |
+                        pieces(Color::White, PieceType::Queen) | pieces(Color::Black, PieceType::Queen);
+    Bitboard attackers = attackers_to(to, occupied);
+    Color side = side_to_move_;
+    bool result = true;
+
+    while (true) {
+        side = opposite_color(side);
+        attackers &= occupied;
+        Bitboard side_attackers = attackers & occupancy(side);
+        if (side_attackers == 0ULL) {
+            break;
+        }
+        result = !result;
+
+        int type = static_cast<int>(PieceType::Pawn);
+        while ((side_attackers & pieces(side, static_cast<PieceType>(type))) == 0ULL) {
+            ++type;
+        }
+        PieceType attacker = static_cast<PieceType>(type);
+        if (attacker == PieceType::King) {
+            // The king may only recapture when the opponent has nothing left on the square.
+            return (attackers & ~occupancy(side)) != 0ULL ? !result : result;
+        }
+
+        swap = see_value(attacker) - swap;
+        if (swap < static_cast<int>(result)) {
+            break;
+        }
+        Bitboard chosen = side_attackers & pieces(side, attacker);
+        occupied ^= chosen & (~chosen + 1);
+
+        // Removing the capturer may uncover sliders behind it on the same line.
+        if (attacker == PieceType::Pawn || attacker == PieceType::Bishop || attacker == PieceType::Queen) {
+            attackers |= bishop_attacks(to, occupied) & diagonal;
+        }
+        if (attacker == PieceType::Rook || attacker == PieceType::Queen) {
+            attackers |= rook_attacks(to, occupied) & straight;
+        }
+    }
+    return result;
+}
+
+bool Board::in_check(Color color) const {
+    if (color == side_to_move_) {
+        return checkers_ != kEmpty;
+    }
+    int king = king_square(color);
+    return king >= 0 && is_square_attacked(static_cast<Square>(king), opposite_color(color));
 }
 
 void Board::make_move(const Move& move, State& out_state) {
+    if (side_to_move_ == Color::White) {
+        make_move<Color::White>(move, out_state);
+    } else {
+        make_move<Color::Black>(move, out_state);
+    }
+}
+
+void Board::undo_move(const Move& move, const State& state) {
+    // After make_move() the side to move is the opponent of the side that moved.
+    if (side_to_move_ == Color::Black) {
+        undo_move<Color::White>(move, state);
+    } else {
+        undo_move<Color::Black>(move, state);
+    }
+}
+
+template <Color Us>
+void Board::make_move(const Move& move, State& out_state) {
+    using Squares = CastlingSquares<Us>;
+    constexpr Color kThem = Us == Color::White ? Color::Black : Color::White;
+    constexpr int kPush = Us == Color::White ? 8 : -8;
+
     out_state.castling_rights = castling_rights_;
     out_state.en_passant_square = en_passant_square_;
     out_state.halfmove_clock = halfmove_clock_;
     out_state.zobrist_key = zobrist_key_;
     out_state.captured_piece = PieceType::None;
     out_state.fullmove_number = fullmove_number_;
-
-    Color us = side_to_move_;
-    Color them = opposite_color(us);
+    out_state.checkers = checkers_;
+    out_state.pinned = pinned_;
 
     PieceType moving_piece = piece_type_at(move.from);
     if (moving_piece == PieceType::None) {
@@ -226,85 +588,44 @@ void Board::make_move(const Move& move, State& out_state) {
 
     zobrist_key_ ^= Zobrist::castling_key(castling_rights_);
 
-    remove_piece(us, moving_piece, move.from);
+    remove_piece(Us, moving_piece, move.from);
 
     PieceType captured = PieceType::None;
     if (move.is_en_passant()) {
-        int cap_sq = move.to + (us == Color::White ? -8 : 8);
         captured = PieceType::Pawn;
-        remove_piece(them, captured, cap_sq);
+        remove_piece(kThem, captured, move.to - kPush);
     } else if (move.is_capture()) {
         captured = piece_type_at(move.to);
         if (captured == PieceType::None) {
             throw std::runtime_error("Capture move without a target piece");
         }
-        remove_piece(them, captured, move.to);
-    }
-
-    PieceType placed_piece = moving_piece;
-    if (move.is_promotion()) {
-        placed_piece = move.promotion;
+        remove_piece(kThem, captured, move.to);
     }
 
-    place_piece(us, placed_piece, move.to);
+    place_piece(Us, move.is_promotion() ? move.promotion : moving_piece, move.to);
 
     if (move.is_castle()) {
-        if (move.flags & MoveFlag::KingCastle) {
-            int rook_from = (us == Color::White) ? static_cast<int>(Square::H1) : static_cast<int>(Square::H8);
-            int rook_to = (us == Color::White) ? static_cast<int>(Square::F1) : static_cast<int>(Square::F8);
-            remove_piece(us, PieceType::Rook, rook_from);
-            place_piece(us, PieceType::Rook, rook_to);
-        } else {
-            int rook_from = (us == Color::White) ? static_cast<int>(Square::A1) : static_cast<int>(Square::A8);
-            int rook_to = (us == Color::White) ? static_cast<int>(Square::D1) : static_cast<int>(Square::D8);
-            remove_piece(us, PieceType::Rook, rook_from);
-            place_piece(us, PieceType::Rook, rook_to);
-        }
+        bool king_side = (move.flags & MoveFlag::KingCastle) != 0;
+        remove_piece(Us, PieceType::Rook, king_side ? Squares::kKingRookFrom : Squares::kQueenRookFrom);
+        place_piece(Us, PieceType::Rook, king_side ? Squares::kKingRookTo : Squares::kQueenRookTo);
     }
 
+    // Moving the king, or moving or capturing a rook on its home square, drops the rights.
     if (moving_piece == PieceType::King) {
-        if (us == Color::White) {
-            castling_rights_ &= ~(kWhiteKingCastle | kWhiteQueenCastle);
-        } else {
-            castling_rights_ &= ~(kBlackKingCastle | kBlackQueenCastle);
-        }
-    } else if (moving_piece == PieceType::Rook) {
-        if (us == Color::White) {
-            if (move.from == static_cast<int>(Square::A1)) {
-                castling_rights_ &= ~kWhiteQueenCastle;
-            } else if (move.from == static_cast<int>(Square::H1)) {
-                castling_rights_ &= ~kWhiteKingCastle;
-            }
-        } else {
-            if (move.from == static_cast<int>(Square::A8)) {
-                castling_rights_ &= ~kBlackQueenCastle;
-            } else if (move.from == static_cast<int>(Square::H8)) {
-                castling_rights_ &= ~kBlackKingCastle;
-            }
-        }
-    }
-
-    if (captured != PieceType::None) {
-        out_state.captured_piece = captured;
-        if (!move.is_en_passant()) {
-            if (move.to == static_cast<int>(Square::A1)) castling_rights_ &= ~kWhiteQueenCastle;
-            if (move.to == static_cast<int>(Square::H1)) castling_rights_ &= ~kWhiteKingCastle;
-            if (move.to == static_cast<int>(Square::A8)) castling_rights_ &= ~kBlackQueenCastle;
-            if (move.to == static_cast<int>(Square::H8)) castling_rights_ &= ~kBlackKingCastle;
-        }
+        castling_rights_ &= static_cast<std::uint8_t>(~Squares::kRights);
     }
+    castling_rights_ &= kCastlingRightsKept[move.from] & kCastlingRightsKept[move.to];
+    out_state.captured_piece = captured;
 
     if (moving_piece == PieceType::Pawn) {
         halfmove_clock_ = 0;
         if (move.is_double_pawn_push()) {
-            en_passant_square_ = (move.from + move.to) / 2;
+            en_passant_square_ = move.from + kPush;
         }
+    } else if (captured != PieceType::None) {
+        halfmove_clock_ = 0;
     } else {
-        if (captured != PieceType::None) {
-            halfmove_clock_ = 0;
-        } else {
-            ++halfmove_clock_;
-        }
+        ++halfmove_clock_;
     }
 
     if (en_passant_square_ != -1) {
@@ -313,51 +634,38 @@ void Board::make_move(const Move& move, State& out_state) {
 
     zobrist_key_ ^= Zobrist::castling_key(castling_rights_);
 
-    side_to_move_ = them;
+    side_to_move_ = kThem;
     zobrist_key_ ^= Zobrist::side_key();
 
-    if (us == Color::Black) {
+    if constexpr (Us == Color::Black) {
         ++fullmove_number_;
     }
+    update_check_info();
 }
 
+template <Color Us>
 void Board::undo_move(const Move& move, const State& state) {
-    Color them = side_to_move_;
-    Color us = opposite_color(them);
+    using Squares = CastlingSquares<Us>;
+    constexpr Color kThem = Us == Color::White ? Color::Black : Color::White;
+    constexpr int kPush = Us == Color::White ? 8 : -8;
 
-    side_to_move_ = us;
-
-    if (en_passant_square_ != -1) {
-        zobrist_key_ ^= Zobrist::en_passant_key(file_of(static_cast<Square>(en_passant_square_)));
-    }
-    zobrist_key_ ^= Zobrist::castling_key(castling_rights_);
+    side_to_move_ = Us;
 
     PieceType moved_piece = piece_type_at(move.to);
-    remove_piece(us, moved_piece, move.to);
-
-    PieceType original_piece = move.is_promotion() ? PieceType::Pawn : moved_piece;
-    place_piece(us, original_piece, move.from);
+    remove_piece(Us, moved_piece, move.to);
+    place_piece(Us, move.is_promotion() ? PieceType::Pawn : moved_piece, move.from);
 
     if (move.is_castle()) {
-        if (move.flags & MoveFlag::KingCastle) {
-            int rook_from = (us == Color::White) ? static_cast<int>(Square::F1) : static_cast<int>(Square::F8);
-            int rook_to = (us == Color::White) ? static_cast<int>(Square::H1) : static_cast<int>(Square::H8);
-            remove_piece(us, PieceType::Rook, rook_from);
-            place_piece(us, PieceType::Rook, rook_to);
-        } else {
-            int rook_from = (us == Color::White) ? static_cast<int>(Square::D1) : static_cast<int>(Square::D8);
-            int rook_to = (us == Color::White) ? static_cast<int>(Square::A1) : static_cast<int>(Square::A8);
-            remove_piece(us, PieceType::Rook, rook_from);
-            place_piece(us, PieceType::Rook, rook_to);
-        }
+        bool king_side = (move.flags & MoveFlag::KingCastle) != 0;
+        remove_piece(Us, PieceType::Rook, king_side ? Squares::kKingRookTo : Squares::kQueenRookTo);
+        place_piece(Us, PieceType::Rook, king_side ? Squares::kKingRookFrom : Squares::kQueenRookFrom);
     }
 
     if (state.captured_piece != PieceType::None) {
         if (move.is_en_passant()) {
-            int cap_sq = move.to + (us == Color::White ? -8 : 8);
-            place_piece(them, PieceType::Pawn, cap_sq);
+            place_piece(kThem, PieceType::Pawn, move.to - kPush);
         } else {
-            place_piece(them, state.captured_piece, move.to);
+            place_piece(kThem, state.captured_piece, move.to);
         }
     }
 
@@ -366,6 +674,8 @@ void Board::undo_move(const Move& move, const State& state) {
     halfmove_clock_ = state.halfmove_clock;
     zobrist_key_ = state.zobrist_key;
     fullmove_number_ = state.fullmove_number;
+    checkers_ = state.checkers;
+    pinned_ = state.pinned;
 }
 
 void Board::make_null_move(State& out_state) {
@@ -375,6 +685,8 @@ void Board::make_null_move(State& out_state) {
     out_state.zobrist_key = zobrist_key_;
     out_state.captured_piece = PieceType::None;
     out_state.fullmove_number = fullmove_number_;
+    out_state.checkers = checkers_;
+    out_state.pinned = pinned_;
 
     if (en_passant_square_ != -1) {
         zobrist_key_ ^= Zobrist::en_passant_key(file_of(static_cast<Square>(en_passant_square_)));
@@ -390,6 +702,7 @@ void Board::make_null_move(State& out_state) {
     }
 
     ++halfmove_clock_;
+    update_check_info();
 }
 
 void Board::undo_null_move(const State& state) {
@@ -399,78 +712,63 @@ void Board::undo_null_move(const State& state) {
     halfmove_clock_ = state.halfmove_clock;
     zobrist_key_ = state.zobrist_key;
     fullmove_number_ = state.fullmove_number;
+    checkers_ = state.checkers;
+    pinned_ = state.pinned;
 }
 
-std::string Board::fen() const {
-    std::ostringstream oss;
+std::size_t Board::write_fen(char* out) const {
+    static constexpr char kPieceChars[] = "PNBRQKpnbrqk";
+    char* cursor = out;
     for (int rank = 7; rank >= 0; --rank) {
         int empty_count = 0;
         for (int file = 0; file < 8; ++file) {
-            int sq = rank * 8 + file;
-            PieceType type = piece_type_at(sq);
-            if (type == PieceType::None) {
+            std::uint8_t code = mailbox_[rank * 8 + file];
+            if (code == kEmptySquare) {
                 ++empty_count;
-            } else {
-                if (empty_count > 0) {
-                    oss << empty_count;
-                    empty_count = 0;
-                }
-                auto color = color_at(sq);
-                char piece_char = '1';
-                switch (type) {
-                    case PieceType::Pawn:
-                        piece_char = 'p';
-                        break;
-                    case PieceType::Knight:
-                        piece_char = 'n';
-                        break;
-                    case PieceType::Bishop:
-                        piece_char = 'b';
-                        break;
-                    case PieceType::Rook:
-                        piece_char = 'r';
-                        break;
-                    case PieceType::Queen:
-                        piece_char = 'q';
-                        break;
-                    case PieceType::King:
-                        piece_char = 'k';
-                        break;
-                    default:
-                        break;
-                }
-                if (color && *color == Color::White) {
-                    piece_char = std::toupper(piece_char);
-                }
-                oss << piece_char;
+                continue;
+            }
+            if (empty_count > 0) {
+                *cursor++ = static_cast<char>('0' + empty_count);
+                empty_count = 0;
             }
+            *cursor++ = kPieceChars[code];
         }
         if (empty_count > 0) {
-            oss << empty_count;
+            *cursor++ = static_cast<char>('0' + empty_count);
         }
         if (rank > 0) {
-            oss << '/';
+            *cursor++ = '/';
         }
     }
 
-    oss << ' ' << (side_to_move_ == Color::White ? 'w' : 'b') << ' ';
-
-    std::string castling_str;
-    if (castling_rights_ & kWhiteKingCastle) castling_str += 'K';
-    if (castling_rights_ & kWhiteQueenCastle) castling_str += 'Q';
-    if (castling_rights_ & kBlackKingCastle) castling_str += 'k';
-    if (castling_rights_ & kBlackQueenCastle) castling_str += 'q';
-    if (castling_str.empty()) castling_str = "-";
-    oss << castling_str << ' ';
+    *cursor++ = ' ';
+    *cursor++ = side_to_move_ == Color::White ? 'w' : 'b';
+    *cursor++ = ' ';
+    char* castling = cursor;
+    if (castling_rights_ & kWhiteKingCastle) *cursor++ = 'K';
+    if (castling_rights_ & kWhiteQueenCastle) *cursor++ = 'Q';
+    if (castling_rights_ & kBlackKingCastle) *cursor++ = 'k';
+    if (castling_rights_ & kBlackQueenCastle) *cursor++ = 'q';
+    if (cursor == castling) *cursor++ = '-';
+    *cursor++ = ' ';
 
     if (en_passant_square_ != -1) {
-        oss << square_to_string(static_cast<Square>(en_passant_square_));
+        *cursor++ = static_cast<char>('a' + en_passant_square_ % 8);
+        *cursor++ = static_cast<char>('1' + en_passant_square_ / 8);
     } else {
-        oss << '-';
+        *cursor++ = '-';
     }
 
-    oss << ' ' << halfmove_clock_ << ' ' << fullmove_number_;
-    return oss.str();
+    *cursor++ = ' ';
+    cursor = std::to_chars(cursor, out + kMaxFenLength, halfmove_clock_).ptr;
+    *cursor++ = ' ';
+    cursor = std::to_chars(cursor, out + kMaxFenLength, fullmove_number_).ptr;
+    return static_cast<std::size_t>(cursor - out);
+}
+
+std::string Board::fen() const {
+    std::array<char, kMaxFenLength> buffer;
+    return std::string(buffer.data(), write_fen(buffer.data()));
 }
 
 }  // namespace chiron
@@ -1,9 +1,11 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "bitboard.h"
@@ -19,8 +21,11 @@ constexpr inline std::uint8_t kBlackQueenCastle = 1 << 3;
 
 /**
  * @brief Represents the full state of a chess board including meta information.
+ *
+ * Cache-line aligned and kept within four lines, so a copy is cheap enough for copy-make
+ * (see BoardStack) as well as make/undo.
  */
-class Board {
+class alignas(64) Board {
    public:
     struct State {
         std::uint8_t castling_rights = 0;
@@ -29,12 +34,27 @@ class Board {
         std::uint64_t zobrist_key = 0ULL;
         PieceType captured_piece = PieceType::None;
         int fullmove_number = 1;
+        Bitboard checkers = 0ULL;
+        Bitboard pinned = 0ULL;
     };
 
     Board();
 
     void set_start_position();
-    void set_from_fen(const std::string& fen);
+    /**
+     * @brief Sets up the position described by @p fen without allocating. The placement must
+     *        hold eight ranks of eight squares and every field must be well formed; the move
+     *        counters may be missing. Throws std::runtime_error otherwise.
+     */
+    void set_from_fen(std::string_view fen);
+
+    /**
+     * @brief Sets up a position from per-square piece codes (encode_piece(), or kEmptySquare)
+     *        without going through FEN text; binary training data is loaded this way.
+     */
+    void set_from_placement(const std::array<std::uint8_t, kBoardSize>& squares, Color side_to_move,
+                            std::uint8_t castling_rights, int en_passant_square, int halfmove_clock,
+                            int fullmove_number);
 
     [[nodiscard]] Bitboard pieces(Color color, PieceType type) const {
         return pieces_[static_cast<int>(color)][static_cast<int>(type)];
@@ -53,23 +73,85 @@ class Board {
     [[nodiscard]] int fullmove_number() const { return fullmove_number_; }
     [[nodiscard]] std::uint64_t zobrist_key() const { return zobrist_key_; }
 
+    /**
+     * @brief Zobrist key of the pawns alone, updated incrementally alongside zobrist_key().
+     */
+    [[nodiscard]] std::uint64_t pawn_key() const { return pawn_key_; }
+
     [[nodiscard]] PieceType piece_type_at(int square) const;
     [[nodiscard]] std::optional<Color> color_at(int square) const;
 
     bool is_square_attacked(Square sq, Color by) const;
     bool in_check(Color color) const;
 
+    /**
+     * @brief Returns the pieces of both colors attacking @p square given an occupancy.
+     */
+    [[nodiscard]] Bitboard attackers_to(int square, Bitboard occupied) const;
+
+    /**
+     * @brief Checks that @p move could be generated here, ignoring only whether it leaves
+     *        the own king in check.
+     *
+     * Validates a move from the TT or a killer slot with a few occupancy tests instead of
+     * generating the move list; the flags must match exactly what the generator emits.
+     */
+    [[nodiscard]] bool is_pseudo_legal(const Move& move) const;
+
+    /**
+     * @brief Checks that a pseudo-legal @p move does not leave the own king in check.
+     */
+    [[nodiscard]] bool is_legal(const Move& move) const;
+
+    /**
+     * @brief Static exchange evaluation: true when @p move gains at least @p threshold
+     *        centipawns once the exchange on its destination square is played out.
+     *
+     * Sliders behind each capturer join in as the line opens; pins and checks are ignored,
+     * which is the usual trade-off for move ordering and pruning.
+     */
+    [[nodiscard]] bool see_ge(const Move& move, int threshold = 0) const;
+
+    /**
+     * @brief Returns the king square for @p color, or -1 if the side has no king.
+     */
+    [[nodiscard]] int king_square(Color color) const { return king_squares_[static_cast<int>(color)]; }
+
+    /**
+     * @brief Enemy pieces giving check to the side to move; computed once per move.
+     */
+    [[nodiscard]] Bitboard checkers() const { return checkers_; }
+
+    /**
+     * @brief Pieces of the side to move pinned against their own king; computed once per move.
+     */
+    [[nodiscard]] Bitboard pinned() const { return pinned_; }
+
     void make_move(const Move& move, State& out_state);
     void undo_move(const Move& move, const State& state);
     void make_null_move(State& out_state);
     void undo_null_move(const State& state);
 
+    /** @brief Longest text write_fen() produces: every field at its widest, with 32-bit counters. */
+    static constexpr std::size_t kMaxFenLength = 128;
+
+    /**
+     * @brief Writes the position's FEN to @p out, which must hold kMaxFenLength characters, and
+     *        returns its length. Nothing is allocated and no terminator is written.
+     */
+    std::size_t write_fen(char* out) const;
     std::string fen() const;
 
    private:
     void clear();
     void place_piece(Color color, PieceType type, int square);
     void remove_piece(Color color, PieceType type, int square);
+    void update_check_info();
+    /** @brief make_move() and undo_move() for the side @p Us that moves, chosen once per call. */
+    template <Color Us>
+    void make_move(const Move& move, State& out_state);
+    template <Color Us>
+    void undo_move(const Move& move, const State& state);
 
     PieceType piece_from_char(char c) const;
 
@@ -84,8 +166,14 @@ class Board {
     int halfmove_clock_ = 0;
     int fullmove_number_ = 1;
     std::uint64_t zobrist_key_ = 0ULL;
+    std::uint64_t pawn_key_ = 0ULL;
+    std::array<int, kNumColors> king_squares_{-1, -1};
+    Bitboard checkers_ = 0ULL;  // Check and pin state for side_to_move_, saved in State.
+    Bitboard pinned_ = 0ULL;
 };
 
+static_assert(sizeof(Board) <= 256, "Board should stay within four cache lines for copy-make");
+
 constexpr inline std::uint8_t encode_piece(Color color, PieceType type) {
     return static_cast<std::uint8_t>(static_cast<int>(type) + static_cast<int>(color) * kNumPieceTypes);
 }
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "board.h"
+#include "move.h"
+
+namespace chiron {
+
+/**
+ * @brief Copy-make position stack: each ply is a fresh copy of its parent with one move played.
+ *
+ * The alternative to Board::make_move()/undo_move() for code that walks a line and comes back:
+ * push() copies the aligned top board forward and plays the move on the copy, pop() just
+ * steps back, so nothing has to be reconstructed on the way up. Storage is reserved once for
+ * a fixed number of plies; references to entries stay valid for the stack's lifetime.
+ */
+class BoardStack {
+   public:
+    static constexpr std::size_t kDefaultCapacity = 128;
+
+    explicit BoardStack(const Board& root, std::size_t capacity = kDefaultCapacity) : boards_(capacity + 1, root) {}
+
+    /** @brief Replaces the whole stack with @p root at ply zero. */
+    void reset(const Board& root) {
+        boards_[0] = root;
+        ply_ = 0;
+    }
+
+    [[nodiscard]] const Board& top() const { return boards_[ply_]; }
+    [[nodiscard]] const Board& root() const { return boards_[0]; }
+
+    /** @brief Number of moves pushed on top of the root. */
+    [[nodiscard]] std::size_t ply() const { return ply_; }
+    [[nodiscard]] std::size_t capacity() const { return boards_.size() - 1; }
+
+    const Board& push(const Move& move) {
+        Board& child = advance();
+        child.make_move(move, scratch_);
+        return child;
+    }
+
+    const Board& push_null() {
+        Board& child = advance();
+        child.make_null_move(scratch_);
+        return child;
+    }
+
+    void pop() { --ply_; }
+
+   private:
+    Board& advance() {
+        if (ply_ + 1 >= boards_.size()) {
+            throw std::length_error("BoardStack capacity exceeded");
+        }
+        Board& child = boards_[ply_ + 1];
+        child = boards_[ply_];
+        ++ply_;
+        return child;
+    }
+
+    std::vector<Board> boards_;
+    std::size_t ply_ = 0;
+    Board::State scratch_;  // Undo record the copy never needs.
+};
+
+}  // namespace chiron
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "move.h"
+
+namespace chiron {
+
+namespace nnue {
+class MappedFile;
+}
+
+/** @brief A book move with its weight; heavier moves are played proportionally more often. */
+struct BookMove {
+    Move move{};
+    int weight = 0;
+};
+
+/**
+ * @brief One 16-byte record of a Polyglot book file: position key, move, weight and a learn field
+ *        Chiron leaves at 0, each stored big-endian. Records are sorted by key.
+ *
+ * Keys are Polyglot's (OpeningBook::polyglot_key()) and moves are encoded as Polyglot does (to file,
+ * to rank, from file, from rank and promotion piece in three bits each; castling as the king taking
+ * its own rook), so standard books can be probed and books built here work with other tools.
+ */
+struct BookEntry {
+    std::uint64_t key = 0;
+    std::uint16_t move = 0;
+    std::uint16_t weight = 0;
+    std::uint32_t learn = 0;
+};
+
+/**
+ * @brief Read-only opening book, memory-mapped and probed by binary search.
+ *
+ * The mapping is shared, so one instance can serve any number of threads without locking.
+ */
+class OpeningBook {
+   public:
+    static constexpr std::size_t kEntryBytes = 16;
+
+    /** @brief Maps @p path; throws std::runtime_error when it is missing or not a whole number of records. */
+    explicit OpeningBook(const std::string& path);
+    ~OpeningBook();
+
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    [[nodiscard]] std::size_t entry_count() const { return entry_count_; }
+
+    /** @brief The legal book moves for @p board with a positive weight, heaviest first. */
+    [[nodiscard]] std::vector<BookMove> probe(const Board& board) const;
+
+    /**
+     * @brief Picks one of probe()'s moves with probability proportional to its weight, @p fraction
+     *        in [0, 1) selecting where in the summed weights the pick falls; nothing when out of book.
+     */
+    [[nodiscard]] std::optional<Move> pick(const Board& board, double fraction) const;
+
+    /** @brief Writes @p entries, sorted by key and then by falling weight, as a book file. */
+    static void write(const std::string& path, std::vector<BookEntry> entries);
+
+    /** @brief Polyglot's key for @p board, which differs from Board::zobrist_key(). */
+    [[nodiscard]] static std::uint64_t polyglot_key(const Board& board);
+
+    /** @brief Polyglot's encoding of @p move. */
+    [[nodiscard]] static std::uint16_t encode_move(const Move& move);
+
+   private:
+    [[nodiscard]] BookEntry entry(std::size_t index) const;
+
+    std::shared_ptr<const nnue::MappedFile> file_;
+    std::size_t entry_count_ = 0;
+};
+
+}  // namespace chiron
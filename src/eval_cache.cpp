@@ -0,0 +1,45 @@
+#include "eval_cache.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace chiron {
+
+namespace {
+
+// The low 16 bits of a slot hold the evaluation; the rest must match the key's upper bits.
+// The index covers at least the low 16 key bits, so together every key bit is verified.
+constexpr std::uint64_t kEvalMask = 0xFFFFULL;
+
+}  // namespace
+
+EvalCache::EvalCache(std::size_t entries) {
+    std::size_t size = std::bit_floor(std::max(entries, kMinEntries));
+    entries_.assign(size, 0);
+    mask_ = size - 1;
+}
+
+bool EvalCache::probe(std::uint64_t key, int& eval) const {
+    std::uint64_t slot = entries_[key & mask_];
+    if (((slot ^ key) & ~kEvalMask) != 0) {
+        return false;
+    }
+    eval = static_cast<int16_t>(static_cast<std::uint16_t>(slot & kEvalMask));
+    return true;
+}
+
+void EvalCache::store(std::uint64_t key, int eval) {
+    entries_[key & mask_] = (key & ~kEvalMask) | static_cast<std::uint16_t>(static_cast<int16_t>(eval));
+}
+
+void EvalCache::clear() { std::fill(entries_.begin(), entries_.end(), 0); }
+
+void EvalCache::sync(std::uint64_t generation) {
+    if (generation == generation_) {
+        return;
+    }
+    clear();
+    generation_ = generation;
+}
+
+}  // namespace chiron
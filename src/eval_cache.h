@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace chiron {
+
+/**
+ * @brief Small direct-mapped cache of static evaluations keyed by Zobrist hash.
+ *
+ * Each search thread owns one, so slots are plain 64-bit words: the key bits above the
+ * index share the word with the 16-bit evaluation and no locking or check word is needed.
+ * Positions revisited by transposition or by the next iteration skip the accumulator update
+ * and network pass entirely.
+ */
+class EvalCache {
+   public:
+    static constexpr std::size_t kMinEntries = 1ULL << 16;
+    static constexpr std::size_t kDefaultEntries = kMinEntries;
+
+    /** @brief Allocates max(@p entries, kMinEntries) slots rounded down to a power of two. */
+    explicit EvalCache(std::size_t entries = kDefaultEntries);
+
+    /**
+     * @brief Looks up the evaluation stored for @p key.
+     * @return True and fills @p eval when the slot holds this position.
+     */
+    bool probe(std::uint64_t key, int& eval) const;
+
+    /**
+     * @brief Records @p eval for @p key, replacing whatever occupied the slot.
+     */
+    void store(std::uint64_t key, int eval);
+
+    /**
+     * @brief Forgets every stored evaluation.
+     */
+    void clear();
+
+    /**
+     * @brief Clears the cache unless it was filled by network load @p generation.
+     */
+    void sync(std::uint64_t generation);
+
+    [[nodiscard]] std::size_t entry_count() const { return entries_.size(); }
+
+   private:
+    std::vector<std::uint64_t> entries_;
+    std::size_t mask_ = 0;
+    std::uint64_t generation_ = 0;
+};
+
+}  // namespace chiron
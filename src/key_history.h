@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace chiron {
+
+/**
+ * @brief Fixed-capacity ring of Zobrist keys for the positions leading to the current one.
+ *
+ * Holds the game history handed over by the GUI followed by the search path. Repetition
+ * checks only look back as far as the last irreversible move (the halfmove clock) and only
+ * at positions with the same side to move, so a probe touches at most fifty keys, and
+ * pushing or popping never allocates. Older keys are overwritten once the ring wraps; they
+ * lie behind an irreversible move by then and can no longer repeat.
+ */
+class KeyHistory {
+   public:
+    static constexpr std::size_t kCapacity = 1024;
+
+    void clear() { size_ = 0; }
+
+    void push(std::uint64_t key) { keys_[size_++ & kMask] = key; }
+
+    void pop() { --size_; }
+
+    /**
+     * @brief Drops every key pushed after the history held @p size entries.
+     */
+    void truncate(std::size_t size) { size_ = std::min(size_, size); }
+
+    /** @brief Number of keys pushed since the last clear(), including overwritten ones. */
+    [[nodiscard]] std::size_t size() const { return size_; }
+
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    /**
+     * @brief Counts earlier occurrences of the most recently pushed key.
+     *
+     * @p halfmove_clock bounds the scan: no position before the last capture or pawn move can
+     * recur. The scan starts four plies back, the shortest possible cycle.
+     */
+    [[nodiscard]] int repetitions(int halfmove_clock) const {
+        if (size_ == 0) {
+            return 0;
+        }
+        const std::size_t current = size_ - 1;
+        const std::uint64_t key = keys_[current & kMask];
+        const std::size_t clock = static_cast<std::size_t>(std::max(halfmove_clock, 0));
+        const std::size_t reach = std::min({clock, current, kCapacity - 1});
+        int count = 0;
+        for (std::size_t back = 4; back <= reach; back += 2) {
+            if (keys_[(current - back) & kMask] == key) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+   private:
+    static constexpr std::size_t kMask = kCapacity - 1;
+    static_assert((kCapacity & kMask) == 0, "KeyHistory capacity must be a power of two");
+
+    std::array<std::uint64_t, kCapacity> keys_{};
+    std::size_t size_ = 0;
+};
+
+}  // namespace chiron
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cmath>
 #include <exception>
 #include <filesystem>
@@ -9,16 +10,22 @@
 #include <iomanip>
 #include <iostream>
 #include <limits>
+#include <optional>
 #include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "bench.h"
 #include "evaluation.h"
+#include "nnue/quantized.h"
 #include "perft.h"
+#include "trace.h"
 #include "tools/teacher.h"
 #include "tools/tuning.h"
+#include "training/data_loader.h"
+#include "training/distributed.h"
 #include "training/pgn_importer.h"
 #include "training/learning_regimen.h"
 #include "training/selfplay.h"
@@ -28,16 +35,20 @@
 namespace {
 
 using chiron::Board;
+using chiron::FeatureBatch;
 using chiron::ParameterSet;
 using chiron::PgnImporter;
 using chiron::TeacherEngine;
 using chiron::Trainer;
 using chiron::TrainerDevice;
+using chiron::TrainingDataLoader;
 using chiron::TrainingExample;
+using chiron::convert_training_file;
 using chiron::DatasetEvaluationResult;
 using chiron::evaluate_dataset_performance;
 using chiron::load_training_file;
 using chiron::perft;
+using chiron::perft_copy_make;
 using chiron::save_training_file;
 using chiron::nnue::kDefaultHiddenSize;
 
@@ -76,6 +87,18 @@ std::size_t parse_size(const std::vector<std::string>& args, std::size_t& index,
     }
 }
 
+std::uint16_t parse_port_value(const std::string& value, const std::string& option) {
+    int port = -1;
+    try {
+        port = std::stoi(value);
+    } catch (const std::exception&) {
+    }
+    if (port < 0 || port > 65535) {
+        throw std::invalid_argument("Invalid port for " + option);
+    }
+    return static_cast<std::uint16_t>(port);
+}
+
 std::uint64_t parse_size_literal(const std::string& value) {
     if (value.empty()) {
         throw std::invalid_argument("Empty numeric literal");
@@ -138,29 +161,168 @@ TrainerDevice parse_trainer_device_option(const std::string& value) {
     throw std::invalid_argument("Unknown training device: " + value);
 }
 
+/**
+ * @brief Parses the optimiser flags shared by every training command; false for any other option.
+ */
+bool parse_optimizer_option(const std::vector<std::string>& args, std::size_t& index, chiron::OptimizerConfig& config) {
+    const std::string& opt = args[index];
+    if (opt == "--optimizer") {
+        if (index + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+        config.kind = chiron::parse_optimizer_kind(args[++index]);
+    } else if (opt == "--lr-schedule") {
+        if (index + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+        config.schedule = chiron::parse_learning_rate_schedule(args[++index]);
+    } else if (opt == "--warmup-steps") {
+        config.warmup_steps = parse_size(args, index, opt);
+    } else if (opt == "--decay-steps") {
+        config.decay_steps = parse_size(args, index, opt);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Adam steps are in weight units, so an SGD-sized default rate would barely move them.
+ */
+double default_learning_rate(const std::vector<std::string>& args, const std::string& rate_option,
+                             const chiron::OptimizerConfig& optimizer, double rate) {
+    if (optimizer.kind == chiron::OptimizerKind::kSgd || std::find(args.begin(), args.end(), rate_option) != args.end()) {
+        return rate;
+    }
+    return chiron::kDefaultAdamLearningRate;
+}
+
 int run_perft(const std::vector<std::string>& args) {
     Board board;
     board.set_start_position();
-    int depth = 1;
+    chiron::PerftConfig config;
+    bool copy_make = false;
+    bool divide = false;
     for (std::size_t i = 1; i < args.size(); ++i) {
         const std::string& opt = args[i];
         if (opt == "--depth") {
-            depth = parse_int(args, i, opt);
+            config.depth = parse_int(args, i, opt);
+        } else if (opt == "--copy-make") {
+            copy_make = true;
+        } else if (opt == "--divide") {
+            divide = true;
+        } else if (opt == "--threads") {
+            config.threads = parse_int(args, i, opt);
+        } else if (opt == "--hash") {
+            int megabytes = parse_int(args, i, opt);
+            if (megabytes < 0) throw std::invalid_argument("--hash must not be negative");
+            config.hash_mb = static_cast<std::size_t>(megabytes);
         } else if (opt == "--fen") {
             if (i + 1 >= args.size()) throw std::invalid_argument("--fen requires a value");
             board.set_from_fen(args[++i]);
         }
     }
-    if (depth <= 0) {
+    if (config.depth <= 0) {
         throw std::invalid_argument("perft depth must be positive");
     }
-    std::uint64_t nodes = perft(board, depth);
-    std::cout << "Perft(" << depth << ") = " << nodes << std::endl;
+    if (config.threads <= 0) {
+        throw std::invalid_argument("--threads must be positive");
+    }
+
+    std::uint64_t nodes = 0;
+    std::chrono::milliseconds elapsed{0};
+    std::string mode = "make/undo";
+    if (copy_make) {
+        mode = "copy-make";
+        auto start = std::chrono::steady_clock::now();
+        nodes = perft_copy_make(board, config.depth);
+        elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    } else {
+        chiron::PerftResult result = chiron::perft_divide(board, config);
+        if (divide) {
+            for (const chiron::PerftDivideEntry& entry : result.divide) {
+                std::cout << chiron::move_to_string(entry.move) << ": " << entry.nodes << '\n';
+            }
+            std::cout << '\n';
+        }
+        nodes = result.nodes;
+        elapsed = result.elapsed;
+        mode += ", " + std::to_string(config.threads) + (config.threads == 1 ? " thread" : " threads");
+        if (config.hash_mb > 0) {
+            mode += ", " + std::to_string(config.hash_mb) + " MB hash";
+        }
+    }
+    auto ms = static_cast<std::uint64_t>(std::max<std::chrono::milliseconds::rep>(elapsed.count(), 1));
+    std::cout << "Perft(" << config.depth << ") = " << nodes << std::endl;
+    std::cout << "Time: " << elapsed.count() << " ms (" << mode << ")" << std::endl;
+    std::cout << "NPS: " << nodes * 1000 / ms << std::endl;
+    return 0;
+}
+
+double percentage(std::uint64_t part, std::uint64_t whole) {
+    return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+}
+
+int run_uci(const std::vector<std::string>& args) {
+    chiron::UCI uci;
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        const std::string& opt = args[i];
+        if (opt == "--hash-file") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--hash-file requires a value");
+            uci.persist_hash(args[++i]);
+        } else if (opt == "--analysis-cache") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--analysis-cache requires a value");
+            uci.persist_analysis_cache(args[++i]);
+        } else {
+            throw std::invalid_argument("Unknown uci option: " + opt);
+        }
+    }
+    uci.loop();
+    return 0;
+}
+
+int run_bench(const std::vector<std::string>& args) {
+    chiron::BenchConfig config;
+    std::size_t index = 0;
+    if (args.size() > 1) config.depth = parse_int(args, index, "bench depth");
+    if (args.size() > 2) config.threads = parse_int(args, index, "bench threads");
+    if (args.size() > 3) config.hash_mb = parse_size(args, index, "bench hash");
+    if (args.size() > 4) throw std::invalid_argument("Usage: bench [depth] [threads] [hash MB]");
+    if (config.depth <= 0 || config.threads <= 0 || config.hash_mb == 0) {
+        throw std::invalid_argument("bench depth, threads and hash must be positive");
+    }
+
+    std::size_t total = chiron::bench_positions().size();
+    chiron::BenchResult bench = chiron::run_bench(config, [&](std::size_t position, const chiron::SearchResult& result) {
+        std::cout << "Position " << (position + 1) << '/' << total << ": " << chiron::move_to_string(result.best_move)
+                  << " score " << result.score << " depth " << result.depth << " nodes " << result.nodes << " time "
+                  << result.elapsed.count() << " ms" << std::endl;
+    });
+
+    std::cout << "===========================" << std::endl;
+    std::cout << "Total time (ms) : " << bench.elapsed.count() << std::endl;
+    std::cout << "Nodes searched  : " << bench.nodes << std::endl;
+    std::cout << "Nodes/second    : " << bench.nodes_per_second() << std::endl;
+    if (config.threads == 1) {
+        std::cout << "Signature       : " << bench.nodes << std::endl;
+    }
+    if (chiron::kSearchStatsEnabled) {
+        const chiron::SearchStats& stats = bench.stats;
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "TT hit rate     : " << percentage(stats.tt_hits, stats.tt_probes) << '%' << std::endl;
+        std::cout << "First-move cuts : " << percentage(stats.first_move_fail_highs, stats.fail_highs) << '%'
+                  << std::endl;
+        std::cout << "QSearch nodes   : " << percentage(stats.qsearch_nodes, bench.nodes) << '%' << std::endl;
+        std::cout << "Null-move cuts  : " << percentage(stats.null_move_cutoffs, stats.null_move_tries) << "% of "
+                  << stats.null_move_tries << std::endl;
+        std::cout << "LMR holds       : " << percentage(stats.lmr_searches - stats.lmr_re_searches, stats.lmr_searches)
+                  << "% of " << stats.lmr_searches << std::endl;
+        std::cout << "Evaluations     : " << stats.evaluations << " (" << percentage(stats.evaluations, bench.nodes)
+                  << "% of nodes)" << std::endl;
+    }
     return 0;
 }
 
 int run_selfplay(const std::vector<std::string>& args) {
     chiron::SelfPlayConfig config;
+    std::optional<chiron::CoordinatorConfig> coordinator;
+    bool depth_given = false;
     config.white.name = "Chiron";
     config.black.name = "Chiron";
 
@@ -169,12 +331,23 @@ int run_selfplay(const std::vector<std::string>& args) {
         if (opt == "--games") {
             config.games = std::max(1, parse_int(args, i, opt));
         } else if (opt == "--depth") {
+            depth_given = true;
             int depth = parse_int(args, i, opt);
             config.white.max_depth = depth;
             config.black.max_depth = depth;
+        } else if (opt == "--nodes") {
+            std::uint64_t nodes = parse_size(args, i, opt);
+            config.white.soft_nodes = nodes;
+            config.black.soft_nodes = nodes;
+        } else if (opt == "--hard-nodes") {
+            std::uint64_t nodes = parse_size(args, i, opt);
+            config.white.hard_nodes = nodes;
+            config.black.hard_nodes = nodes;
         } else if (opt == "--white-depth") {
+            depth_given = true;
             config.white.max_depth = parse_int(args, i, opt);
         } else if (opt == "--black-depth") {
+            depth_given = true;
             config.black.max_depth = parse_int(args, i, opt);
         } else if (opt == "--white-name") {
             if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
@@ -246,6 +419,9 @@ int run_selfplay(const std::vector<std::string>& args) {
         } else if (opt == "--training-device") {
             if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
             config.training_device = parse_trainer_device_option(args[++i]);
+        } else if (opt == "--train-threads") {
+            config.training_threads = parse_size(args, i, opt);
+        } else if (parse_optimizer_option(args, i, config.training_optimizer)) {
         } else if (opt == "--training-output") {
             if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
             config.training_output_path = args[++i];
@@ -254,6 +430,17 @@ int run_selfplay(const std::vector<std::string>& args) {
             config.training_history_dir = args[++i];
         } else if (opt == "--training-hidden") {
             config.training_hidden_size = parse_size(args, i, opt);
+        } else if (opt == "--training-features") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            config.training_features = chiron::nnue::parse_feature_set(args[++i]);
+        } else if (opt == "--training-min-ply") {
+            config.training_filter.min_ply = parse_int(args, i, opt);
+        } else if (opt == "--training-skip-check") {
+            config.training_filter.skip_in_check = true;
+        } else if (opt == "--training-sample-rate") {
+            config.training_filter.sample_rate = parse_double(args, i, opt);
+        } else if (opt == "--training-dedupe") {
+            config.training_filter.dedupe_slots = parse_size(args, i, opt);
         } else if (opt == "--randomness-temperature") {
             config.randomness_temperature = parse_double(args, i, opt);
         } else if (opt == "--randomness-top-moves") {
@@ -262,16 +449,99 @@ int run_selfplay(const std::vector<std::string>& args) {
             config.randomness_score_margin = parse_int(args, i, opt);
         } else if (opt == "--randomness-max-ply") {
             config.randomness_max_ply = parse_int(args, i, opt);
+        } else if (opt == "--openings") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            config.openings_path = args[++i];
+        } else if (opt == "--opening-plies") {
+            config.opening_max_plies = parse_int(args, i, opt);
+        } else if (opt == "--syzygy") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            config.syzygy_path = args[++i];
+        } else if (opt == "--book") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            config.book_path = args[++i];
+        } else if (opt == "--listen") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            std::string address = args[++i];
+            if (!coordinator) coordinator.emplace();
+            auto colon = address.rfind(':');
+            if (colon != std::string::npos) {
+                coordinator->host = address.substr(0, colon);
+                if (coordinator->host.size() > 2 && coordinator->host.front() == '[' &&
+                    coordinator->host.back() == ']') {
+                    coordinator->host = coordinator->host.substr(1, coordinator->host.size() - 2);  // [::]:9000
+                }
+                address = address.substr(colon + 1);
+            }
+            coordinator->port = parse_port_value(address, opt);
+        } else if (opt == "--worker-timeout") {
+            if (!coordinator) coordinator.emplace();
+            coordinator->worker_timeout = std::chrono::seconds(std::max(0, parse_int(args, i, opt)));
         } else {
             throw std::invalid_argument("Unknown selfplay option: " + opt);
         }
     }
+    config.training_learning_rate =
+        default_learning_rate(args, "--training-rate", config.training_optimizer, config.training_learning_rate);
+    for (chiron::EngineConfig* engine : {&config.white, &config.black}) {
+        if (!depth_given && (engine->soft_nodes > 0 || engine->hard_nodes > 0)) {
+            engine->max_depth = chiron::SearchLimits{}.max_depth;  // Node budgets alone bound the search.
+        }
+    }
+    config.record_moves = config.capture_results || config.capture_pgn;
 
     chiron::SelfPlayOrchestrator orchestrator(config);
+    if (coordinator) {
+        coordinator->on_listening = [host = coordinator->host](std::uint16_t port) {
+            std::cout << "Coordinator listening on " << host << " port " << port << std::endl;
+        };
+        chiron::run_coordinator(orchestrator, *coordinator);
+        return 0;
+    }
     orchestrator.run();
     return 0;
 }
 
+int run_worker_command(const std::vector<std::string>& args) {
+    chiron::WorkerConfig config;
+    bool have_coordinator = false;
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        const std::string& opt = args[i];
+        if (opt == "--connect") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            std::string address = args[++i];
+            auto colon = address.rfind(':');
+            if (colon == std::string::npos || colon == 0) {
+                throw std::invalid_argument("--connect expects host:port");
+            }
+            config.host = address.substr(0, colon);
+            if (config.host.size() > 2 && config.host.front() == '[' && config.host.back() == ']') {
+                config.host = config.host.substr(1, config.host.size() - 2);  // [::1]:9000
+            }
+            config.port = parse_port_value(address.substr(colon + 1), opt);
+            have_coordinator = true;
+        } else if (opt == "--concurrency") {
+            config.concurrency = std::max(1, parse_int(args, i, opt));
+        } else if (opt == "--cache-dir") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            config.cache_dir = args[++i];
+        } else if (opt == "--verboselite") {
+            config.verbose_lite = true;
+        } else if (opt == "--syzygy") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            config.syzygy_path = args[++i];
+        } else {
+            throw std::invalid_argument("Unknown worker option: " + opt);
+        }
+    }
+    if (!have_coordinator) {
+        throw std::invalid_argument("worker requires --connect host:port");
+    }
+    std::size_t played = chiron::run_worker(config);
+    std::cout << "Worker finished after " << played << " game(s)" << std::endl;
+    return 0;
+}
+
 int run_sprt(const std::vector<std::string>& args) {
     chiron::SelfPlayConfig match_config;
     match_config.games = 1;
@@ -298,8 +568,16 @@ int run_sprt(const std::vector<std::string>& args) {
             sprt.elo0 = parse_double(args, i, opt);
         } else if (opt == "--elo1") {
             sprt.elo1 = parse_double(args, i, opt);
-        } else if (opt == "--draw") {
-            sprt.draw_ratio = parse_double(args, i, opt);
+        } else if (opt == "--concurrency") {
+            sprt.concurrency = std::max(1, parse_int(args, i, opt));
+        } else if (opt == "--openings") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            match_config.openings_path = args[++i];
+        } else if (opt == "--opening-plies") {
+            match_config.opening_max_plies = parse_int(args, i, opt);
+        } else if (opt == "--book") {
+            if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
+            match_config.book_path = args[++i];
         } else if (opt == "--results") {
             if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
             sprt.results_path = args[++i];
@@ -334,6 +612,10 @@ int run_sprt(const std::vector<std::string>& args) {
             std::size_t size = parse_size(args, i, opt);
             baseline.table_size = size;
             candidate.table_size = size;
+        } else if (opt == "--baseline-continuation-history") {
+            baseline.continuation_history = true;
+        } else if (opt == "--candidate-continuation-history") {
+            candidate.continuation_history = true;
         } else {
             throw std::invalid_argument("Unknown sprt option: " + opt);
         }
@@ -345,6 +627,11 @@ int run_sprt(const std::vector<std::string>& args) {
     std::cout << "SPRT conclusion: " << summary.conclusion << "\n";
     std::cout << "Games: " << summary.games_played << ", candidate wins: " << summary.candidate_wins
               << ", baseline wins: " << summary.baseline_wins << ", draws: " << summary.draws << "\n";
+    std::cout << "Pairs (0/0.5/1/1.5/2 points):";
+    for (int count : summary.pentanomial) {
+        std::cout << ' ' << count;
+    }
+    std::cout << "\n";
     std::cout << "LLR: " << summary.llr << "\n";
     if (summary.elo) {
         std::cout << "Estimated Elo: " << std::fixed << std::setprecision(2) << *summary.elo;
@@ -428,6 +715,10 @@ int run_learn_command(const std::vector<std::string>& args) {
             config.teacher_depth = std::max(1, parse_int(args, i, opt));
         } else if (opt == "--teacher-threads") {
             config.teacher_threads = std::max(1, parse_int(args, i, opt));
+        } else if (opt == "--teacher-processes") {
+            config.teacher_processes = std::max(1, parse_int(args, i, opt));
+        } else if (opt == "--teacher-pipeline") {
+            config.teacher_pipeline = std::max(1, parse_int(args, i, opt));
         } else if (opt == "--online-dir") {
             if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
             config.online_database_dir = args[++i];
@@ -448,8 +739,21 @@ int run_learn_command(const std::vector<std::string>& args) {
         } else if (opt == "--device") {
             if (i + 1 >= args.size()) throw std::invalid_argument(opt + " requires a value");
             config.training_device = parse_trainer_device_option(args[++i]);
+        } else if (opt == "--train-threads") {
+            config.training_threads = parse_size(args, i, opt);
+        } else if (parse_optimizer_option(args, i, config.optimizer)) {
         } else if (opt == "--holdout") {
             config.holdout_samples = parse_size(args, i, opt);
+        } else if (opt == "--min-ply") {
+            config.position_filter.min_ply = parse_int(args, i, opt);
+        } else if (opt == "--skip-check") {
+            config.position_filter.skip_in_check = true;
+        } else if (opt == "--keep-check") {
+            config.position_filter.skip_in_check = false;
+        } else if (opt == "--sample-rate") {
+            config.position_filter.sample_rate = parse_double(args, i, opt);
+        } else if (opt == "--dedupe") {
+            config.position_filter.dedupe_slots = parse_size(args, i, opt);
         } else if (opt == "--include-draws") {
             config.include_draws = true;
         } else if (opt == "--no-draws") {
@@ -458,6 +762,7 @@ int run_learn_command(const std::vector<std::string>& args) {
             throw std::invalid_argument("Unknown learn option: " + opt);
         }
     }
+    config.learning_rate = default_learning_rate(args, "--learning-rate", config.optimizer, config.learning_rate);
 
     if (config.iterations <= 0) {
         throw std::invalid_argument("learn iterations must be positive");
@@ -474,9 +779,15 @@ int run_train_command(const std::vector<std::string>& args) {
     double learning_rate = 0.05;
     std::size_t batch_size = 256;
     std::size_t hidden_size = kDefaultHiddenSize;
+    chiron::nnue::FeatureSet features = chiron::nnue::FeatureSet::PieceSquare;
     int iterations = 1;
     bool shuffle = false;
+    std::optional<std::size_t> shuffle_buffer;
+    std::size_t loader_threads = 1;
+    std::size_t prefetch = 2;
     TrainerDevice trainer_device = TrainerDevice::kCPU;
+    std::size_t train_threads = 1;
+    chiron::OptimizerConfig optimizer;
 
     for (std::size_t i = 1; i < args.size(); ++i) {
         const std::string& opt = args[i];
@@ -494,13 +805,26 @@ int run_train_command(const std::vector<std::string>& args) {
             iterations = parse_int(args, i, opt);
         } else if (opt == "--shuffle") {
             shuffle = true;
+        } else if (opt == "--shuffle-buffer") {
+            shuffle_buffer = parse_size(args, i, opt);
+        } else if (opt == "--loader-threads") {
+            loader_threads = parse_size(args, i, opt);
+        } else if (opt == "--prefetch") {
+            prefetch = parse_size(args, i, opt);
         } else if (opt == "--hidden") {
             hidden_size = parse_size(args, i, opt);
+        } else if (opt == "--features") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--features requires a value");
+            features = chiron::nnue::parse_feature_set(args[++i]);
         } else if (opt == "--device") {
             if (i + 1 >= args.size()) throw std::invalid_argument("--device requires a value");
             trainer_device = parse_trainer_device_option(args[++i]);
+        } else if (opt == "--train-threads") {
+            train_threads = parse_size(args, i, opt);
+        } else if (parse_optimizer_option(args, i, optimizer)) {
         }
     }
+    learning_rate = default_learning_rate(args, "--rate", optimizer, learning_rate);
 
     if (input_path.empty()) {
         throw std::invalid_argument("train command requires --input dataset path");
@@ -511,17 +835,12 @@ int run_train_command(const std::vector<std::string>& args) {
         throw std::runtime_error("No training samples loaded from " + input_path);
     }
 
-    if (shuffle) {
-        std::mt19937 rng(static_cast<unsigned int>(std::random_device{}()));
-        std::shuffle(data.begin(), data.end(), rng);
-    }
-
-    ParameterSet parameters(hidden_size);
+    ParameterSet parameters(hidden_size, features);
     if (!output_path.empty() && std::filesystem::exists(output_path)) {
         parameters.load(output_path);
     }
 
-    Trainer trainer(Trainer::Config{learning_rate, 0.0005, trainer_device});
+    Trainer trainer(Trainer::Config{learning_rate, 0.0005, trainer_device, train_threads, optimizer});
 
     auto log_dataset_eval = [](const std::string& prefix, const DatasetEvaluationResult& eval) {
         if (eval.samples == 0) {
@@ -539,11 +858,20 @@ int run_train_command(const std::vector<std::string>& args) {
     DatasetEvaluationResult baseline = evaluate_dataset_performance(data, parameters, trainer, kEvaluationSamples);
     log_dataset_eval("[Train] Baseline pseudo-Elo ", baseline);
 
+    // --shuffle alone shuffles the whole dataset; the loader reshuffles it every iteration.
+    TrainingDataLoader::Config loader_config;
+    loader_config.batch_size = batch_size;
+    loader_config.shuffle_buffer = shuffle_buffer.value_or(shuffle ? data.size() : 0);
+    loader_config.threads = loader_threads;
+    loader_config.prefetch = prefetch;
+    loader_config.epochs = static_cast<std::size_t>(std::max(iterations, 0));
+    loader_config.seed = std::random_device{}();
+    loader_config.features = parameters.feature_set();
+    TrainingDataLoader loader(data, loader_config);
+    FeatureBatch batch;
+
     for (int iteration = 0; iteration < iterations; ++iteration) {
-        for (std::size_t offset = 0; offset < data.size(); offset += batch_size) {
-            std::size_t end = std::min(offset + batch_size, data.size());
-            std::vector<TrainingExample> batch(data.begin() + static_cast<std::ptrdiff_t>(offset),
-                                              data.begin() + static_cast<std::ptrdiff_t>(end));
+        for (std::size_t step = 0; step < loader.batches_per_epoch() && loader.next(batch); ++step) {
             trainer.train_batch(batch, parameters);
         }
         DatasetEvaluationResult iteration_eval =
@@ -595,6 +923,10 @@ int run_train_teacher_command(const std::vector<std::string>& args) {
             config.teacher.depth = parse_int(args, i, opt);
         } else if (opt == "--teacher-threads" || opt == "--threads") {
             config.teacher.threads = parse_int(args, i, opt);
+        } else if (opt == "--teacher-processes") {
+            config.teacher.processes = std::max(1, parse_int(args, i, opt));
+        } else if (opt == "--teacher-pipeline") {
+            config.teacher.pipeline = std::max(1, parse_int(args, i, opt));
         } else if (opt == "--games") {
             if (i + 1 >= args.size()) throw std::invalid_argument("--games requires a value");
             std::uint64_t count = parse_size_literal(args[++i]);
@@ -637,6 +969,9 @@ int run_train_teacher_command(const std::vector<std::string>& args) {
         } else if (opt == "--device") {
             if (i + 1 >= args.size()) throw std::invalid_argument("--device requires a value");
             config.training_device = parse_trainer_device_option(args[++i]);
+        } else if (opt == "--train-threads") {
+            config.training_threads = parse_size(args, i, opt);
+        } else if (parse_optimizer_option(args, i, config.training_optimizer)) {
         } else if (opt == "--max-ply") {
             config.max_ply = parse_int(args, i, opt);
         } else if (opt == "--seed") {
@@ -664,6 +999,8 @@ int run_train_teacher_command(const std::vector<std::string>& args) {
             throw std::invalid_argument("Unknown train-teacher option: " + opt);
         }
     }
+    config.training_learning_rate =
+        default_learning_rate(args, "--learning-rate", config.training_optimizer, config.training_learning_rate);
 
     if (!teacher_set || config.teacher.engine_path.empty()) {
         throw std::invalid_argument("train-teacher requires --teacher pointing to a Stockfish (or other UCI) binary");
@@ -680,10 +1017,143 @@ int run_train_teacher_command(const std::vector<std::string>& args) {
     return 0;
 }
 
+int run_convert_command(const std::vector<std::string>& args) {
+    std::string input_path;
+    std::string output_path;
+    bool text_output = false;
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        const std::string& opt = args[i];
+        if (opt == "--input") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--input requires a file path");
+            input_path = args[++i];
+        } else if (opt == "--output") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--output requires a file path");
+            output_path = args[++i];
+        } else if (opt == "--text") {
+            text_output = true;
+        }
+    }
+
+    if (input_path.empty() || output_path.empty()) {
+        throw std::invalid_argument("convert requires --input and --output file paths");
+    }
+
+    std::size_t written = convert_training_file(input_path, output_path, !text_output);
+    std::cout << "Converted " << written << " training samples to " << (text_output ? "text" : "packed")
+              << " format in " << output_path << std::endl;
+    return 0;
+}
+
+int run_book_command(const std::vector<std::string>& args) {
+    std::vector<std::string> inputs;
+    std::string output_path = "book.bin";
+    int max_plies = 16;
+    int min_games = 2;
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        const std::string& opt = args[i];
+        if (opt == "--input") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--input requires a file path");
+            inputs.push_back(args[++i]);
+        } else if (opt == "--output") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--output requires a file path");
+            output_path = args[++i];
+        } else if (opt == "--max-plies") {
+            max_plies = parse_int(args, i, opt);
+        } else if (opt == "--min-games") {
+            min_games = parse_int(args, i, opt);
+        } else {
+            throw std::invalid_argument("Unknown book option: " + opt);
+        }
+    }
+    if (inputs.empty()) {
+        throw std::invalid_argument("book requires at least one --input PGN or results log");
+    }
+
+    chiron::OpeningBookBuilder builder(max_plies);
+    for (const std::string& input : inputs) {
+        std::size_t games = builder.add_file(input);
+        std::cout << "Read " << games << " games from " << input << std::endl;
+    }
+    std::size_t entries = builder.write(output_path, min_games);
+    std::cout << "Wrote " << entries << " of " << builder.move_count() << " book moves from " << builder.games()
+              << " games to " << output_path << std::endl;
+    return 0;
+}
+
+int run_evaluate_command(const std::vector<std::string>& args) {
+    std::string input_path;
+    std::string output_path;
+    std::string network_path;
+    std::size_t threads = 0;
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        const std::string& opt = args[i];
+        if (opt == "--input") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--input requires a file path");
+            input_path = args[++i];
+        } else if (opt == "--output") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--output requires a file path");
+            output_path = args[++i];
+        } else if (opt == "--network") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--network requires a file path");
+            network_path = args[++i];
+        } else if (opt == "--threads") {
+            threads = parse_size(args, i, opt);
+        } else {
+            throw std::invalid_argument("Unknown evaluate option: " + opt);
+        }
+    }
+    if (input_path.empty()) {
+        throw std::invalid_argument("evaluate requires --input positions file");
+    }
+
+    // Packed datasets load as they are; text takes one FEN per line, with or without a "|score" suffix.
+    std::vector<TrainingExample> positions;
+    if (chiron::is_packed_training_file(input_path)) {
+        positions = load_training_file(input_path);
+    } else {
+        std::ifstream stream(input_path);
+        if (!stream) {
+            throw std::runtime_error("Failed to open positions file: " + input_path);
+        }
+        std::string line;
+        while (std::getline(stream, line)) {
+            std::string fen = line.substr(0, line.find('|'));
+            if (!fen.empty()) {
+                positions.push_back({fen, 0});
+            }
+        }
+    }
+
+    ParameterSet parameters;
+    if (!network_path.empty()) {
+        parameters.load(network_path);
+    }
+    Trainer::Config trainer_config;
+    trainer_config.threads = threads;
+    Trainer trainer(trainer_config);
+    std::vector<int> scores =
+        trainer.evaluate_examples(positions.data(), positions.data() + positions.size(), parameters);
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        positions[i].target_cp = scores[i];
+    }
+
+    if (output_path.empty()) {
+        for (const TrainingExample& position : positions) {
+            std::cout << chiron::example_fen(position) << '|' << position.target_cp << '\n';
+        }
+        std::cout.flush();
+    } else {
+        save_training_file(output_path, positions);
+        std::cout << "Evaluated " << positions.size() << " positions to " << output_path << std::endl;
+    }
+    return 0;
+}
+
 int run_import_pgn(const std::vector<std::string>& args) {
     std::string pgn_path;
     std::string output_path = "dataset.txt";
     bool include_draws = true;
+    std::size_t threads = 0;
     for (std::size_t i = 1; i < args.size(); ++i) {
         const std::string& opt = args[i];
         if (opt == "--pgn") {
@@ -694,6 +1164,8 @@ int run_import_pgn(const std::vector<std::string>& args) {
             output_path = args[++i];
         } else if (opt == "--no-draws") {
             include_draws = false;
+        } else if (opt == "--threads") {
+            threads = parse_size(args, i, opt);
         }
     }
 
@@ -701,10 +1173,40 @@ int run_import_pgn(const std::vector<std::string>& args) {
         throw std::invalid_argument("import-pgn requires --pgn input file");
     }
 
-    PgnImporter importer;
-    std::vector<TrainingExample> examples = importer.import_file(pgn_path, include_draws);
-    save_training_file(output_path, examples);
-    std::cout << "Wrote " << examples.size() << " training samples to " << output_path << std::endl;
+    PgnImporter importer(threads);
+    PgnImporter::Stats stats = importer.write_dataset(pgn_path, output_path, include_draws);
+    std::cout << "Wrote " << stats.positions << " training samples from " << stats.games << " games to "
+              << output_path << std::endl;
+    return 0;
+}
+
+int run_quantize_command(const std::vector<std::string>& args) {
+    std::string input_path;
+    std::string output_path;
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        const std::string& opt = args[i];
+        if (opt == "--input") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--input requires a file path");
+            input_path = args[++i];
+        } else if (opt == "--output") {
+            if (i + 1 >= args.size()) throw std::invalid_argument("--output requires a file path");
+            output_path = args[++i];
+        }
+    }
+
+    if (input_path.empty()) {
+        throw std::invalid_argument("quantize requires --input network file");
+    }
+    if (output_path.empty()) {
+        output_path = std::filesystem::path(input_path).replace_extension(".nnq").string();
+    }
+
+    chiron::nnue::Network network;
+    network.load_from_file(input_path);
+    chiron::nnue::QuantizedNetwork quantized = chiron::nnue::QuantizedNetwork::from_network(network);
+    quantized.save_to_file(output_path);
+    std::cout << "Quantized " << network.hidden_size() << "-neuron network to " << output_path
+              << " (activation clip " << quantized.clip() << ")" << std::endl;
     return 0;
 }
 
@@ -714,6 +1216,8 @@ int run_teacher_command(const std::vector<std::string>& args) {
     std::string output_path = "teacher_labels.txt";
     int depth = 20;
     int threads = 1;
+    int processes = 1;
+    int pipeline = 1;
 
     for (std::size_t i = 1; i < args.size(); ++i) {
         const std::string& opt = args[i];
@@ -730,6 +1234,10 @@ int run_teacher_command(const std::vector<std::string>& args) {
             depth = parse_int(args, i, opt);
         } else if (opt == "--threads") {
             threads = parse_int(args, i, opt);
+        } else if (opt == "--processes") {
+            processes = std::max(1, parse_int(args, i, opt));
+        } else if (opt == "--pipeline") {
+            pipeline = std::max(1, parse_int(args, i, opt));
         }
     }
 
@@ -755,7 +1263,7 @@ int run_teacher_command(const std::vector<std::string>& args) {
         throw std::runtime_error("Positions file is empty");
     }
 
-    TeacherEngine teacher({engine_path, depth, threads});
+    TeacherEngine teacher({engine_path, depth, threads, processes, pipeline});
     std::vector<int> scores = teacher.evaluate(fens);
     std::vector<TrainingExample> examples;
     examples.reserve(scores.size());
@@ -767,54 +1275,101 @@ int run_teacher_command(const std::vector<std::string>& args) {
     return 0;
 }
 
-}  // namespace
+/** @brief Removes `--trace FILE` from anywhere in @p args and returns FILE, or "" when absent. */
+std::string take_trace_option(std::vector<std::string>& args) {
+    auto found = std::find(args.begin(), args.end(), "--trace");
+    if (found == args.end()) {
+        return {};
+    }
+    if (found + 1 == args.end()) {
+        throw std::invalid_argument("--trace requires a file");
+    }
+    std::string path = *(found + 1);
+    args.erase(found, found + 2);
+    return path;
+}
 
-int main(int argc, char** argv) {
-    try {
-        std::vector<std::string> args(argv + 1, argv + argc);
-        if (args.empty()) {
-            chiron::UCI uci;
-            uci.loop();
-            return 0;
-        }
+int run_command(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        chiron::UCI uci;
+        uci.loop();
+        return 0;
+    }
 
-        const std::string& command = args[0];
-        if (command == "selfplay") {
-            return run_selfplay(args);
-        }
-        if (command == "perft") {
-            return run_perft(args);
-        }
-        if (command == "learn" || command == "-learn" || command == "--learn") {
-            return run_learn_command(args);
-        }
-        if (command == "train") {
-            return run_train_command(args);
+    const std::string& command = args[0];
+    if (command == "uci") {
+        return run_uci(args);
+    }
+    if (command == "selfplay") {
+        return run_selfplay(args);
+    }
+    if (command == "worker") {
+        return run_worker_command(args);
+    }
+    if (command == "perft") {
+        return run_perft(args);
+    }
+    if (command == "bench") {
+        return run_bench(args);
+    }
+    if (command == "learn" || command == "-learn" || command == "--learn") {
+        return run_learn_command(args);
+    }
+    if (command == "train") {
+        return run_train_command(args);
+    }
+    if (command == "train-teacher") {
+        return run_train_teacher_command(args);
+    }
+    if (command == "import-pgn") {
+        return run_import_pgn(args);
+    }
+    if (command == "convert") {
+        return run_convert_command(args);
+    }
+    if (command == "book") {
+        return run_book_command(args);
+    }
+    if (command == "evaluate") {
+        return run_evaluate_command(args);
+    }
+    if (command == "teacher") {
+        return run_teacher_command(args);
+    }
+    if (command == "quantize") {
+        return run_quantize_command(args);
+    }
+    if (command == "tune") {
+        if (args.size() < 2) {
+            throw std::invalid_argument("tune requires a subcommand (sprt/time)");
         }
-        if (command == "train-teacher") {
-            return run_train_teacher_command(args);
+        const std::string& sub = args[1];
+        if (sub == "sprt") {
+            return run_sprt(args);
         }
-        if (command == "import-pgn") {
-            return run_import_pgn(args);
+        if (sub == "time") {
+            return run_time_analysis(args);
         }
-        if (command == "teacher") {
-            return run_teacher_command(args);
+        throw std::invalid_argument("Unknown tune subcommand: " + sub);
+    }
+
+    throw std::invalid_argument("Unknown command: " + command);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        std::vector<std::string> args(argv + 1, argv + argc);
+        std::string trace_path = take_trace_option(args);
+        if (!trace_path.empty()) {
+            chiron::trace::start();
         }
-        if (command == "tune") {
-            if (args.size() < 2) {
-                throw std::invalid_argument("tune requires a subcommand (sprt/time)");
-            }
-            const std::string& sub = args[1];
-            if (sub == "sprt") {
-                return run_sprt(args);
-            }
-            if (sub == "time") {
-                return run_time_analysis(args);
-            }
-            throw std::invalid_argument("Unknown tune subcommand: " + sub);
+        int status = run_command(args);
+        if (!trace_path.empty()) {
+            chiron::trace::stop(trace_path);
         }
-
-        throw std::invalid_argument("Unknown command: " + command);
+        return status;
     } catch (const std::exception& ex) {
         std::cerr << "Fatal error: " << ex.what() << std::endl;
         return 1;
@@ -36,6 +36,84 @@ struct Move {
     bool is_promotion() const { return flags & MoveFlag::Promotion; }
 };
 
+/**
+ * @brief 16-bit move encoding: from (6 bits), to (6 bits) and a 4-bit move type.
+ *
+ * Used wherever moves are stored in bulk (transposition table, killers, move lists). The
+ * type nibble follows the common layout: 0 quiet, 1 double push, 2/3 king/queen castle,
+ * 4 capture, 5 en passant, 8-11 promotions (N, B, R, Q) and 12-15 capturing promotions.
+ * The null move packs to zero.
+ */
+struct PackedMove {
+    std::uint16_t value;
+
+    [[nodiscard]] constexpr int from() const { return value & 0x3F; }
+    [[nodiscard]] constexpr int to() const { return (value >> 6) & 0x3F; }
+    [[nodiscard]] constexpr int type() const { return value >> 12; }
+    [[nodiscard]] constexpr bool is_null() const { return value == 0; }
+
+    friend constexpr bool operator==(PackedMove lhs, PackedMove rhs) = default;
+};
+
+static_assert(sizeof(PackedMove) == 2, "PackedMove must stay two bytes");
+
+/**
+ * @brief Encodes a move into its 16-bit representation.
+ */
+[[nodiscard]] constexpr PackedMove pack_move(const Move& m) {
+    unsigned type = 0;
+    if (m.flags & MoveFlag::Promotion) {
+        type = 8U + static_cast<unsigned>(static_cast<int>(m.promotion) - static_cast<int>(PieceType::Knight));
+        if (m.flags & MoveFlag::Capture) {
+            type += 4U;
+        }
+    } else if (m.flags & MoveFlag::EnPassant) {
+        type = 5U;
+    } else if (m.flags & MoveFlag::Capture) {
+        type = 4U;
+    } else if (m.flags & MoveFlag::DoublePush) {
+        type = 1U;
+    } else if (m.flags & MoveFlag::KingCastle) {
+        type = 2U;
+    } else if (m.flags & MoveFlag::QueenCastle) {
+        type = 3U;
+    }
+    return PackedMove{static_cast<std::uint16_t>((static_cast<unsigned>(m.from) & 0x3FU) |
+                                                 ((static_cast<unsigned>(m.to) & 0x3FU) << 6) | (type << 12))};
+}
+
+/**
+ * @brief Expands a packed move back into the full Move structure.
+ */
+[[nodiscard]] constexpr Move unpack_move(PackedMove packed) {
+    constexpr std::uint8_t kTypeFlags[16] = {
+        MoveFlag::Quiet,
+        MoveFlag::DoublePush,
+        MoveFlag::KingCastle,
+        MoveFlag::QueenCastle,
+        MoveFlag::Capture,
+        MoveFlag::Capture | MoveFlag::EnPassant,
+        MoveFlag::Quiet,
+        MoveFlag::Quiet,
+        MoveFlag::Promotion,
+        MoveFlag::Promotion,
+        MoveFlag::Promotion,
+        MoveFlag::Promotion,
+        MoveFlag::Promotion | MoveFlag::Capture,
+        MoveFlag::Promotion | MoveFlag::Capture,
+        MoveFlag::Promotion | MoveFlag::Capture,
+        MoveFlag::Promotion | MoveFlag::Capture,
+    };
+    Move move;
+    move.from = packed.from();
+    move.to = packed.to();
+    move.flags = kTypeFlags[packed.type()];
+    if (packed.type() >= 8) {
+        move.promotion = static_cast<PieceType>(static_cast<int>(PieceType::Knight) + (packed.type() & 3));
+    }
+    return move;
+}
+
 inline std::string move_to_string(const Move& m) {
     std::string str;
     str.reserve(5);
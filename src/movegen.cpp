@@ -1,140 +1,285 @@
 #include "movegen.h"
 
 #include <algorithm>
+#include <initializer_list>
 
 #include "attacks.h"
 
 namespace chiron {
 
-void MoveGenerator::generate_pseudo_legal_moves(const Board& board, std::vector<Move>& moves) {
-    moves.clear();
+namespace {
+
+constexpr Bitboard kAllSquares = ~0ULL;
+
+/**
+ * @brief Check and pin information computed once per generation call.
+ */
+struct LegalityInfo {
+    int king_square = -1;
+    Bitboard checkers = kEmpty;
+    Bitboard pinned = kEmpty;
+    Bitboard check_mask = kAllSquares;  /**< Destinations that resolve a single check. */
+};
+
+LegalityInfo compute_legality(const Board& board, Color us) {
+    LegalityInfo info;
+    info.king_square = board.king_square(us);
+    if (info.king_square < 0) {
+        return info;
+    }
+
+    // The board caches checkers and pins for the side to move after every move.
+    info.checkers = board.checkers();
+    info.pinned = board.pinned();
 
-    Color us = board.side_to_move();
+    if (popcount(info.checkers) == 1) {
+        int checker = std::countr_zero(info.checkers);
+        info.check_mask = between_bb(info.king_square, checker) | info.checkers;
+    } else if (info.checkers) {
+        info.check_mask = kEmpty;
+    }
+    return info;
+}
+
+Bitboard pin_restriction(const LegalityInfo& info, int from) {
+    if (info.pinned & square_bb(static_cast<Square>(from))) {
+        return line_bb(info.king_square, from);
+    }
+    return kAllSquares;
+}
+
+void add_moves(int from, Bitboard targets, Bitboard enemy, MoveList& moves) {
+    while (targets) {
+        int to = pop_lsb(targets);
+        Move move;
+        move.from = from;
+        move.to = to;
+        move.flags = (enemy & square_bb(static_cast<Square>(to))) ? MoveFlag::Capture : MoveFlag::Quiet;
+        moves.push_back(move);
+    }
+}
+
+/**
+ * @brief Verifies an en-passant capture by replaying the occupancy change.
+ *
+ * Removing both pawns from the same rank can expose the king to a rook or queen, which the
+ * regular single-piece pin test cannot see.
+ */
+bool en_passant_is_legal(const Board& board, Color us, int king_square, int from, int to) {
+    if (king_square < 0) {
+        return true;
+    }
     Color them = opposite_color(us);
-    Bitboard friendly = board.occupancy(us);
-    Bitboard enemy = board.occupancy(them);
+    int captured = to + (us == Color::White ? -8 : 8);
     Bitboard occupied = board.occupancy_all();
+    occupied ^= square_bb(static_cast<Square>(from)) | square_bb(static_cast<Square>(captured));
+    occupied |= square_bb(static_cast<Square>(to));
+    Bitboard diagonal = board.pieces(them, PieceType::Bishop) | board.pieces(them, PieceType::Queen);
+    Bitboard orthogonal = board.pieces(them, PieceType::Rook) | board.pieces(them, PieceType::Queen);
+    return !(bishop_attacks(king_square, occupied) & diagonal) && !(rook_attacks(king_square, occupied) & orthogonal);
+}
 
-    // Pawn moves
-    Bitboard pawns = board.pieces(us, PieceType::Pawn);
-    while (pawns) {
-        int from = pop_lsb(pawns);
-        int rank = from / 8;
-        int forward = from + (us == Color::White ? 8 : -8);
-        if (forward >= 0 && forward < kBoardSize && board.piece_type_at(forward) == PieceType::None) {
-            bool promotion_rank = (us == Color::White) ? (rank == 6) : (rank == 1);
-            if (promotion_rank) {
-                add_promotion_moves(from, forward, false, moves);
-            } else {
-                Move move;
-                move.from = from;
-                move.to = forward;
-                move.flags = MoveFlag::Quiet;
-                moves.push_back(move);
+void add_promotion_moves(int from, int to, bool is_capture, MoveList& moves) {
+    static constexpr PieceType kPromotions[] = {PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight};
+    for (PieceType promotion : kPromotions) {
+        Move move;
+        move.from = from;
+        move.to = to;
+        move.promotion = promotion;
+        move.flags = MoveFlag::Promotion;
+        if (is_capture) {
+            move.flags |= MoveFlag::Capture;
+        }
+        moves.push_back(move);
+    }
+}
 
-                int double_forward = from + (us == Color::White ? 16 : -16);
-                bool double_rank = (us == Color::White) ? (rank == 1) : (rank == 6);
-                if (double_rank && board.piece_type_at(double_forward) == PieceType::None) {
-                    Move dbl = move;
-                    dbl.to = double_forward;
-                    dbl.flags = MoveFlag::DoublePush;
-                    moves.push_back(dbl);
-                }
-            }
+bool castle_path_clear(const Board& board, Color them, std::initializer_list<Square> empty,
+                       std::initializer_list<Square> safe) {
+    for (Square sq : empty) {
+        if (board.piece_type_at(static_cast<int>(sq)) != PieceType::None) {
+            return false;
+        }
+    }
+    for (Square sq : safe) {
+        if (board.is_square_attacked(sq, them)) {
+            return false;
         }
+    }
+    return true;
+}
 
-        Bitboard attacks = pawn_attacks(us, from) & enemy;
-        while (attacks) {
-            int to = pop_lsb(attacks);
-            bool promotion_rank = (us == Color::White) ? (rank == 6) : (rank == 1);
-            if (promotion_rank) {
-                add_promotion_moves(from, to, true, moves);
-            } else {
-                Move move;
-                move.from = from;
-                move.to = to;
-                move.flags = MoveFlag::Capture;
-                moves.push_back(move);
-            }
+constexpr Bitboard kFileA = 0x0101010101010101ULL;
+constexpr Bitboard kFileH = kFileA << 7;
+
+constexpr Bitboard rank_bb(int rank) { return 0xFFULL << (8 * rank); }
+
+/** @brief Shifts every square of @p bb by @p delta, towards the eighth rank when positive. */
+template <int Delta>
+constexpr Bitboard shift(Bitboard bb) {
+    return Delta > 0 ? bb << Delta : bb >> -Delta;
+}
+
+/**
+ * @brief Pawn geometry for the side @p Us; "west" captures head for the a-file.
+ */
+template <Color Us>
+struct PawnGeometry {
+    static constexpr Color kThem = Us == Color::White ? Color::Black : Color::White;
+    static constexpr int kPush = Us == Color::White ? 8 : -8;
+    static constexpr int kCaptureWest = Us == Color::White ? 7 : -9;
+    static constexpr int kCaptureEast = Us == Color::White ? 9 : -7;
+    static constexpr Bitboard kDoublePushRank = rank_bb(Us == Color::White ? 2 : 5);  // After one push.
+    static constexpr Bitboard kPromotionRank = rank_bb(Us == Color::White ? 6 : 1);   // Before the push.
+};
+
+/** @brief Appends one move per square in @p targets, coming from @p delta squares back. */
+void add_shifted_moves(Bitboard targets, int delta, std::uint8_t flags, MoveList& moves) {
+    while (targets) {
+        int to = pop_lsb(targets);
+        Move move;
+        move.from = to - delta;
+        move.to = to;
+        move.flags = flags;
+        moves.push_back(move);
+    }
+}
+
+void add_shifted_promotions(Bitboard targets, int delta, bool is_capture, MoveList& moves) {
+    while (targets) {
+        int to = pop_lsb(targets);
+        add_promotion_moves(to - delta, to, is_capture, moves);
+    }
+}
+
+/**
+ * @brief Generates the pushes and captures of @p pawns set-wise, keeping the destinations in
+ *        @p allowed (the check mask, narrowed to the pin line for a pinned pawn).
+ */
+template <Color Us, MoveGenerator::GenType Type>
+void append_pawn_moves(Bitboard pawns, Bitboard empty, Bitboard enemy, Bitboard allowed, MoveList& moves) {
+    using Geometry = PawnGeometry<Us>;
+    constexpr bool kTactical = Type != MoveGenerator::GenType::Quiets;
+    constexpr bool kQuiet = Type != MoveGenerator::GenType::Captures;
+
+    Bitboard promoting = pawns & Geometry::kPromotionRank;
+    Bitboard others = pawns & ~Geometry::kPromotionRank;
+
+    if constexpr (kQuiet) {
+        Bitboard single = shift<Geometry::kPush>(others) & empty;
+        Bitboard double_push = shift<Geometry::kPush>(single & Geometry::kDoublePushRank) & empty;
+        add_shifted_moves(single & allowed, Geometry::kPush, MoveFlag::Quiet, moves);
+        add_shifted_moves(double_push & allowed, 2 * Geometry::kPush, MoveFlag::DoublePush, moves);
+    }
+    if constexpr (kTactical) {
+        // Underpromotions count as tactical too, so they are never split from the queen promotion.
+        if (promoting) {
+            add_shifted_promotions(shift<Geometry::kPush>(promoting) & empty & allowed, Geometry::kPush, false, moves);
+            add_shifted_promotions(shift<Geometry::kCaptureWest>(promoting & ~kFileA) & enemy & allowed,
+                                   Geometry::kCaptureWest, true, moves);
+            add_shifted_promotions(shift<Geometry::kCaptureEast>(promoting & ~kFileH) & enemy & allowed,
+                                   Geometry::kCaptureEast, true, moves);
+        }
+        add_shifted_moves(shift<Geometry::kCaptureWest>(others & ~kFileA) & enemy & allowed, Geometry::kCaptureWest,
+                          MoveFlag::Capture, moves);
+        add_shifted_moves(shift<Geometry::kCaptureEast>(others & ~kFileH) & enemy & allowed, Geometry::kCaptureEast,
+                          MoveFlag::Capture, moves);
+    }
+}
+
+/**
+ * @brief Appends the legal moves of one category whose origin lies in @p sources, for the side
+ *        to move @p Us.
+ */
+template <Color Us, MoveGenerator::GenType Type>
+void append_moves(const Board& board, Bitboard sources, MoveList& moves) {
+    using Geometry = PawnGeometry<Us>;
+    constexpr Color kThem = Geometry::kThem;
+    constexpr bool kTactical = Type != MoveGenerator::GenType::Quiets;
+    constexpr bool kQuiet = Type != MoveGenerator::GenType::Captures;
+
+    Bitboard friendly = board.occupancy(Us);
+    Bitboard enemy = board.occupancy(kThem);
+    Bitboard occupied = board.occupancy_all();
+    LegalityInfo info = compute_legality(board, Us);
+    bool double_check = popcount(info.checkers) > 1;
+    Bitboard target_mask = Type == MoveGenerator::GenType::Captures ? enemy
+                           : Type == MoveGenerator::GenType::Quiets ? ~occupied
+                                                                    : ~friendly;
+
+    if (!double_check) {
+        // Pawn moves: the unpinned pawns together, each pinned one along its pin line.
+        Bitboard pawns = board.pieces(Us, PieceType::Pawn) & sources;
+        append_pawn_moves<Us, Type>(pawns & ~info.pinned, ~occupied, enemy, info.check_mask, moves);
+        for (Bitboard pinned = pawns & info.pinned; pinned;) {
+            int from = pop_lsb(pinned);
+            append_pawn_moves<Us, Type>(square_bb(static_cast<Square>(from)), ~occupied, enemy,
+                                        info.check_mask & line_bb(info.king_square, from), moves);
         }
 
         int ep_square = board.en_passant_square();
-        if (ep_square != -1 && (pawn_attacks(us, from) & square_bb(static_cast<Square>(ep_square)))) {
-            Move move;
-            move.from = from;
-            move.to = ep_square;
-            move.flags = MoveFlag::Capture | MoveFlag::EnPassant;
-            moves.push_back(move);
+        if (kTactical && ep_square != -1) {
+            // The capture also resolves a check given by the double-pushed pawn itself.
+            Bitboard captured_bb = square_bb(static_cast<Square>(ep_square - Geometry::kPush));
+            bool resolves_check = (info.check_mask & (square_bb(static_cast<Square>(ep_square)) | captured_bb)) != 0;
+            Bitboard capturers = resolves_check ? pawn_attacks(kThem, ep_square) & pawns : kEmpty;
+            while (capturers) {
+                int from = pop_lsb(capturers);
+                // Replaying the occupancy change also catches pins, including the rank pin
+                // through both pawns that the pin mask cannot see.
+                if (en_passant_is_legal(board, Us, info.king_square, from, ep_square)) {
+                    Move move;
+                    move.from = from;
+                    move.to = ep_square;
+                    move.flags = MoveFlag::Capture | MoveFlag::EnPassant;
+                    moves.push_back(move);
+                }
+            }
         }
-    }
 
-    // Knight moves
-    Bitboard knights = board.pieces(us, PieceType::Knight);
-    while (knights) {
-        int from = pop_lsb(knights);
-        Bitboard targets = knight_attacks(from) & ~friendly;
-        while (targets) {
-            int to = pop_lsb(targets);
-            Move move;
-            move.from = from;
-            move.to = to;
-            move.flags = (enemy & square_bb(static_cast<Square>(to))) ? MoveFlag::Capture : MoveFlag::Quiet;
-            moves.push_back(move);
+        // Knight moves; a pinned knight can never move.
+        Bitboard knights = board.pieces(Us, PieceType::Knight) & ~info.pinned & sources;
+        while (knights) {
+            int from = pop_lsb(knights);
+            add_moves(from, knight_attacks(from) & target_mask & info.check_mask, enemy, moves);
         }
-    }
 
-    // Bishop moves
-    Bitboard bishops = board.pieces(us, PieceType::Bishop);
-    while (bishops) {
-        int from = pop_lsb(bishops);
-        Bitboard targets = bishop_attacks(from, occupied) & ~friendly;
-        while (targets) {
-            int to = pop_lsb(targets);
-            Move move;
-            move.from = from;
-            move.to = to;
-            move.flags = (enemy & square_bb(static_cast<Square>(to))) ? MoveFlag::Capture : MoveFlag::Quiet;
-            moves.push_back(move);
+        // Bishop moves
+        Bitboard bishops = board.pieces(Us, PieceType::Bishop) & sources;
+        while (bishops) {
+            int from = pop_lsb(bishops);
+            Bitboard targets = bishop_attacks(from, occupied) & target_mask & info.check_mask & pin_restriction(info, from);
+            add_moves(from, targets, enemy, moves);
         }
-    }
 
-    // Rook moves
-    Bitboard rooks = board.pieces(us, PieceType::Rook);
-    while (rooks) {
-        int from = pop_lsb(rooks);
-        Bitboard targets = rook_attacks(from, occupied) & ~friendly;
-        while (targets) {
-            int to = pop_lsb(targets);
-            Move move;
-            move.from = from;
-            move.to = to;
-            move.flags = (enemy & square_bb(static_cast<Square>(to))) ? MoveFlag::Capture : MoveFlag::Quiet;
-            moves.push_back(move);
+        // Rook moves
+        Bitboard rooks = board.pieces(Us, PieceType::Rook) & sources;
+        while (rooks) {
+            int from = pop_lsb(rooks);
+            Bitboard targets = rook_attacks(from, occupied) & target_mask & info.check_mask & pin_restriction(info, from);
+            add_moves(from, targets, enemy, moves);
         }
-    }
 
-    // Queen moves
-    Bitboard queens = board.pieces(us, PieceType::Queen);
-    while (queens) {
-        int from = pop_lsb(queens);
-        Bitboard targets = queen_attacks(from, occupied) & ~friendly;
-        while (targets) {
-            int to = pop_lsb(targets);
-            Move move;
-            move.from = from;
-            move.to = to;
-            move.flags = (enemy & square_bb(static_cast<Square>(to))) ? MoveFlag::Capture : MoveFlag::Quiet;
-            moves.push_back(move);
+        // Queen moves
+        Bitboard queens = board.pieces(Us, PieceType::Queen) & sources;
+        while (queens) {
+            int from = pop_lsb(queens);
+            Bitboard targets = queen_attacks(from, occupied) & target_mask & info.check_mask & pin_restriction(info, from);
+            add_moves(from, targets, enemy, moves);
         }
     }
 
-    // King moves
-    Bitboard kings = board.pieces(us, PieceType::King);
-    if (kings) {
-        int from = pop_lsb(kings);
-        Bitboard targets = king_attacks(from) & ~friendly;
+    // King moves are tested against the occupancy without the king so it cannot hide
+    // behind itself on a slider's ray.
+    if (info.king_square >= 0 && (sources & square_bb(static_cast<Square>(info.king_square)))) {
+        int from = info.king_square;
+        Bitboard without_king = occupied ^ square_bb(static_cast<Square>(from));
+        Bitboard targets = king_attacks(from) & target_mask;
         while (targets) {
             int to = pop_lsb(targets);
+            if (board.attackers_to(to, without_king) & enemy) {
+                continue;
+            }
             Move move;
             move.from = from;
             move.to = to;
@@ -143,99 +288,83 @@ void MoveGenerator::generate_pseudo_legal_moves(const Board& board, std::vector<
         }
 
         // Castling
-        if (!board.in_check(us)) {
+        if (kQuiet && !info.checkers) {
+            constexpr bool kWhite = Us == Color::White;
+            constexpr std::uint8_t kKingSide = kWhite ? kWhiteKingCastle : kBlackKingCastle;
+            constexpr std::uint8_t kQueenSide = kWhite ? kWhiteQueenCastle : kBlackQueenCastle;
+            constexpr Square kF = kWhite ? Square::F1 : Square::F8;
+            constexpr Square kG = kWhite ? Square::G1 : Square::G8;
+            constexpr Square kD = kWhite ? Square::D1 : Square::D8;
+            constexpr Square kC = kWhite ? Square::C1 : Square::C8;
+            constexpr Square kB = kWhite ? Square::B1 : Square::B8;
             std::uint8_t rights = board.castling_rights();
-            if (us == Color::White) {
-                if ((rights & kWhiteKingCastle) &&
-                    board.piece_type_at(static_cast<int>(Square::F1)) == PieceType::None &&
-                    board.piece_type_at(static_cast<int>(Square::G1)) == PieceType::None &&
-                    !board.is_square_attacked(Square::F1, them) &&
-                    !board.is_square_attacked(Square::G1, them)) {
-                    Move move;
-                    move.from = from;
-                    move.to = static_cast<int>(Square::G1);
-                    move.flags = MoveFlag::KingCastle;
-                    moves.push_back(move);
-                }
-                if ((rights & kWhiteQueenCastle) &&
-                    board.piece_type_at(static_cast<int>(Square::D1)) == PieceType::None &&
-                    board.piece_type_at(static_cast<int>(Square::C1)) == PieceType::None &&
-                    board.piece_type_at(static_cast<int>(Square::B1)) == PieceType::None &&
-                    !board.is_square_attacked(Square::D1, them) &&
-                    !board.is_square_attacked(Square::C1, them)) {
-                    Move move;
-                    move.from = from;
-                    move.to = static_cast<int>(Square::C1);
-                    move.flags = MoveFlag::QueenCastle;
-                    moves.push_back(move);
-                }
-            } else {
-                if ((rights & kBlackKingCastle) &&
-                    board.piece_type_at(static_cast<int>(Square::F8)) == PieceType::None &&
-                    board.piece_type_at(static_cast<int>(Square::G8)) == PieceType::None &&
-                    !board.is_square_attacked(Square::F8, them) &&
-                    !board.is_square_attacked(Square::G8, them)) {
-                    Move move;
-                    move.from = from;
-                    move.to = static_cast<int>(Square::G8);
-                    move.flags = MoveFlag::KingCastle;
-                    moves.push_back(move);
-                }
-                if ((rights & kBlackQueenCastle) &&
-                    board.piece_type_at(static_cast<int>(Square::D8)) == PieceType::None &&
-                    board.piece_type_at(static_cast<int>(Square::C8)) == PieceType::None &&
-                    board.piece_type_at(static_cast<int>(Square::B8)) == PieceType::None &&
-                    !board.is_square_attacked(Square::D8, them) &&
-                    !board.is_square_attacked(Square::C8, them)) {
-                    Move move;
-                    move.from = from;
-                    move.to = static_cast<int>(Square::C8);
-                    move.flags = MoveFlag::QueenCastle;
-                    moves.push_back(move);
-                }
+            if ((rights & kKingSide) && castle_path_clear(board, kThem, {kF, kG}, {kF, kG})) {
+                Move move;
+                move.from = from;
+                move.to = static_cast<int>(kG);
+                move.flags = MoveFlag::KingCastle;
+                moves.push_back(move);
+            }
+            if ((rights & kQueenSide) && castle_path_clear(board, kThem, {kD, kC, kB}, {kD, kC})) {
+                Move move;
+                move.from = from;
+                move.to = static_cast<int>(kC);
+                move.flags = MoveFlag::QueenCastle;
+                moves.push_back(move);
             }
         }
     }
 }
 
-void MoveGenerator::generate_legal_moves(Board& board, std::vector<Move>& moves) {
-    std::vector<Move> pseudo;
-    pseudo.reserve(64);
-    generate_pseudo_legal_moves(board, pseudo);
+/** @brief Dispatches on the side to move once, so the generator itself never branches on it. */
+template <MoveGenerator::GenType Type>
+void append_moves(const Board& board, Bitboard sources, MoveList& moves) {
+    if (board.side_to_move() == Color::White) {
+        append_moves<Color::White, Type>(board, sources, moves);
+    } else {
+        append_moves<Color::Black, Type>(board, sources, moves);
+    }
+}
+
+}  // namespace
 
+void MoveGenerator::generate_legal_moves(const Board& board, MoveList& moves) {
     moves.clear();
-    moves.reserve(pseudo.size());
+    append_moves<GenType::All>(board, kAllSquares, moves);
+}
 
-    for (const Move& move : pseudo) {
-        Board::State state;
-        board.make_move(move, state);
-        if (!board.in_check(opposite_color(board.side_to_move()))) {
-            moves.push_back(move);
-        }
-        board.undo_move(move, state);
+void MoveGenerator::generate_moves(const Board& board, GenType type, MoveList& moves) {
+    switch (type) {
+        case GenType::Captures:
+            append_moves<GenType::Captures>(board, kAllSquares, moves);
+            break;
+        case GenType::Quiets:
+            append_moves<GenType::Quiets>(board, kAllSquares, moves);
+            break;
+        case GenType::All:
+            append_moves<GenType::All>(board, kAllSquares, moves);
+            break;
     }
 }
 
-std::vector<Move> MoveGenerator::generate_legal_moves(Board& board) {
+bool MoveGenerator::is_legal(const Board& board, PackedMove move) {
+    if (move.is_null()) {
+        return false;
+    }
+    Move unpacked = unpack_move(move);
+    return board.is_pseudo_legal(unpacked) && board.is_legal(unpacked);
+}
+
+void MoveGenerator::generate_legal_moves(const Board& board, std::vector<Move>& moves) {
+    MoveList list;
+    generate_legal_moves(board, list);
+    moves.assign(list.begin(), list.end());
+}
+
+std::vector<Move> MoveGenerator::generate_legal_moves(const Board& board) {
     std::vector<Move> moves;
     generate_legal_moves(board, moves);
     return moves;
 }
 
-void MoveGenerator::add_promotion_moves(int from, int to, bool is_capture, std::vector<Move>& moves) {
-    static constexpr PieceType kPromotions[] = {PieceType::Queen, PieceType::Rook, PieceType::Bishop, PieceType::Knight};
-    for (PieceType promotion : kPromotions) {
-        Move move;
-        move.from = from;
-        move.to = to;
-        move.promotion = promotion;
-        move.flags = MoveFlag::Promotion;
-        if (is_capture) {
-            move.flags |= MoveFlag::Capture;
-        }
-        moves.push_back(move);
-    }
-}
-
 }  // namespace chiron
-
@@ -3,20 +3,44 @@
 #include <vector>
 
 #include "board.h"
+#include "movelist.h"
 
 namespace chiron {
 
 /**
  * @brief Generates legal chess moves for the given board state.
+ *
+ * Checkers, pinned pieces and the check evasion mask are computed up front so that only
+ * legal moves are emitted; no candidate is made and unmade to test for self-check.
  */
 class MoveGenerator {
    public:
-    static void generate_legal_moves(Board& board, std::vector<Move>& moves);
-    static std::vector<Move> generate_legal_moves(Board& board);
+    /**
+     * @brief Move categories for staged generation.
+     *
+     * Captures covers every capture, en passant and every promotion (the moves quiescence
+     * searches); Quiets covers the remaining non-capturing moves including castling.
+     */
+    enum class GenType { Captures, Quiets, All };
 
-   private:
-    static void generate_pseudo_legal_moves(const Board& board, std::vector<Move>& moves);
-    static void add_promotion_moves(int from, int to, bool is_capture, std::vector<Move>& moves);
+    /**
+     * @brief Fills @p moves with every legal move; the allocation-free hot-path overload.
+     */
+    static void generate_legal_moves(const Board& board, MoveList& moves);
+    static void generate_legal_moves(const Board& board, std::vector<Move>& moves);
+    static std::vector<Move> generate_legal_moves(const Board& board);
+
+    /**
+     * @brief Appends the legal moves of one category to @p moves without clearing it.
+     */
+    static void generate_moves(const Board& board, GenType type, MoveList& moves);
+
+    /**
+     * @brief Checks that a move (typically from the TT or a killer slot) is legal here.
+     *
+     * Runs Board::is_pseudo_legal() and Board::is_legal(), so no moves are generated.
+     */
+    [[nodiscard]] static bool is_legal(const Board& board, PackedMove move);
 };
 
 }  // namespace chiron
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <iterator>
+
+#include "move.h"
+
+namespace chiron {
+
+/** Upper bound on legal moves in any reachable chess position (the known maximum is 218). */
+constexpr inline std::size_t kMaxMoves = 256;
+
+/**
+ * @brief Fixed-capacity, stack-resident move container with an ordering score per move.
+ *
+ * Used on every hot path (move generation, search and perft) so generating moves never
+ * touches the allocator. Moves are stored as PackedMove and expanded on access, which keeps
+ * a full list at 1.5 KB and makes the container trivially constructible.
+ */
+class MoveList {
+   public:
+    /**
+     * @brief Read-only iterator yielding unpacked moves by value.
+     */
+    class const_iterator {
+       public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Move;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Move;
+
+        const_iterator() = default;
+        explicit const_iterator(const PackedMove* current) : current_(current) {}
+
+        Move operator*() const { return unpack_move(*current_); }
+        const_iterator& operator++() {
+            ++current_;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++current_;
+            return previous;
+        }
+        friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) = default;
+
+       private:
+        const PackedMove* current_ = nullptr;
+    };
+
+    void push_back(const Move& move) {
+        moves_[size_] = pack_move(move);
+        scores_[size_] = 0;
+        ++size_;
+    }
+
+    void clear() { size_ = 0; }
+
+    /**
+     * @brief Shrinks the list to the first @p size entries.
+     */
+    void resize(std::size_t size) { size_ = size; }
+
+    [[nodiscard]] std::size_t size() const { return size_; }
+    [[nodiscard]] bool empty() const { return size_ == 0; }
+
+    [[nodiscard]] Move operator[](std::size_t index) const { return unpack_move(moves_[index]); }
+    [[nodiscard]] PackedMove packed(std::size_t index) const { return moves_[index]; }
+
+    [[nodiscard]] int& score(std::size_t index) { return scores_[index]; }
+    [[nodiscard]] int score(std::size_t index) const { return scores_[index]; }
+
+    /**
+     * @brief Copies entry @p from (move and score) over entry @p to.
+     */
+    void copy_entry(std::size_t to, std::size_t from) {
+        moves_[to] = moves_[from];
+        scores_[to] = scores_[from];
+    }
+
+    [[nodiscard]] bool contains(PackedMove move) const {
+        for (std::size_t i = 0; i < size_; ++i) {
+            if (moves_[i] == move) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    [[nodiscard]] const_iterator begin() const { return const_iterator(moves_.data()); }
+    [[nodiscard]] const_iterator end() const { return const_iterator(moves_.data() + size_); }
+
+    /**
+     * @brief Moves the highest-scored entry in [index, size) to @p index and returns it.
+     *
+     * Selection-style picking keeps ordering cost proportional to the moves actually searched,
+     * which matters when an early move produces a cutoff. Ties keep generation order.
+     */
+    Move pick_best(std::size_t index) {
+        std::size_t best = index;
+        for (std::size_t i = index + 1; i < size_; ++i) {
+            if (scores_[i] > scores_[best]) {
+                best = i;
+            }
+        }
+        if (best != index) {
+            PackedMove move = moves_[best];
+            int score = scores_[best];
+            for (std::size_t i = best; i > index; --i) {
+                moves_[i] = moves_[i - 1];
+                scores_[i] = scores_[i - 1];
+            }
+            moves_[index] = move;
+            scores_[index] = score;
+        }
+        return unpack_move(moves_[index]);
+    }
+
+   private:
+    std::array<PackedMove, kMaxMoves> moves_;
+    std::array<int, kMaxMoves> scores_;
+    std::size_t size_ = 0;
+};
+
+}  // namespace chiron
@@ -0,0 +1,149 @@
+#include "movepicker.h"
+
+namespace chiron {
+
+namespace {
+
+constexpr int kPieceValues[] = {100, 320, 330, 500, 900, 20000};
+
+int mvv_lva(const Move& move, const Board& board) {
+    int score = 0;
+    if (move.is_capture()) {
+        PieceType victim = move.is_en_passant() ? PieceType::Pawn : board.piece_type_at(move.to);
+        PieceType attacker = board.piece_type_at(move.from);
+        score = kPieceValues[static_cast<int>(victim)] * 16 - kPieceValues[static_cast<int>(attacker)];
+    }
+    if (move.is_promotion()) {
+        score += kPieceValues[static_cast<int>(move.promotion)] * 16;
+    }
+    return score;
+}
+
+}  // namespace
+
+MovePicker::MovePicker(const Board& board, PackedMove tt_move, const std::array<PackedMove, 2>& killers,
+                       const ButterflyHistory& history, const ContinuationHistories& continuation)
+    : board_(board),
+      history_(&history),
+      continuation_(continuation.continuation),
+      tt_move_(tt_move),
+      killers_{killers[0], killers[1], continuation.counter_move} {
+    if (!MoveGenerator::is_legal(board_, tt_move_)) {
+        tt_move_ = PackedMove{};
+        stage_ = Stage::GenerateCaptures;
+    }
+}
+
+MovePicker::MovePicker(const Board& board) : board_(board), stage_(Stage::GenerateCaptures), captures_only_(true) {}
+
+bool MovePicker::next(Move& move) {
+    switch (stage_) {
+        case Stage::TTMove:
+            stage_ = Stage::GenerateCaptures;
+            move = unpack_move(tt_move_);
+            return true;
+
+        case Stage::GenerateCaptures:
+            MoveGenerator::generate_moves(board_, MoveGenerator::GenType::Captures, moves_);
+            score_captures();
+            stage_ = Stage::Captures;
+            [[fallthrough]];
+
+        case Stage::Captures:
+            while (cursor_ < moves_.size()) {
+                move = moves_.pick_best(cursor_);
+                if (moves_.packed(cursor_) == tt_move_) {
+                    ++cursor_;
+                    continue;
+                }
+                if (!move.is_promotion() && !board_.see_ge(move, 0)) {
+                    moves_.copy_entry(bad_captures_end_++, cursor_++);
+                    continue;
+                }
+                ++cursor_;
+                return true;
+            }
+            if (captures_only_) {
+                stage_ = Stage::Done;
+                return false;
+            }
+            stage_ = Stage::Killers;
+            [[fallthrough]];
+
+        case Stage::Killers:
+            // Killers and counter moves are quiet by construction, so a legal one can never repeat a
+            // capture.
+            while (killer_index_ < killers_.size()) {
+                PackedMove killer = killers_[killer_index_++];
+                if (killer.is_null() || killer == tt_move_ || already_returned(killer)) {
+                    continue;
+                }
+                if (MoveGenerator::is_legal(board_, killer)) {
+                    played_killers_[killer_index_ - 1] = killer;
+                    move = unpack_move(killer);
+                    return true;
+                }
+            }
+            stage_ = Stage::GenerateQuiets;
+            [[fallthrough]];
+
+        case Stage::GenerateQuiets:
+            MoveGenerator::generate_moves(board_, MoveGenerator::GenType::Quiets, moves_);
+            score_quiets();
+            stage_ = Stage::Quiets;
+            [[fallthrough]];
+
+        case Stage::Quiets:
+            while (cursor_ < moves_.size()) {
+                move = moves_.pick_best(cursor_);
+                if (!already_returned(moves_.packed(cursor_++))) {
+                    return true;
+                }
+            }
+            stage_ = Stage::BadCaptures;
+            [[fallthrough]];
+
+        case Stage::BadCaptures:
+            // Already in MVV-LVA order: they were parked in the order they were picked.
+            if (bad_cursor_ < bad_captures_end_) {
+                move = moves_[bad_cursor_++];
+                return true;
+            }
+            stage_ = Stage::Done;
+            [[fallthrough]];
+
+        case Stage::Done:
+            return false;
+    }
+    return false;
+}
+
+bool MovePicker::already_returned(PackedMove move) const {
+    return move == tt_move_ || move == played_killers_[0] || move == played_killers_[1] ||
+           move == played_killers_[2];
+}
+
+int MovePicker::quiet_score(PackedMove move) const {
+    int score = (*history_)[static_cast<int>(board_.side_to_move())][move.from()][move.to()];
+    int piece_to = encode_piece(board_.side_to_move(), board_.piece_type_at(move.from())) * kBoardSize + move.to();
+    for (const PieceToHistory* table : continuation_) {
+        if (table) {
+            score += (*table)[static_cast<std::size_t>(piece_to)];
+        }
+    }
+    return score;
+}
+
+void MovePicker::score_captures() {
+    for (std::size_t i = cursor_; i < moves_.size(); ++i) {
+        moves_.score(i) = mvv_lva(moves_[i], board_);
+    }
+}
+
+void MovePicker::score_quiets() {
+    for (std::size_t i = cursor_; i < moves_.size(); ++i) {
+        moves_.score(i) = quiet_score(moves_.packed(i));
+    }
+}
+
+}  // namespace chiron
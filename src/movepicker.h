@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "board.h"
+#include "movegen.h"
+#include "movelist.h"
+
+namespace chiron {
+
+/** Butterfly history indexed by side to move, origin and destination square. */
+using ButterflyHistory = int[kNumColors][kBoardSize][kBoardSize];
+
+/** Number of (piece, destination) pairs; a pair is indexed as encode_piece() * kBoardSize + square. */
+inline constexpr int kPieceToCount = kNumColors * kNumPieceTypes * kBoardSize;
+
+/**
+ * @brief History of quiet moves by moving piece and destination, following one particular earlier
+ *        move. A node reads the 1.5 KB table of each previous move, so lookups stay in a few lines.
+ */
+using PieceToHistory = std::array<std::int16_t, kPieceToCount>;
+
+/**
+ * @brief Quiet-move histories keyed by the moves leading to the node, beyond the butterfly table.
+ */
+struct ContinuationHistories {
+    /** Tables following the moves played one and two plies earlier; null where there is none. */
+    std::array<const PieceToHistory*, 2> continuation{nullptr, nullptr};
+    PackedMove counter_move{};  /**< Quiet move that last refuted the previous move. */
+};
+
+/**
+ * @brief Staged, lazily generating move iterator used by the search.
+ *
+ * Moves are produced in the order TT move, winning or equal captures and promotions
+ * (MVV-LVA), killers, the counter move, quiet moves ordered by butterfly plus continuation
+ * history and finally the captures that lose material by static exchange evaluation. Each
+ * category is generated only when the previous one is exhausted, so a cutoff on the hash
+ * move or a capture never pays for quiet move generation or ordering. The quiescence
+ * constructor yields only the captures and promotions that do not lose material.
+ */
+class MovePicker {
+   public:
+    /**
+     * @brief Main search picker over every legal move.
+     */
+    MovePicker(const Board& board, PackedMove tt_move, const std::array<PackedMove, 2>& killers,
+               const ButterflyHistory& history, const ContinuationHistories& continuation = {});
+
+    /**
+     * @brief Quiescence picker over captures and promotions only.
+     */
+    explicit MovePicker(const Board& board);
+
+    /**
+     * @brief Produces the next move.
+     * @return False once every move of the enabled stages has been returned.
+     */
+    bool next(Move& move);
+
+    /**
+     * @brief Butterfly plus continuation history of the quiet @p move, as used for ordering.
+     */
+    [[nodiscard]] int quiet_score(PackedMove move) const;
+
+    /**
+     * @brief True once the picker has moved on to captures that lose material by SEE.
+     */
+    [[nodiscard]] bool in_bad_captures() const { return stage_ == Stage::BadCaptures; }
+
+   private:
+    enum class Stage { TTMove, GenerateCaptures, Captures, Killers, GenerateQuiets, Quiets, BadCaptures, Done };
+
+    [[nodiscard]] bool already_returned(PackedMove move) const;
+    void score_captures();
+    void score_quiets();
+
+    const Board& board_;
+    const ButterflyHistory* history_ = nullptr;
+    std::array<const PieceToHistory*, 2> continuation_{nullptr, nullptr};
+    PackedMove tt_move_{};
+    std::array<PackedMove, 3> killers_{};  // The two killers, then the counter move.
+    std::array<PackedMove, 3> played_killers_{};
+    Stage stage_ = Stage::TTMove;
+    bool captures_only_ = false;
+    std::size_t killer_index_ = 0;
+    std::size_t cursor_ = 0;
+    // Losing captures are parked at the front of moves_, ahead of the captures already returned.
+    std::size_t bad_captures_end_ = 0;
+    std::size_t bad_cursor_ = 0;
+    MoveList moves_;
+};
+
+}  // namespace chiron
@@ -57,7 +57,8 @@ std::string format_move(Board& board, const Move& move) {
     if (moving_piece != PieceType::Pawn) {
         san += piece_to_char(moving_piece);
 
-        auto legal_moves = MoveGenerator::generate_legal_moves(board);
+        MoveList legal_moves;
+        MoveGenerator::generate_legal_moves(board, legal_moves);
         bool needs_file = false;
         bool needs_rank = false;
         bool conflict = false;
@@ -102,7 +103,9 @@ std::string format_move(Board& board, const Move& move) {
     Board::State state;
     board.make_move(move, state);
     bool opponent_in_check = board.in_check(board.side_to_move());
-    bool opponent_has_moves = !MoveGenerator::generate_legal_moves(board).empty();
+    MoveList replies;
+    MoveGenerator::generate_legal_moves(board, replies);
+    bool opponent_has_moves = !replies.empty();
     board.undo_move(move, state);
 
     if (opponent_in_check) {
@@ -118,7 +121,8 @@ std::string move_to_san(Board& board, const Move& move) { return format_move(boa
 
 Move san_to_move(Board& board, const std::string& san) {
     const std::string canonical = canonicalize(san);
-    std::vector<Move> moves = MoveGenerator::generate_legal_moves(board);
+    MoveList moves;
+    MoveGenerator::generate_legal_moves(board, moves);
     for (const Move& move : moves) {
         std::string candidate = canonicalize(move_to_san(board, move));
         if (candidate == canonical) {
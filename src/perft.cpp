@@ -1,24 +1,175 @@
 #include "perft.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "board_stack.h"
+
 namespace chiron {
 
-std::uint64_t perft(Board& board, int depth) {
+namespace {
+
+std::uint64_t perft_stack(BoardStack& stack, int depth) {
+    MoveList moves;
+    MoveGenerator::generate_legal_moves(stack.top(), moves);
+    if (depth == 1) {
+        return moves.size();
+    }
+
+    std::uint64_t nodes = 0ULL;
+    for (const Move& move : moves) {
+        stack.push(move);
+        nodes += perft_stack(stack, depth - 1);
+        stack.pop();
+    }
+    return nodes;
+}
+
+/**
+ * @brief Caches subtree counts. Each slot stores the count and the check word key ^ count, so a
+ *        probe that sees a torn write from another thread fails verification instead of
+ *        returning a wrong count.
+ */
+class PerftTable {
+   public:
+    explicit PerftTable(std::size_t megabytes) {
+        std::size_t slots = std::max<std::size_t>(megabytes * 1024 * 1024 / sizeof(Slot), 1);
+        std::size_t size = 1;
+        while (size * 2 <= slots) {
+            size *= 2;
+        }
+        slots_ = std::make_unique<Slot[]>(size);
+        mask_ = size - 1;
+    }
+
+    [[nodiscard]] bool probe(std::uint64_t key, int depth, std::uint64_t& nodes) const {
+        std::uint64_t tagged = tag(key, depth);
+        const Slot& slot = slots_[tagged & mask_];
+        std::uint64_t check = slot.check.load(std::memory_order_relaxed);
+        std::uint64_t count = slot.nodes.load(std::memory_order_relaxed);
+        if ((check ^ count) != tagged) {
+            return false;
+        }
+        nodes = count;
+        return true;
+    }
+
+    void store(std::uint64_t key, int depth, std::uint64_t nodes) {
+        std::uint64_t tagged = tag(key, depth);
+        Slot& slot = slots_[tagged & mask_];
+        slot.check.store(tagged ^ nodes, std::memory_order_relaxed);
+        slot.nodes.store(nodes, std::memory_order_relaxed);
+    }
+
+   private:
+    struct Slot {
+        std::atomic<std::uint64_t> check{0};
+        std::atomic<std::uint64_t> nodes{0};
+    };
+
+    // Mixes the depth into the key so one position at two depths maps to different slots.
+    static std::uint64_t tag(std::uint64_t key, int depth) {
+        return key ^ (static_cast<std::uint64_t>(depth) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    std::size_t mask_ = 0;
+};
+
+std::uint64_t perft_hashed(Board& board, int depth, PerftTable* table) {
     if (depth == 0) {
         return 1ULL;
     }
 
-    std::vector<Move> moves;
+    std::uint64_t nodes = 0ULL;
+    if (depth > 1 && table != nullptr && table->probe(board.zobrist_key(), depth, nodes)) {
+        return nodes;
+    }
+
+    MoveList moves;
     MoveGenerator::generate_legal_moves(board, moves);
+    if (depth == 1) {
+        return moves.size();
+    }
 
-    std::uint64_t nodes = 0ULL;
     for (const Move& move : moves) {
         Board::State state;
         board.make_move(move, state);
-        nodes += perft(board, depth - 1);
+        nodes += perft_hashed(board, depth - 1, table);
         board.undo_move(move, state);
     }
+    if (table != nullptr) {
+        table->store(board.zobrist_key(), depth, nodes);
+    }
     return nodes;
 }
 
-}  // namespace chiron
+}  // namespace
+
+std::uint64_t perft(Board& board, int depth) {
+    return perft_hashed(board, depth, nullptr);
+}
+
+std::uint64_t perft_copy_make(const Board& board, int depth) {
+    if (depth == 0) {
+        return 1ULL;
+    }
+    BoardStack stack(board, static_cast<std::size_t>(depth));
+    return perft_stack(stack, depth);
+}
+
+std::uint64_t PerftResult::nodes_per_second() const {
+    auto ms = static_cast<std::uint64_t>(std::max<std::chrono::milliseconds::rep>(elapsed.count(), 1));
+    return nodes * 1000 / ms;
+}
 
+PerftResult perft_divide(const Board& board, const PerftConfig& config) {
+    auto start = std::chrono::steady_clock::now();
+    PerftResult result;
+    if (config.depth <= 0) {
+        result.nodes = 1;
+        return result;
+    }
+
+    for (const Move& move : MoveGenerator::generate_legal_moves(board)) {
+        result.divide.push_back({move, 0});
+    }
+    std::unique_ptr<PerftTable> table;
+    if (config.hash_mb > 0 && config.depth > 2) {
+        table = std::make_unique<PerftTable>(config.hash_mb);
+    }
+
+    std::atomic<std::size_t> next{0};
+    auto worker = [&]() {
+        Board local = board;
+        for (std::size_t index = next.fetch_add(1); index < result.divide.size(); index = next.fetch_add(1)) {
+            PerftDivideEntry& entry = result.divide[index];
+            Board::State state;
+            local.make_move(entry.move, state);
+            entry.nodes = perft_hashed(local, config.depth - 1, table.get());
+            local.undo_move(entry.move, state);
+        }
+    };
+
+    std::size_t thread_count = std::clamp<std::size_t>(static_cast<std::size_t>(std::max(config.threads, 1)), 1,
+                                                       std::max<std::size_t>(result.divide.size(), 1));
+    std::vector<std::thread> helpers;
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        helpers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+
+    for (const PerftDivideEntry& entry : result.divide) {
+        result.nodes += entry.nodes;
+    }
+    result.elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+}  // namespace chiron
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <vector>
 
 #include "board.h"
+#include "move.h"
 #include "movegen.h"
 
 namespace chiron {
@@ -12,5 +15,38 @@ namespace chiron {
  */
 std::uint64_t perft(Board& board, int depth);
 
-}  // namespace chiron
+/**
+ * @brief Same count as perft() but walks the tree with a BoardStack (copy-make) instead of
+ *        make/undo, so the two ways of stepping through positions can be benchmarked.
+ */
+std::uint64_t perft_copy_make(const Board& board, int depth);
+
+struct PerftConfig {
+    int depth = 1;
+    int threads = 1;          /**< Root moves are handed out to this many threads. */
+    std::size_t hash_mb = 0;  /**< Size of the shared subtree-count cache; 0 disables it. */
+};
+
+struct PerftDivideEntry {
+    Move move;
+    std::uint64_t nodes = 0;
+};
+
+struct PerftResult {
+    std::uint64_t nodes = 0;
+    std::vector<PerftDivideEntry> divide; /**< Per root move, in generation order. */
+    std::chrono::milliseconds elapsed{0};
 
+    [[nodiscard]] std::uint64_t nodes_per_second() const;
+};
+
+/**
+ * @brief Counts leaf nodes below every root move, splitting the root moves across threads.
+ *
+ * With PerftConfig::hash_mb set, subtree counts are cached by Zobrist key and remaining depth in a
+ * lock-free table shared by all threads, so transpositions are counted once. The totals equal
+ * perft() for the same position and depth.
+ */
+PerftResult perft_divide(const Board& board, const PerftConfig& config);
+
+}  // namespace chiron
@@ -3,15 +3,17 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <condition_variable>
 #include <cstring>
 #include <limits>
 #include <mutex>
 #include <numeric>
-#include <shared_mutex>
 #include <thread>
-#include <tuple>
 
+#include "allocation.h"
 #include "evaluation.h"
+#include "movepicker.h"
+#include "trace.h"
 
 namespace chiron {
 
@@ -20,53 +22,57 @@ namespace {
 constexpr int kInfinity = 32000;
 constexpr int kMateValue = 32000;
 constexpr int kMateScoreThreshold = kMateValue - 512;
+// Tablebase wins score just below mates, less the ply they are found at, so shorter paths into
+// a won ending are preferred; like mates they are stored in the TT relative to the node.
+constexpr int kTablebaseWin = kMateScoreThreshold - 1;
+constexpr int kTablebaseScoreThreshold = kMateScoreThreshold - 256;
 constexpr int kNullMoveReduction = 2;
+constexpr std::uint64_t kNodePollInterval = 256;  // Nodes between two checks of the stop conditions.
+constexpr int kContinuationLimit = 8000;          // Continuation entries saturate towards +-this.
+constexpr std::size_t kMaxTrackedQuiets = 32;     // Quiets per node penalised after a cutoff.
 
-enum class TTFlag : std::uint8_t { Empty = 0, Exact = 1, Alpha = 2, Beta = 3 };
+#ifdef CHIRON_SEARCH_STATS
+#define CHIRON_COUNT(ctx, counter) (++(ctx).stats.counter)
+#else
+#define CHIRON_COUNT(ctx, counter) ((void)0)
+#endif
 
-bool same_move(const Move& a, const Move& b) {
-    return a.from == b.from && a.to == b.to && a.promotion == b.promotion && a.flags == b.flags;
-}
 
 int to_tt_score(int score, int ply) {
-    if (score > kMateScoreThreshold) {
+    if (score > kTablebaseScoreThreshold) {
         return score + ply;
     }
-    if (score < -kMateScoreThreshold) {
+    if (score < -kTablebaseScoreThreshold) {
         return score - ply;
     }
     return score;
 }
 
 int from_tt_score(int score, int ply) {
-    if (score > kMateScoreThreshold) {
+    if (score > kTablebaseScoreThreshold) {
         return score - ply;
     }
-    if (score < -kMateScoreThreshold) {
+    if (score < -kTablebaseScoreThreshold) {
         return score + ply;
     }
     return score;
 }
 
-int mvv_lva(const Move& move, const Board& board) {
-    if (!move.is_capture()) {
-        return 0;
-    }
-    PieceType victim = move.is_en_passant() ? PieceType::Pawn : board.piece_type_at(move.to);
-    PieceType attacker = board.piece_type_at(move.from);
-    static constexpr int piece_values[] = {100, 320, 330, 500, 900, 20000};
-    int victim_score = piece_values[static_cast<int>(victim)];
-    int attacker_score = piece_values[static_cast<int>(attacker)];
-    return victim_score * 16 - attacker_score;
+/** @brief Index of @p move's (moving piece, destination) pair; call before the move is made. */
+int piece_to_index(const Board& board, const Move& move) {
+    return encode_piece(board.side_to_move(), board.piece_type_at(move.from)) * kBoardSize + move.to;
+}
+
+/** @brief Moves @p entry towards +-kContinuationLimit by @p bonus, less the further it already is. */
+void apply_gravity(std::int16_t& entry, int bonus) {
+    int value = entry + bonus - entry * std::abs(bonus) / kContinuationLimit;
+    entry = static_cast<std::int16_t>(std::clamp(value, -kContinuationLimit, kContinuationLimit));
 }
 
 }  // namespace
 
-Search::Search(std::size_t table_size, std::shared_ptr<nnue::Evaluator> evaluator) : evaluator_(std::move(evaluator)) {
-    if (table_size == 0) {
-        table_size = 1ULL;
-    }
-    table_.resize(table_size);
+Search::Search(std::size_t table_size, std::shared_ptr<nnue::Evaluator> evaluator)
+    : table_(table_size), evaluator_(std::move(evaluator)) {
     if (!evaluator_) {
         evaluator_ = global_evaluator();
     }
@@ -81,42 +87,75 @@ void Search::set_evaluator(std::shared_ptr<nnue::Evaluator> evaluator) {
     if (!evaluator_) {
         evaluator_ = global_evaluator();
     }
+    for (auto& ctx : contexts_) {
+        ctx.eval_cache.clear();
+    }
 }
 
-void Search::set_time_manager(TimeHeuristicConfig config) { time_manager_ = TimeManager(config); }
-
-void Search::set_table_size(std::size_t entries) {
-    if (entries == 0) {
-        entries = 1ULL;
+void Search::set_game_history(const std::vector<std::uint64_t>& keys) {
+    game_history_.clear();
+    for (std::uint64_t key : keys) {
+        game_history_.push(key);
     }
-    std::unique_lock lock(tt_mutex_);
-    table_.assign(entries, {});
-    generation_ = 0;
 }
 
-void Search::set_table_size_mb(std::size_t megabytes) {
-    std::size_t bytes = megabytes * 1024ULL * 1024ULL;
-    std::size_t entries = bytes / sizeof(TTEntry);
-    if (entries == 0) {
-        entries = 1ULL;
-    }
-    set_table_size(entries);
+void Search::set_pawn_structure_weight(int percent) {
+    pawn_structure_weight_ = std::max(0, percent);
+    clear();
+}
+
+void Search::set_continuation_history(bool enabled) { continuation_history_ = enabled; }
+
+void Search::set_tablebases(std::shared_ptr<const SyzygyTablebases> tablebases) {
+    tablebases_ = std::move(tablebases);
+}
+
+void Search::set_analysis_cache(std::shared_ptr<AnalysisCache> cache) { analysis_cache_ = std::move(cache); }
+
+void Search::save_table(const std::string& path) const { table_.save(path); }
+
+void Search::load_table(const std::string& path) {
+    table_.load(path);
+    previous_pv_.clear();
+    previous_pv_keys_.clear();
 }
 
+void Search::set_time_manager(TimeHeuristicConfig config) { time_manager_ = TimeManager(config); }
+
+void Search::set_table_size(std::size_t entries) { table_.resize(entries); }
+
+void Search::set_table_size_mb(std::size_t megabytes) { table_.resize_mb(megabytes); }
+
+Search::~Search() { shutdown_helpers(); }
+
 void Search::set_threads(int threads) {
+    shutdown_helpers();
     thread_count_ = std::max(1, threads);
     contexts_.resize(static_cast<std::size_t>(thread_count_));
     for (auto& ctx : contexts_) {
         ensure_context_capacity(ctx, 128);
         reset_context(ctx);
     }
+    helpers_.reserve(static_cast<std::size_t>(thread_count_ - 1));
+    for (int i = 1; i < thread_count_; ++i) {
+        helpers_.emplace_back(&Search::helper_loop, this, i, search_id_);
+    }
 }
 
 void Search::clear() {
-    for (auto& entry : table_) {
-        entry = TTEntry{};
+    table_.clear();
+    previous_pv_.clear();
+    previous_pv_keys_.clear();
+    for (auto& ctx : contexts_) {
+        reset_context(ctx);
+        ctx.eval_cache.clear();
     }
-    generation_ = 0;
+}
+
+void Search::new_game() {
+    table_.new_game();
+    previous_pv_.clear();
+    previous_pv_keys_.clear();
     for (auto& ctx : contexts_) {
         reset_context(ctx);
     }
@@ -134,6 +173,7 @@ SearchResult Search::search(Board& board, const SearchLimits& limits, std::atomi
 
 SearchResult Search::search_impl(Board& board, const SearchLimits& limits, std::atomic<bool>& stop_flag,
                                  const InfoCallback& info_cb) {
+    trace::Span span("search");
     if (!evaluator_) {
         evaluator_ = global_evaluator();
     }
@@ -142,106 +182,130 @@ SearchResult Search::search_impl(Board& board, const SearchLimits& limits, std::
     info_callback_ = info_cb;
     stop_signal_ = &stop_flag;
     node_limit_ = limits.node_limit;
-    start_time_ = std::chrono::steady_clock::now();
-    time_limit_ = limits.infinite ? std::chrono::milliseconds::zero() : compute_time_budget(board, limits);
+    soft_node_limit_ = limits.soft_node_limit;
+    limit_reached_.store(false, std::memory_order_relaxed);
+    if (!clock_prepared_) {
+        prepare_clock(limits.ponder);
+    }
+    clock_prepared_ = false;
+    TimeBudget budget = compute_time_budget(board, limits);
+    time_limit_ = std::chrono::milliseconds(budget.hard_ms);
+    soft_time_limit_ = std::chrono::milliseconds(budget.soft_ms);
+    // A fixed movetime is spent as given; only a clock lets the search stop early or run long.
+    bool manage_time = budget.soft_ms < budget.hard_ms;
     nodes_total_.store(0, std::memory_order_relaxed);
     seldepth_total_.store(0, std::memory_order_relaxed);
-    generation_ = (generation_ + 1) & 0xFFU;
+    eval_probes_total_.store(0, std::memory_order_relaxed);
+    eval_hits_total_.store(0, std::memory_order_relaxed);
+    tb_hits_total_.store(0, std::memory_order_relaxed);
+    table_.new_search();
 
     int max_depth = std::clamp(limits.max_depth, 1, 128);
+    // History carries over from the previous search at half weight. Killers are kept per ply, so
+    // they follow the root down the previous principal variation and are dropped elsewhere.
+    int pv_offset = previous_pv_offset(board.zobrist_key());
     for (auto& ctx : contexts_) {
         ensure_context_capacity(ctx, max_depth);
-        ctx.repetition_stack.clear();
-        ctx.repetition_stack.reserve(512);
-        std::fill(ctx.killer_moves.begin(), ctx.killer_moves.end(), std::array<Move, 2>{});
-        std::memset(ctx.history, 0, sizeof(ctx.history));
+        ctx.eval_cache.sync(evaluator_->network_generation());
+        ctx.key_history.clear();
+        ctx.pending_nodes = 0;
+        ctx.pending_eval_probes = 0;
+        ctx.pending_eval_hits = 0;
+        ctx.pending_tb_hits = 0;
+        ctx.nodes = 0;
+        ctx.root_nodes = 0;
+        ctx.root_best_nodes = 0;
+        ctx.stats = SearchStats{};
+        if (pv_offset < 0) {
+            std::fill(ctx.killer_moves.begin(), ctx.killer_moves.end(), std::array<PackedMove, 2>{});
+        } else if (pv_offset > 0) {
+            auto offset = std::min(static_cast<std::size_t>(pv_offset), ctx.killer_moves.size());
+            std::move(ctx.killer_moves.begin() + static_cast<std::ptrdiff_t>(offset), ctx.killer_moves.end(),
+                      ctx.killer_moves.begin());
+            std::fill(ctx.killer_moves.end() - static_cast<std::ptrdiff_t>(offset), ctx.killer_moves.end(),
+                      std::array<PackedMove, 2>{});
+        }
+        for (auto& from : ctx.history) {
+            for (auto& to : from) {
+                for (int& entry : to) {
+                    entry /= 2;
+                }
+            }
+        }
+        for (PieceToHistory& table : ctx.continuation_history) {
+            for (std::int16_t& entry : table) {
+                entry = static_cast<std::int16_t>(entry / 2);
+            }
+        }
     }
 
     ThreadContext& main_ctx = contexts_.front();
-    main_ctx.repetition_stack.push_back(board.zobrist_key());
-
+    seed_history(main_ctx, board);
     evaluator_->build_accumulator(board, main_ctx.accumulator_stack[0]);
-    for (std::size_t i = 1; i < contexts_.size(); ++i) {
-        contexts_[i].accumulator_stack[0] = main_ctx.accumulator_stack[0];
-        contexts_[i].repetition_stack.push_back(board.zobrist_key());
+
+    tablebase_root_moves_.clear();
+    probe_tablebases_in_tree_ = tablebases_ && tablebases_->max_pieces() > 0;
+    if (probe_tablebases_in_tree_ && tablebases_->may_cover(board)) {
+        if (auto root = tablebases_->probe_root(board, main_ctx.key_history)) {
+            ++main_ctx.pending_tb_hits;
+            for (const Move& move : root->moves) {
+                tablebase_root_moves_.push_back(pack_move(move));
+            }
+            // DTZ ranking already keeps the result; WDL alone still needs the tree to find the
+            // conversion, and drawn or lost roots gain nothing from probes.
+            probe_tablebases_in_tree_ = !root->used_dtz && root->wdl == Wdl::Win;
+        }
     }
 
+    int line_count = 0;
+    if (limits.multi_pv > 1) {
+        MoveList root_moves;
+        MoveGenerator::generate_legal_moves(board, root_moves);
+        line_count = static_cast<int>(tablebase_root_moves_.empty() ? root_moves.size() : tablebase_root_moves_.size());
+    }
+    line_count = std::clamp(line_count, 1, std::max(1, limits.multi_pv));
+
     SearchResult best{};
     Move last_best{};
-    int aspiration = 18;
     int previous_score = 0;
+    int first_depth = 1;
+    if (line_count == 1) {
+        first_depth = seed_from_previous_pv(board, pv_offset, max_depth, best);
+    }
+    if (first_depth > 1) {
+        last_best = best.best_move;
+        previous_score = best.score;
+    } else if (line_count == 1) {
+        previous_score = seed_from_analysis_cache(board).value_or(previous_score);
+    }
+
+    start_helpers(board, max_depth, first_depth);
     std::vector<std::pair<Move, int>> iteration_root_moves;
+    std::vector<std::pair<Move, int>> line_root_moves;
+    IterationSignals signals;
+    std::chrono::milliseconds last_iteration_time{0};
+    std::chrono::milliseconds last_iteration_end{0};
 
-    for (int depth = 1; depth <= max_depth; ++depth) {
+    for (int depth = first_depth; depth <= max_depth; ++depth) {
+        poll_limits(main_ctx);
         if (should_stop()) {
             break;
         }
 
-        for (auto& ctx : contexts_) {
-            if (ctx.repetition_stack.empty()) {
-                ctx.repetition_stack.push_back(board.zobrist_key());
-            } else {
-                ctx.repetition_stack[0] = board.zobrist_key();
-            }
-            ctx.repetition_stack.resize(1);
-            ctx.accumulator_stack[0] = main_ctx.accumulator_stack[0];
-        }
-
-        int alpha = std::max(-kInfinity, previous_score - aspiration);
-        int beta = std::min(kInfinity, previous_score + aspiration);
-        int score = 0;
-        bool completed_window = false;
-
         Move iteration_best{};
-        while (true) {
-            score = search_root(main_ctx, board, depth, alpha, beta, iteration_best, iteration_root_moves);
-            if (stop_flag.load()) {
-                break;
-            }
-
-            bool widened = false;
-            if (score <= alpha) {
-                if (alpha <= -kInfinity) {
-                    completed_window = true;
-                    break;
-                }
-                alpha = std::max(-kInfinity, alpha - aspiration);
-                widened = true;
-            } else if (score >= beta) {
-                if (beta >= kInfinity) {
-                    completed_window = true;
-                    break;
-                }
-                beta = std::min(kInfinity, beta + aspiration);
-                widened = true;
-            } else {
-                completed_window = true;
-                break;
-            }
-
-            if (widened) {
-                aspiration = std::min(aspiration * 2, kInfinity);
-                if (aspiration > kInfinity / 2) {
-                    alpha = -kInfinity;
-                    beta = kInfinity;
-                }
-            }
-
-            if (should_stop()) {
-                break;
-            }
-        }
-
-        if (stop_flag.load()) {
-            break;
-        }
-
+        bool completed_window = false;
+        int score = search_iteration(main_ctx, board, depth, previous_score, iteration_best, iteration_root_moves, {},
+                                     completed_window);
         if (!completed_window) {
             break;
         }
 
+        int score_drop = depth > first_depth ? previous_score - score : 0;
         previous_score = score;
-        aspiration = 18;
+        poll_limits(main_ctx);
+        Move previous_best = best.best_move;
+        std::uint64_t root_nodes = main_ctx.root_nodes;
+        std::uint64_t root_best_nodes = main_ctx.root_best_nodes;
 
         best.depth = depth;
         best.score = score;
@@ -250,6 +314,10 @@ SearchResult Search::search_impl(Board& board, const SearchLimits& limits, std::
         best.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time_);
         best.pv = extract_pv(board);
         best.root_moves = iteration_root_moves;
+        best.hashfull = table_.hashfull();
+        best.eval_probes = eval_probes_total_.load(std::memory_order_relaxed);
+        best.eval_hits = eval_hits_total_.load(std::memory_order_relaxed);
+        best.tb_hits = tb_hits_total_.load(std::memory_order_relaxed);
         if (!best.pv.empty()) {
             best.best_move = best.pv.front();
             last_best = best.best_move;
@@ -260,157 +328,351 @@ SearchResult Search::search_impl(Board& board, const SearchLimits& limits, std::
             best.best_move = last_best;
         }
 
+        // Further MultiPV lines search the root again without the moves already reported, with
+        // the TT and history the first line left behind, and aspiration windows of their own.
+        std::vector<SearchLine> previous_lines = std::move(best.lines);
+        best.lines.clear();
+        if (!best.pv.empty() || best.best_move.from != 0 || best.best_move.to != 0) {
+            best.lines.push_back({best.score, best.pv.empty() ? std::vector<Move>{best.best_move} : best.pv});
+        }
+        std::vector<PackedMove> excluded;
+        for (int index = 1; index < line_count && !best.lines.empty(); ++index) {
+            excluded.push_back(pack_move(best.lines.back().pv.front()));
+            int line_previous = index < static_cast<int>(previous_lines.size()) ? previous_lines[index].score : score;
+            Move line_best{};
+            bool line_completed = false;
+            int line_score = search_iteration(main_ctx, board, depth, line_previous, line_best, line_root_moves,
+                                              excluded, line_completed);
+            if (!line_completed || (line_best.from == 0 && line_best.to == 0)) {
+                break;
+            }
+            SearchLine line{line_score, {line_best}};
+            Board child = board;
+            Board::State state;
+            child.make_move(line_best, state);
+            std::vector<Move> continuation = extract_pv(child);
+            line.pv.insert(line.pv.end(), continuation.begin(), continuation.end());
+            best.lines.push_back(std::move(line));
+        }
+        if (line_count > 1 && !best.lines.empty()) {
+            std::stable_sort(best.lines.begin(), best.lines.end(),
+                             [](const SearchLine& lhs, const SearchLine& rhs) { return lhs.score > rhs.score; });
+            // An interrupted iteration keeps the previous depth's lines, after its own, for the
+            // moves it did not reach.
+            for (SearchLine& line : previous_lines) {
+                if (static_cast<int>(best.lines.size()) >= line_count) {
+                    break;
+                }
+                bool reported = std::any_of(best.lines.begin(), best.lines.end(), [&](const SearchLine& current) {
+                    return pack_move(current.pv.front()) == pack_move(line.pv.front());
+                });
+                if (!reported) {
+                    best.lines.push_back(std::move(line));
+                }
+            }
+            best.score = best.lines.front().score;
+            best.pv = best.lines.front().pv;
+            best.best_move = best.pv.front();
+            last_best = best.best_move;
+            best.nodes = nodes_total_.load(std::memory_order_relaxed);
+            best.seldepth = seldepth_total_.load(std::memory_order_relaxed);
+            best.elapsed =
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time_);
+        }
+
         if (info_callback_) {
             info_callback_(best);
         }
 
-        if (std::abs(score) > kMateScoreThreshold) {
+        if (line_count == 1 && std::abs(score) > kMateScoreThreshold) {
             break;
         }
-        if (node_limit_ && nodes_total_.load(std::memory_order_relaxed) >= node_limit_) {
+        std::uint64_t nodes = nodes_total_.load(std::memory_order_relaxed);
+        if ((node_limit_ && nodes >= node_limit_) || (soft_node_limit_ && nodes >= soft_node_limit_)) {
             break;
         }
+
+        if (manage_time) {
+            signals.best_move_changes *= 0.5;
+            if (depth > 1 && pack_move(best.best_move) != pack_move(previous_best)) {
+                signals.best_move_changes += 1.0;
+            }
+            signals.score_drop = score_drop;
+            signals.best_move_node_share =
+                root_nodes > 0 ? static_cast<double>(root_best_nodes) / static_cast<double>(root_nodes) : 0.0;
+            // Shallow iterations are too noisy to steer by and too quick to matter.
+            auto soft_limit = soft_time_limit_;
+            if (depth >= 4) {
+                soft_limit = std::min(time_limit_, std::chrono::milliseconds(static_cast<std::int64_t>(
+                                                       static_cast<double>(soft_limit.count()) *
+                                                       time_manager_.soft_scale(signals))));
+            }
+            // Each iteration costs a few times the previous one; one that would be cut off by the
+            // hard limit is not worth starting.
+            auto iteration_time = best.elapsed - last_iteration_end;
+            double growth = last_iteration_time.count() > 0
+                                ? std::clamp(static_cast<double>(iteration_time.count()) /
+                                                 static_cast<double>(last_iteration_time.count()),
+                                             1.5, 4.0)
+                                : 2.0;
+            auto predicted_end = best.elapsed + std::chrono::milliseconds(static_cast<std::int64_t>(
+                                                    static_cast<double>(iteration_time.count()) * growth));
+            last_iteration_time = iteration_time;
+            last_iteration_end = best.elapsed;
+            // Time spent pondering counts towards the soft limit; the hard one restarts at ponderhit.
+            if (!pondering_.load(std::memory_order_acquire) &&
+                (best.elapsed >= soft_limit || predicted_end > time_limit_ + ponderhit_time())) {
+                break;
+            }
+        }
+    }
+
+    stop_helpers();
+    // A ponder search may not report its move before the opponent has played it (ponderhit) or
+    // the GUI gives up on it (stop), however early it ran out of depth.
+    while (pondering_.load(std::memory_order_acquire) && !(stop_signal_ && stop_signal_->load())) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    pondering_.store(false, std::memory_order_relaxed);
+    poll_limits(main_ctx);
+    for (const ThreadContext& ctx : contexts_) {
+        best.stats += ctx.stats;
     }
 
     if ((best.best_move.from == 0 && best.best_move.to == 0) && (last_best.from != 0 || last_best.to != 0)) {
         best.best_move = last_best;
     }
 
+    // Helpers keep searching until they are parked, so report the final node count.
+    best.nodes = std::max(best.nodes, nodes_total_.load(std::memory_order_relaxed));
+    best.eval_probes = std::max(best.eval_probes, eval_probes_total_.load(std::memory_order_relaxed));
+    best.eval_hits = std::max(best.eval_hits, eval_hits_total_.load(std::memory_order_relaxed));
+    best.tb_hits = std::max(best.tb_hits, tb_hits_total_.load(std::memory_order_relaxed));
     if (best.elapsed.count() == 0) {
         best.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time_);
     }
 
+    if (analysis_cache_ && best.depth > 0) {
+        analysis_cache_->record(board.zobrist_key(), {pack_move(best.best_move), best.depth, best.score});
+    }
+    remember_pv(board, best.pv);
     return best;
 }
 
-int Search::search_root(ThreadContext& ctx, Board& board, int depth, int alpha, int beta, Move& best_move,
-                        std::vector<std::pair<Move, int>>& root_scores) {
-    TTEntry tt_entry;
-    Move hash_move{};
-    if (probe_tt(board.zobrist_key(), 0, tt_entry)) {
-        hash_move = tt_entry.move;
-    }
+void Search::ponderhit() {
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time_);
+    ponderhit_ms_.store(elapsed.count(), std::memory_order_relaxed);
+    pondering_.store(false, std::memory_order_release);
+}
 
-    std::vector<Move> moves = MoveGenerator::generate_legal_moves(board);
-    if (moves.empty()) {
-        if (board.in_check(board.side_to_move())) {
-            return -kMateValue + 1;
-        }
-        best_move = Move{};
-        return 0;
-    }
+void Search::prepare_clock(bool ponder) {
+    start_time_ = std::chrono::steady_clock::now();
+    ponderhit_ms_.store(0, std::memory_order_relaxed);
+    pondering_.store(ponder, std::memory_order_release);
+    clock_prepared_ = true;
+}
+
+std::chrono::milliseconds Search::ponderhit_time() const {
+    return std::chrono::milliseconds(ponderhit_ms_.load(std::memory_order_relaxed));
+}
 
-    std::stable_sort(moves.begin(), moves.end(), [&](const Move& lhs, const Move& rhs) {
-        if (same_move(lhs, hash_move) != same_move(rhs, hash_move)) {
-            return same_move(lhs, hash_move);
+int Search::search_iteration(ThreadContext& ctx, Board& board, int depth, int previous_score, Move& best_move,
+                             std::vector<std::pair<Move, int>>& root_scores, const std::vector<PackedMove>& excluded,
+                             bool& completed) {
+    int aspiration = 18;
+    int alpha = std::max(-kInfinity, previous_score - aspiration);
+    int beta = std::min(kInfinity, previous_score + aspiration);
+    completed = false;
+
+    while (true) {
+        ctx.key_history.truncate(ctx.history_root);
+        int score = search_root(ctx, board, depth, alpha, beta, best_move, root_scores, excluded);
+        if (should_stop()) {
+            return score;
         }
-        int lhs_score = 0;
-        int rhs_score = 0;
-        if (lhs.is_capture() || rhs.is_capture()) {
-            lhs_score = mvv_lva(lhs, board);
-            rhs_score = mvv_lva(rhs, board);
+
+        if (score <= alpha) {
+            if (alpha <= -kInfinity) {
+                completed = true;
+                return score;
+            }
+            alpha = std::max(-kInfinity, alpha - aspiration);
+        } else if (score >= beta) {
+            if (beta >= kInfinity) {
+                completed = true;
+                return score;
+            }
+            beta = std::min(kInfinity, beta + aspiration);
         } else {
-            lhs_score = history_score(ctx, lhs, board.side_to_move());
-            rhs_score = history_score(ctx, rhs, board.side_to_move());
+            completed = true;
+            return score;
         }
-        return lhs_score > rhs_score;
-    });
 
-    int alpha_original = alpha;
-    int best_score = -kInfinity;
-    best_move = Move{};
+        aspiration = std::min(aspiration * 2, kInfinity);
+        if (aspiration > kInfinity / 2) {
+            alpha = -kInfinity;
+            beta = kInfinity;
+        }
+    }
+}
+
+void Search::start_helpers(const Board& board, int max_depth, int first_depth) {
+    if (helpers_.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    root_board_ = board;
+    root_max_depth_ = max_depth;
+    root_first_depth_ = first_depth;
+    abort_helpers_.store(false, std::memory_order_relaxed);
+    helpers_running_ = static_cast<int>(helpers_.size());
+    ++search_id_;
+    pool_cv_.notify_all();
+}
+
+void Search::stop_helpers() {
+    if (helpers_.empty()) {
+        return;
+    }
+    abort_helpers_.store(true, std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    idle_cv_.wait(lock, [&]() { return helpers_running_ == 0; });
+    abort_helpers_.store(false, std::memory_order_relaxed);
+}
 
-    std::atomic<std::size_t> next_index{1};
-    std::atomic<int> shared_alpha{alpha};
-    std::atomic<bool> cutoff{alpha >= beta};
-    std::mutex best_mutex;
-    std::vector<std::thread> workers;
-    std::vector<std::pair<Move, int>> scored_moves(moves.size());
-    std::vector<bool> evaluated(moves.size(), false);
-
-    auto finalize_scores = [&]() {
-        root_scores.clear();
-        root_scores.reserve(moves.size());
-        for (std::size_t i = 0; i < moves.size(); ++i) {
-            if (i < evaluated.size() && evaluated[i]) {
-                root_scores.push_back(scored_moves[i]);
+void Search::helper_loop(int index, std::uint64_t seen_id) {
+    // Helpers are spread over the NUMA nodes; the main thread stays wherever the caller runs it.
+    bind_thread_to_numa_node(index);
+    while (true) {
+        Board board;
+        int max_depth = 0;
+        int first_depth = 1;
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex_);
+            pool_cv_.wait(lock, [&]() { return shutdown_ || search_id_ != seen_id; });
+            if (shutdown_) {
+                return;
             }
+            seen_id = search_id_;
+            board = root_board_;
+            max_depth = root_max_depth_;
+            first_depth = root_first_depth_;
         }
-        std::sort(root_scores.begin(), root_scores.end(), [](const auto& lhs, const auto& rhs) {
-            return lhs.second > rhs.second;
-        });
-    };
-
-    // Evaluate the first move on the calling thread to seed alpha with a good bound.
-    if (!moves.empty()) {
-        const Move& first = moves.front();
-        int value = search_root_worker(ctx, board, first, depth, alpha, beta);
-        best_score = value;
-        best_move = first;
-        if (!scored_moves.empty()) {
-            scored_moves[0] = {first, value};
-            evaluated[0] = true;
-        }
-        alpha = std::max(alpha, value);
-        shared_alpha.store(alpha, std::memory_order_relaxed);
-        if (value >= beta) {
-            TTFlag flag = TTFlag::Beta;
-            store_tt(board.zobrist_key(), depth, best_score, best_move, static_cast<std::uint8_t>(flag), 0);
-            finalize_scores();
-            return best_score;
-        }
-    }
-
-    auto worker_fn = [&](int context_index) {
-        ThreadContext& worker_ctx = contexts_[static_cast<std::size_t>(context_index)];
-        while (true) {
-            if (cutoff.load(std::memory_order_relaxed) || should_stop()) {
-                break;
-            }
-            std::size_t idx = next_index.fetch_add(1, std::memory_order_relaxed);
-            if (idx >= moves.size()) {
+
+        ThreadContext& ctx = contexts_[static_cast<std::size_t>(index)];
+        seed_history(ctx, board);
+        evaluator_->build_accumulator(board, ctx.accumulator_stack[0]);
+
+        // Odd helpers start one ply deeper so threads desynchronise and fill the shared table
+        // with different subtrees instead of duplicating the main thread's work.
+        int previous_score = 0;
+        Move best_move{};
+        std::vector<std::pair<Move, int>> root_scores;
+        for (int depth = first_depth + (index & 1); depth <= max_depth; ++depth) {
+            if (should_stop()) {
                 break;
             }
-            int local_alpha = shared_alpha.load(std::memory_order_relaxed);
-            int value = search_root_worker(worker_ctx, board, moves[idx], depth, local_alpha, beta);
-            if (stop_signal_ && stop_signal_->load()) {
+            bool completed = false;
+            int score = search_iteration(ctx, board, depth, previous_score, best_move, root_scores, {}, completed);
+            if (!completed) {
                 break;
             }
-            if (idx < scored_moves.size()) {
-                scored_moves[idx] = {moves[idx], value};
-                evaluated[idx] = true;
-            }
-            {
-                std::lock_guard<std::mutex> lock(best_mutex);
-                if (value > best_score) {
-                    best_score = value;
-                    best_move = moves[idx];
-                }
-                int current_alpha = shared_alpha.load(std::memory_order_relaxed);
-                if (value > current_alpha) {
-                    shared_alpha.store(value, std::memory_order_relaxed);
-                }
-                if (value >= beta) {
-                    cutoff.store(true, std::memory_order_relaxed);
-                }
-            }
+            previous_score = score;
         }
-    };
+        poll_limits(ctx);
 
-    for (int i = 1; i < thread_count_; ++i) {
-        workers.emplace_back(worker_fn, i);
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        if (--helpers_running_ == 0) {
+            idle_cv_.notify_all();
+        }
     }
+}
 
-    worker_fn(0);
-
-    for (auto& thread : workers) {
+void Search::shutdown_helpers() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        shutdown_ = true;
+        pool_cv_.notify_all();
+    }
+    for (auto& thread : helpers_) {
         if (thread.joinable()) {
             thread.join();
         }
     }
+    helpers_.clear();
+    shutdown_ = false;
+}
+
+int Search::search_root(ThreadContext& ctx, Board& board, int depth, int alpha, int beta, Move& best_move,
+                        std::vector<std::pair<Move, int>>& root_scores, const std::vector<PackedMove>& excluded) {
+    TTEntry tt_entry;
+    PackedMove hash_move{};
+    if (probe_tt(board.zobrist_key(), 0, tt_entry)) {
+        hash_move = tt_entry.move;
+    }
+
+    MovePicker picker(board, hash_move, ctx.killer_moves[0], ctx.history);
+    int alpha_original = alpha;
+    int best_score = -kInfinity;
+    best_move = Move{};
+    root_scores.clear();
+    std::uint64_t root_start = ctx.nodes + ctx.pending_nodes;
+    std::uint64_t best_nodes = 0;
+
+    Move move;
+    int move_count = 0;
+    while (picker.next(move)) {
+        if (!excluded.empty() && std::find(excluded.begin(), excluded.end(), pack_move(move)) != excluded.end()) {
+            continue;
+        }
+        if (!tablebase_root_moves_.empty() &&
+            std::find(tablebase_root_moves_.begin(), tablebase_root_moves_.end(), pack_move(move)) ==
+                tablebase_root_moves_.end()) {
+            continue;
+        }
+        int value = 0;
+        std::uint64_t move_start = ctx.nodes + ctx.pending_nodes;
+        if (move_count++ == 0) {
+            value = search_root_worker(ctx, board, move, depth, alpha, beta);
+        } else {
+            value = search_root_worker(ctx, board, move, depth, alpha, alpha + 1);
+            if (value > alpha && value < beta && !should_stop()) {
+                value = search_root_worker(ctx, board, move, depth, alpha, beta);
+            }
+        }
+        if (should_stop()) {
+            break;
+        }
+        root_scores.emplace_back(move, value);
+        if (value > best_score) {
+            best_score = value;
+            best_move = move;
+            best_nodes = ctx.nodes + ctx.pending_nodes - move_start;
+        }
+        if (value > alpha) {
+            alpha = value;
+        }
+        if (alpha >= beta) {
+            break;
+        }
+    }
+
+    if (move_count == 0) {
+        return board.in_check(board.side_to_move()) ? -kMateValue + 1 : 0;
+    }
+    if (excluded.empty()) {
+        ctx.root_nodes = ctx.nodes + ctx.pending_nodes - root_start;
+        ctx.root_best_nodes = best_nodes;
+    }
+
+    std::stable_sort(root_scores.begin(), root_scores.end(),
+                     [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
 
     if (best_score == -kInfinity) {
-        best_score = alpha;
+        return alpha;
+    }
+    if (!excluded.empty()) {
+        return best_score;  // Not the root's real score or best move; the first line's entry stays.
     }
 
     TTFlag flag = TTFlag::Exact;
@@ -420,7 +682,6 @@ int Search::search_root(ThreadContext& ctx, Board& board, int depth, int alpha,
         flag = TTFlag::Beta;
     }
     store_tt(board.zobrist_key(), depth, best_score, best_move, static_cast<std::uint8_t>(flag), 0);
-    finalize_scores();
     return best_score;
 }
 
@@ -429,23 +690,19 @@ int Search::search_root_worker(ThreadContext& ctx, Board& board, const Move& mov
         return 0;
     }
 
-    if (ctx.repetition_stack.empty()) {
-        ctx.repetition_stack.push_back(board.zobrist_key());
-    } else {
-        ctx.repetition_stack[0] = board.zobrist_key();
-    }
-    ctx.repetition_stack.resize(1);
+    ctx.key_history.truncate(ctx.history_root);
 
-    evaluator_->update_accumulator(board, move, ctx.accumulator_stack[0], ctx.accumulator_stack[1]);
+    evaluator_->record_move(board, move, ctx.accumulator_stack[1]);
+    ctx.stack[0].piece_to = piece_to_index(board, move);
 
     Board local_board = board;
     Board::State state;
     local_board.make_move(move, state);
-    ctx.repetition_stack.push_back(local_board.zobrist_key());
+    ctx.key_history.push(local_board.zobrist_key());
 
     int value = -negamax(ctx, local_board, depth - 1, -beta, -alpha, true, 1);
 
-    ctx.repetition_stack.pop_back();
+    ctx.key_history.pop();
     return value;
 }
 
@@ -455,7 +712,7 @@ int Search::negamax(ThreadContext& ctx, Board& board, int depth, int alpha, int
     }
 
     atomic_max(seldepth_total_, ply);
-    nodes_total_.fetch_add(1, std::memory_order_relaxed);
+    count_node(ctx);
 
     bool in_check = board.in_check(board.side_to_move());
     ctx.stack[ply].in_check = in_check;
@@ -467,14 +724,50 @@ int Search::negamax(ThreadContext& ctx, Board& board, int depth, int alpha, int
     if (board.halfmove_clock() >= 100) {
         return 0;
     }
-    if (std::count(ctx.repetition_stack.begin(), ctx.repetition_stack.end(), board.zobrist_key()) >= 3) {
+    if (ctx.key_history.repetitions(board.halfmove_clock()) >= 2) {
         return 0;
     }
 
+    // Right after a capture or pawn move the fifty-move counter is zero, so the WDL result is
+    // exact; cursed wins and blessed losses count as (nearly) drawn. A win or loss that does not
+    // cut off still bounds the score the moves below can return.
+    int tablebase_floor = -kInfinity;
+    int tablebase_ceiling = kInfinity;
+    if (probe_tablebases_in_tree_ && board.halfmove_clock() == 0 && tablebases_->may_cover(board)) {
+        if (std::optional<Wdl> wdl = tablebases_->probe_wdl(board)) {
+            ++ctx.pending_tb_hits;
+            int result = static_cast<int>(*wdl);
+            int value = 2 * result;
+            TTFlag bound = TTFlag::Exact;
+            if (*wdl == Wdl::Win) {
+                value = kTablebaseWin - ply;
+                bound = TTFlag::Beta;
+            } else if (*wdl == Wdl::Loss) {
+                value = -kTablebaseWin + ply;
+                bound = TTFlag::Alpha;
+            }
+            if (bound == TTFlag::Exact || (bound == TTFlag::Beta ? value >= beta : value <= alpha)) {
+                store_tt(board.zobrist_key(), std::min(depth + 6, 127), value, Move{}, static_cast<std::uint8_t>(bound),
+                         ply);
+                return value;
+            }
+            if (bound == TTFlag::Beta) {
+                tablebase_floor = value;
+                alpha = std::max(alpha, value);
+            } else {
+                tablebase_ceiling = value;
+            }
+        }
+    }
+
     TTEntry tt_entry;
-    Move tt_move{};
+    PackedMove tt_move{};
+    int tt_eval = kNoTTEval;
+    CHIRON_COUNT(ctx, tt_probes);
     if (probe_tt(board.zobrist_key(), ply, tt_entry)) {
+        CHIRON_COUNT(ctx, tt_hits);
         tt_move = tt_entry.move;
+        tt_eval = tt_entry.eval;
         if (tt_entry.depth >= depth) {
             if (tt_entry.flag == static_cast<std::uint8_t>(TTFlag::Exact)) {
                 return tt_entry.score;
@@ -488,77 +781,67 @@ int Search::negamax(ThreadContext& ctx, Board& board, int depth, int alpha, int
         }
     }
 
-    int static_eval = evaluator_->evaluate(board, ctx.accumulator_stack[ply]);
+    // Accumulator updates are deferred until here, so TT cutoffs and draws never pay for them.
+    int static_eval = static_evaluation(ctx, board, ply, tt_eval);
     ctx.stack[ply].static_eval = static_eval;
     int alpha_original = alpha;
 
     if (!in_check && allow_null && depth >= 3 && static_eval >= beta) {
-        ctx.accumulator_stack[ply + 1] = ctx.accumulator_stack[ply];
+        CHIRON_COUNT(ctx, null_move_tries);
+        evaluator_->record_null_move(ctx.accumulator_stack[ply + 1]);
+        ctx.stack[ply].piece_to = -1;
         Board::State state;
         board.make_null_move(state);
-        ctx.repetition_stack.push_back(board.zobrist_key());
+        ctx.key_history.push(board.zobrist_key());
         int null_score = -negamax(ctx, board, depth - 1 - kNullMoveReduction, -beta, -beta + 1, false, ply + 1);
-        ctx.repetition_stack.pop_back();
+        ctx.key_history.pop();
         board.undo_null_move(state);
         if (null_score >= beta) {
+            CHIRON_COUNT(ctx, null_move_cutoffs);
             return beta;
         }
     }
 
-    std::vector<Move> moves = MoveGenerator::generate_legal_moves(board);
-    if (moves.empty()) {
-        if (in_check) {
-            return -kMateValue + ply;
-        }
-        return 0;
-    }
-
-    const auto move_order_key = [&](const Move& move) {
-        int tier = 0;
-        int primary = 0;
-        int secondary = 0;
-        if (same_move(move, tt_move)) {
-            tier = 3;
-        } else if (move.is_capture()) {
-            tier = 2;
-            primary = mvv_lva(move, board);
-        } else {
-            const auto& killers = ctx.killer_moves[ply];
-            if (same_move(move, killers[0])) {
-                tier = 1;
-                primary = 2;
-            } else if (same_move(move, killers[1])) {
-                tier = 1;
-                primary = 1;
-            }
-            secondary = history_score(ctx, move, board.side_to_move());
-        }
-        return std::make_tuple(tier, primary, secondary);
-    };
-
-    std::stable_sort(moves.begin(), moves.end(), [&](const Move& lhs, const Move& rhs) {
-        return move_order_key(lhs) > move_order_key(rhs);
-    });
-
+    MovePicker picker(board, tt_move, ctx.killer_moves[ply], ctx.history,
+                      continuation_history_ ? continuation_histories(ctx, ply) : ContinuationHistories{});
     Move best_move{};
-    int best_score = -kInfinity;
+    Move first_move{};
+    int best_score = tablebase_floor;
     int move_index = 0;
-
-    for (const Move& move : moves) {
+    bool any_move = false;
+    std::array<Move, kMaxTrackedQuiets> tried_quiets{};
+    std::size_t tried_count = 0;
+
+    Move move;
+    while (picker.next(move)) {
+        if (!any_move) {
+            first_move = move;
+            any_move = true;
+        }
+        bool quiet = !move.is_capture() && !move.is_promotion();
+        int piece_to = piece_to_index(board, move);
+        int quiet_history = quiet && continuation_history_ ? picker.quiet_score(pack_move(move)) : 0;
+        ctx.stack[ply].piece_to = piece_to;
         Board::State state;
-        evaluator_->update_accumulator(board, move, ctx.accumulator_stack[ply], ctx.accumulator_stack[ply + 1]);
+        evaluator_->record_move(board, move, ctx.accumulator_stack[ply + 1]);
         board.make_move(move, state);
-        ctx.repetition_stack.push_back(board.zobrist_key());
+        table_.prefetch(board.zobrist_key());
+        ctx.key_history.push(board.zobrist_key());
 
         int new_depth = depth - 1;
         bool gives_check = board.in_check(board.side_to_move());
         int score = 0;
-        bool can_reduce = !move.is_capture() && !move.is_promotion() && !gives_check && !in_check && depth >= 3 && move_index >= 3;
+        // Captures that lose material by SEE are reduced like quiet moves.
+        bool tactical = (move.is_capture() && !picker.in_bad_captures()) || move.is_promotion();
+        bool can_reduce = !tactical && !gives_check && !in_check && depth >= 3 && move_index >= 3;
         if (can_reduce) {
-            int reduction = 1 + (move_index > 6);
+            // Quiet moves that keep failing low after the same earlier moves are reduced a ply more.
+            int reduction = 1 + (move_index > 6) + (quiet_history < 0);
             int reduced_depth = std::max(1, depth - 1 - reduction);
+            CHIRON_COUNT(ctx, lmr_searches);
             score = -negamax(ctx, board, reduced_depth, -alpha - 1, -alpha, true, ply + 1);
             if (score > alpha) {
+                CHIRON_COUNT(ctx, lmr_re_searches);
                 score = -negamax(ctx, board, new_depth, -beta, -alpha, true, ply + 1);
             }
         } else {
@@ -573,27 +856,42 @@ int Search::negamax(ThreadContext& ctx, Board& board, int depth, int alpha, int
             alpha = score;
         }
 
-        ctx.repetition_stack.pop_back();
+        ctx.key_history.pop();
         board.undo_move(move, state);
 
         if (alpha >= beta) {
-            if (!move.is_capture() && !move.is_promotion()) {
+            CHIRON_COUNT(ctx, fail_highs);
+            if (move_index == 0) {
+                CHIRON_COUNT(ctx, first_move_fail_highs);
+            }
+            if (quiet) {
                 update_killers(ctx.killer_moves[ply], move);
                 update_history(ctx, move, depth, board.side_to_move());
+                if (continuation_history_) {
+                    update_quiet_histories(ctx, board, ply, move, depth,
+                                           std::span<const Move>(tried_quiets.data(), tried_count));
+                }
             }
             break;
         }
 
-        if (!move.is_capture() && !move.is_promotion() && alpha > static_eval) {
+        if (quiet && alpha > static_eval) {
             update_history(ctx, move, depth, board.side_to_move());
         }
+        if (quiet && tried_count < tried_quiets.size()) {
+            tried_quiets[tried_count++] = move;
+        }
 
         ++move_index;
     }
 
+    if (!any_move) {
+        return in_check ? -kMateValue + ply : 0;
+    }
     if (best_move.from == 0 && best_move.to == 0) {
-        best_move = moves.front();
+        best_move = first_move;
     }
+    best_score = std::min(best_score, tablebase_ceiling);
 
     TTFlag flag = TTFlag::Exact;
     if (best_score <= alpha_original) {
@@ -601,7 +899,7 @@ int Search::negamax(ThreadContext& ctx, Board& board, int depth, int alpha, int
     } else if (best_score >= beta) {
         flag = TTFlag::Beta;
     }
-    store_tt(board.zobrist_key(), depth, best_score, best_move, static_cast<std::uint8_t>(flag), ply);
+    store_tt(board.zobrist_key(), depth, best_score, best_move, static_cast<std::uint8_t>(flag), ply, static_eval);
     return best_score;
 }
 
@@ -610,14 +908,15 @@ int Search::quiescence(ThreadContext& ctx, Board& board, int alpha, int beta, in
         return 0;
     }
 
-    nodes_total_.fetch_add(1, std::memory_order_relaxed);
+    count_node(ctx);
+    CHIRON_COUNT(ctx, qsearch_nodes);
 
     bool in_check = board.in_check(board.side_to_move());
     if (in_check) {
         return negamax(ctx, board, 1, alpha, beta, false, ply);
     }
 
-    int stand_pat = evaluator_->evaluate(board, ctx.accumulator_stack[ply]);
+    int stand_pat = static_evaluation(ctx, board, ply);
     if (stand_pat >= beta) {
         return beta;
     }
@@ -625,26 +924,17 @@ int Search::quiescence(ThreadContext& ctx, Board& board, int alpha, int beta, in
         alpha = stand_pat;
     }
 
-    std::vector<Move> moves = MoveGenerator::generate_legal_moves(board);
-    std::vector<Move> captures;
-    captures.reserve(moves.size());
-    for (const Move& move : moves) {
-        if (move.is_capture() || move.is_promotion()) {
-            captures.push_back(move);
-        }
-    }
-
-    std::sort(captures.begin(), captures.end(), [&](const Move& lhs, const Move& rhs) {
-        return mvv_lva(lhs, board) > mvv_lva(rhs, board);
-    });
-
-    for (const Move& move : captures) {
+    // The quiescence picker drops captures that lose material by SEE.
+    MovePicker picker(board);
+    Move move;
+    while (picker.next(move)) {
+        ctx.stack[ply].piece_to = piece_to_index(board, move);
         Board::State state;
-        evaluator_->update_accumulator(board, move, ctx.accumulator_stack[ply], ctx.accumulator_stack[ply + 1]);
+        evaluator_->record_move(board, move, ctx.accumulator_stack[ply + 1]);
         board.make_move(move, state);
-        ctx.repetition_stack.push_back(board.zobrist_key());
+        ctx.key_history.push(board.zobrist_key());
         int score = -quiescence(ctx, board, -beta, -alpha, ply + 1);
-        ctx.repetition_stack.pop_back();
+        ctx.key_history.pop();
         board.undo_move(move, state);
 
         if (score >= beta) {
@@ -658,12 +948,13 @@ int Search::quiescence(ThreadContext& ctx, Board& board, int alpha, int beta, in
     return alpha;
 }
 
-void Search::update_killers(std::array<Move, 2>& killers, const Move& move) {
-    if (same_move(move, killers[0])) {
+void Search::update_killers(std::array<PackedMove, 2>& killers, const Move& move) {
+    PackedMove packed = pack_move(move);
+    if (packed == killers[0]) {
         return;
     }
     killers[1] = killers[0];
-    killers[0] = move;
+    killers[0] = packed;
 }
 
 void Search::update_history(ThreadContext& ctx, const Move& move, int depth, Color mover) {
@@ -675,101 +966,239 @@ void Search::update_history(ThreadContext& ctx, const Move& move, int depth, Col
     entry = std::clamp(entry + bonus, -4000, 4000);
 }
 
-int Search::history_score(const ThreadContext& ctx, const Move& move, Color mover) const {
-    if (move.is_capture() || move.is_promotion()) {
-        return 0;
+void Search::update_quiet_histories(ThreadContext& ctx, const Board& board, int ply, const Move& move, int depth,
+                                 std::span<const Move> tried) {
+    auto& butterfly = ctx.history[static_cast<int>(board.side_to_move())];
+    for (const Move& other : tried) {
+        int& entry = butterfly[other.from][other.to];
+        entry = std::clamp(entry - depth * depth, -4000, 4000);
+    }
+    int bonus = std::min(depth * depth, 1200);
+    int piece_to = piece_to_index(board, move);
+    for (int back = 1; back <= 2 && back <= ply; ++back) {
+        int previous = ctx.stack[static_cast<std::size_t>(ply - back)].piece_to;
+        if (previous < 0) {
+            break;  // Behind a null move the earlier moves no longer lead to this position.
+        }
+        PieceToHistory& table = ctx.continuation_history[static_cast<std::size_t>(previous)];
+        apply_gravity(table[static_cast<std::size_t>(piece_to)], bonus);
+        for (const Move& other : tried) {
+            apply_gravity(table[static_cast<std::size_t>(piece_to_index(board, other))], -bonus);
+        }
+    }
+    if (ply >= 1 && ctx.stack[static_cast<std::size_t>(ply - 1)].piece_to >= 0) {
+        ctx.counter_moves[static_cast<std::size_t>(ctx.stack[static_cast<std::size_t>(ply - 1)].piece_to)] =
+            pack_move(move);
     }
-    return ctx.history[static_cast<int>(mover)][move.from][move.to];
 }
 
-bool Search::probe_tt(std::uint64_t key, int ply, TTEntry& entry) const {
-    std::shared_lock lock(tt_mutex_);
-    const TTEntry& probe = entry_for_key(key);
-    if (probe.flag != static_cast<std::uint8_t>(TTFlag::Empty) && probe.key == key) {
-        entry = probe;
-        entry.score = static_cast<int16_t>(from_tt_score(entry.score, ply));
-        return true;
+ContinuationHistories Search::continuation_histories(const ThreadContext& ctx, int ply) const {
+    ContinuationHistories histories;
+    for (int back = 1; back <= 2 && back <= ply; ++back) {
+        int previous = ctx.stack[static_cast<std::size_t>(ply - back)].piece_to;
+        if (previous < 0) {
+            break;
+        }
+        histories.continuation[static_cast<std::size_t>(back - 1)] =
+            &ctx.continuation_history[static_cast<std::size_t>(previous)];
+    }
+    if (ply >= 1 && ctx.stack[static_cast<std::size_t>(ply - 1)].piece_to >= 0) {
+        histories.counter_move =
+            ctx.counter_moves[static_cast<std::size_t>(ctx.stack[static_cast<std::size_t>(ply - 1)].piece_to)];
     }
-    return false;
+    return histories;
 }
 
-void Search::store_tt(std::uint64_t key, int depth, int score, const Move& move, std::uint8_t flag, int ply) {
-    std::unique_lock lock(tt_mutex_);
-    TTEntry& entry = entry_for_key(key);
-    int stored = to_tt_score(score, ply);
-    if (entry.flag == static_cast<std::uint8_t>(TTFlag::Empty) || entry.depth <= depth || entry.age != generation_) {
-        entry.key = key;
-        entry.depth = static_cast<int16_t>(depth);
-        entry.score = static_cast<int16_t>(stored);
-        entry.move = move;
-        entry.flag = flag;
-        entry.age = static_cast<std::uint8_t>(generation_);
+int Search::static_evaluation(ThreadContext& ctx, const Board& board, int ply, int tt_eval) {
+    ++ctx.pending_eval_probes;
+    std::uint64_t key = board.zobrist_key();
+    int eval = tt_eval;
+    if (eval != kNoTTEval || ctx.eval_cache.probe(key, eval)) {
+        ++ctx.pending_eval_hits;
+        return eval;
     }
+    CHIRON_COUNT(ctx, evaluations);
+    // A skipped materialize is harmless: descendants walk back to the nearest computed ancestor.
+    evaluator_->materialize(board, ctx.accumulator_stack.data(), static_cast<std::size_t>(ply), &ctx.refresh_table);
+    eval = evaluator_->evaluate(board, ctx.accumulator_stack[static_cast<std::size_t>(ply)]);
+    if (pawn_structure_weight_ != 0) {
+        eval += pawn_structure_score(board, ctx.pawn_table) * pawn_structure_weight_ / 100;
+        eval = std::clamp(eval, -nnue::kMaxEvaluationMagnitude, nnue::kMaxEvaluationMagnitude);
+    }
+    ctx.eval_cache.store(key, eval);
+    return eval;
+}
+
+bool Search::probe_tt(std::uint64_t key, int ply, TTEntry& entry) const {
+    if (!table_.probe(key, entry)) {
+        return false;
+    }
+    entry.score = static_cast<int16_t>(from_tt_score(entry.score, ply));
+    return true;
 }
 
-const Search::TTEntry& Search::entry_for_key(std::uint64_t key) const {
-    return table_[key % table_.size()];
+void Search::store_tt(std::uint64_t key, int depth, int score, const Move& move, std::uint8_t flag, int ply,
+                      int eval) {
+    table_.store(key, depth, to_tt_score(score, ply), pack_move(move), flag, eval);
 }
 
-Search::TTEntry& Search::entry_for_key(std::uint64_t key) { return table_[key % table_.size()]; }
+SearchStats& SearchStats::operator+=(const SearchStats& other) {
+    tt_probes += other.tt_probes;
+    tt_hits += other.tt_hits;
+    fail_highs += other.fail_highs;
+    first_move_fail_highs += other.first_move_fail_highs;
+    qsearch_nodes += other.qsearch_nodes;
+    null_move_tries += other.null_move_tries;
+    null_move_cutoffs += other.null_move_cutoffs;
+    lmr_searches += other.lmr_searches;
+    lmr_re_searches += other.lmr_re_searches;
+    evaluations += other.evaluations;
+    return *this;
+}
 
 bool Search::should_stop() const {
-    if (stop_signal_ && stop_signal_->load()) {
-        return true;
-    }
-    if (node_limit_ && nodes_total_.load(std::memory_order_relaxed) >= node_limit_) {
-        return true;
+    return limit_reached_.load(std::memory_order_relaxed) || abort_helpers_.load(std::memory_order_relaxed);
+}
+
+void Search::count_node(ThreadContext& ctx) {
+    if (++ctx.pending_nodes >= kNodePollInterval) {
+        poll_limits(ctx);
     }
-    if (time_limit_.count() > 0) {
+}
+
+void Search::poll_limits(ThreadContext& ctx) {
+    std::uint64_t nodes = nodes_total_.fetch_add(ctx.pending_nodes, std::memory_order_relaxed) + ctx.pending_nodes;
+    ctx.nodes += std::exchange(ctx.pending_nodes, 0);
+    eval_probes_total_.fetch_add(std::exchange(ctx.pending_eval_probes, 0), std::memory_order_relaxed);
+    eval_hits_total_.fetch_add(std::exchange(ctx.pending_eval_hits, 0), std::memory_order_relaxed);
+    tb_hits_total_.fetch_add(std::exchange(ctx.pending_tb_hits, 0), std::memory_order_relaxed);
+    bool reached = (stop_signal_ && stop_signal_->load(std::memory_order_relaxed)) ||
+                   (node_limit_ && nodes >= node_limit_);
+    if (!reached && time_limit_.count() > 0 && !pondering_.load(std::memory_order_acquire)) {
         auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time_);
-        if (elapsed >= time_limit_) {
-            return true;
-        }
+        reached = elapsed >= time_limit_ + ponderhit_time();
+    }
+    if (reached) {
+        limit_reached_.store(true, std::memory_order_relaxed);
     }
-    return false;
 }
 
-std::chrono::milliseconds Search::compute_time_budget(const Board& board, const SearchLimits& limits) const {
-    if (limits.move_time_ms >= 0) {
-        return std::chrono::milliseconds(limits.move_time_ms);
-    }
+TimeBudget Search::compute_time_budget(const Board& board, const SearchLimits& limits) const {
     if (limits.infinite) {
-        return std::chrono::milliseconds(0);
+        return TimeBudget{};
+    }
+    if (limits.move_time_ms >= 0) {
+        return TimeBudget{limits.move_time_ms, limits.move_time_ms};
     }
     Color us = board.side_to_move();
     int time_left = limits.time_left_ms[static_cast<int>(us)];
     int increment = limits.increment_ms[static_cast<int>(us)];
     if (time_left <= 0 && increment <= 0) {
-        return std::chrono::milliseconds(0);
+        return TimeBudget{};
     }
     int move_number = board.fullmove_number();
-    int allocation = time_manager_.allocate_time_ms(time_left, increment, move_number, limits.moves_to_go);
-    return std::chrono::milliseconds(std::max(allocation, 0));
+    return time_manager_.allocate(time_left, increment, move_number, limits.moves_to_go);
+}
+
+void Search::remember_pv(const Board& board, const std::vector<Move>& pv) {
+    previous_pv_ = pv;
+    previous_pv_keys_.clear();
+    Board copy = board;
+    Board::State state;
+    previous_pv_keys_.push_back(copy.zobrist_key());
+    for (const Move& move : pv) {
+        copy.make_move(move, state);
+        previous_pv_keys_.push_back(copy.zobrist_key());
+    }
+}
+
+int Search::previous_pv_offset(std::uint64_t key) const {
+    auto found = std::find(previous_pv_keys_.begin(), previous_pv_keys_.end(), key);
+    return found == previous_pv_keys_.end() ? -1 : static_cast<int>(found - previous_pv_keys_.begin());
+}
+
+int Search::seed_from_previous_pv(Board& board, int pv_offset, int max_depth, SearchResult& seed) {
+    if (pv_offset < 0) {
+        return 1;
+    }
+    TTEntry entry;
+    if (!probe_tt(board.zobrist_key(), 0, entry) || entry.depth < 2 ||
+        static_cast<TTFlag>(entry.flag) != TTFlag::Exact || std::abs(entry.score) > kMateScoreThreshold) {
+        return 1;
+    }
+    std::optional<Move> legal = searchable_root_move(board, entry.move);
+    if (!legal) {
+        return 1;
+    }
+    // The previous search already resolved this subtree to the stored depth, so that iteration
+    // costs little more than TT hits; it starts there with the remaining PV standing in until it
+    // completes.
+    seed.best_move = *legal;
+    seed.score = entry.score;
+    seed.pv.assign(previous_pv_.begin() + std::min<std::ptrdiff_t>(pv_offset, std::ssize(previous_pv_)),
+                   previous_pv_.end());
+    if (seed.pv.empty() || pack_move(seed.pv.front()) != entry.move) {
+        seed.pv = {*legal};
+    }
+    return std::min<int>(entry.depth, max_depth);
+}
+
+std::optional<int> Search::seed_from_analysis_cache(Board& board) {
+    if (!analysis_cache_) {
+        return std::nullopt;
+    }
+    std::optional<AnalysisRecord> cached = analysis_cache_->probe(board.zobrist_key());
+    if (!cached || std::abs(cached->score) > kMateScoreThreshold) {
+        return std::nullopt;
+    }
+    std::optional<Move> legal = searchable_root_move(board, cached->move);
+    if (!legal) {
+        return std::nullopt;
+    }
+    // Iterative deepening still starts at depth 1: the table below the root may be cold, and the
+    // cache key knows neither the repetition history nor the fifty-move clock. A depth-0 root
+    // entry only orders the cached move first and can never cut an iteration short.
+    TTEntry entry;
+    if (!probe_tt(board.zobrist_key(), 0, entry)) {
+        store_tt(board.zobrist_key(), 0, cached->score, *legal, static_cast<std::uint8_t>(TTFlag::Exact), 0);
+    }
+    return cached->score;
+}
+
+std::optional<Move> Search::searchable_root_move(Board& board, PackedMove move) const {
+    MoveList moves;
+    MoveGenerator::generate_legal_moves(board, moves);
+    auto legal =
+        std::find_if(moves.begin(), moves.end(), [&](const Move& candidate) { return pack_move(candidate) == move; });
+    if (legal == moves.end() ||
+        (!tablebase_root_moves_.empty() &&
+         std::find(tablebase_root_moves_.begin(), tablebase_root_moves_.end(), move) == tablebase_root_moves_.end())) {
+        return std::nullopt;
+    }
+    return *legal;
 }
 
 std::vector<Move> Search::extract_pv(Board& board) const {
     std::vector<Move> pv;
+    // Only walks forward, so a scratch copy played with a throwaway undo record is enough.
     Board copy = board;
-    std::vector<Board::State> states;
-    states.reserve(64);
+    Board::State state;
     for (int depth = 0; depth < 64; ++depth) {
-        std::uint64_t key = copy.zobrist_key();
-        std::shared_lock lock(tt_mutex_);
-        const TTEntry& entry = entry_for_key(key);
-        if (entry.flag == static_cast<std::uint8_t>(TTFlag::Empty) || entry.key != key) {
+        TTEntry entry;
+        if (!table_.probe(copy.zobrist_key(), entry)) {
             break;
         }
-        Move move = entry.move;
-        if (move.from == move.to && move.from == 0) {
+        if (entry.move.is_null()) {
             break;
         }
-        pv.push_back(move);
-        Board::State state;
-        copy.make_move(move, state);
-        states.push_back(state);
-        if (MoveGenerator::generate_legal_moves(copy).empty()) {
+        Move move = unpack_move(entry.move);
+        // Lockless slots can be overwritten mid-walk, so only follow moves legal in this position.
+        // A terminal position has no legal move and ends the walk on the next probe.
+        if (!copy.is_pseudo_legal(move) || !copy.is_legal(move)) {
             break;
         }
+        pv.push_back(move);
+        copy.make_move(move, state);
     }
     return pv;
 }
@@ -782,22 +1211,34 @@ void Search::ensure_context_capacity(ThreadContext& ctx, int depth) {
     if (static_cast<int>(ctx.stack.size()) < required) {
         ctx.stack.resize(static_cast<std::size_t>(required));
     }
+    if (ctx.continuation_history.empty()) {
+        ctx.continuation_history.resize(kPieceToCount);
+    }
     if (static_cast<int>(ctx.killer_moves.size()) < required) {
         std::size_t old_size = ctx.killer_moves.size();
         ctx.killer_moves.resize(static_cast<std::size_t>(required));
         for (std::size_t i = old_size; i < ctx.killer_moves.size(); ++i) {
-            ctx.killer_moves[i] = {Move{}, Move{}};
+            ctx.killer_moves[i] = {PackedMove{}, PackedMove{}};
         }
     }
 }
 
 void Search::reset_context(ThreadContext& ctx) {
     for (auto& killers : ctx.killer_moves) {
-        killers[0] = Move{};
-        killers[1] = Move{};
+        killers[0] = PackedMove{};
+        killers[1] = PackedMove{};
     }
     std::memset(ctx.history, 0, sizeof(ctx.history));
-    ctx.repetition_stack.clear();
+    std::fill(ctx.continuation_history.begin(), ctx.continuation_history.end(), PieceToHistory{});
+    ctx.counter_moves.fill(PackedMove{});
+    ctx.key_history.clear();
+    ctx.history_root = 0;
+}
+
+void Search::seed_history(ThreadContext& ctx, const Board& board) const {
+    ctx.key_history = game_history_;
+    ctx.key_history.push(board.zobrist_key());
+    ctx.history_root = ctx.key_history.size();
 }
 
 void Search::atomic_max(std::atomic<int>& target, int value) {
@@ -810,10 +1251,14 @@ void Search::atomic_max(std::atomic<int>& target, int value) {
 int SearchTestHelper::negamax_entry(Search& search, Board& board, int depth, int alpha, int beta) {
     search.stop_signal_ = nullptr;
     search.node_limit_ = 0;
+    search.soft_node_limit_ = 0;
+    search.limit_reached_.store(false, std::memory_order_relaxed);
     search.time_limit_ = std::chrono::milliseconds{0};
     search.start_time_ = std::chrono::steady_clock::now();
     search.nodes_total_.store(0, std::memory_order_relaxed);
     search.seldepth_total_.store(0, std::memory_order_relaxed);
+    search.eval_probes_total_.store(0, std::memory_order_relaxed);
+    search.eval_hits_total_.store(0, std::memory_order_relaxed);
 
     if (!search.evaluator_) {
         search.evaluator_ = global_evaluator();
@@ -827,7 +1272,8 @@ int SearchTestHelper::negamax_entry(Search& search, Board& board, int depth, int
     Search::ThreadContext& ctx = search.contexts_.front();
     search.ensure_context_capacity(ctx, depth + 5);
     search.reset_context(ctx);
-    ctx.repetition_stack.push_back(board.zobrist_key());
+    ctx.eval_cache.sync(search.evaluator_->network_generation());
+    search.seed_history(ctx, board);
     search.evaluator_->build_accumulator(board, ctx.accumulator_stack[0]);
 
     return search.negamax(ctx, board, depth, alpha, beta, true, 0);
@@ -3,18 +3,29 @@
 #include <array>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "analysis_cache.h"
 #include "board.h"
+#include "eval_cache.h"
+#include "key_history.h"
 #include "movegen.h"
+#include "movepicker.h"
 #include "nnue/evaluator.h"
+#include "pawn_structure.h"
+#include "syzygy.h"
 #include "tools/time_manager.h"
+#include "tt.h"
 
 namespace chiron {
 
@@ -25,13 +36,47 @@ class SearchTestHelper;
  */
 struct SearchLimits {
     int max_depth = 64;                    /**< Maximum iterative deepening depth. */
-    std::uint64_t node_limit = 0;          /**< Optional node limit for the search. */
+    std::uint64_t node_limit = 0;          /**< Hard node budget: the search stops once it is spent (0 = none). */
+    std::uint64_t soft_node_limit = 0;     /**< No new iteration starts once this many nodes are searched. */
     int move_time_ms = -1;                 /**< Fixed time allocation for the move; overrides other timings. */
     int time_left_ms[kNumColors] = {0, 0}; /**< Remaining clock times for each color. */
     int increment_ms[kNumColors] = {0, 0}; /**< Increment gained per move for each color. */
     int moves_to_go = 0;                   /**< Moves until the next time control, if any. */
     bool infinite = false;                 /**< Search until explicitly stopped. */
     bool ponder = false;                   /**< Whether the search is in ponder mode. */
+    int multi_pv = 1;                      /**< Root moves to search with exact scores (UCI MultiPV). */
+};
+
+#ifdef CHIRON_SEARCH_STATS
+inline constexpr bool kSearchStatsEnabled = true;
+#else
+inline constexpr bool kSearchStatsEnabled = false; /**< Configure with -DCHIRON_SEARCH_STATS=ON to count. */
+#endif
+
+/**
+ * @brief Where a search spent its nodes; all zero unless built with CHIRON_SEARCH_STATS.
+ */
+struct SearchStats {
+    std::uint64_t tt_probes = 0;
+    std::uint64_t tt_hits = 0;
+    std::uint64_t fail_highs = 0;            /**< Interior nodes that failed high. */
+    std::uint64_t first_move_fail_highs = 0; /**< ... on the first move searched. */
+    std::uint64_t qsearch_nodes = 0;
+    std::uint64_t null_move_tries = 0;
+    std::uint64_t null_move_cutoffs = 0;
+    std::uint64_t lmr_searches = 0;          /**< Reduced searches of late moves. */
+    std::uint64_t lmr_re_searches = 0;       /**< ... that beat alpha and were searched again. */
+    std::uint64_t evaluations = 0;           /**< Network evaluations (eval cache and TT misses). */
+
+    SearchStats& operator+=(const SearchStats& other);
+};
+
+/**
+ * @brief One root move searched with an exact window, and the line it leads to.
+ */
+struct SearchLine {
+    int score = 0;
+    std::vector<Move> pv;  /**< Starts with the root move. */
 };
 
 /**
@@ -45,7 +90,13 @@ struct SearchResult {
     std::uint64_t nodes = 0;                            /**< Total nodes visited. */
     std::vector<Move> pv;                               /**< Principal variation line. */
     std::vector<std::pair<Move, int>> root_moves;       /**< Root move candidates and scores. */
+    std::vector<SearchLine> lines;                      /**< The multi_pv best lines, best first; lines[0] is pv. */
     std::chrono::milliseconds elapsed{0};               /**< Time consumed by the search. */
+    int hashfull = 0;                                   /**< Transposition table occupancy in permille. */
+    std::uint64_t eval_probes = 0;                      /**< Static evaluations requested by the search. */
+    std::uint64_t eval_hits = 0;                        /**< Requests served by the TT or the eval cache. */
+    std::uint64_t tb_hits = 0;                          /**< Successful tablebase probes. */
+    SearchStats stats{};                                /**< Filled in once the search returns. */
 };
 
 /** Callback signature for streaming UCI info output while searching. */
@@ -53,10 +104,18 @@ using InfoCallback = std::function<void(const SearchResult&)>;
 
 /**
  * @brief High-performance negamax searcher with modern alpha-beta enhancements.
+ *
+ * Multi-threaded searches use Lazy SMP: a persistent pool of helper threads runs its own
+ * iterative deepening on a copy of the root position and shares results through the
+ * transposition table, while the calling thread drives reporting and the final move.
  */
 class Search {
    public:
     explicit Search(std::size_t table_size = 1ULL << 20, std::shared_ptr<nnue::Evaluator> evaluator = nullptr);
+    ~Search();
+
+    Search(const Search&) = delete;
+    Search& operator=(const Search&) = delete;
 
     /**
      * @brief Searches for the best move using the provided limits.
@@ -74,16 +133,86 @@ class Search {
      */
     void clear();
 
+    /**
+     * @brief Prepares for an unrelated game without touching the whole table: the TT is
+     *        invalidated through TranspositionTable::new_game() and the heuristics reset.
+     *
+     * Evaluation caches survive since their entries depend only on position and network.
+     */
+    void new_game();
+
     /**
      * @brief Reconfigures the evaluator used for static evaluations.
      */
     void set_evaluator(std::shared_ptr<nnue::Evaluator> evaluator);
 
+    /**
+     * @brief Sets the keys of the game positions played before the next search root, oldest
+     *        first, so repetitions of earlier game positions are recognised as draws.
+     */
+    void set_game_history(const std::vector<std::uint64_t>& keys);
+
+    /**
+     * @brief Blends the classical pawn-structure term into static evaluations at @p percent
+     *        of its centipawn value; 0 (the default) leaves the NNUE output untouched.
+     *
+     * Clears the transposition table and eval caches, whose stored evaluations used the old mix.
+     */
+    void set_pawn_structure_weight(int percent);
+
+    /**
+     * @brief Orders quiets by the counter move and continuation histories as well as the butterfly
+     *        table, penalises quiets searched before a cutoff and reduces those with a negative
+     *        combined history a ply more.
+     *
+     * Off by default until game results back it; `tune sprt` can play it against the default.
+     */
+    void set_continuation_history(bool enabled);
+
+    /**
+     * @brief Probes @p tablebases (nullptr disables probing): a root position they cover only
+     *        searches the moves that keep its DTZ-ranked result, and interior nodes reached by a
+     *        capture or pawn move return the WDL result instead of being searched.
+     */
+    void set_tablebases(std::shared_ptr<const SyzygyTablebases> tablebases);
+
+    /**
+     * @brief Shares @p cache (nullptr disables it) with this search: every finished single-line
+     *        search records its result there, and a root the cache holds searches the cached move
+     *        first, with its first aspiration window around the cached score.
+     */
+    void set_analysis_cache(std::shared_ptr<AnalysisCache> cache);
+
+    /** @brief Saves the transposition table to @p path; see TranspositionTable::save(). */
+    void save_table(const std::string& path) const;
+
+    /**
+     * @brief Restores a table written by save_table(), taking its size; see
+     *        TranspositionTable::load(). Entries only help searches with the same evaluation.
+     */
+    void load_table(const std::string& path);
+
     /**
      * @brief Adjusts the internal time manager heuristics.
      */
     void set_time_manager(TimeHeuristicConfig config);
 
+    /**
+     * @brief Turns the running ponder search into a normal timed one without restarting it.
+     *
+     * The time already spent counts towards the soft limit, while the hard limit is measured from
+     * this call, since the engine's own clock only starts running now.
+     */
+    void ponderhit();
+
+    /**
+     * @brief Starts the clock and ponder state of the next search() before it runs.
+     *
+     * A caller that searches on a thread of its own calls this first, so that a ponderhit() sent
+     * before the thread gets going is kept rather than reset by the search's own start.
+     */
+    void prepare_clock(bool ponder);
+
     /**
      * @brief Resizes the transposition table to the requested number of entries.
      */
@@ -95,23 +224,21 @@ class Search {
     void set_table_size_mb(std::size_t megabytes);
 
     /**
-     * @brief Configures the number of helper threads used at the root.
+     * @brief Configures the total number of search threads; helpers are parked between searches.
      */
     void set_threads(int threads);
+    [[nodiscard]] int threads() const { return thread_count_; }
 
-   private:
-    struct TTEntry {
-        std::uint64_t key = 0ULL;
-        int16_t depth = -1;
-        int16_t score = 0;
-        Move move{};
-        std::uint8_t flag = 0;
-        std::uint8_t age = 0;
-    };
+    /**
+     * @brief Returns the transposition table occupancy in permille.
+     */
+    [[nodiscard]] int hashfull() const { return table_.hashfull(); }
 
+   private:
     struct SearchStackEntry {
         bool in_check = false;
         int static_eval = 0;
+        int piece_to = -1;  // (piece, destination) of the move searched from this node; -1 for a null move.
     };
 
     SearchResult search_impl(Board& board, const SearchLimits& limits, std::atomic<bool>& stop_flag,
@@ -119,52 +246,145 @@ class Search {
 
     struct ThreadContext {
         std::vector<nnue::Accumulator> accumulator_stack;
+        nnue::RefreshTable refresh_table;
+        EvalCache eval_cache;
+        PawnHashTable pawn_table;
         std::vector<SearchStackEntry> stack;
-        std::vector<std::array<Move, 2>> killer_moves;
+        std::vector<std::array<PackedMove, 2>> killer_moves;
         int history[kNumColors][kBoardSize][kBoardSize]{};
-        std::vector<std::uint64_t> repetition_stack;
+        std::vector<PieceToHistory> continuation_history;  // One table per (piece, to) of the previous move.
+        std::array<PackedMove, kPieceToCount> counter_moves{};
+        KeyHistory key_history;
+        std::size_t history_root = 0;  // Entries up to and including the root position.
+        std::uint64_t pending_nodes = 0;  // Nodes not yet folded into nodes_total_.
+        std::uint64_t pending_eval_probes = 0;
+        std::uint64_t pending_eval_hits = 0;
+        std::uint64_t pending_tb_hits = 0;
+        std::uint64_t nodes = 0;            // Nodes this thread folded in during the current search.
+        std::uint64_t root_nodes = 0;       // Nodes below the root moves in the last root search ...
+        std::uint64_t root_best_nodes = 0;  // ... and below its best move, for the time manager.
+        SearchStats stats;
     };
 
+    int search_iteration(ThreadContext& ctx, Board& board, int depth, int previous_score, Move& best_move,
+                         std::vector<std::pair<Move, int>>& root_scores, const std::vector<PackedMove>& excluded,
+                         bool& completed);
+    void start_helpers(const Board& board, int max_depth, int first_depth);
+    void stop_helpers();
+    void helper_loop(int index, std::uint64_t seen_id);
+    void shutdown_helpers();
+
+    /** @brief Searches the root moves, skipping @p excluded ones (earlier MultiPV lines). */
     int search_root(ThreadContext& ctx, Board& board, int depth, int alpha, int beta, Move& best_move,
-                    std::vector<std::pair<Move, int>>& root_scores);
+                    std::vector<std::pair<Move, int>>& root_scores, const std::vector<PackedMove>& excluded);
     int search_root_worker(ThreadContext& ctx, Board& board, const Move& move, int depth, int alpha, int beta);
     int negamax(ThreadContext& ctx, Board& board, int depth, int alpha, int beta, bool allow_null, int ply);
     int quiescence(ThreadContext& ctx, Board& board, int alpha, int beta, int ply);
 
-    void update_killers(std::array<Move, 2>& killers, const Move& move);
+    void update_killers(std::array<PackedMove, 2>& killers, const Move& move);
     void update_history(ThreadContext& ctx, const Move& move, int depth, Color mover);
-    int history_score(const ThreadContext& ctx, const Move& move, Color mover) const;
+    /**
+     * @brief Rewards the quiet cutoff @p move at @p ply in the continuation tables of the two
+     *        previous moves, penalises the quiet moves in @p tried searched before it there and
+     *        in the butterfly table, and makes it the counter move of the previous move.
+     */
+    void update_quiet_histories(ThreadContext& ctx, const Board& board, int ply, const Move& move, int depth,
+                                std::span<const Move> tried);
+    /** @brief The continuation tables and counter move for the node at @p ply. */
+    [[nodiscard]] ContinuationHistories continuation_histories(const ThreadContext& ctx, int ply) const;
+
+    /**
+     * @brief Static evaluation of the node at @p ply, reusing @p tt_eval or the thread's
+     *        eval cache before paying for the accumulator update and network pass.
+     */
+    int static_evaluation(ThreadContext& ctx, const Board& board, int ply, int tt_eval = kNoTTEval);
 
     bool probe_tt(std::uint64_t key, int ply, TTEntry& entry) const;
-    void store_tt(std::uint64_t key, int depth, int score, const Move& move, std::uint8_t flag, int ply);
-    const TTEntry& entry_for_key(std::uint64_t key) const;
-    TTEntry& entry_for_key(std::uint64_t key);
+    void store_tt(std::uint64_t key, int depth, int score, const Move& move, std::uint8_t flag, int ply,
+                  int eval = kNoTTEval);
 
+    /** @brief Cheap per-node test of the flags poll_limits() and stop_helpers() raise. */
     bool should_stop() const;
-    std::chrono::milliseconds compute_time_budget(const Board& board, const SearchLimits& limits) const;
+    /**
+     * @brief Counts a node; every kNodePollInterval nodes the thread's count is folded into
+     *        nodes_total_ and the limits are checked.
+     */
+    void count_node(ThreadContext& ctx);
+    /** @brief Folds @p ctx's pending counts and raises limit_reached_ if a limit has been hit. */
+    void poll_limits(ThreadContext& ctx);
+    /** @brief Soft and hard limits for @p limits; both are 0 without a time limit. */
+    TimeBudget compute_time_budget(const Board& board, const SearchLimits& limits) const;
     std::vector<Move> extract_pv(Board& board) const;
 
+    /** @brief Keeps @p pv, and the key of every position along it, for the next search. */
+    void remember_pv(const Board& board, const std::vector<Move>& pv);
+    /** @brief Plies from the previous root to the position with @p key along its PV, or -1. */
+    [[nodiscard]] int previous_pv_offset(std::uint64_t key) const;
+    /**
+     * @brief Returns the depth to start iterating at: the root's exact TT depth when the root lies
+     *        on the previous PV, else 1. A deeper start fills @p seed with the stored move and line.
+     */
+    int seed_from_previous_pv(Board& board, int pv_offset, int max_depth, SearchResult& seed);
+    /**
+     * @brief Puts the analysis cache's move for the root first in the root move ordering and
+     *        returns its score to centre the first aspiration window on; nothing on a miss.
+     */
+    [[nodiscard]] std::optional<int> seed_from_analysis_cache(Board& board);
+    /** @brief The legal root move matching @p move, unless a tablebase root probe dropped it. */
+    [[nodiscard]] std::optional<Move> searchable_root_move(Board& board, PackedMove move) const;
+    /** @brief How far into a ponder search ponderhit() arrived; 0 for ordinary searches. */
+    [[nodiscard]] std::chrono::milliseconds ponderhit_time() const;
+
     void ensure_context_capacity(ThreadContext& ctx, int depth);
     void reset_context(ThreadContext& ctx);
+    void seed_history(ThreadContext& ctx, const Board& board) const;
     static void atomic_max(std::atomic<int>& target, int value);
 
     friend class SearchTestHelper;
 
-    std::vector<TTEntry> table_;
+    TranspositionTable table_;
     std::shared_ptr<nnue::Evaluator> evaluator_;
     TimeManager time_manager_{};
     std::vector<ThreadContext> contexts_;
+    KeyHistory game_history_;
 
     InfoCallback info_callback_;
     std::atomic<bool>* stop_signal_ = nullptr;
     std::chrono::steady_clock::time_point start_time_;
-    std::chrono::milliseconds time_limit_{0};
+    bool clock_prepared_ = false;  // prepare_clock() already set start_time_ and the ponder state.
+    std::chrono::milliseconds time_limit_{0};       // Hard limit, enforced by poll_limits().
+    std::chrono::milliseconds soft_time_limit_{0};  // Checked between iterations when the clock is managed.
     std::uint64_t node_limit_ = 0;
-    std::size_t generation_ = 0;
+    std::uint64_t soft_node_limit_ = 0;
+    std::atomic<bool> limit_reached_{false};  // Stop signal, time or node budget seen by poll_limits().
     int thread_count_ = 1;
-    mutable std::shared_mutex tt_mutex_;
+    int pawn_structure_weight_ = 0;
+    bool continuation_history_ = false;
+    std::shared_ptr<const SyzygyTablebases> tablebases_;
+    std::shared_ptr<AnalysisCache> analysis_cache_;
+    bool probe_tablebases_in_tree_ = false;
+    std::vector<PackedMove> tablebase_root_moves_;  // Root moves kept by the root probe; empty = all.
+    std::vector<Move> previous_pv_;                 // PV the last search returned ...
+    std::vector<std::uint64_t> previous_pv_keys_;   // ... and the keys from its root along it.
+    std::atomic<bool> pondering_{false};            // Time limits wait until ponderhit().
+    std::atomic<std::int64_t> ponderhit_ms_{0};
     std::atomic<std::uint64_t> nodes_total_{0};
     std::atomic<int> seldepth_total_{0};
+    std::atomic<std::uint64_t> eval_probes_total_{0};
+    std::atomic<std::uint64_t> eval_hits_total_{0};
+    std::atomic<std::uint64_t> tb_hits_total_{0};
+
+    std::vector<std::thread> helpers_;
+    std::mutex pool_mutex_;
+    std::condition_variable pool_cv_;
+    std::condition_variable idle_cv_;
+    Board root_board_;
+    int root_max_depth_ = 0;
+    int root_first_depth_ = 1;
+    std::uint64_t search_id_ = 0;
+    int helpers_running_ = 0;
+    bool shutdown_ = false;
+    std::atomic<bool> abort_helpers_{false};
 };
 
 class SearchTestHelper {
@@ -0,0 +1,1025 @@
+#include "syzygy.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <utility>
+
+#include "movegen.h"
+#include "movelist.h"
+#include "nnue/mapped_file.h"
+
+namespace chiron {
+
+namespace {
+
+constexpr std::uint8_t kWdlMagic[4] = {0x71, 0xE8, 0x23, 0x5D};
+constexpr std::uint8_t kDtzMagic[4] = {0xD7, 0x66, 0x0C, 0xA5};
+constexpr int kPieceTypesWithoutKing = 5;
+
+// Flags of one compressed table.
+constexpr std::uint8_t kSideToMoveFlag = 1;
+constexpr std::uint8_t kMappedFlag = 2;
+constexpr std::uint8_t kWinPliesFlag = 4;
+constexpr std::uint8_t kLossPliesFlag = 8;
+constexpr std::uint8_t kWideFlag = 16;
+constexpr std::uint8_t kSingleValueFlag = 128;
+
+std::uint16_t read_le16(const std::uint8_t* p) { return static_cast<std::uint16_t>(p[0] | (p[1] << 8)); }
+
+std::uint32_t read_le32(const std::uint8_t* p) {
+    return static_cast<std::uint32_t>(p[0]) | (static_cast<std::uint32_t>(p[1]) << 8) |
+           (static_cast<std::uint32_t>(p[2]) << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+std::uint32_t read_be32(const std::uint8_t* p) {
+    return (static_cast<std::uint32_t>(p[0]) << 24) | (static_cast<std::uint32_t>(p[1]) << 16) |
+           (static_cast<std::uint32_t>(p[2]) << 8) | static_cast<std::uint32_t>(p[3]);
+}
+
+std::uint64_t read_be64(const std::uint8_t* p) {
+    return (static_cast<std::uint64_t>(read_be32(p)) << 32) | read_be32(p + 4);
+}
+
+int off_diagonal(int square) { return (square >> 3) - (square & 7); }  // > 0 above a1-h8, < 0 below.
+int flip_file(int square) { return square ^ 7; }
+int flip_rank(int square) { return square ^ 56; }
+int edge_distance(int file) { return std::min(file, 7 - file); }
+int sign_of(int value) { return (value > 0) - (value < 0); }
+
+/**
+ * @brief Index tables of the Syzygy position encoding: mirrored squares, king pairs, binomial
+ *        coefficients and the leading-pawn offsets.
+ */
+struct Encoding {
+    int map_pawns[kBoardSize]{};
+    int map_b1h1h7[kBoardSize]{};
+    int map_a1d1d4[kBoardSize]{};
+    int map_kk[10][kBoardSize]{};
+    std::uint64_t binomial[6][kBoardSize]{};
+    std::uint64_t lead_pawn_idx[6][kBoardSize]{};
+    std::uint64_t lead_pawns_size[6][4]{};
+
+    Encoding() {
+        int code = 0;
+        for (int square = 0; square < kBoardSize; ++square) {
+            if (off_diagonal(square) < 0) {
+                map_b1h1h7[square] = code++;
+            }
+        }
+
+        // The a1-d1-d4 triangle: squares below the diagonal first, diagonal squares last.
+        std::vector<int> diagonal;
+        code = 0;
+        for (int rank = 0; rank < 4; ++rank) {
+            for (int file = 0; file < 4; ++file) {
+                int square = rank * 8 + file;
+                if (off_diagonal(square) < 0) {
+                    map_a1d1d4[square] = code++;
+                } else if (off_diagonal(square) == 0) {
+                    diagonal.push_back(square);
+                }
+            }
+        }
+        for (int square : diagonal) {
+            map_a1d1d4[square] = code++;
+        }
+
+        // The 462 legal placements of two kings with the first in the triangle; when the first
+        // is on the diagonal the second is not above it, and pairs both on it come last.
+        std::vector<std::pair<int, int>> both_on_diagonal;
+        code = 0;
+        for (int idx = 0; idx < 10; ++idx) {
+            for (int first = 0; first < 28; ++first) {
+                if (map_a1d1d4[first] != idx || (idx == 0 && first != 1)) {
+                    continue;  // b1 is the square mapped to 0.
+                }
+                for (int second = 0; second < kBoardSize; ++second) {
+                    bool touching = std::abs((first & 7) - (second & 7)) <= 1 && std::abs((first >> 3) - (second >> 3)) <= 1;
+                    if (touching) {
+                        continue;
+                    }
+                    if (off_diagonal(first) == 0 && off_diagonal(second) > 0) {
+                        continue;
+                    }
+                    if (off_diagonal(first) == 0 && off_diagonal(second) == 0) {
+                        both_on_diagonal.emplace_back(idx, second);
+                    } else {
+                        map_kk[idx][second] = code++;
+                    }
+                }
+            }
+        }
+        for (const auto& [idx, second] : both_on_diagonal) {
+            map_kk[idx][second] = code++;
+        }
+
+        binomial[0][0] = 1;
+        for (int n = 1; n < kBoardSize; ++n) {
+            for (int k = 0; k < 6 && k <= n; ++k) {
+                binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) + (k < n ? binomial[k][n - 1] : 0);
+            }
+        }
+
+        // map_pawns numbers a2-h7 so that the pawn with the highest value, the one nearest the
+        // edge and then lowest on its file, leads; each lead square restarts the index per file.
+        int available = 47;
+        for (int lead_count = 1; lead_count <= 5; ++lead_count) {
+            for (int file = 0; file < 4; ++file) {
+                std::uint64_t idx = 0;
+                for (int rank = 1; rank <= 6; ++rank) {
+                    int square = rank * 8 + file;
+                    if (lead_count == 1) {
+                        map_pawns[square] = available--;
+                        map_pawns[flip_file(square)] = available--;
+                    }
+                    lead_pawn_idx[lead_count][square] = idx;
+                    idx += binomial[lead_count - 1][map_pawns[square]];
+                }
+                lead_pawns_size[lead_count][file] = idx;
+            }
+        }
+    }
+};
+
+const Encoding& encoding() {
+    static const Encoding tables;
+    return tables;
+}
+
+bool pawns_less(int lhs, int rhs) { return encoding().map_pawns[lhs] < encoding().map_pawns[rhs]; }
+
+/**
+ * @brief One compressed table: the piece order and grouping of its index, plus the canonical
+ *        Huffman code and block directory of its recursive-pairing compressed values.
+ */
+struct PairsData {
+    std::uint8_t flags = 0;
+    int max_sym_len = 0;
+    int min_sym_len = 0;  // The stored value itself for kSingleValueFlag tables.
+    std::uint32_t num_blocks = 0;
+    std::size_t block_size = 0;
+    std::size_t span = 0;                         // One sparse index entry per span values.
+    const std::uint8_t* lowest_sym = nullptr;     // Little-endian u16 per code length.
+    const std::uint8_t* btree = nullptr;          // Two 12-bit child symbols per symbol.
+    const std::uint8_t* block_lengths = nullptr;  // Little-endian u16 values stored minus one.
+    std::uint32_t block_length_count = 0;
+    const std::uint8_t* sparse_index = nullptr;   // u32 block and u16 offset per entry.
+    std::size_t sparse_index_size = 0;
+    const std::uint8_t* data = nullptr;
+    std::vector<std::uint64_t> base64;  // Lowest code of each length, left-aligned in 64 bits.
+    std::vector<std::uint8_t> symlen;   // Values (minus one) a symbol expands to.
+    std::uint8_t pieces[SyzygyTablebases::kMaxPieces]{};
+    std::uint64_t group_idx[SyzygyTablebases::kMaxPieces + 1]{};
+    int group_len[SyzygyTablebases::kMaxPieces + 1]{};
+    std::uint16_t map_idx[4]{};  // DTZ value maps for win, loss, cursed win and blessed loss.
+
+    [[nodiscard]] int left(int sym) const { return ((btree[3 * sym + 1] & 0xF) << 8) | btree[3 * sym]; }
+    [[nodiscard]] int right(int sym) const { return (btree[3 * sym + 2] << 4) | (btree[3 * sym + 1] >> 4); }
+};
+
+/** @brief Bounds-checked reader over a mapped table; alignment is relative to the file start. */
+struct Cursor {
+    const std::uint8_t* base;
+    std::size_t size;
+    std::size_t pos;
+    bool ok = true;
+
+    const std::uint8_t* take(std::size_t bytes) {
+        if (pos > size || bytes > size - pos) {
+            ok = false;
+            pos = size;
+            return base + size;
+        }
+        const std::uint8_t* start = base + pos;
+        pos += bytes;
+        return start;
+    }
+    std::uint8_t u8() { return ok ? *take(1) : 0; }
+    void align(std::size_t alignment) { pos = (pos + alignment - 1) / alignment * alignment; }
+};
+
+/**
+ * @brief Counts the values @p sym expands to, recursing through the pairs it was built from.
+ */
+bool set_symlen(PairsData& d, int sym, std::vector<bool>& visited) {
+    visited[static_cast<std::size_t>(sym)] = true;  // The pairing tree is acyclic.
+    int right = d.right(sym);
+    if (right == 0xFFF) {
+        d.symlen[static_cast<std::size_t>(sym)] = 0;
+        return true;
+    }
+    int left = d.left(sym);
+    int count = static_cast<int>(d.symlen.size());
+    if (left >= count || right >= count) {
+        return false;
+    }
+    for (int child : {left, right}) {
+        if (!visited[static_cast<std::size_t>(child)] && !set_symlen(d, child, visited)) {
+            return false;
+        }
+    }
+    d.symlen[static_cast<std::size_t>(sym)] = static_cast<std::uint8_t>(
+        d.symlen[static_cast<std::size_t>(left)] + d.symlen[static_cast<std::size_t>(right)] + 1);
+    return true;
+}
+
+bool set_sizes(PairsData& d, Cursor& cursor) {
+    d.flags = cursor.u8();
+    if (d.flags & kSingleValueFlag) {
+        d.min_sym_len = cursor.u8();
+        return cursor.ok;
+    }
+
+    const int* end = std::find(d.group_len, d.group_len + SyzygyTablebases::kMaxPieces, 0);
+    std::uint64_t table_size = d.group_idx[end - d.group_len];
+
+    d.block_size = std::size_t{1} << cursor.u8();
+    d.span = std::size_t{1} << cursor.u8();
+    d.sparse_index_size = static_cast<std::size_t>((table_size + d.span - 1) / d.span);
+    std::uint8_t padding = cursor.u8();
+    d.num_blocks = read_le32(cursor.take(4));
+    d.block_length_count = d.num_blocks + padding;  // Keeps sparse entries near the end in range.
+    d.max_sym_len = cursor.u8();
+    d.min_sym_len = cursor.u8();
+    if (!cursor.ok || d.min_sym_len < 1 || d.max_sym_len < d.min_sym_len || d.max_sym_len > 32) {
+        return false;
+    }
+
+    // Canonical Huffman code: longer codes have lower values, so base64[] of the
+    // left-aligned lowest code of each length decreases and finds a code's length by scanning.
+    std::size_t lengths = static_cast<std::size_t>(d.max_sym_len - d.min_sym_len + 1);
+    d.lowest_sym = cursor.take(lengths * 2);
+    d.base64.assign(lengths, 0);
+    for (int i = static_cast<int>(lengths) - 2; i >= 0; --i) {
+        d.base64[static_cast<std::size_t>(i)] =
+            (d.base64[static_cast<std::size_t>(i) + 1] + read_le16(d.lowest_sym + 2 * i) -
+             read_le16(d.lowest_sym + 2 * (i + 1))) /
+            2;
+    }
+    for (std::size_t i = 0; i < lengths; ++i) {
+        d.base64[i] <<= 64 - static_cast<int>(i) - d.min_sym_len;
+    }
+
+    std::size_t symbols = read_le16(cursor.take(2));
+    d.btree = cursor.take(symbols * 3);
+    if (!cursor.ok) {
+        return false;
+    }
+    d.symlen.assign(symbols, 0);
+    std::vector<bool> visited(symbols, false);
+    for (std::size_t sym = 0; sym < symbols; ++sym) {
+        if (!visited[sym] && !set_symlen(d, static_cast<int>(sym), visited)) {
+            return false;
+        }
+    }
+    cursor.take(symbols & 1);
+    return cursor.ok;
+}
+
+/**
+ * @brief Looks up value @p idx: finds its block through the sparse index, walks the block's
+ *        Huffman symbols and expands the pair symbol covering it down to the stored value.
+ */
+int decompress_pairs(const PairsData& d, std::uint64_t idx) {
+    if (d.flags & kSingleValueFlag) {
+        return d.min_sym_len;
+    }
+
+    // Sparse entry k records the block and offset of value k * span + span / 2.
+    std::size_t k = static_cast<std::size_t>(idx / d.span);
+    const std::uint8_t* entry = d.sparse_index + 6 * k;
+    std::uint32_t block = read_le32(entry);
+    long long offset = read_le16(entry + 4);
+    offset += static_cast<long long>(idx % d.span) - static_cast<long long>(d.span / 2);
+
+    while (offset < 0) {
+        offset += read_le16(d.block_lengths + 2 * --block) + 1;
+    }
+    while (offset > read_le16(d.block_lengths + 2 * block)) {
+        offset -= read_le16(d.block_lengths + 2 * block++) + 1;
+    }
+
+    const std::uint8_t* ptr = d.data + static_cast<std::uint64_t>(block) * d.block_size;
+    std::uint64_t buffer = read_be64(ptr);
+    ptr += 8;
+    int buffer_bits = 64;
+    int sym = 0;
+    while (true) {
+        std::size_t len = 0;  // Code length minus min_sym_len.
+        while (buffer < d.base64[len]) {
+            ++len;
+        }
+        sym = static_cast<int>((buffer - d.base64[len]) >> (64 - len - static_cast<std::size_t>(d.min_sym_len)));
+        sym += read_le16(d.lowest_sym + 2 * len);
+        if (offset < d.symlen[static_cast<std::size_t>(sym)] + 1) {
+            break;
+        }
+        offset -= d.symlen[static_cast<std::size_t>(sym)] + 1;
+        int bits = static_cast<int>(len) + d.min_sym_len;
+        buffer <<= bits;
+        buffer_bits -= bits;
+        if (buffer_bits <= 32) {
+            buffer_bits += 32;
+            buffer |= static_cast<std::uint64_t>(read_be32(ptr)) << (64 - buffer_bits);
+            ptr += 4;
+        }
+    }
+
+    // Pair symbols expand into adjacent runs, so descend towards the side holding the offset.
+    while (d.symlen[static_cast<std::size_t>(sym)] != 0) {
+        int left = d.left(sym);
+        if (offset < d.symlen[static_cast<std::size_t>(left)] + 1) {
+            sym = left;
+        } else {
+            offset -= d.symlen[static_cast<std::size_t>(left)] + 1;
+            sym = d.right(sym);
+        }
+    }
+    return d.left(sym);
+}
+
+int dtz_before_zeroing(int wdl) {
+    switch (wdl) {
+        case 2:
+            return 1;
+        case 1:
+            return 101;
+        case -1:
+            return -101;
+        case -2:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+std::uint8_t piece_code(Color color, PieceType type) {
+    return static_cast<std::uint8_t>((static_cast<int>(color) << 3) | (static_cast<int>(type) + 1));
+}
+
+/** @brief Packs per-type piece counts, the first color's in the low 20 bits. */
+std::uint64_t material_key(const std::array<std::array<int, kPieceTypesWithoutKing>, kNumColors>& counts,
+                           bool swap_colors) {
+    std::uint64_t key = 0;
+    for (int color = 0; color < kNumColors; ++color) {
+        int side = swap_colors ? 1 - color : color;
+        for (int type = 0; type < kPieceTypesWithoutKing; ++type) {
+            key |= static_cast<std::uint64_t>(counts[static_cast<std::size_t>(side)][static_cast<std::size_t>(type)])
+                   << (4 * (type + kPieceTypesWithoutKing * color));
+        }
+    }
+    return key;
+}
+
+/** @brief Parses a table name such as "KRPvKR" into piece counts; false if it is not one. */
+bool parse_material(const std::string& name, std::array<std::array<int, kPieceTypesWithoutKing>, kNumColors>& counts) {
+    std::size_t split = name.find('v');
+    if (split == std::string::npos || name.find('v', split + 1) != std::string::npos) {
+        return false;
+    }
+    counts = {};
+    const std::string sides[kNumColors] = {name.substr(0, split), name.substr(split + 1)};
+    for (int color = 0; color < kNumColors; ++color) {
+        const std::string& side = sides[color];
+        if (side.empty() || side[0] != 'K') {
+            return false;
+        }
+        for (std::size_t i = 1; i < side.size(); ++i) {
+            std::size_t type = std::string("PNBRQ").find(side[i]);
+            if (type == std::string::npos) {
+                return false;
+            }
+            ++counts[static_cast<std::size_t>(color)][type];
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> split_paths(const std::string& paths) {
+#ifdef _WIN32
+    const std::string separators = ";";
+#else
+    const std::string separators = ":;";
+#endif
+    std::vector<std::string> result;
+    std::size_t start = 0;
+    while (start <= paths.size()) {
+        std::size_t end = paths.find_first_of(separators, start);
+        if (end == std::string::npos) {
+            end = paths.size();
+        }
+        if (end > start) {
+            result.push_back(paths.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+    return result;
+}
+
+}  // namespace
+
+struct SyzygyTablebases::Table {
+    std::shared_ptr<const nnue::MappedFile> file;
+    bool dtz = false;
+    int piece_count = 0;
+    bool has_pawns = false;
+    bool has_unique_pieces = false;  // Some non-king piece is the only one of its type and color.
+    bool symmetric = false;          // Both sides have the same material; only white to move is stored.
+    int pawn_count[2]{};             // The leading color's pawns first.
+    PairsData items[2][4];           // [side to move][leading pawn file, or 0 without pawns]
+    const std::uint8_t* dtz_map = nullptr;
+
+    PairsData& get(int stm, int file) { return items[dtz ? 0 : stm % 2][has_pawns ? file : 0]; }
+    [[nodiscard]] const PairsData& get(int stm, int file) const {
+        return items[dtz ? 0 : stm % 2][has_pawns ? file : 0];
+    }
+
+    /** @brief Sizes the index groups: pieces[] defines the groups, @p order the order they nest in. */
+    bool set_groups(PairsData& d, const int order[2], int file) const {
+        const Encoding& enc = encoding();
+        int n = 0;
+        int first_len = has_pawns ? 0 : has_unique_pieces ? 3 : 2;
+        d.group_len[n] = 1;
+        for (int i = 1; i < piece_count; ++i) {
+            if (--first_len > 0 || d.pieces[i] == d.pieces[i - 1]) {
+                d.group_len[n]++;
+            } else {
+                d.group_len[++n] = 1;
+            }
+        }
+        d.group_len[++n] = 0;
+        for (int i = 0; i < n; ++i) {
+            if (d.group_len[i] > 5) {
+                return false;
+            }
+        }
+
+        bool both_have_pawns = has_pawns && pawn_count[1] > 0;
+        int next = both_have_pawns ? 2 : 1;
+        int free_squares = 64 - d.group_len[0] - (both_have_pawns ? d.group_len[1] : 0);
+        std::uint64_t idx = 1;
+        for (int k = 0; next < n || k == order[0] || k == order[1]; ++k) {
+            if (k == order[0]) {
+                d.group_idx[0] = idx;
+                idx *= has_pawns ? enc.lead_pawns_size[d.group_len[0]][file] : has_unique_pieces ? 31332 : 462;
+            } else if (k == order[1]) {
+                d.group_idx[1] = idx;
+                idx *= enc.binomial[d.group_len[1]][48 - d.group_len[0]];
+            } else {
+                d.group_idx[next] = idx;
+                idx *= enc.binomial[d.group_len[next]][free_squares];
+                free_squares -= d.group_len[next++];
+            }
+        }
+        d.group_idx[n] = idx;
+        return true;
+    }
+
+    bool parse() {
+        const auto* base = reinterpret_cast<const std::uint8_t*>(file->data());
+        Cursor cursor{base, file->size(), 4};
+        std::uint8_t header = cursor.u8();
+        if (((header & 2) != 0) != has_pawns || ((header & 1) != 0) == symmetric) {
+            return false;
+        }
+
+        const int sides = !dtz && !symmetric ? 2 : 1;
+        const int max_file = has_pawns ? 3 : 0;
+        const bool both_have_pawns = has_pawns && pawn_count[1] > 0;
+        for (int f = 0; f <= max_file; ++f) {
+            std::uint8_t first = cursor.u8();
+            std::uint8_t second = both_have_pawns ? cursor.u8() : 0;
+            const int order[2][2] = {{first & 0xF, both_have_pawns ? second & 0xF : 0xF},
+                                     {first >> 4, both_have_pawns ? second >> 4 : 0xF}};
+            for (int k = 0; k < piece_count; ++k) {
+                std::uint8_t byte = cursor.u8();
+                for (int i = 0; i < sides; ++i) {
+                    std::uint8_t* pieces = get(i, f).pieces;
+                    // load_file() checked piece_count <= kMaxPieces; the modulo only helps GCC see it.
+                    pieces[k % kMaxPieces] = static_cast<std::uint8_t>(i ? byte >> 4 : byte & 0xF);
+                }
+            }
+            for (int i = 0; i < sides; ++i) {
+                if (!set_groups(get(i, f), order[i], f)) {
+                    return false;
+                }
+            }
+        }
+        cursor.align(2);
+
+        for (int f = 0; f <= max_file; ++f) {
+            for (int i = 0; i < sides; ++i) {
+                if (!set_sizes(get(i, f), cursor)) {
+                    return false;
+                }
+            }
+        }
+
+        if (dtz) {
+            std::size_t map_start = cursor.pos;
+            dtz_map = base + std::min(map_start, cursor.size);
+            for (int f = 0; f <= max_file; ++f) {
+                PairsData& d = get(0, f);
+                if (!(d.flags & kMappedFlag)) {
+                    continue;
+                }
+                if (d.flags & kWideFlag) {
+                    cursor.align(2);  // A mixed table may switch to 16-bit maps here.
+                    for (std::uint16_t& index : d.map_idx) {
+                        index = static_cast<std::uint16_t>((cursor.pos - map_start) / 2 + 1);
+                        cursor.take(2 * static_cast<std::size_t>(read_le16(cursor.take(2))));
+                    }
+                } else {
+                    for (std::uint16_t& index : d.map_idx) {
+                        index = static_cast<std::uint16_t>(cursor.pos - map_start + 1);
+                        cursor.take(cursor.u8());
+                    }
+                }
+            }
+            cursor.align(2);
+        }
+
+        for (int f = 0; f <= max_file; ++f) {
+            for (int i = 0; i < sides; ++i) {
+                PairsData& d = get(i, f);
+                d.sparse_index = cursor.take(d.sparse_index_size * 6);
+            }
+        }
+        for (int f = 0; f <= max_file; ++f) {
+            for (int i = 0; i < sides; ++i) {
+                PairsData& d = get(i, f);
+                d.block_lengths = cursor.take(static_cast<std::size_t>(d.block_length_count) * 2);
+            }
+        }
+        for (int f = 0; f <= max_file; ++f) {
+            for (int i = 0; i < sides; ++i) {
+                PairsData& d = get(i, f);
+                cursor.align(64);
+                d.data = cursor.take(static_cast<std::size_t>(d.num_blocks) * d.block_size);
+            }
+        }
+        return cursor.ok;
+    }
+
+    [[nodiscard]] int map_dtz(int file, int value, int wdl) const {
+        constexpr int kWdlMap[] = {1, 3, 0, 2, 0};
+        const PairsData& d = get(0, file);
+        if (d.flags & kMappedFlag) {
+            int index = d.map_idx[kWdlMap[wdl + 2]] + value;
+            value = (d.flags & kWideFlag) ? read_le16(dtz_map + 2 * index) : dtz_map[index];
+        }
+        // Tables store moves unless flagged otherwise; callers always get plies.
+        if ((wdl == 2 && !(d.flags & kWinPliesFlag)) || (wdl == -2 && !(d.flags & kLossPliesFlag)) || wdl == 1 ||
+            wdl == -1) {
+            value *= 2;
+        }
+        return value + 1;
+    }
+};
+
+SyzygyTablebases::SyzygyTablebases(const std::string& paths) {
+    for (const std::string& directory : split_paths(paths)) {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string extension = entry.path().extension().string();
+            if (extension == ".rtbw" || extension == ".rtbz") {
+                load_file(entry.path().string(), entry.path().stem().string(), extension == ".rtbz");
+            }
+        }
+    }
+}
+
+SyzygyTablebases::~SyzygyTablebases() = default;
+
+void SyzygyTablebases::load_file(const std::string& path, const std::string& material, bool dtz) {
+    std::array<std::array<int, kPieceTypesWithoutKing>, kNumColors> counts{};
+    if (!parse_material(material, counts)) {
+        return;
+    }
+    auto table = std::make_unique<Table>();
+    table->dtz = dtz;
+    table->piece_count = 2;
+    for (int color = 0; color < kNumColors; ++color) {
+        for (int type = 0; type < kPieceTypesWithoutKing; ++type) {
+            int count = counts[static_cast<std::size_t>(color)][static_cast<std::size_t>(type)];
+            table->piece_count += count;
+            if (count == 1) {
+                table->has_unique_pieces = true;
+            }
+        }
+    }
+    std::uint64_t key = material_key(counts, false);
+    auto& index = dtz ? dtz_by_material_ : wdl_by_material_;
+    if (table->piece_count > kMaxPieces || index.count(key) != 0) {
+        return;
+    }
+    table->symmetric = key == material_key(counts, true);
+    int white_pawns = counts[0][static_cast<std::size_t>(PieceType::Pawn)];
+    int black_pawns = counts[1][static_cast<std::size_t>(PieceType::Pawn)];
+    table->has_pawns = white_pawns + black_pawns > 0;
+    // The side with fewer pawns leads, which compresses better.
+    bool white_leads = black_pawns == 0 || (white_pawns > 0 && black_pawns >= white_pawns);
+    table->pawn_count[0] = white_leads ? white_pawns : black_pawns;
+    table->pawn_count[1] = white_leads ? black_pawns : white_pawns;
+
+    try {
+        table->file = nnue::MappedFile::open(path);
+    } catch (const std::runtime_error&) {
+        return;
+    }
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(table->file->data());
+    const std::uint8_t* magic = dtz ? kDtzMagic : kWdlMagic;
+    if (table->file->size() % 64 != 16 || !std::equal(magic, magic + 4, bytes) || !table->parse()) {
+        return;
+    }
+
+    index.emplace(key, table.get());
+    if (!dtz) {
+        max_pieces_ = std::max(max_pieces_, table->piece_count);
+    }
+    (dtz ? dtz_tables_ : wdl_tables_).push_back(std::move(table));
+}
+
+bool SyzygyTablebases::may_cover(const Board& board) const {
+    return max_pieces_ > 0 && board.castling_rights() == 0 && popcount(board.occupancy_all()) <= max_pieces_;
+}
+
+const SyzygyTablebases::Table* SyzygyTablebases::find(const Board& board, bool dtz, bool& black_stronger) const {
+    std::array<std::array<int, kPieceTypesWithoutKing>, kNumColors> counts{};
+    for (int color = 0; color < kNumColors; ++color) {
+        for (int type = 0; type < kPieceTypesWithoutKing; ++type) {
+            counts[static_cast<std::size_t>(color)][static_cast<std::size_t>(type)] =
+                popcount(board.pieces(static_cast<Color>(color), static_cast<PieceType>(type)));
+        }
+    }
+    const auto& index = dtz ? dtz_by_material_ : wdl_by_material_;
+    for (bool swap : {false, true}) {
+        auto it = index.find(material_key(counts, swap));
+        if (it != index.end()) {
+            black_stronger = swap;
+            return it->second;
+        }
+    }
+    return nullptr;
+}
+
+int SyzygyTablebases::probe_table(const Board& board, bool dtz, Wdl wdl, ProbeState& state) const {
+    if (popcount(board.occupancy_all()) == 2) {
+        return 0;  // Bare kings.
+    }
+    bool black_stronger = false;
+    const Table* table = find(board, dtz, black_stronger);
+    if (table == nullptr) {
+        state = ProbeState::kFail;
+        return 0;
+    }
+    const Encoding& enc = encoding();
+
+    // Tables are built with white as the stronger side, and symmetric ones for white to move
+    // only, so other positions are probed with colors swapped and the board flipped.
+    bool black_to_move = board.side_to_move() == Color::Black;
+    bool flip = (table->symmetric && black_to_move) || black_stronger;
+    int flip_color = flip ? 8 : 0;
+    int flip_squares = flip ? 56 : 0;
+    int stm = (flip ? 1 : 0) ^ (black_to_move ? 1 : 0);
+
+    int squares[kMaxPieces]{};
+    std::uint8_t pieces[kMaxPieces]{};
+    int size = 0;
+    int lead_pawns_count = 0;
+    Bitboard lead_pawns = 0ULL;
+    int tb_file = 0;
+    if (table->has_pawns) {
+        // Pawns of the reference color come first; separate tables exist per leading pawn file.
+        int lead_code = table->get(0, 0).pieces[0] ^ flip_color;
+        Color lead_color = (lead_code & 8) ? Color::Black : Color::White;
+        lead_pawns = board.pieces(lead_color, PieceType::Pawn);
+        Bitboard remaining = lead_pawns;
+        while (remaining != 0ULL && size < kMaxPieces) {
+            squares[size++] = pop_lsb(remaining) ^ flip_squares;
+        }
+        lead_pawns_count = size;
+        std::swap(squares[0], *std::max_element(squares, squares + lead_pawns_count, pawns_less));
+        tb_file = edge_distance(squares[0] & 7);
+    }
+
+    // DTZ tables store one side to move; the caller then searches one ply deeper.
+    if (dtz) {
+        const PairsData& d = table->get(stm, tb_file);
+        if ((d.flags & kSideToMoveFlag) != stm && !(table->symmetric && !table->has_pawns)) {
+            state = ProbeState::kChangeSideToMove;
+            return 0;
+        }
+    }
+
+    Bitboard others = board.occupancy_all() ^ lead_pawns;
+    while (others != 0ULL && size < kMaxPieces) {
+        int square = pop_lsb(others);
+        Color color = board.color_at(square).value_or(Color::White);
+        squares[size] = square ^ flip_squares;
+        pieces[size++] = static_cast<std::uint8_t>(piece_code(color, board.piece_type_at(square)) ^ flip_color);
+    }
+
+    const PairsData& d = table->get(stm, tb_file);
+    // Bring the pieces into the order the table encodes them in.
+    for (int i = lead_pawns_count; i < size - 1; ++i) {
+        for (int j = i + 1; j < size; ++j) {
+            if (d.pieces[i] == pieces[j]) {
+                std::swap(pieces[i], pieces[j]);
+                std::swap(squares[i], squares[j]);
+                break;
+            }
+        }
+    }
+
+    // Mirror so the leading piece is on files a-d.
+    if ((squares[0] & 7) > 3) {
+        for (int i = 0; i < size; ++i) {
+            squares[i] = flip_file(squares[i]);
+        }
+    }
+
+    std::uint64_t idx = 0;
+    if (table->has_pawns) {
+        idx = enc.lead_pawn_idx[lead_pawns_count][squares[0]];
+        std::stable_sort(squares + 1, squares + lead_pawns_count, pawns_less);
+        for (int i = 1; i < lead_pawns_count; ++i) {
+            idx += enc.binomial[i][enc.map_pawns[squares[i]]];
+        }
+    } else {
+        // Without pawns the board is also mirrored onto ranks 1-4 and then below the a1-h8
+        // diagonal, at the first leading piece that is off it.
+        if ((squares[0] >> 3) > 3) {
+            for (int i = 0; i < size; ++i) {
+                squares[i] = flip_rank(squares[i]);
+            }
+        }
+        for (int i = 0; i < d.group_len[0]; ++i) {
+            if (off_diagonal(squares[i]) == 0) {
+                continue;
+            }
+            if (off_diagonal(squares[i]) > 0) {
+                for (int j = i; j < size; ++j) {
+                    squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+                }
+            }
+            break;
+        }
+
+        if (table->has_unique_pieces) {
+            // Three unique pieces (kings included) are placed together.
+            int adjust1 = squares[1] > squares[0];
+            int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+            if (off_diagonal(squares[0]) != 0) {
+                idx = (static_cast<std::uint64_t>(enc.map_a1d1d4[squares[0]]) * 63 + (squares[1] - adjust1)) * 62 +
+                      (squares[2] - adjust2);
+            } else if (off_diagonal(squares[1]) != 0) {
+                idx = (6 * 63 + static_cast<std::uint64_t>(squares[0] >> 3) * 28 + enc.map_b1h1h7[squares[1]]) * 62 +
+                      (squares[2] - adjust2);
+            } else if (off_diagonal(squares[2]) != 0) {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + static_cast<std::uint64_t>(squares[0] >> 3) * 7 * 28 +
+                      static_cast<std::uint64_t>((squares[1] >> 3) - adjust1) * 28 + enc.map_b1h1h7[squares[2]];
+            } else {
+                idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + static_cast<std::uint64_t>(squares[0] >> 3) * 7 * 6 +
+                      static_cast<std::uint64_t>((squares[1] >> 3) - adjust1) * 6 +
+                      static_cast<std::uint64_t>((squares[2] >> 3) - adjust2);
+            }
+        } else {
+            idx = static_cast<std::uint64_t>(enc.map_kk[enc.map_a1d1d4[squares[0]]][squares[1]]);
+        }
+    }
+
+    // Remaining groups, each a combination of the squares left free by the groups before it.
+    idx *= d.group_idx[0];
+    int* group = squares + d.group_len[0];
+    bool remaining_pawns = table->has_pawns && table->pawn_count[1] > 0;
+    for (int next = 1; d.group_len[next] != 0; ++next) {
+        int length = d.group_len[next];
+        std::stable_sort(group, group + length);
+        std::uint64_t n = 0;
+        for (int i = 0; i < length; ++i) {
+            auto adjust = std::count_if(squares, group, [&](int square) { return group[i] > square; });
+            n += enc.binomial[i + 1][group[i] - adjust - 8 * remaining_pawns];
+        }
+        remaining_pawns = false;
+        idx += n * d.group_idx[next];
+        group += length;
+    }
+
+    int value = decompress_pairs(d, idx);
+    return dtz ? table->map_dtz(tb_file, value, static_cast<int>(wdl)) : value - 2;
+}
+
+// A table may store any value for positions where the side to move has a winning capture, and
+// a loss where a capture draws, so captures (and for DTZ pawn moves) are searched first.
+Wdl SyzygyTablebases::search_wdl(Board& board, bool check_zeroing_moves, ProbeState& state) const {
+    MoveList moves;
+    MoveGenerator::generate_legal_moves(board, moves);
+    int best = static_cast<int>(Wdl::Loss);
+    std::size_t searched = 0;
+    for (const Move& move : moves) {
+        if (!move.is_capture() && (!check_zeroing_moves || board.piece_type_at(move.from) != PieceType::Pawn)) {
+            continue;
+        }
+        ++searched;
+        Board::State undo;
+        board.make_move(move, undo);
+        int value = -static_cast<int>(search_wdl(board, false, state));
+        board.undo_move(move, undo);
+        if (state == ProbeState::kFail) {
+            return Wdl::Draw;
+        }
+        if (value > best) {
+            best = value;
+            if (value >= static_cast<int>(Wdl::Win)) {
+                state = ProbeState::kZeroingBestMove;
+                return Wdl::Win;
+            }
+        }
+    }
+
+    // With every move searched the stored value is not needed (and wrong with en passant).
+    bool no_more_moves = searched != 0 && searched == moves.size();
+    int value = best;
+    if (!no_more_moves) {
+        value = probe_table(board, false, Wdl::Draw, state);
+        if (state == ProbeState::kFail) {
+            return Wdl::Draw;
+        }
+    }
+    if (best >= value) {
+        state = best > 0 || no_more_moves ? ProbeState::kZeroingBestMove : ProbeState::kOk;
+        return static_cast<Wdl>(best);
+    }
+    state = ProbeState::kOk;
+    return static_cast<Wdl>(value);
+}
+
+int SyzygyTablebases::search_dtz(Board& board, ProbeState& state) const {
+    state = ProbeState::kOk;
+    int wdl = static_cast<int>(search_wdl(board, true, state));
+    if (state == ProbeState::kFail || wdl == 0) {
+        return 0;  // DTZ tables do not store draws.
+    }
+    if (state == ProbeState::kZeroingBestMove) {
+        return dtz_before_zeroing(wdl);
+    }
+    int dtz = probe_table(board, true, static_cast<Wdl>(wdl), state);
+    if (state == ProbeState::kFail) {
+        return 0;
+    }
+    if (state != ProbeState::kChangeSideToMove) {
+        return (dtz + 100 * (wdl == -1 || wdl == 1)) * sign_of(wdl);
+    }
+
+    // The table stores the other side to move: take the best reply one ply deeper.
+    MoveList moves;
+    MoveGenerator::generate_legal_moves(board, moves);
+    int min_dtz = 0xFFFF;
+    for (const Move& move : moves) {
+        bool zeroing = move.is_capture() || board.piece_type_at(move.from) == PieceType::Pawn;
+        Board::State undo;
+        board.make_move(move, undo);
+        // A zeroing move counts from before it is played; the search only supplies the sign.
+        dtz = zeroing ? -dtz_before_zeroing(static_cast<int>(search_wdl(board, false, state)))
+                      : -search_dtz(board, state);
+        if (dtz == 1 && board.in_check(board.side_to_move())) {
+            MoveList replies;
+            MoveGenerator::generate_legal_moves(board, replies);
+            if (replies.size() == 0) {
+                min_dtz = 1;  // Mate.
+            }
+        }
+        if (!zeroing) {
+            dtz += sign_of(dtz);
+        }
+        if (dtz < min_dtz && sign_of(dtz) == sign_of(wdl)) {
+            min_dtz = dtz;
+        }
+        board.undo_move(move, undo);
+        if (state == ProbeState::kFail) {
+            return 0;
+        }
+    }
+    return min_dtz == 0xFFFF ? -1 : min_dtz;
+}
+
+std::optional<Wdl> SyzygyTablebases::probe_wdl(const Board& board) const {
+    if (!may_cover(board)) {
+        return std::nullopt;
+    }
+    Board copy = board;
+    ProbeState state = ProbeState::kOk;
+    Wdl wdl = search_wdl(copy, false, state);
+    if (state == ProbeState::kFail) {
+        return std::nullopt;
+    }
+    return wdl;
+}
+
+std::optional<int> SyzygyTablebases::probe_dtz(const Board& board) const {
+    if (!may_cover(board)) {
+        return std::nullopt;
+    }
+    Board copy = board;
+    ProbeState state = ProbeState::kOk;
+    int dtz = search_dtz(copy, state);
+    if (state == ProbeState::kFail) {
+        return std::nullopt;
+    }
+    return dtz;
+}
+
+std::optional<SyzygyTablebases::RootProbe> SyzygyTablebases::probe_root(const Board& root,
+                                                                       const KeyHistory& history) const {
+    if (!may_cover(root)) {
+        return std::nullopt;
+    }
+    Board board = root;
+    MoveList moves;
+    MoveGenerator::generate_legal_moves(board, moves);
+    if (moves.size() == 0) {
+        return std::nullopt;
+    }
+
+    const int clock = board.halfmove_clock();
+    const bool repeated = history.repetitions(clock) > 0;
+    KeyHistory path = history;
+    std::vector<int> ranks;
+    ranks.reserve(moves.size());
+    bool used_dtz = !dtz_tables_.empty();
+    if (used_dtz) {
+        for (const Move& move : moves) {
+            Board::State undo;
+            board.make_move(move, undo);
+            path.push(board.zobrist_key());
+            ProbeState state = ProbeState::kOk;
+            int dtz = 0;
+            if (board.halfmove_clock() == 0) {
+                dtz = dtz_before_zeroing(-static_cast<int>(search_wdl(board, false, state)));
+            } else if (board.halfmove_clock() >= 100 || path.repetitions(board.halfmove_clock()) >= 2) {
+                dtz = 0;  // Draws by the fifty-move rule or a third repetition in the game.
+            } else {
+                dtz = -search_dtz(board, state);
+                dtz += sign_of(dtz);
+            }
+            if (dtz == 2 && board.in_check(board.side_to_move())) {
+                MoveList replies;
+                MoveGenerator::generate_legal_moves(board, replies);
+                if (replies.size() == 0) {
+                    dtz = 1;
+                }
+            }
+            path.pop();
+            board.undo_move(move, undo);
+            if (state == ProbeState::kFail) {
+                used_dtz = false;
+                ranks.clear();
+                break;
+            }
+            // Wins that convert before the fifty-move rule rank equally; slower wins and losses
+            // rank by how close the counter gets to a draw claim.
+            int rank = 0;
+            if (dtz > 0) {
+                rank = dtz + clock <= 99 && !repeated ? 1000 : 1000 - (dtz + clock);
+            } else if (dtz < 0) {
+                rank = -dtz * 2 + clock < 100 ? -1000 : -1000 + (-dtz + clock);
+            }
+            ranks.push_back(rank);
+        }
+    }
+    if (!used_dtz) {
+        constexpr int kWdlRank[] = {-1000, -899, 0, 899, 1000};
+        for (const Move& move : moves) {
+            Board::State undo;
+            board.make_move(move, undo);
+            ProbeState state = ProbeState::kOk;
+            int wdl = -static_cast<int>(search_wdl(board, false, state));
+            board.undo_move(move, undo);
+            if (state == ProbeState::kFail) {
+                return std::nullopt;
+            }
+            ranks.push_back(kWdlRank[wdl + 2]);
+        }
+    }
+
+    RootProbe probe;
+    probe.used_dtz = used_dtz;
+    int best = *std::max_element(ranks.begin(), ranks.end());
+    std::size_t index = 0;
+    for (const Move& move : moves) {
+        if (ranks[index++] == best) {
+            probe.moves.push_back(move);
+        }
+    }
+    constexpr int kCertainBound = 900;
+    probe.wdl = best >= kCertainBound ? Wdl::Win
+                : best > 0            ? Wdl::CursedWin
+                : best == 0           ? Wdl::Draw
+                : best > -kCertainBound ? Wdl::BlessedLoss
+                                        : Wdl::Loss;
+    return probe;
+}
+
+}  // namespace chiron
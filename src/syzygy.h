@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "board.h"
+#include "key_history.h"
+#include "move.h"
+
+namespace chiron {
+
+namespace nnue {
+class MappedFile;
+}
+
+/**
+ * @brief Tablebase result from the side to move's point of view.
+ *
+ * Cursed wins and blessed losses are wins and losses that the fifty-move rule turns into draws.
+ */
+enum class Wdl : int {
+    Loss = -2,
+    BlessedLoss = -1,
+    Draw = 0,
+    CursedWin = 1,
+    Win = 2
+};
+
+/**
+ * @brief Read-only Syzygy WDL (.rtbw) and DTZ (.rtbz) tablebases.
+ *
+ * Every table found when the object is constructed is memory-mapped and its header parsed
+ * up front, so probing never takes a lock and one instance can be shared by any number of
+ * search threads. Positions with castling rights are never covered.
+ */
+class SyzygyTablebases {
+   public:
+    static constexpr int kMaxPieces = 7;
+
+    /**
+     * @brief Loads the tables in the directories listed in @p paths, separated by ';' (and by ':'
+     *        outside Windows). Missing directories and malformed files are skipped.
+     */
+    explicit SyzygyTablebases(const std::string& paths);
+    ~SyzygyTablebases();
+
+    SyzygyTablebases(const SyzygyTablebases&) = delete;
+    SyzygyTablebases& operator=(const SyzygyTablebases&) = delete;
+
+    /** @brief Largest piece count, kings included, with a WDL table; 0 when nothing was loaded. */
+    [[nodiscard]] int max_pieces() const { return max_pieces_; }
+    [[nodiscard]] std::size_t wdl_table_count() const { return wdl_tables_.size(); }
+    [[nodiscard]] std::size_t dtz_table_count() const { return dtz_tables_.size(); }
+
+    /** @brief Cheap test of whether a probe can succeed: few enough pieces and no castling rights. */
+    [[nodiscard]] bool may_cover(const Board& board) const;
+
+    /**
+     * @brief Returns the game-theoretic result with the side to move, or nothing if a needed
+     *        table is missing. Only captures from @p board are searched, so it is cheap.
+     */
+    [[nodiscard]] std::optional<Wdl> probe_wdl(const Board& board) const;
+
+    /**
+     * @brief Returns the signed distance in plies to the next capture or pawn move that keeps the
+     *        result (positive when the side to move wins), or nothing if a table is missing.
+     *
+     * Drawn positions return 0; a result of 101 or more is a cursed win (or blessed loss).
+     */
+    [[nodiscard]] std::optional<int> probe_dtz(const Board& board) const;
+
+    struct RootProbe {
+        std::vector<Move> moves; /**< The legal moves that keep the best tablebase result. */
+        Wdl wdl = Wdl::Draw;     /**< That result, with the fifty-move counter taken into account. */
+        bool used_dtz = false;   /**< Moves were ranked by DTZ; otherwise by WDL alone. */
+    };
+
+    /**
+     * @brief Ranks the root moves of @p board and keeps the best ones.
+     *
+     * With DTZ tables, winning moves that convert within the fifty-move rule are preferred and a
+     * losing side keeps the moves that hold out longest. @p history ends with the root's key and
+     * marks root moves that repeat a position for the third time as draws.
+     */
+    [[nodiscard]] std::optional<RootProbe> probe_root(const Board& board, const KeyHistory& history) const;
+
+   private:
+    struct Table;
+    enum class ProbeState { kOk, kFail, kZeroingBestMove, kChangeSideToMove };
+
+    void load_file(const std::string& path, const std::string& material, bool dtz);
+    [[nodiscard]] const Table* find(const Board& board, bool dtz, bool& black_stronger) const;
+    [[nodiscard]] int probe_table(const Board& board, bool dtz, Wdl wdl, ProbeState& state) const;
+    [[nodiscard]] Wdl search_wdl(Board& board, bool check_zeroing_moves, ProbeState& state) const;
+    [[nodiscard]] int search_dtz(Board& board, ProbeState& state) const;
+
+    std::vector<std::unique_ptr<Table>> wdl_tables_;
+    std::vector<std::unique_ptr<Table>> dtz_tables_;
+    std::unordered_map<std::uint64_t, const Table*> wdl_by_material_;  // Keyed by the table's own colors.
+    std::unordered_map<std::uint64_t, const Table*> dtz_by_material_;
+    int max_pieces_ = 0;
+};
+
+}  // namespace chiron
@@ -0,0 +1,165 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace chiron::trace {
+
+namespace detail {
+std::atomic<bool> enabled{false};
+}  // namespace detail
+
+namespace {
+
+struct Event {
+    const char* name = nullptr;
+    std::int64_t begin_ns = 0;
+    std::int64_t duration_ns = 0;
+};
+
+/** @brief One thread's ring; its mutex is only ever contended by start() and stop(). */
+struct ThreadRing {
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::size_t next = 0;  // Slot the next span goes to.
+    std::size_t count = 0;
+    int thread_id = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadRing>> rings;  // Every ring ever created, for the export.
+    std::vector<std::shared_ptr<ThreadRing>> idle;   // Rings whose threads have exited.
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+/** @brief A thread's claim on a ring, handed back to the idle list when the thread exits. */
+struct RingLease {
+    std::shared_ptr<ThreadRing> ring;
+
+    RingLease() = default;
+    RingLease(const RingLease&) = delete;
+    RingLease& operator=(const RingLease&) = delete;
+    ~RingLease() {
+        if (ring) {
+            Registry& shared = registry();
+            std::lock_guard<std::mutex> lock(shared.mutex);
+            shared.idle.push_back(std::move(ring));
+        }
+    }
+};
+
+ThreadRing& thread_ring() {
+    thread_local RingLease lease;
+    if (!lease.ring) {
+        Registry& shared = registry();
+        std::lock_guard<std::mutex> lock(shared.mutex);
+        if (!shared.idle.empty()) {
+            lease.ring = std::move(shared.idle.back());
+            shared.idle.pop_back();
+        } else {
+            lease.ring = std::make_shared<ThreadRing>();
+            lease.ring->events.resize(kRingCapacity);
+            lease.ring->thread_id = static_cast<int>(shared.rings.size()) + 1;
+            shared.rings.push_back(lease.ring);
+        }
+    }
+    return *lease.ring;
+}
+
+void write_json_string(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            out << '\\';
+        }
+        out << *c;
+    }
+    out << '"';
+}
+
+}  // namespace
+
+namespace detail {
+
+void record(const char* name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+    ThreadRing& ring = thread_ring();
+    std::chrono::steady_clock::time_point epoch = registry().epoch;
+    std::lock_guard<std::mutex> lock(ring.mutex);
+    ring.events[ring.next] = {name, std::chrono::duration_cast<std::chrono::nanoseconds>(begin - epoch).count(),
+                              std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count()};
+    ring.next = (ring.next + 1) % kRingCapacity;
+    ring.count = std::min(ring.count + 1, kRingCapacity);
+}
+
+}  // namespace detail
+
+void start() {
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (const std::shared_ptr<ThreadRing>& ring : shared.rings) {
+        std::lock_guard<std::mutex> ring_lock(ring->mutex);
+        ring->next = 0;
+        ring->count = 0;
+    }
+    detail::enabled.store(true);
+}
+
+void stop(const std::string& path) {
+    detail::enabled.store(false);
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Unable to write trace file: " + path);
+    }
+
+    // Complete ("X") events in microseconds, plus one name record per thread. Fixed notation keeps
+    // nanosecond digits however long the session ran; the default precision rounds to 100 us by 10 s.
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (const std::shared_ptr<ThreadRing>& ring : shared.rings) {
+        std::lock_guard<std::mutex> ring_lock(ring->mutex);
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->thread_id
+            << ",\"args\":{\"name\":\"thread " << ring->thread_id << "\"}}";
+        first = false;
+        std::size_t oldest = (ring->next + kRingCapacity - ring->count) % kRingCapacity;
+        for (std::size_t i = 0; i < ring->count; ++i) {
+            const Event& event = ring->events[(oldest + i) % kRingCapacity];
+            out << ",\n{\"name\":";
+            write_json_string(out, event.name);
+            out << ",\"cat\":\"chiron\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->thread_id
+                << ",\"ts\":" << static_cast<double>(event.begin_ns) / 1000.0
+                << ",\"dur\":" << static_cast<double>(event.duration_ns) / 1000.0 << '}';
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        throw std::runtime_error("Failed while writing trace file: " + path);
+    }
+}
+
+std::size_t recorded_spans() {
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    std::size_t total = 0;
+    for (const std::shared_ptr<ThreadRing>& ring : shared.rings) {
+        std::lock_guard<std::mutex> ring_lock(ring->mutex);
+        total += ring->count;
+    }
+    return total;
+}
+
+}  // namespace chiron::trace
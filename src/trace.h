@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace chiron::trace {
+
+/**
+ * @brief Optional wall-clock tracing of scoped spans, exported in Chrome's trace event format
+ *        (load the file in chrome://tracing or ui.perfetto.dev).
+ *
+ * Every thread records into its own fixed-size ring buffer, so a span costs two clock reads
+ * and a store under the ring's mutex while tracing is on (only start(), stop() and
+ * recorded_spans() ever contend for it), and a single relaxed load while it is off. When a
+ * ring fills, the oldest spans are overwritten. A thread that exits hands its ring, spans
+ * and all, to the next thread that starts tracing, so short-lived threads such as one search
+ * per `go` do not add a ring each. Span names must be string literals, or otherwise outlive
+ * the export.
+ */
+
+/** @brief Spans each thread keeps before the oldest are overwritten. */
+constexpr std::size_t kRingCapacity = std::size_t{1} << 16;
+
+namespace detail {
+extern std::atomic<bool> enabled;
+void record(const char* name, std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+}  // namespace detail
+
+/** @brief True while spans are being recorded. */
+[[nodiscard]] inline bool enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+/** @brief Starts recording, dropping spans left from an earlier session. */
+void start();
+
+/**
+ * @brief Stops recording and writes every thread's spans to @p path as Chrome trace JSON.
+ *        Throws std::runtime_error when the file cannot be written.
+ */
+void stop(const std::string& path);
+
+/** @brief Spans currently held across every thread's ring. */
+[[nodiscard]] std::size_t recorded_spans();
+
+/** @brief Records the time from its construction to its destruction as a span named @p name. */
+class Span {
+   public:
+    explicit Span(const char* name) : name_(enabled() ? name : nullptr) {
+        if (name_ != nullptr) {
+            begin_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~Span() {
+        if (name_ != nullptr) {
+            detail::record(name_, begin_, std::chrono::steady_clock::now());
+        }
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+   private:
+    const char* name_;
+    std::chrono::steady_clock::time_point begin_{};
+};
+
+}  // namespace chiron::trace
@@ -0,0 +1,340 @@
+#include "tt.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <xmmintrin.h>
+#endif
+
+namespace chiron {
+
+namespace {
+
+constexpr int kAgeBits = 6;
+constexpr std::uint8_t kAgeMask = (1U << kAgeBits) - 1U;
+
+// Packed data word layout (the remaining 16 bits of the 10-byte slot hold the check):
+//   [0, 16)  packed move   [16, 32) score   [32, 48) static eval
+//   [48, 56) depth + 1     [56, 58) flag    [58, 64) age
+std::uint64_t pack(int depth, int score, int eval, PackedMove move, std::uint8_t flag, std::uint8_t age) {
+    std::uint64_t data = move.value;
+    data |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(static_cast<int16_t>(score))) << 16;
+    data |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(static_cast<int16_t>(eval))) << 32;
+    data |= static_cast<std::uint64_t>(std::clamp(depth, -1, 254) + 1) << 48;
+    data |= static_cast<std::uint64_t>(flag & 0x3U) << 56;
+    data |= static_cast<std::uint64_t>(age & kAgeMask) << 58;
+    return data;
+}
+
+std::uint8_t flag_of(std::uint64_t data) { return static_cast<std::uint8_t>((data >> 56) & 0x3U); }
+
+int depth_of(std::uint64_t data) { return static_cast<int>((data >> 48) & 0xFFU) - 1; }
+
+std::uint8_t age_of(std::uint64_t data) { return static_cast<std::uint8_t>((data >> 58) & kAgeMask); }
+
+PackedMove move_of(std::uint64_t data) { return PackedMove{static_cast<std::uint16_t>(data & 0xFFFFU)}; }
+
+int eval_of(std::uint64_t data) { return static_cast<int16_t>(static_cast<std::uint16_t>((data >> 32) & 0xFFFFU)); }
+
+std::uint16_t check_of(std::uint64_t key, std::uint64_t data) {
+    std::uint64_t folded = data ^ (data >> 16) ^ (data >> 32) ^ (data >> 48);
+    return static_cast<std::uint16_t>((key ^ folded) & 0xFFFFU);
+}
+
+bool slot_matches(std::uint64_t key, std::uint64_t data, std::uint16_t check) {
+    return flag_of(data) != static_cast<std::uint8_t>(TTFlag::Empty) && check_of(key, data) == check;
+}
+
+void unpack(std::uint64_t key, std::uint64_t data, TTEntry& entry) {
+    entry.key = key;
+    entry.score = static_cast<int16_t>(static_cast<std::uint16_t>((data >> 16) & 0xFFFFU));
+    entry.eval = static_cast<int16_t>(eval_of(data));
+    entry.depth = static_cast<int16_t>(depth_of(data));
+    entry.flag = flag_of(data);
+    entry.age = age_of(data);
+    entry.move = move_of(data);
+}
+
+int age_distance(std::uint8_t generation, std::uint64_t data) {
+    return static_cast<int>((generation - age_of(data)) & kAgeMask);
+}
+
+#if defined(__SIZEOF_INT128__)
+__extension__ using uint128 = unsigned __int128;
+#endif
+
+std::size_t scale_index(std::uint64_t key, std::size_t count) {
+#if defined(__SIZEOF_INT128__)
+    return static_cast<std::size_t>((static_cast<uint128>(key) * count) >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<std::size_t>(__umulh(key, count));
+#else
+    return static_cast<std::size_t>(key % count);
+#endif
+}
+
+constexpr std::array<char, 8> kFileMagic = {'C', 'H', 'I', 'R', 'O', 'N', 'T', 'T'};
+constexpr std::uint32_t kFileVersion = 1;
+constexpr std::uint32_t kByteOrderMark = 0x01020304U;  // Reads back differently on the other endianness.
+constexpr std::size_t kFileChunkBuckets = 16384;       // One megabyte of buckets per read or write.
+
+/** @brief Header of a saved table; the buckets follow it, so they stay 64-byte aligned. */
+struct alignas(64) FileHeader {
+    std::array<char, 8> magic = kFileMagic;
+    std::uint32_t version = kFileVersion;
+    std::uint32_t byte_order = kByteOrderMark;
+    std::uint32_t bucket_bytes = 0;
+    std::uint32_t slots_per_bucket = 0;
+    std::uint64_t bucket_count = 0;
+    std::uint64_t salt = 0;
+    std::uint8_t generation = 0;
+};
+
+static_assert(sizeof(FileHeader) == 64, "The saved table header must keep the buckets cache-line aligned");
+
+/** @brief Plain copy of a bucket as saved: the same layout without the atomics. */
+struct alignas(64) SavedBucket {
+    std::uint64_t data[TranspositionTable::kBucketSize];
+    std::uint16_t check[TranspositionTable::kBucketSize];
+};
+
+// Below this much memory per thread, starting threads costs more than zeroing.
+constexpr std::size_t kClearBytesPerThread = 32ULL * 1024ULL * 1024ULL;
+
+}  // namespace
+
+TranspositionTable::TranspositionTable(std::size_t entries) { resize(entries); }
+
+void TranspositionTable::resize(std::size_t entries) {
+    std::size_t buckets = std::max<std::size_t>(1, (entries + kBucketSize - 1) / kBucketSize);
+    if (buckets != bucket_count_ || buckets_ == nullptr) {
+        buckets_ = nullptr;
+        memory_ = LargePageBuffer();  // Release the old table first so the peak is one table.
+        memory_ = LargePageBuffer(buckets * sizeof(Bucket));
+        buckets_ = static_cast<Bucket*>(memory_.data());
+        bucket_count_ = buckets;
+    }
+    clear();
+}
+
+void TranspositionTable::resize_mb(std::size_t megabytes) {
+    std::size_t bytes = megabytes * 1024ULL * 1024ULL;
+    resize(bytes / sizeof(Bucket) * kBucketSize);
+}
+
+void TranspositionTable::clear() {
+    auto zero = [this](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            new (&buckets_[i]) Bucket();  // Value-initialised: every slot empty.
+        }
+    };
+    std::size_t threads = std::clamp<std::size_t>(bucket_count_ * sizeof(Bucket) / kClearBytesPerThread, 1,
+                                                  std::max(1U, std::thread::hardware_concurrency()));
+    if (threads == 1) {
+        zero(0, bucket_count_);
+    } else {
+        // Each thread touches its slice first, so pages that are not interleaved by the OS
+        // still end up spread over the nodes.
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (std::size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                bind_thread_to_numa_node(static_cast<int>(t));
+                zero(bucket_count_ * t / threads, bucket_count_ * (t + 1) / threads);
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+    generation_ = 0;
+}
+
+void TranspositionTable::new_search() { generation_ = static_cast<std::uint8_t>((generation_ + 1) & kAgeMask); }
+
+void TranspositionTable::new_game() {
+    // Splitmix64 step, so successive salts are unrelated to each other and to Zobrist keys.
+    std::uint64_t z = (salt_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    salt_ = z ^ (z >> 31);
+    generation_ = static_cast<std::uint8_t>((generation_ + (kAgeMask + 1U) / 2U) & kAgeMask);
+}
+
+void TranspositionTable::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Unable to write transposition table file: " + path);
+    }
+    FileHeader header;
+    header.bucket_bytes = sizeof(Bucket);
+    header.slots_per_bucket = kBucketSize;
+    header.bucket_count = bucket_count_;
+    header.salt = salt_;
+    header.generation = generation_;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Slots are copied out one relaxed load at a time, so searches may keep writing meanwhile.
+    static_assert(sizeof(SavedBucket) == sizeof(Bucket), "Saved buckets mirror the in-memory layout");
+    std::vector<SavedBucket> chunk(std::min(kFileChunkBuckets, bucket_count_));
+    for (std::size_t begin = 0; begin < bucket_count_; begin += chunk.size()) {
+        std::size_t count = std::min(chunk.size(), bucket_count_ - begin);
+        for (std::size_t i = 0; i < count; ++i) {
+            SavedBucket& saved = chunk[i];
+            std::memset(&saved, 0, sizeof(saved));  // Padding included, so equal tables give equal files.
+            for (std::size_t slot = 0; slot < kBucketSize; ++slot) {
+                saved.data[slot] = buckets_[begin + i].data[slot].load(std::memory_order_relaxed);
+                saved.check[slot] = buckets_[begin + i].check[slot].load(std::memory_order_relaxed);
+            }
+        }
+        out.write(reinterpret_cast<const char*>(chunk.data()),
+                  static_cast<std::streamsize>(count * sizeof(SavedBucket)));
+    }
+    if (!out) {
+        throw std::runtime_error("Failed while writing transposition table file: " + path);
+    }
+}
+
+void TranspositionTable::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Unable to open transposition table file: " + path);
+    }
+    FileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || header.magic != kFileMagic) {
+        throw std::runtime_error("Not a transposition table file: " + path);
+    }
+    if (header.version != kFileVersion || header.byte_order != kByteOrderMark ||
+        header.bucket_bytes != sizeof(Bucket) || header.slots_per_bucket != kBucketSize || header.bucket_count == 0) {
+        throw std::runtime_error("Incompatible transposition table file: " + path);
+    }
+    std::error_code error;
+    std::uintmax_t bytes = std::filesystem::file_size(path, error);
+    if (error || bytes < sizeof(FileHeader) + header.bucket_count * sizeof(Bucket)) {
+        throw std::runtime_error("Truncated transposition table file: " + path);
+    }
+
+    resize(static_cast<std::size_t>(header.bucket_count) * kBucketSize);
+    std::vector<SavedBucket> chunk(std::min(kFileChunkBuckets, bucket_count_));
+    for (std::size_t begin = 0; begin < bucket_count_; begin += chunk.size()) {
+        std::size_t count = std::min(chunk.size(), bucket_count_ - begin);
+        in.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(count * sizeof(SavedBucket)));
+        if (!in) {
+            clear();
+            throw std::runtime_error("Truncated transposition table file: " + path);
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            for (std::size_t slot = 0; slot < kBucketSize; ++slot) {
+                buckets_[begin + i].data[slot].store(chunk[i].data[slot], std::memory_order_relaxed);
+                buckets_[begin + i].check[slot].store(chunk[i].check[slot], std::memory_order_relaxed);
+            }
+        }
+    }
+    salt_ = header.salt;
+    generation_ = static_cast<std::uint8_t>(header.generation & kAgeMask);
+}
+
+TranspositionTable::Bucket& TranspositionTable::bucket_for(std::uint64_t key) const {
+    return buckets_[scale_index(key, bucket_count_)];
+}
+
+bool TranspositionTable::probe(std::uint64_t key, TTEntry& entry) const {
+    const std::uint64_t salted = key ^ salt_;
+    const Bucket& bucket = bucket_for(salted);
+    for (std::size_t slot = 0; slot < kBucketSize; ++slot) {
+        std::uint64_t data = bucket.data[slot].load(std::memory_order_relaxed);
+        std::uint16_t check = bucket.check[slot].load(std::memory_order_relaxed);
+        if (slot_matches(salted, data, check)) {
+            unpack(key, data, entry);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(std::uint64_t key, int depth, int score, PackedMove move, std::uint8_t flag,
+                               int eval) {
+    key ^= salt_;
+    Bucket& bucket = bucket_for(key);
+    std::size_t target = 0;
+    std::uint64_t target_data = 0;
+    bool same_position = false;
+    int worst_value = std::numeric_limits<int>::max();
+
+    for (std::size_t slot = 0; slot < kBucketSize; ++slot) {
+        std::uint64_t data = bucket.data[slot].load(std::memory_order_relaxed);
+        if (slot_matches(key, data, bucket.check[slot].load(std::memory_order_relaxed))) {
+            target = slot;
+            target_data = data;
+            same_position = true;
+            break;
+        }
+        // Prefer empty slots, then stale generations, then shallow entries.
+        int value = flag_of(data) == static_cast<std::uint8_t>(TTFlag::Empty)
+                        ? std::numeric_limits<int>::min()
+                        : depth_of(data) - 8 * age_distance(generation_, data);
+        if (value < worst_value) {
+            worst_value = value;
+            target = slot;
+            target_data = data;
+        }
+    }
+
+    if (same_position) {
+        if (move.is_null()) {
+            move = move_of(target_data);
+        }
+        if (eval == kNoTTEval) {
+            eval = eval_of(target_data);
+        }
+        bool keep_existing = flag != static_cast<std::uint8_t>(TTFlag::Exact) && depth + 2 < depth_of(target_data) &&
+                             age_of(target_data) == generation_;
+        if (keep_existing) {
+            return;
+        }
+    }
+
+    std::uint64_t data = pack(depth, score, eval, move, flag, generation_);
+    bucket.data[target].store(data, std::memory_order_relaxed);
+    bucket.check[target].store(check_of(key, data), std::memory_order_relaxed);
+}
+
+void TranspositionTable::prefetch(std::uint64_t key) const {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(&bucket_for(key ^ salt_));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(reinterpret_cast<const char*>(&bucket_for(key ^ salt_)), _MM_HINT_T0);
+#else
+    (void)key;
+#endif
+}
+
+int TranspositionTable::hashfull() const {
+    std::size_t sampled = std::min<std::size_t>(bucket_count_, 1000 / kBucketSize);
+    if (sampled == 0) {
+        return 0;
+    }
+    std::size_t used = 0;
+    for (std::size_t i = 0; i < sampled; ++i) {
+        for (std::size_t slot = 0; slot < kBucketSize; ++slot) {
+            std::uint64_t data = buckets_[i].data[slot].load(std::memory_order_relaxed);
+            if (flag_of(data) != static_cast<std::uint8_t>(TTFlag::Empty) && age_of(data) == generation_) {
+                ++used;
+            }
+        }
+    }
+    return static_cast<int>(used * 1000 / (sampled * kBucketSize));
+}
+
+}  // namespace chiron
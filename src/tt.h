@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "allocation.h"
+#include "move.h"
+
+namespace chiron {
+
+/**
+ * @brief Bound type recorded alongside a transposition table score.
+ */
+enum class TTFlag : std::uint8_t { Empty = 0, Exact = 1, Alpha = 2, Beta = 3 };
+
+/** Static evaluation marker for entries stored without one. */
+constexpr int16_t kNoTTEval = std::numeric_limits<int16_t>::min();
+
+/**
+ * @brief Decoded view of a transposition table slot.
+ */
+struct TTEntry {
+    std::uint64_t key = 0ULL;  /**< Full Zobrist key of the stored position. */
+    int16_t depth = -1;        /**< Remaining search depth of the stored result. */
+    int16_t score = 0;         /**< Score in table form (mate scores relative to the node). */
+    int16_t eval = kNoTTEval;  /**< Static evaluation of the position, or kNoTTEval. */
+    PackedMove move{};         /**< Best or refutation move found for the position. */
+    std::uint8_t flag = 0;     /**< TTFlag describing the score bound. */
+    std::uint8_t age = 0;      /**< Search generation that wrote the entry. */
+};
+
+/**
+ * @brief Lock-free bucketed transposition table shared by all search threads.
+ *
+ * Each bucket occupies a single cache line and holds six 10-byte slots: a 64-bit data word
+ * (packed move, score, static eval, depth, bound and age) plus a 16-bit check equal to the low key bits
+ * XOR a fold of the data. A torn write from a concurrent thread is therefore rejected on
+ * probe as a key mismatch instead of requiring a lock.
+ */
+class TranspositionTable {
+   public:
+    static constexpr std::size_t kBucketSize = 6;
+
+    explicit TranspositionTable(std::size_t entries = 1ULL << 20);
+
+    /**
+     * @brief Resizes the table to hold at least the requested number of entries.
+     */
+    void resize(std::size_t entries);
+
+    /**
+     * @brief Resizes the table to approximately the specified size in megabytes.
+     */
+    void resize_mb(std::size_t megabytes);
+
+    /**
+     * @brief Zeroes every slot and resets the search generation; large tables are zeroed by
+     *        several threads at once, spread over the NUMA nodes.
+     */
+    void clear();
+
+    /**
+     * @brief Advances the generation counter; call once at the start of every search.
+     */
+    void new_search();
+
+    /**
+     * @brief Invalidates every entry in constant time for an unrelated game.
+     *
+     * Keys are mixed with a per-game salt, so earlier entries stop matching (short of the
+     * usual check-field collisions), and the generation jumps half an age cycle so they are
+     * the first slots replaced. Far cheaper than clear() on a large table.
+     */
+    void new_game();
+
+    /**
+     * @brief Writes every bucket, the generation and the key salt to @p path.
+     *
+     * The file is a 64-byte header followed by the buckets exactly as they lie in memory, in
+     * native byte order, so it can also be mapped directly. Throws std::runtime_error when the
+     * file cannot be written.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Replaces the table with one written by save().
+     *
+     * Slots are placed by their key, which the table does not keep, so the table takes the
+     * saved size rather than rehashing. Throws std::runtime_error when the file is missing,
+     * truncated or from an incompatible build. Those are detected from the header and file size
+     * before the table is touched; a read that still fails partway leaves it empty at the saved size.
+     */
+    void load(const std::string& path);
+
+    /**
+     * @brief Looks up the entry for a key.
+     * @return True and fills @p entry when a verified slot is found.
+     */
+    bool probe(std::uint64_t key, TTEntry& entry) const;
+
+    /**
+     * @brief Stores a search result using the depth/age-aware bucket replacement policy.
+     *
+     * A null @p move or an @p eval of kNoTTEval keeps what an existing entry for the same
+     * position already recorded.
+     */
+    void store(std::uint64_t key, int depth, int score, PackedMove move, std::uint8_t flag, int eval = kNoTTEval);
+
+    /**
+     * @brief Hints the CPU to fetch the bucket for @p key into cache.
+     */
+    void prefetch(std::uint64_t key) const;
+
+    /**
+     * @brief Estimates table occupancy by the current generation in permille.
+     */
+    [[nodiscard]] int hashfull() const;
+
+    [[nodiscard]] std::size_t entry_count() const { return bucket_count_ * kBucketSize; }
+    [[nodiscard]] std::uint8_t generation() const { return generation_; }
+    /** @brief True when the table lives in explicit large pages (see LargePageBuffer). */
+    [[nodiscard]] bool large_pages() const { return memory_.large_pages(); }
+
+   private:
+    struct alignas(64) Bucket {
+        std::atomic<std::uint64_t> data[kBucketSize];
+        std::atomic<std::uint16_t> check[kBucketSize];
+    };
+
+    static_assert(sizeof(Bucket) == 64, "Transposition table buckets must fill exactly one cache line");
+    static_assert(std::is_trivially_destructible_v<Bucket>, "Buckets are released without destructor calls");
+
+    [[nodiscard]] Bucket& bucket_for(std::uint64_t key) const;
+
+    LargePageBuffer memory_;
+    Bucket* buckets_ = nullptr;  // Constructed in memory_ by clear().
+    std::size_t bucket_count_ = 0;
+    std::uint8_t generation_ = 0;
+    std::uint64_t salt_ = 0;
+};
+
+}  // namespace chiron
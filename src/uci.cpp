@@ -2,10 +2,15 @@
 
 #include <algorithm>
 #include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "evaluation.h"
@@ -26,6 +31,20 @@ std::vector<std::string> tokenize(const std::string& line) {
     return tokens;
 }
 
+/**
+ * @brief Prints the eval cache hit rate as an info string; kept out of the info lines themselves
+ *        so GUIs only see standard tokens there.
+ */
+void report_eval_cache(const SearchResult& result) {
+    if (result.eval_probes == 0) {
+        return;
+    }
+    std::uint64_t permille = result.eval_hits * 1000ULL / result.eval_probes;
+    std::cout << "info string evalcache hits " << static_cast<unsigned long long>(result.eval_hits) << " of "
+              << static_cast<unsigned long long>(result.eval_probes) << " (" << permille / 10 << '.' << permille % 10
+              << "%)" << std::endl;
+}
+
 }  // namespace
 
 UCI::UCI() : board_(), search_(1 << 20) {
@@ -55,14 +74,26 @@ void UCI::loop() {
             std::cout << "option name Maximum Think Time type spin default " << time_config_.max_time_ms
                       << " min 10 max 120000" << std::endl;
             std::cout << "option name EvalNetwork type string default " << std::endl;
+            std::cout << "option name PawnStructureWeight type spin default 0 min 0 max 200" << std::endl;
+            std::cout << "option name ContinuationHistory type check default false" << std::endl;
+            std::cout << "option name MultiPV type spin default 1 min 1 max 256" << std::endl;
             std::cout << "option name Ponder type check default false" << std::endl;
+            std::cout << "option name SyzygyPath type string default <empty>" << std::endl;
+            std::cout << "option name HashFile type string default <empty>" << std::endl;
+            std::cout << "option name Save Hash to File type button" << std::endl;
+            std::cout << "option name Load Hash from File type button" << std::endl;
+            std::cout << "option name AnalysisCache type string default <empty>" << std::endl;
+            std::cout << "option name OwnBook type check default false" << std::endl;
+            std::cout << "option name BookFile type string default <empty>" << std::endl;
             std::cout << "uciok" << std::endl;
         } else if (line == "isready") {
             std::cout << "readyok" << std::endl;
         } else if (line == "ucinewgame") {
             stop_search(true);
             board_.set_start_position();
+            game_history_.clear();
             search_.clear();
+            reload_hash_file();  // GUIs send this before every game, so keep the table from disk.
         } else if (line.rfind("setoption", 0) == 0) {
             handle_setoption(line);
         } else if (line.rfind("position", 0) == 0) {
@@ -70,10 +101,19 @@ void UCI::loop() {
             handle_position(line);
         } else if (line.rfind("go", 0) == 0) {
             handle_go(line);
+        } else if (line == "ponderhit") {
+            search_.ponderhit();  // The ponder search carries on as the real one.
         } else if (line == "stop") {
             stop_search(true);
+        } else if (line.rfind("savehash", 0) == 0 || line.rfind("loadhash", 0) == 0) {
+            handle_hash_file(line);
         } else if (line == "quit") {
             stop_search(true);
+            if (save_hash_on_quit_) {
+                handle_hash_file("savehash");
+            } else {
+                save_analysis_cache();
+            }
             break;
         }
     }
@@ -85,6 +125,7 @@ void UCI::handle_position(const std::string& command) {
         return;
     }
 
+    game_history_.clear();
     std::size_t index = 1;
     if (tokens[index] == "startpos") {
         board_.set_start_position();
@@ -109,6 +150,7 @@ void UCI::handle_position(const std::string& command) {
         while (index < tokens.size()) {
             Move move = parse_move(tokens[index]);
             Board::State state;
+            game_history_.push_back(board_.zobrist_key());
             board_.make_move(move, state);
             ++index;
         }
@@ -118,6 +160,7 @@ void UCI::handle_position(const std::string& command) {
 void UCI::handle_go(const std::string& command) {
     SearchLimits limits;
     limits.max_depth = 64;
+    limits.multi_pv = multi_pv_;
     auto tokens = tokenize(command);
     for (std::size_t i = 1; i < tokens.size(); ++i) {
         const std::string& token = tokens[i];
@@ -166,6 +209,19 @@ void UCI::handle_go(const std::string& command) {
         limits.max_depth = 64;
     }
 
+    // Analysis and ponder searches are asked for a search, not a move, so they skip the book.
+    if (own_book_ && book_ && !limits.infinite && !limits.ponder) {
+        std::uniform_real_distribution<double> fraction(0.0, 1.0);
+        if (std::optional<Move> move = book_->pick(board_, fraction(book_rng_))) {
+            stop_search(true);
+            current_limits_ = limits;
+            SearchResult result;
+            result.best_move = *move;
+            report_bestmove(result);
+            return;
+        }
+    }
+
     start_search(limits);
 }
 
@@ -194,6 +250,7 @@ void UCI::handle_setoption(const std::string& command) {
         if (name == "Hash") {
             int mb = std::max(1, std::stoi(value));
             search_.set_table_size_mb(static_cast<std::size_t>(mb));
+            reload_hash_file();
         } else if (name == "Threads") {
             int threads = std::max(1, std::stoi(value));
             search_.set_threads(threads);
@@ -220,6 +277,50 @@ void UCI::handle_setoption(const std::string& command) {
                 std::lock_guard<std::mutex> lock(io_mutex_);
                 std::cout << "info string nnue network set to " << value << std::endl;
             }
+        } else if (name == "PawnStructureWeight") {
+            search_.set_pawn_structure_weight(std::clamp(std::stoi(value), 0, 200));
+        } else if (name == "ContinuationHistory") {
+            search_.set_continuation_history(value == "true");
+        } else if (name == "SyzygyPath") {
+            stop_search(true);  // Searches hold the old tables only through search_.
+            if (value.empty() || value == "<empty>") {
+                search_.set_tablebases(nullptr);
+            } else {
+                auto tablebases = std::make_shared<const SyzygyTablebases>(value);
+                std::lock_guard<std::mutex> lock(io_mutex_);
+                std::cout << "info string syzygy found " << tablebases->wdl_table_count() << " WDL and "
+                          << tablebases->dtz_table_count() << " DTZ tables, up to " << tablebases->max_pieces()
+                          << " pieces" << std::endl;
+                search_.set_tablebases(tablebases->max_pieces() > 0 ? std::move(tablebases) : nullptr);
+            }
+        } else if (name == "HashFile") {
+            hash_file_ = value == "<empty>" ? std::string() : value;
+        } else if (name == "Save Hash to File") {
+            handle_hash_file("savehash");
+        } else if (name == "Load Hash from File") {
+            handle_hash_file("loadhash");
+        } else if (name == "AnalysisCache") {
+            stop_search(true);
+            if (value.empty() || value == "<empty>") {
+                save_analysis_cache();
+                analysis_cache_.reset();
+                analysis_cache_file_.clear();
+                search_.set_analysis_cache(nullptr);
+            } else {
+                persist_analysis_cache(value);
+            }
+        } else if (name == "OwnBook") {
+            own_book_ = value == "true";
+        } else if (name == "BookFile") {
+            if (value.empty() || value == "<empty>") {
+                book_.reset();
+            } else {
+                book_ = std::make_shared<const OpeningBook>(value);
+                std::lock_guard<std::mutex> lock(io_mutex_);
+                std::cout << "info string book " << value << " holds " << book_->entry_count() << " moves" << std::endl;
+            }
+        } else if (name == "MultiPV") {
+            multi_pv_ = std::clamp(std::stoi(value), 1, 256);
         } else if (name == "Ponder") {
             // Ponder option acknowledged but handled implicitly.
         }
@@ -229,8 +330,84 @@ void UCI::handle_setoption(const std::string& command) {
     }
 }
 
+void UCI::persist_hash(const std::string& path) {
+    hash_file_ = path;
+    save_hash_on_quit_ = true;
+    if (std::filesystem::exists(path)) {
+        handle_hash_file("loadhash");
+    }
+}
+
+void UCI::persist_analysis_cache(const std::string& path) {
+    save_analysis_cache();  // Keeps what the previous file's cache gathered.
+    auto cache = std::make_shared<AnalysisCache>();
+    if (std::filesystem::exists(path)) {
+        cache->load(path);
+    }
+    analysis_cache_ = cache;
+    analysis_cache_file_ = path;
+    search_.set_analysis_cache(std::move(cache));
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    std::cout << "info string analysis cache " << path << " holds " << analysis_cache_->size() << " positions"
+              << std::endl;
+}
+
+bool UCI::handle_hash_file(const std::string& command) {
+    bool save = command.rfind("savehash", 0) == 0;
+    std::size_t start = command.find_first_not_of(' ', std::string_view("savehash").size());  // Both names are as long.
+    std::string path = start == std::string::npos ? hash_file_ : command.substr(start);
+    if (!save) {
+        stop_search(true);  // Saving only reads the table, so a running search carries on.
+    }
+    try {
+        if (path.empty()) {
+            throw std::invalid_argument("no file given and HashFile is not set");
+        }
+        if (save) {
+            search_.save_table(path);
+            save_analysis_cache();
+        } else {
+            search_.load_table(path);
+            loaded_hash_file_ = path;
+        }
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        std::cout << "info string hash " << (save ? "saved to " : "loaded from ") << path << std::endl;
+        return true;
+    } catch (const std::exception& ex) {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        std::cout << "info string Failed to " << (save ? "save" : "load") << " hash: " << ex.what() << std::endl;
+        return false;
+    }
+}
+
+void UCI::reload_hash_file() {
+    if (loaded_hash_file_.empty()) {
+        return;
+    }
+    std::string path = loaded_hash_file_;
+    if (!handle_hash_file("loadhash " + path)) {
+        loaded_hash_file_.clear();
+        if (path == hash_file_) {
+            save_hash_on_quit_ = false;  // Never replace the saved table with the cleared one.
+        }
+    }
+}
+
+void UCI::save_analysis_cache() {
+    if (!analysis_cache_ || analysis_cache_file_.empty()) {
+        return;
+    }
+    try {
+        analysis_cache_->save(analysis_cache_file_);
+    } catch (const std::exception& ex) {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        std::cout << "info string Failed to save analysis cache: " << ex.what() << std::endl;
+    }
+}
+
 Move UCI::parse_move(const std::string& token) {
-    std::vector<Move> moves = MoveGenerator::generate_legal_moves(board_);
+    MoveList moves;
+    MoveGenerator::generate_legal_moves(board_, moves);
     for (const Move& move : moves) {
         if (move_to_string(move) == token) {
             return move;
@@ -255,6 +432,9 @@ void UCI::start_search(SearchLimits limits) {
     stop_flag_.store(false);
     have_result_ = false;
     search_.set_time_manager(time_config_);
+    search_.set_game_history(game_history_);
+    // Armed here rather than on the search thread, so a ponderhit right behind "go ponder" counts.
+    search_.prepare_clock(limits.ponder);
 
     Board board_copy = board_;
     searching_.store(true);
@@ -288,44 +468,61 @@ void UCI::join_thread() {
 
 void UCI::send_info(const SearchResult& result) {
     std::lock_guard<std::mutex> lock(io_mutex_);
-    std::cout << "info depth " << result.depth;
-    if (result.seldepth > 0) {
-        std::cout << " seldepth " << result.seldepth;
-    }
+    // A MultiPV search reports every line, best first, each with the shared statistics.
+    const bool multi_pv = result.lines.size() > 1;
+    const std::size_t line_count = multi_pv ? result.lines.size() : 1;
+    for (std::size_t index = 0; index < line_count; ++index) {
+        const int score = multi_pv ? result.lines[index].score : result.score;
+        const std::vector<Move>& pv = multi_pv ? result.lines[index].pv : result.pv;
+        std::cout << "info depth " << result.depth;
+        if (result.seldepth > 0) {
+            std::cout << " seldepth " << result.seldepth;
+        }
+        if (multi_pv) {
+            std::cout << " multipv " << index + 1;
+        }
 
-    if (std::abs(result.score) >= kMateThreshold) {
-        int mate_moves = (kMateValue - std::abs(result.score) + 1) / 2;
-        if (result.score < 0) {
-            mate_moves = -mate_moves;
+        if (std::abs(score) >= kMateThreshold) {
+            int mate_moves = (kMateValue - std::abs(score) + 1) / 2;
+            if (score < 0) {
+                mate_moves = -mate_moves;
+            }
+            std::cout << " score mate " << mate_moves;
+        } else {
+            std::cout << " score cp " << score;
         }
-        std::cout << " score mate " << mate_moves;
-    } else {
-        std::cout << " score cp " << result.score;
-    }
 
-    auto elapsed_ms = static_cast<int>(result.elapsed.count());
-    if (elapsed_ms < 0) {
-        elapsed_ms = 0;
-    }
-    std::cout << " time " << elapsed_ms;
-    std::cout << " nodes " << static_cast<unsigned long long>(result.nodes);
-    if (elapsed_ms > 0) {
-        std::uint64_t nps = result.nodes * 1000ULL / static_cast<std::uint64_t>(elapsed_ms);
-        std::cout << " nps " << static_cast<unsigned long long>(nps);
-    }
+        auto elapsed_ms = static_cast<int>(result.elapsed.count());
+        if (elapsed_ms < 0) {
+            elapsed_ms = 0;
+        }
+        std::cout << " time " << elapsed_ms;
+        std::cout << " nodes " << static_cast<unsigned long long>(result.nodes);
+        if (elapsed_ms > 0) {
+            std::uint64_t nps = result.nodes * 1000ULL / static_cast<std::uint64_t>(elapsed_ms);
+            std::cout << " nps " << static_cast<unsigned long long>(nps);
+        }
+        std::cout << " hashfull " << result.hashfull;
+        if (result.tb_hits > 0) {
+            std::cout << " tbhits " << static_cast<unsigned long long>(result.tb_hits);
+        }
 
-    if (!result.pv.empty()) {
-        std::cout << " pv";
-        for (const Move& move : result.pv) {
-            std::cout << ' ' << move_to_string(move);
+        if (!pv.empty()) {
+            std::cout << " pv";
+            for (const Move& move : pv) {
+                std::cout << ' ' << move_to_string(move);
+            }
         }
-    }
 
-    std::cout << std::endl;
+        std::cout << std::endl;
+    }
+    report_eval_cache(result);
 }
 
 void UCI::report_bestmove(const SearchResult& result) {
     std::lock_guard<std::mutex> lock(io_mutex_);
+    report_eval_cache(result);
+
     Move best = result.best_move;
     if (best.from == best.to && best.from == 0) {
         std::cout << "bestmove 0000" << std::endl;
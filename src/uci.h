@@ -1,11 +1,16 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
+#include <memory>
 #include <mutex>
+#include <random>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "board.h"
+#include "book.h"
 #include "search.h"
 
 namespace chiron {
@@ -19,10 +24,33 @@ class UCI {
     ~UCI();
     void loop();
 
+    /**
+     * @brief Loads the transposition table from @p path when the file exists and saves it back
+     *        there when the engine quits, so analysis resumes from a warm table.
+     *
+     * `ucinewgame` and a new Hash size clear the table and then load the file again, so the
+     * table keeps the size it was saved with.
+     */
+    void persist_hash(const std::string& path);
+
+    /**
+     * @brief Enables the analysis cache backed by @p path: loaded now when the file exists and
+     *        saved on quit and with every `savehash`.
+     */
+    void persist_analysis_cache(const std::string& path);
+
    private:
    void handle_position(const std::string& command);
    void handle_go(const std::string& command);
     void handle_setoption(const std::string& command);
+    /** @brief `savehash [file]` and `loadhash [file]`; the file defaults to the HashFile option. */
+    bool handle_hash_file(const std::string& command);
+    /**
+     * @brief Loads the last loaded hash file again after the table was cleared; if that fails,
+     *        quitting no longer saves over it.
+     */
+    void reload_hash_file();
+    void save_analysis_cache();
     Move parse_move(const std::string& token);
     void start_search(SearchLimits limits);
     void stop_search(bool wait_for_join);
@@ -31,6 +59,7 @@ class UCI {
     void join_thread();
 
     Board board_;
+    std::vector<std::uint64_t> game_history_;  // Keys of the positions before board_, oldest first.
     Search search_;
     TimeHeuristicConfig time_config_{};
     std::atomic<bool> stop_flag_{false};
@@ -42,6 +71,15 @@ class UCI {
     SearchResult last_result_{};
     bool have_result_ = false;
     int move_overhead_ms_ = 30;
+    int multi_pv_ = 1;
+    std::string hash_file_;
+    bool save_hash_on_quit_ = false;
+    std::string loaded_hash_file_;  // The file the table was last loaded from, restored after a clear.
+    std::shared_ptr<AnalysisCache> analysis_cache_;
+    std::string analysis_cache_file_;
+    bool own_book_ = false;
+    std::shared_ptr<const OpeningBook> book_;  // Played from when own_book_ is set.
+    std::mt19937_64 book_rng_{std::random_device{}()};
 };
 
 }  // namespace chiron
@@ -2,6 +2,8 @@
 
 #include "board.h"
 #include "eval/evaluation.h"
+#include "eval/pawn_structure.h"
+#include "movegen.h"
 
 TEST(EvaluationPipelineTest, StartPositionIsBalanced) {
     chiron::Board board;
@@ -20,3 +22,49 @@ TEST(EvaluationPipelineTest, MaterialAdvantageReflectsScore) {
     int eval_black = chiron::evaluate(board);
     EXPECT_LT(eval_black, -400);
 }
+
+TEST(PawnStructure, FindsPassedIsolatedAndDoubledPawns) {
+    chiron::Board board;
+    // White: a2 isolated and passed, c3 doubled behind the passed c4, d4 passed, e5 held by f7.
+    // Black: g6 and h7 are passed; f7 is stopped by e5.
+    board.set_from_fen("4k3/5p1p/6p1/4P3/2PP4/2P5/P7/4K3 w - - 0 1");
+    chiron::PawnEntry entry = chiron::analyze_pawns(board);
+    auto bb = [](std::initializer_list<int> squares) {
+        chiron::Bitboard result = 0ULL;
+        for (int square : squares) {
+            result |= chiron::square_bb(static_cast<chiron::Square>(square));
+        }
+        return result;
+    };
+    EXPECT_EQ(entry.isolated[0], bb({8}));
+    EXPECT_EQ(entry.doubled[0], bb({18}));
+    EXPECT_EQ(entry.passed[0], bb({8, 26, 27}));
+    EXPECT_EQ(entry.isolated[1], 0ULL);
+    EXPECT_EQ(entry.doubled[1], 0ULL);
+    EXPECT_EQ(entry.passed[1], bb({46, 55}));
+    // White: 5 + 20 + 20 for passers, -12 isolated, -10 doubled; black: 10 + 5 for passers.
+    EXPECT_EQ(entry.score, 8);
+}
+
+TEST(PawnStructure, PawnKeyIsIncrementalAndDrivesTheHashTable) {
+    chiron::Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    chiron::PawnHashTable table;
+    for (const chiron::Move& move : chiron::MoveGenerator::generate_legal_moves(board)) {
+        std::uint64_t before = board.pawn_key();
+        bool pawn_move = board.piece_type_at(move.from) == chiron::PieceType::Pawn;
+        chiron::Board::State state;
+        board.make_move(move, state);
+
+        chiron::Board rebuilt;
+        rebuilt.set_from_fen(board.fen());
+        EXPECT_EQ(board.pawn_key(), rebuilt.pawn_key()) << board.fen();
+        bool pawns_changed = pawn_move || state.captured_piece == chiron::PieceType::Pawn;
+        EXPECT_EQ(board.pawn_key() != before, pawns_changed) << board.fen();
+        int cached = table.probe(board).score;
+        EXPECT_EQ(cached, chiron::analyze_pawns(board).score);
+
+        board.undo_move(move, state);
+        EXPECT_EQ(board.pawn_key(), before);
+    }
+}
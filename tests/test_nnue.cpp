@@ -1,7 +1,18 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "board.h"
 #include "evaluation.h"
+#include "movegen.h"
+#include "nnue/evaluator.h"
+#include "nnue/quantized.h"
+#include "nnue/simd.h"
 
 namespace chiron {
 
@@ -20,5 +31,305 @@ TEST(NnueEvaluation, MaterialAdvantageReflectsScore) {
     EXPECT_LT(evaluate(board), 0);
 }
 
-}  // namespace chiron
+TEST(NnueSimd, FastTanhTracksStdTanh) {
+    for (int i = -8000; i <= 8000; ++i) {
+        float x = static_cast<float>(i) / 1000.0F;
+        EXPECT_NEAR(nnue::simd::fast_tanh(x), std::tanh(x), 2e-4F) << "x = " << x;
+    }
+}
+
+TEST(NnueSimd, VectorKernelsMatchScalarReference) {
+    // 37 neurons exercises both the vector body and the scalar tail of every kernel.
+    nnue::Network network;
+    network.set_hidden_size(37);
+    for (std::size_t feature = 0; feature < nnue::kFeatureCount; ++feature) {
+        for (std::size_t neuron = 0; neuron < network.hidden_size(); ++neuron) {
+            network.set_input_weight(feature, neuron, static_cast<int32_t>((feature * 31 + neuron * 17) % 401) - 200);
+        }
+    }
+    for (std::size_t neuron = 0; neuron < network.hidden_size(); ++neuron) {
+        network.set_hidden_bias(neuron, static_cast<int32_t>(neuron * 13 % 97) - 48);
+        network.set_output_weight(neuron, 0.05F * static_cast<float>(static_cast<int>(neuron % 7) - 3));
+    }
+    network.set_bias(7);
+
+    auto path = std::filesystem::temp_directory_path() / "chiron_simd_test.nnue";
+    network.save_to_file(path.string());
+    nnue::Network reloaded;
+    reloaded.load_from_file(path.string());
+    auto evaluator = std::make_shared<nnue::Evaluator>();
+    evaluator->set_network_path(path.string());
+    evaluator->ensure_network_loaded();
+    std::filesystem::remove(path);
+
+    EXPECT_EQ(reloaded.input_weights_data(), network.input_weights_data());
+
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    std::vector<int32_t> white(network.hidden_size(), 0);
+    std::vector<int32_t> black(network.hidden_size(), 0);
+    for (int sq = 0; sq < kBoardSize; ++sq) {
+        PieceType piece = board.piece_type_at(sq);
+        if (piece == PieceType::None) {
+            continue;
+        }
+        Color color = *board.color_at(sq);
+        for (std::size_t neuron = 0; neuron < network.hidden_size(); ++neuron) {
+            (color == Color::White ? white : black)[neuron] += network.input_weight(color, piece, sq, neuron);
+        }
+    }
+    double raw = network.bias();
+    for (std::size_t neuron = 0; neuron < network.hidden_size(); ++neuron) {
+        double pre = white[neuron] - black[neuron] + network.hidden_bias(neuron);
+        raw += std::tanh(pre / nnue::kActivationScale) * nnue::kActivationScale * network.output_weight(neuron);
+    }
+
+    nnue::Accumulator accumulator;
+    evaluator->build_accumulator(board, accumulator);
+    ASSERT_EQ(accumulator.size(), network.hidden_size());
+    EXPECT_TRUE(std::equal(white.begin(), white.end(), accumulator.white.begin()));
+    EXPECT_TRUE(std::equal(black.begin(), black.end(), accumulator.black.begin()));
+    EXPECT_NEAR(evaluator->evaluate(board, accumulator), raw, 1.0);
+}
+
+TEST(NnueQuantized, MatchesClippedFloatNetwork) {
+    nnue::Network network;
+    network.set_hidden_size(24);
+    for (std::size_t feature = 0; feature < nnue::kFeatureCount; ++feature) {
+        for (std::size_t neuron = 0; neuron < network.hidden_size(); ++neuron) {
+            network.set_input_weight(feature, neuron, static_cast<int32_t>((feature * 7 + neuron * 29) % 301) - 150);
+        }
+    }
+    for (std::size_t neuron = 0; neuron < network.hidden_size(); ++neuron) {
+        network.set_hidden_bias(neuron, static_cast<int32_t>(neuron * 11 % 61) - 30);
+        network.set_output_weight(neuron, 0.1F * static_cast<float>(static_cast<int>(neuron % 5) - 2));
+    }
+    network.set_bias(-3);
+
+    auto path = std::filesystem::temp_directory_path() / "chiron_quantized_test.nnq";
+    nnue::QuantizedNetwork::from_network(network).save_to_file(path.string());
+    ASSERT_TRUE(nnue::QuantizedNetwork::is_quantized_file(path.string()));
+    auto evaluator = std::make_shared<nnue::Evaluator>();
+    evaluator->set_network_path(path.string());
+    ASSERT_TRUE(evaluator->is_quantized());
+    std::filesystem::remove(path);
 
+    for (const char* fen : {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+                            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"}) {
+        Board board;
+        board.set_from_fen(fen);
+        double raw = network.bias();
+        for (std::size_t neuron = 0; neuron < network.hidden_size(); ++neuron) {
+            double pre = network.hidden_bias(neuron);
+            for (int sq = 0; sq < kBoardSize; ++sq) {
+                PieceType piece = board.piece_type_at(sq);
+                if (piece != PieceType::None) {
+                    Color color = *board.color_at(sq);
+                    double weight = network.input_weight(color, piece, sq, neuron);
+                    pre += color == Color::White ? weight : -weight;
+                }
+            }
+            raw += std::clamp(pre, -nnue::kActivationScale, nnue::kActivationScale) * network.output_weight(neuron);
+        }
+        double expected = board.side_to_move() == Color::White ? raw : -raw;
+
+        nnue::Accumulator accumulator;
+        evaluator->build_accumulator(board, accumulator);
+        // Rounding of the 127-step activation and int8 output weights bounds the error.
+        EXPECT_NEAR(evaluator->evaluate(board, accumulator), expected, 0.02 * std::abs(expected) + 8.0) << fen;
+    }
+}
+
+TEST(NnueAccumulator, IncrementalUpdateMatchesRebuild) {
+    static_assert(alignof(nnue::Accumulator) >= 64);
+    auto evaluator = global_evaluator();
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    nnue::Accumulator base;
+    evaluator->build_accumulator(board, base);
+
+    for (const Move& move : MoveGenerator::generate_legal_moves(board)) {
+        nnue::Accumulator updated;
+        evaluator->update_accumulator(board, move, base, updated);
+        Board child = board;
+        Board::State state;
+        child.make_move(move, state);
+        nnue::Accumulator rebuilt;
+        evaluator->build_accumulator(child, rebuilt);
+        ASSERT_EQ(updated.size(), rebuilt.size());
+        EXPECT_TRUE(std::equal(rebuilt.white.begin(), rebuilt.white.begin() + rebuilt.size(), updated.white.begin()));
+        EXPECT_TRUE(std::equal(rebuilt.black.begin(), rebuilt.black.begin() + rebuilt.size(), updated.black.begin()));
+    }
+}
+
+TEST(NnueAccumulator, DeferredUpdatesMatchRebuild) {
+    auto evaluator = global_evaluator();
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    std::vector<nnue::Accumulator> stack(12);
+    evaluator->build_accumulator(board, stack[0]);
+
+    // Several plies of pending deltas (with a null move in the middle) are folded in one pass.
+    std::vector<Board::State> states(stack.size());
+    for (std::size_t ply = 0; ply + 1 < stack.size(); ++ply) {
+        if (ply == 4 && !board.in_check(board.side_to_move())) {
+            evaluator->record_null_move(stack[ply + 1]);
+            board.make_null_move(states[ply]);
+            continue;
+        }
+        auto moves = MoveGenerator::generate_legal_moves(board);
+        ASSERT_FALSE(moves.empty());
+        auto capture = std::find_if(moves.begin(), moves.end(), [](const Move& m) { return m.is_capture(); });
+        Move move = capture != moves.end() ? *capture : moves[ply % moves.size()];
+        evaluator->record_move(board, move, stack[ply + 1]);
+        board.make_move(move, states[ply]);
+        if (ply == 6) {
+            evaluator->materialize(board, stack.data(), ply + 1);
+            EXPECT_TRUE(stack[ply + 1].computed);
+        }
+    }
+
+    std::size_t last = stack.size() - 1;
+    evaluator->materialize(board, stack.data(), last);
+    nnue::Accumulator rebuilt;
+    evaluator->build_accumulator(board, rebuilt);
+    ASSERT_EQ(stack[last].size(), rebuilt.size());
+    EXPECT_TRUE(std::equal(rebuilt.white.begin(), rebuilt.white.begin() + rebuilt.size(), stack[last].white.begin()));
+    EXPECT_TRUE(std::equal(rebuilt.black.begin(), rebuilt.black.begin() + rebuilt.size(), stack[last].black.begin()));
+    EXPECT_EQ(evaluator->evaluate(board, stack[last]), evaluator->evaluate(board, rebuilt));
+}
+
+namespace {
+
+std::shared_ptr<nnue::Evaluator> load_temp_network(const nnue::Network& network, const std::string& name) {
+    auto path = std::filesystem::temp_directory_path() / name;
+    network.save_to_file(path.string());
+    auto evaluator = std::make_shared<nnue::Evaluator>();
+    evaluator->set_network_path(path.string());
+    evaluator->ensure_network_loaded();
+    std::filesystem::remove(path);
+    return evaluator;
+}
+
+}  // namespace
+
+TEST(NnueHalfKp, DefaultNetworkMatchesPieceSquareDefault) {
+    nnue::Network piece_square;
+    piece_square.load_default(4);
+    nnue::Network halfkp;
+    halfkp.load_default(4, nnue::FeatureSet::HalfKP);
+    auto square_eval = load_temp_network(piece_square, "chiron_default_ps.nnue");
+    auto king_eval = load_temp_network(halfkp, "chiron_default_halfkp.nnue");
+    ASSERT_EQ(king_eval->feature_set(), nnue::FeatureSet::HalfKP);
+
+    for (const char* fen : {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+                            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                            "4k3/8/8/8/8/8/4P3/4K3 w - - 0 1"}) {
+        Board board;
+        board.set_from_fen(fen);
+        nnue::Accumulator a;
+        nnue::Accumulator b;
+        square_eval->build_accumulator(board, a);
+        king_eval->build_accumulator(board, b);
+        EXPECT_EQ(square_eval->evaluate(board, a), king_eval->evaluate(board, b)) << fen;
+    }
+}
+
+TEST(NnueHalfKp, KingMovesRefreshThroughCacheAndMatchRebuild) {
+    nnue::Network network;
+    network.load_default(19, nnue::FeatureSet::HalfKP);
+    auto& weights = network.input_weights_data();
+    for (std::size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = static_cast<int32_t>((i * 2654435761ULL) % 301) - 150;
+    }
+    auto evaluator = load_temp_network(network, "chiron_halfkp_test.nnue");
+
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    std::vector<nnue::Accumulator> stack(14);
+    std::vector<Board::State> states(stack.size());
+    nnue::RefreshTable table;
+    evaluator->build_accumulator(board, stack[0]);
+
+    // Favour king moves (castling included) so both lanes go through the refresh table, and
+    // only materialize every other ply so pending deltas and refreshes mix.
+    for (std::size_t ply = 0; ply + 1 < stack.size(); ++ply) {
+        auto moves = MoveGenerator::generate_legal_moves(board);
+        ASSERT_FALSE(moves.empty());
+        auto pick = std::find_if(moves.begin(), moves.end(),
+                                 [&](const Move& m) { return board.piece_type_at(m.from) == PieceType::King; });
+        if (pick == moves.end()) {
+            pick = std::find_if(moves.begin(), moves.end(), [](const Move& m) { return m.is_capture(); });
+        }
+        Move move = pick != moves.end() ? *pick : moves[ply % moves.size()];
+        evaluator->record_move(board, move, stack[ply + 1]);
+
+        nnue::Accumulator eager;
+        if (stack[ply].computed) {
+            evaluator->update_accumulator(board, move, stack[ply], eager);
+        }
+        board.make_move(move, states[ply]);
+        if (ply % 2 == 0) {
+            continue;
+        }
+
+        evaluator->materialize(board, stack.data(), ply + 1, &table);
+        nnue::Accumulator rebuilt;
+        evaluator->build_accumulator(board, rebuilt);
+        const nnue::Accumulator& lazy = stack[ply + 1];
+        ASSERT_EQ(lazy.size(), rebuilt.size());
+        EXPECT_TRUE(std::equal(rebuilt.white.begin(), rebuilt.white.begin() + rebuilt.size(), lazy.white.begin()))
+            << "ply " << ply;
+        EXPECT_TRUE(std::equal(rebuilt.black.begin(), rebuilt.black.begin() + rebuilt.size(), lazy.black.begin()))
+            << "ply " << ply;
+        if (eager.size() == rebuilt.size()) {
+            EXPECT_TRUE(
+                std::equal(rebuilt.white.begin(), rebuilt.white.begin() + rebuilt.size(), eager.white.begin()));
+            EXPECT_TRUE(
+                std::equal(rebuilt.black.begin(), rebuilt.black.begin() + rebuilt.size(), eager.black.begin()));
+        }
+    }
+}
+
+TEST(NnueNetworkCache, EvaluatorsShareOneMappedNetworkPerContent) {
+    nnue::Network network;
+    network.load_default(8);
+    network.set_input_weight(3, 5, 1234);
+    network.set_output_weight(2, 0.25F);
+    auto dir = std::filesystem::temp_directory_path();
+    auto first = dir / "chiron_cache_a.nnue";
+    auto second = dir / "chiron_cache_b.nnue";
+    network.save_to_file(first.string());
+    std::filesystem::copy_file(first, second, std::filesystem::copy_options::overwrite_existing);
+
+    auto white = std::make_shared<nnue::Evaluator>();
+    auto black = std::make_shared<nnue::Evaluator>();
+    white->set_network_path(first.string());
+    black->set_network_path(second.string());
+    const nnue::Network& shared = white->network();
+    EXPECT_EQ(&shared, &black->network());
+    EXPECT_TRUE(shared.is_mapped());
+    EXPECT_EQ(shared.input_weight(3, 5), 1234);
+    EXPECT_FLOAT_EQ(shared.output_weight(2), 0.25F);
+    EXPECT_TRUE(std::equal(network.input_weights_data().begin(), network.input_weights_data().end(),
+                           shared.input_weights_data().begin()));
+
+    // Writing through a copy detaches it from the mapping and leaves the shared instance intact.
+    nnue::Network copy = shared;
+    copy.set_input_weight(3, 5, -7);
+    EXPECT_FALSE(copy.is_mapped());
+    EXPECT_EQ(copy.input_weight(3, 5), -7);
+    EXPECT_EQ(shared.input_weight(3, 5), 1234);
+
+    // Different bytes behind the same path produce a distinct instance.
+    copy.save_to_file(second.string());
+    auto rewritten = std::make_shared<nnue::Evaluator>();
+    rewritten->set_network_path(second.string());
+    EXPECT_NE(&rewritten->network(), &shared);
+    EXPECT_EQ(rewritten->network().input_weight(3, 5), -7);
+
+    std::filesystem::remove(first);
+    std::filesystem::remove(second);
+}
+
+}  // namespace chiron
@@ -1,9 +1,30 @@
+#include <array>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
 #include <gtest/gtest.h>
 
+#include "attacks.h"
+#include "board_stack.h"
+#include "movegen.h"
 #include "perft.h"
 
 namespace chiron {
 
+TEST(AttackTables, SliderLookupsMatchRayWalk) {
+    init_attack_tables();
+    std::mt19937_64 rng(20240531ULL);
+    for (int sq = 0; sq < kBoardSize; ++sq) {
+        for (int sample = 0; sample < 256; ++sample) {
+            Bitboard blockers = rng() & rng();
+            EXPECT_EQ(bishop_attacks(sq, blockers), sliding_attacks_slow(PieceType::Bishop, sq, blockers));
+            EXPECT_EQ(rook_attacks(sq, blockers), sliding_attacks_slow(PieceType::Rook, sq, blockers));
+        }
+    }
+}
+
 TEST(PerftTest, StartPositionDepths) {
     Board board;
     board.set_start_position();
@@ -15,6 +36,14 @@ TEST(PerftTest, StartPositionDepths) {
     EXPECT_EQ(perft(board, 6), 119060324ULL);
 }
 
+TEST(PerftTest, HashedDivideStartPositionDepthSix) {
+    Board board;
+    board.set_start_position();
+    PerftResult result = perft_divide(board, PerftConfig{6, 2, 16});
+    EXPECT_EQ(result.nodes, 119060324ULL);
+    EXPECT_EQ(result.divide.size(), 20U);
+}
+
 TEST(PerftTest, KiwipeteDepths) {
     Board board;
     board.set_from_fen("rnbq1k1r/pppp1ppp/5n2/4p3/1bB1P3/5N2/PPPP1PPP/RNBQ1RK1 w - - 0 1");
@@ -25,5 +54,157 @@ TEST(PerftTest, KiwipeteDepths) {
     EXPECT_EQ(perft(board, 4), 951029ULL);
 }
 
-}  // namespace chiron
+TEST(PerftTest, StandardSuitePositions) {
+    struct Case {
+        const char* fen;
+        std::uint64_t counts[4];
+    };
+    // Well-known positions exercising pins, en-passant discovered checks, castling through
+    // attacked squares and promotions.
+    const Case cases[] = {
+        {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", {48, 2039, 97862, 4085603}},
+        {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", {14, 191, 2812, 43238}},
+        {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", {6, 264, 9467, 422333}},
+        {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", {44, 1486, 62379, 2103487}},
+        {"8/8/8/KPp4r/8/8/8/7k w - c6 0 2", {4, 56, 259, 4225}},
+        // Color-mirrored copies of the first and third, so both sides' generators are covered.
+        {"r3k2r/pppbbppp/2n2q1P/1P2p3/3pn3/BN2PNP1/P1PPQPB1/R3K2R b KQkq - 0 1", {48, 2039, 97862, 4085603}},
+        {"r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", {6, 264, 9467, 422333}},
+        // Rooks captured on their home squares must take the castling rights with them.
+        {"r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", {26, 1141, 27826, 1274206}},
+    };
+    for (const Case& test_case : cases) {
+        Board board;
+        board.set_from_fen(test_case.fen);
+        for (int depth = 1; depth <= 4; ++depth) {
+            EXPECT_EQ(perft(board, depth), test_case.counts[depth - 1]) << test_case.fen << " depth " << depth;
+        }
+    }
+}
+
+TEST(PerftTest, DivideMatchesPerft) {
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    PerftResult plain = perft_divide(board, PerftConfig{4, 1, 0});
+    EXPECT_EQ(plain.nodes, 4085603ULL);
+    ASSERT_EQ(plain.divide.size(), 48U);
+    for (const PerftDivideEntry& entry : plain.divide) {
+        Board::State state;
+        board.make_move(entry.move, state);
+        EXPECT_EQ(entry.nodes, perft(board, 3)) << move_to_string(entry.move);
+        board.undo_move(entry.move, state);
+    }
+
+    // A tiny table forces constant replacement, which must never change a count.
+    for (const PerftConfig& config : {PerftConfig{4, 4, 1}, PerftConfig{4, 3, 16}, PerftConfig{1, 2, 16}}) {
+        PerftResult result = perft_divide(board, config);
+        EXPECT_EQ(result.nodes, perft(board, config.depth)) << config.threads << " threads, " << config.hash_mb;
+        ASSERT_EQ(result.divide.size(), plain.divide.size());
+        for (std::size_t i = 0; i < result.divide.size(); ++i) {
+            EXPECT_EQ(pack_move(result.divide[i].move), pack_move(plain.divide[i].move));
+            if (config.depth == 4) {
+                EXPECT_EQ(result.divide[i].nodes, plain.divide[i].nodes);
+            }
+        }
+    }
+}
 
+TEST(PerftTest, CopyMakeMatchesMakeUndo) {
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    EXPECT_EQ(perft_copy_make(board, 3), 97862ULL);
+    EXPECT_EQ(perft_copy_make(board, 4), perft(board, 4));
+
+    BoardStack stack(board, 2);
+    const Board& child = stack.push(Move{4, 6, PieceType::None, MoveFlag::KingCastle});  // e1g1
+    EXPECT_EQ(child.king_square(Color::White), 6);
+    EXPECT_EQ(board.king_square(Color::White), 4);
+    stack.push_null();
+    EXPECT_EQ(stack.ply(), 2U);
+    EXPECT_THROW(stack.push_null(), std::length_error);
+    stack.pop();
+    stack.pop();
+    EXPECT_EQ(stack.top().zobrist_key(), board.zobrist_key());
+    EXPECT_EQ(stack.top().fen(), board.fen());
+}
+
+TEST(MoveValidation, AgreesWithGeneratorForEveryPackedMove) {
+    // Every 16-bit encoding is tried in each position and in each of its children, which
+    // covers castling rights, en passant, pins, checks and promotions on both sides.
+    const char* fens[] = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/8/8/KPp4r/8/8/8/7k w - c6 0 2",
+    };
+    auto check_position = [](const Board& board) {
+        MoveList legal;
+        MoveGenerator::generate_legal_moves(board, legal);
+        std::size_t accepted = 0;
+        for (std::uint32_t value = 1; value <= 0xFFFFU; ++value) {
+            PackedMove packed{static_cast<std::uint16_t>(value)};
+            Move move = unpack_move(packed);
+            if (pack_move(move) != packed) {
+                continue;  // Unused type nibbles alias a plain quiet move.
+            }
+            bool valid = board.is_pseudo_legal(move) && board.is_legal(move);
+            ASSERT_EQ(valid, legal.contains(packed)) << board.fen() << " move " << value;
+            accepted += valid ? 1 : 0;
+        }
+        EXPECT_EQ(accepted, legal.size()) << board.fen();
+    };
+
+    for (const char* fen : fens) {
+        Board board;
+        board.set_from_fen(fen);
+        check_position(board);
+        for (const Move& move : MoveGenerator::generate_legal_moves(board)) {
+            Board::State state;
+            board.make_move(move, state);
+            check_position(board);
+            board.undo_move(move, state);
+        }
+    }
+}
+
+TEST(BoardFen, WrittenFensReloadToTheSamePosition) {
+    // Random playouts reach castling-right losses, en passant squares and promotions.
+    std::mt19937 rng(11);
+    std::array<char, Board::kMaxFenLength> buffer{};
+    for (int game = 0; game < 20; ++game) {
+        Board board;
+        board.set_start_position();
+        for (int ply = 0; ply < 120; ++ply) {
+            std::size_t length = board.write_fen(buffer.data());
+            std::string_view fen(buffer.data(), length);
+            ASSERT_EQ(fen, board.fen());
+            Board reloaded;
+            reloaded.set_from_fen(fen);
+            ASSERT_EQ(reloaded.zobrist_key(), board.zobrist_key()) << fen;
+            ASSERT_EQ(reloaded.fen(), board.fen());
+
+            MoveList moves;
+            MoveGenerator::generate_legal_moves(board, moves);
+            if (moves.empty()) {
+                break;
+            }
+            Board::State state;
+            board.make_move(moves[static_cast<std::size_t>(rng()) % moves.size()], state);
+        }
+    }
+
+    Board board;
+    board.set_from_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - bm e4; id \"start\";");
+    EXPECT_EQ(board.fen(), "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    for (const char* malformed : {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1",
+                                  "rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+                                  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",
+                                  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQxq - 0 1",
+                                  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e4 0 1",
+                                  "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w"}) {
+        EXPECT_THROW(board.set_from_fen(malformed), std::runtime_error) << malformed;
+    }
+}
+
+}  // namespace chiron
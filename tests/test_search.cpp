@@ -1,10 +1,33 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "allocation.h"
+#include "analysis_cache.h"
+#include "bench.h"
 #include "board.h"
+#include "eval_cache.h"
+#include "key_history.h"
 #include "movegen.h"
+#include "movepicker.h"
 #include "search.h"
+#include "trace.h"
+#include "tt.h"
+#include "uci.h"
 
 namespace chiron {
 
@@ -34,6 +57,27 @@ TEST(SearchIntegration, ProducesLegalMoveFromStartPosition) {
     EXPECT_TRUE(contains_move(legal, result.best_move));
 }
 
+TEST(SearchIntegration, LazySmpPoolSurvivesRepeatedSearches) {
+    Board board;
+    board.set_from_fen("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+
+    Search search(1ULL << 16);
+    search.set_threads(3);
+    SearchLimits limits;
+    limits.max_depth = 4;
+
+    std::vector<Move> legal = MoveGenerator::generate_legal_moves(board);
+    for (int i = 0; i < 3; ++i) {
+        SearchResult result = search.search(board, limits);
+        EXPECT_EQ(result.depth, 4);
+        EXPECT_TRUE(contains_move(legal, result.best_move));
+    }
+
+    search.set_threads(2);
+    SearchResult result = search.search(board, limits);
+    EXPECT_TRUE(contains_move(legal, result.best_move));
+}
+
 TEST(SearchNullMove, PreservesAccumulatorState) {
     Board board;
     board.set_from_fen("8/8/8/8/8/8/PPP5/K6k w - - 0 1");
@@ -47,5 +91,686 @@ TEST(SearchNullMove, PreservesAccumulatorState) {
     EXPECT_GE(score, beta) << "Null-move pruning failed to trigger with consistent evaluation.";
 }
 
-}  // namespace chiron
+TEST(PackedMove, RoundTripsEveryGeneratedMove) {
+    Board board;
+    for (const char* fen : {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 b kq - 0 1",
+                            "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                            "8/8/8/KPp4r/8/8/8/7k w - c6 0 2"}) {
+        board.set_from_fen(fen);
+        for (const Move& move : MoveGenerator::generate_legal_moves(board)) {
+            Move round_trip = unpack_move(pack_move(move));
+            EXPECT_EQ(round_trip.from, move.from);
+            EXPECT_EQ(round_trip.to, move.to);
+            EXPECT_EQ(round_trip.flags, move.flags);
+            if (move.is_promotion()) {
+                EXPECT_EQ(round_trip.promotion, move.promotion);
+            }
+        }
+    }
+    EXPECT_TRUE(pack_move(Move{}).is_null());
+}
+
+TEST(MovePicker, YieldsEveryLegalMoveOnceWithHashMoveFirst) {
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    MoveList legal;
+    MoveGenerator::generate_legal_moves(board, legal);
+
+    PackedMove tt_move = pack_move(Move{12, 28, PieceType::None, MoveFlag::DoublePush});  // e2e4 is blocked
+    ASSERT_FALSE(MoveGenerator::is_legal(board, tt_move));
+    PackedMove quiet_hash = pack_move(Move{0, 3, PieceType::None, MoveFlag::Quiet});  // a1d1
+    ASSERT_TRUE(legal.contains(quiet_hash));
+    std::array<PackedMove, 2> killers{quiet_hash, tt_move};
+    ButterflyHistory history{};
+
+    for (PackedMove hash : {tt_move, quiet_hash}) {
+        MovePicker picker(board, hash, killers, history);
+        std::vector<PackedMove> seen;
+        Move move;
+        while (picker.next(move)) {
+            seen.push_back(pack_move(move));
+        }
+        EXPECT_EQ(seen.size(), legal.size());
+        for (std::size_t i = 0; i < legal.size(); ++i) {
+            EXPECT_EQ(std::count(seen.begin(), seen.end(), legal.packed(i)), 1);
+        }
+        // The first yielded move is the hash move when legal, otherwise the best capture.
+        EXPECT_TRUE(hash == quiet_hash ? seen.front() == quiet_hash : unpack_move(seen.front()).is_capture());
+    }
+
+    // Of the eight captures only d5e6, e2a6 and g2h3 survive SEE in quiescence.
+    MovePicker captures(board);
+    std::size_t tactical = 0;
+    for (Move move; captures.next(move);) {
+        EXPECT_TRUE(move.is_capture() || move.is_promotion());
+        EXPECT_TRUE(board.see_ge(move, 0));
+        ++tactical;
+    }
+    EXPECT_EQ(tactical, 3u);
+}
+
+TEST(StaticExchange, ResolvesRecapturesAndXRays) {
+    Board board;
+    // Rxe5 wins a clean pawn.
+    board.set_from_fen("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1");
+    Move rook_takes{4, 36, PieceType::None, MoveFlag::Capture};
+    EXPECT_TRUE(board.see_ge(rook_takes, 0));
+    EXPECT_TRUE(board.see_ge(rook_takes, 100));
+    EXPECT_FALSE(board.see_ge(rook_takes, 101));
+
+    // Nxe5 dxe5 Rxe5 nets 100 - 320 + 100.
+    board.set_from_fen("1k2r3/1p1bn2p/p2p4/4p3/8/P2N2P1/1PP1R2P/2K1R3 w - - 0 1");
+    Move knight_takes{19, 36, PieceType::None, MoveFlag::Capture};
+    EXPECT_FALSE(board.see_ge(knight_takes, 0));
+    EXPECT_TRUE(board.see_ge(knight_takes, -120));
+    EXPECT_FALSE(board.see_ge(knight_takes, -119));
+
+    // The queen behind the rook joins in once the rook has captured: Rxd5 Rxd5 Qxd5 wins the
+    // pawn and the exchange comes out even.
+    board.set_from_fen("3r2k1/8/8/3p4/8/8/3R4/3Q2K1 w - - 0 1");
+    Move rook_on_d5{11, 35, PieceType::None, MoveFlag::Capture};
+    EXPECT_TRUE(board.see_ge(rook_on_d5, 100));
+    EXPECT_FALSE(board.see_ge(rook_on_d5, 101));
+
+    // A quiet move onto a square attacked by a pawn loses the piece.
+    board.set_from_fen("4k3/8/8/2p5/8/8/8/3QK3 w - - 0 1");
+    EXPECT_FALSE(board.see_ge(Move{3, 27, PieceType::None, MoveFlag::Quiet}, 0));
+    EXPECT_TRUE(board.see_ge(Move{3, 19, PieceType::None, MoveFlag::Quiet}, 0));
+}
+
+TEST(MovePicker, DefersLosingCapturesUntilAfterQuiets) {
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    std::array<PackedMove, 2> killers{};
+    ButterflyHistory history{};
+    MovePicker picker(board, PackedMove{}, killers, history);
+
+    std::vector<Move> order;
+    for (Move move; picker.next(move);) {
+        order.push_back(move);
+    }
+    auto first_quiet = std::find_if(order.begin(), order.end(), [](const Move& m) { return !m.is_capture(); });
+    ASSERT_NE(first_quiet, order.end());
+    for (auto it = order.begin(); it != first_quiet; ++it) {
+        EXPECT_TRUE(board.see_ge(*it, 0));
+    }
+    std::size_t losing = 0;
+    for (auto it = first_quiet; it != order.end(); ++it) {
+        if (it->is_capture()) {
+            EXPECT_FALSE(board.see_ge(*it, 0));
+            ++losing;
+        }
+    }
+    EXPECT_EQ(losing, 5u);
+}
+
+TEST(MovePicker, OrdersQuietsByCounterMoveAndContinuationHistory) {
+    Board board;
+    board.set_start_position();
+    std::array<PackedMove, 2> killers{};
+    ButterflyHistory history{};
+    history[static_cast<int>(Color::White)][6][21] = 500;  // g1f3 leads on butterfly history alone.
+    PackedMove d2d4 = pack_move(Move{11, 27, PieceType::None, MoveFlag::DoublePush});
+    PackedMove b1c3 = pack_move(Move{1, 18, PieceType::None, MoveFlag::Quiet});
+    PieceToHistory one_ply_back{};
+    PieceToHistory two_plies_back{};
+    int knight = encode_piece(Color::White, PieceType::Knight);
+    one_ply_back[static_cast<std::size_t>(knight * kBoardSize + 18)] = 400;
+    two_plies_back[static_cast<std::size_t>(knight * kBoardSize + 18)] = 400;
+
+    ContinuationHistories continuation;
+    continuation.continuation = {&one_ply_back, &two_plies_back};
+    continuation.counter_move = d2d4;
+    MovePicker picker(board, PackedMove{}, killers, history, continuation);
+    std::vector<PackedMove> order;
+    for (Move move; picker.next(move);) {
+        order.push_back(pack_move(move));
+    }
+    ASSERT_EQ(order.size(), 20u);
+    EXPECT_EQ(order[0], d2d4);  // No captures or killers, so the counter move comes first.
+    EXPECT_EQ(order[1], b1c3);  // 0 + 400 + 400 beats g1f3's 500.
+    EXPECT_EQ(picker.quiet_score(b1c3), 800);
+    EXPECT_EQ(std::count(order.begin(), order.end(), d2d4), 1);
+}
+
+TEST(TranspositionTable, StoresAndProbesPackedEntries) {
+    TranspositionTable table(1024);
+    Move move;
+    move.from = 12;
+    move.to = 28;
+    move.flags = MoveFlag::DoublePush;
+    const std::uint64_t key = 0x9E3779B97F4A7C15ULL;
+
+    table.store(key, 7, -1234, pack_move(move), static_cast<std::uint8_t>(TTFlag::Beta));
+
+    TTEntry entry;
+    ASSERT_TRUE(table.probe(key, entry));
+    EXPECT_EQ(entry.depth, 7);
+    EXPECT_EQ(entry.score, -1234);
+    EXPECT_EQ(entry.flag, static_cast<std::uint8_t>(TTFlag::Beta));
+    Move stored = unpack_move(entry.move);
+    EXPECT_EQ(stored.from, 12);
+    EXPECT_EQ(stored.to, 28);
+    EXPECT_EQ(stored.flags, MoveFlag::DoublePush);
+    EXPECT_FALSE(table.probe(key ^ 1ULL, entry));
+}
+
+TEST(TranspositionTable, ReplacementKeepsDeepEntriesAndReportsHashfull) {
+    TranspositionTable table(TranspositionTable::kBucketSize);
+    EXPECT_EQ(table.hashfull(), 0);
+
+    table.store(1ULL, 20, 10, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Exact));
+    for (std::uint64_t key = 2; key < 16; ++key) {
+        table.store(key, 1, 0, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Alpha));
+    }
+
+    TTEntry entry;
+    ASSERT_TRUE(table.probe(1ULL, entry));
+    EXPECT_EQ(entry.depth, 20);
+    EXPECT_EQ(table.hashfull(), 1000);
+
+    table.new_search();
+    EXPECT_EQ(table.hashfull(), 0);
+}
+
+TEST(TranspositionTable, LargeTablesClearInParallelOnAlignedPages) {
+    LargePageBuffer buffer(3 * 1024 * 1024 + 5);
+    ASSERT_NE(buffer.data(), nullptr);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer.data()) % 4096, 0u);
+    const auto* bytes = static_cast<const unsigned char*>(buffer.data());
+    EXPECT_TRUE(std::all_of(bytes, bytes + buffer.size(), [](unsigned char byte) { return byte == 0; }));
+    LargePageBuffer moved = std::move(buffer);
+    EXPECT_EQ(buffer.data(), nullptr);
+    EXPECT_EQ(moved.size(), 3u * 1024u * 1024u + 5u);
+
+    // 128 MB is split over up to four clearing threads; every slice must come back empty.
+    TranspositionTable table(1);
+    table.resize_mb(128);
+    std::vector<std::uint64_t> keys;
+    for (std::uint64_t i = 1; i <= 4096; ++i) {
+        keys.push_back(i * 0x9E3779B97F4A7C15ULL);
+        table.store(keys.back(), 5, 1, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Exact));
+    }
+    table.clear();
+    TTEntry entry;
+    EXPECT_TRUE(std::none_of(keys.begin(), keys.end(), [&](std::uint64_t key) { return table.probe(key, entry); }));
+    EXPECT_GT(numa_node_count(), 0);
+}
+
+TEST(TranspositionTable, NewGameInvalidatesEntriesWithoutClearing) {
+    TranspositionTable table(1024);
+    const std::uint64_t key = 0x0F1E2D3C4B5A6978ULL;
+    table.store(key, 9, 77, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Exact));
+    const std::uint8_t generation = table.generation();
+
+    table.new_game();
+    TTEntry entry;
+    EXPECT_FALSE(table.probe(key, entry));
+    EXPECT_NE(table.generation(), generation);
+
+    table.store(key, 2, -5, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Alpha));
+    ASSERT_TRUE(table.probe(key, entry));
+    EXPECT_EQ(entry.depth, 2);
+    EXPECT_EQ(entry.score, -5);
+}
+
+TEST(TranspositionTable, KeepsStaticEvalAcrossUpdatesWithoutOne) {
+    TranspositionTable table(1024);
+    const std::uint64_t key = 0x0123456789ABCDEFULL;
+
+    table.store(key, 3, 50, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Exact), -321);
+    TTEntry entry;
+    ASSERT_TRUE(table.probe(key, entry));
+    EXPECT_EQ(entry.eval, -321);
+
+    table.store(key, 5, 60, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Exact));
+    ASSERT_TRUE(table.probe(key, entry));
+    EXPECT_EQ(entry.depth, 5);
+    EXPECT_EQ(entry.eval, -321);
+
+    table.store(key ^ 0x40ULL, 1, 0, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Alpha));
+    ASSERT_TRUE(table.probe(key ^ 0x40ULL, entry));
+    EXPECT_EQ(entry.eval, kNoTTEval);
+}
+
+TEST(TranspositionTable, SavedTablesReloadWithTheirSizeAndSalt) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "chiron-tt-roundtrip.bin";
+    TranspositionTable table(4096);
+    table.new_game();  // Saved keys are salted, so the salt has to travel with them.
+    table.new_search();
+    std::vector<std::uint64_t> keys;
+    for (std::uint64_t i = 1; i <= 200; ++i) {
+        keys.push_back(i * 0xD1B54A32D192ED03ULL);
+        table.store(keys.back(), static_cast<int>(i % 30), static_cast<int>(i) - 100,
+                    PackedMove{static_cast<std::uint16_t>(i)}, static_cast<std::uint8_t>(TTFlag::Exact), static_cast<int>(i));
+    }
+    table.save(path.string());
+
+    TranspositionTable restored(64);
+    restored.load(path.string());
+    EXPECT_EQ(restored.entry_count(), table.entry_count());
+    EXPECT_EQ(restored.generation(), table.generation());
+    for (std::uint64_t key : keys) {
+        TTEntry expected;
+        TTEntry entry;
+        ASSERT_EQ(restored.probe(key, entry), table.probe(key, expected));
+        EXPECT_EQ(entry.depth, expected.depth);
+        EXPECT_EQ(entry.score, expected.score);
+        EXPECT_EQ(entry.eval, expected.eval);
+        EXPECT_EQ(entry.move, expected.move);
+    }
+
+    // A cut-off file is rejected before anything is replaced.
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 64);
+    TranspositionTable untouched(64);
+    untouched.store(keys.front(), 3, 1, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Alpha));
+    EXPECT_THROW(untouched.load(path.string()), std::runtime_error);
+    TTEntry entry;
+    EXPECT_TRUE(untouched.probe(keys.front(), entry));
+    std::filesystem::remove(path);
+}
+
+TEST(Uci, NewGameKeepsTheLoadedHashFile) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "chiron-uci-hash.bin";
+    TranspositionTable table(4096);
+    std::vector<std::uint64_t> keys;
+    for (std::uint64_t i = 1; i <= 200; ++i) {
+        keys.push_back(i * 0xD1B54A32D192ED03ULL);
+        table.store(keys.back(), 20, 0, PackedMove{}, static_cast<std::uint8_t>(TTFlag::Exact));
+    }
+    table.save(path.string());
+
+    std::istringstream input("ucinewgame\nposition startpos\ngo depth 1\nisready\nquit\n");
+    std::ostringstream output;
+    std::streambuf* previous_in = std::cin.rdbuf(input.rdbuf());
+    std::streambuf* previous_out = std::cout.rdbuf(output.rdbuf());
+    {
+        UCI uci;
+        uci.persist_hash(path.string());
+        uci.loop();
+    }
+    std::cin.rdbuf(previous_in);
+    std::cout.rdbuf(previous_out);
+    EXPECT_NE(output.str().find("info string hash saved to"), std::string::npos) << output.str();
+
+    // The table saved on quit still holds what was loaded before `ucinewgame`.
+    TranspositionTable restored(64);
+    restored.load(path.string());
+    std::size_t found = 0;
+    for (std::uint64_t key : keys) {
+        TTEntry entry;
+        found += restored.probe(key, entry) ? 1U : 0U;
+    }
+    EXPECT_GE(found, keys.size() - 10);
+    std::filesystem::remove(path);
+}
+
+TEST(Search, AnalysisCacheSeedsRepeatAnalysisWithoutSkippingDepths) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "chiron-analysis-cache.bin";
+    Board board;
+    board.set_from_fen("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+    SearchLimits limits;
+    limits.max_depth = 7;
+    {
+        auto cache = std::make_shared<AnalysisCache>();
+        Search search(1ULL << 16);
+        search.set_analysis_cache(cache);
+        SearchResult result = search.search(board, limits);
+        std::optional<AnalysisRecord> record = cache->probe(board.zobrist_key());
+        ASSERT_TRUE(record.has_value());
+        EXPECT_EQ(record->depth, 7);
+        EXPECT_EQ(record->move, pack_move(result.best_move));
+        cache->record(board.zobrist_key(), {PackedMove{}, 20, 0});  // Null moves are never kept.
+        cache->record(board.zobrist_key(), {record->move, 3, 0});   // Nor are shallower results.
+        EXPECT_EQ(cache->probe(board.zobrist_key())->depth, 7);
+        cache->save(path.string());
+    }
+
+    // A fresh engine with a cold table picks the analysis up from the file, but only as a hint.
+    auto cache = std::make_shared<AnalysisCache>();
+    cache->load(path.string());
+    EXPECT_EQ(cache->size(), 1u);
+    Search search(1ULL << 16);
+    search.set_analysis_cache(cache);
+    limits.max_depth = 8;
+    int first_reported = 0;
+    std::atomic<bool> stop{false};
+    SearchResult next = search.search(board, limits, stop, [&](const SearchResult& info) {
+        if (first_reported == 0) {
+            first_reported = info.depth;
+        }
+    });
+    EXPECT_EQ(first_reported, 1);
+    EXPECT_EQ(next.depth, 8);
+    EXPECT_EQ(cache->probe(board.zobrist_key())->depth, 8);
+    std::filesystem::remove(path);
+}
+
+TEST(EvalCache, StoresEvaluationsAndRejectsOtherKeys) {
+    EvalCache cache;
+    const std::uint64_t key = 0x9E3779B97F4A7C15ULL;
+    int eval = 0;
+    EXPECT_FALSE(cache.probe(key, eval));
+
+    cache.store(key, -1500);
+    ASSERT_TRUE(cache.probe(key, eval));
+    EXPECT_EQ(eval, -1500);
+    EXPECT_FALSE(cache.probe(key ^ (1ULL << 40), eval));
+    EXPECT_FALSE(cache.probe(key + cache.entry_count(), eval));
 
+    cache.sync(1);
+    EXPECT_FALSE(cache.probe(key, eval));
+}
+
+TEST(Search, ReportsEvalCacheHitRate) {
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    SearchLimits limits;
+    limits.max_depth = 5;
+
+    Search search(1ULL << 16);
+    SearchResult result = search.search(board, limits);
+    EXPECT_GT(result.eval_probes, 0u);
+    EXPECT_GT(result.eval_hits, 0u);
+    EXPECT_LE(result.eval_hits, result.eval_probes);
+}
+
+TEST(KeyHistory, CountsRepetitionsWithinTheHalfmoveWindow) {
+    KeyHistory history;
+    // A B C D A B C D A: the last A has two earlier occurrences, and a smaller halfmove
+    // clock (a capture or pawn move in between) hides the older ones.
+    for (int cycle = 0; cycle < 2; ++cycle) {
+        for (std::uint64_t key : {0xAULL, 0xBULL, 0xCULL, 0xDULL}) {
+            history.push(key);
+        }
+    }
+    history.push(0xAULL);
+    EXPECT_EQ(history.repetitions(8), 2);
+    EXPECT_EQ(history.repetitions(7), 1);
+    EXPECT_EQ(history.repetitions(3), 0);
+    history.pop();
+    EXPECT_EQ(history.repetitions(8), 1);
+
+    // Wrapping the ring keeps the most recent keys intact.
+    for (std::size_t i = 0; i < KeyHistory::kCapacity + 4; ++i) {
+        history.push(i % 4 == 0 ? 0xEULL : 0x100ULL + i);
+    }
+    EXPECT_EQ(history.repetitions(50), 0);
+    history.push(0xEULL);
+    EXPECT_EQ(history.repetitions(50), 12);
+}
+
+TEST(SearchIntegration, SeededGameHistoryScoresRepetitionAsDraw) {
+    // White is a queen up, but after the knight and king shuffle below the position has
+    // occurred for the third time, which only the seeded game history reveals.
+    Board board;
+    board.set_from_fen("k7/8/8/8/8/8/8/K2Q2N1 w - - 0 1");
+    std::vector<std::uint64_t> history;
+    const Move shuffle[] = {{6, 21, PieceType::None, MoveFlag::Quiet}, {56, 57, PieceType::None, MoveFlag::Quiet},
+                            {21, 6, PieceType::None, MoveFlag::Quiet}, {57, 56, PieceType::None, MoveFlag::Quiet}};
+    for (int cycle = 0; cycle < 2; ++cycle) {
+        for (const Move& move : shuffle) {
+            history.push_back(board.zobrist_key());
+            Board::State state;
+            board.make_move(move, state);
+        }
+    }
+    ASSERT_EQ(board.halfmove_clock(), 8);
+
+    Search fresh(1ULL << 16);
+    EXPECT_GT(SearchTestHelper::negamax_entry(fresh, board, 3, -30000, 30000), 500);
+
+    Search seeded(1ULL << 16);
+    seeded.set_game_history(history);
+    EXPECT_EQ(SearchTestHelper::negamax_entry(seeded, board, 3, -30000, 30000), 0);
+}
+
+TEST(Search, HonoursSoftAndHardNodeBudgets) {
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Search search(1ULL << 16);
+
+    SearchLimits hard;
+    hard.node_limit = 3000;
+    SearchResult stopped = search.search(board, hard);
+    EXPECT_GE(stopped.nodes, 3000u);
+    EXPECT_LT(stopped.nodes, 3000u + 512u);  // Limits are checked every few hundred nodes.
+    EXPECT_FALSE(stopped.best_move.from == 0 && stopped.best_move.to == 0);
+
+    // A soft budget lets the iteration in progress finish, then starts no other.
+    SearchLimits soft;
+    soft.soft_node_limit = 3000;
+    search.new_game();
+    SearchResult finished = search.search(board, soft);
+    EXPECT_GE(finished.nodes, 3000u);
+    EXPECT_LT(finished.depth, 64);
+
+    SearchLimits shallower;
+    shallower.max_depth = finished.depth - 1;
+    search.new_game();
+    EXPECT_LT(search.search(board, shallower).nodes, 3000u);
+}
+
+TEST(Search, ContinuationHistoryIsOptIn) {
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    SearchLimits limits;
+    limits.max_depth = 7;
+
+    Search off(1ULL << 16);
+    Search on(1ULL << 16);
+    on.set_continuation_history(true);
+    SearchResult plain = off.search(board, limits);
+    SearchResult ordered = on.search(board, limits);
+    EXPECT_NE(plain.nodes, ordered.nodes);
+    EXPECT_FALSE(ordered.best_move.from == 0 && ordered.best_move.to == 0);
+
+    // Switching it back off gives the default search again.
+    on.set_continuation_history(false);
+    on.new_game();
+    off.new_game();
+    EXPECT_EQ(on.search(board, limits).nodes, off.search(board, limits).nodes);
+}
+
+TEST(Search, MultiPvReportsDistinctLinesBestFirst) {
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Search search(1ULL << 16);
+    SearchLimits limits;
+    limits.max_depth = 4;
+    limits.multi_pv = 3;
+    SearchResult result = search.search(board, limits);
+
+    ASSERT_EQ(result.lines.size(), 3u);
+    EXPECT_EQ(pack_move(result.lines[0].pv.front()), pack_move(result.best_move));
+    EXPECT_EQ(result.lines[0].score, result.score);
+    std::vector<Move> legal = MoveGenerator::generate_legal_moves(board);
+    for (std::size_t i = 0; i < result.lines.size(); ++i) {
+        ASSERT_FALSE(result.lines[i].pv.empty());
+        EXPECT_TRUE(contains_move(legal, result.lines[i].pv.front()));
+        for (std::size_t j = 0; j < i; ++j) {
+            EXPECT_NE(pack_move(result.lines[i].pv.front()), pack_move(result.lines[j].pv.front()));
+            EXPECT_GE(result.lines[j].score, result.lines[i].score);
+        }
+    }
+
+    // Asking for more lines than there are legal moves reports each move once.
+    board.set_from_fen("k7/8/8/8/8/8/8/K7 w - - 0 1");
+    limits.multi_pv = 10;
+    search.new_game();
+    EXPECT_EQ(search.search(board, limits).lines.size(), 3u);
+}
+
+TEST(TimeManager, SoftLimitStretchesForUnstableSearches) {
+    TimeManager manager;
+    TimeBudget budget = manager.allocate(3000, 0, 1, 0);
+    EXPECT_EQ(budget.soft_ms, manager.allocate_time_ms(3000, 0, 1, 0));
+    EXPECT_GT(budget.hard_ms, budget.soft_ms);
+    EXPECT_LE(budget.hard_ms, 900);  // At most 30% of the clock.
+
+    IterationSignals settled;
+    settled.best_move_node_share = 0.95;
+    IterationSignals typical;
+    typical.best_move_node_share = 0.66;
+    IterationSignals unstable = typical;
+    unstable.best_move_changes = 2.0;
+    unstable.score_drop = 40;
+    EXPECT_LT(manager.soft_scale(settled), 1.0);
+    EXPECT_NEAR(manager.soft_scale(typical), 1.0, 0.05);
+    EXPECT_GT(manager.soft_scale(unstable), 2.0);
+}
+
+TEST(Search, ClockSearchesFinishWithinTheHardLimit) {
+    Board board;
+    board.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    Search search(1ULL << 16);
+    SearchLimits limits;
+    limits.time_left_ms[static_cast<int>(Color::White)] = 3000;
+    TimeBudget budget = TimeManager{}.allocate(3000, 0, board.fullmove_number(), 0);
+    SearchResult result = search.search(board, limits);
+    EXPECT_FALSE(result.best_move.from == 0 && result.best_move.to == 0);
+    EXPECT_GT(result.depth, 1);
+    EXPECT_LE(result.elapsed.count(), budget.hard_ms + 100);  // Slack for a loaded machine.
+}
+
+TEST(Search, ContinuesFromThePreviousPrincipalVariation) {
+    Board board;
+    board.set_from_fen("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3");
+    Search search(1ULL << 18);
+    SearchLimits limits;
+    limits.max_depth = 8;
+    SearchResult first = search.search(board, limits);
+    ASSERT_GE(first.pv.size(), 3u);
+
+    // Two plies later the root lies on the PV, so iterative deepening resumes near the old depth.
+    Board::State states[2];
+    board.make_move(first.pv[0], states[0]);
+    board.make_move(first.pv[1], states[1]);
+    limits.max_depth = 9;
+    int first_reported = 0;
+    std::atomic<bool> stop{false};
+    SearchResult next = search.search(board, limits, stop, [&](const SearchResult& info) {
+        if (first_reported == 0) {
+            first_reported = info.depth;
+        }
+    });
+    EXPECT_GT(first_reported, 2);
+    EXPECT_EQ(next.depth, 9);
+    EXPECT_TRUE(contains_move(MoveGenerator::generate_legal_moves(board), next.best_move));
+}
+
+TEST(Search, PonderSearchWaitsForPonderhit) {
+    Board board;
+    board.set_start_position();
+    Search search(1ULL << 16);
+    SearchLimits limits;
+    limits.max_depth = 3;
+    limits.ponder = true;
+    limits.time_left_ms[static_cast<int>(Color::White)] = 1000;
+    std::atomic<bool> stop{false};
+
+    auto start = std::chrono::steady_clock::now();
+    search.prepare_clock(limits.ponder);
+    std::thread opponent([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        search.ponderhit();
+    });
+    SearchResult result = search.search(board, limits, stop, {});
+    opponent.join();
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+    EXPECT_EQ(result.depth, 3);
+    EXPECT_TRUE(contains_move(MoveGenerator::generate_legal_moves(board), result.best_move));
+}
+
+TEST(Search, PonderhitBeforeThePonderSearchStartsIsKept) {
+    Board board;
+    board.set_start_position();
+    Search search(1ULL << 16);
+    SearchLimits limits;
+    limits.max_depth = 3;
+    limits.ponder = true;
+    limits.time_left_ms[static_cast<int>(Color::White)] = 1000;
+    std::atomic<bool> stop{false};
+
+    search.prepare_clock(limits.ponder);
+    search.ponderhit();
+    // Without the early ponderhit this search would wait for a stop that never comes.
+    SearchResult result = search.search(board, limits, stop, {});
+    EXPECT_EQ(result.depth, 3);
+    EXPECT_TRUE(contains_move(MoveGenerator::generate_legal_moves(board), result.best_move));
+}
+
+TEST(Bench, SignatureIsRepeatableAndStatsAreConsistent) {
+    BenchConfig config;
+    config.depth = 4;
+    config.hash_mb = 1;
+    std::size_t searched = 0;
+    BenchResult first = run_bench(config, [&](std::size_t, const SearchResult& result) {
+        EXPECT_FALSE(result.best_move.from == 0 && result.best_move.to == 0);
+        ++searched;
+    });
+    EXPECT_EQ(searched, bench_positions().size());
+    EXPECT_GT(first.nodes, 0u);
+    EXPECT_EQ(run_bench(config).nodes, first.nodes);
+
+    const SearchStats& stats = first.stats;
+    if (kSearchStatsEnabled) {
+        EXPECT_GT(stats.tt_probes, 0u);
+        EXPECT_LE(stats.tt_hits, stats.tt_probes);
+        EXPECT_LE(stats.first_move_fail_highs, stats.fail_highs);
+        EXPECT_LE(stats.qsearch_nodes, first.nodes);
+        EXPECT_LE(stats.null_move_cutoffs, stats.null_move_tries);
+        EXPECT_LE(stats.lmr_re_searches, stats.lmr_searches);
+    } else {
+        EXPECT_EQ(stats.tt_probes, 0u);
+        EXPECT_EQ(stats.evaluations, 0u);
+    }
+}
+
+TEST(Trace, RecordsSpansOnlyWhileEnabledAndExportsChromeJson) {
+    const auto path = std::filesystem::temp_directory_path() / "chiron_trace_test.json";
+    { trace::Span ignored("disabled"); }
+    trace::start();
+    EXPECT_EQ(trace::recorded_spans(), 0u);
+    {
+        trace::Span outer("outer");
+        std::thread worker([] { trace::Span inner("worker"); });
+        worker.join();
+    }
+    EXPECT_EQ(trace::recorded_spans(), 2u);
+    // A later thread takes over the finished worker's ring rather than adding one.
+    std::thread([] { trace::Span again("worker"); }).join();
+    EXPECT_EQ(trace::recorded_spans(), 3u);
+    // A span from late in a long session keeps its sub-microsecond digits.
+    auto late = std::chrono::steady_clock::now() + std::chrono::seconds(12);
+    trace::detail::record("late", late, late + std::chrono::nanoseconds(15250));
+    trace::stop(path.string());
+    { trace::Span ignored("stopped"); }
+    EXPECT_EQ(trace::recorded_spans(), 4u);
+
+    std::ifstream in(path);
+    std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0), 0u);
+    EXPECT_NE(json.find("\"name\":\"outer\",\"cat\":\"chiron\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"worker\""), std::string::npos);
+    EXPECT_EQ(json.find("disabled"), std::string::npos);
+    EXPECT_EQ(json.find("stopped"), std::string::npos);
+    std::size_t threads = 0;
+    for (std::size_t at = json.find("thread_name"); at != std::string::npos; at = json.find("thread_name", at + 1)) {
+        ++threads;
+    }
+    EXPECT_EQ(threads, 2u);
+    std::size_t late_at = json.find("\"name\":\"late\"");
+    ASSERT_NE(late_at, std::string::npos);
+    std::size_t ts_at = json.find("\"ts\":", late_at) + 5;
+    std::string ts = json.substr(ts_at, json.find(',', ts_at) - ts_at);
+    EXPECT_EQ(ts.find('e'), std::string::npos) << ts;
+    EXPECT_GE(std::stod(ts), 12e6) << ts;
+    ASSERT_NE(ts.find('.'), std::string::npos) << ts;
+    EXPECT_EQ(ts.size() - ts.find('.'), 4u) << ts;
+    EXPECT_NE(json.find("\"dur\":15.250}", late_at), std::string::npos);
+    EXPECT_EQ(json.substr(json.size() - 3), "]}\n");
+    std::filesystem::remove(path);
+}
+
+}  // namespace chiron
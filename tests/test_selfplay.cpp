@@ -1,10 +1,24 @@
 #include <gtest/gtest.h>
 
+#include <array>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <future>
+#include <optional>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "book.h"
+#include "tools/tuning.h"
+#include "training/distributed.h"
+#include "training/learning_regimen.h"
+#include "training/log_sink.h"
+#include "training/openings.h"
 #include "training/selfplay.h"
 
 namespace chiron {
@@ -22,6 +36,99 @@ TEST(SelfPlay, GeneratesGameData) {
     SelfPlayResult result = orchestrator.play_game(0, config.white, config.black, false);
     EXPECT_GE(result.ply_count, 0);
     EXPECT_FALSE(result.result.empty());
+
+    // The compact record replays to the position the game ended in.
+    ASSERT_EQ(result.moves.size(), static_cast<std::size_t>(result.ply_count));
+    std::vector<std::string> fens = result.fens();
+    ASSERT_EQ(fens.size(), result.moves.size());
+    if (!fens.empty()) {
+        EXPECT_EQ(fens.back(), result.end_fen);
+    }
+    EXPECT_EQ(result.san_moves().size(), result.moves.size());
+}
+
+TEST(SelfPlay, EnginePoolReusesEnginesAcrossGames) {
+    EngineConfig candidate;
+    candidate.network_path = "candidate.nnue";
+    EngineConfig baseline;
+    baseline.network_path = "baseline.nnue";
+
+    // Networks load lazily, so the placeholder paths are never opened.
+    SelfPlayEnginePool pool;
+    SelfPlayEnginePool::Engines first = pool.acquire(candidate, baseline);
+    Search* candidate_engine = &first.white;
+    Search* baseline_engine = &first.black;
+    EXPECT_NE(candidate_engine, baseline_engine);
+
+    SelfPlayEnginePool::Engines swapped = pool.acquire(baseline, candidate);
+    EXPECT_EQ(&swapped.white, baseline_engine);
+    EXPECT_EQ(&swapped.black, candidate_engine);
+
+    candidate.threads = 2;
+    SelfPlayEnginePool::Engines rebound = pool.acquire(candidate, baseline);
+    EXPECT_EQ(&rebound.white, candidate_engine);
+    EXPECT_EQ(rebound.white.threads(), 2);
+}
+
+TEST(SelfPlay, TrainsOnItsOwnThreadWhileGamesRun) {
+    namespace fs = std::filesystem;
+    auto timestamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    fs::path directory = fs::temp_directory_path() / fs::path("selfplay-train-" + std::to_string(timestamp));
+
+    SelfPlayConfig config;
+    config.games = 6;
+    config.concurrency = 2;
+    config.white.max_depth = 1;
+    config.black.max_depth = 1;
+    config.white.table_size = 1 << 12;
+    config.black.table_size = 1 << 12;
+    config.max_ply = 20;
+    config.capture_results = false;
+    config.capture_pgn = false;
+    config.enable_training = true;
+    config.training_batch_size = 16;
+    config.training_queue_batches = 1;  // Workers wait for the trainer once a batch is queued.
+    config.training_output_path = (directory / "net.nnue").string();
+    config.training_history_dir = (directory / "history").string();
+
+    {
+        SelfPlayOrchestrator orchestrator(config);
+        orchestrator.run();
+    }
+    EXPECT_TRUE(fs::exists(directory / "net.nnue"));
+    EXPECT_FALSE(fs::is_empty(directory / "history"));
+    fs::remove_all(directory);
+}
+
+TEST(SelfPlay, LearningRegimenTrainsEachPipelinedIterationOnce) {
+    namespace fs = std::filesystem;
+    auto timestamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    fs::path directory = fs::temp_directory_path() / fs::path("learn-pipeline-" + std::to_string(timestamp));
+
+    LearningRegimenConfig config;
+    config.iterations = 3;
+    config.selfplay_games = 2;
+    config.selfplay_depth = 1;
+    config.selfplay_max_ply = 16;
+    config.teacher_games = 0;
+    config.training_batch_size = 8;
+    config.holdout_samples = 0;
+    config.online_database_dir = (directory / "online").string();
+    config.output_network_path = (directory / "net.nnue").string();
+    config.training_history_dir = (directory / "history").string();
+    {
+        LearningRegimen regimen(config);
+        regimen.run();
+    }
+
+    // Games only hand positions over; the regimen saves one snapshot per trained iteration.
+    std::set<std::string> snapshots;
+    for (const auto& entry : fs::directory_iterator(directory / "history")) {
+        snapshots.insert(entry.path().filename().string());
+    }
+    EXPECT_EQ(snapshots, (std::set<std::string>{"net-iter000001.nnue", "net-iter000002.nnue", "net-iter000003.nnue"}));
+    EXPECT_TRUE(fs::exists(directory / "net.nnue"));
+    fs::remove_all(directory);
 }
 
 TEST(SelfPlay, LogsWellFormedResultLine) {
@@ -63,5 +170,294 @@ TEST(SelfPlay, LogsWellFormedResultLine) {
     EXPECT_EQ(line.find(",\"\""), std::string::npos);
 }
 
-}  // namespace chiron
+TEST(SelfPlay, SchedulesOpeningsAsColourSwappedPairs) {
+    namespace fs = std::filesystem;
+    fs::path epd = fs::temp_directory_path() / "chiron-openings.epd";
+    fs::path pgn = fs::temp_directory_path() / "chiron-openings.pgn";
+    {
+        std::ofstream out(epd);
+        out << "# comment\n";
+        out << "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - bm e5; id \"e4\";\n";
+        out << "rnbqkbnr/pppppppp/8/8/3P4/8/PPP1PPPP/RNBQKBNR b KQkq - 0 1\n";
+    }
+    {
+        std::ofstream out(pgn);
+        out << "[Event \"a\"]\n[Result \"*\"]\n\n1. e4 {main} e5 (1... c5) 2. Nf3 Nc6 *\n\n";
+        out << "[Event \"b\"]\n[Result \"1-0\"]\n\n1. d4! d5 2. c4 1-0\n";
+    }
+
+    OpeningSuite from_epd = OpeningSuite::load(epd.string());
+    ASSERT_EQ(from_epd.size(), 2u);
+    EXPECT_EQ(from_epd.fen(0), "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+
+    OpeningSuite from_pgn = OpeningSuite::load(pgn.string(), 2);
+    ASSERT_EQ(from_pgn.size(), 2u);
+    EXPECT_EQ(from_pgn.fen(0), "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq e6 0 2");
+    EXPECT_EQ(from_pgn.fen(1), "rnbqkbnr/ppp1pppp/8/3p4/3P4/8/PPP1PPPP/RNBQKBNR w KQkq d6 0 2");
+    fs::remove(epd);
+    fs::remove(pgn);
+
+    GamePairScheduler scheduler(5, true, std::make_shared<const OpeningSuite>(from_epd));
+    std::vector<GameAssignment> games;
+    while (std::optional<GameAssignment> game = scheduler.next()) {
+        games.push_back(*game);
+    }
+    ASSERT_EQ(games.size(), 5u);
+    for (int pair = 0; pair < 2; ++pair) {
+        const GameAssignment& first = games[static_cast<std::size_t>(pair * 2)];
+        const GameAssignment& second = games[static_cast<std::size_t>(pair * 2 + 1)];
+        EXPECT_EQ(first.start_fen, second.start_fen);
+        EXPECT_NE(first.swap_colors, second.swap_colors);
+        EXPECT_EQ(first.swap_colors, pair % 2 == 1);
+    }
+    EXPECT_NE(games[0].start_fen, games[2].start_fen);
+    EXPECT_EQ(games[4].start_fen, games[0].start_fen);
+
+    // Games from a black-to-move opening keep its position and move numbers.
+    SelfPlayConfig config;
+    config.white.max_depth = 1;
+    config.black.max_depth = 1;
+    config.capture_results = false;
+    config.capture_pgn = false;
+    config.max_ply = 6;
+    SelfPlayOrchestrator orchestrator(config);
+    SelfPlayResult result = orchestrator.play_game(0, config.white, config.black, false, games[0].start_fen);
+    EXPECT_EQ(result.start_fen, games[0].start_fen);
+    EXPECT_EQ(result.ply_count, 6);
+}
+
+TEST(OpeningBook, PolyglotKeysMatchTheReferenceVectors) {
+    // Keys from Polyglot's book format description; en passant counts only when a capture is possible.
+    const std::vector<std::pair<const char*, std::uint64_t>> cases = {
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463B96181691FC9CULL},
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823C9B50FD114196ULL},
+        {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22A48B5A8E47FF78ULL},
+        {"rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00FDD303C946BDD9ULL},
+        {"rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3C8123EA7B067637ULL},
+        {"rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5C3F9B829B279560ULL},
+    };
+    Board board;
+    for (const auto& [fen, key] : cases) {
+        board.set_from_fen(fen);
+        EXPECT_EQ(OpeningBook::polyglot_key(board), key) << fen;
+    }
+}
+
+TEST(SelfPlay, BuildsAndPlaysFromAnOpeningBook) {
+    namespace fs = std::filesystem;
+    fs::path pgn = fs::temp_directory_path() / "chiron-book-games.pgn";
+    fs::path log = fs::temp_directory_path() / "chiron-book-results.jsonl";
+    fs::path book_path = fs::temp_directory_path() / "chiron-book.bin";
+    {
+        std::ofstream out(pgn);
+        out << "[Result \"1-0\"]\n\n1. e4 e5 2. Nf3 Nc6 1-0\n\n";
+        out << "[Result \"0-1\"]\n\n1. e4 c5 0-1\n\n";
+        out << "[FEN \"r3k3/1P6/8/8/8/8/8/4K2R w K - 0 1\"]\n\n1. O-O Kd7 2. bxa8=Q 1-0\n\n";
+        out << "[Result \"*\"]\n\n1. d4 *\n";
+    }
+    {
+        std::ofstream out(log);
+        out << "{\"game\":1,\"result\":\"1/2-1/2\",\"start_fen\":"
+               "\"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1\",\"moves\":[\"e4\",\"e5\"]}\n";
+    }
+    OpeningBookBuilder builder;
+    EXPECT_EQ(builder.add_file(pgn.string()), 3u);  // The unfinished game is skipped.
+    EXPECT_EQ(builder.add_file(log.string()), 1u);
+    EXPECT_EQ(builder.write(book_path.string()), 8u);
 
+    OpeningBook book(book_path.string());
+    EXPECT_EQ(book.entry_count(), 8u);
+    Board board;
+    board.set_start_position();
+    std::vector<BookMove> root = book.probe(board);
+    ASSERT_EQ(root.size(), 1u);
+    EXPECT_EQ(move_to_string(root[0].move), "e2e4");
+    EXPECT_EQ(root[0].weight, 3);  // A win and a draw for the side playing it, two points and one.
+    Board::State state;
+    board.make_move(root[0].move, state);
+    std::vector<BookMove> replies = book.probe(board);
+    ASSERT_EQ(replies.size(), 2u);
+    EXPECT_EQ(move_to_string(replies[0].move), "c7c5");
+    EXPECT_EQ(move_to_string(replies[1].move), "e7e5");
+    EXPECT_EQ(move_to_string(*book.pick(board, 0.0)), "c7c5");
+    EXPECT_EQ(move_to_string(*book.pick(board, 0.99)), "e7e5");
+
+    Board endgame;
+    endgame.set_from_fen("r3k3/1P6/8/8/8/8/8/4K2R w K - 0 1");
+    std::vector<BookMove> castle = book.probe(endgame);
+    ASSERT_EQ(castle.size(), 1u);
+    EXPECT_TRUE(castle[0].move.is_castle());
+    EXPECT_EQ(OpeningBook::encode_move(castle[0].move), 4 << 6 | 7);  // Polyglot's e1h1.
+
+    // Rarely played moves drop out when games are required to agree.
+    EXPECT_EQ(builder.write(book_path.string(), 2), 2u);
+
+    SelfPlayConfig config;
+    config.white.max_depth = 1;
+    config.black.max_depth = 1;
+    config.capture_results = false;
+    config.capture_pgn = false;
+    config.max_ply = 3;
+    config.book_path = book_path.string();
+    SelfPlayOrchestrator orchestrator(config);
+    SelfPlayResult result = orchestrator.play_game(0, config.white, config.black, false);
+    std::vector<std::string> san = result.san_moves();
+    ASSERT_EQ(san.size(), 3u);
+    EXPECT_EQ(san[0], "e4");
+    EXPECT_EQ(san[1], "e5");
+    fs::remove(pgn);
+    fs::remove(log);
+    fs::remove(book_path);
+}
+
+TEST(SelfPlay, PentanomialLlrFollowsPairScores) {
+    EXPECT_DOUBLE_EQ(pentanomial_llr({0, 0, 0, 0, 0}, 0.0, 10.0), 0.0);
+    // Balanced pairs favour the null hypothesis, pairs won by the candidate the alternative.
+    std::array<int, 5> balanced{5, 20, 50, 20, 5};
+    std::array<int, 5> stronger{2, 10, 40, 30, 18};
+    EXPECT_LT(pentanomial_llr(balanced, 0.0, 10.0), 0.0);
+    EXPECT_GT(pentanomial_llr(stronger, 0.0, 10.0), 0.0);
+    // The ratio grows with the evidence.
+    std::array<int, 5> doubled{4, 20, 80, 60, 36};
+    EXPECT_GT(pentanomial_llr(doubled, 0.0, 10.0), 1.9 * pentanomial_llr(stronger, 0.0, 10.0));
+    // A single won pair is weak evidence, not a decision.
+    EXPECT_LT(pentanomial_llr({0, 0, 0, 1, 0}, 0.0, 50.0), 1.0);
+}
+
+TEST(SelfPlay, ParallelSprtLogsGamesInOrder) {
+    namespace fs = std::filesystem;
+    fs::path log = fs::temp_directory_path() / "chiron-sprt-parallel.jsonl";
+    fs::remove(log);
+
+    SelfPlayConfig match;
+    match.max_ply = 16;
+    match.capture_results = false;
+    match.capture_pgn = false;
+    EngineConfig baseline;
+    baseline.max_depth = 1;
+    EngineConfig candidate = baseline;
+    SprtConfig sprt;
+    sprt.max_games = 7;
+    sprt.concurrency = 3;
+    sprt.results_path = log.string();
+
+    SprtSummary summary = SprtTester(match, baseline, candidate, sprt).run();
+    int pairs = 0;
+    for (int count : summary.pentanomial) {
+        pairs += count;
+    }
+    EXPECT_EQ(summary.games_played, 2 * pairs);
+    EXPECT_EQ(summary.candidate_wins + summary.baseline_wins + summary.draws, summary.games_played);
+
+    std::ifstream stream(log);
+    std::string line;
+    int expected_game = 1;
+    while (std::getline(stream, line)) {
+        EXPECT_EQ(line.rfind("{\"game\":" + std::to_string(expected_game) + ",", 0), 0u) << line;
+        ++expected_game;
+    }
+    EXPECT_EQ(expected_game - 1, summary.games_played);
+    stream.close();
+    fs::remove(log);
+
+    // Cancelled games end at once and unfinished until games are resumed.
+    SelfPlayOrchestrator orchestrator(match);
+    orchestrator.cancel_games();
+    SelfPlayResult cancelled = orchestrator.play_game(0, baseline, candidate, false);
+    EXPECT_EQ(cancelled.termination, "cancelled");
+    EXPECT_EQ(cancelled.ply_count, 0);
+    orchestrator.resume_games();
+    EXPECT_NE(orchestrator.play_game(0, baseline, candidate, false).termination, "cancelled");
+}
+
+TEST(SelfPlay, CoordinatorPlaysGamesOnRemoteWorkers) {
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "chiron-distributed";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    fs::path network = dir / "shared.nnue";
+    ParameterSet(16, nnue::FeatureSet::PieceSquare).save(network.string());
+
+    SelfPlayConfig config;
+    config.games = 3;
+    config.max_ply = 12;
+    config.white.max_depth = 1;
+    config.black.max_depth = 1;
+    config.white.network_path = network.string();
+    config.results_log = (dir / "results.jsonl").string();
+    config.pgn_path = (dir / "games.pgn").string();
+    config.append_logs = false;
+    SelfPlayOrchestrator orchestrator(config);
+
+    std::promise<std::uint16_t> listening;
+    CoordinatorConfig coordinator;
+    coordinator.port = 0;
+    coordinator.on_listening = [&](std::uint16_t port) { listening.set_value(port); };
+    std::thread server([&]() { run_coordinator(orchestrator, coordinator); });
+
+    WorkerConfig worker;
+    worker.port = listening.get_future().get();
+    worker.concurrency = 2;
+    worker.cache_dir = (dir / "cache").string();
+    EXPECT_EQ(run_worker(worker), 3u);
+    server.join();
+
+    std::ifstream results(config.results_log);
+    std::set<std::string> games;
+    std::string line;
+    while (std::getline(results, line)) {
+        games.insert(line.substr(0, line.find(',')));
+    }
+    EXPECT_EQ(games, (std::set<std::string>{"{\"game\":1", "{\"game\":2", "{\"game\":3"}));
+
+    // The network travelled once, under its content hash.
+    std::size_t cached = 0;
+    for (const auto& entry : fs::directory_iterator(dir / "cache")) {
+        EXPECT_EQ(entry.path().extension(), ".nnue");
+        ++cached;
+    }
+    EXPECT_EQ(cached, 1u);
+    results.close();
+    fs::remove_all(dir);
+}
+
+TEST(SelfPlay, AsyncLogSinkKeepsEachWritersOrder) {
+    std::ostringstream even;
+    std::ostringstream odd;
+    constexpr int kWriters = 4;
+    constexpr int kRecords = 500;
+    {
+        AsyncLogSink sink({&even, &odd}, AsyncLogSink::Config{256, std::chrono::milliseconds(5)});
+        std::vector<std::thread> writers;
+        for (int writer = 0; writer < kWriters; ++writer) {
+            writers.emplace_back([&sink, writer]() {
+                for (int record = 0; record < kRecords; ++record) {
+                    sink.write(static_cast<std::size_t>(writer % 2),
+                               std::to_string(writer) + ' ' + std::to_string(record) + '\n');
+                }
+            });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+        sink.flush();
+
+        std::array<int, kWriters> next{};
+        int lines = 0;
+        for (const std::ostringstream* stream : {&even, &odd}) {
+            std::istringstream input(stream->str());
+            int writer = 0;
+            int record = 0;
+            while (input >> writer >> record) {
+                EXPECT_EQ(writer % 2, stream == &even ? 0 : 1);
+                EXPECT_EQ(record, next[static_cast<std::size_t>(writer)]++);
+                ++lines;
+            }
+        }
+        EXPECT_EQ(lines, kWriters * kRecords);
+        sink.write(0, "last\n");
+    }
+    EXPECT_NE(even.str().find("last\n"), std::string::npos);  // Drained on destruction.
+}
+
+}  // namespace chiron
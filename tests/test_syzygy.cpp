@@ -0,0 +1,749 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "key_history.h"
+#include "movegen.h"
+#include "search.h"
+#include "syzygy.h"
+#include "training/selfplay.h"
+
+namespace chiron {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+/**
+ * @brief Writes a KQvK WDL table that stores one value per side to move instead of compressed
+ *        data. The real table is not needed: every KQvK position without a capture is a win for
+ *        the side with the queen, which is exactly what a single-value table says.
+ */
+fs::path write_kqvk_table(const std::string& name) {
+    fs::path directory = fs::temp_directory_path() / name;
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    std::array<std::uint8_t, 80> bytes{};  // Header, a 64-byte aligned (empty) data section and padding.
+    const std::uint8_t header[] = {
+        0x71, 0xE8, 0x23, 0x5D,  // WDL magic.
+        0x01,                    // No pawns, different material per color.
+        0x00,                    // Index order: all three pieces form the first group.
+        0x66, 0x55, 0xEE,        // White king, white queen, black king for either side to move.
+        0x00,                    // Alignment.
+        0x80, 4,                 // White to move: a single value, a win (WDL + 2).
+        0x80, 0,                 // Black to move: a loss.
+    };
+    std::copy(std::begin(header), std::end(header), bytes.begin());
+    std::ofstream out(directory / "KQvK.rtbw", std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return directory;
+}
+
+Board from_fen(const std::string& fen) {
+    Board board;
+    board.set_from_fen(fen);
+    return board;
+}
+
+// Compressed fixtures: real tables store their values as a canonical Huffman code over recursive
+// pairs. The writer below produces that layout for KRvK, from its known results, and for KPvK,
+// from a retrograde solution; neither uses the prober's own code.
+
+int file_of(int square) { return square & 7; }
+int rank_of(int square) { return square >> 3; }
+
+bool adjacent(int a, int b) {
+    return a != b && std::abs(file_of(a) - file_of(b)) <= 1 && std::abs(rank_of(a) - rank_of(b)) <= 1;
+}
+
+/** @brief Whether a rook (or with @p diagonals a queen) on @p from attacks @p to past @p occupied. */
+bool slider_attacks(int from, int to, std::uint64_t occupied, bool diagonals) {
+    int df = file_of(to) - file_of(from);
+    int dr = rank_of(to) - rank_of(from);
+    bool straight = df == 0 || dr == 0;
+    if (from == to || (!straight && (!diagonals || std::abs(df) != std::abs(dr)))) {
+        return false;
+    }
+    int step = (dr > 0 ? 8 : dr < 0 ? -8 : 0) + (df > 0 ? 1 : df < 0 ? -1 : 0);
+    for (int square = from + step; square != to; square += step) {
+        if (occupied & (1ULL << square)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const std::vector<int>& king_moves(int square) {
+    static const auto moves = [] {
+        std::array<std::vector<int>, 64> table;
+        for (int from = 0; from < 64; ++from) {
+            for (int to = 0; to < 64; ++to) {
+                if (adjacent(from, to)) {
+                    table[static_cast<std::size_t>(from)].push_back(to);
+                }
+            }
+        }
+        return table;
+    }();
+    return moves[static_cast<std::size_t>(square)];
+}
+
+bool pawn_attacks(int pawn, int square) {
+    return (square == pawn + 7 && file_of(pawn) > 0) || (square == pawn + 9 && file_of(pawn) < 7);
+}
+
+/**
+ * @brief Black to move against a lone white king and rook or queen on @p piece: a draw after a
+ *        stalemate or a free capture of the piece, otherwise lost.
+ */
+bool black_loses_against_piece(int piece, int white_king, int black_king, bool queen) {
+    std::uint64_t occupied = (1ULL << piece) | (1ULL << white_king);
+    bool has_move = false;
+    for (int to : king_moves(black_king)) {
+        if (to == white_king || adjacent(to, white_king)) {
+            continue;
+        }
+        if (to == piece) {
+            return false;  // The piece is not defended, so taking it leaves bare kings.
+        }
+        has_move = has_move || !slider_attacks(piece, to, occupied, queen);
+    }
+    return has_move || slider_attacks(piece, black_king, occupied, queen);
+}
+
+/** @brief Values (WDL + 2) of KPvK, [side to move][pawn][white king][black king], by retrograde analysis. */
+std::array<std::vector<std::uint8_t>, 2> solve_kpvk() {
+    auto at = [](int pawn, int white_king, int black_king) {
+        return (static_cast<std::size_t>(pawn) * 64 + static_cast<std::size_t>(white_king)) * 64 +
+               static_cast<std::size_t>(black_king);
+    };
+    std::vector<bool> white_wins(64 * 64 * 64, false);  // White to move.
+    std::vector<bool> black_loses(64 * 64 * 64, false);  // Black to move.
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (int pawn = 8; pawn < 56; ++pawn) {
+            for (int wk = 0; wk < 64; ++wk) {
+                for (int bk = 0; bk < 64; ++bk) {
+                    if (wk == pawn || bk == pawn || wk == bk || adjacent(wk, bk)) {
+                        continue;
+                    }
+                    if (!white_wins[at(pawn, wk, bk)] && !pawn_attacks(pawn, bk)) {
+                        bool wins = false;
+                        for (int to : king_moves(wk)) {
+                            wins = wins || (to != pawn && !adjacent(to, bk) && black_loses[at(pawn, to, bk)]);
+                        }
+                        int push = pawn + 8;
+                        if (!wins && push != wk && push != bk) {
+                            if (push >= 56) {
+                                wins = black_loses_against_piece(push, wk, bk, true) ||
+                                       black_loses_against_piece(push, wk, bk, false);
+                            } else {
+                                bool double_push = pawn < 16 && push + 8 != wk && push + 8 != bk;
+                                wins = black_loses[at(push, wk, bk)] ||
+                                       (double_push && black_loses[at(push + 8, wk, bk)]);
+                            }
+                        }
+                        if (wins) {
+                            white_wins[at(pawn, wk, bk)] = true;
+                            changed = true;
+                        }
+                    }
+                    if (!black_loses[at(pawn, wk, bk)]) {
+                        bool has_move = false;
+                        bool all_lose = true;
+                        for (int to : king_moves(bk)) {
+                            if (to == wk || adjacent(to, wk) || pawn_attacks(pawn, to)) {
+                                continue;
+                            }
+                            has_move = true;
+                            all_lose = all_lose && to != pawn && white_wins[at(pawn, wk, to)];
+                        }
+                        if (has_move ? all_lose : pawn_attacks(pawn, bk)) {
+                            black_loses[at(pawn, wk, bk)] = true;
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    std::array<std::vector<std::uint8_t>, 2> values;
+    for (std::size_t i = 0; i < white_wins.size(); ++i) {
+        values[0].push_back(white_wins[i] ? 4 : 2);
+        values[1].push_back(black_loses[i] ? 0 : 2);
+    }
+    return values;
+}
+
+void put_le16(std::vector<std::uint8_t>& out, std::size_t value) {
+    out.push_back(static_cast<std::uint8_t>(value & 0xFF));
+    out.push_back(static_cast<std::uint8_t>((value >> 8) & 0xFF));
+}
+
+void put_le32(std::vector<std::uint8_t>& out, std::size_t value) {
+    put_le16(out, value & 0xFFFF);
+    put_le16(out, (value >> 16) & 0xFFFF);
+}
+
+/** @brief One side's compressed values, in the sections a table file keeps them in. */
+struct PairsTable {
+    std::vector<std::uint8_t> sizes;
+    std::vector<std::uint8_t> sparse_index;
+    std::vector<std::uint8_t> block_lengths;
+    std::vector<std::uint8_t> data;
+};
+
+/**
+ * @brief Compresses @p values the way the Syzygy generator lays them out: leaf symbols, pair
+ *        symbols for runs of the commonest value and for one mixed pair, a canonical Huffman code
+ *        and small blocks, so that lookups cross blocks and walk the sparse index both ways.
+ */
+PairsTable compress_values(const std::vector<std::uint8_t>& values) {
+    constexpr int kBlockBits = 5;
+    constexpr int kSpanBits = 6;
+    constexpr std::size_t kSpan = std::size_t{1} << kSpanBits;
+    struct Symbol {
+        int left;
+        int right;
+        std::size_t length;
+    };
+    std::vector<Symbol> symbols;
+    std::array<std::size_t, 5> frequency{};
+    for (std::uint8_t value : values) {
+        ++frequency[value];
+    }
+    int common = static_cast<int>(std::max_element(frequency.begin(), frequency.end()) - frequency.begin());
+    int second = -1;
+    std::array<int, 5> leaf{-1, -1, -1, -1, -1};
+    for (int value = 0; value < 5; ++value) {
+        if (frequency[static_cast<std::size_t>(value)] == 0) {
+            continue;
+        }
+        leaf[static_cast<std::size_t>(value)] = static_cast<int>(symbols.size());
+        symbols.push_back({value, 0xFFF, 1});
+        if (value != common &&
+            (second < 0 || frequency[static_cast<std::size_t>(value)] > frequency[static_cast<std::size_t>(second)])) {
+            second = value;
+        }
+    }
+    std::vector<int> runs{leaf[static_cast<std::size_t>(common)]};
+    for (std::size_t length = 2; length <= 64; length *= 2) {
+        symbols.push_back({runs.back(), runs.back(), length});
+        runs.push_back(static_cast<int>(symbols.size()) - 1);
+    }
+    int mixed = -1;
+    if (second >= 0) {
+        mixed = static_cast<int>(symbols.size());
+        symbols.push_back({leaf[static_cast<std::size_t>(second)], leaf[static_cast<std::size_t>(common)], 2});
+    }
+
+    std::vector<std::size_t> common_run(values.size() + 1, 0);
+    for (std::size_t i = values.size(); i-- > 0;) {
+        common_run[i] = values[i] == common ? common_run[i + 1] + 1 : 0;
+    }
+    std::vector<int> tokens;
+    for (std::size_t i = 0; i < values.size();) {
+        int token = leaf[values[i]];
+        for (auto run = runs.rbegin(); run != runs.rend(); ++run) {
+            if (symbols[static_cast<std::size_t>(*run)].length <= common_run[i]) {
+                token = *run;
+                break;
+            }
+        }
+        if (mixed >= 0 && values[i] == second && common_run[i + 1] > 0) {
+            token = mixed;
+        }
+        tokens.push_back(token);
+        i += symbols[static_cast<std::size_t>(token)].length;
+    }
+
+    // Huffman code lengths, then canonical numbering: longest codes first, with the lowest values.
+    std::vector<std::size_t> weight(symbols.size(), 0);
+    for (int token : tokens) {
+        ++weight[static_cast<std::size_t>(token)];
+    }
+    if (std::count_if(weight.begin(), weight.end(), [](std::size_t w) { return w > 0; }) < 2) {
+        weight[static_cast<std::size_t>(runs[1])] += 1;  // A code needs two symbols; this one is never used.
+    }
+    std::vector<int> parent;
+    std::vector<std::pair<std::size_t, int>> queue;
+    std::vector<int> node_of(symbols.size(), -1);
+    for (std::size_t sym = 0; sym < symbols.size(); ++sym) {
+        if (weight[sym] > 0) {
+            node_of[sym] = static_cast<int>(parent.size());
+            queue.emplace_back(weight[sym], static_cast<int>(parent.size()));
+            parent.push_back(-1);
+        }
+    }
+    auto heavier = [](const auto& lhs, const auto& rhs) { return lhs > rhs; };
+    std::make_heap(queue.begin(), queue.end(), heavier);
+    while (queue.size() > 1) {
+        std::pop_heap(queue.begin(), queue.end(), heavier);
+        auto first = queue.back();
+        queue.pop_back();
+        std::pop_heap(queue.begin(), queue.end(), heavier);
+        auto next = queue.back();
+        queue.pop_back();
+        int merged = static_cast<int>(parent.size());
+        parent.push_back(-1);
+        parent[static_cast<std::size_t>(first.second)] = merged;
+        parent[static_cast<std::size_t>(next.second)] = merged;
+        queue.emplace_back(first.first + next.first, merged);
+        std::push_heap(queue.begin(), queue.end(), heavier);
+    }
+    std::vector<int> code_length(symbols.size(), 0);
+    std::vector<int> order;
+    for (std::size_t sym = 0; sym < symbols.size(); ++sym) {
+        for (int node = node_of[sym]; node >= 0 && parent[static_cast<std::size_t>(node)] >= 0;
+             node = parent[static_cast<std::size_t>(node)]) {
+            ++code_length[sym];
+        }
+        if (code_length[sym] > 0) {
+            order.push_back(static_cast<int>(sym));
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int lhs, int rhs) {
+        return code_length[static_cast<std::size_t>(lhs)] > code_length[static_cast<std::size_t>(rhs)];
+    });
+    for (std::size_t sym = 0; sym < symbols.size(); ++sym) {
+        if (code_length[sym] == 0) {
+            order.push_back(static_cast<int>(sym));
+        }
+    }
+    std::vector<int> renumbered(symbols.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        renumbered[static_cast<std::size_t>(order[i])] = static_cast<int>(i);
+    }
+    int max_len = code_length[static_cast<std::size_t>(order.front())];
+    int min_len = max_len;
+    for (int sym : order) {
+        if (code_length[static_cast<std::size_t>(sym)] > 0) {
+            min_len = std::min(min_len, code_length[static_cast<std::size_t>(sym)]);
+        }
+    }
+    std::vector<std::uint64_t> base(static_cast<std::size_t>(max_len) + 2, 0);
+    std::vector<std::size_t> count(static_cast<std::size_t>(max_len) + 2, 0);
+    std::vector<std::size_t> lowest(static_cast<std::size_t>(max_len) + 2, 0);
+    for (int sym : order) {
+        ++count[static_cast<std::size_t>(code_length[static_cast<std::size_t>(sym)])];
+    }
+    for (auto len = static_cast<std::size_t>(max_len) - 1; len >= static_cast<std::size_t>(min_len); --len) {
+        base[len] = (base[len + 1] + count[len + 1]) / 2;
+        lowest[len] = lowest[len + 1] + count[len + 1];
+    }
+    std::vector<std::uint64_t> code(symbols.size(), 0);
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        auto len = static_cast<std::size_t>(code_length[static_cast<std::size_t>(order[i])]);
+        if (len > 0) {
+            code[static_cast<std::size_t>(order[i])] = base[len] + (i - lowest[len]);
+        }
+    }
+
+    // Blocks of whole symbols, bits written most significant first.
+    PairsTable table;
+    const std::size_t block_bytes = std::size_t{1} << kBlockBits;
+    std::vector<std::size_t> block_start{0};
+    std::size_t bits = 0;
+    std::size_t block_values = 0;
+    std::size_t value_index = 0;
+    table.data.assign(block_bytes, 0);
+    for (int token : tokens) {
+        auto len = static_cast<std::size_t>(code_length[static_cast<std::size_t>(token)]);
+        std::size_t length = symbols[static_cast<std::size_t>(token)].length;
+        if (bits + len > 8 * block_bytes || block_values + length > 60000) {
+            put_le16(table.block_lengths, block_values - 1);
+            block_start.push_back(value_index);
+            table.data.resize(table.data.size() + block_bytes, 0);
+            bits = 0;
+            block_values = 0;
+        }
+        std::size_t offset = table.data.size() - block_bytes;
+        for (std::size_t bit = 0; bit < len; ++bit) {
+            if ((code[static_cast<std::size_t>(token)] >> (len - 1 - bit)) & 1) {
+                table.data[offset + (bits + bit) / 8] |= static_cast<std::uint8_t>(0x80 >> ((bits + bit) % 8));
+            }
+        }
+        bits += len;
+        block_values += length;
+        value_index += length;
+    }
+    put_le16(table.block_lengths, block_values - 1);
+
+    // Sparse entry k locates value k * span + span / 2, counting on past the last value.
+    for (std::size_t k = 0; k * kSpan < values.size(); ++k) {
+        std::size_t target = k * kSpan + kSpan / 2;
+        std::size_t clamped = std::min(target, values.size() - 1);
+        std::size_t block = static_cast<std::size_t>(
+            std::upper_bound(block_start.begin(), block_start.end(), clamped) - block_start.begin() - 1);
+        put_le32(table.sparse_index, block);
+        put_le16(table.sparse_index, clamped - block_start[block] + (target - clamped));
+    }
+
+    std::vector<std::uint8_t>& sizes = table.sizes;
+    sizes = {0, kBlockBits, kSpanBits, 0};
+    put_le32(sizes, block_start.size());
+    sizes.push_back(static_cast<std::uint8_t>(max_len));
+    sizes.push_back(static_cast<std::uint8_t>(min_len));
+    for (int len = min_len; len <= max_len; ++len) {
+        put_le16(sizes, lowest[static_cast<std::size_t>(len)]);
+    }
+    put_le16(sizes, symbols.size());
+    for (int sym : order) {
+        const Symbol& symbol = symbols[static_cast<std::size_t>(sym)];
+        int left = symbol.right == 0xFFF ? symbol.left : renumbered[static_cast<std::size_t>(symbol.left)];
+        int right = symbol.right == 0xFFF ? 0xFFF : renumbered[static_cast<std::size_t>(symbol.right)];
+        sizes.push_back(static_cast<std::uint8_t>(left & 0xFF));
+        sizes.push_back(static_cast<std::uint8_t>((left >> 8) | ((right & 0xF) << 4)));
+        sizes.push_back(static_cast<std::uint8_t>(right >> 4));
+    }
+    if (symbols.size() & 1) {
+        sizes.push_back(0);
+    }
+    return table;
+}
+
+/** @brief Writes a WDL file from its header (magic up to the piece bytes) and compressed tables. */
+void write_wdl_file(const fs::path& path, std::vector<std::uint8_t> bytes, const std::vector<PairsTable>& tables) {
+    auto pad_to = [&](std::size_t alignment) {
+        bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+    };
+    pad_to(2);
+    for (const PairsTable& table : tables) {
+        bytes.insert(bytes.end(), table.sizes.begin(), table.sizes.end());
+    }
+    for (const PairsTable& table : tables) {
+        bytes.insert(bytes.end(), table.sparse_index.begin(), table.sparse_index.end());
+    }
+    for (const PairsTable& table : tables) {
+        bytes.insert(bytes.end(), table.block_lengths.begin(), table.block_lengths.end());
+    }
+    for (const PairsTable& table : tables) {
+        pad_to(64);
+        bytes.insert(bytes.end(), table.data.begin(), table.data.end());
+    }
+    pad_to(64);
+    bytes.resize(bytes.size() + 16, 0);
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+/** @brief Maps @p square, an index over the squares not in @p taken, back onto the board. */
+int skip_squares(int square, std::vector<int> taken) {
+    std::sort(taken.begin(), taken.end());
+    for (int other : taken) {
+        square += square >= other;
+    }
+    return square;
+}
+
+/**
+ * @brief Squares of three unique pieces at @p index of a pawnless table, written from the
+ *        Syzygy piece encoding: the leading piece in the a1-d1-d4 triangle, then placements
+ *        with the leading pieces on the a1-h8 diagonal.
+ */
+std::array<int, 3> unique_pieces_at(std::size_t index) {
+    constexpr int kTriangle[6] = {1, 2, 3, 10, 11, 19};  // b1 c1 d1 c2 d2 d3.
+    std::vector<int> below;                              // b1 to h7, the squares below the diagonal.
+    for (int square = 0; square < 64; ++square) {
+        if (file_of(square) > rank_of(square)) {
+            below.push_back(square);
+        }
+    }
+    auto diagonal = [](int rank) { return rank * 9; };
+    int i = static_cast<int>(index);
+    if (i < 6 * 63 * 62) {
+        int first = kTriangle[i / (63 * 62)];
+        int second = skip_squares(i / 62 % 63, {first});
+        return {first, second, skip_squares(i % 62, {first, second})};
+    }
+    i -= 6 * 63 * 62;
+    if (i < 4 * 28 * 62) {
+        int first = diagonal(i / (28 * 62));
+        int second = below[static_cast<std::size_t>(i / 62 % 28)];
+        return {first, second, skip_squares(i % 62, {first, second})};
+    }
+    i -= 4 * 28 * 62;
+    if (i < 4 * 7 * 28) {
+        int first_rank = i / (7 * 28);
+        int second_rank = skip_squares(i / 28 % 7, {first_rank});
+        return {diagonal(first_rank), diagonal(second_rank), below[static_cast<std::size_t>(i % 28)]};
+    }
+    i -= 4 * 7 * 28;
+    int first_rank = i / 42;
+    int second_rank = skip_squares(i / 6 % 7, {first_rank});
+    return {diagonal(first_rank), diagonal(second_rank), diagonal(skip_squares(i % 6, {first_rank, second_rank}))};
+}
+
+/** @brief FEN of a pawnless or pawn ending from (square, piece letter) pairs. */
+std::string fen_of(const std::vector<std::pair<int, char>>& pieces, bool white_to_move) {
+    std::array<char, 64> board{};
+    for (const auto& [square, letter] : pieces) {
+        board[static_cast<std::size_t>(square)] = letter;
+    }
+    std::string fen;
+    for (int rank = 7; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file) {
+            char letter = board[static_cast<std::size_t>(rank * 8 + file)];
+            if (letter == 0) {
+                ++empty;
+                continue;
+            }
+            if (empty > 0) {
+                fen += static_cast<char>('0' + empty);
+                empty = 0;
+            }
+            fen += letter;
+        }
+        if (empty > 0) {
+            fen += static_cast<char>('0' + empty);
+        }
+        fen += rank > 0 ? "/" : "";
+    }
+    return fen + (white_to_move ? " w - - 0 1" : " b - - 0 1");
+}
+
+/**
+ * @brief Writes a compressed KRvK WDL table: black to move loses unless stalemated or able to
+ *        take an undefended rook, and white to move always wins. The rook leads the piece order.
+ */
+fs::path write_krvk_table(const std::string& name) {
+    fs::path directory = fs::temp_directory_path() / name;
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    constexpr std::size_t kSize = 31332;  // Placements of three unique pieces without pawns.
+    std::array<std::vector<std::uint8_t>, 2> values;
+    for (std::size_t index = 0; index < kSize; ++index) {
+        auto [rook, white_king, black_king] = unique_pieces_at(index);
+        bool kings_apart = !adjacent(white_king, black_king);
+        values[0].push_back(4);
+        values[1].push_back(kings_apart && !black_loses_against_piece(rook, white_king, black_king, false) ? 2 : 0);
+    }
+    std::vector<std::uint8_t> header = {0x71, 0xE8, 0x23, 0x5D, 0x01, 0x00, 0x44, 0x66, 0xEE};
+    write_wdl_file(directory / "KRvK.rtbw", header, {compress_values(values[0]), compress_values(values[1])});
+    return directory;
+}
+
+/**
+ * @brief Writes a compressed KPvK WDL table from solve_kpvk(), one table per leading pawn file.
+ *        White to move orders the pieces pawn, king, black king and nests the pawn inside the
+ *        king; black to move orders them pawn, black king, king with the pawn innermost.
+ */
+fs::path write_kpvk_table(const std::string& name, const std::array<std::vector<std::uint8_t>, 2>& solved) {
+    fs::path directory = fs::temp_directory_path() / name;
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    constexpr std::size_t kSize = 6 * 63 * 62;
+    auto at = [](int pawn, int white_king, int black_king) {
+        return (static_cast<std::size_t>(pawn) * 64 + static_cast<std::size_t>(white_king)) * 64 +
+               static_cast<std::size_t>(black_king);
+    };
+    std::vector<std::uint8_t> header = {0x71, 0xE8, 0x23, 0x5D, 0x03};
+    std::vector<PairsTable> tables;
+    for (int file = 0; file < 4; ++file) {
+        header.insert(header.end(), {0x01, 0x11, 0xE6, 0x6E});
+        std::array<std::vector<std::uint8_t>, 2> values;
+        for (std::size_t index = 0; index < kSize; ++index) {
+            int i = static_cast<int>(index);
+            int pawn = (i / 63 % 6 + 1) * 8 + file;
+            int white_king = skip_squares(i % 63, {pawn});
+            values[0].push_back(solved[0][at(pawn, white_king, skip_squares(i / 378, {pawn, white_king}))]);
+            pawn = (i % 6 + 1) * 8 + file;
+            int black_king = skip_squares(i / 6 % 63, {pawn});
+            values[1].push_back(solved[1][at(pawn, skip_squares(i / 378, {pawn, black_king}), black_king)]);
+        }
+        tables.push_back(compress_values(values[0]));
+        tables.push_back(compress_values(values[1]));
+    }
+    write_wdl_file(directory / "KPvK.rtbw", header, tables);
+    return directory;
+}
+
+}  // namespace
+
+TEST(Syzygy, LoadsTablesAndProbesWdlForEitherColor) {
+    fs::path directory = write_kqvk_table("chiron-syzygy-wdl");
+    SyzygyTablebases tablebases(directory.string() + ";" + (directory / "missing").string());
+    ASSERT_EQ(tablebases.wdl_table_count(), 1u);
+    EXPECT_EQ(tablebases.dtz_table_count(), 0u);
+    EXPECT_EQ(tablebases.max_pieces(), 3);
+
+    EXPECT_EQ(tablebases.probe_wdl(from_fen("8/8/8/4k3/8/8/8/4KQ2 w - - 0 1")), Wdl::Win);
+    EXPECT_EQ(tablebases.probe_wdl(from_fen("8/8/8/4k3/8/8/8/4KQ2 b - - 0 1")), Wdl::Loss);
+    // Black holds the queen, so the table is probed with the colors swapped.
+    EXPECT_EQ(tablebases.probe_wdl(from_fen("4kq2/8/8/8/8/8/8/4K3 w - - 0 1")), Wdl::Loss);
+    // Capturing the hanging queen leaves bare kings, whatever the table stores.
+    EXPECT_EQ(tablebases.probe_wdl(from_fen("8/8/8/8/8/8/4k3/3Q3K b - - 0 1")), Wdl::Draw);
+    EXPECT_EQ(tablebases.probe_wdl(from_fen("8/8/8/4k3/8/8/8/4KR2 w - - 0 1")), std::nullopt);
+    EXPECT_FALSE(tablebases.may_cover(from_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1")));
+    fs::remove_all(directory);
+}
+
+TEST(Syzygy, CompressedKrvkTableMatchesTheKnownResults) {
+    fs::path directory = write_krvk_table("chiron-syzygy-krvk");
+    SyzygyTablebases tablebases(directory.string());
+    ASSERT_EQ(tablebases.wdl_table_count(), 1u);
+
+    // Every legal placement, and its color-swapped mirror, which is probed with the board flipped.
+    std::size_t probed = 0;
+    std::size_t wrong = 0;
+    for (int rook = 0; rook < 64; ++rook) {
+        for (int white_king = 0; white_king < 64; ++white_king) {
+            for (int black_king = 0; black_king < 64; ++black_king) {
+                if (rook == white_king || rook == black_king || white_king == black_king ||
+                    adjacent(white_king, black_king)) {
+                    continue;
+                }
+                for (bool white_to_move : {true, false}) {
+                    std::uint64_t occupied = (1ULL << rook) | (1ULL << white_king);
+                    if (white_to_move && slider_attacks(rook, black_king, occupied, false)) {
+                        continue;
+                    }
+                    Wdl expected = white_to_move ? Wdl::Win
+                                   : black_loses_against_piece(rook, white_king, black_king, false) ? Wdl::Loss
+                                                                                                   : Wdl::Draw;
+                    Board board = from_fen(fen_of({{rook, 'R'}, {white_king, 'K'}, {black_king, 'k'}}, white_to_move));
+                    Board mirror = from_fen(
+                        fen_of({{rook ^ 56, 'r'}, {white_king ^ 56, 'k'}, {black_king ^ 56, 'K'}}, !white_to_move));
+                    for (const Board& position : {board, mirror}) {
+                        ++probed;
+                        if (tablebases.probe_wdl(position) != expected && ++wrong <= 5) {
+                            ADD_FAILURE() << position.fen();
+                        }
+                    }
+                }
+            }
+        }
+    }
+    EXPECT_GT(probed, 400000u);
+    EXPECT_EQ(wrong, 0u);
+    fs::remove_all(directory);
+}
+
+TEST(Syzygy, CompressedKpvkTableMatchesARetrogradeSolution) {
+    std::array<std::vector<std::uint8_t>, 2> solved = solve_kpvk();
+    auto value = [&](bool white_to_move, int pawn, int white_king, int black_king) {
+        std::size_t at = (static_cast<std::size_t>(pawn) * 64 + static_cast<std::size_t>(white_king)) * 64 +
+                         static_cast<std::size_t>(black_king);
+        return static_cast<Wdl>(solved[white_to_move ? 0 : 1][at] - 2);
+    };
+    // Textbook checks of the solution: the king on the sixth rank ahead of its pawn wins with
+    // either side to move, while with the kings in opposition the side to move decides.
+    EXPECT_EQ(value(true, 36, 44, 60), Wdl::Win);    // Ke6 Pe5 ke8.
+    EXPECT_EQ(value(false, 36, 44, 60), Wdl::Loss);
+    EXPECT_EQ(value(true, 28, 36, 52), Wdl::Draw);   // Ke5 Pe4 ke7.
+    EXPECT_EQ(value(false, 28, 36, 52), Wdl::Loss);
+    EXPECT_EQ(value(true, 32, 40, 57), Wdl::Draw);   // A rook pawn with the king in its corner: Ka6 Pa5 kb8.
+    EXPECT_EQ(value(true, 48, 40, 58), Wdl::Win);    // Ka6 Pa7 kc8: Kb6 drives the king off.
+
+    fs::path directory = write_kpvk_table("chiron-syzygy-kpvk", solved);
+    SyzygyTablebases tablebases(directory.string());
+    ASSERT_EQ(tablebases.wdl_table_count(), 1u);
+    std::size_t probed = 0;
+    std::size_t wrong = 0;
+    for (int pawn = 8; pawn < 56; ++pawn) {
+        for (int white_king = 0; white_king < 64; ++white_king) {
+            for (int black_king = 0; black_king < 64; ++black_king) {
+                if (pawn == white_king || pawn == black_king || white_king == black_king ||
+                    adjacent(white_king, black_king)) {
+                    continue;
+                }
+                for (bool white_to_move : {true, false}) {
+                    if (white_to_move && pawn_attacks(pawn, black_king)) {
+                        continue;
+                    }
+                    Wdl expected = value(white_to_move, pawn, white_king, black_king);
+                    Board board = from_fen(fen_of({{pawn, 'P'}, {white_king, 'K'}, {black_king, 'k'}}, white_to_move));
+                    Board mirror = from_fen(
+                        fen_of({{pawn ^ 56, 'p'}, {white_king ^ 56, 'k'}, {black_king ^ 56, 'K'}}, !white_to_move));
+                    for (const Board& position : {board, mirror}) {
+                        ++probed;
+                        if (tablebases.probe_wdl(position) != expected && ++wrong <= 5) {
+                            ADD_FAILURE() << position.fen();
+                        }
+                    }
+                }
+            }
+        }
+    }
+    EXPECT_GT(probed, 300000u);
+    EXPECT_EQ(wrong, 0u);
+    fs::remove_all(directory);
+}
+
+TEST(Syzygy, RootProbeDropsMovesThatHangTheQueen) {
+    fs::path directory = write_kqvk_table("chiron-syzygy-root");
+    SyzygyTablebases tablebases(directory.string());
+    Board board = from_fen("8/8/8/8/8/4k3/8/3Q3K w - - 0 1");
+    KeyHistory history;
+    history.push(board.zobrist_key());
+
+    auto root = tablebases.probe_root(board, history);
+    ASSERT_TRUE(root.has_value());
+    EXPECT_EQ(root->wdl, Wdl::Win);
+    EXPECT_FALSE(root->used_dtz);
+    std::vector<Move> legal = MoveGenerator::generate_legal_moves(board);
+    EXPECT_FALSE(root->moves.empty());
+    EXPECT_LT(root->moves.size(), legal.size());
+    for (const Move& move : root->moves) {
+        int file_distance = std::abs((move.to & 7) - 4);
+        int rank_distance = std::abs((move.to >> 3) - 2);
+        EXPECT_FALSE(move.from == 3 && std::max(file_distance, rank_distance) <= 1) << move_to_string(move);
+    }
+    fs::remove_all(directory);
+}
+
+TEST(Syzygy, SearchScoresCapturesIntoCoveredPositions) {
+    fs::path directory = write_kqvk_table("chiron-syzygy-search");
+    auto tablebases = std::make_shared<const SyzygyTablebases>(directory.string());
+    // Four pieces are not covered, but taking the rook reaches a won KQvK ending.
+    Board board = from_fen("8/8/8/4k3/8/8/3r4/3QK3 w - - 0 1");
+    Search search(1ULL << 16);
+    search.set_tablebases(tablebases);
+    SearchLimits limits;
+    limits.max_depth = 3;
+    SearchResult result = search.search(board, limits);
+    EXPECT_EQ(result.best_move.to, 11);  // d2
+    EXPECT_GT(result.score, 30000);  // Tablebase wins score just below mates.
+    EXPECT_GT(result.tb_hits, 0u);
+
+    search.set_tablebases(nullptr);
+    search.new_game();
+    EXPECT_EQ(search.search(board, limits).tb_hits, 0u);
+    fs::remove_all(directory);
+}
+
+TEST(Syzygy, SelfPlayAdjudicatesCoveredPositions) {
+    fs::path directory = write_kqvk_table("chiron-syzygy-selfplay");
+    SelfPlayConfig config;
+    config.white.max_depth = 2;
+    config.black.max_depth = 2;
+    config.randomness_temperature = 0.0;
+    config.capture_results = false;
+    config.capture_pgn = false;
+    config.syzygy_path = directory.string();
+    SelfPlayOrchestrator orchestrator(config);
+
+    SelfPlayResult won = orchestrator.play_game(0, config.white, config.black, false, "4k3/8/8/8/8/8/8/3QK3 b - - 0 1");
+    EXPECT_EQ(won.result, "1-0");
+    EXPECT_EQ(won.termination, "tablebase");
+    EXPECT_EQ(won.ply_count, 0);
+
+    // Taking the rook reaches the covered ending, where the game ends at once.
+    SelfPlayResult captured =
+        orchestrator.play_game(0, config.white, config.black, false, "4k3/8/8/8/8/8/3r4/3QK3 w - - 0 1");
+    EXPECT_EQ(captured.result, "1-0");
+    EXPECT_EQ(captured.termination, "tablebase");
+    EXPECT_EQ(captured.ply_count, 1);
+    fs::remove_all(directory);
+}
+
+}  // namespace chiron
@@ -1,9 +1,19 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
+#include "movegen.h"
+#include "movelist.h"
+#include "tools/teacher.h"
+#include "training/data_loader.h"
+#include "training/gpu_backend.h"
 #include "training/pgn_importer.h"
+#include "training/position_filter.h"
 #include "training/trainer.h"
 
 namespace chiron {
@@ -27,6 +37,322 @@ TEST(Training, SaveLoadRoundTrip) {
     EXPECT_EQ(before, after);
 }
 
+TEST(Training, ShardedBatchesMatchSingleThreadedSteps) {
+    const std::vector<std::string> fens = {
+        "8/8/8/4k3/8/8/4P3/4K3 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "4k3/8/8/8/8/8/8/R3K3 w Q - 0 1",
+    };
+    std::vector<TrainingExample> batch;
+    for (int i = 0; i < 64; ++i) {
+        const std::string& fen = fens[static_cast<std::size_t>(i) % fens.size()];
+        batch.push_back({fen, (i % 3 == 0) ? 150 : -40});
+    }
+
+    ParameterSet single;
+    ParameterSet sharded;
+    Trainer single_trainer({0.02, 0.0005, TrainerDevice::kCPU, 1});
+    Trainer sharded_trainer({0.02, 0.0005, TrainerDevice::kCPU, 2});
+    for (int step = 0; step < 3; ++step) {
+        single_trainer.train_batch(batch, single);
+        sharded_trainer.train_batch(batch, sharded);
+    }
+
+    // Shards only change the order floating-point gradients are summed in.
+    for (const std::string& fen : fens) {
+        TrainingExample probe{fen, 0};
+        EXPECT_NEAR(single_trainer.evaluate_example(probe, single), sharded_trainer.evaluate_example(probe, sharded), 2)
+            << fen;
+    }
+}
+
+TEST(Training, BatchedEvaluationMatchesSingleExamples) {
+    const std::vector<std::string> fens = {
+        "8/8/8/4k3/8/8/4P3/4K3 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "4k3/8/8/8/8/8/8/R3K3 w Q - 0 1",
+    };
+    std::vector<TrainingExample> examples;
+    for (int i = 0; i < 96; ++i) {
+        examples.push_back({fens[static_cast<std::size_t>(i) % fens.size()], (i % 2 == 0) ? 120 : -80});
+    }
+    ParameterSet parameters(8, nnue::FeatureSet::HalfKP);
+    Trainer trainer({0.02, 0.0005, TrainerDevice::kCPU, 3});
+    trainer.train_batch(examples, parameters);
+
+    std::vector<int> scores = trainer.evaluate_examples(examples.data(), examples.data() + examples.size(), parameters);
+    FeatureBatch batch;
+    encode_feature_batch(examples.data(), examples.data() + examples.size(), parameters.feature_set(), batch);
+    std::vector<int> batch_scores = trainer.evaluate_batch(batch, parameters);
+    ASSERT_EQ(scores.size(), examples.size());
+    EXPECT_EQ(scores, batch_scores);
+    for (std::size_t i = 0; i < examples.size(); ++i) {
+        EXPECT_EQ(scores[i], trainer.evaluate_example(examples[i], parameters)) << examples[i].fen;
+    }
+}
+
+TEST(Training, PositionFilterDropsEarlyCheckedAndRepeatedPositions) {
+    PositionFilter filter({2, true, 1.0, 64});
+    Board start;
+    start.set_from_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    Board checked;
+    checked.set_from_fen("rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3");
+    Board quiet;
+    quiet.set_from_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+
+    EXPECT_FALSE(filter.accept(start, 1));
+    EXPECT_TRUE(filter.accept(start, 2));
+    EXPECT_FALSE(filter.accept(start, 10));
+    EXPECT_FALSE(filter.accept(checked, 5));
+    EXPECT_TRUE(filter.accept(quiet, 5));
+    EXPECT_FALSE(filter.accept(quiet, 7));
+
+    PositionFilter::Stats stats = filter.stats();
+    EXPECT_EQ(stats.accepted, 2U);
+    EXPECT_EQ(stats.early, 1U);
+    EXPECT_EQ(stats.in_check, 1U);
+    EXPECT_EQ(stats.duplicates, 2U);
+
+    // Half-rate sampling keeps roughly half of the 400 distinct positions two plies in, and
+    // deduplication never sees a repeat among them.
+    PositionFilter sampler({0, false, 0.5, 1024}, 7);
+    MoveList first_moves;
+    MoveGenerator::generate_legal_moves(start, first_moves);
+    for (const Move& first : first_moves) {
+        Board::State first_state;
+        start.make_move(first, first_state);
+        MoveList replies;
+        MoveGenerator::generate_legal_moves(start, replies);
+        for (const Move& reply : replies) {
+            Board::State reply_state;
+            start.make_move(reply, reply_state);
+            sampler.accept(start, 2);
+            start.undo_move(reply, reply_state);
+        }
+        start.undo_move(first, first_state);
+    }
+    PositionFilter::Stats sampled = sampler.stats();
+    EXPECT_EQ(sampled.accepted + sampled.sampled_out, 400U);
+    EXPECT_EQ(sampled.duplicates, 0U);
+    EXPECT_GT(sampled.accepted, 150U);
+    EXPECT_LT(sampled.accepted, 250U);
+}
+
+TEST(Training, GpuBatchesMatchCpuSteps) {
+    if (!gpu::is_available()) {
+        GTEST_SKIP() << "built without CUDA";
+    }
+    const std::vector<std::string> fens = {
+        "8/8/8/4k3/8/8/4P3/4K3 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    };
+    std::vector<TrainingExample> batch;
+    for (int i = 0; i < 48; ++i) {
+        batch.push_back({fens[static_cast<std::size_t>(i) % fens.size()], (i % 2 == 0) ? 120 : -60});
+    }
+
+    ParameterSet cpu;
+    ParameterSet device;
+    Trainer cpu_trainer({0.02, 0.0005, TrainerDevice::kCPU, 1});
+    Trainer gpu_trainer({0.02, 0.0005, TrainerDevice::kGPU, 1});
+    for (int step = 0; step < 3; ++step) {
+        gpu_trainer.train_batch(batch, device);
+        if (gpu::keeps_weights_resident()) {
+            cpu_trainer.train_batch(batch, cpu);
+            continue;
+        }
+        // The per-example kernel applies every example as its own step.
+        for (const TrainingExample& example : batch) {
+            cpu_trainer.train_batch(std::vector<TrainingExample>{example}, cpu);
+        }
+    }
+
+    // Reading the device-trained set pulls any resident weights back to the host.
+    for (const std::string& fen : fens) {
+        TrainingExample probe{fen, 0};
+        EXPECT_NEAR(cpu_trainer.evaluate_example(probe, cpu), cpu_trainer.evaluate_example(probe, device), 4) << fen;
+    }
+}
+
+TEST(Training, LearningRateSchedulesWarmUpAndDecay) {
+    OptimizerConfig config;
+    EXPECT_DOUBLE_EQ(learning_rate_factor(config, 1), 1.0);
+    config.warmup_steps = 4;
+    EXPECT_DOUBLE_EQ(learning_rate_factor(config, 1), 0.25);
+    EXPECT_DOUBLE_EQ(learning_rate_factor(config, 4), 1.0);
+    config.warmup_steps = 0;
+    config.schedule = LearningRateSchedule::kCosine;
+    config.decay_steps = 100;
+    EXPECT_NEAR(learning_rate_factor(config, 50), 0.55, 1e-9);
+    EXPECT_NEAR(learning_rate_factor(config, 100), config.final_rate_fraction, 1e-9);
+    EXPECT_NEAR(learning_rate_factor(config, 500), config.final_rate_fraction, 1e-9);
+    EXPECT_THROW(parse_optimizer_kind("rmsprop"), std::invalid_argument);
+}
+
+TEST(Training, AdamStepsFitABatchAndSaveQuantisedWeights) {
+    const std::vector<std::string> fens = {
+        "8/8/8/4k3/8/8/4P3/4K3 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "4k3/8/8/8/8/8/8/R3K3 w Q - 0 1",
+    };
+    const std::vector<int> targets = {300, -120, 500};
+    std::vector<TrainingExample> batch;
+    for (std::size_t i = 0; i < fens.size(); ++i) {
+        batch.push_back({fens[i], targets[i]});
+    }
+
+    for (OptimizerKind kind : {OptimizerKind::kAdam, OptimizerKind::kAdamW}) {
+        Trainer::Config config{kDefaultAdamLearningRate, 0.0005, TrainerDevice::kCPU, 1};
+        config.optimizer.kind = kind;
+        Trainer trainer(config);
+        ParameterSet parameters;
+        auto error = [&](const ParameterSet& set) {
+            double total = 0.0;
+            for (const TrainingExample& example : batch) {
+                double diff = trainer.evaluate_example(example, set) - example.target_cp;
+                total += diff * diff;
+            }
+            return total;
+        };
+        double before = error(parameters);
+        for (int step = 0; step < 40; ++step) {
+            trainer.train_batch(batch, parameters);
+        }
+        double after = error(parameters);
+        EXPECT_LT(after, before * 0.5) << optimizer_name(kind);
+
+        // The saved network is the quantised master copy the trainer was evaluating.
+        std::filesystem::path path = std::filesystem::temp_directory_path() / "chiron-adam.nnue";
+        parameters.save(path.string());
+        ParameterSet reloaded;
+        reloaded.load(path.string());
+        EXPECT_DOUBLE_EQ(error(reloaded), after) << optimizer_name(kind);
+        std::filesystem::remove(path);
+    }
+}
+
+TEST(Training, DataLoaderShufflesEachEpochIndependentlyOfThreads) {
+    const std::vector<std::string> fens = {
+        "8/8/8/4k3/8/8/4P3/4K3 w - - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "4k3/8/8/8/8/8/8/R3K3 w Q - 0 1",
+    };
+    std::vector<TrainingExample> data;
+    for (int i = 0; i < 100; ++i) {
+        data.push_back({fens[static_cast<std::size_t>(i) % fens.size()], i});
+    }
+
+    auto collect = [&](std::size_t threads, std::size_t shuffle_buffer) {
+        TrainingDataLoader::Config config;
+        config.batch_size = 16;
+        config.shuffle_buffer = shuffle_buffer;
+        config.threads = threads;
+        config.prefetch = 3;
+        config.epochs = 2;
+        config.seed = 11;
+        TrainingDataLoader loader(data, config);
+        EXPECT_EQ(loader.batches_per_epoch(), 7u);
+        std::vector<int> targets;
+        FeatureBatch batch;
+        while (loader.next(batch)) {
+            targets.insert(targets.end(), batch.targets.begin(), batch.targets.end());
+            EXPECT_EQ(batch.sources.size(), batch.size());
+            for (std::size_t i = 0; i < batch.sources.size(); ++i) {
+                EXPECT_EQ(batch.sources[i]->target_cp, batch.targets[i]);
+            }
+        }
+        return targets;
+    };
+
+    std::vector<int> ordered = collect(1, 0);
+    ASSERT_EQ(ordered.size(), 200u);
+    for (std::size_t i = 0; i < ordered.size(); ++i) {
+        EXPECT_EQ(ordered[i], static_cast<int>(i % 100));
+    }
+
+    std::vector<int> shuffled = collect(1, 32);
+    EXPECT_EQ(collect(3, 32), shuffled);
+    EXPECT_NE(shuffled, ordered);
+    for (std::size_t epoch = 0; epoch < 2; ++epoch) {
+        std::vector<int> seen(shuffled.begin() + static_cast<std::ptrdiff_t>(epoch * 100),
+                              shuffled.begin() + static_cast<std::ptrdiff_t>(epoch * 100 + 100));
+        std::sort(seen.begin(), seen.end());
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_EQ(seen[static_cast<std::size_t>(i)], i);
+        }
+    }
+
+    // Pre-decoded batches train exactly like the examples they came from.
+    ParameterSet direct;
+    ParameterSet loaded;
+    Trainer trainer({0.02, 0.0005, TrainerDevice::kCPU, 1});
+    TrainingDataLoader::Config config;
+    config.batch_size = 16;
+    TrainingDataLoader loader(data, config);
+    FeatureBatch batch;
+    for (std::size_t offset = 0; loader.next(batch); offset += 16) {
+        std::size_t end = std::min<std::size_t>(offset + 16, data.size());
+        trainer.train_batch(std::vector<TrainingExample>(data.begin() + static_cast<std::ptrdiff_t>(offset),
+                                                         data.begin() + static_cast<std::ptrdiff_t>(end)),
+                            direct);
+        trainer.train_batch(batch, loaded);
+    }
+    for (const std::string& fen : fens) {
+        TrainingExample probe{fen, 0};
+        EXPECT_EQ(trainer.evaluate_example(probe, direct), trainer.evaluate_example(probe, loaded)) << fen;
+    }
+}
+
+TEST(Training, PackedPositionsRoundTrip) {
+    const std::vector<std::string> fens = {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "rnbqkbnr/pp1ppppp/8/2pP4/8/8/PPP1PPPP/RNBQKBNR w KQkq c6 0 3",
+        "8/8/8/4k3/8/8/4P3/4K3 b - - 17 42",
+    };
+    std::filesystem::path text = std::filesystem::temp_directory_path() / "chiron-packed.txt";
+    std::filesystem::path packed = std::filesystem::temp_directory_path() / "chiron-packed.bin";
+
+    std::vector<TrainingExample> examples;
+    for (std::size_t i = 0; i < fens.size(); ++i) {
+        Board original;
+        original.set_from_fen(fens[i]);
+        PackedPosition record = PackedPosition::from_board(original, 100 * static_cast<int>(i) - 50);
+        Board unpacked;
+        record.to_board(unpacked);
+        EXPECT_EQ(unpacked.fen(), original.fen());
+        EXPECT_EQ(unpacked.zobrist_key(), original.zobrist_key());
+        EXPECT_EQ(unpacked.pawn_key(), original.pawn_key());
+        EXPECT_EQ(unpacked.checkers(), original.checkers());
+        examples.push_back({fens[i], record.score});
+    }
+
+    save_training_file(text.string(), examples);
+    EXPECT_EQ(convert_training_file(text.string(), packed.string(), true), fens.size());
+    ASSERT_TRUE(is_packed_training_file(packed.string()));
+    EXPECT_LT(std::filesystem::file_size(packed), std::filesystem::file_size(text));
+
+    PackedPositionReader reader(packed.string());
+    ASSERT_EQ(reader.size(), fens.size());
+    std::vector<TrainingExample> loaded = load_training_file(packed.string());
+    ASSERT_EQ(loaded.size(), fens.size());
+    for (std::size_t i = 0; i < fens.size(); ++i) {
+        EXPECT_EQ(reader[i].score, examples[i].target_cp);
+        EXPECT_TRUE(loaded[i].packed.has_value());
+        EXPECT_EQ(example_fen(loaded[i]), fens[i]);
+        EXPECT_EQ(loaded[i].target_cp, examples[i].target_cp);
+    }
+
+    Trainer trainer;
+    ParameterSet parameters;
+    EXPECT_EQ(trainer.evaluate_example(loaded[0], parameters), trainer.evaluate_example(examples[0], parameters));
+
+    std::filesystem::remove(text);
+    std::filesystem::remove(packed);
+}
+
 TEST(Training, PgnImporterOrientsTargets) {
     const char* pgn = R"([Event "Test"]
 [Site "Test"]
@@ -55,5 +381,108 @@ TEST(Training, PgnImporterOrientsTargets) {
     EXPECT_EQ(examples[1].target_cp, -1000);
 }
 
-}  // namespace chiron
+TEST(Training, PgnImporterStreamsChunksInFileOrder) {
+    namespace fs = std::filesystem;
+    fs::path pgn = fs::temp_directory_path() / "chiron-import-stream.pgn";
+    fs::path packed = fs::temp_directory_path() / "chiron-import-stream.bin";
+    {
+        std::ofstream out(pgn);
+        ASSERT_TRUE(out.good());
+        for (int game = 0; game < 40; ++game) {
+            const bool white_wins = game % 2 == 0;
+            // Tags after [Result] must not reset it.
+            out << "[Event \"Stream " << game << "\"]\n[Result \"" << (white_wins ? "1-0" : "0-1") << "\"]\n"
+                << "[Termination \"normal\"]\n[PlyCount \"6\"]\n\n";
+            out << "1. e4 {a comment\n[not a tag]} e5 2. Nf3 (2. f4 exf4) Nc6 3. Bb5 a6 " << (white_wins ? "1-0" : "0-1")
+                << "\n\n";
+        }
+    }
 
+    std::vector<TrainingExample> sequential = PgnImporter(1).import_file(pgn.string());
+    ASSERT_EQ(sequential.size(), 40u * 6u);
+    EXPECT_EQ(sequential[0].target_cp, 1000);
+    EXPECT_EQ(sequential[1].target_cp, -1000);
+    EXPECT_EQ(sequential[6].target_cp, -1000);
+    EXPECT_EQ(example_fen(sequential[5]), "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3 3");
+
+    // Tiny chunks spread the games over many workers; output order must not change.
+    PgnImporter parallel(4, 64);
+    std::vector<TrainingExample> streamed = parallel.import_file(pgn.string());
+    ASSERT_EQ(streamed.size(), sequential.size());
+    for (std::size_t i = 0; i < streamed.size(); ++i) {
+        EXPECT_EQ(example_fen(streamed[i]), example_fen(sequential[i]));
+        EXPECT_EQ(streamed[i].target_cp, sequential[i].target_cp);
+    }
+
+    PgnImporter::Stats stats = parallel.write_dataset(pgn.string(), packed.string());
+    EXPECT_EQ(stats.games, 40u);
+    EXPECT_EQ(stats.positions, sequential.size());
+    EXPECT_EQ(load_training_file(packed.string()).size(), sequential.size());
+
+    // Without tags, chunks are cut after the results instead.
+    {
+        std::ofstream out(pgn, std::ios::trunc);
+        for (int game = 0; game < 40; ++game) {
+            out << "1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 " << (game % 2 == 0 ? "1-0" : "0-1") << "\n";
+        }
+    }
+    std::size_t chunk_count = 0;
+    stats = parallel.stream_file(pgn.string(), true, [&](const std::vector<PackedPosition>&) { ++chunk_count; });
+    EXPECT_EQ(stats.positions, sequential.size());
+    EXPECT_GT(stats.chunks, 1u);
+    EXPECT_EQ(chunk_count, stats.chunks);
+    std::vector<TrainingExample> tagless = parallel.import_file(pgn.string());
+    ASSERT_EQ(tagless.size(), sequential.size());
+    for (std::size_t i = 0; i < tagless.size(); ++i) {
+        EXPECT_EQ(example_fen(tagless[i]), example_fen(sequential[i]));
+        EXPECT_EQ(tagless[i].target_cp, sequential[i].target_cp);
+    }
+
+    fs::remove(pgn);
+    fs::remove(packed);
+}
+
+#ifndef _WIN32
+TEST(Teacher, PersistentProcessesAnswerPipelinedPositionsInOrder) {
+    namespace fs = std::filesystem;
+    // A stand-in UCI engine whose score is the length of the position command it received.
+    fs::path script = fs::temp_directory_path() / "chiron-fake-teacher.sh";
+    {
+        std::ofstream stream(script);
+        stream << "#!/bin/sh\n"
+                  "while IFS= read -r line; do\n"
+                  "  case \"$line\" in\n"
+                  "    uci) echo 'id name Fake'; echo uciok ;;\n"
+                  "    isready) echo readyok ;;\n"
+                  "    position*) length=${#line} ;;\n"
+                  "    go*) echo \"info depth 1 score cp $length\"; echo 'bestmove 0000' ;;\n"
+                  "    quit) exit 0 ;;\n"
+                  "  esac\n"
+                  "done\n";
+    }
+    fs::permissions(script, fs::perms::owner_all);
+
+    TeacherConfig config;
+    config.engine_path = script.string();
+    config.depth = 1;
+    config.processes = 2;
+    config.pipeline = 3;
+    TeacherEngine teacher(config);
+
+    std::vector<std::string> fens;
+    std::vector<int> expected;
+    std::string board = "8/8/8/4k3/8/8/4P3/4K3";
+    for (int i = 0; i < 12; ++i) {
+        std::string fen = board + " w - - 0 " + std::to_string(1 + i * 37);
+        fens.push_back(fen);
+        expected.push_back(static_cast<int>(std::string("position fen ").size() + fen.size()));
+    }
+    EXPECT_EQ(teacher.evaluate(fens), expected);
+    // The second batch reuses the running processes.
+    EXPECT_EQ(teacher.evaluate_single(fens[5]), expected[5]);
+
+    fs::remove(script);
+}
+#endif
+
+}  // namespace chiron
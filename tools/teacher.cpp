@@ -1,13 +1,33 @@
 #include "tools/teacher.h"
 
 #include <algorithm>
-#include <cctype>
-#include <cstdio>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
-#include <filesystem>
-#include <fstream>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+
+#include "trace.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
 
 namespace chiron {
 
@@ -15,29 +35,6 @@ namespace {
 
 constexpr int kMateValue = 32000;
 
-std::string build_script(const TeacherConfig& config, const std::vector<std::string>& fens) {
-    std::ostringstream script;
-    script << "uci\n";
-    if (config.threads > 1) {
-        script << "setoption name Threads value " << config.threads << "\n";
-    }
-    script << "isready\n";
-    for (const std::string& fen : fens) {
-        script << "position fen " << fen << "\n";
-        script << "go depth " << config.depth << "\n";
-    }
-    script << "quit\n";
-    return script.str();
-}
-
-std::string quote_path(const std::filesystem::path& path) {
-    std::string str = path.string();
-    if (str.find(' ') != std::string::npos) {
-        return '"' + str + '"';
-    }
-    return str;
-}
-
 int parse_score_from_line(const std::string& line, int current_score, bool& have_score) {
     std::istringstream iss(line);
     std::string token;
@@ -67,55 +64,272 @@ int parse_score_from_line(const std::string& line, int current_score, bool& have
     return current_score;
 }
 
-std::vector<int> parse_output(const std::filesystem::path& output_path, std::size_t expected) {
-    std::ifstream stream(output_path);
-    if (!stream) {
-        throw std::runtime_error("Failed to read teacher engine output from " + output_path.string());
-    }
-    std::vector<int> results;
-    results.reserve(expected);
-    std::string line;
-    int current_score = 0;
-    bool have_score = false;
-    while (std::getline(stream, line)) {
-        if (line.rfind("info", 0) == 0) {
-            current_score = parse_score_from_line(line, current_score, have_score);
-        }
-        if (line.rfind("bestmove", 0) == 0) {
-            results.push_back(have_score ? current_score : 0);
-            current_score = 0;
-            have_score = false;
-            if (results.size() == expected) {
-                break;
+// A stray line break would split the command and desynchronise the conversation.
+std::string sanitize_fen(const std::string& fen) {
+    std::string clean = fen;
+    std::replace(clean.begin(), clean.end(), '\r', ' ');
+    std::replace(clean.begin(), clean.end(), '\n', ' ');
+    std::size_t first = clean.find_first_not_of(' ');
+    std::size_t last = clean.find_last_not_of(' ');
+    return first == std::string::npos ? std::string{} : clean.substr(first, last - first + 1);
+}
+
+}  // namespace
+
+/**
+ * @brief One running UCI engine, spoken to through its standard input and output.
+ */
+class TeacherProcess {
+   public:
+    TeacherProcess(const std::string& path, int threads) {
+        spawn(path);
+        send("uci\n");
+        wait_for("uciok", path);
+        if (threads > 1) {
+            send("setoption name Threads value " + std::to_string(threads) + "\n");
+        }
+        send("isready\n");
+        wait_for("readyok", path);
+    }
+
+    ~TeacherProcess() { shut_down(); }
+
+    TeacherProcess(const TeacherProcess&) = delete;
+    TeacherProcess& operator=(const TeacherProcess&) = delete;
+
+    void send(const std::string& text) {
+        if (!write_raw(text.data(), text.size())) {
+            throw std::runtime_error("Lost connection to teacher engine");
+        }
+    }
+
+    /**
+     * @brief Reads the next output line without its terminator; false once the engine exited.
+     */
+    bool read_line(std::string& line) {
+        while (true) {
+            std::size_t newline = buffer_.find('\n', buffer_pos_);
+            if (newline != std::string::npos) {
+                line.assign(buffer_, buffer_pos_, newline - buffer_pos_);
+                buffer_pos_ = newline + 1;
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                return true;
             }
+            buffer_.erase(0, buffer_pos_);
+            buffer_pos_ = 0;
+            char chunk[4096];
+            std::size_t count = read_raw(chunk, sizeof(chunk));
+            if (count == 0) {
+                return false;
+            }
+            buffer_.append(chunk, count);
         }
     }
-    return results;
-}
 
-std::filesystem::path write_temp_file(const std::string& prefix, const std::string& content) {
-    std::filesystem::path directory = std::filesystem::temp_directory_path();
-    char buffer[L_tmpnam];
-    if (std::tmpnam(buffer) == nullptr) {
-        throw std::runtime_error("Failed to generate temporary file name");
-    }
-    std::string name = prefix + buffer;
-    std::replace(name.begin(), name.end(), '\\', '_');
-    std::replace(name.begin(), name.end(), '/', '_');
-    std::filesystem::path temp = directory / name;
-    std::ofstream stream(temp);
-    if (!stream) {
-        throw std::runtime_error("Failed to open temporary file for writing");
-    }
-    stream << content;
-    return temp;
-}
+   private:
+    void wait_for(const std::string& token, const std::string& path) {
+        std::string line;
+        while (read_line(line)) {
+            if (line == token) {
+                return;
+            }
+        }
+        throw std::runtime_error("Teacher engine " + path + " exited during start-up");
+    }
 
-}  // namespace
+#ifdef _WIN32
+    void spawn(const std::string& path) {
+        SECURITY_ATTRIBUTES attributes{sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+        HANDLE child_stdin = nullptr;
+        HANDLE child_stdout = nullptr;
+        if (!CreatePipe(&from_child_, &child_stdout, &attributes, 0)) {
+            throw std::runtime_error("Failed to create teacher engine pipe");
+        }
+        if (!CreatePipe(&child_stdin, &to_child_, &attributes, 0)) {
+            CloseHandle(from_child_);
+            CloseHandle(child_stdout);
+            throw std::runtime_error("Failed to create teacher engine pipe");
+        }
+        SetHandleInformation(from_child_, HANDLE_FLAG_INHERIT, 0);
+        SetHandleInformation(to_child_, HANDLE_FLAG_INHERIT, 0);
+
+        STARTUPINFOA startup{};
+        startup.cb = sizeof(startup);
+        startup.dwFlags = STARTF_USESTDHANDLES;
+        startup.hStdInput = child_stdin;
+        startup.hStdOutput = child_stdout;
+        startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+        PROCESS_INFORMATION info{};
+        std::string command = '"' + path + '"';
+        BOOL started = CreateProcessA(nullptr, command.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr,
+                                      nullptr, &startup, &info);
+        CloseHandle(child_stdin);
+        CloseHandle(child_stdout);
+        if (!started) {
+            CloseHandle(from_child_);
+            CloseHandle(to_child_);
+            from_child_ = nullptr;
+            to_child_ = nullptr;
+            throw std::runtime_error("Failed to start teacher engine " + path);
+        }
+        CloseHandle(info.hThread);
+        process_ = info.hProcess;
+    }
+
+    bool write_raw(const char* data, std::size_t size) {
+        while (size > 0) {
+            DWORD written = 0;
+            if (!WriteFile(to_child_, data, static_cast<DWORD>(size), &written, nullptr)) {
+                return false;
+            }
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    std::size_t read_raw(char* data, std::size_t size) {
+        DWORD count = 0;
+        if (!ReadFile(from_child_, data, static_cast<DWORD>(size), &count, nullptr)) {
+            return 0;
+        }
+        return count;
+    }
+
+    void shut_down() {
+        if (!process_) {
+            return;
+        }
+        write_raw("quit\n", 5);
+        CloseHandle(to_child_);
+        if (WaitForSingleObject(process_, 2000) != WAIT_OBJECT_0) {
+            TerminateProcess(process_, 1);
+            WaitForSingleObject(process_, INFINITE);
+        }
+        CloseHandle(from_child_);
+        CloseHandle(process_);
+        process_ = nullptr;
+    }
+
+    HANDLE process_ = nullptr;
+    HANDLE to_child_ = nullptr;
+    HANDLE from_child_ = nullptr;
+#else
+    void spawn(const std::string& path) {
+        // A teacher that dies must surface as a failed write, not terminate the trainer.
+        static const bool ignore_sigpipe = [] {
+            std::signal(SIGPIPE, SIG_IGN);
+            return true;
+        }();
+        (void)ignore_sigpipe;
+
+        int stdin_pipe[2];
+        int stdout_pipe[2];
+        if (pipe(stdin_pipe) != 0) {
+            throw std::runtime_error("Failed to create teacher engine pipe");
+        }
+        if (pipe(stdout_pipe) != 0) {
+            close(stdin_pipe[0]);
+            close(stdin_pipe[1]);
+            throw std::runtime_error("Failed to create teacher engine pipe");
+        }
+        // Close-on-exec keeps these ends out of every other child; dup2 clears it on 0 and 1.
+        for (int fd : {stdin_pipe[0], stdin_pipe[1], stdout_pipe[0], stdout_pipe[1]}) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, stdin_pipe[0], STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, stdout_pipe[1], STDOUT_FILENO);
+        std::string program = path;
+        char* argv[] = {program.data(), nullptr};
+        int status = posix_spawnp(&pid_, program.c_str(), &actions, nullptr, argv, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(stdin_pipe[0]);
+        close(stdout_pipe[1]);
+        if (status != 0) {
+            close(stdin_pipe[1]);
+            close(stdout_pipe[0]);
+            pid_ = -1;
+            throw std::runtime_error("Failed to start teacher engine " + path + ": " + std::strerror(status));
+        }
+        to_child_ = stdin_pipe[1];
+        from_child_ = stdout_pipe[0];
+    }
+
+    bool write_raw(const char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t written = write(to_child_, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    std::size_t read_raw(char* data, std::size_t size) {
+        while (true) {
+            ssize_t count = read(from_child_, data, size);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            return count > 0 ? static_cast<std::size_t>(count) : 0;
+        }
+    }
+
+    void shut_down() {
+        if (pid_ < 0) {
+            return;
+        }
+        write_raw("quit\n", 5);
+        close(to_child_);
+        close(from_child_);
+        // Engines exit on quit or on end of input; one that ignores both is killed.
+        int status = 0;
+        for (int attempt = 0; attempt < 200; ++attempt) {
+            if (waitpid(pid_, &status, WNOHANG) == pid_) {
+                pid_ = -1;
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        kill(pid_, SIGKILL);
+        waitpid(pid_, &status, 0);
+        pid_ = -1;
+    }
+
+    pid_t pid_ = -1;
+    int to_child_ = -1;
+    int from_child_ = -1;
+#endif
+
+    std::string buffer_;
+    std::size_t buffer_pos_ = 0;
+};
 
 TeacherEngine::TeacherEngine(TeacherConfig config) : config_(std::move(config)) {}
 
-std::vector<int> TeacherEngine::evaluate(const std::vector<std::string>& fens) const {
+TeacherEngine::~TeacherEngine() = default;
+
+void TeacherEngine::start_processes() {
+    processes_.resize(static_cast<std::size_t>(std::max(1, config_.processes)));
+    for (auto& process : processes_) {
+        if (!process) {
+            process = std::make_unique<TeacherProcess>(config_.engine_path, config_.threads);
+        }
+    }
+}
+
+std::vector<int> TeacherEngine::evaluate(const std::vector<std::string>& fens) {
+    trace::Span span("teacher_evaluate");
     if (config_.engine_path.empty()) {
         throw std::runtime_error("Teacher engine path not configured");
     }
@@ -123,40 +337,87 @@ std::vector<int> TeacherEngine::evaluate(const std::vector<std::string>& fens) c
         return {};
     }
 
-    std::string script_content = build_script(config_, fens);
-    auto script_path = write_temp_file("chiron-teacher", script_content);
-    auto output_path = write_temp_file("chiron-teacher-out", "");
+    std::lock_guard<std::mutex> lock(mutex_);
+    start_processes();
 
-    std::string command;
-#ifdef _WIN32
-    command = "cmd /C \"" + quote_path(config_.engine_path) + " < " + quote_path(script_path) + " > " + quote_path(output_path) + "\"";
-#else
-    command = quote_path(config_.engine_path) + " < " + quote_path(script_path) + " > " + quote_path(output_path);
-#endif
+    const std::size_t pipeline = static_cast<std::size_t>(std::max(1, config_.pipeline));
+    const std::string go_command = "go depth " + std::to_string(config_.depth) + "\n";
+    std::vector<int> scores(fens.size(), 0);
+    std::vector<std::exception_ptr> errors(processes_.size());
+    std::atomic<std::size_t> next_fen{0};
 
-    int result = std::system(command.c_str());
-    if (result != 0) {
-        std::filesystem::remove(script_path);
-        std::filesystem::remove(output_path);
-        throw std::runtime_error("Teacher engine process failed with exit code " + std::to_string(result));
-    }
-
-    std::vector<int> scores = parse_output(output_path, fens.size());
+    // Each process keeps up to `pipeline` positions queued and takes the next unclaimed one
+    // as soon as an answer comes back, so faster engines simply end up labelling more.
+    auto serve = [&](std::size_t index) {
+        TeacherProcess& process = *processes_[index];
+        std::deque<std::size_t> in_flight;
+        bool exhausted = false;
+        int score = 0;
+        bool have_score = false;
+        std::string line;
+        try {
+            while (true) {
+                while (!exhausted && in_flight.size() < pipeline) {
+                    std::size_t job = next_fen.fetch_add(1, std::memory_order_relaxed);
+                    if (job >= fens.size()) {
+                        exhausted = true;
+                        break;
+                    }
+                    process.send("position fen " + sanitize_fen(fens[job]) + "\n" + go_command);
+                    in_flight.push_back(job);
+                }
+                if (in_flight.empty()) {
+                    return;
+                }
+                if (!process.read_line(line)) {
+                    throw std::runtime_error("Teacher engine terminated unexpectedly");
+                }
+                if (line.rfind("info", 0) == 0) {
+                    score = parse_score_from_line(line, score, have_score);
+                } else if (line.rfind("bestmove", 0) == 0) {
+                    scores[in_flight.front()] = have_score ? score : 0;
+                    in_flight.pop_front();
+                    score = 0;
+                    have_score = false;
+                }
+            }
+        } catch (...) {
+            errors[index] = std::current_exception();
+        }
+    };
 
-    std::filesystem::remove(script_path);
-    std::filesystem::remove(output_path);
+    if (processes_.size() == 1) {
+        serve(0);
+    } else {
+        std::vector<std::thread> workers;
+        workers.reserve(processes_.size());
+        for (std::size_t index = 0; index < processes_.size(); ++index) {
+            workers.emplace_back(serve, index);
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
 
-    if (scores.size() != fens.size()) {
-        throw std::runtime_error("Teacher engine returned insufficient evaluations");
+    std::exception_ptr first_error;
+    for (std::size_t index = 0; index < processes_.size(); ++index) {
+        if (errors[index]) {
+            processes_[index].reset();  // Restarted by the next batch.
+            if (!first_error) {
+                first_error = errors[index];
+            }
+        }
+    }
+    if (first_error) {
+        std::rethrow_exception(first_error);
     }
     return scores;
 }
 
-int TeacherEngine::evaluate_single(const std::string& fen) const {
+int TeacherEngine::evaluate_single(const std::string& fen) {
     std::vector<std::string> fens{fen};
     std::vector<int> scores = evaluate(fens);
     return scores.empty() ? 0 : scores.front();
 }
 
 }  // namespace chiron
-
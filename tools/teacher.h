@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -9,21 +11,47 @@ struct TeacherConfig {
     std::string engine_path;
     int depth = 20;
     int threads = 1;
+    int processes = 1;  /**< Long-lived engine processes positions are spread across. */
+    /**
+     * Positions queued on one process before its previous search has answered. UCI engines
+     * that simply read commands in order (Stockfish does) can work back to back without a
+     * round trip; engines whose "position" aborts a running search need the default of 1.
+     */
+    int pipeline = 1;
 };
 
+class TeacherProcess;
+
 /**
- * @brief Offline annotator that queries an external UCI engine for evaluations.
+ * @brief Offline annotator that queries external UCI engines for evaluations.
+ *
+ * The engine processes are started on the first evaluate() and then kept alive, talking
+ * over pipes, so the start-up cost and the teacher's hash table are paid for once rather
+ * than per batch. Positions go to whichever process becomes idle first.
  */
 class TeacherEngine {
    public:
     explicit TeacherEngine(TeacherConfig config);
+    ~TeacherEngine();
+
+    TeacherEngine(const TeacherEngine&) = delete;
+    TeacherEngine& operator=(const TeacherEngine&) = delete;
 
-    std::vector<int> evaluate(const std::vector<std::string>& fens) const;
-    int evaluate_single(const std::string& fen) const;
+    /**
+     * @brief Returns one centipawn score per FEN, in order, from the side to move's view.
+     *
+     * Safe to call from several threads; batches are served one after another. A process
+     * that dies mid-batch fails the batch and is restarted on the next call.
+     */
+    std::vector<int> evaluate(const std::vector<std::string>& fens);
+    int evaluate_single(const std::string& fen);
 
    private:
+    void start_processes();
+
     TeacherConfig config_;
+    std::vector<std::unique_ptr<TeacherProcess>> processes_;
+    std::mutex mutex_;
 };
 
 }  // namespace chiron
-
@@ -8,7 +8,27 @@ struct TimeHeuristicConfig {
     double base_allocation = 0.04;  // Fraction of remaining time to invest each move.
     double increment_bonus = 0.5;   // Additional fraction of increment to invest.
     int min_time_ms = 10;
-    int max_time_ms = 2000;
+    int max_time_ms = 2000;         // Cap on the soft budget; the hard limit may exceed it.
+    double hard_limit_scale = 4.0;  // Hard limit as a multiple of the soft budget ...
+    double max_move_fraction = 0.3; // ... but never more than this fraction of the remaining time.
+};
+
+/**
+ * @brief Thinking time for one move: the search aims for the soft limit, which
+ *        TimeManager::soft_scale() adjusts between iterations, and stops outright at the hard one.
+ */
+struct TimeBudget {
+    int soft_ms = 0;
+    int hard_ms = 0;
+};
+
+/**
+ * @brief What the latest completed iteration says about how settled the search is.
+ */
+struct IterationSignals {
+    double best_move_changes = 0.0;    /**< Best-move changes, halved every iteration so old ones fade. */
+    int score_drop = 0;                /**< Centipawns the score fell since the previous iteration. */
+    double best_move_node_share = 0.0; /**< Fraction of the root's nodes spent below the best move. */
 };
 
 struct TimeTuningReport {
@@ -22,6 +42,18 @@ class TimeManager {
     explicit TimeManager(TimeHeuristicConfig config = {});
 
     int allocate_time_ms(int remaining_ms, int increment_ms, int move_number, int moves_to_go) const;
+
+    /**
+     * @brief Soft and hard limits for a move; the soft limit is allocate_time_ms().
+     */
+    [[nodiscard]] TimeBudget allocate(int remaining_ms, int increment_ms, int move_number, int moves_to_go) const;
+
+    /**
+     * @brief Factor applied to the soft limit after an iteration: a changing best move or a
+     *        falling score asks for more time, a best move that absorbs nearly all nodes for less.
+     */
+    [[nodiscard]] double soft_scale(const IterationSignals& signals) const;
+
     TimeTuningReport analyse_results_log(const std::string& path) const;
 
    private:
@@ -3,10 +3,17 @@
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <exception>
 #include <iomanip>
 #include <ios>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#include "training/results_log.h"
 
 namespace chiron {
 
@@ -20,44 +27,68 @@ SelfPlayConfig prepare_config(SelfPlayConfig config) {
     config.games = 1;
     config.capture_results = false;
     config.capture_pgn = false;
+    config.record_moves = false;
     return config;
 }
 
 constexpr double kEpsilon = 1e-9;
+// One pseudo-pair spread like two independent even games, so a handful of identical pair
+// scores cannot collapse the variance; its weight fades as real pairs accumulate.
+constexpr std::array<double, 5> kPriorPair = {1.0 / 16.0, 4.0 / 16.0, 6.0 / 16.0, 4.0 / 16.0, 1.0 / 16.0};
+
+double candidate_score_of(const SelfPlayResult& result, bool candidate_is_white) {
+    if (result.result == "1-0") {
+        return candidate_is_white ? 1.0 : 0.0;
+    }
+    if (result.result == "0-1") {
+        return candidate_is_white ? 0.0 : 1.0;
+    }
+    return 0.5;
+}
 
 }  // namespace
 
+double pentanomial_llr(const std::array<int, 5>& pairs, double elo0, double elo1) {
+    double total = 0.0;
+    for (int count : pairs) {
+        total += count;
+    }
+    if (total <= 0.0) {
+        return 0.0;
+    }
+
+    std::array<double, 5> frequencies{};
+    double mean = 0.0;
+    for (std::size_t i = 0; i < frequencies.size(); ++i) {
+        frequencies[i] = (static_cast<double>(pairs[i]) + kPriorPair[i]) / (total + 1.0);
+        mean += frequencies[i] * (static_cast<double>(i) / 4.0);
+    }
+    double variance = 0.0;
+    for (std::size_t i = 0; i < frequencies.size(); ++i) {
+        double deviation = static_cast<double>(i) / 4.0 - mean;
+        variance += frequencies[i] * deviation * deviation;
+    }
+
+    // Normal approximation of the likelihood ratio of the mean pair score (per game, in [0, 1]).
+    double score0 = logistic(elo0);
+    double score1 = logistic(elo1);
+    return total * (score1 - score0) * (2.0 * mean - score0 - score1) / (2.0 * std::max(variance, kEpsilon));
+}
+
 SprtTester::SprtTester(SelfPlayConfig base_config, EngineConfig baseline, EngineConfig candidate, SprtConfig sprt_config)
     : base_config_(prepare_config(std::move(base_config))),
       baseline_(std::move(baseline)),
       candidate_(std::move(candidate)),
       sprt_(std::move(sprt_config)),
-      orchestrator_(std::make_unique<SelfPlayOrchestrator>(base_config_)) {
-    double p0 = logistic(sprt_.elo0);
-    double p1 = logistic(sprt_.elo1);
-    double non_draw = std::max(1.0 - sprt_.draw_ratio, kEpsilon);
-    win_prob_h0_ = std::max(p0 * non_draw, kEpsilon);
-    loss_prob_h0_ = std::max((1.0 - p0) * non_draw, kEpsilon);
-    win_prob_h1_ = std::max(p1 * non_draw, kEpsilon);
-    loss_prob_h1_ = std::max((1.0 - p1) * non_draw, kEpsilon);
-}
+      orchestrator_(std::make_unique<SelfPlayOrchestrator>(base_config_)) {}
 
 SprtTester::~SprtTester() = default;
 
-double SprtTester::likelihood_increment(double candidate_score) const {
-    if (candidate_score >= 1.0 - kEpsilon) {
-        return std::log(win_prob_h1_ / win_prob_h0_);
-    }
-    if (candidate_score <= kEpsilon) {
-        return std::log(loss_prob_h1_ / loss_prob_h0_);
-    }
-    return 0.0;  // Draws do not change the ratio in this simplified model.
-}
-
-void SprtTester::log_game(int game_index, const SelfPlayResult& result, double candidate_score,
+void SprtTester::log_game(const GameAssignment& game, const SelfPlayResult& result, double candidate_score,
                           std::ofstream& stream) const {
     stream << '{';
-    stream << "\"game\":" << (game_index + 1) << ',';
+    stream << "\"game\":" << (game.game_index + 1) << ',';
+    stream << "\"pair\":" << (game.pair_index + 1) << ',';
     stream << "\"result\":\"" << result.result << "\",";
     stream << "\"termination\":\"" << result.termination << "\",";
     stream << "\"ply_count\":" << result.ply_count << ',';
@@ -77,43 +108,103 @@ SprtSummary SprtTester::run() {
 
     SprtSummary summary;
 
-    for (int game = 0; game < sprt_.max_games; ++game) {
-        bool candidate_is_white = (game % 2 == 0);
-        EngineConfig white = candidate_is_white ? candidate_ : baseline_;
-        EngineConfig black = candidate_is_white ? baseline_ : candidate_;
-
-        SelfPlayResult result = orchestrator_->play_game(game, white, black, false);
-
-        double candidate_score = 0.5;
-        if (result.result == "1-0") {
-            candidate_score = candidate_is_white ? 1.0 : 0.0;
-        } else if (result.result == "0-1") {
-            candidate_score = candidate_is_white ? 0.0 : 1.0;
-        }
-
-        if (candidate_score >= 1.0 - kEpsilon) {
-            ++candidate_wins_;
-        } else if (candidate_score <= kEpsilon) {
-            ++baseline_wins_;
-        } else {
-            ++draws_;
+    // Both games of a pair start from the same opening with colours swapped; the ratio is only
+    // updated once a pair is complete. Workers finish games in any order, so results are applied
+    // and logged strictly by game index, and the test stops at the first prefix that crosses a
+    // bound; games past it are cancelled or discarded.
+    int pairs = (sprt_.max_games + 1) / 2;
+    GamePairScheduler scheduler(pairs * 2, true, orchestrator_->openings());
+    std::mutex mutex;
+    std::map<int, std::pair<GameAssignment, SelfPlayResult>> finished;
+    int next_to_apply = 0;
+    int pair_score = 0;  // Half points of the pair being applied.
+    bool decided = false;
+    std::exception_ptr failure;
+
+    auto apply_in_order = [&]() {
+        for (auto it = finished.find(next_to_apply); it != finished.end() && !decided;
+             it = finished.find(next_to_apply)) {
+            const auto& [game, result] = it->second;
+            double candidate_score = candidate_score_of(result, !game.swap_colors);
+            if (candidate_score >= 1.0 - kEpsilon) {
+                ++candidate_wins_;
+            } else if (candidate_score <= kEpsilon) {
+                ++baseline_wins_;
+            } else {
+                ++draws_;
+            }
+            pair_score += static_cast<int>(std::lround(candidate_score * 2.0));
+            ++games_played_;
+
+            if (game.game_index % 2 == 1) {
+                ++pentanomial_[static_cast<std::size_t>(pair_score)];
+                pair_score = 0;
+                llr_ = pentanomial_llr(pentanomial_, sprt_.elo0, sprt_.elo1);
+                if (llr_ >= upper_bound) {
+                    summary.conclusion = "accept_h1";
+                    decided = true;
+                } else if (llr_ <= lower_bound) {
+                    summary.conclusion = "accept_h0";
+                    decided = true;
+                }
+            }
+            if (log_stream) {
+                log_game(game, result, candidate_score, log_stream);
+            }
+            finished.erase(it);
+            ++next_to_apply;
         }
-
-        ++games_played_;
-        llr_ += likelihood_increment(candidate_score);
-
-        if (log_stream) {
-            log_game(game, result, candidate_score, log_stream);
-        }
-
-        if (llr_ >= upper_bound) {
-            summary.conclusion = "accept_h1";
-            break;
+        if (decided) {
+            orchestrator_->cancel_games();
         }
-        if (llr_ <= lower_bound) {
-            summary.conclusion = "accept_h0";
-            break;
+    };
+
+    auto worker = [&]() {
+        SelfPlayEnginePool engines;
+        try {
+            while (std::optional<GameAssignment> game = scheduler.next()) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (decided || failure) {
+                        return;
+                    }
+                }
+                bool candidate_is_white = !game->swap_colors;
+                const EngineConfig& white = candidate_is_white ? candidate_ : baseline_;
+                const EngineConfig& black = candidate_is_white ? baseline_ : candidate_;
+                SelfPlayResult result =
+                    orchestrator_->play_game(game->game_index, white, black, false, engines, game->start_fen);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (result.termination == "cancelled") {
+                    return;
+                }
+                finished.emplace(game->game_index, std::make_pair(*game, std::move(result)));
+                apply_in_order();
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+            orchestrator_->cancel_games();
         }
+    };
+
+    // The calling thread is one of the workers.
+    std::vector<std::thread> helpers;
+    int concurrency = std::max(1, sprt_.concurrency);
+    helpers.reserve(static_cast<std::size_t>(concurrency - 1));
+    for (int i = 1; i < concurrency; ++i) {
+        helpers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+    orchestrator_->resume_games();
+    if (failure) {
+        std::rethrow_exception(failure);
     }
 
     if (summary.conclusion.empty()) {
@@ -125,6 +216,7 @@ SprtSummary SprtTester::run() {
     summary.candidate_wins = candidate_wins_;
     summary.baseline_wins = baseline_wins_;
     summary.draws = draws_;
+    summary.pentanomial = pentanomial_;
 
     double wins = static_cast<double>(candidate_wins_) + 0.5 * static_cast<double>(draws_);
     double losses = static_cast<double>(baseline_wins_) + 0.5 * static_cast<double>(draws_);
@@ -174,6 +266,26 @@ int TimeManager::allocate_time_ms(int remaining_ms, int increment_ms, int move_n
     return static_cast<int>(allocation);
 }
 
+TimeBudget TimeManager::allocate(int remaining_ms, int increment_ms, int move_number, int moves_to_go) const {
+    TimeBudget budget;
+    budget.soft_ms = allocate_time_ms(remaining_ms, increment_ms, move_number, moves_to_go);
+    double hard = static_cast<double>(budget.soft_ms) * config_.hard_limit_scale;
+    if (remaining_ms > 0) {
+        hard = std::min(hard, static_cast<double>(remaining_ms) * config_.max_move_fraction);
+    }
+    budget.hard_ms = std::max(budget.soft_ms, static_cast<int>(hard));
+    return budget;
+}
+
+double TimeManager::soft_scale(const IterationSignals& signals) const {
+    // Each term is 1.0 for a typical iteration; their product stretches or shrinks the soft limit.
+    double instability = 1.0 + 0.4 * std::min(signals.best_move_changes, 3.0);
+    double falling_score = std::clamp(1.0 + 0.005 * static_cast<double>(signals.score_drop), 0.85, 1.5);
+    // Principal variation search spends about two thirds of the root's nodes on the first move.
+    double effort = std::clamp(2.0 - 1.5 * signals.best_move_node_share, 0.6, 1.4);
+    return std::clamp(instability * falling_score * effort, 0.4, config_.hard_limit_scale);
+}
+
 TimeTuningReport TimeManager::analyse_results_log(const std::string& path) const {
     TimeTuningReport report;
     std::ifstream stream(path);
@@ -183,16 +295,8 @@ TimeTuningReport TimeManager::analyse_results_log(const std::string& path) const
 
     long long total_ply = 0;
     std::string line;
-    const std::string key = "\"ply_count\":";
     while (std::getline(stream, line)) {
-        auto pos = line.find(key);
-        if (pos == std::string::npos) {
-            continue;
-        }
-        pos += key.size();
-        std::istringstream iss(line.substr(pos));
-        int ply = 0;
-        iss >> ply;
+        long long ply = results_log::read_int_field(line, "ply_count").value_or(0);
         if (ply > 0) {
             total_ply += ply;
             ++report.games_evaluated;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <fstream>
 #include <memory>
 #include <optional>
@@ -15,8 +16,8 @@ struct SprtConfig {
     double beta = 0.05;
     double elo0 = 0.0;
     double elo1 = 10.0;
-    double draw_ratio = 0.5;
-    int max_games = 200;
+    int max_games = 200; /**< Rounded up to whole game pairs. */
+    int concurrency = 1; /**< Games played at once; each engine still uses its own search threads. */
     std::string results_path = "sprt_results.jsonl";
 };
 
@@ -27,10 +28,27 @@ struct SprtSummary {
     int candidate_wins = 0;
     int baseline_wins = 0;
     int draws = 0;
+    std::array<int, 5> pentanomial{}; /**< Pairs by candidate score: 0, 0.5, 1, 1.5 and 2 points. */
     std::optional<double> elo;
     std::optional<double> elo_confidence;
 };
 
+/**
+ * @brief Generalised SPRT log-likelihood ratio of @p pairs, the pentanomial counts of
+ *        colour-swapped game pairs, for logistic Elo @p elo1 against @p elo0.
+ *
+ * Scoring whole pairs cancels the bias of the shared opening and the variance of colour, so
+ * the ratio moves faster than one built from independent games. The frequencies include one
+ * prior pseudo-pair so the variance is sensible from the first pair.
+ */
+double pentanomial_llr(const std::array<int, 5>& pairs, double elo0, double elo1);
+
+/**
+ * @brief Plays a baseline against a candidate in colour-swapped pairs until the SPRT decides.
+ *
+ * Games run on SprtConfig::concurrency workers sharing one ratio; once it crosses a bound the
+ * games still in flight are cancelled.
+ */
 class SprtTester {
    public:
     SprtTester(SelfPlayConfig base_config, EngineConfig baseline, EngineConfig candidate, SprtConfig sprt_config);
@@ -39,8 +57,8 @@ class SprtTester {
     SprtSummary run();
 
    private:
-    double likelihood_increment(double candidate_score) const;
-    void log_game(int game_index, const SelfPlayResult& result, double candidate_score, std::ofstream& stream) const;
+    void log_game(const GameAssignment& game, const SelfPlayResult& result, double candidate_score,
+                  std::ofstream& stream) const;
 
     SelfPlayConfig base_config_;
     EngineConfig baseline_;
@@ -53,10 +71,7 @@ class SprtTester {
     int candidate_wins_ = 0;
     int baseline_wins_ = 0;
     int draws_ = 0;
-    double win_prob_h0_ = 0.0;
-    double win_prob_h1_ = 0.0;
-    double loss_prob_h0_ = 0.0;
-    double loss_prob_h1_ = 0.0;
+    std::array<int, 5> pentanomial_{};
 };
 
 }  // namespace chiron
@@ -0,0 +1,129 @@
+#include "training/data_loader.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "board.h"
+
+namespace chiron {
+
+TrainingDataLoader::TrainingDataLoader(const std::vector<TrainingExample>& data, Config config)
+    : data_(data), config_(config), rng_(config.seed) {
+    config_.batch_size = std::max<std::size_t>(config_.batch_size, 1);
+    config_.prefetch = std::max<std::size_t>(config_.prefetch, 1);
+    std::size_t threads =
+        config_.threads != 0 ? config_.threads : std::max(1U, std::thread::hardware_concurrency());
+    batches_per_epoch_ = (data_.size() + config_.batch_size - 1) / config_.batch_size;
+    total_batches_ = batches_per_epoch_ * config_.epochs;
+
+    threads = std::min(threads, std::min(total_batches_, config_.prefetch));
+    workers_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back(&TrainingDataLoader::worker, this);
+    }
+}
+
+TrainingDataLoader::~TrainingDataLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    space_cv_.notify_all();
+    for (std::thread& thread : workers_) {
+        thread.join();
+    }
+}
+
+void TrainingDataLoader::start_epoch() {
+    next_example_ = 0;
+    epoch_remaining_ = data_.size();
+    window_.clear();
+    std::size_t window = std::min(config_.shuffle_buffer, data_.size());
+    while (window_.size() < window) {
+        window_.push_back(next_example_++);
+    }
+}
+
+void TrainingDataLoader::draw_batch(std::vector<std::size_t>& indices) {
+    if (epoch_remaining_ == 0) {
+        start_epoch();
+    }
+    std::size_t count = std::min(config_.batch_size, epoch_remaining_);
+    epoch_remaining_ -= count;
+    indices.clear();
+    for (std::size_t i = 0; i < count; ++i) {
+        if (window_.empty()) {
+            indices.push_back(next_example_++);
+            continue;
+        }
+        std::size_t slot = std::uniform_int_distribution<std::size_t>(0, window_.size() - 1)(rng_);
+        indices.push_back(window_[slot]);
+        if (next_example_ < data_.size()) {
+            window_[slot] = next_example_++;
+        } else {
+            window_[slot] = window_.back();
+            window_.pop_back();
+        }
+    }
+}
+
+void TrainingDataLoader::worker() {
+    std::vector<std::size_t> indices;
+    Board board;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        space_cv_.wait(lock, [&]() {
+            return stopping_ || failure_ || claimed_ == total_batches_ || claimed_ - delivered_ < config_.prefetch;
+        });
+        if (stopping_ || failure_ || claimed_ == total_batches_) {
+            return;
+        }
+        std::size_t index = claimed_++;
+        draw_batch(indices);
+        FeatureBatch batch;
+        if (!spare_.empty()) {
+            batch = std::move(spare_.back());
+            spare_.pop_back();
+        }
+        lock.unlock();
+
+        try {
+            batch.clear(config_.features);
+            for (std::size_t example : indices) {
+                load_example_position(data_[example], board);
+                batch.append(board, data_[example].target_cp);
+                batch.sources.push_back(&data_[example]);
+            }
+        } catch (...) {
+            lock.lock();
+            failure_ = std::current_exception();
+            ready_cv_.notify_all();
+            space_cv_.notify_all();
+            return;
+        }
+
+        lock.lock();
+        ready_.emplace(index, std::move(batch));
+        ready_cv_.notify_all();
+    }
+}
+
+bool TrainingDataLoader::next(FeatureBatch& batch) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (delivered_ == total_batches_) {
+        return false;
+    }
+    ready_cv_.wait(lock, [&]() { return failure_ || ready_.count(delivered_) != 0; });
+    if (failure_) {
+        std::rethrow_exception(failure_);
+    }
+    auto it = ready_.find(delivered_);
+    std::swap(batch, it->second);
+    spare_.push_back(std::move(it->second));
+    ready_.erase(it);
+    ++delivered_;
+    space_cv_.notify_all();
+    return true;
+}
+
+}  // namespace chiron
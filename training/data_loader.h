@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "training/trainer.h"
+
+namespace chiron {
+
+/**
+ * @brief Streams shuffled, pre-decoded training batches from an in-memory dataset.
+ *
+ * Background threads draw examples through a shuffle buffer, decode them into FeatureBatch
+ * form and keep up to Config::prefetch batches ready, so the trainer only ever swaps in a
+ * finished batch. The batch sequence depends only on the data and the seed, never on the
+ * thread count. The dataset must outlive the loader.
+ */
+class TrainingDataLoader {
+   public:
+    struct Config {
+        std::size_t batch_size = 256;
+        /**
+         * Examples held in the shuffle window: each pick is a random slot, refilled from the next
+         * example in file order. 0 keeps file order; the dataset size gives a full shuffle.
+         */
+        std::size_t shuffle_buffer = 0;
+        std::size_t threads = 1;  /**< Decoding threads (0 = all cores); at most prefetch are used. */
+        std::size_t prefetch = 2; /**< Batches decoded ahead of the trainer (2 = double buffering). */
+        std::size_t epochs = 1;   /**< Passes over the data; each is reshuffled. */
+        std::uint64_t seed = 0;
+        nnue::FeatureSet features = nnue::FeatureSet::PieceSquare;
+    };
+
+    TrainingDataLoader(const std::vector<TrainingExample>& data, Config config);
+    ~TrainingDataLoader();
+
+    TrainingDataLoader(const TrainingDataLoader&) = delete;
+    TrainingDataLoader& operator=(const TrainingDataLoader&) = delete;
+
+    /**
+     * @brief Swaps the next batch into @p batch (whose old buffers are reused); false once every
+     *        epoch has been delivered. Rethrows any decoding failure.
+     */
+    bool next(FeatureBatch& batch);
+
+    [[nodiscard]] std::size_t batches_per_epoch() const { return batches_per_epoch_; }
+    [[nodiscard]] std::size_t total_batches() const { return total_batches_; }
+
+   private:
+    void worker();
+    /** @brief Draws the examples of the next batch, in order; called with the lock held. */
+    void draw_batch(std::vector<std::size_t>& indices);
+    void start_epoch();
+
+    const std::vector<TrainingExample>& data_;
+    Config config_;
+    std::size_t batches_per_epoch_ = 0;
+    std::size_t total_batches_ = 0;
+
+    std::mutex mutex_;
+    std::condition_variable ready_cv_;
+    std::condition_variable space_cv_;
+    std::map<std::size_t, FeatureBatch> ready_;
+    std::vector<FeatureBatch> spare_;
+    std::size_t claimed_ = 0;
+    std::size_t delivered_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr failure_;
+
+    // Shuffle state, advanced only under the lock by whichever worker claims the next batch.
+    std::mt19937_64 rng_;
+    std::vector<std::size_t> window_;
+    std::size_t next_example_ = 0;
+    std::size_t epoch_remaining_ = 0;
+
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace chiron
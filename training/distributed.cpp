@@ -0,0 +1,884 @@
+#include "training/distributed.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace chiron {
+
+namespace {
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+constexpr int kSendFlags = 0;
+void close_handle(SocketHandle handle) { closesocket(handle); }
+void shutdown_handle(SocketHandle handle) { ::shutdown(handle, SD_BOTH); }
+bool receive_timed_out() { return WSAGetLastError() == WSAETIMEDOUT; }
+void set_receive_timeout(SocketHandle handle, std::chrono::seconds timeout) {
+    DWORD milliseconds = static_cast<DWORD>(timeout.count() * 1000);
+    setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&milliseconds), sizeof(milliseconds));
+}
+#else
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocket = -1;
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;  // A vanished peer must fail the send, not raise SIGPIPE.
+#else
+constexpr int kSendFlags = 0;
+#endif
+void close_handle(SocketHandle handle) { ::close(handle); }
+void shutdown_handle(SocketHandle handle) { ::shutdown(handle, SHUT_RDWR); }
+bool receive_timed_out() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+void set_receive_timeout(SocketHandle handle, std::chrono::seconds timeout) {
+    timeval wait{};
+    wait.tv_sec = static_cast<decltype(wait.tv_sec)>(timeout.count());
+    setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+}
+#endif
+
+void init_sockets() {
+#ifdef _WIN32
+    static const bool started = []() {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+            throw std::runtime_error("Failed to initialise Winsock");
+        }
+        return true;
+    }();
+    (void)started;
+#endif
+}
+
+constexpr const char* kProtocolName = "chiron-selfplay";
+constexpr std::uint32_t kProtocolVersion = 5;
+constexpr std::uint32_t kMaxMessageBytes = 1U << 28;
+constexpr auto kWaitRetry = std::chrono::milliseconds(250);
+
+/**
+ * @brief Message kinds; every message is framed as [u32 payload length][u8 kind][payload].
+ *
+ * A worker opens with kHello and receives kSession, then repeats kRequest, answered by kAssign,
+ * kWait (all remaining games are in flight elsewhere) or kDone, and sends kResult for each
+ * assignment. kNetworkRequest fetches the bytes behind a network hash as kNetwork, or kNetworkGone
+ * once the coordinator no longer holds it; the worker then requests the game again, and the new
+ * kAssign names the networks in use now.
+ */
+enum class MessageType : std::uint8_t {
+    kHello = 1,
+    kSession,
+    kRequest,
+    kAssign,
+    kWait,
+    kDone,
+    kResult,
+    kNetworkRequest,
+    kNetwork,
+    kNetworkGone,
+};
+
+class Socket {
+   public:
+    Socket() = default;
+    explicit Socket(SocketHandle handle) : handle_(handle) {}
+    ~Socket() { reset(); }
+
+    Socket(Socket&& other) noexcept : handle_(std::exchange(other.handle_, kInvalidSocket)) {}
+    Socket& operator=(Socket&& other) noexcept {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, kInvalidSocket);
+        }
+        return *this;
+    }
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+    [[nodiscard]] SocketHandle handle() const { return handle_; }
+    [[nodiscard]] bool valid() const { return handle_ != kInvalidSocket; }
+
+    void reset() {
+        if (valid()) {
+            close_handle(handle_);
+            handle_ = kInvalidSocket;
+        }
+    }
+
+    void send_all(const char* data, std::size_t size) {
+        while (size > 0) {
+            int chunk = static_cast<int>(std::min<std::size_t>(size, 1U << 20));
+            auto sent = ::send(handle_, data, chunk, kSendFlags);
+            if (sent <= 0) {
+                throw std::runtime_error("Connection lost while sending");
+            }
+            data += sent;
+            size -= static_cast<std::size_t>(sent);
+        }
+    }
+
+    /** @brief Fills @p data; false if the peer closed the connection before the first byte. */
+    bool receive_all(char* data, std::size_t size) {
+        std::size_t received = 0;
+        while (received < size) {
+            int chunk = static_cast<int>(std::min<std::size_t>(size - received, 1U << 20));
+            auto count = ::recv(handle_, data + received, chunk, 0);
+            if (count <= 0) {
+                if (received == 0 && count == 0) {
+                    return false;
+                }
+                if (count < 0 && receive_timed_out()) {
+                    throw std::runtime_error("Timed out while receiving");
+                }
+                throw std::runtime_error("Connection lost while receiving");
+            }
+            received += static_cast<std::size_t>(count);
+        }
+        return true;
+    }
+
+   private:
+    SocketHandle handle_ = kInvalidSocket;
+};
+
+class RecordWriter {
+   public:
+    void u8(std::uint8_t value) { bytes_.push_back(static_cast<char>(value)); }
+    void u32(std::uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            u8(static_cast<std::uint8_t>(value >> shift));
+        }
+    }
+    void u64(std::uint64_t value) {
+        for (int shift = 0; shift < 64; shift += 8) {
+            u8(static_cast<std::uint8_t>(value >> shift));
+        }
+    }
+    void i32(int value) { u32(static_cast<std::uint32_t>(value)); }
+    void f64(double value) { u64(std::bit_cast<std::uint64_t>(value)); }
+    void str(const std::string& value) {
+        u32(static_cast<std::uint32_t>(value.size()));
+        bytes_ += value;
+    }
+    void strings(const std::vector<std::string>& values) {
+        u32(static_cast<std::uint32_t>(values.size()));
+        for (const std::string& value : values) {
+            str(value);
+        }
+    }
+    void moves(const std::vector<PackedMove>& values) {
+        u32(static_cast<std::uint32_t>(values.size()));
+        for (PackedMove value : values) {
+            u8(static_cast<std::uint8_t>(value.value));
+            u8(static_cast<std::uint8_t>(value.value >> 8));
+        }
+    }
+
+    [[nodiscard]] std::string take() { return std::move(bytes_); }
+
+   private:
+    std::string bytes_;
+};
+
+class RecordReader {
+   public:
+    explicit RecordReader(const std::string& bytes) : bytes_(bytes) {}
+
+    std::uint8_t u8() {
+        require(1);
+        return static_cast<std::uint8_t>(bytes_[position_++]);
+    }
+    std::uint32_t u32() {
+        std::uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+            value |= static_cast<std::uint32_t>(u8()) << shift;
+        }
+        return value;
+    }
+    std::uint64_t u64() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 8) {
+            value |= static_cast<std::uint64_t>(u8()) << shift;
+        }
+        return value;
+    }
+    int i32() { return static_cast<int>(u32()); }
+    double f64() { return std::bit_cast<double>(u64()); }
+    std::string str() {
+        std::uint32_t size = u32();
+        require(size);
+        std::string value = bytes_.substr(position_, size);
+        position_ += size;
+        return value;
+    }
+    std::vector<std::string> strings() {
+        std::uint32_t count = u32();
+        require(count);  // Every string takes at least its length prefix.
+        std::vector<std::string> values;
+        values.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            values.push_back(str());
+        }
+        return values;
+    }
+    std::vector<PackedMove> moves() {
+        std::uint32_t count = u32();
+        require(std::size_t{count} * 2);
+        std::vector<PackedMove> values(count);
+        for (PackedMove& value : values) {
+            std::uint8_t low = u8();
+            value.value = static_cast<std::uint16_t>(low | (u8() << 8));
+        }
+        return values;
+    }
+
+   private:
+    void require(std::size_t count) const {
+        if (bytes_.size() - position_ < count) {
+            throw std::runtime_error("Truncated self-play message");
+        }
+    }
+
+    const std::string& bytes_;
+    std::size_t position_ = 0;
+};
+
+void send_message(Socket& socket, MessageType type, const std::string& payload = {}) {
+    RecordWriter header;
+    header.u32(static_cast<std::uint32_t>(payload.size()));
+    header.u8(static_cast<std::uint8_t>(type));
+    std::string frame = header.take();
+    frame += payload;
+    socket.send_all(frame.data(), frame.size());
+}
+
+/** @brief Reads the next message; false once the peer has closed the connection. */
+bool receive_message(Socket& socket, MessageType& type, std::string& payload) {
+    char header[5];
+    if (!socket.receive_all(header, sizeof(header))) {
+        return false;
+    }
+    std::string header_bytes(header, sizeof(header));
+    RecordReader reader(header_bytes);
+    std::uint32_t size = reader.u32();
+    if (size > kMaxMessageBytes) {
+        throw std::runtime_error("Oversized self-play message");
+    }
+    type = static_cast<MessageType>(reader.u8());
+    payload.resize(size);
+    if (size > 0 && !socket.receive_all(payload.data(), size)) {
+        throw std::runtime_error("Connection lost while receiving");
+    }
+    return true;
+}
+
+MessageType expect_message(Socket& socket, std::string& payload) {
+    MessageType type{};
+    if (!receive_message(socket, type, payload)) {
+        throw std::runtime_error("Connection closed by peer");
+    }
+    return type;
+}
+
+std::uint64_t content_hash(const std::string& bytes) {
+    std::uint64_t hash = 1469598103934665603ULL;  // FNV-1a.
+    for (char c : bytes) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash != 0 ? hash : 1;  // 0 stands for the default network.
+}
+
+std::string hash_name(std::uint64_t hash) {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return name.str();
+}
+
+/** @brief The file extension of @p path when it is a plain one, which network loaders may key on. */
+std::string network_extension(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    bool plain = std::all_of(extension.begin(), extension.end(),
+                             [](unsigned char c) { return c == '.' || std::isalnum(c) != 0; });
+    return plain ? extension : std::string{};
+}
+
+std::string read_file(const std::filesystem::path& path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("Failed to open network file: " + path.string());
+    }
+    return std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+}
+
+/** @brief An engine as sent to workers: its network travels as a hash instead of a path. */
+struct RemoteEngine {
+    EngineConfig config;
+    std::uint64_t network_hash = 0;
+    std::string network_extension;
+};
+
+void write_engine(RecordWriter& writer, const RemoteEngine& engine) {
+    writer.str(engine.config.name);
+    writer.i32(engine.config.max_depth);
+    writer.u64(engine.config.soft_nodes);
+    writer.u64(engine.config.hard_nodes);
+    writer.u64(engine.config.table_size);
+    writer.i32(engine.config.threads);
+    writer.u8(engine.config.continuation_history ? 1 : 0);
+    writer.u64(engine.network_hash);
+    writer.str(engine.network_extension);
+}
+
+RemoteEngine read_engine(RecordReader& reader) {
+    RemoteEngine engine;
+    engine.config.name = reader.str();
+    engine.config.max_depth = reader.i32();
+    engine.config.soft_nodes = reader.u64();
+    engine.config.hard_nodes = reader.u64();
+    engine.config.table_size = static_cast<std::size_t>(reader.u64());
+    engine.config.threads = reader.i32();
+    engine.config.continuation_history = reader.u8() != 0;
+    engine.network_hash = reader.u64();
+    engine.network_extension = reader.str();
+    return engine;
+}
+
+void write_result(RecordWriter& writer, const SelfPlayResult& result) {
+    writer.str(result.white_player);
+    writer.str(result.black_player);
+    writer.str(result.result);
+    writer.str(result.termination);
+    writer.i32(result.ply_count);
+    writer.moves(result.moves);
+    writer.str(result.start_fen);
+    writer.str(result.end_fen);
+    writer.f64(result.duration_ms);
+}
+
+SelfPlayResult read_result(RecordReader& reader) {
+    SelfPlayResult result;
+    result.white_player = reader.str();
+    result.black_player = reader.str();
+    result.result = reader.str();
+    result.termination = reader.str();
+    result.ply_count = reader.i32();
+    result.moves = reader.moves();
+    result.start_fen = reader.str();
+    result.end_fen = reader.str();
+    result.duration_ms = reader.f64();
+    return result;
+}
+
+/**
+ * @brief Hashes the network files engines are configured with and keeps recent contents so
+ *        workers can fetch them; a file is re-read only when its size or timestamp changes.
+ */
+class NetworkRegistry {
+   public:
+    RemoteEngine describe(const EngineConfig& config) {
+        RemoteEngine engine{config, 0, {}};
+        if (config.network_path.empty()) {
+            return engine;
+        }
+        namespace fs = std::filesystem;
+        fs::path path(config.network_path);
+        auto time = fs::last_write_time(path);
+        auto size = fs::file_size(path);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto known = files_.find(config.network_path);
+        if (known == files_.end() || known->second.time != time || known->second.size != size) {
+            auto contents = std::make_shared<const std::string>(read_file(path));
+            std::uint64_t hash = content_hash(*contents);
+            files_[config.network_path] = File{time, size, hash};
+            if (contents_.emplace(hash, contents).second) {
+                recent_.push_back(hash);
+                while (recent_.size() > kRetained) {
+                    contents_.erase(recent_.front());
+                    recent_.pop_front();
+                }
+            }
+            known = files_.find(config.network_path);
+        }
+        engine.network_hash = known->second.hash;
+        engine.network_extension = network_extension(config.network_path);
+        engine.config.network_path.clear();
+        return engine;
+    }
+
+    std::shared_ptr<const std::string> contents(std::uint64_t hash) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = contents_.find(hash);
+        return it != contents_.end() ? it->second : nullptr;
+    }
+
+   private:
+    struct File {
+        std::filesystem::file_time_type time;
+        std::uintmax_t size = 0;
+        std::uint64_t hash = 0;
+    };
+    static constexpr std::size_t kRetained = 4;  // Networks older than this are no longer assigned.
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, File> files_;
+    std::unordered_map<std::uint64_t, std::shared_ptr<const std::string>> contents_;
+    std::deque<std::uint64_t> recent_;
+};
+
+class Coordinator {
+   public:
+    explicit Coordinator(SelfPlayOrchestrator& orchestrator)
+        : orchestrator_(orchestrator),
+          scheduler_(orchestrator.config().games, orchestrator.config().alternate_colors, orchestrator.openings()) {}
+
+    [[nodiscard]] bool finished() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return completed_ == scheduler_.total_games();
+    }
+
+    void serve(SocketHandle handle) {
+        Socket socket(handle);
+        std::optional<GameAssignment> current;
+        try {
+            std::string payload;
+            MessageType type = expect_message(socket, payload);
+            RecordReader hello(payload);
+            if (type != MessageType::kHello || hello.str() != kProtocolName || hello.u32() != kProtocolVersion) {
+                throw std::runtime_error("Incompatible worker");
+            }
+            send_message(socket, MessageType::kSession, session_payload());
+
+            while (receive_message(socket, type, payload)) {
+                if (type == MessageType::kRequest) {
+                    if (!current) {
+                        current = claim();
+                    }
+                    if (current) {
+                        send_message(socket, MessageType::kAssign, assignment_payload(*current));
+                    } else {
+                        send_message(socket, finished() ? MessageType::kDone : MessageType::kWait);
+                    }
+                } else if (type == MessageType::kResult) {
+                    RecordReader reader(payload);
+                    int game_index = reader.i32();
+                    SelfPlayResult result = read_result(reader);
+                    if (!current || current->game_index != game_index) {
+                        throw std::runtime_error("Result for a game that was not assigned");
+                    }
+                    orchestrator_.record_game(game_index, result, true);
+                    current.reset();
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    ++completed_;
+                } else if (type == MessageType::kNetworkRequest) {
+                    RecordReader reader(payload);
+                    std::uint64_t hash = reader.u64();
+                    std::shared_ptr<const std::string> contents = networks_.contents(hash);
+                    if (!contents) {
+                        send_message(socket, MessageType::kNetworkGone);  // Retired while the game waited.
+                        continue;
+                    }
+                    RecordWriter writer;
+                    writer.u64(hash);
+                    writer.str(*contents);
+                    send_message(socket, MessageType::kNetwork, writer.take());
+                } else {
+                    throw std::runtime_error("Unexpected message from worker");
+                }
+            }
+        } catch (const std::exception& error) {
+            if (!finished()) {
+                std::cerr << "[Coordinator] Worker dropped: " << error.what() << std::endl;
+            }
+        }
+        if (current) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            requeued_.push_back(*current);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_.erase(std::remove(open_.begin(), open_.end(), handle), open_.end());
+        // The socket closes on return, after it can no longer be shut down from close_all().
+    }
+
+    void track(SocketHandle handle) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        open_.push_back(handle);
+    }
+
+    /** @brief Ends every open connection, so idle workers stop waiting for games. */
+    void close_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (SocketHandle handle : open_) {
+            shutdown_handle(handle);
+        }
+    }
+
+   private:
+    std::optional<GameAssignment> claim() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!requeued_.empty()) {
+            GameAssignment game = requeued_.front();
+            requeued_.pop_front();
+            return game;
+        }
+        return scheduler_.next();
+    }
+
+    std::string session_payload() const {
+        const SelfPlayConfig& config = orchestrator_.config();
+        RecordWriter writer;
+        writer.i32(config.max_ply);
+        writer.u8(config.record_fens ? 1 : 0);
+        writer.u8(config.record_moves && (config.capture_results || config.capture_pgn) ? 1 : 0);
+        writer.f64(config.randomness_temperature);
+        writer.i32(config.randomness_max_ply);
+        writer.i32(config.randomness_top_moves);
+        writer.i32(config.randomness_score_margin);
+        return writer.take();
+    }
+
+    std::string assignment_payload(const GameAssignment& game) {
+        auto [white, black] = orchestrator_.current_engines();
+        if (game.swap_colors) {
+            std::swap(white, black);
+        }
+        RecordWriter writer;
+        writer.i32(game.game_index);
+        writer.str(game.start_fen);
+        write_engine(writer, networks_.describe(white));
+        write_engine(writer, networks_.describe(black));
+        return writer.take();
+    }
+
+    SelfPlayOrchestrator& orchestrator_;
+    GamePairScheduler scheduler_;
+    NetworkRegistry networks_;
+    mutable std::mutex mutex_;
+    std::deque<GameAssignment> requeued_;  // Games whose worker disconnected before reporting.
+    int completed_ = 0;
+    std::vector<SocketHandle> open_;
+};
+
+Socket listen_on(const std::string& host, std::uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &addresses) != 0) {
+        throw std::runtime_error("Failed to resolve listen address " + host);
+    }
+    Socket socket;
+    for (addrinfo* address = addresses; address != nullptr && !socket.valid(); address = address->ai_next) {
+        Socket candidate(::socket(address->ai_family, address->ai_socktype, address->ai_protocol));
+        if (!candidate.valid()) {
+            continue;
+        }
+        int enable = 1;
+        setsockopt(candidate.handle(), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&enable),
+                   sizeof(enable));
+        if (address->ai_family == AF_INET6) {
+            int v6_only = 0;  // "::" also accepts IPv4 workers.
+            setsockopt(candidate.handle(), IPPROTO_IPV6, IPV6_V6ONLY, reinterpret_cast<const char*>(&v6_only),
+                       sizeof(v6_only));
+        }
+        if (::bind(candidate.handle(), address->ai_addr, static_cast<socklen_t>(address->ai_addrlen)) == 0 &&
+            ::listen(candidate.handle(), SOMAXCONN) == 0) {
+            socket = std::move(candidate);
+        }
+    }
+    freeaddrinfo(addresses);
+    if (!socket.valid()) {
+        throw std::runtime_error("Failed to listen on " + host + ':' + service);
+    }
+    return socket;
+}
+
+std::uint16_t bound_port(const Socket& socket) {
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (getsockname(socket.handle(), reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        throw std::runtime_error("Failed to query the listening port");
+    }
+    if (address.ss_family == AF_INET6) {
+        return ntohs(reinterpret_cast<const sockaddr_in6*>(&address)->sin6_port);
+    }
+    return ntohs(reinterpret_cast<const sockaddr_in*>(&address)->sin_port);
+}
+
+/** @brief Waits up to @p timeout for a pending connection on @p listener. */
+bool connection_pending(const Socket& listener, std::chrono::milliseconds timeout) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(listener.handle(), &readable);
+    timeval wait{};
+    wait.tv_sec = static_cast<long>(timeout.count() / 1000);
+    wait.tv_usec = static_cast<long>((timeout.count() % 1000) * 1000);
+    return ::select(static_cast<int>(listener.handle()) + 1, &readable, nullptr, nullptr, &wait) > 0;
+}
+
+Socket connect_to(const std::string& host, std::uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses) != 0) {
+        throw std::runtime_error("Failed to resolve coordinator " + host);
+    }
+    Socket socket;
+    for (addrinfo* address = addresses; address != nullptr; address = address->ai_next) {
+        Socket candidate(::socket(address->ai_family, address->ai_socktype, address->ai_protocol));
+        if (candidate.valid() &&
+            ::connect(candidate.handle(), address->ai_addr, static_cast<socklen_t>(address->ai_addrlen)) == 0) {
+            socket = std::move(candidate);
+            break;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (!socket.valid()) {
+        throw std::runtime_error("Failed to connect to coordinator " + host + ':' + service);
+    }
+    int enable = 1;
+    setsockopt(socket.handle(), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enable), sizeof(enable));
+    return socket;
+}
+
+/** @brief Introduces a worker connection and returns the coordinator's game settings. */
+SelfPlayConfig open_session(Socket& socket) {
+    RecordWriter hello;
+    hello.str(kProtocolName);
+    hello.u32(kProtocolVersion);
+    send_message(socket, MessageType::kHello, hello.take());
+
+    std::string payload;
+    if (expect_message(socket, payload) != MessageType::kSession) {
+        throw std::runtime_error("Coordinator rejected the session");
+    }
+    RecordReader reader(payload);
+    SelfPlayConfig config;
+    config.games = 0;
+    config.max_ply = reader.i32();
+    config.record_fens = reader.u8() != 0;
+    config.record_moves = reader.u8() != 0;
+    config.randomness_temperature = reader.f64();
+    config.randomness_max_ply = reader.i32();
+    config.randomness_top_moves = reader.i32();
+    config.randomness_score_margin = reader.i32();
+    config.capture_results = false;
+    config.capture_pgn = false;
+    return config;
+}
+
+/** @brief Networks a worker has fetched, stored as "<hash><extension>" in the cache directory. */
+class NetworkCache {
+   public:
+    explicit NetworkCache(std::filesystem::path directory) : directory_(std::move(directory)) {}
+
+    /**
+     * @brief Points @p engine at a local copy of its network, fetching it over @p socket if needed;
+     *        std::nullopt when the coordinator has retired that network.
+     */
+    std::optional<EngineConfig> resolve(const RemoteEngine& engine, Socket& socket) {
+        EngineConfig config = engine.config;
+        if (engine.network_hash == 0) {
+            return config;
+        }
+        std::filesystem::path path = directory_ / (hash_name(engine.network_hash) + engine.network_extension);
+        config.network_path = path.string();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (std::filesystem::exists(path)) {
+            return config;
+        }
+        RecordWriter request;
+        request.u64(engine.network_hash);
+        send_message(socket, MessageType::kNetworkRequest, request.take());
+        std::string payload;
+        MessageType reply = expect_message(socket, payload);
+        if (reply == MessageType::kNetworkGone) {
+            return std::nullopt;
+        }
+        if (reply != MessageType::kNetwork) {
+            throw std::runtime_error("Coordinator did not send network " + hash_name(engine.network_hash));
+        }
+        RecordReader reader(payload);
+        std::uint64_t hash = reader.u64();
+        std::string contents = reader.str();
+        if (hash != engine.network_hash || content_hash(contents) != hash) {
+            throw std::runtime_error("Corrupt transfer of network " + hash_name(engine.network_hash));
+        }
+        std::filesystem::create_directories(directory_);
+        std::filesystem::path partial = path;
+        partial += ".part";
+        {
+            std::ofstream stream(partial, std::ios::binary | std::ios::trunc);
+            stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+            if (!stream) {
+                throw std::runtime_error("Failed to write " + partial.string());
+            }
+        }
+        std::filesystem::rename(partial, path);
+        return config;
+    }
+
+   private:
+    std::filesystem::path directory_;
+    std::mutex mutex_;  // One download per network, however many connections need it.
+};
+
+std::size_t play_assignments(Socket& socket, SelfPlayOrchestrator& orchestrator, NetworkCache& cache) {
+    SelfPlayEnginePool engines;
+    std::size_t played = 0;
+    std::string payload;
+    while (true) {
+        send_message(socket, MessageType::kRequest);
+        MessageType type{};
+        if (!receive_message(socket, type, payload) || type == MessageType::kDone) {
+            return played;
+        }
+        if (type == MessageType::kWait) {
+            std::this_thread::sleep_for(kWaitRetry);
+            continue;
+        }
+        if (type != MessageType::kAssign) {
+            throw std::runtime_error("Unexpected message from coordinator");
+        }
+        RecordReader reader(payload);
+        int game_index = reader.i32();
+        std::string start_fen = reader.str();
+        RemoteEngine white = read_engine(reader);
+        RemoteEngine black = read_engine(reader);
+        std::optional<EngineConfig> white_config = cache.resolve(white, socket);
+        std::optional<EngineConfig> black_config = white_config ? cache.resolve(black, socket) : std::nullopt;
+        if (!white_config || !black_config) {
+            continue;  // The coordinator reassigns the same game with its current networks.
+        }
+
+        SelfPlayResult result =
+            orchestrator.play_game(game_index, *white_config, *black_config, false, engines, start_fen);
+        RecordWriter writer;
+        writer.i32(game_index);
+        write_result(writer, result);
+        send_message(socket, MessageType::kResult, writer.take());
+        ++played;
+    }
+}
+
+}  // namespace
+
+void run_coordinator(SelfPlayOrchestrator& orchestrator, const CoordinatorConfig& config) {
+    init_sockets();
+    if (orchestrator.config().games <= 0) {
+        std::cout << "No games to play." << std::endl;
+        return;
+    }
+    Socket listener = listen_on(config.host, config.port);
+    Coordinator coordinator(orchestrator);
+    orchestrator.begin_session(0);
+    if (config.on_listening) {
+        config.on_listening(bound_port(listener));
+    }
+
+    std::vector<std::thread> connections;
+    while (!coordinator.finished()) {
+        if (!connection_pending(listener, std::chrono::milliseconds(200))) {
+            continue;
+        }
+        SocketHandle handle = ::accept(listener.handle(), nullptr, nullptr);
+        if (handle == kInvalidSocket) {
+            continue;
+        }
+        int enable = 1;
+        setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&enable), sizeof(enable));
+        if (config.worker_timeout.count() > 0) {
+            set_receive_timeout(handle, config.worker_timeout);  // A hung worker's game is requeued.
+        }
+        coordinator.track(handle);
+        connections.emplace_back([&coordinator, handle]() { coordinator.serve(handle); });
+    }
+    listener.reset();
+    coordinator.close_all();
+    for (std::thread& connection : connections) {
+        connection.join();
+    }
+    orchestrator.end_session();
+}
+
+std::size_t run_worker(const WorkerConfig& config) {
+    init_sockets();
+    Socket first = connect_to(config.host, config.port);
+    SelfPlayConfig session = open_session(first);
+    session.verbose_lite = config.verbose_lite;
+    session.syzygy_path = config.syzygy_path;
+    SelfPlayOrchestrator orchestrator(session);
+    NetworkCache cache(config.cache_dir);
+
+    std::atomic<std::size_t> played{0};
+    std::mutex failure_mutex;
+    std::exception_ptr failure;
+    auto serve = [&](Socket socket) {
+        try {
+            if (!socket.valid()) {
+                socket = connect_to(config.host, config.port);
+                open_session(socket);
+            }
+            played += play_assignments(socket, orchestrator, cache);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(failure_mutex);
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < std::max(1, config.concurrency); ++i) {
+        helpers.emplace_back(serve, Socket{});
+    }
+    serve(std::move(first));
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    return played;
+}
+
+}  // namespace chiron
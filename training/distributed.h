@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "training/selfplay.h"
+
+namespace chiron {
+
+/**
+ * @brief Serves the games of a self-play run to remote workers instead of local threads.
+ */
+struct CoordinatorConfig {
+    std::string host = "127.0.0.1";  /**< Address to bind; "::" or "0.0.0.0" accepts remote workers. */
+    std::uint16_t port = 9000;       /**< TCP port to listen on (0 picks a free one). */
+    /** @brief How long a worker may stay silent, a whole game included, before its game is reassigned. */
+    std::chrono::seconds worker_timeout{900};
+    /** @brief Called with the bound port once workers can connect. */
+    std::function<void(std::uint16_t)> on_listening;
+};
+
+/**
+ * @brief Plays @p orchestrator's games on connected `chiron worker` processes.
+ *
+ * Each worker connection requests games one at a time and receives its assignment (game index,
+ * colours, start position) together with both engine configurations, networks identified by a
+ * content hash the worker fetches once and caches. Finished games stream back as binary
+ * records and are logged, trained on and rated through SelfPlayOrchestrator::record_game(), so
+ * the results JSONL, PGN and Elo outputs match a local run. A game whose worker disconnects or
+ * exceeds CoordinatorConfig::worker_timeout is handed to the next request. The protocol is
+ * unauthenticated, so the coordinator binds loopback unless told otherwise. Returns once every
+ * game has been recorded.
+ */
+void run_coordinator(SelfPlayOrchestrator& orchestrator, const CoordinatorConfig& config);
+
+struct WorkerConfig {
+    std::string host = "127.0.0.1";
+    std::uint16_t port = 9000;
+    int concurrency = 1;                         /**< Games played at once, each on its own connection. */
+    std::string cache_dir = "nnue/worker-cache"; /**< Where fetched networks are stored by hash. */
+    bool verbose_lite = false;
+    std::string syzygy_path;                     /**< Local Syzygy directories used to adjudicate games. */
+};
+
+/**
+ * @brief Connects to a coordinator and plays the games it assigns until it has none left.
+ *
+ * Networks are fetched whenever an assignment names a hash not yet cached, so weights the
+ * coordinator's trainer publishes are picked up from the next game on; an assignment naming a
+ * network the coordinator has since retired is requested again with the current one. Returns
+ * the number of games played.
+ */
+std::size_t run_worker(const WorkerConfig& config);
+
+}  // namespace chiron
@@ -4,31 +4,90 @@
 
 namespace chiron::gpu {
 
+namespace {
+
+[[maybe_unused]] [[noreturn]] void throw_unavailable() {
+    throw std::runtime_error(
+        "Chiron was built without CUDA support. Reconfigure with -DCHIRON_ENABLE_CUDA=ON to enable GPU training.");
+}
+
+[[maybe_unused]] [[noreturn]] void throw_not_resident() {
+    throw std::runtime_error(
+        "Chiron was built without the batched CUDA trainer. Reconfigure with -DCHIRON_CUDA_BATCHED_TRAINER=ON.");
+}
+
+}  // namespace
+
 #ifdef CHIRON_ENABLE_CUDA
 
+bool is_available() {
+    return true;
+}
+
+#ifdef CHIRON_CUDA_BATCHED_TRAINER
+
+void upload_cuda(const nnue::Network& host, std::shared_ptr<DeviceNetwork>& device);
+void train_batch_cuda(const FeatureBatch& batch, DeviceNetwork& device, const Trainer::Config& config);
+void download_cuda(const DeviceNetwork& device, nnue::Network& host);
+
+bool keeps_weights_resident() {
+    return true;
+}
+
+void train_examples(const std::vector<TrainingExample>&, nnue::Network&, const Trainer::Config&) {
+    throw std::logic_error("The batched CUDA trainer trains through train_batch()");
+}
+
+void upload(const nnue::Network& host, std::shared_ptr<DeviceNetwork>& device) { upload_cuda(host, device); }
+
+void train_batch(const FeatureBatch& batch, DeviceNetwork& device, const Trainer::Config& config) {
+    train_batch_cuda(batch, device, config);
+}
+
+void download(const DeviceNetwork& device, nnue::Network& host) { download_cuda(device, host); }
+
+#else
+
 void train_batch_cuda(const std::vector<TrainingExample>& batch, nnue::Network& network,
                       const Trainer::Config& config);
 
-bool is_available() {
-    return true;
+bool keeps_weights_resident() {
+    return false;
 }
 
-void train_batch(const std::vector<TrainingExample>& batch, nnue::Network& network,
-                 const Trainer::Config& config) {
+void train_examples(const std::vector<TrainingExample>& batch, nnue::Network& network,
+                    const Trainer::Config& config) {
     train_batch_cuda(batch, network, config);
 }
 
+void upload(const nnue::Network&, std::shared_ptr<DeviceNetwork>&) { throw_not_resident(); }
+
+void train_batch(const FeatureBatch&, DeviceNetwork&, const Trainer::Config&) { throw_not_resident(); }
+
+void download(const DeviceNetwork&, nnue::Network&) { throw_not_resident(); }
+
+#endif
+
 #else
 
 bool is_available() {
     return false;
 }
 
-void train_batch(const std::vector<TrainingExample>&, nnue::Network&, const Trainer::Config&) {
-    throw std::runtime_error(
-        "Chiron was built without CUDA support. Reconfigure with -DCHIRON_ENABLE_CUDA=ON to enable GPU training.");
+bool keeps_weights_resident() {
+    return false;
 }
 
+void train_examples(const std::vector<TrainingExample>&, nnue::Network&, const Trainer::Config&) {
+    throw_unavailable();
+}
+
+void upload(const nnue::Network&, std::shared_ptr<DeviceNetwork>&) { throw_unavailable(); }
+
+void train_batch(const FeatureBatch&, DeviceNetwork&, const Trainer::Config&) { throw_unavailable(); }
+
+void download(const DeviceNetwork&, nnue::Network&) { throw_unavailable(); }
+
 #endif
 
 }  // namespace chiron::gpu
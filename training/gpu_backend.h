@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "nnue/network.h"
@@ -7,8 +8,37 @@
 
 namespace chiron::gpu {
 
+/**
+ * @brief Device-resident copy of a network plus the scratch buffers of batched training.
+ *
+ * Defined by the CUDA backend; other builds only ever hold a null pointer to it.
+ */
+struct DeviceNetwork;
+
 bool is_available();
-void train_batch(const std::vector<TrainingExample>& batch, nnue::Network& network,
-                 const Trainer::Config& config);
+
+/**
+ * @brief True when the batched trainer (CHIRON_CUDA_BATCHED_TRAINER) keeps the weights on the
+ *        device; otherwise train_examples() is the GPU path.
+ */
+bool keeps_weights_resident();
+
+/**
+ * @brief Applies @p batch one example per kernel launch, copying @p network to the device and
+ *        back around the batch; SGD only.
+ */
+void train_examples(const std::vector<TrainingExample>& batch, nnue::Network& network,
+                    const Trainer::Config& config);
+
+/** @brief Copies @p host to the device, (re)allocating @p device when its shape changed. */
+void upload(const nnue::Network& host, std::shared_ptr<DeviceNetwork>& device);
+
+/**
+ * @brief Runs one mini-batch step on the device-resident weights; nothing is copied back.
+ */
+void train_batch(const FeatureBatch& batch, DeviceNetwork& device, const Trainer::Config& config);
+
+/** @brief Copies the device weights back into @p host (e.g. before saving or evaluating). */
+void download(const DeviceNetwork& device, nnue::Network& host);
 
 }  // namespace chiron::gpu
@@ -4,14 +4,23 @@
 #include <cctype>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <ctime>
+#include <exception>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <map>
+#include <optional>
 #include <random>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "evaluation.h"
+#include "training/data_loader.h"
 
 namespace chiron {
 
@@ -37,18 +46,107 @@ std::string timestamp_string() {
     return oss.str();
 }
 
+/** @brief Highest N among @p dir's "<stem>-iterN<extension>" snapshots, 0 when there are none. */
+int latest_history_iteration(const std::filesystem::path& dir, const std::string& stem, const std::string& extension) {
+    if (dir.empty() || !std::filesystem::exists(dir)) {
+        return 0;
+    }
+    const std::string prefix = stem + "-iter";
+    int latest = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        std::string name = entry.path().stem().string();
+        if (!entry.is_regular_file() || entry.path().extension().string() != extension || name.rfind(prefix, 0) != 0) {
+            continue;
+        }
+        try {
+            latest = std::max(latest, std::stoi(name.substr(prefix.size())));
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+    return latest;
+}
+
 }  // namespace
 
+/**
+ * @brief One-slot hand-off between two pipeline stages.
+ *
+ * The producer blocks while the previous iteration is still waiting, which is what keeps the
+ * stages at most one iteration apart. A producer finishes (possibly with its failure, rethrown
+ * to the consumer once the slot is empty); a consumer closes to make pending pushes give up.
+ */
+class LearningRegimen::Handoff {
+   public:
+    /** @brief Waits for the slot to empty and fills it; false once the consumer has closed. */
+    bool push(IterationData data) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !pending_ || closed_; });
+        if (closed_) {
+            return false;
+        }
+        pending_ = std::move(data);
+        cv_.notify_all();
+        return true;
+    }
+
+    /** @brief Waits for the next iteration; false when the producer finished without one. */
+    bool pop(IterationData& data) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return pending_ || finished_ || closed_; });
+        if (pending_) {
+            data = std::move(*pending_);
+            pending_.reset();
+            cv_.notify_all();
+            return true;
+        }
+        if (failure_) {
+            std::rethrow_exception(failure_);
+        }
+        return false;
+    }
+
+    void finish(std::exception_ptr failure = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        failure_ = std::move(failure);
+        cv_.notify_all();
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        cv_.notify_all();
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::optional<IterationData> pending_;
+    std::exception_ptr failure_;
+    bool finished_ = false;
+    bool closed_ = false;
+};
+
 LearningRegimen::LearningRegimen(LearningRegimenConfig config)
     : config_(std::move(config)),
-      trainer_(Trainer::Config{config_.learning_rate, 0.0005, config_.training_device}),
-      parameters_(config_.hidden_size) {
+      trainer_(Trainer::Config{config_.learning_rate, 0.0005, config_.training_device, config_.training_threads,
+                               config_.optimizer}),
+      parameters_(config_.hidden_size),
+      position_filter_(std::make_shared<PositionFilter>(config_.position_filter, std::random_device{}())) {
     ensure_directories();
+    if (!config_.output_network_path.empty()) {
+        std::filesystem::path output_path(config_.output_network_path);
+        history_iteration_ = latest_history_iteration(config_.training_history_dir, output_path.stem().string(),
+                                                      output_path.extension().string());
+    }
 
     if (!config_.output_network_path.empty() && std::filesystem::exists(config_.output_network_path)) {
         parameters_.load(config_.output_network_path);
         config_.hidden_size = parameters_.network().hidden_size();
-        parameters_loaded_ = true;
+        // Until the first iteration is trained, games play with the loaded weights; without a
+        // file they keep the engine's default evaluation, as a fresh self-play session would.
+        publish_parameters();
     }
 
     if (!config_.online_database_dir.empty()) {
@@ -123,14 +221,17 @@ void LearningRegimen::announce_online_database_location() const {
     }
 }
 
-void LearningRegimen::refresh_parameters_from_disk() {
-    if (!parameters_loaded_) {
-        parameters_.reset(config_.hidden_size);
-        parameters_loaded_ = true;
-    }
-    if (!config_.output_network_path.empty() && std::filesystem::exists(config_.output_network_path)) {
-        parameters_.load(config_.output_network_path);
-        config_.hidden_size = parameters_.network().hidden_size();
+LearningRegimen::~LearningRegimen() = default;
+
+void LearningRegimen::publish_parameters() {
+    auto trained = std::make_shared<TrainedNetwork>();
+    // Engines follow the snapshot by path alone, so a regimen without an output file still needs one.
+    trained->path = config_.output_network_path.empty() ? "<learning-regimen>" : config_.output_network_path;
+    trained->network = std::make_shared<const nnue::Network>(std::as_const(parameters_).network());
+    std::lock_guard<std::mutex> lock(stages_mutex_);
+    published_ = std::move(trained);
+    for (SelfPlayOrchestrator* orchestrator : live_orchestrators_) {
+        orchestrator->publish_network(published_);
     }
 }
 
@@ -139,6 +240,22 @@ void LearningRegimen::save_parameters() {
         return;
     }
     parameters_.save(config_.output_network_path);
+    set_global_network_path(config_.output_network_path);
+    if (!config_.training_history_dir.empty()) {
+        std::filesystem::path output_path(config_.output_network_path);
+        std::ostringstream name;
+        name << output_path.stem().string() << "-iter" << std::setw(6) << std::setfill('0') << ++history_iteration_
+             << output_path.extension().string();
+        parameters_.save((std::filesystem::path(config_.training_history_dir) / name.str()).string());
+    }
+}
+
+void LearningRegimen::cancel_stages() {
+    std::lock_guard<std::mutex> lock(stages_mutex_);
+    stopping_ = true;
+    for (SelfPlayOrchestrator* orchestrator : live_orchestrators_) {
+        orchestrator->cancel_games();
+    }
 }
 
 void LearningRegimen::log_dataset_summary(const std::string& prefix, const DatasetEvaluationResult& summary) const {
@@ -168,7 +285,11 @@ void LearningRegimen::log_dataset_composition(const std::string& label, const st
 
     for (const TrainingExample& example : data) {
         std::size_t space = example.fen.find(' ');
-        if (space != std::string::npos && space + 1 < example.fen.size()) {
+        if (example.packed) {
+            if (example.packed->side_to_move() == Color::White) {
+                ++white_to_move;
+            }
+        } else if (space != std::string::npos && space + 1 < example.fen.size()) {
             char stm = example.fen[space + 1];
             if (stm == 'w' || stm == 'W') {
                 ++white_to_move;
@@ -255,7 +376,7 @@ void LearningRegimen::log_dataset_composition(const std::string& label, const st
 
     std::cout << "[Learn] " << label << " sample positions:" << std::endl;
     for (const TrainingExample& sample : samples) {
-        std::cout << "         target " << sample.target_cp << " | " << sample.fen << std::endl;
+        std::cout << "         target " << sample.target_cp << " | " << example_fen(sample) << std::endl;
     }
 }
 
@@ -289,9 +410,48 @@ std::vector<TrainingExample> LearningRegimen::load_online_examples(std::size_t m
     return result;
 }
 
-void LearningRegimen::run_selfplay_phase(int iteration, int total_iterations) {
+std::vector<TrainingExample> LearningRegimen::collect_games(SelfPlayConfig config) {
+    std::mutex examples_mutex;
+    std::vector<TrainingExample> examples;
+    config.enable_training = true;
+    config.position_filter = position_filter_;
+    config.training_sink = [&](std::vector<TrainingExample> batch) {
+        std::lock_guard<std::mutex> lock(examples_mutex);
+        examples.insert(examples.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+    };
+    {
+        std::lock_guard<std::mutex> lock(stages_mutex_);
+        config.initial_network = published_;
+    }
+
+    SelfPlayOrchestrator orchestrator(std::move(config));
+    auto unregister = [&] {
+        std::lock_guard<std::mutex> lock(stages_mutex_);
+        live_orchestrators_.erase(std::remove(live_orchestrators_.begin(), live_orchestrators_.end(), &orchestrator),
+                                  live_orchestrators_.end());
+    };
+    {
+        std::lock_guard<std::mutex> lock(stages_mutex_);
+        if (stopping_) {
+            return {};
+        }
+        live_orchestrators_.push_back(&orchestrator);
+        // The network may have moved on while the orchestrator was being set up.
+        orchestrator.publish_network(published_);
+    }
+    try {
+        orchestrator.run();
+    } catch (...) {
+        unregister();
+        throw;
+    }
+    unregister();
+    return examples;  // run() joined every thread that fed the sink.
+}
+
+std::vector<TrainingExample> LearningRegimen::run_selfplay_phase(int iteration, int total_iterations) {
     if (config_.selfplay_games <= 0) {
-        return;
+        return {};
     }
     std::cout << "[Learn] Iteration " << iteration << '/' << total_iterations << " self-play: "
               << config_.selfplay_games << " games (depth " << config_.selfplay_depth << ")" << std::endl;
@@ -300,12 +460,9 @@ void LearningRegimen::run_selfplay_phase(int iteration, int total_iterations) {
     sp.games = config_.selfplay_games;
     sp.max_ply = config_.selfplay_max_ply;
     sp.concurrency = std::max(1, config_.selfplay_concurrency);
-    sp.enable_training = true;
     sp.training_batch_size = config_.training_batch_size;
-    sp.training_learning_rate = config_.learning_rate;
-    sp.training_device = config_.training_device;
     sp.training_output_path = config_.output_network_path;
-    sp.training_history_dir = config_.training_history_dir;
+    sp.training_history_dir.clear();
     sp.training_hidden_size = config_.hidden_size;
     sp.white.max_depth = config_.selfplay_depth;
     sp.black.max_depth = config_.selfplay_depth;
@@ -315,15 +472,12 @@ void LearningRegimen::run_selfplay_phase(int iteration, int total_iterations) {
     sp.capture_pgn = false;
     sp.verbose_lite = true;
     sp.teacher_mode = false;
-
-    SelfPlayOrchestrator orchestrator(sp);
-    orchestrator.run();
-    refresh_parameters_from_disk();
+    return collect_games(std::move(sp));
 }
 
-void LearningRegimen::run_teacher_phase(int iteration, int total_iterations) {
+std::vector<TrainingExample> LearningRegimen::run_teacher_phase(int iteration, int total_iterations) {
     if (config_.teacher_games <= 0 || config_.teacher_engine_path.empty()) {
-        return;
+        return {};
     }
     std::cout << "[Learn] Iteration " << iteration << '/' << total_iterations << " teacher-guided self-play: "
               << config_.teacher_games << " games using " << config_.teacher_engine_path << std::endl;
@@ -332,12 +486,9 @@ void LearningRegimen::run_teacher_phase(int iteration, int total_iterations) {
     teacher_sp.games = config_.teacher_games;
     teacher_sp.max_ply = config_.selfplay_max_ply;
     teacher_sp.concurrency = std::max(1, config_.selfplay_concurrency);
-    teacher_sp.enable_training = true;
     teacher_sp.training_batch_size = config_.training_batch_size;
-    teacher_sp.training_learning_rate = config_.learning_rate;
-    teacher_sp.training_device = config_.training_device;
     teacher_sp.training_output_path = config_.output_network_path;
-    teacher_sp.training_history_dir = config_.training_history_dir;
+    teacher_sp.training_history_dir.clear();
     teacher_sp.training_hidden_size = config_.hidden_size;
     teacher_sp.white.max_depth = config_.selfplay_depth;
     teacher_sp.black.max_depth = config_.selfplay_depth;
@@ -348,11 +499,78 @@ void LearningRegimen::run_teacher_phase(int iteration, int total_iterations) {
     teacher_sp.teacher.engine_path = config_.teacher_engine_path;
     teacher_sp.teacher.depth = config_.teacher_depth;
     teacher_sp.teacher.threads = config_.teacher_threads;
+    teacher_sp.teacher.processes = config_.teacher_processes;
+    teacher_sp.teacher.pipeline = config_.teacher_pipeline;
     teacher_sp.teacher_chunk_size = config_.training_batch_size;
+    return collect_games(std::move(teacher_sp));
+}
+
+void LearningRegimen::run_selfplay_stage(Handoff& output) {
+    try {
+        for (int iteration = 1; iteration <= config_.iterations && !stopping_; ++iteration) {
+            std::cout << "[Learn] === Iteration " << iteration << " started at " << timestamp_string() << " ==="
+                      << std::endl;
+            IterationData data{iteration, run_selfplay_phase(iteration, config_.iterations)};
+            if (stopping_ || !output.push(std::move(data))) {
+                break;
+            }
+        }
+        output.finish();
+    } catch (...) {
+        output.finish(std::current_exception());
+    }
+}
+
+void LearningRegimen::run_teacher_stage(Handoff& input, Handoff& output) {
+    try {
+        IterationData data;
+        while (input.pop(data)) {
+            std::vector<TrainingExample> labelled = run_teacher_phase(data.iteration, config_.iterations);
+            data.examples.insert(data.examples.end(), std::make_move_iterator(labelled.begin()),
+                                 std::make_move_iterator(labelled.end()));
+            if (stopping_ || !output.push(std::move(data))) {
+                break;
+            }
+        }
+        input.close();
+        output.finish();
+    } catch (...) {
+        input.close();
+        output.finish(std::current_exception());
+    }
+}
 
-    SelfPlayOrchestrator orchestrator(teacher_sp);
-    orchestrator.run();
-    refresh_parameters_from_disk();
+void LearningRegimen::train_examples(const std::vector<TrainingExample>& dataset) {
+    // Positions arrive game by game; shuffling the whole set decorrelates the batches, and
+    // decoding runs ahead of the trainer.
+    TrainingDataLoader::Config loader_config;
+    loader_config.batch_size = config_.training_batch_size;
+    loader_config.shuffle_buffer = dataset.size();
+    loader_config.seed = std::random_device{}();
+    loader_config.features = parameters_.feature_set();
+    TrainingDataLoader loader(dataset, loader_config);
+    FeatureBatch batch;
+    while (loader.next(batch)) {
+        trainer_.train_batch(batch, parameters_);
+    }
+    total_positions_trained_ += dataset.size();
+}
+
+void LearningRegimen::train_iteration(IterationData& data) {
+    if (!data.examples.empty()) {
+        std::cout << "[Learn] Iteration " << data.iteration << '/' << config_.iterations << " training on "
+                  << data.examples.size() << " self-play and teacher positions" << std::endl;
+        train_examples(data.examples);
+        DatasetEvaluationResult summary = evaluate_dataset_performance(
+            data.examples, parameters_, trainer_, std::min<std::size_t>(data.examples.size(), 4096));
+        log_dataset_summary("[Learn] Self-play pseudo-Elo ", summary);
+    }
+    run_online_phase(data.iteration, config_.iterations);
+    publish_parameters();
+    save_parameters();
+    evaluate_holdout(data.iteration);
+    std::cout << "[Learn] Iteration " << data.iteration << " complete. Cumulative supervised samples: "
+              << total_positions_trained_ << std::endl;
 }
 
 void LearningRegimen::run_online_phase(int iteration, int total_iterations) {
@@ -370,18 +588,7 @@ void LearningRegimen::run_online_phase(int iteration, int total_iterations) {
               << dataset.size() << " positions from PGNs" << std::endl;
 
     log_dataset_composition("Online replay batch", dataset);
-
-    refresh_parameters_from_disk();
-
-    std::size_t batch_size = std::max<std::size_t>(1, config_.training_batch_size);
-    for (std::size_t offset = 0; offset < dataset.size(); offset += batch_size) {
-        std::size_t end = std::min(offset + batch_size, dataset.size());
-        std::vector<TrainingExample> batch(dataset.begin() + static_cast<std::ptrdiff_t>(offset),
-                                           dataset.begin() + static_cast<std::ptrdiff_t>(end));
-        trainer_.train_batch(batch, parameters_);
-    }
-    total_positions_trained_ += dataset.size();
-    save_parameters();
+    train_examples(dataset);
 
     DatasetEvaluationResult summary =
         evaluate_dataset_performance(dataset, parameters_, trainer_, std::min<std::size_t>(dataset.size(), 4096));
@@ -392,7 +599,6 @@ void LearningRegimen::evaluate_holdout(int iteration) {
     if (holdout_set_.empty()) {
         return;
     }
-    refresh_parameters_from_disk();
     DatasetEvaluationResult summary = evaluate_dataset_performance(holdout_set_, parameters_, trainer_,
                                                                    std::min(config_.holdout_samples, holdout_set_.size()));
     std::ostringstream prefix;
@@ -406,18 +612,28 @@ void LearningRegimen::run() {
         std::cout << "[Learn] Using " << holdout_set_.size() << " holdout samples for progress tracking." << std::endl;
     }
 
-    for (int iteration = 1; iteration <= config_.iterations; ++iteration) {
-        std::cout << "[Learn] === Iteration " << iteration << " started at " << timestamp_string() << " ===" << std::endl;
-        run_selfplay_phase(iteration, config_.iterations);
-        run_teacher_phase(iteration, config_.iterations);
-        run_online_phase(iteration, config_.iterations);
-        evaluate_holdout(iteration);
-        std::cout << "[Learn] Iteration " << iteration << " complete. Cumulative supervised samples: "
-                  << total_positions_trained_ << std::endl;
+    stopping_ = false;
+    Handoff games;
+    Handoff labelled;
+    std::thread selfplay_stage(&LearningRegimen::run_selfplay_stage, this, std::ref(games));
+    std::thread teacher_stage(&LearningRegimen::run_teacher_stage, this, std::ref(games), std::ref(labelled));
+    try {
+        IterationData data;
+        while (labelled.pop(data)) {
+            train_iteration(data);
+        }
+    } catch (...) {
+        cancel_stages();
+        games.close();
+        labelled.close();
+        selfplay_stage.join();
+        teacher_stage.join();
+        throw;
     }
+    selfplay_stage.join();
+    teacher_stage.join();
 
     std::cout << "[Learn] Training complete. Latest network saved to " << config_.output_network_path << std::endl;
 }
 
 }  // namespace chiron
-
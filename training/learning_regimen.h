@@ -1,11 +1,15 @@
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "training/pgn_importer.h"
+#include "training/position_filter.h"
 #include "training/selfplay.h"
 #include "training/trainer.h"
 #include "training/training_metrics.h"
@@ -22,32 +26,66 @@ struct LearningRegimenConfig {
     std::string teacher_engine_path;
     int teacher_depth = 20;
     int teacher_threads = 1;
+    int teacher_processes = 1;
+    int teacher_pipeline = 1;
     std::string online_database_dir = "data/online_pgns";
     std::size_t online_batch_positions = 2048;
     std::size_t training_batch_size = 256;
     double learning_rate = 0.05;
     TrainerDevice training_device = TrainerDevice::kCPU;
+    std::size_t training_threads = 1;  /**< CPU trainer threads per batch (0 = all cores). */
+    OptimizerConfig optimizer{};
     std::string output_network_path = "nnue/models/chiron-learned.nnue";
     std::string training_history_dir = "nnue/models/history";
     std::size_t hidden_size = nnue::kDefaultHiddenSize;
     std::size_t holdout_samples = 2048;
     bool include_draws = true;
+    /** Game positions kept for training; one filter spans every iteration, so repeats are dropped throughout. */
+    PositionFilterConfig position_filter{0, true, 1.0, std::size_t{1} << 20};
 };
 
+/**
+ * @brief Self-play, teacher and online training cycles run as a three-stage pipeline.
+ *
+ * While the calling thread trains iteration N, a teacher thread plays and labels the teacher
+ * games of N+1 and a self-play thread plays the games of N+2. Each hand-off holds one
+ * iteration, so no stage runs more than one iteration ahead of the next.
+ * The regimen owns the only trainable weights: games record labelled positions for it instead
+ * of training their own copy, and every trained iteration is published to the games in memory
+ * (new games adopt it at once) before it is saved once to the output path for later sessions.
+ */
 class LearningRegimen {
    public:
     explicit LearningRegimen(LearningRegimenConfig config);
+    ~LearningRegimen();
+
+    LearningRegimen(const LearningRegimen&) = delete;
+    LearningRegimen& operator=(const LearningRegimen&) = delete;
 
     void run();
 
    private:
+    struct IterationData {
+        int iteration = 0;
+        std::vector<TrainingExample> examples;  /**< Self-play and teacher positions, labelled. */
+    };
+    class Handoff;
+
     void announce_online_database_location() const;
     void ensure_directories() const;
-    void run_selfplay_phase(int iteration, int total_iterations);
-    void run_teacher_phase(int iteration, int total_iterations);
+    void run_selfplay_stage(Handoff& output);
+    void run_teacher_stage(Handoff& input, Handoff& output);
+    std::vector<TrainingExample> run_selfplay_phase(int iteration, int total_iterations);
+    std::vector<TrainingExample> run_teacher_phase(int iteration, int total_iterations);
+    /** @brief Plays @p config's games on the published network and returns their labelled positions. */
+    std::vector<TrainingExample> collect_games(SelfPlayConfig config);
+    void train_iteration(IterationData& data);
     void run_online_phase(int iteration, int total_iterations);
-    void refresh_parameters_from_disk();
+    void train_examples(const std::vector<TrainingExample>& dataset);
+    void publish_parameters();
+    /** @brief Writes the output network and the next numbered snapshot in the history directory. */
     void save_parameters();
+    void cancel_stages();
     void log_dataset_summary(const std::string& prefix, const DatasetEvaluationResult& summary) const;
     std::vector<TrainingExample> load_online_examples(std::size_t max_positions);
     void evaluate_holdout(int iteration);
@@ -60,9 +98,15 @@ class LearningRegimen {
     std::vector<std::filesystem::path> online_files_;
     std::size_t online_file_index_ = 0;
     std::vector<TrainingExample> holdout_set_;
-    bool parameters_loaded_ = false;
     std::size_t total_positions_trained_ = 0;
+    int history_iteration_ = 0;  // Number of the last snapshot in the history directory.
+
+    std::shared_ptr<PositionFilter> position_filter_;  // Shared by every game session.
+
+    std::mutex stages_mutex_;  // Guards the two members below.
+    std::shared_ptr<const TrainedNetwork> published_;   // Latest trained weights the games play with.
+    std::vector<SelfPlayOrchestrator*> live_orchestrators_;  // Stages' running game sessions.
+    std::atomic<bool> stopping_{false};
 };
 
 }  // namespace chiron
-
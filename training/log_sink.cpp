@@ -0,0 +1,98 @@
+#include "training/log_sink.h"
+
+#include <utility>
+
+namespace chiron {
+
+AsyncLogSink::AsyncLogSink(std::vector<std::ostream*> streams) : AsyncLogSink(std::move(streams), Config{}) {}
+
+AsyncLogSink::AsyncLogSink(std::vector<std::ostream*> streams, Config config)
+    : streams_(std::move(streams)), config_(config), writer_(&AsyncLogSink::writer_loop, this) {}
+
+AsyncLogSink::~AsyncLogSink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_cv_.notify_one();
+    writer_.join();
+}
+
+void AsyncLogSink::write(std::size_t channel, std::string text) {
+    std::size_t bytes = text.size();
+    auto* record = new Record{channel, std::move(text), head_.load(std::memory_order_relaxed)};
+    // Counted before it is published, so a flush() that can see the record also waits for it; a
+    // flush that counts it a moment early keeps waking the writer until the push lands.
+    submitted_.fetch_add(1, std::memory_order_release);
+    while (!head_.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    if (pending_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes >= config_.flush_bytes) {
+        // Unsynchronised on purpose: a missed wake-up only delays the batch to the next interval.
+        wake_cv_.notify_one();
+    }
+}
+
+void AsyncLogSink::flush() {
+    std::uint64_t target = submitted_.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++flush_waiters_;
+    wake_cv_.notify_one();
+    written_cv_.wait(lock, [&]() { return written_.load(std::memory_order_acquire) >= target; });
+    --flush_waiters_;
+}
+
+void AsyncLogSink::writer_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_cv_.wait_for(lock, config_.flush_interval, [&]() {
+            return stopping_ || flush_waiters_ > 0 ||
+                   pending_bytes_.load(std::memory_order_relaxed) >= config_.flush_bytes;
+        });
+        bool stop = stopping_;
+        lock.unlock();
+        drain();
+        lock.lock();
+        written_cv_.notify_all();
+        if (stop && head_.load(std::memory_order_acquire) == nullptr) {
+            return;
+        }
+    }
+}
+
+void AsyncLogSink::drain() {
+    Record* newest = head_.exchange(nullptr, std::memory_order_acquire);
+    if (newest == nullptr) {
+        return;
+    }
+    Record* oldest = nullptr;
+    while (newest != nullptr) {
+        Record* next = newest->next;
+        newest->next = oldest;
+        oldest = newest;
+        newest = next;
+    }
+
+    std::vector<bool> touched(streams_.size(), false);
+    std::size_t bytes = 0;
+    std::uint64_t count = 0;
+    while (oldest != nullptr) {
+        Record* record = oldest;
+        oldest = record->next;
+        if (record->channel < streams_.size() && streams_[record->channel] != nullptr) {
+            streams_[record->channel]->write(record->text.data(), static_cast<std::streamsize>(record->text.size()));
+            touched[record->channel] = true;
+        }
+        bytes += record->text.size();
+        ++count;
+        delete record;
+    }
+    for (std::size_t channel = 0; channel < streams_.size(); ++channel) {
+        if (touched[channel]) {
+            streams_[channel]->flush();
+        }
+    }
+    pending_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+    written_.fetch_add(count, std::memory_order_release);
+}
+
+}  // namespace chiron
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace chiron {
+
+/**
+ * @brief Moves log output off the threads producing it.
+ *
+ * write() pushes a finished record onto a lock-free list and returns; a background thread
+ * collects everything queued, writes it to the record's stream and flushes each stream once per
+ * batch. A batch is written when Config::flush_bytes are pending or Config::flush_interval has
+ * passed, whichever comes first. Records written by one thread keep their order.
+ */
+class AsyncLogSink {
+   public:
+    struct Config {
+        std::size_t flush_bytes = 64 * 1024;
+        std::chrono::milliseconds flush_interval{100};
+    };
+
+    /** @brief Channel i of write() is @p streams[i]; the streams must outlive the sink. */
+    explicit AsyncLogSink(std::vector<std::ostream*> streams);
+    AsyncLogSink(std::vector<std::ostream*> streams, Config config);
+    /** @brief Writes and flushes everything still queued. */
+    ~AsyncLogSink();
+
+    AsyncLogSink(const AsyncLogSink&) = delete;
+    AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+
+    void write(std::size_t channel, std::string text);
+
+    /** @brief Blocks until every record written before the call is on its stream and flushed. */
+    void flush();
+
+   private:
+    struct Record {
+        std::size_t channel;
+        std::string text;
+        Record* next;
+    };
+
+    void writer_loop();
+    void drain();
+
+    std::vector<std::ostream*> streams_;
+    Config config_;
+    std::atomic<Record*> head_{nullptr};  // Newest first; the writer takes the whole list at once.
+    std::atomic<std::size_t> pending_bytes_{0};
+    std::atomic<std::uint64_t> submitted_{0};
+    std::atomic<std::uint64_t> written_{0};
+
+    std::mutex mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable written_cv_;
+    int flush_waiters_ = 0;
+    bool stopping_ = false;
+    std::thread writer_;
+};
+
+}  // namespace chiron
@@ -0,0 +1,307 @@
+#include "training/openings.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include "board.h"
+#include "book.h"
+#include "notation.h"
+#include "training/pgn_tokens.h"
+#include "training/results_log.h"
+
+namespace chiron {
+
+namespace {
+
+bool has_pgn_extension(const std::string& path) {
+    std::string ext = std::filesystem::path(path).extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".pgn";
+}
+
+/**
+ * @brief Normalises an EPD record (or a full FEN) to a FEN: the four position fields, then the
+ *        clocks when the record carries them and "0 1" otherwise.
+ */
+std::optional<std::string> epd_to_fen(const std::string& line) {
+    std::istringstream iss(line);
+    std::vector<std::string> fields;
+    std::string field;
+    while (fields.size() < 6 && iss >> field) {
+        fields.push_back(field);
+    }
+    if (fields.size() < 4) {
+        return std::nullopt;
+    }
+    auto is_number = [](const std::string& value) {
+        return !value.empty() &&
+               std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
+    };
+    std::string fen = fields[0] + ' ' + fields[1] + ' ' + fields[2] + ' ' + fields[3];
+    if (fields.size() == 6 && is_number(fields[4]) && is_number(fields[5])) {
+        fen += ' ' + fields[4] + ' ' + fields[5];
+    } else {
+        fen += " 0 1";
+    }
+    return fen;
+}
+
+std::vector<std::string> load_epd(std::istream& stream, const std::string& path) {
+    std::vector<std::string> fens;
+    Board board;
+    std::string line;
+    std::size_t line_number = 0;
+    while (std::getline(stream, line)) {
+        ++line_number;
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        std::optional<std::string> fen = epd_to_fen(line);
+        try {
+            if (!fen) {
+                throw std::invalid_argument("too few fields");
+            }
+            board.set_from_fen(*fen);
+        } catch (const std::exception& error) {
+            throw std::runtime_error("Invalid opening on line " + std::to_string(line_number) + " of " + path + ": " +
+                                     error.what());
+        }
+        fens.push_back(board.fen());
+    }
+    return fens;
+}
+
+/** @brief The parts of a PGN game the openings and books use. */
+struct PgnGame {
+    std::string start_fen;  // Empty for the standard start position.
+    std::vector<std::string> moves_san;
+    std::string result;     // "*" when the movetext ends without a result.
+};
+
+/** @brief Splits a PGN database into its games; comments, variations, numbers and glyphs are dropped. */
+std::vector<PgnGame> parse_pgn(std::istream& stream) {
+    std::ostringstream contents;
+    contents << stream.rdbuf();
+    std::istringstream tokens(pgn::strip_comments(contents.str()));
+
+    std::vector<PgnGame> games;
+    PgnGame game;
+    bool in_game = false;
+    bool in_headers = false;
+    auto finish_game = [&](const std::string& result) {
+        if (in_game) {
+            game.result = result;
+            games.push_back(std::move(game));
+        }
+        game = PgnGame{};
+        in_game = false;
+    };
+
+    std::string token;
+    while (tokens >> token) {
+        if (token.front() == '[') {
+            if (!in_headers) {
+                finish_game("*");
+                in_headers = true;
+            }
+            std::string header = token;
+            while (header.back() != ']' && tokens >> token) {
+                header += ' ' + token;
+            }
+            const std::string fen_tag = "[FEN \"";
+            if (header.rfind(fen_tag, 0) == 0) {
+                std::string fen = header.substr(fen_tag.size());
+                game.start_fen = fen.substr(0, fen.find('"'));
+                in_game = true;
+            }
+            continue;
+        }
+        in_headers = false;
+        if (pgn::is_result_token(token)) {
+            finish_game(token);
+            continue;
+        }
+        if (pgn::is_move_number(token) || token.front() == '$') {
+            continue;  // Move numbers and annotation glyphs.
+        }
+        in_game = true;
+        while (!token.empty() && (token.back() == '!' || token.back() == '?')) {
+            token.pop_back();
+        }
+        game.moves_san.push_back(token);
+    }
+    finish_game("*");
+    return games;
+}
+
+Board start_board(const std::string& start_fen) {
+    Board board;
+    if (start_fen.empty()) {
+        board.set_start_position();
+    } else {
+        board.set_from_fen(start_fen);
+    }
+    return board;
+}
+
+std::vector<std::string> load_pgn(std::istream& stream, int max_plies) {
+    std::vector<std::string> fens;
+    for (const PgnGame& game : parse_pgn(stream)) {
+        Board board = start_board(game.start_fen);
+        std::size_t plies = max_plies > 0 ? std::min(game.moves_san.size(), static_cast<std::size_t>(max_plies))
+                                          : game.moves_san.size();
+        for (std::size_t ply = 0; ply < plies; ++ply) {
+            Board::State state;
+            board.make_move(san_to_move(board, game.moves_san[ply]), state);
+        }
+        fens.push_back(board.fen());
+    }
+    return fens;
+}
+
+/** @brief Reads one game from a self-play results-log line; nothing when a field is missing. */
+std::optional<PgnGame> parse_results_line(const std::string& line) {
+    PgnGame game;
+    std::size_t pos = results_log::find_field(line, "result");
+    std::optional<std::string> result = pos == std::string::npos ? std::nullopt : results_log::read_string(line, pos);
+    pos = results_log::find_field(line, "moves");
+    if (!result || pos == std::string::npos || pos >= line.size() || line[pos] != '[') {
+        return std::nullopt;
+    }
+    game.result = *result;
+    for (++pos; pos < line.size() && line[pos] != ']';) {
+        if (line[pos] == ',' || line[pos] == ' ') {
+            ++pos;
+            continue;
+        }
+        std::optional<std::string> san = results_log::read_string(line, pos);
+        if (!san) {
+            return std::nullopt;
+        }
+        game.moves_san.push_back(std::move(*san));
+    }
+    pos = results_log::find_field(line, "start_fen");
+    if (pos != std::string::npos) {
+        game.start_fen = results_log::read_string(line, pos).value_or(std::string());
+    }
+    return game;
+}
+
+}  // namespace
+
+OpeningSuite::OpeningSuite(std::vector<std::string> fens) : fens_(std::move(fens)) {}
+
+OpeningSuite OpeningSuite::load(const std::string& path, int max_plies) {
+    std::ifstream stream(path);
+    if (!stream) {
+        throw std::runtime_error("Failed to open openings file: " + path);
+    }
+    std::vector<std::string> fens = has_pgn_extension(path) ? load_pgn(stream, max_plies) : load_epd(stream, path);
+    if (fens.empty()) {
+        throw std::runtime_error("No openings found in " + path);
+    }
+    return OpeningSuite(std::move(fens));
+}
+
+OpeningBookBuilder::OpeningBookBuilder(int max_plies) : max_plies_(std::max(1, max_plies)) {}
+
+void OpeningBookBuilder::add_game(const std::string& start_fen, const std::vector<std::string>& moves_san,
+                                  const std::string& result) {
+    int white_points = result == "1-0" ? 2 : result == "0-1" ? 0 : result == "1/2-1/2" ? 1 : -1;
+    if (white_points < 0) {
+        return;
+    }
+    Board board = start_board(start_fen);
+    std::size_t plies = std::min(moves_san.size(), static_cast<std::size_t>(max_plies_));
+    for (std::size_t ply = 0; ply < plies; ++ply) {
+        Move move = san_to_move(board, moves_san[ply]);
+        int points = board.side_to_move() == Color::White ? white_points : 2 - white_points;
+        Tally& tally = tallies_[{OpeningBook::polyglot_key(board), OpeningBook::encode_move(move)}];
+        ++tally.games;
+        tally.points += static_cast<std::uint32_t>(points);
+        Board::State state;
+        board.make_move(move, state);
+    }
+    ++games_;
+}
+
+std::size_t OpeningBookBuilder::add_file(const std::string& path) {
+    std::ifstream stream(path);
+    if (!stream) {
+        throw std::runtime_error("Failed to open games file: " + path);
+    }
+    std::size_t before = games_;
+    if (has_pgn_extension(path)) {
+        for (const PgnGame& game : parse_pgn(stream)) {
+            add_game(game.start_fen, game.moves_san, game.result);
+        }
+        return games_ - before;
+    }
+    std::string line;
+    std::size_t line_number = 0;
+    while (std::getline(stream, line)) {
+        ++line_number;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        std::optional<PgnGame> game = parse_results_line(line);
+        if (!game) {
+            throw std::runtime_error("Malformed results line " + std::to_string(line_number) + " in " + path);
+        }
+        add_game(game->start_fen, game->moves_san, game->result);
+    }
+    return games_ - before;
+}
+
+std::size_t OpeningBookBuilder::write(const std::string& path, int min_games) const {
+    std::vector<BookEntry> entries;
+    for (const auto& [position, tally] : tallies_) {
+        if (tally.games < static_cast<std::uint32_t>(std::max(1, min_games))) {
+            continue;
+        }
+        BookEntry entry;
+        entry.key = position.first;
+        entry.move = position.second;
+        entry.weight = static_cast<std::uint16_t>(std::min<std::uint32_t>(tally.points, 0xFFFFU));
+        entries.push_back(entry);
+    }
+    std::size_t count = entries.size();
+    OpeningBook::write(path, std::move(entries));
+    return count;
+}
+
+GamePairScheduler::GamePairScheduler(int total_games, bool alternate_colors,
+                                     std::shared_ptr<const OpeningSuite> openings)
+    : total_games_(std::max(0, total_games)), alternate_colors_(alternate_colors), openings_(std::move(openings)) {}
+
+GameAssignment GamePairScheduler::assignment(int game_index) const {
+    GameAssignment assignment;
+    assignment.game_index = game_index;
+    assignment.pair_index = game_index / 2;
+    if (alternate_colors_) {
+        bool flip_pair_orientation = (assignment.pair_index % 2) == 1;
+        bool second_game_in_pair = (game_index % 2) == 1;
+        assignment.swap_colors = flip_pair_orientation != second_game_in_pair;
+    }
+    if (openings_ && !openings_->empty()) {
+        assignment.start_fen = openings_->fen(static_cast<std::size_t>(assignment.pair_index) % openings_->size());
+    }
+    return assignment;
+}
+
+std::optional<GameAssignment> GamePairScheduler::next() {
+    int game = next_game_.fetch_add(1);
+    if (game >= total_games_) {
+        return std::nullopt;
+    }
+    return assignment(game);
+}
+
+}  // namespace chiron
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace chiron {
+
+/**
+ * @brief Start positions for self-play and matches, read from an EPD or PGN file.
+ */
+class OpeningSuite {
+   public:
+    OpeningSuite() = default;
+    explicit OpeningSuite(std::vector<std::string> fens);
+
+    /**
+     * @brief Loads @p path: a ".pgn" file contributes the position after each game's moves
+     *        (at most @p max_plies of them when positive), anything else is read as EPD with
+     *        one position per line and its opcodes ignored.
+     */
+    static OpeningSuite load(const std::string& path, int max_plies = 0);
+
+    [[nodiscard]] std::size_t size() const { return fens_.size(); }
+    [[nodiscard]] bool empty() const { return fens_.empty(); }
+    [[nodiscard]] const std::string& fen(std::size_t index) const { return fens_[index]; }
+
+   private:
+    std::vector<std::string> fens_;
+};
+
+/**
+ * @brief Tallies finished games into an OpeningBook file.
+ *
+ * Each move in the first plies of a game counts under the position it was played from, two
+ * points for a win by the side that played it and one for a draw. The book weight is that total,
+ * as Polyglot books weigh moves, so a move that only ever lost is kept with weight 0 and never
+ * played. Unfinished games ("*") are skipped.
+ */
+class OpeningBookBuilder {
+   public:
+    explicit OpeningBookBuilder(int max_plies = 16);
+
+    /** @brief Adds one game of SAN moves from @p start_fen (empty for the start position). */
+    void add_game(const std::string& start_fen, const std::vector<std::string>& moves_san, const std::string& result);
+
+    /**
+     * @brief Adds every game in @p path: a ".pgn" database, or anything else as a self-play
+     *        results log (JSONL with "start_fen", "result" and "moves"). Returns the games added.
+     */
+    std::size_t add_file(const std::string& path);
+
+    /**
+     * @brief Writes the moves played in at least @p min_games games as a book and returns the
+     *        number of entries written.
+     */
+    std::size_t write(const std::string& path, int min_games = 1) const;
+
+    [[nodiscard]] std::size_t games() const { return games_; }
+    /** @brief Distinct (position, move) pairs tallied so far. */
+    [[nodiscard]] std::size_t move_count() const { return tallies_.size(); }
+
+   private:
+    struct Tally {
+        std::uint32_t games = 0;
+        std::uint32_t points = 0;
+    };
+
+    int max_plies_;
+    std::size_t games_ = 0;
+    std::map<std::pair<std::uint64_t, std::uint16_t>, Tally> tallies_;  // Keyed by (position key, book move).
+};
+
+/**
+ * @brief What one scheduled game plays: its colours and its start position.
+ */
+struct GameAssignment {
+    int game_index = 0;
+    int pair_index = 0;
+    bool swap_colors = false; /**< Play the configured black engine as white. */
+    std::string start_fen;    /**< Empty for the standard start position. */
+};
+
+/**
+ * @brief Hands out games as colour-swapped pairs that share one opening.
+ *
+ * Games 2p and 2p+1 form pair p and start from opening p (cycling through the suite); with
+ * colour alternation the second game swaps colours, and every other pair starts swapped so
+ * neither engine always opens a pair as white. next() may be called from any thread.
+ */
+class GamePairScheduler {
+   public:
+    GamePairScheduler(int total_games, bool alternate_colors, std::shared_ptr<const OpeningSuite> openings = nullptr);
+
+    /** @brief Assignment of @p game_index, independent of the order games are handed out in. */
+    [[nodiscard]] GameAssignment assignment(int game_index) const;
+
+    /** @brief Claims the next unplayed game, or nullopt once all have been handed out. */
+    std::optional<GameAssignment> next();
+
+    [[nodiscard]] int total_games() const { return total_games_; }
+
+   private:
+    int total_games_ = 0;
+    bool alternate_colors_ = true;
+    std::shared_ptr<const OpeningSuite> openings_;
+    std::atomic<int> next_game_{0};
+};
+
+}  // namespace chiron
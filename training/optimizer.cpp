@@ -0,0 +1,130 @@
+#include "training/optimizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace chiron {
+
+namespace {
+
+std::string lowercase(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+std::int32_t quantize(float value) {
+    return static_cast<std::int32_t>(
+        std::clamp(std::lrint(value), static_cast<long>(-kTrainerWeightLimit), static_cast<long>(kTrainerWeightLimit)));
+}
+
+constexpr double kNominalWeight = 100.0;
+
+}  // namespace
+
+OptimizerKind parse_optimizer_kind(const std::string& value) {
+    std::string lower = lowercase(value);
+    if (lower == "sgd") {
+        return OptimizerKind::kSgd;
+    }
+    if (lower == "adam") {
+        return OptimizerKind::kAdam;
+    }
+    if (lower == "adamw") {
+        return OptimizerKind::kAdamW;
+    }
+    throw std::invalid_argument("Unknown optimizer: " + value + " (expected sgd, adam or adamw)");
+}
+
+const char* optimizer_name(OptimizerKind kind) {
+    switch (kind) {
+        case OptimizerKind::kAdam:
+            return "adam";
+        case OptimizerKind::kAdamW:
+            return "adamw";
+        case OptimizerKind::kSgd:
+            break;
+    }
+    return "sgd";
+}
+
+LearningRateSchedule parse_learning_rate_schedule(const std::string& value) {
+    std::string lower = lowercase(value);
+    if (lower == "constant") {
+        return LearningRateSchedule::kConstant;
+    }
+    if (lower == "cosine") {
+        return LearningRateSchedule::kCosine;
+    }
+    throw std::invalid_argument("Unknown learning-rate schedule: " + value + " (expected constant or cosine)");
+}
+
+double learning_rate_factor(const OptimizerConfig& config, std::size_t step) {
+    double factor = 1.0;
+    if (config.warmup_steps > 0 && step < config.warmup_steps) {
+        factor = static_cast<double>(step) / static_cast<double>(config.warmup_steps);
+    }
+    if (config.schedule == LearningRateSchedule::kCosine && config.decay_steps > 0) {
+        double progress = std::min(1.0, static_cast<double>(step) / static_cast<double>(config.decay_steps));
+        double cosine = 0.5 * (1.0 + std::cos(progress * 3.14159265358979323846));
+        factor *= config.final_rate_fraction + (1.0 - config.final_rate_fraction) * cosine;
+    }
+    return factor;
+}
+
+AdamStep AdamStep::make(const OptimizerConfig& config, double learning_rate, double regularisation,
+                        std::size_t step) {
+    double factor = learning_rate_factor(config, step);
+    double exponent = static_cast<double>(step);
+    AdamStep result;
+    result.step_size = static_cast<float>(learning_rate * factor);
+    result.beta1 = static_cast<float>(config.beta1);
+    result.beta2 = static_cast<float>(config.beta2);
+    result.inverse_correction1 = static_cast<float>(1.0 / (1.0 - std::pow(config.beta1, exponent)));
+    result.inverse_correction2 = static_cast<float>(1.0 / (1.0 - std::pow(config.beta2, exponent)));
+    result.epsilon = static_cast<float>(config.epsilon);
+    if (config.kind == OptimizerKind::kAdamW) {
+        // Decoupled decay is rate x regularisation as usual, with the rate (in weight units)
+        // first made relative to a nominal weight of one pawn.
+        result.decoupled_decay = static_cast<float>(learning_rate * factor * regularisation / kNominalWeight);
+    } else {
+        result.l2 = static_cast<float>(regularisation);
+    }
+    return result;
+}
+
+void MasterWeights::load(const nnue::Network& network) {
+    hidden_ = network.hidden_size();
+    feature_set_ = network.feature_set();
+    scale_ = network.scale();
+    step_ = 0;
+
+    const auto& inputs = network.input_weights_data();
+    input_.assign(inputs.begin(), inputs.end());
+    input_m_.assign(input_.size(), 0.0F);
+    input_v_.assign(input_.size(), 0.0F);
+    const auto& hidden_biases = network.hidden_biases_data();
+    hidden_biases_.assign(hidden_biases.begin(), hidden_biases.end());
+    hidden_bias_m_.assign(hidden_, 0.0F);
+    hidden_bias_v_.assign(hidden_, 0.0F);
+    const auto& outputs = network.output_weights_data();
+    output_.assign(outputs.begin(), outputs.end());
+    output_m_.assign(hidden_, 0.0F);
+    output_v_.assign(hidden_, 0.0F);
+    bias_ = static_cast<float>(network.bias());
+    bias_m_ = 0.0F;
+    bias_v_ = 0.0F;
+}
+
+void MasterWeights::store(nnue::Network& network) const {
+    auto& inputs = network.input_weights_data();
+    std::transform(input_.begin(), input_.end(), inputs.begin(), quantize);
+    auto& hidden_biases = network.hidden_biases_data();
+    std::transform(hidden_biases_.begin(), hidden_biases_.end(), hidden_biases.begin(), quantize);
+    auto& outputs = network.output_weights_data();
+    std::copy(output_.begin(), output_.end(), outputs.begin());
+    network.set_bias(quantize(bias_));
+}
+
+}  // namespace chiron
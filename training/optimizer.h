@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nnue/network.h"
+
+#if defined(__CUDACC__)
+#define CHIRON_HOST_DEVICE __host__ __device__
+#else
+#define CHIRON_HOST_DEVICE
+#endif
+
+namespace chiron {
+
+constexpr int kTrainerWeightLimit = 40000;
+
+enum class OptimizerKind {
+    kSgd,    /**< Per-batch gradient step applied straight to the integer weights. */
+    kAdam,   /**< Adam on float master weights; regularisation acts as an L2 penalty. */
+    kAdamW,  /**< Adam with regularisation applied as decoupled weight decay. */
+};
+
+enum class LearningRateSchedule {
+    kConstant,
+    kCosine,  /**< Cosine decay from the base rate to final_rate_fraction over decay_steps. */
+};
+
+/**
+ * @brief Optimiser selection and hyper-parameters shared by the CPU and CUDA trainers.
+ *
+ * With Adam the learning rate is the per-step change of a weight in its own units
+ * (centipawn-scaled for inputs and biases; output weights are stepped 1/kActivationScale as
+ * far, matching their smaller magnitude), so values of 1-4 are sensible where SGD needs a
+ * few hundredths.
+ */
+struct OptimizerConfig {
+    OptimizerKind kind = OptimizerKind::kSgd;
+    double beta1 = 0.9;
+    double beta2 = 0.999;
+    double epsilon = 1e-8;
+    LearningRateSchedule schedule = LearningRateSchedule::kConstant;
+    std::size_t warmup_steps = 0;  /**< Steps of linear warm-up from zero. */
+    std::size_t decay_steps = 0;   /**< Horizon of the cosine schedule; 0 keeps the rate constant. */
+    double final_rate_fraction = 0.1;
+};
+
+constexpr double kDefaultAdamLearningRate = 2.0;
+
+OptimizerKind parse_optimizer_kind(const std::string& value);
+const char* optimizer_name(OptimizerKind kind);
+LearningRateSchedule parse_learning_rate_schedule(const std::string& value);
+
+/** @brief Multiplier applied to the base learning rate at 1-based @p step. */
+double learning_rate_factor(const OptimizerConfig& config, std::size_t step);
+
+/**
+ * @brief Per-step Adam constants; plain data so CUDA kernels can take it by value.
+ */
+struct AdamStep {
+    float step_size = 0.0F;
+    float beta1 = 0.9F;
+    float beta2 = 0.999F;
+    float inverse_correction1 = 1.0F;  // 1 / (1 - beta1^t)
+    float inverse_correction2 = 1.0F;  // 1 / (1 - beta2^t)
+    float epsilon = 1e-8F;
+    float l2 = 0.0F;               // Coupled penalty per sample (Adam).
+    float decoupled_decay = 0.0F;  // Fraction of the weight removed this step (AdamW).
+
+    static AdamStep make(const OptimizerConfig& config, double learning_rate, double regularisation,
+                         std::size_t step);
+};
+
+/**
+ * @brief Applies one Adam update to @p weight from the summed descent direction of @p samples
+ *        samples; @p step_scale rescales the step for the parameter group, and a positive
+ *        @p limit clamps the result.
+ */
+CHIRON_HOST_DEVICE inline void adam_update(float& weight, float& first_moment, float& second_moment, float descent,
+                                           float samples, const AdamStep& step, float step_scale, float limit) {
+    float gradient = descent - step.l2 * samples * weight;
+    first_moment = step.beta1 * first_moment + (1.0F - step.beta1) * gradient;
+    second_moment = step.beta2 * second_moment + (1.0F - step.beta2) * gradient * gradient;
+    weight -= step.decoupled_decay * weight;
+    float m_hat = first_moment * step.inverse_correction1;
+    float v_hat = second_moment * step.inverse_correction2;
+    weight += step.step_size * step_scale * m_hat / (sqrtf(v_hat) + step.epsilon);
+    if (limit > 0.0F) {
+        weight = fminf(fmaxf(weight, -limit), limit);
+    }
+}
+
+/** @brief Step multiplier of the output-weight group (see OptimizerConfig). */
+constexpr float kOutputStepScale = static_cast<float>(1.0 / nnue::kActivationScale);
+
+/**
+ * @brief Float master copy of a network plus its Adam moments, for the CPU trainer.
+ *
+ * Training steps update these; the integer runtime network is only rebuilt from them by
+ * store(), when the weights are read or saved. Accessors mirror nnue::Network's so the
+ * trainer's forward pass runs on either.
+ */
+class MasterWeights {
+   public:
+    void load(const nnue::Network& network);
+    /** @brief Quantises into @p network: integer parameters are rounded and clamped. */
+    void store(nnue::Network& network) const;
+
+    [[nodiscard]] std::size_t hidden_size() const { return hidden_; }
+    [[nodiscard]] nnue::FeatureSet feature_set() const { return feature_set_; }
+    [[nodiscard]] float scale() const { return scale_; }
+    [[nodiscard]] const float* feature_weights(std::size_t feature) const { return &input_[feature * hidden_]; }
+    [[nodiscard]] float hidden_bias(std::size_t neuron) const { return hidden_biases_[neuron]; }
+    [[nodiscard]] float output_weight(std::size_t neuron) const { return output_[neuron]; }
+    [[nodiscard]] float bias() const { return bias_; }
+
+    /** @brief Advances the step counter and returns the new (1-based) step. */
+    std::size_t next_step() { return ++step_; }
+
+    float* feature_row(std::size_t feature) { return &input_[feature * hidden_]; }
+    float* feature_first_moments(std::size_t feature) { return &input_m_[feature * hidden_]; }
+    float* feature_second_moments(std::size_t feature) { return &input_v_[feature * hidden_]; }
+
+    std::vector<float>& hidden_biases() { return hidden_biases_; }
+    std::vector<float>& hidden_bias_first_moments() { return hidden_bias_m_; }
+    std::vector<float>& hidden_bias_second_moments() { return hidden_bias_v_; }
+    std::vector<float>& output_weights() { return output_; }
+    std::vector<float>& output_first_moments() { return output_m_; }
+    std::vector<float>& output_second_moments() { return output_v_; }
+    float& bias_value() { return bias_; }
+    float& bias_first_moment() { return bias_m_; }
+    float& bias_second_moment() { return bias_v_; }
+
+   private:
+    std::size_t hidden_ = 0;
+    nnue::FeatureSet feature_set_ = nnue::FeatureSet::PieceSquare;
+    float scale_ = 1.0F;
+    std::size_t step_ = 0;
+    std::vector<float> input_, input_m_, input_v_;
+    std::vector<float> hidden_biases_, hidden_bias_m_, hidden_bias_v_;
+    std::vector<float> output_, output_m_, output_v_;
+    float bias_ = 0.0F, bias_m_ = 0.0F, bias_v_ = 0.0F;
+};
+
+}  // namespace chiron
@@ -0,0 +1,128 @@
+#include "training/packed_position.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace chiron {
+
+namespace {
+
+constexpr std::array<char, 4> kPackedMagic{'C', 'B', 'I', 'N'};
+constexpr std::uint32_t kPackedVersion = 1;
+
+/**
+ * @brief 16-byte file header; records follow immediately and stay 16-byte aligned.
+ */
+struct PackedFileHeader {
+    std::array<char, 4> magic = kPackedMagic;
+    std::uint32_t version = kPackedVersion;
+    std::uint32_t record_size = sizeof(PackedPosition);
+    std::uint32_t reserved = 0;
+};
+
+static_assert(sizeof(PackedFileHeader) == 16, "PackedFileHeader must stay 16 bytes");
+
+}  // namespace
+
+PackedPosition PackedPosition::from_board(const Board& board, int score, PackedResult result) {
+    PackedPosition packed;
+    packed.occupancy = board.occupancy_all();
+    if (popcount(packed.occupancy) > 32) {
+        throw std::invalid_argument("Cannot pack a position with more than 32 pieces");
+    }
+
+    int index = 0;
+    Bitboard occupied = packed.occupancy;
+    while (occupied) {
+        int square = pop_lsb(occupied);
+        std::uint8_t code = encode_piece(*board.color_at(square), board.piece_type_at(square));
+        packed.pieces[static_cast<std::size_t>(index / 2)] |=
+            static_cast<std::uint8_t>(code << ((index % 2) * 4));
+        ++index;
+    }
+
+    packed.score = static_cast<std::int16_t>(std::clamp(score, static_cast<int>(std::numeric_limits<std::int16_t>::min()),
+                                                        static_cast<int>(std::numeric_limits<std::int16_t>::max())));
+    packed.flags = static_cast<std::uint8_t>((board.side_to_move() == Color::Black ? kBlackToMove : 0) |
+                                             (board.castling_rights() << kCastlingShift));
+    packed.en_passant =
+        board.en_passant_square() >= 0 ? static_cast<std::uint8_t>(board.en_passant_square()) : kNoEnPassant;
+    packed.halfmove_clock = static_cast<std::uint8_t>(std::min(board.halfmove_clock(), 255));
+    packed.result = result;
+    packed.fullmove_number = static_cast<std::uint16_t>(std::clamp(board.fullmove_number(), 1, 65535));
+    return packed;
+}
+
+void PackedPosition::to_board(Board& board) const {
+    std::array<std::uint8_t, kBoardSize> squares;
+    squares.fill(kEmptySquare);
+
+    int index = 0;
+    Bitboard occupied = occupancy;
+    while (occupied) {
+        int square = pop_lsb(occupied);
+        squares[static_cast<std::size_t>(square)] =
+            static_cast<std::uint8_t>((pieces[static_cast<std::size_t>(index / 2)] >> ((index % 2) * 4)) & 0x0F);
+        ++index;
+    }
+
+    board.set_from_placement(squares, side_to_move(), static_cast<std::uint8_t>(flags >> kCastlingShift),
+                             en_passant == kNoEnPassant ? -1 : static_cast<int>(en_passant), halfmove_clock,
+                             fullmove_number);
+}
+
+bool is_packed_training_file(const std::string& path) {
+    std::ifstream stream(path, std::ios::binary);
+    std::array<char, 4> magic{};
+    if (!stream.read(magic.data(), static_cast<std::streamsize>(magic.size()))) {
+        return false;
+    }
+    return magic == kPackedMagic;
+}
+
+PackedPositionWriter::PackedPositionWriter(const std::string& path)
+    : stream_(path, std::ios::binary | std::ios::out | std::ios::trunc), path_(path) {
+    if (!stream_) {
+        throw std::runtime_error("Failed to open packed training file for writing: " + path);
+    }
+    PackedFileHeader header;
+    stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void PackedPositionWriter::write(const PackedPosition& position) {
+    stream_.write(reinterpret_cast<const char*>(&position), sizeof(position));
+    ++count_;
+}
+
+void PackedPositionWriter::close() {
+    stream_.flush();
+    bool ok = static_cast<bool>(stream_);
+    stream_.close();
+    if (!ok) {
+        throw std::runtime_error("Failed to write packed training file: " + path_);
+    }
+}
+
+PackedPositionReader::PackedPositionReader(const std::string& path) : file_(nnue::MappedFile::open(path)) {
+    PackedFileHeader header;
+    if (file_->size() < sizeof(header)) {
+        throw std::runtime_error("Packed training file is truncated: " + path);
+    }
+    std::memcpy(&header, file_->data(), sizeof(header));
+    if (header.magic != kPackedMagic) {
+        throw std::runtime_error("Not a packed training file: " + path);
+    }
+    if (header.version != kPackedVersion || header.record_size != sizeof(PackedPosition)) {
+        throw std::runtime_error("Unsupported packed training file version: " + path);
+    }
+    std::size_t payload = file_->size() - sizeof(header);
+    if (payload % sizeof(PackedPosition) != 0) {
+        throw std::runtime_error("Packed training file has a partial record: " + path);
+    }
+    records_ = reinterpret_cast<const PackedPosition*>(file_->data() + sizeof(header));
+    count_ = payload / sizeof(PackedPosition);
+}
+
+}  // namespace chiron
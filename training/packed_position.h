@@ -0,0 +1,105 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "bitboard.h"
+#include "board.h"
+#include "nnue/mapped_file.h"
+
+namespace chiron {
+
+/**
+ * @brief Outcome of the game a packed position was taken from, from White's point of view.
+ */
+enum class PackedResult : std::uint8_t { Unknown = 0, WhiteWin = 1, Draw = 2, BlackWin = 3 };
+
+/**
+ * @brief Fixed 32-byte binary training record.
+ *
+ * The occupancy bitboard says where pieces stand; `pieces` holds one encode_piece() nibble per
+ * set bit, lowest square first and low nibble first, which covers the at most 32 pieces of a
+ * legal position. Flags pack the side to move (bit 0) and the castling rights (bits 1-4).
+ * Files store records in little-endian byte order, as written on every supported target.
+ */
+struct PackedPosition {
+    static constexpr std::uint8_t kBlackToMove = 1U << 0;
+    static constexpr int kCastlingShift = 1;
+    static constexpr std::uint8_t kNoEnPassant = kBoardSize;
+
+    Bitboard occupancy = 0ULL;
+    std::array<std::uint8_t, 16> pieces{};
+    std::int16_t score = 0;  /**< Target centipawns from the side to move's view. */
+    std::uint8_t flags = 0;
+    std::uint8_t en_passant = kNoEnPassant;
+    std::uint8_t halfmove_clock = 0;
+    PackedResult result = PackedResult::Unknown;
+    std::uint16_t fullmove_number = 1;
+
+    /**
+     * @brief Packs @p board; the clocks saturate at their field widths and @p score is clamped
+     *        to int16. Throws std::invalid_argument for boards with more than 32 pieces.
+     */
+    static PackedPosition from_board(const Board& board, int score, PackedResult result = PackedResult::Unknown);
+
+    /** @brief Sets @p board to the packed position without parsing any text. */
+    void to_board(Board& board) const;
+
+    [[nodiscard]] Color side_to_move() const { return (flags & kBlackToMove) ? Color::Black : Color::White; }
+};
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay a 32-byte record");
+
+/**
+ * @brief True when @p path starts with the packed training data header.
+ */
+[[nodiscard]] bool is_packed_training_file(const std::string& path);
+
+/**
+ * @brief Streams PackedPosition records to a file behind a small header.
+ */
+class PackedPositionWriter {
+   public:
+    explicit PackedPositionWriter(const std::string& path);
+
+    void write(const PackedPosition& position);
+
+    /** @brief Flushes the file; throws std::runtime_error if any write failed. */
+    void close();
+
+    [[nodiscard]] std::size_t count() const { return count_; }
+
+   private:
+    std::ofstream stream_;
+    std::string path_;
+    std::size_t count_ = 0;
+};
+
+/**
+ * @brief Memory-mapped, random-access view of a packed training file.
+ *
+ * Records are read straight from the mapping, so iterating a dataset costs no parsing and no
+ * copy beyond what the page cache already holds.
+ */
+class PackedPositionReader {
+   public:
+    /** @brief Maps @p path; throws std::runtime_error unless it is a well-formed packed file. */
+    explicit PackedPositionReader(const std::string& path);
+
+    [[nodiscard]] std::size_t size() const { return count_; }
+    [[nodiscard]] bool empty() const { return count_ == 0; }
+    [[nodiscard]] const PackedPosition& operator[](std::size_t index) const { return records_[index]; }
+    [[nodiscard]] const PackedPosition* begin() const { return records_; }
+    [[nodiscard]] const PackedPosition* end() const { return records_ + count_; }
+
+   private:
+    std::shared_ptr<const nnue::MappedFile> file_;
+    const PackedPosition* records_ = nullptr;
+    std::size_t count_ = 0;
+};
+
+}  // namespace chiron
@@ -1,49 +1,26 @@
 #include "training/pgn_importer.h"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+#include <utility>
 
 #include "notation.h"
+#include "training/pgn_tokens.h"
 
 namespace chiron {
 
 namespace {
 
-std::string strip_comments(const std::string& input) {
-    std::string output;
-    output.reserve(input.size());
-    bool in_brace = false;
-    int paren_depth = 0;
-    for (std::size_t i = 0; i < input.size(); ++i) {
-        char c = input[i];
-        if (c == '{') {
-            in_brace = true;
-            continue;
-        }
-        if (c == '}') {
-            in_brace = false;
-            continue;
-        }
-        if (c == '(') {
-            ++paren_depth;
-            continue;
-        }
-        if (c == ')') {
-            if (paren_depth > 0) {
-                --paren_depth;
-            }
-            continue;
-        }
-        if (!in_brace && paren_depth == 0) {
-            output.push_back(c);
-        }
-    }
-    return output;
-}
-
 std::string trim(const std::string& value) {
     auto is_space = [](unsigned char c) { return std::isspace(c) != 0; };
     auto begin = std::find_if_not(value.begin(), value.end(), is_space);
@@ -54,31 +31,56 @@ std::string trim(const std::string& value) {
     return std::string(begin, end);
 }
 
-bool is_move_number(const std::string& token) {
-    return !token.empty() && std::isdigit(static_cast<unsigned char>(token.front()));
-}
-
-bool is_result_token(const std::string& token) {
-    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+/** @brief True when the last token of @p line is a game result. */
+bool ends_with_result(const std::string& line) {
+    std::string trimmed = trim(line);
+    std::size_t space = trimmed.find_last_of(" \t");
+    return pgn::is_result_token(space == std::string::npos ? trimmed : trimmed.substr(space + 1));
 }
 
-int orient_target_for_fen(const std::string& fen, int target) {
-    if (target == 0) {
-        return 0;
+PackedResult packed_result(const std::string& result) {
+    if (result == "1-0") {
+        return PackedResult::WhiteWin;
     }
-    std::size_t space = fen.find(' ');
-    if (space == std::string::npos || space + 1 >= fen.size()) {
-        return target;
+    if (result == "0-1") {
+        return PackedResult::BlackWin;
     }
-    char side_to_move = fen[space + 1];
-    if (side_to_move == 'b' || side_to_move == 'B') {
-        return -target;
+    if (result == "1/2-1/2") {
+        return PackedResult::Draw;
     }
-    return target;
+    return PackedResult::Unknown;
 }
 
+/**
+ * @brief Tracks whether a line-by-line scan sits inside a {comment} or (variation).
+ */
+struct CommentState {
+    bool in_brace = false;
+    int paren_depth = 0;
+
+    [[nodiscard]] bool inside() const { return in_brace || paren_depth > 0; }
+
+    void scan(const std::string& line) {
+        for (char c : line) {
+            if (in_brace) {
+                in_brace = c != '}';
+            } else if (c == '{') {
+                in_brace = true;
+            } else if (c == '(') {
+                ++paren_depth;
+            } else if (c == ')' && paren_depth > 0) {
+                --paren_depth;
+            }
+        }
+    }
+};
+
 }  // namespace
 
+PgnImporter::PgnImporter(std::size_t threads, std::size_t chunk_bytes)
+    : threads_(threads != 0 ? threads : std::max(1U, std::thread::hardware_concurrency())),
+      chunk_bytes_(std::max<std::size_t>(chunk_bytes, 1)) {}
+
 int PgnImporter::result_to_target(const std::string& result_tag) {
     if (result_tag == "1-0") {
         return 1000;
@@ -92,40 +94,47 @@ int PgnImporter::result_to_target(const std::string& result_tag) {
     return 0;
 }
 
-std::vector<TrainingExample> PgnImporter::import_file(const std::string& path, bool include_draws) const {
-    std::ifstream stream(path);
-    if (!stream) {
-        throw std::runtime_error("Failed to open PGN file: " + path);
-    }
-
-    std::ostringstream buffer;
-    buffer << stream.rdbuf();
-    std::string content = strip_comments(buffer.str());
-
-    std::istringstream iss(content);
+std::size_t PgnImporter::parse_games(const std::string& text, bool include_draws, std::vector<PackedPosition>& out) {
+    std::istringstream iss(pgn::strip_comments(text));
     std::string token;
     Board board;
     board.set_start_position();
-    std::vector<std::string> positions;
+    std::vector<PackedPosition> positions;
     std::string current_result;
-    std::vector<TrainingExample> examples;
+    std::size_t games = 0;
+    bool in_headers = false;
+
+    auto flush = [&](const std::string& result) {
+        if (positions.empty()) {
+            return;
+        }
+        ++games;
+        int target = result_to_target(result);
+        if (include_draws || target != 0) {
+            PackedResult outcome = packed_result(result);
+            for (PackedPosition& position : positions) {
+                int oriented = position.side_to_move() == Color::Black ? -target : target;
+                position.score = static_cast<std::int16_t>(oriented);
+                position.result = outcome;
+                out.push_back(position);
+            }
+        }
+        positions.clear();
+    };
 
     while (iss >> token) {
         if (token.empty()) {
             continue;
         }
         if (token.front() == '[') {
-            if (!positions.empty() && !current_result.empty()) {
-                int target = result_to_target(current_result);
-                if (include_draws || target != 0) {
-                    for (const std::string& fen : positions) {
-                        examples.push_back({fen, orient_target_for_fen(fen, target)});
-                    }
-                }
-                positions.clear();
+            // Only the first tag of a header block starts a new game; later tags such as
+            // [Termination] or [FEN] must not discard the [Result] read before them.
+            if (!in_headers) {
+                flush(current_result);
+                board.set_start_position();
+                current_result.clear();
+                in_headers = true;
             }
-            board.set_start_position();
-            current_result.clear();
 
             std::string header = token;
             while (!header.empty() && header.back() != ']') {
@@ -152,27 +161,27 @@ std::vector<TrainingExample> PgnImporter::import_file(const std::string& path, b
                 }
                 if (tag_name == "Result") {
                     current_result = tag_value;
+                } else if (tag_name == "FEN") {
+                    try {
+                        board.set_from_fen(tag_value);
+                    } catch (const std::exception&) {
+                        board.set_start_position();
+                    }
                 }
             }
             continue;
         }
+        in_headers = false;
 
-        if (is_move_number(token)) {
+        // Results start with a digit too, so they must be recognised before move numbers.
+        if (pgn::is_result_token(token)) {
+            flush(!current_result.empty() ? current_result : token);
+            board.set_start_position();
+            current_result.clear();
             continue;
         }
 
-        if (is_result_token(token)) {
-            if (!positions.empty()) {
-                int target = result_to_target(!current_result.empty() ? current_result : token);
-                if (include_draws || target != 0) {
-                    for (const std::string& fen : positions) {
-                        examples.push_back({fen, orient_target_for_fen(fen, target)});
-                    }
-                }
-                positions.clear();
-            }
-            board.set_start_position();
-            current_result.clear();
+        if (pgn::is_move_number(token)) {
             continue;
         }
 
@@ -182,32 +191,189 @@ std::vector<TrainingExample> PgnImporter::import_file(const std::string& path, b
         }
 
         try {
-            std::string fen = board.fen();
             Move move = san_to_move(board, san);
+            PackedPosition before = PackedPosition::from_board(board, 0);
             Board::State state;
             board.make_move(move, state);
-            positions.push_back(std::move(fen));
+            positions.push_back(before);
         } catch (const std::exception&) {
             // Skip malformed moves.
         }
     }
 
-    if (!positions.empty()) {
-        int target = result_to_target(current_result);
-        if (include_draws || target != 0) {
-            for (const std::string& fen : positions) {
-                examples.push_back({fen, orient_target_for_fen(fen, target)});
+    flush(current_result);
+    return games;
+}
+
+PgnImporter::Stats PgnImporter::stream_file(const std::string& path, bool include_draws, const Sink& sink) const {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        throw std::runtime_error("Failed to open PGN file: " + path);
+    }
+
+    std::mutex mutex;
+    std::condition_variable work_cv;
+    std::condition_variable space_cv;
+    std::deque<std::pair<std::size_t, std::string>> pending;
+    std::map<std::size_t, std::vector<PackedPosition>> parsed;
+    std::size_t next_to_emit = 0;
+    std::size_t in_flight = 0;
+    bool reading_done = false;
+    std::exception_ptr failure;
+    Stats stats;
+    const std::size_t max_in_flight = threads_ * 2;
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            work_cv.wait(lock, [&]() { return !pending.empty() || reading_done || failure; });
+            if (failure || pending.empty()) {
+                return;
+            }
+            auto [index, text] = std::move(pending.front());
+            pending.pop_front();
+            lock.unlock();
+
+            std::vector<PackedPosition> positions;
+            std::size_t games = 0;
+            try {
+                games = parse_games(text, include_draws, positions);
+            } catch (...) {
+                lock.lock();
+                failure = std::current_exception();
+                work_cv.notify_all();
+                space_cv.notify_all();
+                return;
+            }
+
+            lock.lock();
+            stats.games += games;
+            parsed.emplace(index, std::move(positions));
+            // Whichever worker completes the oldest outstanding chunk hands the run of finished
+            // chunks to the sink, which keeps the output ordered and the sink single-threaded.
+            for (auto it = parsed.find(next_to_emit); it != parsed.end() && !failure; it = parsed.find(next_to_emit)) {
+                try {
+                    sink(it->second);
+                } catch (...) {
+                    failure = std::current_exception();
+                    work_cv.notify_all();
+                    break;
+                }
+                stats.positions += it->second.size();
+                parsed.erase(it);
+                ++next_to_emit;
+                --in_flight;
             }
+            space_cv.notify_all();
         }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads_);
+    for (std::size_t i = 0; i < threads_; ++i) {
+        workers.emplace_back(worker);
     }
 
+    std::size_t next_index = 0;
+    auto submit = [&](std::string&& chunk) {
+        std::unique_lock<std::mutex> lock(mutex);
+        space_cv.wait(lock, [&]() { return in_flight < max_in_flight || failure; });
+        if (failure) {
+            return false;
+        }
+        pending.emplace_back(next_index++, std::move(chunk));
+        ++in_flight;
+        work_cv.notify_one();
+        return true;
+    };
+
+    // Chunks only ever end just before a tag line that follows move text, or just after a line
+    // ending in a result for databases without tags, outside any comment, so every game lands
+    // whole in one chunk.
+    std::string chunk;
+    std::string line;
+    CommentState comments;
+    bool in_movetext = false;
+    bool accepting = true;
+    while (accepting && std::getline(stream, line)) {
+        bool tag_line = !comments.inside() && !line.empty() && line.front() == '[';
+        if (tag_line && in_movetext && chunk.size() >= chunk_bytes_) {
+            accepting = submit(std::move(chunk));
+            chunk.clear();
+        }
+        if (tag_line) {
+            in_movetext = false;
+        } else if (!trim(line).empty()) {
+            in_movetext = true;
+        }
+        comments.scan(line);
+        chunk += line;
+        chunk += '\n';
+        if (!tag_line && !comments.inside() && chunk.size() >= chunk_bytes_ && ends_with_result(line)) {
+            accepting = submit(std::move(chunk));
+            chunk.clear();
+            in_movetext = false;
+        }
+    }
+    if (accepting && !chunk.empty()) {
+        submit(std::move(chunk));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        reading_done = true;
+    }
+    work_cv.notify_all();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    stats.chunks = next_index;
+    return stats;
+}
+
+std::vector<TrainingExample> PgnImporter::import_file(const std::string& path, bool include_draws) const {
+    std::vector<TrainingExample> examples;
+    stream_file(path, include_draws, [&](const std::vector<PackedPosition>& positions) {
+        for (const PackedPosition& position : positions) {
+            examples.push_back({std::string{}, position.score, position});
+        }
+    });
     return examples;
 }
 
-void PgnImporter::write_dataset(const std::string& pgn_path, const std::string& output_path, bool include_draws) const {
-    std::vector<TrainingExample> data = import_file(pgn_path, include_draws);
-    save_training_file(output_path, data);
+PgnImporter::Stats PgnImporter::write_dataset(const std::string& pgn_path, const std::string& output_path,
+                                              bool include_draws) const {
+    if (is_packed_training_path(output_path)) {
+        PackedPositionWriter writer(output_path);
+        Stats stats = stream_file(pgn_path, include_draws, [&](const std::vector<PackedPosition>& positions) {
+            for (const PackedPosition& position : positions) {
+                writer.write(position);
+            }
+        });
+        writer.close();
+        return stats;
+    }
+
+    std::ofstream stream(output_path, std::ios::out | std::ios::trunc);
+    if (!stream) {
+        throw std::runtime_error("Failed to open training file for writing: " + output_path);
+    }
+    Board board;
+    std::array<char, Board::kMaxFenLength> fen;
+    Stats stats = stream_file(pgn_path, include_draws, [&](const std::vector<PackedPosition>& positions) {
+        for (const PackedPosition& position : positions) {
+            position.to_board(board);
+            stream.write(fen.data(), static_cast<std::streamsize>(board.write_fen(fen.data())));
+            stream << '|' << position.score << '\n';
+        }
+    });
+    if (!stream) {
+        throw std::runtime_error("Failed to write training file: " + output_path);
+    }
+    return stats;
 }
 
 }  // namespace chiron
-
@@ -1,23 +1,56 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <string>
 #include <vector>
 
+#include "training/packed_position.h"
 #include "training/trainer.h"
 
 namespace chiron {
 
 /**
  * @brief Utility for converting PGN databases into training examples.
+ *
+ * Files are streamed in chunks of whole games, which a pool of worker threads replays
+ * (resolving SAN with san_to_move()) into packed positions. At most a few chunks per worker
+ * are held at once, so memory stays bounded however large the database is, and positions
+ * come out in file order whatever the thread count.
  */
 class PgnImporter {
    public:
+    struct Stats {
+        std::size_t games = 0;
+        std::size_t positions = 0;
+        std::size_t chunks = 0;
+    };
+
+    /** @brief Receives the positions of consecutive chunks, in file order, on one thread at a time. */
+    using Sink = std::function<void(const std::vector<PackedPosition>&)>;
+
+    /** @brief @p threads parser threads; 0 uses every hardware thread. */
+    explicit PgnImporter(std::size_t threads = 0, std::size_t chunk_bytes = kDefaultChunkBytes);
+
     std::vector<TrainingExample> import_file(const std::string& path, bool include_draws = true) const;
-    void write_dataset(const std::string& pgn_path, const std::string& output_path, bool include_draws = true) const;
+
+    /**
+     * @brief Streams @p pgn_path into a dataset file (packed when @p output_path ends in ".bin")
+     *        without collecting the examples in memory.
+     */
+    Stats write_dataset(const std::string& pgn_path, const std::string& output_path, bool include_draws = true) const;
+
+    /** @brief Parses @p path chunk by chunk, handing each chunk's positions to @p sink. */
+    Stats stream_file(const std::string& path, bool include_draws, const Sink& sink) const;
+
+    static constexpr std::size_t kDefaultChunkBytes = 1U << 20;
 
    private:
     static int result_to_target(const std::string& result_tag);
+    static std::size_t parse_games(const std::string& text, bool include_draws, std::vector<PackedPosition>& out);
+
+    std::size_t threads_;
+    std::size_t chunk_bytes_;
 };
 
 }  // namespace chiron
-
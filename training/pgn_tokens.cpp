@@ -0,0 +1,37 @@
+#include "training/pgn_tokens.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace chiron::pgn {
+
+std::string strip_comments(const std::string& input) {
+    std::string output;
+    output.reserve(input.size());
+    bool in_brace = false;
+    int paren_depth = 0;
+    for (char c : input) {
+        if (in_brace) {
+            in_brace = c != '}';
+        } else if (c == '{') {
+            in_brace = true;
+        } else if (c == '(') {
+            ++paren_depth;
+        } else if (c == ')') {
+            paren_depth = std::max(0, paren_depth - 1);
+        } else if (paren_depth == 0) {
+            output.push_back(c);
+        }
+    }
+    return output;
+}
+
+bool is_result_token(const std::string& token) {
+    return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+}
+
+bool is_move_number(const std::string& token) {
+    return !token.empty() && std::isdigit(static_cast<unsigned char>(token.front())) != 0;
+}
+
+}  // namespace chiron::pgn
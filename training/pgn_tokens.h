@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+namespace chiron::pgn {
+
+/** @brief @p input with {comments} and (variations), nested to any depth, removed. */
+[[nodiscard]] std::string strip_comments(const std::string& input);
+
+/** @brief True for the game termination markers "1-0", "0-1", "1/2-1/2" and "*". */
+[[nodiscard]] bool is_result_token(const std::string& token);
+
+/** @brief True for move number tokens such as "12." or "12..."; check is_result_token() first. */
+[[nodiscard]] bool is_move_number(const std::string& token);
+
+}  // namespace chiron::pgn
@@ -0,0 +1,68 @@
+#include "training/position_filter.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace chiron {
+
+namespace {
+
+// Slots probed past a key's home slot before an old key is evicted.
+constexpr std::size_t kProbeWindow = 8;
+
+}  // namespace
+
+PositionFilter::PositionFilter(PositionFilterConfig config, std::uint64_t seed)
+    : config_(config), rng_(seed), keep_(std::clamp(config.sample_rate, 0.0, 1.0)) {
+    if (config_.dedupe_slots > 0) {
+        keys_.assign(std::bit_ceil(std::max(config_.dedupe_slots, kProbeWindow)), 0);
+    }
+}
+
+bool PositionFilter::accept(const Board& board, int ply) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (ply < config_.min_ply) {
+        ++stats_.early;
+        return false;
+    }
+    if (config_.skip_in_check && board.in_check(board.side_to_move())) {
+        ++stats_.in_check;
+        return false;
+    }
+    // Sample before remembering, so a position dropped here can still be kept when it recurs.
+    if (config_.sample_rate < 1.0 && !keep_(rng_)) {
+        ++stats_.sampled_out;
+        return false;
+    }
+    if (!keys_.empty() && seen_before_locked(board.zobrist_key())) {
+        ++stats_.duplicates;
+        return false;
+    }
+    ++stats_.accepted;
+    return true;
+}
+
+bool PositionFilter::seen_before_locked(std::uint64_t key) {
+    key = std::max<std::uint64_t>(key, 1);  // Keep 0 free as the empty marker.
+    std::size_t mask = keys_.size() - 1;
+    std::size_t home = static_cast<std::size_t>(key) & mask;
+    for (std::size_t probe = 0; probe < kProbeWindow; ++probe) {
+        std::uint64_t& slot = keys_[(home + probe) & mask];
+        if (slot == key) {
+            return true;
+        }
+        if (slot == 0) {
+            slot = key;
+            return false;
+        }
+    }
+    keys_[home] = key;  // A full window forgets its home slot's key.
+    return false;
+}
+
+PositionFilter::Stats PositionFilter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+}  // namespace chiron
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "board.h"
+
+namespace chiron {
+
+/** @brief Which positions of a finished game are worth labelling and training on. */
+struct PositionFilterConfig {
+    int min_ply = 0;                /**< Positions before this ply of the game are skipped. */
+    bool skip_in_check = false;     /**< Skip positions whose side to move is in check. */
+    double sample_rate = 1.0;       /**< Fraction of the remaining positions kept, drawn at random. */
+    std::size_t dedupe_slots = 0;   /**< Zobrist keys remembered to drop repeats (0 = keep repeats). */
+
+    /** @brief True when every position passes, so callers need not decode them at all. */
+    [[nodiscard]] bool keeps_everything() const {
+        return min_ply <= 0 && !skip_in_check && sample_rate >= 1.0 && dedupe_slots == 0;
+    }
+};
+
+/**
+ * @brief Drops early, in-check, repeated and randomly sampled-out positions from training data.
+ *
+ * Accepted positions are remembered by Zobrist key in a fixed-size, open-addressed table, so
+ * the same opening position reaches the teacher and the trainer once however many games pass
+ * through it. When a key's probe window is full the key in its home slot is forgotten, so
+ * memory stays bounded and a repeat is at worst trained on again, never a new position lost.
+ * All members may be called from any thread.
+ */
+class PositionFilter {
+   public:
+    struct Stats {
+        std::size_t accepted = 0;
+        std::size_t early = 0;
+        std::size_t in_check = 0;
+        std::size_t duplicates = 0;
+        std::size_t sampled_out = 0;
+    };
+
+    explicit PositionFilter(PositionFilterConfig config = {}, std::uint64_t seed = 0);
+
+    /** @brief Whether @p board, reached at @p ply of its game, should be kept; kept keys are remembered. */
+    bool accept(const Board& board, int ply);
+
+    [[nodiscard]] const PositionFilterConfig& config() const { return config_; }
+    [[nodiscard]] Stats stats() const;
+
+   private:
+    /** @brief True when @p key was already stored; stores it otherwise. Called with the lock held. */
+    bool seen_before_locked(std::uint64_t key);
+
+    PositionFilterConfig config_;
+    mutable std::mutex mutex_;
+    std::vector<std::uint64_t> keys_;  // 0 marks an empty slot.
+    std::mt19937_64 rng_;
+    std::bernoulli_distribution keep_;
+    Stats stats_{};
+};
+
+}  // namespace chiron
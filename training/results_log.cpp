@@ -0,0 +1,46 @@
+#include "training/results_log.h"
+
+#include <charconv>
+
+namespace chiron::results_log {
+
+std::size_t find_field(const std::string& line, const std::string& field) {
+    std::size_t pos = line.find('"' + field + "\":");
+    return pos == std::string::npos ? pos : pos + field.size() + 3;
+}
+
+std::optional<std::string> read_string(const std::string& line, std::size_t& pos) {
+    if (pos >= line.size() || line[pos] != '"') {
+        return std::nullopt;
+    }
+    std::string value;
+    for (++pos; pos < line.size(); ++pos) {
+        char c = line[pos];
+        if (c == '"') {
+            ++pos;
+            return value;
+        }
+        if (c == '\\' && pos + 1 < line.size()) {
+            char escaped = line[++pos];
+            value += escaped == 'n' ? '\n' : escaped == 'r' ? '\r' : escaped == 't' ? '\t' : escaped;
+        } else {
+            value += c;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<long long> read_int_field(const std::string& line, const std::string& field) {
+    std::size_t pos = find_field(line, field);
+    if (pos == std::string::npos) {
+        return std::nullopt;
+    }
+    long long value = 0;
+    auto [end, error] = std::from_chars(line.data() + pos, line.data() + line.size(), value);
+    if (error != std::errc{}) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+}  // namespace chiron::results_log
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+
+namespace chiron::results_log {
+
+/**
+ * @brief Field readers for self-play results-log lines, the flat JSON objects (one per game)
+ *        SelfPlayOrchestrator writes. They expect that writer's layout, not arbitrary JSON.
+ */
+
+/** @brief Position just past `"field":` in @p line, or npos. */
+[[nodiscard]] std::size_t find_field(const std::string& line, const std::string& field);
+
+/** @brief Decodes the JSON string starting at the quote at @p pos, leaving @p pos after its closing quote. */
+[[nodiscard]] std::optional<std::string> read_string(const std::string& line, std::size_t& pos);
+
+/** @brief The integer value of @p field, or nothing when it is missing or not a number. */
+[[nodiscard]] std::optional<long long> read_int_field(const std::string& line, const std::string& field);
+
+}  // namespace chiron::results_log
@@ -8,10 +8,12 @@
 #include <stdexcept>
 #include <ctime>
 #include <filesystem>
+#include <iterator>
 #include <iostream>
 #include <iomanip>
 #include <ios>
 #include <limits>
+#include <optional>
 #include <sstream>
 #include <unordered_map>
 #include <utility>
@@ -19,11 +21,17 @@
 #include "bitboard.h"
 #include "evaluation.h"
 #include "movegen.h"
+#include "trace.h"
 
 namespace chiron {
 
 namespace {
 
+// Channels of SelfPlayOrchestrator::log_sink_.
+constexpr std::size_t kResultsChannel = 0;
+constexpr std::size_t kPgnChannel = 1;
+constexpr std::size_t kConsoleChannel = 2;
+
 bool is_null_move(const Move& move) {
     return move.from == 0 && move.to == 0 && move.promotion == PieceType::None && move.flags == MoveFlag::Quiet;
 }
@@ -93,21 +101,6 @@ bool insufficient_material(const Board& board) {
     return false;
 }
 
-int orient_target_for_fen(const std::string& fen, int base_target) {
-    if (base_target == 0) {
-        return 0;
-    }
-    std::size_t space = fen.find(' ');
-    if (space == std::string::npos || space + 1 >= fen.size()) {
-        return base_target;
-    }
-    char side = fen[space + 1];
-    if (side == 'b' || side == 'B') {
-        return -base_target;
-    }
-    return base_target;
-}
-
 std::string escape_json(const std::string& value) {
     std::string escaped;
     escaped.reserve(value.size());
@@ -149,12 +142,25 @@ std::string join_string_array(const std::vector<std::string>& values) {
     return oss.str();
 }
 
-std::string format_moves(const std::vector<std::string>& moves) {
+/**
+ * @brief Numbers @p moves as PGN movetext played from @p start_fen.
+ */
+std::string format_moves(const std::vector<std::string>& moves, const std::string& start_fen) {
+    Board start;
+    start.set_from_fen(start_fen);
+    int move_number = start.fullmove_number();
+    bool white_to_move = start.side_to_move() == Color::White;
     std::ostringstream oss;
     for (std::size_t i = 0; i < moves.size(); ++i) {
-        if (i % 2 == 0) {
-            oss << static_cast<int>(i / 2 + 1) << ". ";
+        if (white_to_move) {
+            oss << move_number << ". ";
+        } else {
+            if (i == 0) {
+                oss << move_number << "... ";
+            }
+            ++move_number;
         }
+        white_to_move = !white_to_move;
         oss << moves[i];
         if (i + 1 < moves.size()) {
             oss << ' ';
@@ -213,7 +219,8 @@ std::string move_to_san(Board& board, const Move& move) {
     if (moving_piece != PieceType::Pawn) {
         san += piece_to_char(moving_piece);
 
-        auto legal_moves = MoveGenerator::generate_legal_moves(board);
+        MoveList legal_moves;
+        MoveGenerator::generate_legal_moves(board, legal_moves);
         bool needs_file = false;
         bool needs_rank = false;
         bool conflict = false;
@@ -258,7 +265,9 @@ std::string move_to_san(Board& board, const Move& move) {
     Board::State state;
     board.make_move(move, state);
     bool opponent_in_check = board.in_check(board.side_to_move());
-    bool opponent_has_moves = !MoveGenerator::generate_legal_moves(board).empty();
+    MoveList replies;
+    MoveGenerator::generate_legal_moves(board, replies);
+    bool opponent_has_moves = !replies.empty();
     board.undo_move(move, state);
 
     if (opponent_in_check) {
@@ -308,13 +317,13 @@ std::string format_pv(Board board, const std::vector<Move>& pv) {
     }
     std::ostringstream oss;
     bool first = true;
+    Board::State state;  // The by-value board only moves forward; undo records are discarded.
     for (const Move& move : pv) {
         if (!first) {
             oss << ' ';
         }
         std::string san = move_to_san(board, move);
         oss << san;
-        Board::State state;
         board.make_move(move, state);
         first = false;
     }
@@ -325,13 +334,151 @@ std::string trainer_device_name(TrainerDevice device) {
     return device == TrainerDevice::kGPU ? "GPU" : "CPU";
 }
 
+/**
+ * @brief Returns the PGN result the tablebases prove for @p board, or nothing when they do not
+ *        cover it or the fifty-move counter leaves a win in doubt.
+ */
+std::optional<std::string> tablebase_result(const SyzygyTablebases& tablebases, const Board& board) {
+    std::optional<Wdl> wdl = tablebases.probe_wdl(board);
+    if (!wdl) {
+        return std::nullopt;
+    }
+    if (*wdl != Wdl::Win && *wdl != Wdl::Loss) {
+        return std::string("1/2-1/2");
+    }
+    if (board.halfmove_clock() > 0) {
+        // WDL assumes a fresh counter; only DTZ shows whether the win still beats the fifty-move rule.
+        std::optional<int> dtz = tablebases.probe_dtz(board);
+        if (!dtz || std::abs(*dtz) + board.halfmove_clock() > 100) {
+            return std::nullopt;
+        }
+    }
+    bool white_wins = (*wdl == Wdl::Win) == (board.side_to_move() == Color::White);
+    return std::string(white_wins ? "1-0" : "0-1");
+}
+
 }  // namespace
 
+void SelfPlayResult::replay(const std::function<void(const Board&, int)>& visit) const {
+    Board board;
+    board.set_from_fen(start_fen);
+    visit(board, 0);
+    for (std::size_t ply = 0; ply < moves.size(); ++ply) {
+        Board::State state;
+        board.make_move(unpack_move(moves[ply]), state);
+        visit(board, static_cast<int>(ply) + 1);
+    }
+}
+
+std::vector<std::string> SelfPlayResult::san_moves() const {
+    trace::Span span("san_moves");
+    std::vector<std::string> san;
+    san.reserve(moves.size());
+    Board board;
+    board.set_from_fen(start_fen);
+    for (PackedMove packed : moves) {
+        Move move = unpack_move(packed);
+        san.push_back(move_to_san(board, move));
+        Board::State state;
+        board.make_move(move, state);
+    }
+    return san;
+}
+
+std::vector<std::string> SelfPlayResult::fens() const {
+    std::vector<std::string> positions;
+    positions.reserve(moves.size());
+    replay([&](const Board& board, int ply) {
+        if (ply > 0) {
+            positions.push_back(board.fen());
+        }
+    });
+    return positions;
+}
+
+SelfPlayEnginePool::Engines SelfPlayEnginePool::acquire(const EngineConfig& white, const EngineConfig& black,
+                                                        const std::shared_ptr<const TrainedNetwork>& trained) {
+    Slot& first = slots_[static_cast<int>(Color::White)];
+    Slot& second = slots_[static_cast<int>(Color::Black)];
+    bool swapped = first.search && second.search && first.network_path != white.network_path &&
+                   first.network_path == black.network_path && second.network_path == white.network_path;
+    if (swapped) {
+        std::swap(first, second);
+    }
+    Search& white_search = bind(first, white, trained.get());
+    Search& black_search = bind(second, black, trained.get());
+    return Engines{white_search, black_search};
+}
+
+Search& SelfPlayEnginePool::bind(Slot& slot, const EngineConfig& config, const TrainedNetwork* trained) {
+    bool follows_training = trained && trained->network && !trained->path.empty() &&
+                            config.network_path == trained->path;
+    std::shared_ptr<const nnue::Network> snapshot = follows_training ? trained->network : nullptr;
+    // Training saves over the same path, so a file's time and size tell a new network from the old.
+    std::filesystem::file_time_type written{};
+    std::uintmax_t bytes = 0;
+    if (!snapshot && !config.network_path.empty()) {
+        std::error_code error;
+        written = std::filesystem::last_write_time(config.network_path, error);
+        bytes = error ? 0 : std::filesystem::file_size(config.network_path, error);
+        if (error) {
+            written = {};
+            bytes = 0;
+        }
+    }
+    bool rebind = !slot.search || slot.network_path != config.network_path || slot.trained != snapshot ||
+                  slot.network_written != written || slot.network_bytes != bytes;
+    if (rebind) {
+        slot.network_path = config.network_path;
+        slot.network_written = written;
+        slot.network_bytes = bytes;
+        slot.trained = snapshot;
+        if (snapshot) {
+            slot.evaluator = std::make_shared<nnue::Evaluator>();
+            slot.evaluator->set_network(snapshot);
+        } else {
+            slot.evaluator = create_evaluator(config);
+        }
+    }
+    if (!slot.search) {
+        slot.table_size = config.table_size;
+        slot.search = std::make_unique<Search>(config.table_size, slot.evaluator);
+    } else {
+        if (rebind) {
+            slot.search->set_evaluator(slot.evaluator);
+        }
+        if (slot.table_size != config.table_size) {
+            slot.table_size = config.table_size;
+            slot.search->set_table_size(config.table_size);
+        }
+    }
+    if (slot.search->threads() != std::max(1, config.threads)) {
+        slot.search->set_threads(config.threads);
+    }
+    slot.search->set_continuation_history(config.continuation_history);
+    slot.search->new_game();
+    return *slot.search;
+}
+
 SelfPlayOrchestrator::SelfPlayOrchestrator(SelfPlayConfig config)
     : config_(std::move(config)),
+      openings_(config_.openings_path.empty()
+                    ? nullptr
+                    : std::make_shared<const OpeningSuite>(
+                          OpeningSuite::load(config_.openings_path, config_.opening_max_plies))),
       rng_(config_.seed != 0U ? config_.seed : static_cast<unsigned int>(std::random_device{}())),
-      trainer_(Trainer::Config{config_.training_learning_rate, 0.0005, config_.training_device}),
-      parameters_(config_.training_hidden_size) {
+      trainer_(Trainer::Config{config_.training_learning_rate, 0.0005, config_.training_device,
+                               config_.training_threads, config_.training_optimizer}),
+      parameters_(config_.training_hidden_size, config_.training_features) {
+    if (!config_.book_path.empty()) {
+        book_ = std::make_shared<const OpeningBook>(config_.book_path);
+    }
+    if (!config_.syzygy_path.empty()) {
+        auto tablebases = std::make_shared<const SyzygyTablebases>(config_.syzygy_path);
+        if (tablebases->max_pieces() > 0) {
+            tablebases_ = std::move(tablebases);
+        }
+    }
     if (!config_.training_output_path.empty()) {
         std::filesystem::path output_path(config_.training_output_path);
         training_history_prefix_ = output_path.stem().string();
@@ -344,9 +491,23 @@ SelfPlayOrchestrator::SelfPlayOrchestrator(SelfPlayConfig config)
         training_history_extension_ = ".nnue";
     }
 
+    if (config_.initial_network) {
+        trained_network_ = config_.initial_network;
+        for (EngineConfig* engine : {&config_.white, &config_.black}) {
+            if (engine->network_path.empty()) {
+                engine->network_path = trained_network_->path;
+            }
+        }
+    }
+
     if (config_.enable_training) {
-        config_.record_fens = true;
-        if (!config_.training_output_path.empty() && std::filesystem::exists(config_.training_output_path)) {
+        position_filter_ = config_.position_filter
+                               ? config_.position_filter
+                               : std::make_shared<PositionFilter>(config_.training_filter,
+                                                                  config_.seed != 0U ? config_.seed
+                                                                                     : std::random_device{}());
+        if (!config_.training_sink && !config_.training_output_path.empty() &&
+            std::filesystem::exists(config_.training_output_path)) {
             parameters_.load(config_.training_output_path);
             config_.training_hidden_size = parameters_.network().hidden_size();
             set_global_network_path(config_.training_output_path);
@@ -371,7 +532,7 @@ SelfPlayOrchestrator::SelfPlayOrchestrator(SelfPlayConfig config)
 
       
         total_positions_trained_ = static_cast<std::size_t>(training_iteration_) * config_.training_batch_size;
-        total_positions_collected_ = total_positions_trained_;
+        total_positions_collected_ = total_positions_trained_.load();
     }
 }
 
@@ -402,19 +563,20 @@ void SelfPlayOrchestrator::ensure_streams() {
     streams_open_ = true;
 }
 
-void SelfPlayOrchestrator::run() {
+SelfPlayOrchestrator::~SelfPlayOrchestrator() { stop_training_thread(); }
+
+void SelfPlayOrchestrator::begin_session(int concurrency) {
     load_existing_elo_history();
-    int total_games = config_.games;
-    int concurrency = std::max(1, config_.concurrency);
-    if (total_games <= 0) {
-        log_lite("No games to play.");
-        return;
-    }
     ensure_streams();
     if (config_.verbose) {
         std::ostringstream header;
-        header << "[SelfPlay] Starting " << total_games << " game(s) with concurrency " << concurrency
-               << ". Max ply " << config_.max_ply << '.';
+        header << "[SelfPlay] Starting " << config_.games << " game(s) ";
+        if (concurrency > 0) {
+            header << "with concurrency " << concurrency;
+        } else {
+            header << "on remote workers";
+        }
+        header << ". Max ply " << config_.max_ply << '.';
         log_verbose(header.str());
 
         std::ostringstream engines;
@@ -448,9 +610,13 @@ void SelfPlayOrchestrator::run() {
 
         if (config_.enable_training) {
             std::ostringstream train;
-            train << "[Train] Batch size " << config_.training_batch_size << ", learning rate "
+            train << "[Train] Batch size " << config_.training_batch_size << ", "
+                  << optimizer_name(config_.training_optimizer.kind) << " learning rate "
                   << config_.training_learning_rate << ", device "
                   << trainer_device_name(config_.training_device);
+            if (config_.training_device == TrainerDevice::kCPU) {
+                train << ", " << config_.training_threads << " trainer thread(s)";
+            }
             if (!config_.training_output_path.empty()) {
                 train << ", output " << config_.training_output_path;
             } else {
@@ -462,54 +628,96 @@ void SelfPlayOrchestrator::run() {
             if (config_.teacher_mode) {
                 train << ", teacher " << (config_.teacher.engine_path.empty() ? "<none>" : config_.teacher.engine_path)
                       << " (depth " << config_.teacher.depth << ", threads " << config_.teacher.threads
+                      << ", processes " << config_.teacher.processes
                       << ", batch " << config_.teacher_chunk_size << ')';
             }
             train << ". Previously trained positions " << total_positions_trained_ << '.';
             log_verbose(train.str());
         }
     }
-    std::atomic<int> next_game{0};
+    start_training_thread();
+}
+
+void SelfPlayOrchestrator::end_session() {
+    stop_training_thread();
+    finalize_training();
+    log_rating_snapshot("[Elo] Final ratings: ");
+    log_sink_.flush();
+}
+
+std::pair<EngineConfig, EngineConfig> SelfPlayOrchestrator::current_engines() const {
+    std::lock_guard<std::mutex> config_lock(config_mutex_);
+    return {config_.white, config_.black};
+}
+
+void SelfPlayOrchestrator::run() {
+    int concurrency = std::max(1, config_.concurrency);
+    if (config_.games <= 0) {
+        log_lite("No games to play.");
+        return;
+    }
+    begin_session(concurrency);
+    GamePairScheduler scheduler(config_.games, config_.alternate_colors, openings_);
     std::vector<std::thread> workers;
     workers.reserve(static_cast<std::size_t>(concurrency));
     for (int thread_index = 0; thread_index < concurrency; ++thread_index) {
-        workers.emplace_back([this, total_games, &next_game]() {
-            while (true) {
-                int game = next_game.fetch_add(1);
-                if (game >= total_games) {
-                    break;
-                }
-                EngineConfig white;
-                EngineConfig black;
-                bool alternate_colors = false;
-                {
-                    std::lock_guard<std::mutex> config_lock(config_mutex_);
-                    white = config_.white;
-                    black = config_.black;
-                    alternate_colors = config_.alternate_colors;
-                }
-                if (alternate_colors) {
-                    int pair_index = game / 2;
-                    bool flip_pair_orientation = (pair_index % 2) == 1;
-                    bool second_game_in_pair = (game % 2) == 1;
-                    bool swap_colors = flip_pair_orientation ? !second_game_in_pair : second_game_in_pair;
-                    if (swap_colors) {
-                        std::swap(white, black);
-                    }
+        workers.emplace_back([this, &scheduler]() {
+            SelfPlayEnginePool engines;
+            while (std::optional<GameAssignment> game = scheduler.next()) {
+                auto [white, black] = current_engines();
+                if (game->swap_colors) {
+                    std::swap(white, black);
                 }
-                play_game(game, white, black, true);
+                play_game(game->game_index, white, black, true, engines, game->start_fen);
             }
         });
     }
     for (auto& worker : workers) {
         worker.join();
     }
+    end_session();
+}
 
-    finalize_training();
-    log_rating_snapshot("[Elo] Final ratings: ");
+void SelfPlayOrchestrator::cancel_games() { games_cancelled_.store(true); }
+
+void SelfPlayOrchestrator::resume_games() { games_cancelled_.store(false); }
+
+void SelfPlayOrchestrator::publish_network(std::shared_ptr<const TrainedNetwork> network) {
+    std::atomic_store(&trained_network_, network);
+    if (!network || network->path.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> config_lock(config_mutex_);
+    config_.white.network_path = network->path;
+    config_.black.network_path = network->path;
 }
 
 SelfPlayResult SelfPlayOrchestrator::play_game(int game_index, const EngineConfig& white, const EngineConfig& black,
-                                               bool log_outputs) {
+                                               bool log_outputs, const std::string& start_fen) {
+    // Each call borrows a pool of its own, so independent callers still play in parallel.
+    std::unique_ptr<SelfPlayEnginePool> engines;
+    {
+        std::lock_guard<std::mutex> lock(idle_engines_mutex_);
+        if (!idle_engines_.empty()) {
+            engines = std::move(idle_engines_.back());
+            idle_engines_.pop_back();
+        }
+    }
+    if (!engines) {
+        engines = std::make_unique<SelfPlayEnginePool>();
+    }
+    SelfPlayResult result = play_game(game_index, white, black, log_outputs, *engines, start_fen);
+    {
+        std::lock_guard<std::mutex> lock(idle_engines_mutex_);
+        idle_engines_.push_back(std::move(engines));
+    }
+    log_sink_.flush();
+    return result;
+}
+
+SelfPlayResult SelfPlayOrchestrator::play_game(int game_index, const EngineConfig& white, const EngineConfig& black,
+                                               bool log_outputs, SelfPlayEnginePool& engines,
+                                               const std::string& start_fen) {
     ensure_streams();
     if (config_.verbose) {
         std::ostringstream start;
@@ -520,16 +728,32 @@ SelfPlayResult SelfPlayOrchestrator::play_game(int game_index, const EngineConfi
               << (black.network_path.empty() ? "<default>" : black.network_path) << ')';
         log_verbose(start.str());
     }
-    SelfPlayResult result = play_single_game(game_index, white, black);
+    SelfPlayResult result = play_single_game(game_index, white, black, engines, start_fen);
+    if (result.termination == "cancelled") {
+        return result;
+    }
+    record_game(game_index, result, log_outputs);
+    return result;
+}
+
+void SelfPlayOrchestrator::record_game(int game_index, const SelfPlayResult& result, bool log_outputs) {
+    ensure_streams();
     if (log_outputs) {
-        if (config_.capture_results && results_stream_) {
-            log_result(game_index, result);
+        bool log_results = config_.capture_results && results_stream_;
+        bool log_pgn = config_.capture_pgn && pgn_stream_;
+        // Both writers print the same SAN, so the moves are formatted once per game.
+        std::vector<std::string> moves_san;
+        if (config_.record_moves && (log_results || log_pgn)) {
+            moves_san = result.san_moves();
+        }
+        if (log_results) {
+            log_result(game_index, result, moves_san);
         }
-        if (config_.capture_pgn && pgn_stream_) {
-            write_pgn(game_index, result);
+        if (log_pgn) {
+            write_pgn(game_index, result, moves_san);
         }
     }
-    handle_training(result);
+    std::size_t added = handle_training(result);
     record_elo(game_index, result);
     if (config_.verbose) {
         std::ostringstream summary;
@@ -537,7 +761,6 @@ SelfPlayResult SelfPlayOrchestrator::play_game(int game_index, const EngineConfi
                 << ") after " << result.ply_count << " ply in " << std::fixed << std::setprecision(2)
                 << (result.duration_ms / 1000.0) << "s";
         if (config_.enable_training) {
-            std::size_t added = 1 + result.fens.size();
             summary << ". Positions collected " << added << " (total collected " << total_positions_collected_
                     << ", trained " << total_positions_trained_ << ")";
         }
@@ -556,28 +779,29 @@ SelfPlayResult SelfPlayOrchestrator::play_game(int game_index, const EngineConfi
                 << (result.duration_ms / 1000.0) << "s)";
         log_lite(summary.str());
     }
-    return result;
 }
 
 SelfPlayResult SelfPlayOrchestrator::play_single_game(int game_index, const EngineConfig& white,
-                                                      const EngineConfig& black) {
+                                                      const EngineConfig& black, SelfPlayEnginePool& engines,
+                                                      const std::string& start_fen) {
+    trace::Span span("selfplay_game");
     Board board;
-    board.set_start_position();
+    if (start_fen.empty()) {
+        board.set_start_position();
+    } else {
+        board.set_from_fen(start_fen);
+    }
 
     SelfPlayResult result;
     result.white_player = white.name;
     result.black_player = black.name;
     result.start_fen = board.fen();
 
-    auto white_eval = create_evaluator(white);
-    auto black_eval = create_evaluator(black);
-
-    Search white_search(white.table_size, white_eval);
-    Search black_search(black.table_size, black_eval);
-    white_search.set_threads(white.threads);
-    black_search.set_threads(black.threads);
-    white_search.clear();
-    black_search.clear();
+    SelfPlayEnginePool::Engines bound = engines.acquire(white, black, std::atomic_load(&trained_network_));
+    Search& white_search = bound.white;
+    Search& black_search = bound.black;
+    white_search.set_tablebases(tablebases_);
+    black_search.set_tablebases(tablebases_);
 
     auto start_time = std::chrono::steady_clock::now();
 
@@ -588,64 +812,86 @@ SelfPlayResult SelfPlayOrchestrator::play_single_game(int game_index, const Engi
     bool finished = false;
 
     while (!finished) {
+        if (games_cancelled_.load()) {
+            result.result = "*";
+            result.termination = "cancelled";
+            break;
+        }
         if (config_.max_ply > 0 && ply >= config_.max_ply) {
             result.result = "1/2-1/2";
             result.termination = "max-ply";
             break;
         }
-
-        const EngineConfig& cfg = board.side_to_move() == Color::White ? white : black;
-        Search& current_search = board.side_to_move() == Color::White ? white_search : black_search;
-
-        SearchLimits limits;
-        limits.max_depth = cfg.max_depth;
-        if (config_.verbose) {
-            int move_number = ply / 2 + 1;
-            std::ostringstream search_msg;
-            search_msg << "[Game " << (game_index + 1) << "] Searching " << move_number
-                       << (board.side_to_move() == Color::White ? ". " : "... ")
-                       << (board.side_to_move() == Color::White ? white.name : black.name)
-                       << " at depth " << cfg.max_depth;
-            if (cfg.threads > 1) {
-                search_msg << " (threads " << cfg.threads << ')';
+        if (tablebases_ && tablebases_->may_cover(board)) {
+            if (std::optional<std::string> adjudicated = tablebase_result(*tablebases_, board)) {
+                result.result = std::move(*adjudicated);
+                result.termination = "tablebase";
+                break;
             }
-            log_verbose(search_msg.str());
-        }
-        std::atomic<bool> stop_flag{false};
-        InfoCallback info_cb;
-        if (config_.verbose) {
-            Color mover = board.side_to_move();
-            info_cb = [this, game_index, mover, &board](const SearchResult& info) {
-                std::ostringstream info_msg;
-                info_msg << "[Game " << (game_index + 1) << "] info depth " << info.depth;
-                info_msg << " | eval " << format_evaluation(info.score, mover);
-                info_msg << " | nodes " << static_cast<unsigned long long>(info.nodes);
-                if (info.elapsed.count() > 0) {
-                    double elapsed_ms = static_cast<double>(info.elapsed.count());
-                    info_msg << " | time " << static_cast<long long>(info.elapsed.count()) << "ms";
-                    if (elapsed_ms > 0.0) {
-                        double nodes_per_second = static_cast<double>(info.nodes) * 1000.0 / elapsed_ms;
-                        if (nodes_per_second > 0.0) {
-                            info_msg << " | nps " << static_cast<unsigned long long>(nodes_per_second);
-                        }
-                    }
-                }
-                Board pv_board = board;
-                std::string pv_line = format_pv(pv_board, info.pv);
-                if (!pv_line.empty()) {
-                    info_msg << " | pv " << pv_line;
-                }
-                log_verbose(info_msg.str());
-            };
         }
+
+        // Book moves are played without a search, so the result keeps only the move.
+        std::optional<Move> from_book = book_move(board);
         SearchResult search_result;
-        if (info_cb) {
-            search_result = current_search.search(board, limits, stop_flag, info_cb);
+        if (from_book) {
+            search_result.best_move = *from_book;
         } else {
-            search_result = current_search.search(board, limits);
+            const EngineConfig& cfg = board.side_to_move() == Color::White ? white : black;
+            Search& current_search = board.side_to_move() == Color::White ? white_search : black_search;
+            SearchLimits limits;
+            limits.max_depth = cfg.max_depth;
+            limits.soft_node_limit = cfg.soft_nodes;
+            limits.node_limit = cfg.hard_nodes;
+            if (config_.verbose) {
+                int move_number = ply / 2 + 1;
+                std::ostringstream search_msg;
+                search_msg << "[Game " << (game_index + 1) << "] Searching " << move_number
+                           << (board.side_to_move() == Color::White ? ". " : "... ")
+                           << (board.side_to_move() == Color::White ? white.name : black.name)
+                           << " at depth " << cfg.max_depth;
+                if (cfg.soft_nodes > 0 || cfg.hard_nodes > 0) {
+                    search_msg << " (nodes " << cfg.soft_nodes << '/' << cfg.hard_nodes << ')';
+                }
+                if (cfg.threads > 1) {
+                    search_msg << " (threads " << cfg.threads << ')';
+                }
+                log_verbose(search_msg.str());
+            }
+            InfoCallback info_cb;
+            if (config_.verbose) {
+                Color mover = board.side_to_move();
+                info_cb = [this, game_index, mover, &board](const SearchResult& info) {
+                    std::ostringstream info_msg;
+                    info_msg << "[Game " << (game_index + 1) << "] info depth " << info.depth;
+                    info_msg << " | eval " << format_evaluation(info.score, mover);
+                    info_msg << " | nodes " << static_cast<unsigned long long>(info.nodes);
+                    if (info.elapsed.count() > 0) {
+                        double elapsed_ms = static_cast<double>(info.elapsed.count());
+                        info_msg << " | time " << static_cast<long long>(info.elapsed.count()) << "ms";
+                        if (elapsed_ms > 0.0) {
+                            double nodes_per_second = static_cast<double>(info.nodes) * 1000.0 / elapsed_ms;
+                            if (nodes_per_second > 0.0) {
+                                info_msg << " | nps " << static_cast<unsigned long long>(nodes_per_second);
+                            }
+                        }
+                    }
+                    Board pv_board = board;
+                    std::string pv_line = format_pv(pv_board, info.pv);
+                    if (!pv_line.empty()) {
+                        info_msg << " | pv " << pv_line;
+                    }
+                    log_verbose(info_msg.str());
+                };
+            }
+            search_result = current_search.search(board, limits, games_cancelled_, info_cb);
+            if (games_cancelled_.load()) {
+                result.result = "*";
+                result.termination = "cancelled";
+                break;
+            }
         }
 
-        Move best = select_move(search_result, ply);
+        Move best = from_book ? *from_book : select_move(search_result, ply);
         if (is_null_move(best)) {
             bool in_check = board.in_check(board.side_to_move());
             if (in_check) {
@@ -658,8 +904,8 @@ SelfPlayResult SelfPlayOrchestrator::play_single_game(int game_index, const Engi
             break;
         }
 
-        std::string san = move_to_san(board, best);
         if (config_.verbose) {
+            std::string san = move_to_san(board, best);
             Board pv_board = board;
             std::string pv_san = format_pv(pv_board, search_result.pv);
             double elapsed_ms = static_cast<double>(search_result.elapsed.count());
@@ -674,7 +920,11 @@ SelfPlayResult SelfPlayOrchestrator::play_single_game(int game_index, const Engi
             move_log << "[Game " << (game_index + 1) << "] " << move_number
                      << (mover == Color::White ? ". " : "... ") << player_name << " (" << color_name(mover)
                      << ") plays " << san;
-            move_log << " | eval " << format_evaluation(search_result.score, mover);
+            if (from_book) {
+                move_log << " | book";
+            } else {
+                move_log << " | eval " << format_evaluation(search_result.score, mover);
+            }
             move_log << " | depth " << search_result.depth;
             if (search_result.seldepth > 0) {
                 move_log << " (sel " << search_result.seldepth << ')';
@@ -691,7 +941,7 @@ SelfPlayResult SelfPlayOrchestrator::play_single_game(int game_index, const Engi
             }
             log_verbose(move_log.str());
         }
-        result.moves_san.push_back(std::move(san));
+        result.moves.push_back(pack_move(best));
 
         Board::State state;
         board.make_move(best, state);
@@ -699,10 +949,6 @@ SelfPlayResult SelfPlayOrchestrator::play_single_game(int game_index, const Engi
 
         repetition[board.zobrist_key()] += 1;
 
-        if (config_.record_fens) {
-            result.fens.push_back(board.fen());
-        }
-
         if (board.halfmove_clock() >= 100) {
             result.result = "1/2-1/2";
             result.termination = "fifty-move-rule";
@@ -724,13 +970,25 @@ SelfPlayResult SelfPlayOrchestrator::play_single_game(int game_index, const Engi
     }
 
     result.end_fen = board.fen();
-    result.ply_count = static_cast<int>(result.moves_san.size());
+    result.ply_count = ply;
     auto end_time = std::chrono::steady_clock::now();
     result.duration_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
 
     return result;
 }
 
+std::optional<Move> SelfPlayOrchestrator::book_move(const Board& board) {
+    if (!book_) {
+        return std::nullopt;
+    }
+    double fraction = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(rng_mutex_);
+        fraction = std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
+    }
+    return book_->pick(board, fraction);
+}
+
 Move SelfPlayOrchestrator::select_move(const SearchResult& search_result, int ply) {
     Move deterministic = search_result.best_move;
     if (config_.randomness_temperature <= 0.0) {
@@ -796,7 +1054,11 @@ Move SelfPlayOrchestrator::select_move(const SearchResult& search_result, int pl
     }
 
     std::uniform_real_distribution<double> dist(0.0, sum);
-    double target = dist(rng_);
+    double target = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(rng_mutex_);
+        target = dist(rng_);
+    }
     for (std::size_t i = 0; i < candidates.size(); ++i) {
         target -= weights[i];
         if (target <= 0.0) {
@@ -807,160 +1069,277 @@ Move SelfPlayOrchestrator::select_move(const SearchResult& search_result, int pl
     return candidates.back().first;
 }
 
-void SelfPlayOrchestrator::log_result(int game_index, const SelfPlayResult& result) {
+void SelfPlayOrchestrator::log_result(int game_index, const SelfPlayResult& result,
+                                      const std::vector<std::string>& moves_san) {
     if (!results_stream_) {
         return;
     }
-    std::lock_guard<std::mutex> lock(log_mutex_);
-    results_stream_ << '{';
-    results_stream_ << "\"game\":" << (game_index + 1) << ',';
-    results_stream_ << "\"white\":\"" << escape_json(result.white_player) << '"' << ',';
-    results_stream_ << "\"black\":\"" << escape_json(result.black_player) << '"' << ',';
-    results_stream_ << "\"result\":\"" << escape_json(result.result) << '"' << ',';
-    results_stream_ << "\"termination\":\"" << escape_json(result.termination) << '"' << ',';
-    results_stream_ << "\"ply_count\":" << result.ply_count << ',';
-    results_stream_ << "\"duration_ms\":" << std::fixed << std::setprecision(2) << result.duration_ms << ',';
-    results_stream_ << "\"start_fen\":\"" << escape_json(result.start_fen) << '"' << ',';
-    results_stream_ << "\"end_fen\":\"" << escape_json(result.end_fen) << '"' << ',';
-
-    results_stream_ << "\"moves\":" << join_string_array(result.moves_san);
+    trace::Span span("log_result");
+    std::ostringstream line;
+    line << '{';
+    line << "\"game\":" << (game_index + 1) << ',';
+    line << "\"white\":\"" << escape_json(result.white_player) << '"' << ',';
+    line << "\"black\":\"" << escape_json(result.black_player) << '"' << ',';
+    line << "\"result\":\"" << escape_json(result.result) << '"' << ',';
+    line << "\"termination\":\"" << escape_json(result.termination) << '"' << ',';
+    line << "\"ply_count\":" << result.ply_count << ',';
+    line << "\"duration_ms\":" << std::fixed << std::setprecision(2) << result.duration_ms << ',';
+    line << "\"start_fen\":\"" << escape_json(result.start_fen) << '"' << ',';
+    line << "\"end_fen\":\"" << escape_json(result.end_fen) << '"' << ',';
+
+    line << "\"moves\":" << join_string_array(moves_san);
     if (config_.record_fens) {
-        results_stream_ << ",\"fens\":" << join_string_array(result.fens);
+        line << ",\"fens\":" << join_string_array(result.fens());
     }
-    results_stream_ << "}\n" << std::defaultfloat;
-    results_stream_.flush();
+    line << "}\n";
+    log_sink_.write(kResultsChannel, line.str());
 }
 
-void SelfPlayOrchestrator::write_pgn(int game_index, const SelfPlayResult& result) {
+void SelfPlayOrchestrator::write_pgn(int game_index, const SelfPlayResult& result,
+                                     const std::vector<std::string>& moves_san) {
     if (!pgn_stream_) {
         return;
     }
-    std::lock_guard<std::mutex> lock(log_mutex_);
-    auto now = std::chrono::system_clock::now();
-    std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-    std::tm tm = *std::localtime(&now_time);
-
-    pgn_stream_ << "[Event \"Chiron Self-Play\"]\n";
-    pgn_stream_ << "[Site \"Local\"]\n";
-    pgn_stream_ << "[Date \"" << std::put_time(&tm, "%Y.%m.%d") << "\"]\n";
-    pgn_stream_ << "[Round \"" << (game_index + 1) << "\"]\n";
-    pgn_stream_ << "[White \"" << result.white_player << "\"]\n";
-    pgn_stream_ << "[Black \"" << result.black_player << "\"]\n";
-    pgn_stream_ << "[Result \"" << result.result << "\"]\n";
-    pgn_stream_ << "[Termination \"" << result.termination << "\"]\n";
-    pgn_stream_ << "[PlyCount \"" << result.ply_count << "\"]\n";
-    pgn_stream_ << "[FEN \"" << result.start_fen << "\"]\n";
-    pgn_stream_ << "[SetUp \"1\"]\n\n";
-
-    pgn_stream_ << format_moves(result.moves_san);
-    if (!result.moves_san.empty()) {
-        pgn_stream_ << ' ';
-    }
-    pgn_stream_ << result.result << "\n\n";
-    pgn_stream_.flush();
+    trace::Span span("write_pgn");
+    std::time_t now_time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &now_time);
+#else
+    localtime_r(&now_time, &tm);
+#endif
+
+    std::ostringstream pgn;
+    pgn << "[Event \"Chiron Self-Play\"]\n";
+    pgn << "[Site \"Local\"]\n";
+    pgn << "[Date \"" << std::put_time(&tm, "%Y.%m.%d") << "\"]\n";
+    pgn << "[Round \"" << (game_index + 1) << "\"]\n";
+    pgn << "[White \"" << result.white_player << "\"]\n";
+    pgn << "[Black \"" << result.black_player << "\"]\n";
+    pgn << "[Result \"" << result.result << "\"]\n";
+    pgn << "[Termination \"" << result.termination << "\"]\n";
+    pgn << "[PlyCount \"" << result.ply_count << "\"]\n";
+    pgn << "[FEN \"" << result.start_fen << "\"]\n";
+    pgn << "[SetUp \"1\"]\n\n";
+
+    pgn << format_moves(moves_san, result.start_fen);
+    if (!moves_san.empty()) {
+        pgn << ' ';
+    }
+    pgn << result.result << "\n\n";
+    log_sink_.write(kPgnChannel, pgn.str());
 }
 
-void SelfPlayOrchestrator::handle_training(const SelfPlayResult& result) {
+std::size_t SelfPlayOrchestrator::handle_training(const SelfPlayResult& result) {
     if (!config_.enable_training) {
-        return;
+        return 0;
+    }
+    trace::Span span("collect_training");
+
+    int base_target = 0;
+    if (result.result == "1-0") {
+        base_target = 1000;
+    } else if (result.result == "0-1") {
+        base_target = -1000;
     }
 
-    std::size_t added = 1 + result.fens.size();
+    // Replay the game once, formatting only the positions the filter keeps.
+    std::vector<TrainingExample> positions;
+    positions.reserve(1 + result.moves.size());
+    bool keep_all = position_filter_->config().keeps_everything();
+    result.replay([&](const Board& board, int ply) {
+        if (keep_all || position_filter_->accept(board, ply)) {
+            int target = board.side_to_move() == Color::White ? base_target : -base_target;
+            positions.push_back({board.fen(), target});
+        }
+    });
+    std::size_t skipped = 1 + result.moves.size() - positions.size();
+    std::size_t added = positions.size();
 
     if (config_.teacher_mode) {
         std::vector<std::string> fen_batch;
         {
-            std::lock_guard<std::mutex> lock(training_mutex_);
-            teacher_queue_.push_back(result.start_fen);
-            teacher_queue_.insert(teacher_queue_.end(), result.fens.begin(), result.fens.end());
+            std::unique_lock<std::mutex> lock(training_mutex_);
+            wait_for_training_space(lock, true);
+            for (TrainingExample& position : positions) {
+                teacher_queue_.push_back(std::move(position.fen));
+            }
             total_positions_collected_ += added;
 
             if (config_.verbose) {
                 std::ostringstream collect;
-                collect << "[Train] Queued " << added << " positions for teacher (queue "
+                collect << "[Train] Queued " << added << " positions for teacher (skipped " << skipped << ", queue "
                         << teacher_queue_.size() << '/' << config_.teacher_chunk_size
                         << ", total collected " << total_positions_collected_ << ')';
                 log_verbose(collect.str());
             }
 
-            if (teacher_queue_.size() >= config_.teacher_chunk_size) {
-                std::size_t chunk = std::min(config_.teacher_chunk_size, teacher_queue_.size());
-                fen_batch.assign(teacher_queue_.begin(), teacher_queue_.begin() + chunk);
-                teacher_queue_.erase(teacher_queue_.begin(), teacher_queue_.begin() + chunk);
+            if (teacher_queue_.size() < config_.teacher_chunk_size) {
+                return added;
             }
+            if (training_thread_active_) {
+                training_cv_.notify_one();
+                return added;
+            }
+            fen_batch = take_teacher_chunk_locked();
         }
 
-        if (!fen_batch.empty()) {
+        // Without a training thread (a lone play_game() call) the caller labels and trains.
+        while (!fen_batch.empty()) {
             process_teacher_batch(std::move(fen_batch), false);
-            while (true) {
-                std::vector<std::string> next_batch;
-                {
-                    std::lock_guard<std::mutex> lock(training_mutex_);
-                    if (teacher_queue_.size() < config_.teacher_chunk_size) {
-                        break;
-                    }
-                    std::size_t chunk = std::min(config_.teacher_chunk_size, teacher_queue_.size());
-                    next_batch.assign(teacher_queue_.begin(), teacher_queue_.begin() + chunk);
-                    teacher_queue_.erase(teacher_queue_.begin(), teacher_queue_.begin() + chunk);
-                }
-                process_teacher_batch(std::move(next_batch), false);
-            }
+            std::lock_guard<std::mutex> lock(training_mutex_);
+            fen_batch = teacher_queue_.size() >= config_.teacher_chunk_size ? take_teacher_chunk_locked()
+                                                                              : std::vector<std::string>{};
         }
-        return;
+        return added;
     }
 
-    int base_target = 0;
-    if (result.result == "1-0") {
-        base_target = 1000;
-    } else if (result.result == "0-1") {
-        base_target = -1000;
+    {
+        std::unique_lock<std::mutex> lock(training_mutex_);
+        wait_for_training_space(lock, false);
+        for (TrainingExample& position : positions) {
+            training_buffer_.push_back(std::move(position));
+        }
+
+        total_positions_collected_ += added;
+        std::ostringstream collect;
+        collect << "[Train] Collected " << added << " positions (skipped " << skipped << ", buffer "
+                << training_buffer_.size() << '/' << config_.training_batch_size << ", total collected "
+                << total_positions_collected_ << ')';
+        log_lite(collect.str());
+
+        if (training_thread_active_) {
+            if (training_buffer_.size() >= config_.training_batch_size) {
+                training_cv_.notify_one();
+            }
+            return added;
+        }
     }
+    train_if_ready(false);
+    return added;
+}
 
-    std::lock_guard<std::mutex> lock(training_mutex_);
-    training_buffer_.push_back({result.start_fen, orient_target_for_fen(result.start_fen, base_target)});
-    for (const std::string& fen : result.fens) {
-        training_buffer_.push_back({fen, orient_target_for_fen(fen, base_target)});
+void SelfPlayOrchestrator::start_training_thread() {
+    if (!config_.enable_training) {
+        return;
     }
+    {
+        std::lock_guard<std::mutex> lock(training_mutex_);
+        training_stop_ = false;
+        training_thread_active_ = true;
+    }
+    training_thread_ = std::thread(&SelfPlayOrchestrator::training_loop, this);
+}
 
-    total_positions_collected_ += added;
+void SelfPlayOrchestrator::stop_training_thread() {
     {
-        std::ostringstream collect;
-        collect << "[Train] Collected " << added << " positions (buffer " << training_buffer_.size() << '/'
-                << config_.training_batch_size << ", total collected " << total_positions_collected_ << ')';
-        log_lite(collect.str());
+        std::lock_guard<std::mutex> lock(training_mutex_);
+        if (!training_thread_active_) {
+            return;
+        }
+        training_stop_ = true;
     }
+    training_cv_.notify_one();
+    training_space_cv_.notify_all();
+    training_thread_.join();
+    std::lock_guard<std::mutex> lock(training_mutex_);
+    training_thread_active_ = false;
+}
 
-    train_buffer_if_ready_locked(false);
+void SelfPlayOrchestrator::wait_for_training_space(std::unique_lock<std::mutex>& lock, bool teacher_queue) {
+    // Only a training thread drains the queues; a lone caller trains on them itself.
+    std::size_t unit = std::max<std::size_t>(1, teacher_queue ? config_.teacher_chunk_size : config_.training_batch_size);
+    std::size_t capacity = std::max<std::size_t>(1, config_.training_queue_batches) * unit;
+    training_space_cv_.wait(lock, [&] {
+        std::size_t queued = teacher_queue ? teacher_queue_.size() : training_buffer_.size();
+        return !training_thread_active_ || training_stop_ || queued < capacity;
+    });
 }
 
+bool SelfPlayOrchestrator::training_work_ready_locked() const {
+    if (config_.teacher_mode && teacher_engine_ && teacher_queue_.size() >= config_.teacher_chunk_size) {
+        return true;
+    }
+    return !training_buffer_.empty() && training_buffer_.size() >= config_.training_batch_size;
+}
 
-void SelfPlayOrchestrator::train_buffer_if_ready_locked(bool force) {
-    if (force && training_buffer_.empty()) {
-        log_lite("[Train] Forced training flush with empty buffer; no training performed.");
-        return;
+std::vector<std::string> SelfPlayOrchestrator::take_teacher_chunk_locked() {
+    std::size_t chunk = std::min(config_.teacher_chunk_size, teacher_queue_.size());
+    std::vector<std::string> fen_batch(std::make_move_iterator(teacher_queue_.begin()),
+                                       std::make_move_iterator(teacher_queue_.begin() + chunk));
+    teacher_queue_.erase(teacher_queue_.begin(), teacher_queue_.begin() + chunk);
+    return fen_batch;
+}
+
+void SelfPlayOrchestrator::training_loop() {
+    // Consumer side of the pipeline: game workers only append to the queues and notify, while
+    // labelling, optimisation and network saves happen here with training_mutex_ released.
+    std::unique_lock<std::mutex> lock(training_mutex_);
+    while (true) {
+        training_cv_.wait(lock, [this] { return training_stop_ || training_work_ready_locked(); });
+        if (!training_work_ready_locked()) {
+            return;  // Stopping; finalize_training() flushes what is left.
+        }
+        if (config_.teacher_mode && teacher_engine_ && teacher_queue_.size() >= config_.teacher_chunk_size) {
+            std::vector<std::string> fen_batch = take_teacher_chunk_locked();
+            lock.unlock();
+            training_space_cv_.notify_all();
+            process_teacher_batch(std::move(fen_batch), false);
+            lock.lock();
+            continue;
+        }
+        std::vector<TrainingExample> batch;
+        batch.swap(training_buffer_);
+        training_buffer_.reserve(config_.training_batch_size);
+        lock.unlock();
+        training_space_cv_.notify_all();
+        train_and_publish(std::move(batch), false);
+        lock.lock();
     }
+}
 
-    if (training_buffer_.empty()) {
-        return;
+void SelfPlayOrchestrator::train_if_ready(bool force) {
+    std::vector<TrainingExample> batch;
+    {
+        std::lock_guard<std::mutex> lock(training_mutex_);
+        if (force && training_buffer_.empty()) {
+            log_lite("[Train] Forced training flush with empty buffer; no training performed.");
+            return;
+        }
+        if (training_buffer_.empty()) {
+            return;
+        }
+        if (!force && training_buffer_.size() < config_.training_batch_size) {
+            return;
+        }
+        batch.swap(training_buffer_);
+        training_buffer_.reserve(config_.training_batch_size);
     }
-    if (!force && training_buffer_.size() < config_.training_batch_size) {
+    training_space_cv_.notify_all();
+    train_and_publish(std::move(batch), force);
+}
+
+void SelfPlayOrchestrator::train_and_publish(std::vector<TrainingExample> batch, bool force) {
+    trace::Span span("train_and_publish");
+    std::lock_guard<std::mutex> weights_lock(weights_mutex_);
+    std::size_t batch_size = batch.size();
+    if (config_.training_sink) {
+        total_positions_trained_ += batch_size;
+        config_.training_sink(std::move(batch));
         return;
     }
-
-    std::size_t batch = training_buffer_.size();
-    std::size_t projected_total = total_positions_trained_ + batch;
+    std::size_t projected_total = total_positions_trained_ + batch_size;
 
     {
         std::ostringstream flush;
-        flush << "[Train] Flushing training buffer with " << batch << " positions (force="
+        flush << "[Train] Flushing training buffer with " << batch_size << " positions (force="
               << (force ? "true" : "false") << ", total collected " << total_positions_collected_
               << ", total trained " << projected_total << ')';
         log_lite(flush.str());
     }
 
-    trainer_.train_batch(training_buffer_, parameters_);
-    training_buffer_.clear();
-    total_positions_trained_ += batch;
+    trainer_.train_batch(batch, parameters_);
+    total_positions_trained_ += batch_size;
     ++training_iteration_;
 
     std::string updated_network_path;
@@ -972,6 +1351,12 @@ void SelfPlayOrchestrator::train_buffer_if_ready_locked(bool force) {
         }
         parameters_.save(output_path.string());
         set_global_network_path(output_path.string());
+
+        // Games starting from now pick up the new weights without re-reading the file.
+        auto trained = std::make_shared<TrainedNetwork>();
+        trained->path = output_path.string();
+        trained->network = std::make_shared<const nnue::Network>(std::as_const(parameters_).network());
+        std::atomic_store(&trained_network_, std::shared_ptr<const TrainedNetwork>(std::move(trained)));
         {
             std::lock_guard<std::mutex> config_lock(config_mutex_);
             config_.white.network_path = output_path.string();
@@ -994,7 +1379,7 @@ void SelfPlayOrchestrator::train_buffer_if_ready_locked(bool force) {
 
     if (config_.verbose) {
         std::ostringstream train_msg;
-        train_msg << "[Train] Iteration " << training_iteration_ << " trained on " << batch
+        train_msg << "[Train] Iteration " << training_iteration_ << " trained on " << batch_size
                   << " positions (total trained " << total_positions_trained_ << ')';
         if (!updated_network_path.empty()) {
             train_msg << ". Updated network: " << updated_network_path;
@@ -1016,18 +1401,19 @@ void SelfPlayOrchestrator::process_teacher_batch(std::vector<std::string> fen_ba
     if (!teacher_engine_ || fen_batch.empty()) {
         return;
     }
+    trace::Span span("teacher_batch");
     std::vector<int> scores = teacher_engine_->evaluate(fen_batch);
     if (scores.size() != fen_batch.size()) {
         throw std::runtime_error("Teacher engine returned an unexpected number of evaluations");
     }
 
-    std::lock_guard<std::mutex> lock(training_mutex_);
-    for (std::size_t i = 0; i < fen_batch.size(); ++i) {
-        training_buffer_.push_back({std::move(fen_batch[i]), scores[i]});
-    }
-
-    total_positions_collected_ += scores.size();
     {
+        std::lock_guard<std::mutex> lock(training_mutex_);
+        for (std::size_t i = 0; i < fen_batch.size(); ++i) {
+            training_buffer_.push_back({std::move(fen_batch[i]), scores[i]});
+        }
+
+        total_positions_collected_ += scores.size();
         std::ostringstream collect;
         collect << "[Train] Teacher labelled " << scores.size() << " positions (buffer "
                 << training_buffer_.size() << '/' << config_.training_batch_size
@@ -1035,7 +1421,7 @@ void SelfPlayOrchestrator::process_teacher_batch(std::vector<std::string> fen_ba
         log_lite(collect.str());
     }
 
-    train_buffer_if_ready_locked(force);
+    train_if_ready(force);
 }
 
 void SelfPlayOrchestrator::finalize_training() {
@@ -1052,20 +1438,13 @@ void SelfPlayOrchestrator::finalize_training() {
                 if (teacher_queue_.empty()) {
                     break;
                 }
-                std::size_t chunk = std::min(config_.teacher_chunk_size, teacher_queue_.size());
-                fen_batch.assign(teacher_queue_.begin(), teacher_queue_.begin() + chunk);
-                teacher_queue_.erase(teacher_queue_.begin(), teacher_queue_.begin() + chunk);
+                fen_batch = take_teacher_chunk_locked();
                 queue_empty = teacher_queue_.empty();
             }
             process_teacher_batch(std::move(fen_batch), queue_empty);
         }
-        std::lock_guard<std::mutex> lock(training_mutex_);
-        train_buffer_if_ready_locked(true);
-        return;
     }
-
-    std::lock_guard<std::mutex> lock(training_mutex_);
-    train_buffer_if_ready_locked(true);
+    train_if_ready(true);
 }
 
 
@@ -1076,12 +1455,7 @@ void SelfPlayOrchestrator::log_verbose(const std::string& message) {
     log_lite(message);
 }
 
-void SelfPlayOrchestrator::log_lite(const std::string& message) {
-    std::lock_guard<std::mutex> lock(log_mutex_);
-    std::cout << message << std::endl;
-
-
-}
+void SelfPlayOrchestrator::log_lite(const std::string& message) { log_sink_.write(kConsoleChannel, message + '\n'); }
 
 void SelfPlayOrchestrator::record_elo(int game_index, const SelfPlayResult& result) {
     double score = result_to_white_score(result.result);
@@ -1,18 +1,31 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iostream>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <random>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 #include "board.h"
+#include "book.h"
 #include "search.h"
+#include "syzygy.h"
 #include "tools/teacher.h"
 #include "training/elo_tracker.h"
+#include "training/log_sink.h"
+#include "training/openings.h"
+#include "training/position_filter.h"
 #include "training/trainer.h"
 
 namespace chiron {
@@ -20,9 +33,20 @@ namespace chiron {
 struct EngineConfig {
     std::string name = "Chiron";
     int max_depth = 6;
+    std::uint64_t soft_nodes = 0;  /**< No new iteration starts after this many nodes (0 = none). */
+    std::uint64_t hard_nodes = 0;  /**< The search stops outright at this many nodes (0 = none). */
     std::size_t table_size = 1ULL << 20;
     std::string network_path;
     int threads = 1;
+    bool continuation_history = false;  /**< See Search::set_continuation_history(). */
+};
+
+/**
+ * @brief Weights produced by in-process training, handed to games by an atomic pointer swap.
+ */
+struct TrainedNetwork {
+    std::string path;  /**< File the weights were saved to; engines configured with it adopt them. */
+    std::shared_ptr<const nnue::Network> network;
 };
 
 struct SelfPlayConfig {
@@ -33,7 +57,8 @@ struct SelfPlayConfig {
     int max_ply = 1024;
     bool capture_results = true;
     bool capture_pgn = true;
-    bool record_fens = false;
+    bool record_fens = false;  /**< Also log the position after every move in the results log. */
+    bool record_moves = true;  /**< Print the moves in the results log and PGN; verbose always formats them. */
     bool verbose = false;
     bool verbose_lite = false;
     std::string results_log = "selfplay_results.jsonl";
@@ -47,72 +72,238 @@ struct SelfPlayConfig {
     std::string training_output_path = "nnue/models/chiron-selfplay-latest.nnue";
     std::string training_history_dir = "nnue/models/history";
     std::size_t training_hidden_size = nnue::kDefaultHiddenSize;
+    nnue::FeatureSet training_features = nnue::FeatureSet::PieceSquare; /**< Inputs of a freshly created network. */
     TrainerDevice training_device = TrainerDevice::kCPU;
+    std::size_t training_threads = 1;  /**< CPU trainer threads per batch (0 = all cores). */
+    OptimizerConfig training_optimizer{};
     bool teacher_mode = false;
     TeacherConfig teacher{};
     std::size_t teacher_chunk_size = 256;
+    /** Batches (teacher chunks in teacher mode) queued for the training thread before game workers wait. */
+    std::size_t training_queue_batches = 4;
     double randomness_temperature = 0.7;  /**< Softmax temperature for randomized move selection. */
     int randomness_max_ply = 24;          /**< Apply randomness up to this ply (0 = entire game). */
     int randomness_top_moves = 4;         /**< Consider at most this many moves when randomizing. */
     int randomness_score_margin = 40;     /**< Only randomize among moves within this score margin (cp). */
+    std::string openings_path;  /**< EPD or PGN start positions, each played by a colour-swapped pair. */
+    int opening_max_plies = 0;  /**< Plies of each PGN opening to play out (0 = all of them). */
+    std::string syzygy_path;    /**< Syzygy directories; covered positions are adjudicated and probed in search. */
+    std::string book_path;      /**< Opening book probed before every search; book moves are played at once. */
+    PositionFilterConfig training_filter{};  /**< Which positions of each game are labelled and trained on. */
+    /** Filter to use instead of one built from training_filter, so deduplication spans sessions. */
+    std::shared_ptr<PositionFilter> position_filter;
+    /**
+     * Receives every labelled training batch instead of the orchestrator's own trainer, so a driver
+     * that owns the weights (LearningRegimen) trains them; nothing is trained or saved here then.
+     */
+    std::function<void(std::vector<TrainingExample>)> training_sink;
+    /** Weights the games start on in place of training_output_path's file; see publish_network(). */
+    std::shared_ptr<const TrainedNetwork> initial_network;
 };
 
+/**
+ * @brief A finished game, recorded compactly as its start position and the 16-bit moves played.
+ *
+ * SAN and FENs are produced on demand by replaying the moves, so only the logs that print them
+ * and the training collector pay for the formatting.
+ */
 struct SelfPlayResult {
     std::string white_player;
     std::string black_player;
     std::string result;
     std::string termination;
     int ply_count = 0;
-    std::vector<std::string> moves_san;
-    std::vector<std::string> fens;
+    std::vector<PackedMove> moves;
     std::string start_fen;
     std::string end_fen;
     double duration_ms = 0.0;
+
+    /** @brief Calls @p visit with each position of the game and its ply, from start_fen (ply 0) to the end. */
+    void replay(const std::function<void(const Board&, int)>& visit) const;
+    /** @brief The moves in SAN. */
+    [[nodiscard]] std::vector<std::string> san_moves() const;
+    /** @brief FEN of the position after each move. */
+    [[nodiscard]] std::vector<std::string> fens() const;
+};
+
+/**
+ * @brief Search instances and evaluators one self-play worker reuses from game to game.
+ *
+ * A fresh Search allocates and zeroes its whole transposition table, which dominates short
+ * games. The pool keeps two engines alive instead and, per game, only rebinds what differs
+ * from the last one: a new network path, or the same file saved again, swaps in a new evaluator,
+ * a new table size resizes, a new thread count respawns helpers. Everything else starts with
+ * Search::new_game().
+ */
+class SelfPlayEnginePool {
+   public:
+    struct Engines {
+        Search& white;
+        Search& black;
+    };
+
+    /**
+     * @brief Returns engines configured for @p white and @p black, ready for a new game.
+     *
+     * When the colors swap between games the engines swap with them, so alternating two
+     * networks never reloads either. An engine whose network path is @p trained's path plays
+     * with those in-memory weights, rebinding only when a newer snapshot was published.
+     */
+    Engines acquire(const EngineConfig& white, const EngineConfig& black,
+                    const std::shared_ptr<const TrainedNetwork>& trained = nullptr);
+
+   private:
+    struct Slot {
+        std::string network_path;
+        std::filesystem::file_time_type network_written{};  // Of the file, to notice it being saved again.
+        std::uintmax_t network_bytes = 0;
+        std::size_t table_size = 0;
+        std::shared_ptr<const nnue::Network> trained;  // Snapshot bound instead of the file, if any.
+        std::shared_ptr<nnue::Evaluator> evaluator;
+        std::unique_ptr<Search> search;
+    };
+
+    Search& bind(Slot& slot, const EngineConfig& config, const TrainedNetwork* trained);
+
+    std::array<Slot, kNumColors> slots_{};
 };
 
 class SelfPlayOrchestrator {
    public:
     explicit SelfPlayOrchestrator(SelfPlayConfig config);
+    ~SelfPlayOrchestrator();
 
+    SelfPlayOrchestrator(const SelfPlayOrchestrator&) = delete;
+    SelfPlayOrchestrator& operator=(const SelfPlayOrchestrator&) = delete;
+
+    /**
+     * @brief Plays every configured game on config.concurrency workers.
+     *
+     * Workers claim games from a GamePairScheduler, so consecutive games form colour-swapped
+     * pairs starting from the same opening when an openings file is configured.
+     *
+     * With training enabled a dedicated thread labels (teacher mode) and trains on the
+     * positions the games produce, so workers never wait for the optimiser; each update is
+     * published to games that start afterwards.
+     */
     void run();
-    SelfPlayResult play_game(int game_index, const EngineConfig& white, const EngineConfig& black, bool log_outputs);
+
+    /**
+     * @brief The setup and teardown run() wraps around its workers, for drivers that play the
+     *        games elsewhere and feed them back through record_game() (see run_coordinator()).
+     *        @p concurrency is only reported; 0 stands for remote workers.
+     */
+    void begin_session(int concurrency);
+    void end_session();
+
+    /**
+     * @brief Logs, trains on and rates a finished game as play_game() does for its own games.
+     */
+    void record_game(int game_index, const SelfPlayResult& result, bool log_outputs);
+
+    /** @brief The engines of the next game, whose network paths training moves to its output. */
+    [[nodiscard]] std::pair<EngineConfig, EngineConfig> current_engines() const;
+
+    /** @brief The configuration; read engine settings through current_engines() instead. */
+    [[nodiscard]] const SelfPlayConfig& config() const { return config_; }
+
+    /**
+     * @brief Plays one game from @p start_fen (the standard start position when empty); its log
+     *        records are written out before the call returns.
+     */
+    SelfPlayResult play_game(int game_index, const EngineConfig& white, const EngineConfig& black, bool log_outputs,
+                             const std::string& start_fen = {});
+
+    /**
+     * @brief Plays a game on engines from @p engines; run() gives every worker its own pool.
+     *        Log records are queued for the background writer, which end_session() drains.
+     */
+    SelfPlayResult play_game(int game_index, const EngineConfig& white, const EngineConfig& black, bool log_outputs,
+                             SelfPlayEnginePool& engines, const std::string& start_fen = {});
+
+    /**
+     * @brief Stops every game in progress at its current search, and any started later, until
+     *        resume_games(). Such games end unfinished with termination "cancelled" and are
+     *        neither trained on nor rated.
+     */
+    void cancel_games();
+    void resume_games();
+
+    /**
+     * @brief Hands @p network to games that start from now on; engines whose network path is
+     *        its path play with the in-memory weights. Safe to call while run() is playing.
+     */
+    void publish_network(std::shared_ptr<const TrainedNetwork> network);
+
+    /** @brief Openings loaded from config.openings_path, or null when none were configured. */
+    [[nodiscard]] std::shared_ptr<const OpeningSuite> openings() const { return openings_; }
 
    private:
-    SelfPlayResult play_single_game(int game_index, const EngineConfig& white, const EngineConfig& black);
-    void log_result(int game_index, const SelfPlayResult& result);
-    void write_pgn(int game_index, const SelfPlayResult& result);
+    SelfPlayResult play_single_game(int game_index, const EngineConfig& white, const EngineConfig& black,
+                                    SelfPlayEnginePool& engines, const std::string& start_fen);
+    void log_result(int game_index, const SelfPlayResult& result, const std::vector<std::string>& moves_san);
+    void write_pgn(int game_index, const SelfPlayResult& result, const std::vector<std::string>& moves_san);
     void ensure_streams();
-    void handle_training(const SelfPlayResult& result);
+    /** @brief Queues the game's positions the filter keeps for training; returns how many. */
+    std::size_t handle_training(const SelfPlayResult& result);
     void log_verbose(const std::string& message);
     void log_lite(const std::string& message);
     void record_elo(int game_index, const SelfPlayResult& result);
+    void start_training_thread();
+    void stop_training_thread();
+    void training_loop();
+    [[nodiscard]] bool training_work_ready_locked() const;
+    [[nodiscard]] std::vector<std::string> take_teacher_chunk_locked();
+    /** @brief Blocks a game worker while the teacher queue or training buffer is at capacity. */
+    void wait_for_training_space(std::unique_lock<std::mutex>& lock, bool teacher_queue);
+    void train_if_ready(bool force);
+    void train_and_publish(std::vector<TrainingExample> batch, bool force);
     void log_rating_snapshot(const std::string& prefix);
     void load_existing_elo_history();
     Move select_move(const SearchResult& search_result, int ply);
-    void train_buffer_if_ready_locked(bool force);
+    /** @brief A weighted random move from the opening book for @p board, if there is one. */
+    std::optional<Move> book_move(const Board& board);
     void process_teacher_batch(std::vector<std::string> fen_batch, bool force);
     void finalize_training();
 
     SelfPlayConfig config_;
+    std::shared_ptr<const OpeningSuite> openings_;
+    std::shared_ptr<const SyzygyTablebases> tablebases_;  // Null without usable tables.
+    std::shared_ptr<const OpeningBook> book_;             // Null without config.book_path.
     std::mt19937 rng_;
+    std::mutex rng_mutex_;  // Workers pick randomized moves concurrently.
+    std::atomic<bool> games_cancelled_{false};  // Doubles as the stop flag of every search.
     std::ofstream results_stream_;
     std::ofstream pgn_stream_;
-    bool streams_open_ = false;
-    std::mutex log_mutex_;
-    std::mutex training_mutex_;
+    std::atomic<bool> streams_open_{false};
+    std::mutex log_mutex_;  // Serialises opening the streams.
+    // Results, PGN and console output, written by a background thread; declared after the
+    // streams so it drains into them before they close.
+    AsyncLogSink log_sink_{{&results_stream_, &pgn_stream_, &std::cout}};
+    std::mutex training_mutex_;  // Guards the buffers below; never held while training.
+    std::condition_variable training_cv_;
+    std::condition_variable training_space_cv_;  // Game workers wait here while the queues are full.
+    std::thread training_thread_;
+    bool training_thread_active_ = false;
+    bool training_stop_ = false;
+    std::mutex weights_mutex_;  // Serialises train_and_publish() over trainer_ and parameters_.
+    std::shared_ptr<const TrainedNetwork> trained_network_;  // Read and swapped with std::atomic_load/store.
     mutable std::mutex config_mutex_;
     std::mutex elo_mutex_;
     Trainer trainer_;
     ParameterSet parameters_;
+    std::shared_ptr<PositionFilter> position_filter_;  // Set when training is enabled.
     std::vector<TrainingExample> training_buffer_;
     std::vector<std::string> teacher_queue_;
     std::unique_ptr<TeacherEngine> teacher_engine_;
     int training_iteration_ = 0;
     std::string training_history_prefix_;
     std::string training_history_extension_;
-    std::size_t total_positions_collected_ = 0;
-    std::size_t total_positions_trained_ = 0;
+    std::atomic<std::size_t> total_positions_collected_{0};
+    std::atomic<std::size_t> total_positions_trained_{0};
     EloTracker elo_tracker_{};
+    std::vector<std::unique_ptr<SelfPlayEnginePool>> idle_engines_;  // Lent to pool-less play_game() calls.
+    std::mutex idle_engines_mutex_;
 
     int detect_existing_history_iteration() const;
 };
@@ -1,14 +1,21 @@
 #include "training/trainer.h"
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <istream>
 #include <system_error>
 #include <sstream>
 #include <stdexcept>
+#include <string>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #ifdef _WIN32
@@ -23,12 +30,46 @@
 
 #include "bitboard.h"
 #include "nnue/evaluator.h"
+#include "nnue/feature_set.h"
+#include "trace.h"
 #include "training/gpu_backend.h"
 
 namespace chiron {
 
 namespace {
 
+/**
+ * @brief Reads the next well-formed "fen|score" line from @p stream into @p example.
+ */
+bool read_text_example(std::istream& stream, TrainingExample& example) {
+    std::string line;
+    while (std::getline(stream, line)) {
+        auto delimiter = line.find('|');
+        if (line.empty() || delimiter == std::string::npos) {
+            continue;
+        }
+        try {
+            example.target_cp = std::stoi(line.substr(delimiter + 1));
+        } catch (const std::exception&) {
+            continue;
+        }
+        example.fen = line.substr(0, delimiter);
+        example.packed.reset();
+        return true;
+    }
+    return false;
+}
+
+PackedPosition pack_example(const TrainingExample& example, Board& board) {
+    if (example.packed) {
+        PackedPosition packed = *example.packed;
+        packed.score = static_cast<std::int16_t>(std::clamp(example.target_cp, -32768, 32767));
+        return packed;
+    }
+    board.set_from_fen(example.fen);
+    return PackedPosition::from_board(board, example.target_cp);
+}
+
 std::filesystem::path make_unique_temp_path(const std::filesystem::path& target) {
     namespace fs = std::filesystem;
     auto parent = target.parent_path();
@@ -115,20 +156,14 @@ int evaluate_with_network(const Board& board, const nnue::Network& network) {
     std::size_t hidden = network.hidden_size();
     std::vector<int32_t> white(hidden, 0);
     std::vector<int32_t> black(hidden, 0);
+    std::array<std::size_t, nnue::kMaxActiveFeatures> features{};
     for (int color = 0; color < kNumColors; ++color) {
-        for (int piece = 0; piece < kNumPieceTypes; ++piece) {
-            Bitboard bb = board.pieces(static_cast<Color>(color), static_cast<PieceType>(piece));
-            while (bb) {
-                int sq = pop_lsb(bb);
-                std::size_t feature = nnue::feature_index(static_cast<Color>(color), static_cast<PieceType>(piece), sq);
-                for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
-                    int32_t weight = network.input_weight(feature, neuron);
-                    if (color == static_cast<int>(Color::White)) {
-                        white[neuron] += weight;
-                    } else {
-                        black[neuron] += weight;
-                    }
-                }
+        std::vector<int32_t>& lane = color == static_cast<int>(Color::White) ? white : black;
+        std::size_t count =
+            nnue::append_active_features(board, network.feature_set(), static_cast<Color>(color), features.data());
+        for (std::size_t i = 0; i < count; ++i) {
+            for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+                lane[neuron] += network.input_weight(features[i], neuron);
             }
         }
     }
@@ -146,124 +181,408 @@ int evaluate_with_network(const Board& board, const nnue::Network& network) {
     return board.side_to_move() == Color::White ? eval : -eval;
 }
 
-void train_batch_cpu(const std::vector<TrainingExample>& batch, nnue::Network& net,
-                     const Trainer::Config& config) {
-    std::size_t hidden = net.hidden_size();
-    std::vector<std::size_t> white_features;
-    std::vector<std::size_t> black_features;
-    white_features.reserve(32);
-    black_features.reserve(32);
-    std::vector<int32_t> white_accum(hidden);
-    std::vector<int32_t> black_accum(hidden);
-    std::vector<double> activations(hidden);
-    std::vector<double> activation_derivatives(hidden);
+/**
+ * @brief Gradient sums of one shard of a batch.
+ *
+ * Input rows are kept only for features that were active somewhere in the shard, in first-use
+ * order, so the memory touched scales with the positions seen rather than the feature count.
+ */
+struct GradientShard {
+    double bias = 0.0;
+    std::vector<double> output;
+    std::vector<double> hidden_bias;
+    std::unordered_map<std::size_t, std::size_t> row_index;
+    std::vector<std::size_t> row_features;
+    std::vector<std::uint32_t> row_hits;  // Lane occurrences, for the per-sample weight decay.
+    std::vector<double> rows;
+    std::size_t hidden = 0;
+
+    void reset(std::size_t hidden_size) {
+        hidden = hidden_size;
+        bias = 0.0;
+        output.assign(hidden, 0.0);
+        hidden_bias.assign(hidden, 0.0);
+        row_index.clear();
+        row_features.clear();
+        row_hits.clear();
+        rows.clear();
+    }
 
-    for (const TrainingExample& example : batch) {
-        Board board;
-        board.set_from_fen(example.fen);
+    double* row(std::size_t feature) {
+        auto [it, inserted] = row_index.try_emplace(feature, row_features.size());
+        if (inserted) {
+            row_features.push_back(feature);
+            row_hits.push_back(0);
+            rows.resize(rows.size() + hidden, 0.0);
+        }
+        ++row_hits[it->second];
+        return rows.data() + it->second * hidden;
+    }
 
-        white_features.clear();
-        black_features.clear();
-        for (int color = 0; color < kNumColors; ++color) {
-            for (int piece = 0; piece < kNumPieceTypes; ++piece) {
-                Bitboard bb = board.pieces(static_cast<Color>(color), static_cast<PieceType>(piece));
-                while (bb) {
-                    int square = pop_lsb(bb);
-                    std::size_t feature =
-                        nnue::feature_index(static_cast<Color>(color), static_cast<PieceType>(piece), square);
-                    if (color == static_cast<int>(Color::White)) {
-                        white_features.push_back(feature);
-                    } else {
-                        black_features.push_back(feature);
-                    }
-                }
+    void merge(const GradientShard& other) {
+        bias += other.bias;
+        for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+            output[neuron] += other.output[neuron];
+            hidden_bias[neuron] += other.hidden_bias[neuron];
+        }
+        for (std::size_t i = 0; i < other.row_features.size(); ++i) {
+            double* target = row(other.row_features[i]);
+            row_hits[row_index[other.row_features[i]]] += other.row_hits[i] - 1;
+            const double* source = other.rows.data() + i * hidden;
+            for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+                target[neuron] += source[neuron];
             }
         }
-
-        std::fill(white_accum.begin(), white_accum.end(), 0);
-        std::fill(black_accum.begin(), black_accum.end(), 0);
-        for (std::size_t feature : white_features) {
+    }
+};
+
+/**
+ * @brief Accumulates the gradients of examples @p begin..@p end of @p batch against the
+ *        (unchanging) weights.
+ *
+ * @p Weights is nnue::Network for SGD or MasterWeights for Adam; both expose the same reads.
+ * Integer weights are summed exactly in double, so the SGD results do not depend on which.
+ * @p learning_rate scales the sums (Adam passes 1 and applies its own step size).
+ */
+template <typename Weights>
+void accumulate_gradients(const FeatureBatch& batch, std::size_t begin, std::size_t end, const Weights& net,
+                          double learning_rate, GradientShard& shard) {
+    std::size_t hidden = net.hidden_size();
+    std::vector<double> white_accum(hidden);
+    std::vector<double> black_accum(hidden);
+    std::vector<double> activations(hidden);
+    std::vector<double> activation_derivatives(hidden);
+    std::vector<double> grad_pre(hidden);
+
+    for (std::size_t example = begin; example != end; ++example) {
+        // The white lane's features push the evaluation up and the black lane's push it down,
+        // for either feature set.
+        const std::uint32_t* white_features = batch.features.data() + batch.offsets[2 * example];
+        const std::uint32_t* black_features = batch.features.data() + batch.offsets[2 * example + 1];
+        std::size_t white_count = batch.offsets[2 * example + 1] - batch.offsets[2 * example];
+        std::size_t black_count = batch.offsets[2 * example + 2] - batch.offsets[2 * example + 1];
+
+        std::fill(white_accum.begin(), white_accum.end(), 0.0);
+        std::fill(black_accum.begin(), black_accum.end(), 0.0);
+        for (std::size_t i = 0; i < white_count; ++i) {
+            const auto* weights = net.feature_weights(white_features[i]);
             for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
-                white_accum[neuron] += net.input_weight(feature, neuron);
+                white_accum[neuron] += static_cast<double>(weights[neuron]);
             }
         }
-        for (std::size_t feature : black_features) {
+        for (std::size_t i = 0; i < black_count; ++i) {
+            const auto* weights = net.feature_weights(black_features[i]);
             for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
-                black_accum[neuron] += net.input_weight(feature, neuron);
+                black_accum[neuron] += static_cast<double>(weights[neuron]);
             }
         }
 
         double raw = static_cast<double>(net.bias());
         for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
-            int32_t pre = white_accum[neuron] - black_accum[neuron] + net.hidden_bias(neuron);
-            double normalized = static_cast<double>(pre) / nnue::kActivationScale;
-            double tanh_val = std::tanh(normalized);
+            double pre = white_accum[neuron] - black_accum[neuron] + static_cast<double>(net.hidden_bias(neuron));
+            double tanh_val = std::tanh(pre / nnue::kActivationScale);
             activations[neuron] = tanh_val * nnue::kActivationScale;
             activation_derivatives[neuron] = 1.0 - tanh_val * tanh_val;
             raw += activations[neuron] * static_cast<double>(net.output_weight(neuron));
         }
 
-        double orientation = (board.side_to_move() == Color::White) ? 1.0 : -1.0;
+        double orientation = static_cast<double>(batch.orientations[example]);
         double predicted_cp = orientation * raw * static_cast<double>(net.scale());
-        double error = static_cast<double>(example.target_cp) - predicted_cp;
-        double lr_error = config.learning_rate * error * orientation * static_cast<double>(net.scale());
+        double error = static_cast<double>(batch.targets[example]) - predicted_cp;
+        double lr_error = learning_rate * error * orientation * static_cast<double>(net.scale());
 
-        double bias_current = static_cast<double>(net.bias());
-        double bias_next = bias_current + lr_error;
-        if (config.regularisation > 0.0) {
-            bias_next -= config.regularisation * bias_current;
+        shard.bias += lr_error;
+        for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+            shard.output[neuron] += lr_error * activations[neuron];
+            grad_pre[neuron] = lr_error * static_cast<double>(net.output_weight(neuron)) * activation_derivatives[neuron];
+            shard.hidden_bias[neuron] += grad_pre[neuron];
         }
-        net.set_bias(clamp_weight(static_cast<int>(std::llround(bias_next))));
+        for (std::size_t i = 0; i < white_count; ++i) {
+            double* row = shard.row(white_features[i]);
+            for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+                row[neuron] += grad_pre[neuron];
+            }
+        }
+        for (std::size_t i = 0; i < black_count; ++i) {
+            double* row = shard.row(black_features[i]);
+            for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+                row[neuron] -= grad_pre[neuron];
+            }
+        }
+    }
+}
+
+/**
+ * @brief One optimiser step from the summed gradients of @p samples positions.
+ *
+ * Weight decay compounds once per sample (once per lane occurrence for input rows), which is
+ * what applying the same decay after every sample would amount to.
+ */
+void apply_gradients(const GradientShard& gradients, std::size_t samples, nnue::Network& net,
+                     const Trainer::Config& config) {
+    auto decay = [&](std::size_t count) {
+        return config.regularisation > 0.0 ? std::pow(1.0 - config.regularisation, static_cast<double>(count)) : 1.0;
+    };
+    double sample_decay = decay(samples);
+    std::size_t hidden = gradients.hidden;
+
+    net.set_bias(clamp_weight(
+        static_cast<int>(std::llround(static_cast<double>(net.bias()) * sample_decay + gradients.bias))));
+    for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+        double output_next = static_cast<double>(net.output_weight(neuron)) * sample_decay + gradients.output[neuron];
+        net.set_output_weight(neuron, static_cast<float>(output_next));
+        double hidden_next =
+            static_cast<double>(net.hidden_bias(neuron)) * sample_decay + gradients.hidden_bias[neuron];
+        net.set_hidden_bias(neuron, clamp_weight(static_cast<int>(std::llround(hidden_next))));
+    }
 
+    for (std::size_t i = 0; i < gradients.row_features.size(); ++i) {
+        std::size_t feature = gradients.row_features[i];
+        double row_decay = decay(gradients.row_hits[i]);
+        const double* row = gradients.rows.data() + i * hidden;
         for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
-            double output_current = static_cast<double>(net.output_weight(neuron));
-            double output_next = output_current + lr_error * activations[neuron];
-            if (config.regularisation > 0.0) {
-                output_next -= config.regularisation * output_current;
-            }
-            net.set_output_weight(neuron, static_cast<float>(output_next));
+            double next = static_cast<double>(net.input_weight(feature, neuron)) * row_decay + row[neuron];
+            net.set_input_weight(feature, neuron, clamp_weight(static_cast<int>(std::llround(next))));
+        }
+    }
+}
 
-            double grad_pre = lr_error * output_current * activation_derivatives[neuron];
-            int32_t hidden_bias_current = net.hidden_bias(neuron);
-            double hidden_next = static_cast<double>(hidden_bias_current) + grad_pre;
-            if (config.regularisation > 0.0) {
-                hidden_next -= config.regularisation * static_cast<double>(hidden_bias_current);
-            }
-            net.set_hidden_bias(neuron, clamp_weight(static_cast<int>(std::llround(hidden_next))));
+/**
+ * @brief One Adam/AdamW step on the master weights; only the touched input rows move.
+ */
+void apply_adam(const GradientShard& gradients, std::size_t samples, MasterWeights& master,
+                const Trainer::Config& config) {
+    AdamStep step = AdamStep::make(config.optimizer, config.learning_rate, config.regularisation, master.next_step());
+    const float limit = static_cast<float>(kTrainerWeightLimit);
+    const float sample_count = static_cast<float>(samples);
+    std::size_t hidden = gradients.hidden;
+
+    adam_update(master.bias_value(), master.bias_first_moment(), master.bias_second_moment(),
+                static_cast<float>(gradients.bias), sample_count, step, 1.0F, limit);
+    auto& hidden_biases = master.hidden_biases();
+    auto& hidden_m = master.hidden_bias_first_moments();
+    auto& hidden_v = master.hidden_bias_second_moments();
+    auto& outputs = master.output_weights();
+    auto& output_m = master.output_first_moments();
+    auto& output_v = master.output_second_moments();
+    for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+        adam_update(hidden_biases[neuron], hidden_m[neuron], hidden_v[neuron],
+                    static_cast<float>(gradients.hidden_bias[neuron]), sample_count, step, 1.0F, limit);
+        adam_update(outputs[neuron], output_m[neuron], output_v[neuron], static_cast<float>(gradients.output[neuron]),
+                    sample_count, step, kOutputStepScale, 0.0F);
+    }
 
-            if (std::abs(grad_pre) < 1e-12) {
-                continue;
-            }
+    for (std::size_t i = 0; i < gradients.row_features.size(); ++i) {
+        std::size_t feature = gradients.row_features[i];
+        float* weights = master.feature_row(feature);
+        float* first = master.feature_first_moments(feature);
+        float* second = master.feature_second_moments(feature);
+        const double* row = gradients.rows.data() + i * hidden;
+        const float hits = static_cast<float>(gradients.row_hits[i]);
+        for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+            adam_update(weights[neuron], first[neuron], second[neuron], static_cast<float>(row[neuron]), hits, step,
+                        1.0F, limit);
+        }
+    }
+}
+
+// Below this many samples per shard, starting a thread costs more than the shard saves.
+constexpr std::size_t kMinSamplesPerShard = 32;
+
+/** @brief Shards for @p samples samples over the configured threads (0 = all cores). */
+std::size_t shard_count_for(std::size_t samples, const Trainer::Config& config) {
+    std::size_t threads = config.threads != 0 ? config.threads : std::max(1U, std::thread::hardware_concurrency());
+    return std::clamp<std::size_t>(samples / kMinSamplesPerShard, 1, threads);
+}
+
+/**
+ * @brief Calls @p run(index) for every shard, shard 0 on the calling thread and the others on
+ *        their own threads, and rethrows the first shard's failure once all have finished.
+ */
+template <typename Run>
+void run_shards(std::size_t shard_count, const Run& run) {
+    if (shard_count == 1) {
+        run(0);
+        return;
+    }
+    std::vector<std::thread> workers;
+    std::vector<std::exception_ptr> failures(shard_count);
+    workers.reserve(shard_count - 1);
+    auto run_shard = [&](std::size_t index) {
+        try {
+            run(index);
+        } catch (...) {
+            failures[index] = std::current_exception();
+        }
+    };
+    for (std::size_t index = 1; index < shard_count; ++index) {
+        workers.emplace_back(run_shard, index);
+    }
+    run_shard(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    for (const std::exception_ptr& failure : failures) {
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+}
+
+/** @brief First and one-past-last sample of shard @p index when @p samples are split @p shard_count ways. */
+std::pair<std::size_t, std::size_t> shard_bounds(std::size_t samples, std::size_t index, std::size_t shard_count) {
+    return {samples * index / shard_count, samples * (index + 1) / shard_count};
+}
+
+/**
+ * @brief Sums the gradients of @p batch, sharded over the configured threads, into one shard.
+ */
+template <typename Weights>
+GradientShard compute_gradients(const FeatureBatch& batch, const Weights& net,
+                                const Trainer::Config& config, double learning_rate) {
+    std::size_t shard_count = shard_count_for(batch.size(), config);
+    std::vector<GradientShard> shards(shard_count);
+    for (GradientShard& shard : shards) {
+        shard.reset(net.hidden_size());
+    }
 
-            for (std::size_t feature : white_features) {
-                int32_t current = net.input_weight(feature, neuron);
-                double next = static_cast<double>(current) + grad_pre;
-                if (config.regularisation > 0.0) {
-                    next -= config.regularisation * static_cast<double>(current);
-                }
-                net.set_input_weight(feature, neuron, clamp_weight(static_cast<int>(std::llround(next))));
+    run_shards(shard_count, [&](std::size_t index) {
+        auto [begin, end] = shard_bounds(batch.size(), index, shard_count);
+        accumulate_gradients(batch, begin, end, net, learning_rate, shards[index]);
+    });
+    // Reduce in shard order so a given thread count always produces the same weights.
+    for (std::size_t index = 1; index < shard_count; ++index) {
+        shards[0].merge(shards[index]);
+    }
+    return std::move(shards[0]);
+}
+
+/**
+ * @brief Scores examples @p begin..@p end of @p batch into @p scores, from the side to move's
+ *        point of view.
+ *
+ * Each lane adds (white) or subtracts (black) whole contiguous weight rows into one integer
+ * accumulator, which the compiler vectorises; the output layer then follows evaluate_with_network
+ * operation for operation, so the scores are identical to scoring each board on its own.
+ */
+void evaluate_features(const FeatureBatch& batch, std::size_t begin, std::size_t end, const nnue::Network& net,
+                       int* scores) {
+    std::size_t hidden = net.hidden_size();
+    std::vector<int32_t> accumulator(hidden);
+    const std::uint32_t* features = batch.features.data();
+    for (std::size_t example = begin; example != end; ++example) {
+        const std::uint32_t* lanes = batch.offsets.data() + 2 * example;
+        std::fill(accumulator.begin(), accumulator.end(), 0);
+        for (std::uint32_t i = lanes[0]; i < lanes[1]; ++i) {
+            const int32_t* weights = net.feature_weights(features[i]);
+            for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+                accumulator[neuron] += weights[neuron];
             }
-            for (std::size_t feature : black_features) {
-                int32_t current = net.input_weight(feature, neuron);
-                double next = static_cast<double>(current) - grad_pre;
-                if (config.regularisation > 0.0) {
-                    next -= config.regularisation * static_cast<double>(current);
-                }
-                net.set_input_weight(feature, neuron, clamp_weight(static_cast<int>(std::llround(next))));
+        }
+        for (std::uint32_t i = lanes[1]; i < lanes[2]; ++i) {
+            const int32_t* weights = net.feature_weights(features[i]);
+            for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+                accumulator[neuron] -= weights[neuron];
             }
         }
+
+        double raw = static_cast<double>(net.bias());
+        for (std::size_t neuron = 0; neuron < hidden; ++neuron) {
+            int32_t pre = accumulator[neuron] + net.hidden_bias(neuron);
+            double normalized = static_cast<double>(pre) / nnue::kActivationScale;
+            double activation = std::tanh(normalized) * nnue::kActivationScale;
+            raw += activation * static_cast<double>(net.output_weight(neuron));
+        }
+        double scaled = raw * static_cast<double>(net.scale());
+        int eval = static_cast<int>(std::llround(scaled));
+        eval = std::clamp(eval, -nnue::kMaxEvaluationMagnitude, nnue::kMaxEvaluationMagnitude);
+        scores[example] = batch.orientations[example] * eval;
     }
 }
 
+/**
+ * @brief True when @p config trains on the per-example CUDA kernel, which takes examples rather
+ *        than feature batches; unavailable or unsupported setups are reported by the batch path.
+ */
+bool trains_examples_on_gpu(const Trainer::Config& config) {
+    return config.device == TrainerDevice::kGPU && gpu::is_available() && !gpu::keeps_weights_resident() &&
+           config.optimizer.kind == OptimizerKind::kSgd;
+}
+
 }  // namespace
 
-ParameterSet::ParameterSet(std::size_t hidden_size) { network_.load_default(hidden_size); }
+ParameterSet::ParameterSet(std::size_t hidden_size, nnue::FeatureSet features) {
+    network_.load_default(hidden_size, features);
+}
+
+void ParameterSet::reset(std::size_t hidden_size) { reset(hidden_size, network_.feature_set()); }
+
+void ParameterSet::reset(std::size_t hidden_size, nnue::FeatureSet features) {
+    network_.load_default(hidden_size, features);
+    mark_host_changed();
+}
+
+void ParameterSet::load(const std::string& path) {
+    network_.load_from_file(path);
+    mark_host_changed();
+}
+
+nnue::Network& ParameterSet::network() {
+    pull_training_copies();
+    mark_host_changed();
+    return network_;
+}
+
+const nnue::Network& ParameterSet::network() const {
+    pull_training_copies();
+    return network_;
+}
 
-void ParameterSet::reset(std::size_t hidden_size) { network_.load_default(hidden_size); }
+void ParameterSet::pull_training_copies() const {
+    if (device_ahead_) {
+        gpu::download(*device_, network_);
+        device_ahead_ = false;
+    }
+    if (master_ahead_) {
+        master_->store(network_);
+        master_ahead_ = false;
+    }
+}
+
+void ParameterSet::mark_host_changed() {
+    device_ahead_ = false;
+    master_ahead_ = false;
+    device_stale_ = true;
+    master_stale_ = true;
+}
 
-void ParameterSet::load(const std::string& path) { network_.load_from_file(path); }
+gpu::DeviceNetwork& ParameterSet::device_network() {
+    pull_training_copies();
+    if (device_stale_ || !device_) {
+        gpu::upload(network_, device_);
+        device_stale_ = false;
+    }
+    device_ahead_ = true;
+    master_stale_ = true;
+    return *device_;
+}
+
+MasterWeights& ParameterSet::master_weights() {
+    pull_training_copies();
+    if (master_stale_ || !master_) {
+        if (!master_) {
+            master_ = std::make_unique<MasterWeights>();
+        }
+        master_->load(network_);
+        master_stale_ = false;
+    }
+    master_ahead_ = true;
+    device_stale_ = true;
+    return *master_;
+}
 
 void ParameterSet::save(const std::string& path) const {
+    pull_training_copies();
     namespace fs = std::filesystem;
     fs::path target(path);
 
@@ -288,66 +607,264 @@ Trainer::Trainer(Config config) : config_(config) {}
 
 int Trainer::evaluate_example(const TrainingExample& example, const ParameterSet& parameters) const {
     Board board;
-    board.set_from_fen(example.fen);
+    load_example_position(example, board);
     return evaluate_with_network(board, parameters.network());
 }
 
+std::vector<int> Trainer::evaluate_batch(const FeatureBatch& batch, const ParameterSet& parameters) const {
+    trace::Span span("evaluate_batch");
+    if (batch.feature_set != parameters.feature_set()) {
+        throw std::invalid_argument("Feature batch was decoded for a different feature set than the network");
+    }
+    std::vector<int> scores(batch.size());
+    if (batch.empty()) {
+        return scores;
+    }
+    const nnue::Network& network = parameters.network();
+    std::size_t shard_count = shard_count_for(batch.size(), config_);
+    run_shards(shard_count, [&](std::size_t index) {
+        auto [begin, end] = shard_bounds(batch.size(), index, shard_count);
+        evaluate_features(batch, begin, end, network, scores.data());
+    });
+    return scores;
+}
+
+std::vector<int> Trainer::evaluate_examples(const TrainingExample* begin, const TrainingExample* end,
+                                            const ParameterSet& parameters) const {
+    trace::Span span("evaluate_examples");
+    auto count = static_cast<std::size_t>(end - begin);
+    std::vector<int> scores(count);
+    if (count == 0) {
+        return scores;
+    }
+    // Refresh the network once here; the shards only read it.
+    const nnue::Network& network = parameters.network();
+    std::size_t shard_count = shard_count_for(count, config_);
+    run_shards(shard_count, [&](std::size_t index) {
+        auto [first, last] = shard_bounds(count, index, shard_count);
+        FeatureBatch batch;
+        encode_feature_batch(begin + first, begin + last, network.feature_set(), batch);
+        evaluate_features(batch, 0, batch.size(), network, scores.data() + first);
+    });
+    return scores;
+}
+
 void Trainer::train_batch(const std::vector<TrainingExample>& batch, ParameterSet& parameters) const {
     if (batch.empty()) {
         return;
     }
+    if (trains_examples_on_gpu(config_)) {
+        trace::Span span("train_batch");
+        gpu::train_examples(batch, parameters.network(), config_);
+        return;
+    }
+    FeatureBatch features;
+    encode_feature_batch(batch.data(), batch.data() + batch.size(), parameters.feature_set(), features);
+    train_batch(features, parameters);
+}
+
+void Trainer::train_batch(const FeatureBatch& batch, ParameterSet& parameters) const {
+    if (batch.empty()) {
+        return;
+    }
+    trace::Span span("train_batch");
+    if (batch.feature_set != parameters.feature_set()) {
+        throw std::invalid_argument("Feature batch was decoded for a different feature set than the network");
+    }
 
     if (config_.device == TrainerDevice::kGPU) {
         if (!gpu::is_available()) {
             throw std::runtime_error(
                 "GPU training requested but CUDA support was not enabled when building Chiron");
         }
-        gpu::train_batch(batch, parameters.network(), config_);
+        if (gpu::keeps_weights_resident()) {
+            gpu::train_batch(batch, parameters.device_network(), config_);
+            return;
+        }
+        if (config_.optimizer.kind != OptimizerKind::kSgd) {
+            throw std::runtime_error(
+                "Adam on the GPU requires the batched CUDA trainer (-DCHIRON_CUDA_BATCHED_TRAINER=ON)");
+        }
+        // The per-example kernel decodes positions itself, so hand it the examples behind the batch.
+        if (batch.sources.size() != batch.size()) {
+            throw std::invalid_argument("The per-example CUDA trainer needs the examples a feature batch came from");
+        }
+        std::vector<TrainingExample> examples;
+        examples.reserve(batch.size());
+        for (const TrainingExample* example : batch.sources) {
+            examples.push_back(*example);
+        }
+        gpu::train_examples(examples, parameters.network(), config_);
         return;
     }
 
-    train_batch_cpu(batch, parameters.network(), config_);
+    if (config_.optimizer.kind == OptimizerKind::kSgd) {
+        nnue::Network& network = parameters.network();
+        apply_gradients(compute_gradients(batch, network, config_, config_.learning_rate), batch.size(), network,
+                        config_);
+        return;
+    }
+    MasterWeights& master = parameters.master_weights();
+    apply_adam(compute_gradients(batch, master, config_, 1.0), batch.size(), master, config_);
+}
+
+
+void FeatureBatch::clear(nnue::FeatureSet features) {
+    feature_set = features;
+    this->features.clear();
+    offsets.assign(1, 0);
+    targets.clear();
+    orientations.clear();
+    sources.clear();
+}
+
+void FeatureBatch::append(const Board& board, int target_cp) {
+    std::array<std::size_t, nnue::kMaxActiveFeatures> active{};
+    for (Color lane : {Color::White, Color::Black}) {
+        std::size_t count = nnue::append_active_features(board, feature_set, lane, active.data());
+        for (std::size_t i = 0; i < count; ++i) {
+            features.push_back(static_cast<std::uint32_t>(active[i]));
+        }
+        offsets.push_back(static_cast<std::uint32_t>(features.size()));
+    }
+    targets.push_back(target_cp);
+    orientations.push_back(board.side_to_move() == Color::White ? 1 : -1);
+}
+
+void encode_feature_batch(const TrainingExample* begin, const TrainingExample* end, nnue::FeatureSet features,
+                          FeatureBatch& batch) {
+    batch.clear(features);
+    Board board;
+    for (const TrainingExample* example = begin; example != end; ++example) {
+        load_example_position(*example, board);
+        batch.append(board, example->target_cp);
+        batch.sources.push_back(example);
+    }
+}
+
+void load_example_position(const TrainingExample& example, Board& board) {
+    if (example.packed) {
+        example.packed->to_board(board);
+    } else {
+        board.set_from_fen(example.fen);
+    }
 }
 
+std::string example_fen(const TrainingExample& example) {
+    if (!example.packed || !example.fen.empty()) {
+        return example.fen;
+    }
+    Board board;
+    example.packed->to_board(board);
+    return board.fen();
+}
+
+bool is_packed_training_path(const std::string& path) {
+    return std::filesystem::path(path).extension() == ".bin";
+}
 
 std::vector<TrainingExample> load_training_file(const std::string& path) {
+    if (is_packed_training_file(path)) {
+        PackedPositionReader reader(path);
+        std::vector<TrainingExample> data;
+        data.reserve(reader.size());
+        for (const PackedPosition& position : reader) {
+            data.push_back({std::string{}, position.score, position});
+        }
+        return data;
+    }
+
     std::ifstream stream(path);
     if (!stream) {
         throw std::runtime_error("Failed to open training data file: " + path);
     }
 
     std::vector<TrainingExample> data;
-    std::string line;
-    while (std::getline(stream, line)) {
-        if (line.empty()) {
-            continue;
-        }
-        auto delimiter = line.find('|');
-        if (delimiter == std::string::npos) {
-            continue;
-        }
-        TrainingExample example;
-        example.fen = line.substr(0, delimiter);
-        std::string score = line.substr(delimiter + 1);
-        try {
-            example.target_cp = std::stoi(score);
-        } catch (const std::exception&) {
-            continue;
-        }
+    TrainingExample example;
+    while (read_text_example(stream, example)) {
         data.push_back(std::move(example));
     }
     return data;
 }
 
 void save_training_file(const std::string& path, const std::vector<TrainingExample>& data) {
+    if (is_packed_training_path(path)) {
+        save_packed_training_file(path, data);
+        return;
+    }
     std::ofstream stream(path, std::ios::out | std::ios::trunc);
     if (!stream) {
         throw std::runtime_error("Failed to open training file for writing: " + path);
     }
     for (const TrainingExample& example : data) {
+        stream << example_fen(example) << '|' << example.target_cp << '\n';
+    }
+}
+
+void save_packed_training_file(const std::string& path, const std::vector<TrainingExample>& data) {
+    PackedPositionWriter writer(path);
+    Board board;
+    for (const TrainingExample& example : data) {
+        writer.write(pack_example(example, board));
+    }
+    writer.close();
+}
+
+std::size_t convert_training_file(const std::string& input, const std::string& output, bool packed_output) {
+    if (is_packed_training_file(input)) {
+        PackedPositionReader reader(input);
+        if (packed_output) {
+            PackedPositionWriter writer(output);
+            for (const PackedPosition& position : reader) {
+                writer.write(position);
+            }
+            writer.close();
+            return writer.count();
+        }
+        std::ofstream stream(output, std::ios::out | std::ios::trunc);
+        if (!stream) {
+            throw std::runtime_error("Failed to open training file for writing: " + output);
+        }
+        Board board;
+        std::array<char, Board::kMaxFenLength> fen;
+        for (const PackedPosition& position : reader) {
+            position.to_board(board);
+            stream.write(fen.data(), static_cast<std::streamsize>(board.write_fen(fen.data())));
+            stream << '|' << position.score << '\n';
+        }
+        if (!stream) {
+            throw std::runtime_error("Failed to write training file: " + output);
+        }
+        return reader.size();
+    }
+
+    std::ifstream source(input);
+    if (!source) {
+        throw std::runtime_error("Failed to open training data file: " + input);
+    }
+    std::size_t written = 0;
+    TrainingExample example;
+    if (packed_output) {
+        PackedPositionWriter writer(output);
+        Board board;
+        while (read_text_example(source, example)) {
+            writer.write(pack_example(example, board));
+        }
+        writer.close();
+        return writer.count();
+    }
+    std::ofstream stream(output, std::ios::out | std::ios::trunc);
+    if (!stream) {
+        throw std::runtime_error("Failed to open training file for writing: " + output);
+    }
+    while (read_text_example(source, example)) {
         stream << example.fen << '|' << example.target_cp << '\n';
+        ++written;
     }
+    if (!stream) {
+        throw std::runtime_error("Failed to write training file: " + output);
+    }
+    return written;
 }
 
 }  // namespace chiron
-
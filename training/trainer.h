@@ -1,41 +1,113 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "board.h"
 #include "nnue/network.h"
+#include "training/optimizer.h"
+#include "training/packed_position.h"
 
 namespace chiron {
 
 /**
- * @brief Single training sample pairing a FEN position with a target evaluation.
+ * @brief Single training sample pairing a position with a target evaluation.
+ *
+ * Samples read from text carry a FEN; samples read from packed files carry the binary record
+ * instead and leave fen empty, so the training loop never parses text for them.
  */
 struct TrainingExample {
     std::string fen;   /**< Position encoded as a FEN string. */
     int target_cp = 0; /**< Target centipawn evaluation from the side to move. */
+    std::optional<PackedPosition> packed{}; /**< Binary form of the position, when loaded from a packed file. */
 };
 
+/** @brief Sets @p board to the example's position, preferring the packed record over the FEN. */
+void load_example_position(const TrainingExample& example, Board& board);
+
+/** @brief FEN of the example, rebuilt from the packed record when no text was loaded. */
+std::string example_fen(const TrainingExample& example);
+
+/**
+ * @brief Batch of examples already decoded into sparse feature indices, ready for a step.
+ *
+ * Example i's white-lane features are features[offsets[2i], offsets[2i+1]) and its black-lane
+ * features run on to offsets[2i+2], so decoding can be done ahead of (and apart from) training.
+ */
+struct FeatureBatch {
+    nnue::FeatureSet feature_set = nnue::FeatureSet::PieceSquare;
+    std::vector<std::uint32_t> features;
+    std::vector<std::uint32_t> offsets{0};
+    std::vector<int> targets;
+    std::vector<std::int8_t> orientations; /**< +1 when white is to move, -1 otherwise. */
+    /** Examples the batch was decoded from, for the per-example CUDA trainer; they must outlive the batch. */
+    std::vector<const TrainingExample*> sources;
+
+    [[nodiscard]] std::size_t size() const { return targets.size(); }
+    [[nodiscard]] bool empty() const { return targets.empty(); }
+
+    /** @brief Empties the batch, keeping its buffers, for examples decoded with @p features. */
+    void clear(nnue::FeatureSet features);
+    /** @brief Appends @p board's active features for both lanes with target @p target_cp. */
+    void append(const Board& board, int target_cp);
+};
+
+/** @brief Decodes @p begin..@p end into @p batch (cleared first) using feature set @p features. */
+void encode_feature_batch(const TrainingExample* begin, const TrainingExample* end, nnue::FeatureSet features,
+                          FeatureBatch& batch);
+
+namespace gpu {
+struct DeviceNetwork;
+}
+
 /**
  * @brief Lightweight wrapper managing a mutable NNUE network instance.
+ *
+ * Adam training keeps float master weights, and GPU training keeps the weights resident on the
+ * device, between batches. The integer network is refreshed from whichever copy is newer the
+ * first time network() or save() needs it.
  */
 class ParameterSet {
    public:
-    explicit ParameterSet(std::size_t hidden_size = nnue::kDefaultHiddenSize);
+    explicit ParameterSet(std::size_t hidden_size = nnue::kDefaultHiddenSize,
+                          nnue::FeatureSet features = nnue::FeatureSet::PieceSquare);
 
+    ParameterSet(const ParameterSet&) = delete;
+    ParameterSet& operator=(const ParameterSet&) = delete;
+
+    /** @brief Re-initialises the network, keeping the current feature set. */
     void reset(std::size_t hidden_size);
+    void reset(std::size_t hidden_size, nnue::FeatureSet features);
     void load(const std::string& path);
     void save(const std::string& path) const;
 
-    nnue::Network& network() { return network_; }
-    const nnue::Network& network() const { return network_; }
+    /** @brief Mutable access; training copies are rebuilt from the network before the next step. */
+    nnue::Network& network();
+    const nnue::Network& network() const;
+    /** @brief Feature set of the network, without refreshing it from a training copy. */
+    [[nodiscard]] nnue::FeatureSet feature_set() const { return network_.feature_set(); }
 
    private:
-    nnue::Network network_{};
+    friend class Trainer;
+
+    void pull_training_copies() const;
+    void mark_host_changed();
+    gpu::DeviceNetwork& device_network();
+    MasterWeights& master_weights();
+
+    // Mutable so const readers can refresh the host copy from a newer training copy.
+    mutable nnue::Network network_{};
+    std::shared_ptr<gpu::DeviceNetwork> device_;
+    std::unique_ptr<MasterWeights> master_;
+    mutable bool device_ahead_ = false;  // The device holds steps the host has not seen.
+    mutable bool master_ahead_ = false;  // The master weights hold steps the host has not seen.
+    bool device_stale_ = true;           // The host changed since the last upload.
+    bool master_stale_ = true;           // The host changed since the master weights were built.
 };
 
-constexpr int kTrainerWeightLimit = 40000;
-
 enum class TrainerDevice {
     kCPU,
     kGPU,
@@ -43,6 +115,9 @@ enum class TrainerDevice {
 
 /**
  * @brief Gradient-style optimiser for the simple NNUE evaluation.
+ *
+ * Each batch is one step: SGD applies it straight to the integer weights, Adam/AdamW to float
+ * master weights that are quantised into the network only when it is read.
  */
 class Trainer {
    public:
@@ -50,20 +125,55 @@ class Trainer {
         double learning_rate = 0.05;
         double regularisation = 0.0005;
         TrainerDevice device = TrainerDevice::kCPU;
+        /**
+         * CPU threads a batch is sharded over (0 = all cores). Each shard sums sparse gradients
+         * for its active features; the sums are reduced and applied as one step per batch.
+         */
+        std::size_t threads = 1;
+        OptimizerConfig optimizer{};
     };
 
     Trainer();
     explicit Trainer(Config config);
 
     void train_batch(const std::vector<TrainingExample>& batch, ParameterSet& parameters) const;
+    /** @brief Trains on a pre-decoded batch; it must use the network's feature set. */
+    void train_batch(const FeatureBatch& batch, ParameterSet& parameters) const;
     int evaluate_example(const TrainingExample& example, const ParameterSet& parameters) const;
+    /**
+     * @brief Scores every example of a pre-decoded @p batch, sharded over the configured threads.
+     *
+     * Scores are from the side to move's point of view and equal evaluate_example()'s, but each
+     * position's features are decoded only once and the forward passes share their buffers.
+     */
+    [[nodiscard]] std::vector<int> evaluate_batch(const FeatureBatch& batch, const ParameterSet& parameters) const;
+    /** @brief Decodes and scores @p begin..@p end, each thread decoding its own share of the examples. */
+    [[nodiscard]] std::vector<int> evaluate_examples(const TrainingExample* begin, const TrainingExample* end,
+                                                     const ParameterSet& parameters) const;
 
    private:
     Config config_;
 };
 
+/**
+ * @brief Loads "fen|score" text or a packed binary file, detected from the file header.
+ */
 std::vector<TrainingExample> load_training_file(const std::string& path);
+
+/** @brief True when datasets written to @p path use the packed format (a ".bin" extension). */
+[[nodiscard]] bool is_packed_training_path(const std::string& path);
+
+/**
+ * @brief Writes @p data as text, or as packed records when is_packed_training_path(@p path).
+ */
 void save_training_file(const std::string& path, const std::vector<TrainingExample>& data);
+void save_packed_training_file(const std::string& path, const std::vector<TrainingExample>& data);
+
+/**
+ * @brief Streams @p input (text or packed) into @p output in the requested format without
+ *        holding the dataset in memory; returns the number of samples written.
+ */
+std::size_t convert_training_file(const std::string& input, const std::string& output, bool packed_output);
 
 }  // namespace chiron
 
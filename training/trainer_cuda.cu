@@ -1,6 +1,7 @@
 #include <cuda_runtime.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdint>
 #include <stdexcept>
@@ -9,6 +10,7 @@
 
 #include "bitboard.h"
 #include "board.h"
+#include "nnue/feature_set.h"
 #include "nnue/network.h"
 #include "training/gpu_backend.h"
 
@@ -45,14 +47,15 @@ __global__ void train_example_kernel(const int8_t* features, int target_cp, int
 
     int tid = threadIdx.x;
     if (tid < hidden_size) {
-        long long offset = static_cast<long long>(tid) * feature_count;
+        // Feature-major weights: neighbouring threads read neighbouring words (coalesced).
         double pre = static_cast<double>(hidden_biases[tid]);
         for (int f = 0; f < feature_count; ++f) {
             int8_t feature = features[f];
             if (feature == 0) {
                 continue;
             }
-            pre += static_cast<double>(input_weights[offset + f]) * static_cast<double>(feature);
+            long long index = static_cast<long long>(f) * hidden_size + tid;
+            pre += static_cast<double>(input_weights[index]) * static_cast<double>(feature);
         }
         double normalized = pre / nnue::kActivationScale;
         double tanh_val = tanh(normalized);
@@ -105,32 +108,31 @@ __global__ void train_example_kernel(const int8_t* features, int target_cp, int
         return;
     }
 
-    long long offset = static_cast<long long>(tid) * feature_count;
     for (int f = 0; f < feature_count; ++f) {
         int8_t feature = features[f];
         if (feature == 0) {
             continue;
         }
-        int32_t current = input_weights[offset + f];
+        long long index = static_cast<long long>(f) * hidden_size + tid;
+        int32_t current = input_weights[index];
         double next = static_cast<double>(current) + grad_pre * static_cast<double>(feature);
         if (regularisation > 0.0) {
             next -= regularisation * static_cast<double>(current);
         }
-        input_weights[offset + f] = clamp_weight_device(next);
+        input_weights[index] = clamp_weight_device(next);
     }
 }
 
-void encode_features(const Board& board, std::vector<int8_t>& buffer) {
+void encode_features(const Board& board, nnue::FeatureSet set, std::vector<int8_t>& buffer) {
     std::fill(buffer.begin(), buffer.end(), 0);
+    // White-lane inputs count +1 and black-lane inputs -1; a HalfKP feature active in both
+    // lanes cancels out, exactly as it does in the accumulator difference.
+    std::array<std::size_t, nnue::kMaxActiveFeatures> features{};
     for (int color = 0; color < kNumColors; ++color) {
-        for (int piece = 0; piece < kNumPieceTypes; ++piece) {
-            Bitboard bb = board.pieces(static_cast<Color>(color), static_cast<PieceType>(piece));
-            while (bb) {
-                int square = pop_lsb(bb);
-                std::size_t feature =
-                    nnue::feature_index(static_cast<Color>(color), static_cast<PieceType>(piece), square);
-                buffer[feature] = (color == static_cast<int>(Color::White)) ? 1 : -1;
-            }
+        int8_t sign = color == static_cast<int>(Color::White) ? 1 : -1;
+        std::size_t count = nnue::append_active_features(board, set, static_cast<Color>(color), features.data());
+        for (std::size_t i = 0; i < count; ++i) {
+            buffer[features[i]] = static_cast<int8_t>(buffer[features[i]] + sign);
         }
     }
 }
@@ -147,7 +149,7 @@ void train_batch_cuda(const std::vector<TrainingExample>& batch, nnue::Network&
     if (hidden <= 0) {
         return;
     }
-    int feature_count = static_cast<int>(nnue::kFeatureCount);
+    int feature_count = static_cast<int>(network.feature_count());
 
     auto& input_weights = network.input_weights_data();
     auto& hidden_biases = network.hidden_biases_data();
@@ -185,10 +187,10 @@ void train_batch_cuda(const std::vector<TrainingExample>& batch, nnue::Network&
 
         std::vector<int8_t> feature_buffer(static_cast<std::size_t>(feature_count), 0);
 
+        Board board;
         for (const TrainingExample& example : batch) {
-            Board board;
-            board.set_from_fen(example.fen);
-            encode_features(board, feature_buffer);
+            load_example_position(example, board);
+            encode_features(board, network.feature_set(), feature_buffer);
 
             check_cuda(cudaMemcpy(d_features, feature_buffer.data(),
                                   static_cast<size_t>(feature_count) * sizeof(int8_t), cudaMemcpyHostToDevice),
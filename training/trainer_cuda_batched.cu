@@ -0,0 +1,423 @@
+#include <cuda_runtime.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bitboard.h"
+#include "board.h"
+#include "nnue/feature_set.h"
+#include "nnue/network.h"
+#include "training/gpu_backend.h"
+#include "training/optimizer.h"
+
+namespace chiron::gpu {
+
+namespace {
+
+void check_cuda(cudaError_t result, const char* context) {
+    if (result != cudaSuccess) {
+        throw std::runtime_error(std::string("CUDA error during ") + context + ": " +
+                                 cudaGetErrorString(result));
+    }
+}
+
+// Power of two, so the per-example output reduction can halve the active threads each round.
+constexpr int kMaxBlockThreads = 256;
+
+int block_threads(std::size_t hidden) {
+    int threads = 32;
+    while (threads < kMaxBlockThreads && static_cast<std::size_t>(threads) < hidden) {
+        threads <<= 1;
+    }
+    return threads;
+}
+
+/**
+ * @brief Growable device allocation; contents are undefined after a grow.
+ */
+template <typename T>
+class DeviceBuffer {
+   public:
+    DeviceBuffer() = default;
+    DeviceBuffer(const DeviceBuffer&) = delete;
+    DeviceBuffer& operator=(const DeviceBuffer&) = delete;
+    ~DeviceBuffer() {
+        if (data_) {
+            cudaFree(data_);
+        }
+    }
+
+    void reserve(std::size_t count, const char* context) {
+        if (count <= capacity_) {
+            return;
+        }
+        if (data_) {
+            cudaFree(data_);
+            data_ = nullptr;
+            capacity_ = 0;
+        }
+        check_cuda(cudaMalloc(&data_, std::max<std::size_t>(count, 1) * sizeof(T)), context);
+        capacity_ = count;
+    }
+
+    void upload(const std::vector<T>& host, const char* context) {
+        reserve(host.size(), context);
+        if (!host.empty()) {
+            check_cuda(cudaMemcpy(data_, host.data(), host.size() * sizeof(T), cudaMemcpyHostToDevice), context);
+        }
+    }
+
+    void download(std::vector<T>& host, std::size_t count, const char* context) const {
+        host.resize(count);
+        if (count != 0) {
+            check_cuda(cudaMemcpy(host.data(), data_, count * sizeof(T), cudaMemcpyDeviceToHost), context);
+        }
+    }
+
+    void zero(std::size_t count, const char* context) {
+        reserve(count, context);
+        check_cuda(cudaMemset(data_, 0, std::max<std::size_t>(count, 1) * sizeof(T)), context);
+    }
+
+    [[nodiscard]] T* get() const { return data_; }
+
+   private:
+    T* data_ = nullptr;
+    std::size_t capacity_ = 0;
+};
+
+__device__ inline float clamp_weight_device(float value) {
+    return fminf(fmaxf(rintf(value), static_cast<float>(-kTrainerWeightLimit)), static_cast<float>(kTrainerWeightLimit));
+}
+
+/**
+ * @brief One block per example: forward pass over the example's sparse features.
+ *
+ * Entries hold (feature << 1) | lane, lane 1 meaning the black accumulator (subtracted).
+ * Activations and derivatives are kept for the backward kernel, and thread 0 leaves the
+ * scaled error of the example in lr_errors.
+ */
+__global__ void forward_kernel(const int32_t* offsets, const int32_t* entries, const float* targets,
+                               const float* orientations, const float* input_weights, const float* hidden_biases,
+                               const float* output_weights, const float* bias, int hidden_size, float scale,
+                               float learning_rate, float* activations, float* derivatives, float* lr_errors,
+                               float* bias_grad) {
+    extern __shared__ float partial_sums[];
+    const int example = blockIdx.x;
+    const int begin = offsets[example];
+    const int end = offsets[example + 1];
+    const std::size_t row = static_cast<std::size_t>(example) * hidden_size;
+
+    float partial = 0.0f;
+    for (int neuron = threadIdx.x; neuron < hidden_size; neuron += blockDim.x) {
+        // Feature-major weights: neighbouring threads read neighbouring words (coalesced).
+        float pre = hidden_biases[neuron];
+        for (int e = begin; e < end; ++e) {
+            int entry = entries[e];
+            float weight = input_weights[static_cast<std::size_t>(entry >> 1) * hidden_size + neuron];
+            pre += (entry & 1) ? -weight : weight;
+        }
+        float tanh_val = tanhf(pre / nnue::kActivationScale);
+        float activation = tanh_val * nnue::kActivationScale;
+        activations[row + neuron] = activation;
+        derivatives[row + neuron] = 1.0f - tanh_val * tanh_val;
+        partial += activation * output_weights[neuron];
+    }
+    partial_sums[threadIdx.x] = partial;
+    __syncthreads();
+
+    for (unsigned stride = blockDim.x / 2; stride > 0; stride >>= 1) {
+        if (threadIdx.x < stride) {
+            partial_sums[threadIdx.x] += partial_sums[threadIdx.x + stride];
+        }
+        __syncthreads();
+    }
+
+    if (threadIdx.x == 0) {
+        float orientation = orientations[example];
+        float raw = bias[0] + partial_sums[0];
+        float error = targets[example] - orientation * raw * scale;
+        float lr_error = learning_rate * error * orientation * scale;
+        lr_errors[example] = lr_error;
+        atomicAdd(bias_grad, lr_error);
+    }
+}
+
+/**
+ * @brief One block per example: scatters its gradients into the batch-wide sums.
+ */
+__global__ void backward_kernel(const int32_t* offsets, const int32_t* entries, const float* output_weights,
+                                const float* activations, const float* derivatives, const float* lr_errors,
+                                int hidden_size, float* output_grad, float* hidden_bias_grad, float* input_grad) {
+    const int example = blockIdx.x;
+    const int begin = offsets[example];
+    const int end = offsets[example + 1];
+    const std::size_t row = static_cast<std::size_t>(example) * hidden_size;
+    const float lr_error = lr_errors[example];
+
+    for (int neuron = threadIdx.x; neuron < hidden_size; neuron += blockDim.x) {
+        float grad_pre = lr_error * output_weights[neuron] * derivatives[row + neuron];
+        atomicAdd(&output_grad[neuron], lr_error * activations[row + neuron]);
+        atomicAdd(&hidden_bias_grad[neuron], grad_pre);
+        for (int e = begin; e < end; ++e) {
+            int entry = entries[e];
+            atomicAdd(&input_grad[static_cast<std::size_t>(entry >> 1) * hidden_size + neuron],
+                      (entry & 1) ? -grad_pre : grad_pre);
+        }
+    }
+}
+
+/**
+ * @brief One block per feature touched by the batch: applies and clears its gradient row.
+ *
+ * Only touched rows are visited, so the dense gradient buffer stays zero between batches
+ * without a full memset. With Adam the moments live alongside the float master weights.
+ */
+__global__ void apply_input_kernel(const int32_t* features, const int32_t* hits, int hidden_size,
+                                   float regularisation, bool use_adam, AdamStep adam, float* input_weights,
+                                   float* input_grad, float* first_moments, float* second_moments) {
+    const std::size_t row = static_cast<std::size_t>(features[blockIdx.x]) * hidden_size;
+    const float count = static_cast<float>(hits[blockIdx.x]);
+    const float decay = regularisation > 0.0f ? powf(1.0f - regularisation, count) : 1.0f;
+    const float limit = static_cast<float>(kTrainerWeightLimit);
+    for (int neuron = threadIdx.x; neuron < hidden_size; neuron += blockDim.x) {
+        std::size_t index = row + neuron;
+        if (use_adam) {
+            adam_update(input_weights[index], first_moments[index], second_moments[index], input_grad[index], count,
+                        adam, 1.0f, limit);
+        } else {
+            input_weights[index] = clamp_weight_device(input_weights[index] * decay + input_grad[index]);
+        }
+        input_grad[index] = 0.0f;
+    }
+}
+
+/**
+ * @brief Dense parameters (hidden biases, output weights, output bias); moment arrays are laid
+ *        out hidden biases, then output weights, then the bias.
+ */
+__global__ void apply_dense_kernel(int hidden_size, float decay, float samples, bool use_adam, AdamStep adam,
+                                   float* hidden_biases, float* hidden_bias_grad, float* output_weights,
+                                   float* output_grad, float* bias, float* bias_grad, float* first_moments,
+                                   float* second_moments) {
+    const float limit = static_cast<float>(kTrainerWeightLimit);
+    for (int neuron = threadIdx.x; neuron < hidden_size; neuron += blockDim.x) {
+        if (use_adam) {
+            adam_update(hidden_biases[neuron], first_moments[neuron], second_moments[neuron], hidden_bias_grad[neuron],
+                        samples, adam, 1.0f, limit);
+            int output = hidden_size + neuron;
+            adam_update(output_weights[neuron], first_moments[output], second_moments[output], output_grad[neuron],
+                        samples, adam, kOutputStepScale, 0.0f);
+        } else {
+            hidden_biases[neuron] = clamp_weight_device(hidden_biases[neuron] * decay + hidden_bias_grad[neuron]);
+            output_weights[neuron] = output_weights[neuron] * decay + output_grad[neuron];
+        }
+        hidden_bias_grad[neuron] = 0.0f;
+        output_grad[neuron] = 0.0f;
+    }
+    if (threadIdx.x == 0) {
+        if (use_adam) {
+            int slot = 2 * hidden_size;
+            adam_update(bias[0], first_moments[slot], second_moments[slot], bias_grad[0], samples, adam, 1.0f, limit);
+        } else {
+            bias[0] = clamp_weight_device(bias[0] * decay + bias_grad[0]);
+        }
+        bias_grad[0] = 0.0f;
+    }
+}
+
+}  // namespace
+
+/**
+ * Weights live on the device as floats. SGD keeps them integer-rounded and clamped like the
+ * host network; Adam treats them as master weights, quantised only by a download. Gradient
+ * buffers are zero between batches; the per-batch buffers only grow.
+ */
+struct DeviceNetwork {
+    std::size_t hidden = 0;
+    std::size_t features = 0;
+    nnue::FeatureSet feature_set = nnue::FeatureSet::PieceSquare;
+    float scale = 1.0f;
+
+    DeviceBuffer<float> input_weights;
+    DeviceBuffer<float> hidden_biases;
+    DeviceBuffer<float> output_weights;
+    DeviceBuffer<float> bias;
+    DeviceBuffer<float> input_grad;
+    DeviceBuffer<float> hidden_bias_grad;
+    DeviceBuffer<float> output_grad;
+    DeviceBuffer<float> bias_grad;
+
+    // Adam moments, allocated on the first Adam step and reset by every upload.
+    DeviceBuffer<float> input_first_moments;
+    DeviceBuffer<float> input_second_moments;
+    DeviceBuffer<float> dense_first_moments;
+    DeviceBuffer<float> dense_second_moments;
+    bool moments_ready = false;
+    std::size_t adam_step = 0;
+
+    DeviceBuffer<int32_t> offsets;
+    DeviceBuffer<int32_t> entries;
+    DeviceBuffer<float> targets;
+    DeviceBuffer<float> orientations;
+    DeviceBuffer<float> activations;
+    DeviceBuffer<float> derivatives;
+    DeviceBuffer<float> lr_errors;
+    DeviceBuffer<int32_t> touched;
+    DeviceBuffer<int32_t> touched_hits;
+
+    // Host staging reused across batches.
+    std::vector<int32_t> host_offsets;
+    std::vector<int32_t> host_entries;
+    std::vector<float> host_targets;
+    std::vector<float> host_orientations;
+    std::vector<int32_t> host_touched;
+    std::vector<int32_t> host_touched_hits;
+    std::vector<int32_t> feature_hits;  // Indexed by feature; left all zero after each batch.
+};
+
+void upload_cuda(const nnue::Network& host, std::shared_ptr<DeviceNetwork>& device) {
+    if (!device) {
+        device = std::make_shared<DeviceNetwork>();
+    }
+    DeviceNetwork& net = *device;
+    net.hidden = host.hidden_size();
+    net.features = host.feature_count();
+    net.feature_set = host.feature_set();
+    net.scale = host.scale();
+
+    auto as_floats = [](auto values) { return std::vector<float>(values.begin(), values.end()); };
+    net.input_weights.upload(as_floats(host.input_weights_data()), "upload input weights");
+    net.hidden_biases.upload(as_floats(host.hidden_biases_data()), "upload hidden biases");
+    net.output_weights.upload(as_floats(host.output_weights_data()), "upload output weights");
+    net.bias.upload(std::vector<float>{static_cast<float>(host.bias())}, "upload bias");
+
+    net.input_grad.zero(net.features * net.hidden, "clear input gradients");
+    net.hidden_bias_grad.zero(net.hidden, "clear hidden bias gradients");
+    net.output_grad.zero(net.hidden, "clear output gradients");
+    net.bias_grad.zero(1, "clear bias gradient");
+    net.feature_hits.assign(net.features, 0);
+    net.moments_ready = false;
+    net.adam_step = 0;
+}
+
+void train_batch_cuda(const FeatureBatch& batch, DeviceNetwork& net, const Trainer::Config& config) {
+    if (batch.empty() || net.hidden == 0) {
+        return;
+    }
+
+    // The batch arrives already decoded; only the lane bit and touched rows are added here.
+    net.host_offsets.assign(1, 0);
+    net.host_entries.clear();
+    net.host_targets.clear();
+    net.host_orientations.clear();
+    net.host_touched.clear();
+    for (std::size_t example = 0; example < batch.size(); ++example) {
+        for (int color = 0; color < kNumColors; ++color) {
+            for (std::uint32_t i = batch.offsets[2 * example + color]; i < batch.offsets[2 * example + color + 1];
+                 ++i) {
+                int32_t feature = static_cast<int32_t>(batch.features[i]);
+                net.host_entries.push_back((feature << 1) | color);
+                if (net.feature_hits[feature]++ == 0) {
+                    net.host_touched.push_back(feature);
+                }
+            }
+        }
+        net.host_offsets.push_back(static_cast<int32_t>(net.host_entries.size()));
+        net.host_targets.push_back(static_cast<float>(batch.targets[example]));
+        net.host_orientations.push_back(static_cast<float>(batch.orientations[example]));
+    }
+    net.host_touched_hits.clear();
+    for (int32_t feature : net.host_touched) {
+        net.host_touched_hits.push_back(net.feature_hits[feature]);
+        net.feature_hits[feature] = 0;
+    }
+
+    const std::size_t examples = batch.size();
+    net.offsets.upload(net.host_offsets, "upload feature offsets");
+    net.entries.upload(net.host_entries, "upload feature entries");
+    net.targets.upload(net.host_targets, "upload targets");
+    net.orientations.upload(net.host_orientations, "upload orientations");
+    net.touched.upload(net.host_touched, "upload touched features");
+    net.touched_hits.upload(net.host_touched_hits, "upload touched feature counts");
+    net.activations.reserve(examples * net.hidden, "allocate activations");
+    net.derivatives.reserve(examples * net.hidden, "allocate derivatives");
+    net.lr_errors.reserve(examples, "allocate errors");
+
+    const bool use_adam = config.optimizer.kind != OptimizerKind::kSgd;
+    AdamStep adam{};
+    if (use_adam) {
+        if (!net.moments_ready) {
+            net.input_first_moments.zero(net.features * net.hidden, "clear input moments");
+            net.input_second_moments.zero(net.features * net.hidden, "clear input moments");
+            net.dense_first_moments.zero(2 * net.hidden + 1, "clear dense moments");
+            net.dense_second_moments.zero(2 * net.hidden + 1, "clear dense moments");
+            net.moments_ready = true;
+        }
+        adam = AdamStep::make(config.optimizer, config.learning_rate, config.regularisation, ++net.adam_step);
+    }
+
+    const int hidden = static_cast<int>(net.hidden);
+    const int threads = block_threads(net.hidden);
+    const int blocks = static_cast<int>(examples);
+    forward_kernel<<<blocks, threads, threads * sizeof(float)>>>(
+        net.offsets.get(), net.entries.get(), net.targets.get(), net.orientations.get(), net.input_weights.get(),
+        net.hidden_biases.get(), net.output_weights.get(), net.bias.get(), hidden, net.scale,
+        use_adam ? 1.0f : static_cast<float>(config.learning_rate), net.activations.get(), net.derivatives.get(), net.lr_errors.get(),
+        net.bias_grad.get());
+    check_cuda(cudaGetLastError(), "launch forward_kernel");
+
+    backward_kernel<<<blocks, threads>>>(net.offsets.get(), net.entries.get(), net.output_weights.get(),
+                                         net.activations.get(), net.derivatives.get(), net.lr_errors.get(), hidden,
+                                         net.output_grad.get(), net.hidden_bias_grad.get(), net.input_grad.get());
+    check_cuda(cudaGetLastError(), "launch backward_kernel");
+
+    // Same step as the CPU trainer: summed gradients, then SGD (decay compounded per sample) or
+    // the shared adam_update().
+    const float regularisation = static_cast<float>(config.regularisation);
+    if (!net.host_touched.empty()) {
+        apply_input_kernel<<<static_cast<int>(net.host_touched.size()), threads>>>(
+            net.touched.get(), net.touched_hits.get(), hidden, regularisation, use_adam, adam, net.input_weights.get(),
+            net.input_grad.get(), net.input_first_moments.get(), net.input_second_moments.get());
+        check_cuda(cudaGetLastError(), "launch apply_input_kernel");
+    }
+    float decay = regularisation > 0.0f ? std::pow(1.0f - regularisation, static_cast<float>(examples)) : 1.0f;
+    apply_dense_kernel<<<1, threads>>>(hidden, decay, static_cast<float>(examples), use_adam, adam,
+                                       net.hidden_biases.get(), net.hidden_bias_grad.get(), net.output_weights.get(),
+                                       net.output_grad.get(), net.bias.get(), net.bias_grad.get(),
+                                       net.dense_first_moments.get(), net.dense_second_moments.get());
+    check_cuda(cudaGetLastError(), "launch apply_dense_kernel");
+}
+
+void download_cuda(const DeviceNetwork& device, nnue::Network& host) {
+    check_cuda(cudaDeviceSynchronize(), "training kernels");
+    std::vector<float> values;
+
+    auto quantize = [](float value) {
+        return static_cast<int32_t>(std::clamp(std::lrint(value), static_cast<long>(-kTrainerWeightLimit),
+                                               static_cast<long>(kTrainerWeightLimit)));
+    };
+
+    device.input_weights.download(values, device.features * device.hidden, "download input weights");
+    auto& input_weights = host.input_weights_data();
+    std::transform(values.begin(), values.end(), input_weights.begin(), quantize);
+
+    device.hidden_biases.download(values, device.hidden, "download hidden biases");
+    auto& hidden_biases = host.hidden_biases_data();
+    std::transform(values.begin(), values.end(), hidden_biases.begin(), quantize);
+
+    device.output_weights.download(values, device.hidden, "download output weights");
+    auto& output_weights = host.output_weights_data();
+    std::copy(values.begin(), values.end(), output_weights.begin());
+
+    device.bias.download(values, 1, "download bias");
+    host.set_bias(quantize(values[0]));
+}
+
+}  // namespace chiron::gpu
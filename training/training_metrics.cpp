@@ -15,16 +15,24 @@ DatasetEvaluationResult evaluate_dataset_performance(const std::vector<TrainingE
     }
 
     std::size_t sample_count = std::min<std::size_t>(max_samples, data.size());
+    std::vector<TrainingExample> sampled;
+    const TrainingExample* examples = data.data();
+    if (sample_count < data.size()) {
+        double step = static_cast<double>(data.size()) / static_cast<double>(sample_count);
+        sampled.reserve(sample_count);
+        for (std::size_t i = 0; i < sample_count; ++i) {
+            std::size_t index = std::min(static_cast<std::size_t>(i * step), data.size() - 1);
+            sampled.push_back(data[index]);
+        }
+        examples = sampled.data();
+    }
+    std::vector<int> predictions = trainer.evaluate_examples(examples, examples + sample_count, parameters);
+
     double total_score = 0.0;
     double total_squared_error = 0.0;
-    double step = static_cast<double>(data.size()) / static_cast<double>(sample_count);
     for (std::size_t i = 0; i < sample_count; ++i) {
-        std::size_t index = static_cast<std::size_t>(i * step);
-        if (index >= data.size()) {
-            index = data.size() - 1;
-        }
-        const TrainingExample& example = data[index];
-        int predicted_cp = trainer.evaluate_example(example, parameters);
+        const TrainingExample& example = examples[i];
+        int predicted_cp = predictions[i];
         double predicted_prob = 1.0 / (1.0 + std::exp(-static_cast<double>(predicted_cp) / 400.0));
         double actual_prob = 0.5;
         if (example.target_cp > 50) {
@@ -14,6 +14,10 @@ struct DatasetEvaluationResult {
     std::size_t samples = 0;
 };
 
+/**
+ * @brief Scores up to @p max_samples evenly spaced examples of @p data in one batched pass,
+ *        sharded over @p trainer's threads.
+ */
 DatasetEvaluationResult evaluate_dataset_performance(const std::vector<TrainingExample>& data,
                                                      const ParameterSet& parameters,
                                                      const Trainer& trainer,